@@ -1,7 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0-only
 /*
  * AES using the RISC-V vector crypto extensions.  Includes the bare block
- * cipher and the ECB, CBC, CBC-CTS, CTR, and XTS modes.
+ * cipher, the ECB, CBC, CBC-CTS, CTR, and XTS modes, and the GCM AEAD.
  *
  * Copyright (C) 2023 VRULL GmbH
  * Author: Heiko Stuebner <heiko.stuebner@vrull.eu>
@@ -15,6 +15,10 @@
 #include <asm/simd.h>
 #include <asm/vector.h>
 #include <crypto/aes.h>
+#include <crypto/algapi.h>
+#include <crypto/gcm.h>
+#include <crypto/ghash.h>
+#include <crypto/internal/aead.h>
 #include <crypto/internal/cipher.h>
 #include <crypto/internal/simd.h>
 #include <crypto/internal/skcipher.h>
@@ -60,6 +64,21 @@ asmlinkage void aes_xts_decrypt_zvkned_zvbb_zvkg(
 			const u8 *in, u8 *out, size_t len,
 			u8 tweak[AES_BLOCK_SIZE]);
 
+asmlinkage void aes_gcm_encrypt_zvkned_zvkb_zvkg(
+			const struct crypto_aes_ctx *key,
+			const be128 *ghash_key, be128 *accumulator,
+			const u8 *in, u8 *out, size_t len,
+			u8 ctr[AES_BLOCK_SIZE]);
+
+asmlinkage void aes_gcm_decrypt_zvkned_zvkb_zvkg(
+			const struct crypto_aes_ctx *key,
+			const be128 *ghash_key, be128 *accumulator,
+			const u8 *in, u8 *out, size_t len,
+			u8 ctr[AES_BLOCK_SIZE]);
+
+asmlinkage void aes_gcm_ghash_zvkg(be128 *accumulator, const be128 *key,
+				   const u8 *data, size_t len);
+
 static int riscv64_aes_setkey(struct crypto_aes_ctx *ctx,
 			      const u8 *key, unsigned int keylen)
 {
@@ -360,17 +379,20 @@ static int riscv64_aes_xts_crypt(struct skcipher_request *req, bool enc)
 	struct skcipher_request subreq;
 	struct scatterlist *src, *dst;
 	struct skcipher_walk walk;
+	bool hold_vector, in_vector;
 	int err;
 
 	if (req->cryptlen < AES_BLOCK_SIZE)
 		return -EINVAL;
 
-	/* Encrypt the IV with the tweak key to get the first tweak. */
-	kernel_vector_begin();
-	aes_encrypt_zvkned(&ctx->ctx2, req->iv, req->iv);
-	kernel_vector_end();
+	/*
+	 * If the vector unit can be held without disabling preemption, then
+	 * hold it for the whole walk instead of saving and restoring the
+	 * vector state around every step.  The walk then must not sleep.
+	 */
+	hold_vector = riscv_v_kernel_preemptible();
 
-	err = skcipher_walk_virt(&walk, req, false);
+	err = skcipher_walk_virt(&walk, req, hold_vector);
 
 	/*
 	 * If the message length isn't divisible by the AES block size and the
@@ -390,18 +412,30 @@ static int riscv64_aes_xts_crypt(struct skcipher_request *req, bool enc)
 					   req->cryptlen - tail - AES_BLOCK_SIZE,
 					   req->iv);
 		req = &subreq;
-		err = skcipher_walk_virt(&walk, req, false);
+		err = skcipher_walk_virt(&walk, req, hold_vector);
 	} else {
 		tail = 0;
 	}
 
+	/*
+	 * Encrypt the IV with the tweak key to get the first tweak.  This
+	 * shares the vector section of the first step of the walk, so that a
+	 * request that fits in one step, e.g. a disk sector, needs only one.
+	 */
+	kernel_vector_begin();
+	aes_encrypt_zvkned(&ctx->ctx2, req->iv, req->iv);
+	in_vector = true;
+
 	while (walk.nbytes) {
 		unsigned int nbytes = walk.nbytes;
 
 		if (nbytes < walk.total)
 			nbytes = round_down(nbytes, AES_BLOCK_SIZE);
 
-		kernel_vector_begin();
+		if (!in_vector) {
+			kernel_vector_begin();
+			in_vector = true;
+		}
 		if (enc)
 			aes_xts_encrypt_zvkned_zvbb_zvkg(
 				&ctx->ctx1, walk.src.virt.addr,
@@ -410,9 +444,14 @@ static int riscv64_aes_xts_crypt(struct skcipher_request *req, bool enc)
 			aes_xts_decrypt_zvkned_zvbb_zvkg(
 				&ctx->ctx1, walk.src.virt.addr,
 				walk.dst.virt.addr, nbytes, req->iv);
-		kernel_vector_end();
+		if (!hold_vector) {
+			kernel_vector_end();
+			in_vector = false;
+		}
 		err = skcipher_walk_done(&walk, walk.nbytes - nbytes);
 	}
+	if (in_vector)
+		kernel_vector_end();
 
 	if (err || likely(!tail))
 		return err;
@@ -454,6 +493,247 @@ static int riscv64_aes_xts_decrypt(struct skcipher_request *req)
 	return riscv64_aes_xts_crypt(req, false);
 }
 
+/* AES-GCM */
+
+struct riscv64_aes_gcm_ctx {
+	struct crypto_aes_ctx aes;
+	be128 ghash_key;
+	u8 nonce[4];	/* rfc4106 only */
+};
+
+static int riscv64_aes_gcm_setkey(struct crypto_aead *tfm, const u8 *key,
+				  unsigned int keylen)
+{
+	struct riscv64_aes_gcm_ctx *ctx = crypto_aead_ctx(tfm);
+	int err;
+
+	err = riscv64_aes_setkey(&ctx->aes, key, keylen);
+	if (err)
+		return err;
+
+	/* The GHASH key is the encryption of the all-zeroes block. */
+	memset(&ctx->ghash_key, 0, sizeof(ctx->ghash_key));
+	aes_encrypt(&ctx->aes, (u8 *)&ctx->ghash_key, (u8 *)&ctx->ghash_key);
+
+	return 0;
+}
+
+static int riscv64_rfc4106_setkey(struct crypto_aead *tfm, const u8 *key,
+				  unsigned int keylen)
+{
+	struct riscv64_aes_gcm_ctx *ctx = crypto_aead_ctx(tfm);
+
+	if (keylen < sizeof(ctx->nonce))
+		return -EINVAL;
+
+	keylen -= sizeof(ctx->nonce);
+	memcpy(ctx->nonce, key + keylen, sizeof(ctx->nonce));
+
+	return riscv64_aes_gcm_setkey(tfm, key, keylen);
+}
+
+static int riscv64_aes_gcm_setauthsize(struct crypto_aead *tfm,
+				       unsigned int authsize)
+{
+	return crypto_gcm_check_authsize(authsize);
+}
+
+static int riscv64_rfc4106_setauthsize(struct crypto_aead *tfm,
+				       unsigned int authsize)
+{
+	return crypto_rfc4106_check_authsize(authsize);
+}
+
+/* Hash @len bytes of associated data, carrying partial blocks in @buf. */
+static void riscv64_aes_gcm_ghash_assoc(const struct riscv64_aes_gcm_ctx *ctx,
+					be128 *acc, u8 buf[GHASH_BLOCK_SIZE],
+					unsigned int *buflen, const u8 *src,
+					unsigned int len)
+{
+	unsigned int n;
+
+	if (*buflen) {
+		n = min_t(unsigned int, len, GHASH_BLOCK_SIZE - *buflen);
+		memcpy(buf + *buflen, src, n);
+		*buflen += n;
+		src += n;
+		len -= n;
+		if (*buflen < GHASH_BLOCK_SIZE)
+			return;
+		aes_gcm_ghash_zvkg(acc, &ctx->ghash_key, buf, GHASH_BLOCK_SIZE);
+		*buflen = 0;
+	}
+
+	n = round_down(len, GHASH_BLOCK_SIZE);
+	if (n) {
+		aes_gcm_ghash_zvkg(acc, &ctx->ghash_key, src, n);
+		src += n;
+		len -= n;
+	}
+
+	if (len) {
+		memcpy(buf, src, len);
+		*buflen = len;
+	}
+}
+
+static void riscv64_aes_gcm_auth_assoc(struct aead_request *req,
+				       const struct riscv64_aes_gcm_ctx *ctx,
+				       be128 *acc, unsigned int assoclen)
+{
+	u8 buf[GHASH_BLOCK_SIZE] __aligned(4);
+	struct scatter_walk walk;
+	unsigned int buflen = 0;
+
+	scatterwalk_start(&walk, req->src);
+	while (assoclen) {
+		unsigned int n = scatterwalk_clamp(&walk, assoclen);
+		u8 *p;
+
+		if (!n) {
+			scatterwalk_start(&walk, sg_next(walk.sg));
+			n = scatterwalk_clamp(&walk, assoclen);
+		}
+
+		p = scatterwalk_map(&walk);
+		kernel_vector_begin();
+		riscv64_aes_gcm_ghash_assoc(ctx, acc, buf, &buflen, p, n);
+		kernel_vector_end();
+		scatterwalk_unmap(p);
+
+		assoclen -= n;
+		scatterwalk_advance(&walk, n);
+		scatterwalk_done(&walk, 0, assoclen);
+	}
+
+	if (buflen) {
+		memset(buf + buflen, 0, GHASH_BLOCK_SIZE - buflen);
+		kernel_vector_begin();
+		aes_gcm_ghash_zvkg(acc, &ctx->ghash_key, buf, GHASH_BLOCK_SIZE);
+		kernel_vector_end();
+	}
+}
+
+/*
+ * Unlike the gcm template on top of ctr(aes) and ghash, which walks the data
+ * once for each, the assembly produces the keystream and hashes the
+ * ciphertext in the same pass, so each step of the walk is a single vector
+ * section.  @assoclen is the length of the associated data that is hashed,
+ * which for rfc4106 excludes the IV at its end.
+ */
+static int riscv64_aes_gcm_crypt(struct aead_request *req, const u8 *iv,
+				 unsigned int assoclen, bool enc)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	const struct riscv64_aes_gcm_ctx *ctx = crypto_aead_ctx(tfm);
+	unsigned int authsize = crypto_aead_authsize(tfm);
+	unsigned int cryptlen = req->cryptlen - (enc ? 0 : authsize);
+	u8 ctr[AES_BLOCK_SIZE] __aligned(4);
+	u8 tag[AES_BLOCK_SIZE] __aligned(4);
+	u8 otag[AES_BLOCK_SIZE];
+	struct skcipher_walk walk;
+	be128 acc = {}, lengths;
+	unsigned int nbytes;
+	int err;
+
+	if (assoclen)
+		riscv64_aes_gcm_auth_assoc(req, ctx, &acc, assoclen);
+
+	/* The data starts at counter 2, counter 1 encrypts the tag. */
+	memcpy(ctr, iv, GCM_AES_IV_SIZE);
+	put_unaligned_be32(2, ctr + GCM_AES_IV_SIZE);
+
+	if (enc)
+		err = skcipher_walk_aead_encrypt(&walk, req, false);
+	else
+		err = skcipher_walk_aead_decrypt(&walk, req, false);
+
+	while ((nbytes = walk.nbytes) != 0) {
+		/* Only the end of the message may have a partial block. */
+		if (nbytes < walk.total)
+			nbytes = round_down(nbytes, AES_BLOCK_SIZE);
+
+		kernel_vector_begin();
+		if (enc)
+			aes_gcm_encrypt_zvkned_zvkb_zvkg(
+				&ctx->aes, &ctx->ghash_key, &acc,
+				walk.src.virt.addr, walk.dst.virt.addr,
+				nbytes, ctr);
+		else
+			aes_gcm_decrypt_zvkned_zvkb_zvkg(
+				&ctx->aes, &ctx->ghash_key, &acc,
+				walk.src.virt.addr, walk.dst.virt.addr,
+				nbytes, ctr);
+		kernel_vector_end();
+
+		err = skcipher_walk_done(&walk, walk.nbytes - nbytes);
+	}
+	if (err)
+		return err;
+
+	lengths.a = cpu_to_be64((u64)assoclen * 8);
+	lengths.b = cpu_to_be64((u64)cryptlen * 8);
+	put_unaligned_be32(1, ctr + GCM_AES_IV_SIZE);
+
+	kernel_vector_begin();
+	aes_gcm_ghash_zvkg(&acc, &ctx->ghash_key, (const u8 *)&lengths,
+			   GHASH_BLOCK_SIZE);
+	aes_encrypt_zvkned(&ctx->aes, ctr, tag);
+	kernel_vector_end();
+
+	crypto_xor(tag, (const u8 *)&acc, AES_BLOCK_SIZE);
+
+	if (enc) {
+		scatterwalk_map_and_copy(tag, req->dst,
+					 req->assoclen + req->cryptlen,
+					 authsize, 1);
+		return 0;
+	}
+
+	scatterwalk_map_and_copy(otag, req->src, req->assoclen + cryptlen,
+				 authsize, 0);
+
+	return crypto_memneq(tag, otag, authsize) ? -EBADMSG : 0;
+}
+
+static int riscv64_aes_gcm_encrypt(struct aead_request *req)
+{
+	return riscv64_aes_gcm_crypt(req, req->iv, req->assoclen, true);
+}
+
+static int riscv64_aes_gcm_decrypt(struct aead_request *req)
+{
+	return riscv64_aes_gcm_crypt(req, req->iv, req->assoclen, false);
+}
+
+static int riscv64_rfc4106_crypt(struct aead_request *req, bool enc)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	const struct riscv64_aes_gcm_ctx *ctx = crypto_aead_ctx(tfm);
+	u8 iv[GCM_AES_IV_SIZE];
+	int err;
+
+	err = crypto_ipsec_check_assoclen(req->assoclen);
+	if (err)
+		return err;
+
+	memcpy(iv, ctx->nonce, sizeof(ctx->nonce));
+	memcpy(iv + sizeof(ctx->nonce), req->iv, GCM_RFC4106_IV_SIZE);
+
+	return riscv64_aes_gcm_crypt(req, iv,
+				     req->assoclen - GCM_RFC4106_IV_SIZE, enc);
+}
+
+static int riscv64_rfc4106_encrypt(struct aead_request *req)
+{
+	return riscv64_rfc4106_crypt(req, true);
+}
+
+static int riscv64_rfc4106_decrypt(struct aead_request *req)
+{
+	return riscv64_rfc4106_crypt(req, false);
+}
+
 /* Algorithm definitions */
 
 static struct crypto_alg riscv64_zvkned_aes_cipher_alg = {
@@ -561,6 +841,43 @@ static struct skcipher_alg riscv64_zvkned_zvbb_zvkg_aes_skcipher_alg = {
 	},
 };
 
+static struct aead_alg riscv64_zvkned_zvkb_zvkg_aes_aead_algs[] = {
+	{
+		.setkey = riscv64_aes_gcm_setkey,
+		.setauthsize = riscv64_aes_gcm_setauthsize,
+		.encrypt = riscv64_aes_gcm_encrypt,
+		.decrypt = riscv64_aes_gcm_decrypt,
+		.ivsize = GCM_AES_IV_SIZE,
+		.maxauthsize = AES_BLOCK_SIZE,
+		.chunksize = AES_BLOCK_SIZE,
+		.base = {
+			.cra_blocksize = 1,
+			.cra_ctxsize = sizeof(struct riscv64_aes_gcm_ctx),
+			/* Above the gcm template instantiated on our ctr(aes) */
+			.cra_priority = 400,
+			.cra_name = "gcm(aes)",
+			.cra_driver_name = "gcm-aes-riscv64-zvkned-zvkb-zvkg",
+			.cra_module = THIS_MODULE,
+		},
+	}, {
+		.setkey = riscv64_rfc4106_setkey,
+		.setauthsize = riscv64_rfc4106_setauthsize,
+		.encrypt = riscv64_rfc4106_encrypt,
+		.decrypt = riscv64_rfc4106_decrypt,
+		.ivsize = GCM_RFC4106_IV_SIZE,
+		.maxauthsize = AES_BLOCK_SIZE,
+		.chunksize = AES_BLOCK_SIZE,
+		.base = {
+			.cra_blocksize = 1,
+			.cra_ctxsize = sizeof(struct riscv64_aes_gcm_ctx),
+			.cra_priority = 400,
+			.cra_name = "rfc4106(gcm(aes))",
+			.cra_driver_name = "rfc4106-gcm-aes-riscv64-zvkned-zvkb-zvkg",
+			.cra_module = THIS_MODULE,
+		},
+	}
+};
+
 static inline bool riscv64_aes_xts_supported(void)
 {
 	return riscv_isa_extension_available(NULL, ZVBB) &&
@@ -568,6 +885,12 @@ static inline bool riscv64_aes_xts_supported(void)
 	       riscv_vector_vlen() < 2048 /* Implementation limitation */;
 }
 
+static inline bool riscv64_aes_gcm_supported(void)
+{
+	return riscv_isa_extension_available(NULL, ZVKB) &&
+	       riscv_isa_extension_available(NULL, ZVKG);
+}
+
 static int __init riscv64_aes_mod_init(void)
 {
 	int err = -ENODEV;
@@ -597,10 +920,21 @@ static int __init riscv64_aes_mod_init(void)
 			if (err)
 				goto unregister_zvkned_zvkb_skcipher_alg;
 		}
+
+		if (riscv64_aes_gcm_supported()) {
+			err = crypto_register_aeads(
+				riscv64_zvkned_zvkb_zvkg_aes_aead_algs,
+				ARRAY_SIZE(riscv64_zvkned_zvkb_zvkg_aes_aead_algs));
+			if (err)
+				goto unregister_zvkned_zvbb_zvkg_skcipher_alg;
+		}
 	}
 
 	return err;
 
+unregister_zvkned_zvbb_zvkg_skcipher_alg:
+	if (riscv64_aes_xts_supported())
+		crypto_unregister_skcipher(&riscv64_zvkned_zvbb_zvkg_aes_skcipher_alg);
 unregister_zvkned_zvkb_skcipher_alg:
 	if (riscv_isa_extension_available(NULL, ZVKB))
 		crypto_unregister_skcipher(&riscv64_zvkned_zvkb_aes_skcipher_alg);
@@ -614,6 +948,9 @@ static int __init riscv64_aes_mod_init(void)
 
 static void __exit riscv64_aes_mod_exit(void)
 {
+	if (riscv64_aes_gcm_supported())
+		crypto_unregister_aeads(riscv64_zvkned_zvkb_zvkg_aes_aead_algs,
+					ARRAY_SIZE(riscv64_zvkned_zvkb_zvkg_aes_aead_algs));
 	if (riscv64_aes_xts_supported())
 		crypto_unregister_skcipher(&riscv64_zvkned_zvbb_zvkg_aes_skcipher_alg);
 	if (riscv_isa_extension_available(NULL, ZVKB))
@@ -626,7 +963,7 @@ static void __exit riscv64_aes_mod_exit(void)
 module_init(riscv64_aes_mod_init);
 module_exit(riscv64_aes_mod_exit);
 
-MODULE_DESCRIPTION("AES-ECB/CBC/CTS/CTR/XTS (RISC-V accelerated)");
+MODULE_DESCRIPTION("AES-ECB/CBC/CTS/CTR/XTS/GCM (RISC-V accelerated)");
 MODULE_AUTHOR("Jerry Shih <jerry.shih@sifive.com>");
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_CRYPTO("aes");
@@ -635,3 +972,5 @@ MODULE_ALIAS_CRYPTO("cbc(aes)");
 MODULE_ALIAS_CRYPTO("cts(cbc(aes))");
 MODULE_ALIAS_CRYPTO("ctr(aes)");
 MODULE_ALIAS_CRYPTO("xts(aes)");
+MODULE_ALIAS_CRYPTO("gcm(aes)");
+MODULE_ALIAS_CRYPTO("rfc4106(gcm(aes))");
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0-only
 /*
- * ChaCha20 using the RISC-V vector crypto extensions
+ * ChaCha20 using the RISC-V vector extension, and the vector crypto extensions
+ * where available
  *
  * Copyright (C) 2023 SiFive, Inc.
  * Author: Jerry Shih <jerry.shih@sifive.com>
@@ -9,22 +10,99 @@
 #include <asm/simd.h>
 #include <asm/vector.h>
 #include <crypto/internal/chacha.h>
+#include <crypto/internal/simd.h>
 #include <crypto/internal/skcipher.h>
+#include <linux/jump_label.h>
 #include <linux/linkage.h>
 #include <linux/module.h>
+#include <linux/sizes.h>
 
 asmlinkage void chacha20_zvkb(const u32 key[8], const u8 *in, u8 *out,
 			      size_t len, const u32 iv[4]);
+asmlinkage void chacha20_v(const u32 key[8], const u8 *in, u8 *out,
+			   size_t len, const u32 iv[4]);
+
+static __ro_after_init DEFINE_STATIC_KEY_FALSE(have_v);
+static __ro_after_init DEFINE_STATIC_KEY_FALSE(have_zvkb);
+
+/* |len| must be nonzero and a multiple of CHACHA_BLOCK_SIZE. */
+static void riscv64_chacha20_blocks(const u32 key[8], const u8 *in, u8 *out,
+				    size_t len, const u32 iv[4])
+{
+	if (static_branch_likely(&have_zvkb))
+		chacha20_zvkb(key, in, out, len, iv);
+	else
+		chacha20_v(key, in, out, len, iv);
+}
+
+/* Encrypts any length, advancing the counter in iv[0]. */
+static void riscv64_chacha20_crypt_bytes(const u32 key[8], const u8 *in,
+					 u8 *out, unsigned int len, u32 iv[4])
+{
+	unsigned int nbytes = len & ~(CHACHA_BLOCK_SIZE - 1);
+	unsigned int tail_bytes = len & (CHACHA_BLOCK_SIZE - 1);
+	u8 block_buffer[CHACHA_BLOCK_SIZE];
+
+	if (nbytes) {
+		riscv64_chacha20_blocks(key, in, out, nbytes, iv);
+		iv[0] += nbytes / CHACHA_BLOCK_SIZE;
+	}
+	if (tail_bytes) {
+		memcpy(block_buffer, in + nbytes, tail_bytes);
+		riscv64_chacha20_blocks(key, block_buffer, block_buffer,
+					CHACHA_BLOCK_SIZE, iv);
+		memcpy(out + nbytes, block_buffer, tail_bytes);
+		iv[0]++;
+	}
+}
+
+void hchacha_block_arch(const u32 *state, u32 *stream, int nrounds)
+{
+	hchacha_block_generic(state, stream, nrounds);
+}
+EXPORT_SYMBOL(hchacha_block_arch);
+
+void chacha_init_arch(u32 *state, const u32 *key, const u8 *iv)
+{
+	chacha_init_generic(state, key, iv);
+}
+EXPORT_SYMBOL(chacha_init_arch);
+
+/*
+ * This is what chacha20poly1305 and WireGuard end up in.  The state is laid
+ * out as constants, key, then the counter and nonce words the assembly takes
+ * as its iv.  Only ChaCha20 is vectorized, XChaCha12 users get the generic
+ * code.
+ */
+void chacha_crypt_arch(u32 *state, u8 *dst, const u8 *src, unsigned int bytes,
+		       int nrounds)
+{
+	if (!static_branch_likely(&have_v) || nrounds != 20 ||
+	    bytes <= CHACHA_BLOCK_SIZE || !crypto_simd_usable())
+		return chacha_crypt_generic(state, dst, src, bytes, nrounds);
+
+	do {
+		unsigned int todo = min_t(unsigned int, bytes, SZ_4K);
+
+		kernel_vector_begin();
+		riscv64_chacha20_crypt_bytes(&state[4], src, dst, todo,
+					     &state[12]);
+		kernel_vector_end();
+
+		bytes -= todo;
+		src += todo;
+		dst += todo;
+	} while (bytes);
+}
+EXPORT_SYMBOL(chacha_crypt_arch);
 
 static int riscv64_chacha20_crypt(struct skcipher_request *req)
 {
 	u32 iv[CHACHA_IV_SIZE / sizeof(u32)];
-	u8 block_buffer[CHACHA_BLOCK_SIZE];
 	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(req);
 	const struct chacha_ctx *ctx = crypto_skcipher_ctx(tfm);
 	struct skcipher_walk walk;
 	unsigned int nbytes;
-	unsigned int tail_bytes;
 	int err;
 
 	iv[0] = get_unaligned_le32(req->iv);
@@ -34,62 +112,84 @@ static int riscv64_chacha20_crypt(struct skcipher_request *req)
 
 	err = skcipher_walk_virt(&walk, req, false);
 	while (walk.nbytes) {
-		nbytes = walk.nbytes & ~(CHACHA_BLOCK_SIZE - 1);
-		tail_bytes = walk.nbytes & (CHACHA_BLOCK_SIZE - 1);
+		nbytes = walk.nbytes;
+		if (nbytes < walk.total)
+			nbytes &= ~(CHACHA_BLOCK_SIZE - 1);
 		kernel_vector_begin();
-		if (nbytes) {
-			chacha20_zvkb(ctx->key, walk.src.virt.addr,
-				      walk.dst.virt.addr, nbytes, iv);
-			iv[0] += nbytes / CHACHA_BLOCK_SIZE;
-		}
-		if (walk.nbytes == walk.total && tail_bytes > 0) {
-			memcpy(block_buffer, walk.src.virt.addr + nbytes,
-			       tail_bytes);
-			chacha20_zvkb(ctx->key, block_buffer, block_buffer,
-				      CHACHA_BLOCK_SIZE, iv);
-			memcpy(walk.dst.virt.addr + nbytes, block_buffer,
-			       tail_bytes);
-			tail_bytes = 0;
-		}
+		if (nbytes)
+			riscv64_chacha20_crypt_bytes(ctx->key,
+						      walk.src.virt.addr,
+						      walk.dst.virt.addr,
+						      nbytes, iv);
 		kernel_vector_end();
 
-		err = skcipher_walk_done(&walk, tail_bytes);
+		err = skcipher_walk_done(&walk, walk.nbytes - nbytes);
 	}
 
 	return err;
 }
 
-static struct skcipher_alg riscv64_chacha_alg = {
-	.setkey = chacha20_setkey,
-	.encrypt = riscv64_chacha20_crypt,
-	.decrypt = riscv64_chacha20_crypt,
-	.min_keysize = CHACHA_KEY_SIZE,
-	.max_keysize = CHACHA_KEY_SIZE,
-	.ivsize = CHACHA_IV_SIZE,
-	.chunksize = CHACHA_BLOCK_SIZE,
-	.walksize = 4 * CHACHA_BLOCK_SIZE,
-	.base = {
-		.cra_blocksize = 1,
-		.cra_ctxsize = sizeof(struct chacha_ctx),
-		.cra_priority = 300,
-		.cra_name = "chacha20",
-		.cra_driver_name = "chacha20-riscv64-zvkb",
-		.cra_module = THIS_MODULE,
-	},
+static struct skcipher_alg riscv64_chacha_algs[] = {
+	{
+		.setkey = chacha20_setkey,
+		.encrypt = riscv64_chacha20_crypt,
+		.decrypt = riscv64_chacha20_crypt,
+		.min_keysize = CHACHA_KEY_SIZE,
+		.max_keysize = CHACHA_KEY_SIZE,
+		.ivsize = CHACHA_IV_SIZE,
+		.chunksize = CHACHA_BLOCK_SIZE,
+		.walksize = 4 * CHACHA_BLOCK_SIZE,
+		.base = {
+			.cra_blocksize = 1,
+			.cra_ctxsize = sizeof(struct chacha_ctx),
+			.cra_priority = 200,
+			.cra_name = "chacha20",
+			.cra_driver_name = "chacha20-riscv64-v",
+			.cra_module = THIS_MODULE,
+		},
+	}, {
+		.setkey = chacha20_setkey,
+		.encrypt = riscv64_chacha20_crypt,
+		.decrypt = riscv64_chacha20_crypt,
+		.min_keysize = CHACHA_KEY_SIZE,
+		.max_keysize = CHACHA_KEY_SIZE,
+		.ivsize = CHACHA_IV_SIZE,
+		.chunksize = CHACHA_BLOCK_SIZE,
+		.walksize = 4 * CHACHA_BLOCK_SIZE,
+		.base = {
+			.cra_blocksize = 1,
+			.cra_ctxsize = sizeof(struct chacha_ctx),
+			.cra_priority = 300,
+			.cra_name = "chacha20",
+			.cra_driver_name = "chacha20-riscv64-zvkb",
+			.cra_module = THIS_MODULE,
+		},
+	}
 };
 
+static struct skcipher_alg *riscv64_chacha_alg(void)
+{
+	return &riscv64_chacha_algs[static_branch_likely(&have_zvkb)];
+}
+
 static int __init riscv64_chacha_mod_init(void)
 {
-	if (riscv_isa_extension_available(NULL, ZVKB) &&
-	    riscv_vector_vlen() >= 128)
-		return crypto_register_skcipher(&riscv64_chacha_alg);
+	/* chacha_crypt_arch() falls back to the generic code without V */
+	if (!riscv_isa_extension_available(NULL, v) ||
+	    riscv_vector_vlen() < 128)
+		return 0;
+
+	static_branch_enable(&have_v);
+	if (riscv_isa_extension_available(NULL, ZVKB))
+		static_branch_enable(&have_zvkb);
 
-	return -ENODEV;
+	return crypto_register_skcipher(riscv64_chacha_alg());
 }
 
 static void __exit riscv64_chacha_mod_exit(void)
 {
-	crypto_unregister_skcipher(&riscv64_chacha_alg);
+	if (static_branch_likely(&have_v))
+		crypto_unregister_skcipher(riscv64_chacha_alg());
 }
 
 module_init(riscv64_chacha_mod_init);
@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * CRC-T10DIF using the RISC-V Zbc carry-less multiply extension
+ *
+ * The 16-bit CRC is computed as a 32-bit MSB-first CRC over the polynomial
+ * shifted up by 16 bits, which lets it share the Barrett reduction used
+ * for crc32_be().
+ */
+
+#include <asm/cpufeature.h>
+#include <asm/crc-zbc.h>
+#include <asm/hwcap.h>
+#include <crypto/internal/hash.h>
+#include <linux/crc-t10dif.h>
+#include <linux/module.h>
+
+#define CRCT10DIF_POLY		0x8bb7U
+/* floor(x^96 / (P(x) * x^16)) with the x^64 term dropped */
+#define CRCT10DIF_POLY_QT_BE	0xf65a57f81d33a48aULL
+
+static u16 crct10dif_zbc(u16 crc, const u8 *data, size_t len)
+{
+	u32 crc32 = (u32)crc << 16;
+
+	crc32 = crc32_be_generic_zbc(crc32, data, len, CRCT10DIF_POLY << 16,
+				     CRCT10DIF_POLY_QT_BE);
+
+	return crc32 >> 16;
+}
+
+static int riscv64_crct10dif_init(struct shash_desc *desc)
+{
+	u16 *crc = shash_desc_ctx(desc);
+
+	*crc = 0;
+	return 0;
+}
+
+static int riscv64_crct10dif_update(struct shash_desc *desc, const u8 *data,
+				    unsigned int length)
+{
+	u16 *crc = shash_desc_ctx(desc);
+
+	*crc = crct10dif_zbc(*crc, data, length);
+	return 0;
+}
+
+static int riscv64_crct10dif_final(struct shash_desc *desc, u8 *out)
+{
+	u16 *crc = shash_desc_ctx(desc);
+
+	*(u16 *)out = *crc;
+	return 0;
+}
+
+static int riscv64_crct10dif_finup(struct shash_desc *desc, const u8 *data,
+				   unsigned int length, u8 *out)
+{
+	u16 *crc = shash_desc_ctx(desc);
+
+	*(u16 *)out = crct10dif_zbc(*crc, data, length);
+	return 0;
+}
+
+static int riscv64_crct10dif_digest(struct shash_desc *desc, const u8 *data,
+				    unsigned int length, u8 *out)
+{
+	*(u16 *)out = crct10dif_zbc(0, data, length);
+	return 0;
+}
+
+static struct shash_alg riscv64_crct10dif_alg = {
+	.digestsize = CRC_T10DIF_DIGEST_SIZE,
+	.init = riscv64_crct10dif_init,
+	.update = riscv64_crct10dif_update,
+	.final = riscv64_crct10dif_final,
+	.finup = riscv64_crct10dif_finup,
+	.digest = riscv64_crct10dif_digest,
+	.descsize = sizeof(u16),
+	.base = {
+		.cra_name = "crct10dif",
+		.cra_driver_name = "crct10dif-riscv64-zbc",
+		.cra_priority = 150,
+		.cra_blocksize = CRC_T10DIF_BLOCK_SIZE,
+		.cra_module = THIS_MODULE,
+	},
+};
+
+static int __init riscv64_crct10dif_mod_init(void)
+{
+	if (riscv_isa_extension_available(NULL, ZBC))
+		return crypto_register_shash(&riscv64_crct10dif_alg);
+
+	return -ENODEV;
+}
+
+static void __exit riscv64_crct10dif_mod_exit(void)
+{
+	crypto_unregister_shash(&riscv64_crct10dif_alg);
+}
+
+module_init(riscv64_crct10dif_mod_init);
+module_exit(riscv64_crct10dif_mod_exit);
+
+MODULE_DESCRIPTION("CRC-T10DIF (RISC-V Zbc accelerated)");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS_CRYPTO("crct10dif");
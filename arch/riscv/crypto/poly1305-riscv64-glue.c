@@ -0,0 +1,345 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Poly1305 using the RISC-V vector extension
+ *
+ * The scalar parts, the key setup, and short inputs use the generic 64-bit
+ * implementation, whose state is kept in base 2^44.  Long inputs are converted
+ * to base 2^26 and hashed several blocks at a time with the vector unit.
+ */
+
+#include <asm/simd.h>
+#include <asm/unaligned.h>
+#include <asm/vector.h>
+#include <crypto/algapi.h>
+#include <crypto/internal/hash.h>
+#include <crypto/internal/poly1305.h>
+#include <crypto/internal/simd.h>
+#include <linux/jump_label.h>
+#include <linux/linkage.h>
+#include <linux/module.h>
+#include <linux/sizes.h>
+
+#define POLY1305_V_MAX_LANES	8
+/* Below this many bytes, the generic code is faster than setting up powers */
+#define POLY1305_V_MIN_BYTES	256
+
+#define MASK26	GENMASK_ULL(25, 0)
+#define MASK42	GENMASK_ULL(41, 0)
+#define MASK44	GENMASK_ULL(43, 0)
+
+struct poly1305_v_powers {
+	/* r[i][k] is limb i of r^(lanes - k), in base 2^26 */
+	u64 r[5][POLY1305_V_MAX_LANES];
+};
+
+asmlinkage void poly1305_blocks_v(u64 h[5],
+				  const struct poly1305_v_powers *powers,
+				  const u8 *src, size_t nblocks, size_t lanes);
+
+static __ro_after_init DEFINE_STATIC_KEY_FALSE(have_v);
+static unsigned int poly1305_v_lanes __ro_after_init;
+
+/* Splits a base 2^44 value, whose middle limb may have one extra bit. */
+static void poly1305_v_from_base44(u64 out[5], const u64 in[3])
+{
+	out[0] = in[0] & MASK26;
+	out[1] = (in[0] >> 26) + ((in[1] << 18) & MASK26);
+	out[2] = (in[1] >> 8) & MASK26;
+	out[3] = (in[1] >> 34) + ((in[2] << 10) & MASK26);
+	out[4] = in[2] >> 16;
+}
+
+static void poly1305_v_carry(u64 h[5])
+{
+	u64 c;
+
+	c = h[0] >> 26;
+	h[0] &= MASK26;
+	h[1] += c;
+	c = h[1] >> 26;
+	h[1] &= MASK26;
+	h[2] += c;
+	c = h[2] >> 26;
+	h[2] &= MASK26;
+	h[3] += c;
+	c = h[3] >> 26;
+	h[3] &= MASK26;
+	h[4] += c;
+	c = h[4] >> 26;
+	h[4] &= MASK26;
+	h[0] += c * 5;
+	c = h[0] >> 26;
+	h[0] &= MASK26;
+	h[1] += c;
+}
+
+static void poly1305_v_to_base44(u64 out[3], u64 in[5])
+{
+	u64 t, c;
+
+	poly1305_v_carry(in);
+
+	t = in[0] + (in[1] << 26);
+	out[0] = t & MASK44;
+	c = t >> 44;
+	t = c + (in[2] << 8) + (in[3] << 34);
+	out[1] = t & MASK44;
+	c = t >> 44;
+	t = c + (in[4] << 16);
+	out[2] = t & MASK42;
+	out[0] += (t >> 42) * 5;
+	out[1] += out[0] >> 44;
+	out[0] &= MASK44;
+}
+
+/* h = h * r mod 2^130 - 5, both in base 2^26 */
+static void poly1305_v_mul(u64 h[5], const u64 r[5])
+{
+	u64 s1 = r[1] * 5, s2 = r[2] * 5, s3 = r[3] * 5, s4 = r[4] * 5;
+	u64 d[5];
+
+	d[0] = h[0] * r[0] + h[1] * s4 + h[2] * s3 + h[3] * s2 + h[4] * s1;
+	d[1] = h[0] * r[1] + h[1] * r[0] + h[2] * s4 + h[3] * s3 + h[4] * s2;
+	d[2] = h[0] * r[2] + h[1] * r[1] + h[2] * r[0] + h[3] * s4 + h[4] * s3;
+	d[3] = h[0] * r[3] + h[1] * r[2] + h[2] * r[1] + h[3] * r[0] + h[4] * s4;
+	d[4] = h[0] * r[4] + h[1] * r[3] + h[2] * r[2] + h[3] * r[1] + h[4] * r[0];
+
+	poly1305_v_carry(d);
+	memcpy(h, d, sizeof(d));
+}
+
+static void poly1305_v_setup_powers(struct poly1305_v_powers *powers,
+				    const struct poly1305_core_key *key,
+				    unsigned int lanes)
+{
+	u64 r[5], p[5];
+	unsigned int i, k;
+
+	poly1305_v_from_base44(r, key->key.r64);
+	memcpy(p, r, sizeof(p));
+
+	for (k = lanes; k-- > 0;) {
+		for (i = 0; i < 5; i++)
+			powers->r[i][k] = p[i];
+		if (k)
+			poly1305_v_mul(p, r);
+	}
+}
+
+static void poly1305_riscv64_blocks(struct poly1305_desc_ctx *dctx,
+				    const u8 *src, unsigned int nblocks)
+{
+	unsigned int lanes = poly1305_v_lanes, vblocks;
+	struct poly1305_v_powers powers;
+	u64 h[5];
+
+	vblocks = round_down(nblocks, lanes);
+	if (!static_branch_likely(&have_v) ||
+	    nblocks * POLY1305_BLOCK_SIZE < POLY1305_V_MIN_BYTES ||
+	    !crypto_simd_usable())
+		vblocks = 0;
+
+	if (vblocks) {
+		poly1305_v_setup_powers(&powers, &dctx->core_r, lanes);
+		poly1305_v_from_base44(h, dctx->h.h64);
+
+		do {
+			/* SZ_4K worth of blocks is a multiple of any lanes */
+			unsigned int todo = min_t(unsigned int, vblocks,
+						  SZ_4K / POLY1305_BLOCK_SIZE);
+
+			kernel_vector_begin();
+			poly1305_blocks_v(h, &powers, src, todo, lanes);
+			kernel_vector_end();
+			poly1305_v_carry(h);
+
+			src += todo * POLY1305_BLOCK_SIZE;
+			nblocks -= todo;
+			vblocks -= todo;
+		} while (vblocks);
+
+		poly1305_v_to_base44(dctx->h.h64, h);
+		memzero_explicit(&powers, sizeof(powers));
+	}
+
+	if (nblocks)
+		poly1305_core_blocks(&dctx->h, &dctx->core_r, src, nblocks, 1);
+}
+
+void poly1305_init_arch(struct poly1305_desc_ctx *dctx,
+			const u8 key[POLY1305_KEY_SIZE])
+{
+	poly1305_init_generic(dctx, key);
+}
+EXPORT_SYMBOL(poly1305_init_arch);
+
+void poly1305_update_arch(struct poly1305_desc_ctx *dctx, const u8 *src,
+			  unsigned int nbytes)
+{
+	if (unlikely(dctx->buflen)) {
+		unsigned int bytes = min(nbytes, POLY1305_BLOCK_SIZE - dctx->buflen);
+
+		memcpy(dctx->buf + dctx->buflen, src, bytes);
+		src += bytes;
+		nbytes -= bytes;
+		dctx->buflen += bytes;
+
+		if (dctx->buflen == POLY1305_BLOCK_SIZE) {
+			poly1305_core_blocks(&dctx->h, &dctx->core_r,
+					     dctx->buf, 1, 1);
+			dctx->buflen = 0;
+		}
+	}
+
+	if (likely(nbytes >= POLY1305_BLOCK_SIZE)) {
+		poly1305_riscv64_blocks(dctx, src,
+					nbytes / POLY1305_BLOCK_SIZE);
+		src += round_down(nbytes, POLY1305_BLOCK_SIZE);
+		nbytes %= POLY1305_BLOCK_SIZE;
+	}
+
+	if (unlikely(nbytes)) {
+		dctx->buflen = nbytes;
+		memcpy(dctx->buf, src, nbytes);
+	}
+}
+EXPORT_SYMBOL(poly1305_update_arch);
+
+void poly1305_final_arch(struct poly1305_desc_ctx *dctx, u8 *dst)
+{
+	poly1305_final_generic(dctx, dst);
+}
+EXPORT_SYMBOL(poly1305_final_arch);
+
+static int riscv64_poly1305_init(struct shash_desc *desc)
+{
+	struct poly1305_desc_ctx *dctx = shash_desc_ctx(desc);
+
+	poly1305_core_init(&dctx->h);
+	dctx->buflen = 0;
+	dctx->rset = 0;
+	dctx->sset = false;
+
+	return 0;
+}
+
+/* The one-time key is the first 32 bytes of the message for the shash. */
+static unsigned int riscv64_poly1305_setdesckey(struct poly1305_desc_ctx *dctx,
+						const u8 *src,
+						unsigned int srclen)
+{
+	if (!dctx->rset && srclen >= POLY1305_BLOCK_SIZE) {
+		poly1305_core_setkey(&dctx->core_r, src);
+		srclen -= POLY1305_BLOCK_SIZE;
+		dctx->rset = 1;
+		src += POLY1305_BLOCK_SIZE;
+	}
+	if (dctx->rset && srclen >= POLY1305_BLOCK_SIZE) {
+		dctx->s[0] = get_unaligned_le32(src +  0);
+		dctx->s[1] = get_unaligned_le32(src +  4);
+		dctx->s[2] = get_unaligned_le32(src +  8);
+		dctx->s[3] = get_unaligned_le32(src + 12);
+		srclen -= POLY1305_BLOCK_SIZE;
+		dctx->sset = true;
+	}
+
+	return srclen;
+}
+
+static int riscv64_poly1305_update(struct shash_desc *desc,
+				   const u8 *src, unsigned int srclen)
+{
+	struct poly1305_desc_ctx *dctx = shash_desc_ctx(desc);
+	unsigned int bytes;
+
+	if (unlikely(dctx->buflen)) {
+		bytes = min(srclen, POLY1305_BLOCK_SIZE - dctx->buflen);
+		memcpy(dctx->buf + dctx->buflen, src, bytes);
+		src += bytes;
+		srclen -= bytes;
+		dctx->buflen += bytes;
+
+		if (dctx->buflen == POLY1305_BLOCK_SIZE) {
+			if (likely(dctx->sset))
+				poly1305_core_blocks(&dctx->h, &dctx->core_r,
+						     dctx->buf, 1, 1);
+			else
+				riscv64_poly1305_setdesckey(dctx, dctx->buf,
+							    POLY1305_BLOCK_SIZE);
+			dctx->buflen = 0;
+		}
+	}
+
+	if (!dctx->sset) {
+		bytes = srclen - riscv64_poly1305_setdesckey(dctx, src, srclen);
+		src += bytes;
+		srclen -= bytes;
+	}
+
+	if (likely(srclen >= POLY1305_BLOCK_SIZE)) {
+		poly1305_riscv64_blocks(dctx, src,
+					srclen / POLY1305_BLOCK_SIZE);
+		src += round_down(srclen, POLY1305_BLOCK_SIZE);
+		srclen %= POLY1305_BLOCK_SIZE;
+	}
+
+	if (unlikely(srclen)) {
+		dctx->buflen = srclen;
+		memcpy(dctx->buf, src, srclen);
+	}
+
+	return 0;
+}
+
+static int riscv64_poly1305_final(struct shash_desc *desc, u8 *dst)
+{
+	struct poly1305_desc_ctx *dctx = shash_desc_ctx(desc);
+
+	if (unlikely(!dctx->sset))
+		return -ENOKEY;
+
+	poly1305_final_arch(dctx, dst);
+	return 0;
+}
+
+static struct shash_alg riscv64_poly1305_alg = {
+	.init			= riscv64_poly1305_init,
+	.update			= riscv64_poly1305_update,
+	.final			= riscv64_poly1305_final,
+	.digestsize		= POLY1305_DIGEST_SIZE,
+	.descsize		= sizeof(struct poly1305_desc_ctx),
+
+	.base.cra_name		= "poly1305",
+	.base.cra_driver_name	= "poly1305-riscv64-v",
+	.base.cra_priority	= 200,
+	.base.cra_blocksize	= POLY1305_BLOCK_SIZE,
+	.base.cra_module	= THIS_MODULE,
+};
+
+static int __init riscv64_poly1305_mod_init(void)
+{
+	/* The poly1305_*_arch() library calls fall back to the generic code */
+	if (!riscv_isa_extension_available(NULL, v) ||
+	    riscv_vector_vlen() < 128)
+		return 0;
+
+	poly1305_v_lanes = min_t(unsigned int, riscv_vector_vlen() / 64,
+				 POLY1305_V_MAX_LANES);
+	static_branch_enable(&have_v);
+
+	return IS_REACHABLE(CONFIG_CRYPTO_HASH) ?
+		crypto_register_shash(&riscv64_poly1305_alg) : 0;
+}
+
+static void __exit riscv64_poly1305_mod_exit(void)
+{
+	if (IS_REACHABLE(CONFIG_CRYPTO_HASH) && static_branch_likely(&have_v))
+		crypto_unregister_shash(&riscv64_poly1305_alg);
+}
+
+module_init(riscv64_poly1305_mod_init);
+module_exit(riscv64_poly1305_mod_exit);
+
+MODULE_DESCRIPTION("Poly1305 (RISC-V accelerated)");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS_CRYPTO("poly1305");
@@ -56,17 +56,21 @@ static inline size_t __must_check arch_get_random_longs(unsigned long *v, size_t
 
 static inline size_t __must_check arch_get_random_seed_longs(unsigned long *v, size_t max_longs)
 {
-	if (!max_longs)
+	size_t i;
+
+	if (!riscv_has_extension_likely(RISCV_ISA_EXT_ZKR))
 		return 0;
 
 	/*
-	 * If Zkr is supported and csr_seed_long succeeds, we return one long
-	 * worth of entropy.
+	 * Return as many longs of entropy as the seed CSR provides in a row,
+	 * which saves the callers a round trip per long when filling a pool.
 	 */
-	if (riscv_has_extension_likely(RISCV_ISA_EXT_ZKR) && csr_seed_long(v))
-		return 1;
+	for (i = 0; i < max_longs; i++) {
+		if (!csr_seed_long(&v[i]))
+			break;
+	}
 
-	return 0;
+	return i;
 }
 
 #endif /* ASM_RISCV_ARCHRANDOM_H */
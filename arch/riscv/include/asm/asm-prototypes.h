@@ -13,6 +13,8 @@ long long __ashlti3(long long a, int b);
 
 #ifdef CONFIG_MMU
 asmlinkage int enter_vector_usercopy(void *dst, void *src, size_t n);
+int __asm_vector_usercopy(void *dst, void *src, size_t n);
+int fallback_scalar_usercopy(void *dst, void *src, size_t n);
 #endif /* CONFIG_MMU  */
 
 void xor_regs_2_(unsigned long bytes, unsigned long *__restrict p1,
@@ -29,6 +31,8 @@ void xor_regs_5_(unsigned long bytes, unsigned long *__restrict p1,
 		 const unsigned long *__restrict p3,
 		 const unsigned long *__restrict p4,
 		 const unsigned long *__restrict p5);
+void xor_regs_n_(unsigned long bytes, unsigned long *__restrict p1,
+		 unsigned int src_count, const unsigned long * const *srcs);
 
 #ifdef CONFIG_RISCV_ISA_V_PREEMPTIVE
 asmlinkage void riscv_v_context_nesting_start(struct pt_regs *regs);
@@ -63,19 +63,34 @@
  * copy_page - copy 1 page (4KB) of data from source to destination
  * @a0 - destination
  * @a1 - source
+ *
+ * Moves 8 registers per iteration so that the loads of an iteration are all
+ * in flight before the first store needs its data. Clobbers a2-a3 and t0-t6.
  */
 	.macro	copy_page a0, a1
 		lui	a2, 0x1
 		add	a2, a2, a0
 1 :
-		REG_L	t0, 0(a1)
-		REG_L	t1, SZREG(a1)
+		REG_L	t0, 0 * SZREG(a1)
+		REG_L	t1, 1 * SZREG(a1)
+		REG_L	t2, 2 * SZREG(a1)
+		REG_L	t3, 3 * SZREG(a1)
+		REG_L	t4, 4 * SZREG(a1)
+		REG_L	t5, 5 * SZREG(a1)
+		REG_L	t6, 6 * SZREG(a1)
+		REG_L	a3, 7 * SZREG(a1)
 
-		REG_S	t0, 0(a0)
-		REG_S	t1, SZREG(a0)
+		REG_S	t0, 0 * SZREG(a0)
+		REG_S	t1, 1 * SZREG(a0)
+		REG_S	t2, 2 * SZREG(a0)
+		REG_S	t3, 3 * SZREG(a0)
+		REG_S	t4, 4 * SZREG(a0)
+		REG_S	t5, 5 * SZREG(a0)
+		REG_S	t6, 6 * SZREG(a0)
+		REG_S	a3, 7 * SZREG(a0)
 
-		addi	a0, a0, 2 * SZREG
-		addi	a1, a1, 2 * SZREG
+		addi	a0, a0, 8 * SZREG
+		addi	a1, a1, 8 * SZREG
 		bne	a2, a0, 1b
 	.endm
 
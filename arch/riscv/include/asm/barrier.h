@@ -11,6 +11,7 @@
 #define _ASM_RISCV_BARRIER_H
 
 #ifndef __ASSEMBLY__
+#include <asm/cmpxchg.h>
 #include <asm/fence.h>
 
 #define nop()		__asm__ __volatile__ ("nop")
@@ -53,6 +54,18 @@ do {									\
 	___p1;								\
 })
 
+#define smp_cond_load_relaxed(ptr, cond_expr) ({			\
+	typeof(ptr) __PTR = (ptr);					\
+	__unqual_scalar_typeof(*ptr) VAL;				\
+	for (;;) {							\
+		VAL = READ_ONCE(*__PTR);				\
+		if (cond_expr)						\
+			break;						\
+		__cmpwait_relaxed(__PTR, VAL);				\
+	}								\
+	(typeof(*ptr))VAL;						\
+})
+
 #define smp_cond_load_acquire(ptr, cond_expr) ({			\
 	typeof(ptr) __PTR = (ptr);					\
 	__unqual_scalar_typeof(*ptr) VAL;				\
@@ -60,7 +73,7 @@ do {									\
 		VAL = __smp_load_acquire(__PTR);			\
 		if (cond_expr)						\
 			break;						\
-		cpu_relax();						\
+		__cmpwait_relaxed(__PTR, VAL);				\
 	}								\
 	(typeof(*ptr))VAL;						\
 })
@@ -51,10 +51,14 @@ static inline void flush_dcache_page(struct page *page)
 void flush_icache_all(void);
 void flush_icache_mm(struct mm_struct *mm, bool local);
 
+/* The user MM each hart last switched to, see flush_icache_deferred() */
+DECLARE_PER_CPU(struct mm_struct *, icache_running_mm);
+
 #endif /* CONFIG_SMP */
 
 extern unsigned int riscv_cbom_block_size;
 extern unsigned int riscv_cboz_block_size;
+extern unsigned int riscv_cbop_block_size;
 void riscv_init_cbo_blocksizes(void);
 
 #ifdef CONFIG_RISCV_DMA_NONCOHERENT
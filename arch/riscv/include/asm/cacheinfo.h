@@ -16,5 +16,6 @@ struct riscv_cacheinfo_ops {
 void riscv_set_cacheinfo_ops(struct riscv_cacheinfo_ops *ops);
 uintptr_t get_cache_size(u32 level, enum cache_type type);
 uintptr_t get_cache_geometry(u32 level, enum cache_type type);
+void riscv_update_cluster_siblings(unsigned int cpuid);
 
 #endif /* _ASM_RISCV_CACHEINFO_H */
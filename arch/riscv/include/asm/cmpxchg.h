@@ -6,9 +6,72 @@
 #ifndef _ASM_RISCV_CMPXCHG_H
 #define _ASM_RISCV_CMPXCHG_H
 
+#include <linux/bits.h>
 #include <linux/bug.h>
 
+#include <asm/alternative-macros.h>
 #include <asm/fence.h>
+#include <asm/hwcap.h>
+#include <asm/insn-def.h>
+
+/*
+ * There are no sub-word AMOs in the base A extension, so 8 and 16-bit
+ * xchg() is done with an LR/SC loop on the naturally aligned word that
+ * contains the value. This only makes forward progress under contention
+ * if the platform guarantees it for LR/SC (Ziccrse).
+ */
+#define __arch_xchg_masked(sc_sfx, prepend, append, r, p, n)		\
+({									\
+	u32 *__ptr32b = (u32 *)((ulong)(p) & ~0x3);			\
+	ulong __s = ((ulong)(p) & (0x4 - sizeof(*p))) * BITS_PER_BYTE;	\
+	ulong __mask = GENMASK(((sizeof(*p)) * BITS_PER_BYTE) - 1, 0)	\
+			<< __s;						\
+	ulong __newx = ((ulong)(n) << __s) & __mask;			\
+	ulong __retx;							\
+	ulong __rc;							\
+									\
+	__asm__ __volatile__ (						\
+	       prepend							\
+	       "0:	lr.w %0, %2\n"					\
+	       "	and  %1, %0, %z4\n"				\
+	       "	or   %1, %1, %z3\n"				\
+	       "	sc.w" sc_sfx " %1, %1, %2\n"			\
+	       "	bnez %1, 0b\n"					\
+	       append							\
+	       : "=&r" (__retx), "=&r" (__rc), "+A" (*(__ptr32b))	\
+	       : "rJ" (__newx), "rJ" (~__mask)				\
+	       : "memory");						\
+									\
+	r = (__typeof__(*(p)))((__retx & __mask) >> __s);		\
+})
+
+/*
+ * xchg_tail() in the queued spinlock slowpath uses a relaxed 16-bit
+ * xchg(), so that one is patched to a native Zabha AMO when available.
+ */
+#define __arch_xchg_masked_relaxed(r, p, n)				\
+({									\
+	__label__ __no_zabha, __done;					\
+									\
+	asm goto(ALTERNATIVE("j %l[__no_zabha]", "nop", 0,		\
+			     RISCV_ISA_EXT_ZABHA, 1)			\
+		 : : : : __no_zabha);					\
+	if (sizeof(*p) == 1)						\
+		__asm__ __volatile__ (AMOSWAP_B(%0, %1, %2)		\
+				      : "=&r" (r)			\
+				      : "r" (p), "r" (n)		\
+				      : "memory");			\
+	else								\
+		__asm__ __volatile__ (AMOSWAP_H(%0, %1, %2)		\
+				      : "=&r" (r)			\
+				      : "r" (p), "r" (n)		\
+				      : "memory");			\
+	goto __done;							\
+__no_zabha:								\
+	__arch_xchg_masked("", "", "", r, p, n);			\
+__done:									\
+	;								\
+})
 
 #define __xchg_relaxed(ptr, new, size)					\
 ({									\
@@ -16,6 +79,10 @@
 	__typeof__(new) __new = (new);					\
 	__typeof__(*(ptr)) __ret;					\
 	switch (size) {							\
+	case 1:								\
+	case 2:								\
+		__arch_xchg_masked_relaxed(__ret, __ptr, __new);	\
+		break;							\
 	case 4:								\
 		__asm__ __volatile__ (					\
 			"	amoswap.w %0, %2, %1\n"			\
@@ -49,6 +116,11 @@
 	__typeof__(new) __new = (new);					\
 	__typeof__(*(ptr)) __ret;					\
 	switch (size) {							\
+	case 1:								\
+	case 2:								\
+		__arch_xchg_masked("", "", RISCV_ACQUIRE_BARRIER,	\
+				   __ret, __ptr, __new);		\
+		break;							\
 	case 4:								\
 		__asm__ __volatile__ (					\
 			"	amoswap.w %0, %2, %1\n"			\
@@ -84,6 +156,11 @@
 	__typeof__(new) __new = (new);					\
 	__typeof__(*(ptr)) __ret;					\
 	switch (size) {							\
+	case 1:								\
+	case 2:								\
+		__arch_xchg_masked("", RISCV_RELEASE_BARRIER, "",	\
+				   __ret, __ptr, __new);		\
+		break;							\
 	case 4:								\
 		__asm__ __volatile__ (					\
 			RISCV_RELEASE_BARRIER				\
@@ -119,6 +196,11 @@
 	__typeof__(new) __new = (new);					\
 	__typeof__(*(ptr)) __ret;					\
 	switch (size) {							\
+	case 1:								\
+	case 2:								\
+		__arch_xchg_masked(".rl", "", "	fence rw, rw\n",	\
+				   __ret, __ptr, __new);		\
+		break;							\
 	case 4:								\
 		__asm__ __volatile__ (					\
 			"	amoswap.w.aqrl %0, %2, %1\n"		\
@@ -161,202 +243,313 @@
  * Atomic compare and exchange.  Compare OLD with MEM, if identical,
  * store NEW in MEM.  Return the initial value in MEM.  Success is
  * indicated by comparing RETURN with OLD.
+ *
+ * Each size has an LR/SC loop and, when the hart implements Zacas (and
+ * Zabha for 8 and 16-bit values), an alternative-patched amocas of the
+ * same ordering. amocas never fails spuriously and needs no retry
+ * loop, so contended cmpxchg() no longer depends on LR/SC forward
+ * progress guarantees.
  */
-#define __cmpxchg_relaxed(ptr, old, new, size)				\
+#define __arch_cmpxchg_masked(sc_sfx, ord, prepend, append, r, p, o, n)	\
 ({									\
-	__typeof__(ptr) __ptr = (ptr);					\
-	__typeof__(*(ptr)) __old = (old);				\
-	__typeof__(*(ptr)) __new = (new);				\
-	__typeof__(*(ptr)) __ret;					\
-	register unsigned int __rc;					\
-	switch (size) {							\
-	case 4:								\
-		__asm__ __volatile__ (					\
-			"0:	lr.w %0, %2\n"				\
-			"	bne  %0, %z3, 1f\n"			\
-			"	sc.w %1, %z4, %2\n"			\
-			"	bnez %1, 0b\n"				\
-			"1:\n"						\
-			: "=&r" (__ret), "=&r" (__rc), "+A" (*__ptr)	\
-			: "rJ" ((long)__old), "rJ" (__new)		\
-			: "memory");					\
-		break;							\
-	case 8:								\
-		__asm__ __volatile__ (					\
-			"0:	lr.d %0, %2\n"				\
-			"	bne %0, %z3, 1f\n"			\
-			"	sc.d %1, %z4, %2\n"			\
-			"	bnez %1, 0b\n"				\
-			"1:\n"						\
-			: "=&r" (__ret), "=&r" (__rc), "+A" (*__ptr)	\
-			: "rJ" (__old), "rJ" (__new)			\
-			: "memory");					\
-		break;							\
-	default:							\
-		BUILD_BUG();						\
+	__label__ __no_zabha, __done;					\
+									\
+	asm goto(ALTERNATIVE("j %l[__no_zabha]", "nop", 0,		\
+			     RISCV_ISA_EXT_ZABHA, 1)			\
+		 : : : : __no_zabha);					\
+	asm goto(ALTERNATIVE("j %l[__no_zabha]", "nop", 0,		\
+			     RISCV_ISA_EXT_ZACAS, 1)			\
+		 : : : : __no_zabha);					\
+	r = o;								\
+	if (sizeof(*p) == 1)						\
+		__asm__ __volatile__ (AMOCAS_B(%0, %1, %2, ord)		\
+				      : "+&r" (r)			\
+				      : "r" (p), "r" (n)		\
+				      : "memory");			\
+	else								\
+		__asm__ __volatile__ (AMOCAS_H(%0, %1, %2, ord)		\
+				      : "+&r" (r)			\
+				      : "r" (p), "r" (n)		\
+				      : "memory");			\
+	goto __done;							\
+__no_zabha:								\
+	{								\
+	u32 *__ptr32b = (u32 *)((ulong)(p) & ~0x3);			\
+	ulong __s = ((ulong)(p) & (0x4 - sizeof(*p))) * BITS_PER_BYTE;	\
+	ulong __mask = GENMASK(((sizeof(*p)) * BITS_PER_BYTE) - 1, 0)	\
+			<< __s;						\
+	ulong __newx = ((ulong)(n) << __s) & __mask;			\
+	ulong __oldx = ((ulong)(o) << __s) & __mask;			\
+	ulong __retx;							\
+	ulong __rc;							\
+									\
+	__asm__ __volatile__ (						\
+		prepend							\
+		"0:	lr.w %0, %2\n"					\
+		"	and  %1, %0, %z5\n"				\
+		"	bne  %1, %z3, 1f\n"				\
+		"	and  %1, %0, %z6\n"				\
+		"	or   %1, %1, %z4\n"				\
+		"	sc.w" sc_sfx " %1, %1, %2\n"			\
+		"	bnez %1, 0b\n"					\
+		append							\
+		"1:\n"							\
+		: "=&r" (__retx), "=&r" (__rc), "+A" (*(__ptr32b))	\
+		: "rJ" ((long)__oldx), "rJ" (__newx),			\
+		  "rJ" (__mask), "rJ" (~__mask)				\
+		: "memory");						\
+									\
+	r = (__typeof__(*(p)))((__retx & __mask) >> __s);		\
 	}								\
-	__ret;								\
+__done:									\
+	;								\
 })
 
-#define arch_cmpxchg_relaxed(ptr, o, n)					\
+#define __arch_cmpxchg(lr_sfx, sc_sfx, cas_insn, prepend, append,	\
+		       r, p, co, o, n)					\
 ({									\
-	__typeof__(*(ptr)) _o_ = (o);					\
-	__typeof__(*(ptr)) _n_ = (n);					\
-	(__typeof__(*(ptr))) __cmpxchg_relaxed((ptr),			\
-					_o_, _n_, sizeof(*(ptr)));	\
+	__label__ __no_zacas, __done;					\
+									\
+	asm goto(ALTERNATIVE("j %l[__no_zacas]", "nop", 0,		\
+			     RISCV_ISA_EXT_ZACAS, 1)			\
+		 : : : : __no_zacas);					\
+	r = (__typeof__(r))(o);						\
+	__asm__ __volatile__ (cas_insn					\
+			      : "+&r" (r)				\
+			      : "r" (p), "r" (n)			\
+			      : "memory");				\
+	goto __done;							\
+__no_zacas:								\
+	{								\
+	register unsigned int __rc;					\
+									\
+	__asm__ __volatile__ (						\
+		prepend							\
+		"0:	lr" lr_sfx " %0, %2\n"				\
+		"	bne  %0, %z3, 1f\n"				\
+		"	sc" sc_sfx " %1, %z4, %2\n"			\
+		"	bnez %1, 0b\n"					\
+		append							\
+		"1:\n"							\
+		: "=&r" (r), "=&r" (__rc), "+A" (*(p))			\
+		: "rJ" (co o), "rJ" (n)					\
+		: "memory");						\
+	}								\
+__done:									\
+	;								\
 })
 
-#define __cmpxchg_acquire(ptr, old, new, size)				\
+#define _arch_cmpxchg(ptr, old, new, sc_sfx, ord, prepend, append)	\
 ({									\
 	__typeof__(ptr) __ptr = (ptr);					\
-	__typeof__(*(ptr)) __old = (old);				\
-	__typeof__(*(ptr)) __new = (new);				\
-	__typeof__(*(ptr)) __ret;					\
-	register unsigned int __rc;					\
-	switch (size) {							\
+	__typeof__(*(__ptr)) __old = (old);				\
+	__typeof__(*(__ptr)) __new = (new);				\
+	__typeof__(*(__ptr)) __ret;					\
+									\
+	switch (sizeof(*__ptr)) {					\
+	case 1:								\
+	case 2:								\
+		__arch_cmpxchg_masked(sc_sfx, ord, prepend, append,	\
+				      __ret, __ptr, __old, __new);	\
+		break;							\
 	case 4:								\
-		__asm__ __volatile__ (					\
-			"0:	lr.w %0, %2\n"				\
-			"	bne  %0, %z3, 1f\n"			\
-			"	sc.w %1, %z4, %2\n"			\
-			"	bnez %1, 0b\n"				\
-			RISCV_ACQUIRE_BARRIER				\
-			"1:\n"						\
-			: "=&r" (__ret), "=&r" (__rc), "+A" (*__ptr)	\
-			: "rJ" ((long)__old), "rJ" (__new)		\
-			: "memory");					\
+		__arch_cmpxchg(".w", ".w" sc_sfx,			\
+			       AMOCAS_W(%0, %1, %2, ord),		\
+			       prepend, append,				\
+			       __ret, __ptr, (long), __old, __new);	\
 		break;							\
 	case 8:								\
-		__asm__ __volatile__ (					\
-			"0:	lr.d %0, %2\n"				\
-			"	bne %0, %z3, 1f\n"			\
-			"	sc.d %1, %z4, %2\n"			\
-			"	bnez %1, 0b\n"				\
-			RISCV_ACQUIRE_BARRIER				\
-			"1:\n"						\
-			: "=&r" (__ret), "=&r" (__rc), "+A" (*__ptr)	\
-			: "rJ" (__old), "rJ" (__new)			\
-			: "memory");					\
+		__arch_cmpxchg(".d", ".d" sc_sfx,			\
+			       AMOCAS_D(%0, %1, %2, ord),		\
+			       prepend, append,				\
+			       __ret, __ptr, /**/, __old, __new);	\
 		break;							\
 	default:							\
 		BUILD_BUG();						\
 	}								\
-	__ret;								\
+	(__typeof__(*(__ptr)))__ret;					\
 })
 
+#define arch_cmpxchg_relaxed(ptr, o, n)					\
+	_arch_cmpxchg((ptr), (o), (n), "", RELAXED, "", "")
+
 #define arch_cmpxchg_acquire(ptr, o, n)					\
-({									\
-	__typeof__(*(ptr)) _o_ = (o);					\
-	__typeof__(*(ptr)) _n_ = (n);					\
-	(__typeof__(*(ptr))) __cmpxchg_acquire((ptr),			\
-					_o_, _n_, sizeof(*(ptr)));	\
-})
+	_arch_cmpxchg((ptr), (o), (n), "", AQ, "", RISCV_ACQUIRE_BARRIER)
 
-#define __cmpxchg_release(ptr, old, new, size)				\
+#define arch_cmpxchg_release(ptr, o, n)					\
+	_arch_cmpxchg((ptr), (o), (n), "", RL, RISCV_RELEASE_BARRIER, "")
+
+#define arch_cmpxchg(ptr, o, n)						\
+	_arch_cmpxchg((ptr), (o), (n), ".rl", AQRL, "", RISCV_FULL_BARRIER)
+
+#define arch_cmpxchg_local(ptr, o, n)					\
+	arch_cmpxchg_relaxed((ptr), (o), (n))
+
+#define arch_cmpxchg64(ptr, o, n)					\
 ({									\
-	__typeof__(ptr) __ptr = (ptr);					\
-	__typeof__(*(ptr)) __old = (old);				\
-	__typeof__(*(ptr)) __new = (new);				\
-	__typeof__(*(ptr)) __ret;					\
-	register unsigned int __rc;					\
-	switch (size) {							\
-	case 4:								\
-		__asm__ __volatile__ (					\
-			RISCV_RELEASE_BARRIER				\
-			"0:	lr.w %0, %2\n"				\
-			"	bne  %0, %z3, 1f\n"			\
-			"	sc.w %1, %z4, %2\n"			\
-			"	bnez %1, 0b\n"				\
-			"1:\n"						\
-			: "=&r" (__ret), "=&r" (__rc), "+A" (*__ptr)	\
-			: "rJ" ((long)__old), "rJ" (__new)		\
-			: "memory");					\
-		break;							\
-	case 8:								\
-		__asm__ __volatile__ (					\
-			RISCV_RELEASE_BARRIER				\
-			"0:	lr.d %0, %2\n"				\
-			"	bne %0, %z3, 1f\n"			\
-			"	sc.d %1, %z4, %2\n"			\
-			"	bnez %1, 0b\n"				\
-			"1:\n"						\
-			: "=&r" (__ret), "=&r" (__rc), "+A" (*__ptr)	\
-			: "rJ" (__old), "rJ" (__new)			\
-			: "memory");					\
-		break;							\
-	default:							\
-		BUILD_BUG();						\
-	}								\
-	__ret;								\
+	BUILD_BUG_ON(sizeof(*(ptr)) != 8);				\
+	arch_cmpxchg((ptr), (o), (n));					\
 })
 
-#define arch_cmpxchg_release(ptr, o, n)					\
+#define arch_cmpxchg64_local(ptr, o, n)					\
 ({									\
-	__typeof__(*(ptr)) _o_ = (o);					\
-	__typeof__(*(ptr)) _n_ = (n);					\
-	(__typeof__(*(ptr))) __cmpxchg_release((ptr),			\
-					_o_, _n_, sizeof(*(ptr)));	\
+	BUILD_BUG_ON(sizeof(*(ptr)) != 8);				\
+	arch_cmpxchg_relaxed((ptr), (o), (n));				\
 })
 
-#define __cmpxchg(ptr, old, new, size)					\
+/*
+ * Without these, the generic fallbacks turn cmpxchg64_relaxed() (as used by
+ * the lockref fast path) into the fully ordered arch_cmpxchg64().
+ */
+#define arch_cmpxchg64_relaxed(ptr, o, n)				\
 ({									\
-	__typeof__(ptr) __ptr = (ptr);					\
-	__typeof__(*(ptr)) __old = (old);				\
-	__typeof__(*(ptr)) __new = (new);				\
-	__typeof__(*(ptr)) __ret;					\
-	register unsigned int __rc;					\
-	switch (size) {							\
-	case 4:								\
-		__asm__ __volatile__ (					\
-			"0:	lr.w %0, %2\n"				\
-			"	bne  %0, %z3, 1f\n"			\
-			"	sc.w.rl %1, %z4, %2\n"			\
-			"	bnez %1, 0b\n"				\
-			RISCV_FULL_BARRIER				\
-			"1:\n"						\
-			: "=&r" (__ret), "=&r" (__rc), "+A" (*__ptr)	\
-			: "rJ" ((long)__old), "rJ" (__new)		\
-			: "memory");					\
-		break;							\
-	case 8:								\
-		__asm__ __volatile__ (					\
-			"0:	lr.d %0, %2\n"				\
-			"	bne %0, %z3, 1f\n"			\
-			"	sc.d.rl %1, %z4, %2\n"			\
-			"	bnez %1, 0b\n"				\
-			RISCV_FULL_BARRIER				\
-			"1:\n"						\
-			: "=&r" (__ret), "=&r" (__rc), "+A" (*__ptr)	\
-			: "rJ" (__old), "rJ" (__new)			\
-			: "memory");					\
-		break;							\
-	default:							\
-		BUILD_BUG();						\
-	}								\
-	__ret;								\
+	BUILD_BUG_ON(sizeof(*(ptr)) != 8);				\
+	arch_cmpxchg_relaxed((ptr), (o), (n));				\
 })
 
-#define arch_cmpxchg(ptr, o, n)						\
+#define arch_cmpxchg64_acquire(ptr, o, n)				\
 ({									\
-	__typeof__(*(ptr)) _o_ = (o);					\
-	__typeof__(*(ptr)) _n_ = (n);					\
-	(__typeof__(*(ptr))) __cmpxchg((ptr),				\
-				       _o_, _n_, sizeof(*(ptr)));	\
+	BUILD_BUG_ON(sizeof(*(ptr)) != 8);				\
+	arch_cmpxchg_acquire((ptr), (o), (n));				\
 })
 
-#define arch_cmpxchg_local(ptr, o, n)					\
-	(__cmpxchg_relaxed((ptr), (o), (n), sizeof(*(ptr))))
-
-#define arch_cmpxchg64(ptr, o, n)					\
+#define arch_cmpxchg64_release(ptr, o, n)				\
 ({									\
 	BUILD_BUG_ON(sizeof(*(ptr)) != 8);				\
-	arch_cmpxchg((ptr), (o), (n));					\
+	arch_cmpxchg_release((ptr), (o), (n));				\
 })
 
-#define arch_cmpxchg64_local(ptr, o, n)					\
+#ifdef CONFIG_64BIT
+
+union __u128_halves {
+	u128 full;
+	struct {
+		u64 low, high;
+	};
+};
+
+/*
+ * amocas.q operates on even/odd register pairs holding the low and high
+ * halves, so pin the operands to t1/t2 (new) and t3/t4 (old/result).
+ */
+#define __arch_cmpxchg128(p, o, n, ord)					\
 ({									\
-	BUILD_BUG_ON(sizeof(*(ptr)) != 8);				\
-	arch_cmpxchg_relaxed((ptr), (o), (n));				\
+	union __u128_halves __ho = { .full = (o), },			\
+			    __hn = { .full = (n), };			\
+	register unsigned long __t1 asm ("t1") = __hn.low;		\
+	register unsigned long __t2 asm ("t2") = __hn.high;		\
+	register unsigned long __t3 asm ("t3") = __ho.low;		\
+	register unsigned long __t4 asm ("t4") = __ho.high;		\
+									\
+	__asm__ __volatile__ (AMOCAS_Q(%0, %2, %3, ord)			\
+			      : "+&r" (__t3), "+&r" (__t4)		\
+			      : "r" (p), "r" (__t1), "r" (__t2)		\
+			      : "memory");				\
+									\
+	((u128)__t4 << 64) | __t3;					\
 })
 
+static __always_inline u128 arch_cmpxchg128(volatile u128 *ptr, u128 old, u128 new)
+{
+	return __arch_cmpxchg128(ptr, old, new, AQRL);
+}
+#define arch_cmpxchg128 arch_cmpxchg128
+
+static __always_inline u128 arch_cmpxchg128_local(volatile u128 *ptr, u128 old, u128 new)
+{
+	return __arch_cmpxchg128(ptr, old, new, RELAXED);
+}
+#define arch_cmpxchg128_local arch_cmpxchg128_local
+
+/*
+ * There is no LR/SC fallback for 128-bit values; callers must check this
+ * before using cmpxchg128(), as they do on other architectures.
+ */
+static __always_inline bool __riscv_has_cmpxchg128(void)
+{
+	asm goto(ALTERNATIVE("j %l[no_zacas]", "nop", 0, RISCV_ISA_EXT_ZACAS, 1)
+		 : : : : no_zacas);
+	return true;
+no_zacas:
+	return false;
+}
+
+#define system_has_cmpxchg128()		__riscv_has_cmpxchg128()
+
+#endif /* CONFIG_64BIT */
+
+/*
+ * Wait for *ptr to change from @val. With Zawrs, the lr registers a
+ * reservation on the containing word and wrs.nto stalls the hart until
+ * that reservation is lost (or an interrupt becomes pending), rather than
+ * spinning on loads. Without it, fall back to a pause hint. Either way
+ * the caller re-reads *ptr, so returning early is harmless.
+ */
+static __always_inline void __cmpwait(volatile void *ptr, unsigned long val,
+				      int size)
+{
+	unsigned long tmp;
+	u32 *__ptr32b;
+	ulong __s, __val, __mask;
+
+	asm goto(ALTERNATIVE("j %l[no_zawrs]", "nop", 0, RISCV_ISA_EXT_ZAWRS, 1)
+		 : : : : no_zawrs);
+
+	switch (size) {
+	case 1:
+	case 2:
+		__ptr32b = (u32 *)((ulong)(ptr) & ~0x3);
+		__s = ((ulong)(ptr) & (0x4 - size)) * BITS_PER_BYTE;
+		__mask = GENMASK(size * BITS_PER_BYTE - 1, 0) << __s;
+		__val = (val << __s) & __mask;
+		__asm__ __volatile__ (
+			"	lr.w	%0, %1\n"
+			"	and	%0, %0, %3\n"
+			"	xor	%0, %0, %2\n"
+			"	bnez	%0, 1f\n"
+			WRS_NTO()
+			"1:\n"
+			: "=&r" (tmp), "+A" (*(__ptr32b))
+			: "r" (__val), "r" (__mask)
+			: "memory");
+		break;
+	case 4:
+		/* lr.w sign-extends, so compare against a sign-extended val */
+		__asm__ __volatile__ (
+			"	lr.w	%0, %1\n"
+			"	xor	%0, %0, %2\n"
+			"	bnez	%0, 1f\n"
+			WRS_NTO()
+			"1:\n"
+			: "=&r" (tmp), "+A" (*(u32 *)ptr)
+			: "r" ((long)(int)val)
+			: "memory");
+		break;
+#ifdef CONFIG_64BIT
+	case 8:
+		__asm__ __volatile__ (
+			"	lr.d	%0, %1\n"
+			"	xor	%0, %0, %2\n"
+			"	bnez	%0, 1f\n"
+			WRS_NTO()
+			"1:\n"
+			: "=&r" (tmp), "+A" (*(u64 *)ptr)
+			: "r" (val)
+			: "memory");
+		break;
+#endif
+	default:
+		BUILD_BUG();
+	}
+
+	return;
+
+no_zawrs:
+	/* Encoding of the Zihintpause pause hint, a nop without it */
+	__asm__ __volatile__ (".4byte 0x100000F" : : : "memory");
+}
+
+#define __cmpwait_relaxed(ptr, val)					\
+	__cmpwait((ptr), (unsigned long)(val), sizeof(*(ptr)))
+
 #endif /* _ASM_RISCV_CMPXCHG_H */
@@ -32,17 +32,27 @@ DECLARE_PER_CPU(struct riscv_cpuinfo, riscv_cpuinfo);
 extern struct riscv_isainfo hart_isa[NR_CPUS];
 
 void riscv_user_isa_enable(void);
+void riscv_svadu_enable(void);
+
+struct mm_struct;
 
 #if defined(CONFIG_RISCV_MISALIGNED)
 bool check_unaligned_access_emulated_all_cpus(void);
 void unaligned_emulation_finish(void);
 bool unaligned_ctl_available(void);
+void misaligned_report_free(struct mm_struct *mm);
 DECLARE_PER_CPU(long, misaligned_access_speed);
 #else
 static inline bool unaligned_ctl_available(void)
 {
 	return false;
 }
+
+static inline void misaligned_report_free(struct mm_struct *mm) { }
+#endif
+
+#if defined(CONFIG_RISCV_ISA_V) && defined(CONFIG_MMU)
+DECLARE_PER_CPU(size_t, riscv_v_usercopy_threshold);
 #endif
 
 #if defined(CONFIG_RISCV_PROBE_UNALIGNED_ACCESS)
@@ -0,0 +1,167 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Barrett reduction helpers for 32-bit CRCs using the Zbc carry-less
+ * multiply instructions.
+ *
+ * Each step folds one XLEN-sized chunk of message, already XORed with the
+ * running CRC, into a new 32-bit CRC with two carry-less multiplies: one
+ * by the quotient (floor(x^96 / P(x)), with its implicit x^64 term
+ * dropped) and one by the polynomial itself.
+ */
+
+#ifndef _ASM_RISCV_CRC_ZBC_H
+#define _ASM_RISCV_CRC_ZBC_H
+
+#include <linux/minmax.h>
+#include <linux/types.h>
+#include <asm/byteorder.h>
+#include <asm/insn-def.h>
+
+#define CRC_ZBC_STEP_ORDER	3
+#define CRC_ZBC_STEP		(1 << CRC_ZBC_STEP_ORDER)
+#define CRC_ZBC_OFFSET_MASK	(CRC_ZBC_STEP - 1)
+
+/*
+ * Bit-reflected CRC: @s holds the message chunk in little-endian order, so
+ * the lowest-order term sits in the most significant bit after reflection.
+ * There is no "clmulrh", so emulate it with clmul followed by a 1-bit shift.
+ */
+static inline u32 crc32_le_zbc(unsigned long s, u32 poly, unsigned long poly_qt)
+{
+	unsigned long crc;
+
+	asm (CLMUL(%0, %1, %2) "\n\t"
+	     "slli	%0, %0, 0x1\n\t"
+	     "xor	%0, %0, %1\n\t"
+	     CLMULR(%0, %0, %3) "\n\t"
+	     "srli	%0, %0, 32\n\t"
+	     : "=&r" (crc)
+	     : "r" (s), "r" (poly_qt), "r" ((u64)poly << 32)
+	     :);
+
+	return crc;
+}
+
+/* Normal (MSB-first) CRC: @s holds the message chunk in big-endian order. */
+static inline u32 crc32_be_zbc(unsigned long s, u32 poly, unsigned long poly_qt)
+{
+	unsigned long crc;
+
+	asm (CLMULH(%0, %1, %2) "\n\t"
+	     "xor	%0, %0, %1\n\t"
+	     CLMUL(%0, %0, %3)
+	     : "=&r" (crc)
+	     : "r" (s), "r" (poly_qt), "r" ((unsigned long)poly)
+	     :);
+
+	return crc;
+}
+
+/* Fold @len (1..CRC_ZBC_STEP) bytes at @p into a reflected CRC. */
+static inline u32 crc32_le_unaligned_zbc(u32 crc, unsigned char const *p,
+					 size_t len, u32 poly,
+					 unsigned long poly_qt)
+{
+	size_t bits = len * 8;
+	unsigned long s = 0;
+	u32 crc_low = 0;
+
+	for (size_t i = 0; i < len; i++)
+		s = ((unsigned long)*p++ << (BITS_PER_LONG - 8)) | (s >> 8);
+
+	s ^= (unsigned long)crc << (BITS_PER_LONG - bits);
+	if (len < sizeof(u32))
+		crc_low = crc >> bits;
+
+	return crc32_le_zbc(s, poly, poly_qt) ^ crc_low;
+}
+
+/* Fold @len (1..CRC_ZBC_STEP) bytes at @p into a normal CRC. */
+static inline u32 crc32_be_unaligned_zbc(u32 crc, unsigned char const *p,
+					 size_t len, u32 poly,
+					 unsigned long poly_qt)
+{
+	size_t bits = len * 8;
+	unsigned long s = 0;
+	u32 crc_low = 0;
+
+	for (size_t i = 0; i < len; i++)
+		s = (s << 8) | *p++;
+
+	if (len < sizeof(u32)) {
+		s ^= crc >> (32 - bits);
+		crc_low = crc << bits;
+	} else {
+		s ^= (unsigned long)crc << (bits - 32);
+	}
+
+	return crc32_be_zbc(s, poly, poly_qt) ^ crc_low;
+}
+
+/*
+ * Callers must have checked for Zbc. The unaligned head and the tail are
+ * folded one partial chunk at a time; everything in between is processed
+ * with naturally aligned XLEN loads.
+ */
+static inline u32 crc32_le_generic_zbc(u32 crc, unsigned char const *p,
+				       size_t len, u32 poly,
+				       unsigned long poly_qt)
+{
+	unsigned long const *p_ul;
+	size_t offset, head_len, tail_len;
+
+	offset = (unsigned long)p & CRC_ZBC_OFFSET_MASK;
+	if (offset && len) {
+		head_len = min_t(size_t, CRC_ZBC_STEP - offset, len);
+		crc = crc32_le_unaligned_zbc(crc, p, head_len, poly, poly_qt);
+		p += head_len;
+		len -= head_len;
+	}
+
+	tail_len = len & CRC_ZBC_OFFSET_MASK;
+	len >>= CRC_ZBC_STEP_ORDER;
+	p_ul = (unsigned long const *)p;
+
+	for (size_t i = 0; i < len; i++)
+		crc = crc32_le_zbc(crc ^ le64_to_cpu(*p_ul++), poly, poly_qt);
+
+	if (tail_len)
+		crc = crc32_le_unaligned_zbc(crc, (unsigned char const *)p_ul,
+					     tail_len, poly, poly_qt);
+
+	return crc;
+}
+
+static inline u32 crc32_be_generic_zbc(u32 crc, unsigned char const *p,
+				       size_t len, u32 poly,
+				       unsigned long poly_qt)
+{
+	unsigned long const *p_ul;
+	size_t offset, head_len, tail_len;
+	unsigned long s;
+
+	offset = (unsigned long)p & CRC_ZBC_OFFSET_MASK;
+	if (offset && len) {
+		head_len = min_t(size_t, CRC_ZBC_STEP - offset, len);
+		crc = crc32_be_unaligned_zbc(crc, p, head_len, poly, poly_qt);
+		p += head_len;
+		len -= head_len;
+	}
+
+	tail_len = len & CRC_ZBC_OFFSET_MASK;
+	len >>= CRC_ZBC_STEP_ORDER;
+	p_ul = (unsigned long const *)p;
+
+	for (size_t i = 0; i < len; i++) {
+		s = ((unsigned long)crc << 32) ^ be64_to_cpu(*p_ul++);
+		crc = crc32_be_zbc(s, poly, poly_qt);
+	}
+
+	if (tail_len)
+		crc = crc32_be_unaligned_zbc(crc, (unsigned char const *)p_ul,
+					     tail_len, poly, poly_qt);
+
+	return crc;
+}
+
+#endif /* _ASM_RISCV_CRC_ZBC_H */
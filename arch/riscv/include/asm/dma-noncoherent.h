@@ -14,11 +14,16 @@
  * @wback: Function pointer for cache writeback
  * @inv: Function pointer for invalidating cache
  * @wback_inv: Function pointer for flushing the cache (writeback + invalidating)
+ * @wback_inv_all: Optional function pointer for flushing the whole cache
+ * @wback_inv_all_size: Range size from which @wback_inv_all is used instead of
+ *			the range operations, typically the cache size
  */
 struct riscv_nonstd_cache_ops {
 	void (*wback)(phys_addr_t paddr, size_t size);
 	void (*inv)(phys_addr_t paddr, size_t size);
 	void (*wback_inv)(phys_addr_t paddr, size_t size);
+	void (*wback_inv_all)(void);
+	size_t wback_inv_all_size;
 };
 
 extern struct riscv_nonstd_cache_ops noncoherent_cache_ops;
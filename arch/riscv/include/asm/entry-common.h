@@ -17,6 +17,7 @@ static inline void arch_exit_to_user_mode_prepare(struct pt_regs *regs,
 		 * keeping track of riscv_v_flags.
 		 */
 		riscv_v_vstate_restore(&current->thread.vstate, regs);
+		current->thread.vstate_discarded = false;
 	}
 }
 
@@ -14,6 +14,9 @@
 #define HAVE_FUNCTION_GRAPH_RET_ADDR_PTR
 
 #define ARCH_SUPPORTS_FTRACE_OPS 1
+
+/* Size of the per-callsite ftrace_ops pointer in front of each function */
+#define FTRACE_OPS_LITERAL_SIZE	8
 #ifndef __ASSEMBLY__
 
 extern void *return_address(unsigned int level);
@@ -23,6 +26,13 @@ extern void *return_address(unsigned int level);
 void _mcount(void);
 static inline unsigned long ftrace_call_adjust(unsigned long addr)
 {
+	/*
+	 * With call ops, __patchable_function_entries points at the 8-byte
+	 * ftrace_ops literal placed in front of the function entry.
+	 */
+	if (IS_ENABLED(CONFIG_DYNAMIC_FTRACE_WITH_CALL_OPS))
+		return addr + FTRACE_OPS_LITERAL_SIZE;
+
 	return addr;
 }
 
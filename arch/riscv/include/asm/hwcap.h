@@ -81,6 +81,12 @@
 #define RISCV_ISA_EXT_ZTSO		72
 #define RISCV_ISA_EXT_ZACAS		73
 #define RISCV_ISA_EXT_XANDESPMU		74
+#define RISCV_ISA_EXT_ZABHA		75
+#define RISCV_ISA_EXT_ZICCRSE		76
+#define RISCV_ISA_EXT_ZAWRS		77
+#define RISCV_ISA_EXT_ZICBOP		78
+#define RISCV_ISA_EXT_SVADE		79
+#define RISCV_ISA_EXT_SVADU		80
 
 #define RISCV_ISA_EXT_XLINUXENVCFG	127
 
@@ -8,11 +8,32 @@
 
 #include <uapi/asm/hwprobe.h>
 
-#define RISCV_HWPROBE_MAX_KEY 6
+#define RISCV_HWPROBE_MAX_KEY 18
+
+/*
+ * The keys in between are assigned upstream to features this kernel
+ * doesn't report. Tables indexed by key, such as the vDSO's, are packed
+ * into one slot per key that is answered.
+ */
+static inline int riscv_hwprobe_key_slot(__s64 key)
+{
+	switch (key) {
+	case RISCV_HWPROBE_KEY_MVENDORID ... RISCV_HWPROBE_KEY_TIME_CSR_FREQ:
+		return key;
+	case RISCV_HWPROBE_KEY_VECTOR_USERCOPY_THRESHOLD:
+		return RISCV_HWPROBE_KEY_TIME_CSR_FREQ + 1;
+	case RISCV_HWPROBE_KEY_TIME_CSR:
+		return RISCV_HWPROBE_KEY_TIME_CSR_FREQ + 2;
+	}
+
+	return -1;
+}
+
+#define RISCV_HWPROBE_NR_SLOTS	(RISCV_HWPROBE_KEY_TIME_CSR_FREQ + 3)
 
 static inline bool riscv_hwprobe_key_is_valid(__s64 key)
 {
-	return key >= 0 && key <= RISCV_HWPROBE_MAX_KEY;
+	return riscv_hwprobe_key_slot(key) >= 0;
 }
 
 static inline bool hwprobe_key_is_bitmask(__s64 key)
@@ -39,4 +60,28 @@ static inline bool riscv_hwprobe_pair_cmp(struct riscv_hwprobe *pair,
 	return pair->value == other_pair->value;
 }
 
+/*
+ * Combine the answers of two sets of CPUs for @key the way the syscall
+ * reports a value that holds across the union of both sets.
+ */
+static inline __u64 riscv_hwprobe_combine(__s64 key, __u64 a, __u64 b)
+{
+	switch (key) {
+	case RISCV_HWPROBE_KEY_MVENDORID:
+	case RISCV_HWPROBE_KEY_MARCHID:
+	case RISCV_HWPROBE_KEY_MIMPID:
+		return a == b ? a : -1ULL;
+	case RISCV_HWPROBE_KEY_IMA_EXT_0:
+		return a & b;
+	case RISCV_HWPROBE_KEY_CPUPERF_0:
+		return a == b ? a : RISCV_HWPROBE_MISALIGNED_UNKNOWN;
+	case RISCV_HWPROBE_KEY_ZICBOZ_BLOCK_SIZE:
+		return a == b ? a : 0;
+	case RISCV_HWPROBE_KEY_VECTOR_USERCOPY_THRESHOLD:
+		return a > b ? a : b;
+	}
+
+	return a;
+}
+
 #endif
@@ -133,6 +133,9 @@
 #define RV___RS2(v)		__RV_REG(v)
 
 #define RV_OPCODE_MISC_MEM	RV_OPCODE(15)
+#define RV_OPCODE_OP_IMM	RV_OPCODE(19)
+#define RV_OPCODE_AMO		RV_OPCODE(47)
+#define RV_OPCODE_OP		RV_OPCODE(51)
 #define RV_OPCODE_SYSTEM	RV_OPCODE(115)
 
 #define HFENCE_VVMA(vaddr, asid)				\
@@ -172,6 +175,14 @@
 	INSN_R(OPCODE_SYSTEM, FUNC3(0), FUNC7(12),		\
 	       __RD(0), __RS1(0), __RS2(1))
 
+#define WRS_NTO()						\
+	INSN_I(OPCODE_SYSTEM, FUNC3(0), __RD(0),		\
+	       __RS1(0), SIMM12(13))
+
+#define WRS_STO()						\
+	INSN_I(OPCODE_SYSTEM, FUNC3(0), __RD(0),		\
+	       __RS1(0), SIMM12(29))
+
 #define HINVAL_VVMA(vaddr, asid)				\
 	INSN_R(OPCODE_SYSTEM, FUNC3(0), FUNC7(19),		\
 	       __RD(0), RS1(vaddr), RS2(asid))
@@ -196,4 +207,71 @@
 	INSN_I(OPCODE_MISC_MEM, FUNC3(2), __RD(0),		\
 	       RS1(base), SIMM12(4))
 
+/*
+ * The Zicbop prefetches are ORI hints with rd=x0.  The offset must be a
+ * multiple of 32, as the low five bits of the immediate select the prefetch.
+ */
+#define PREFETCH_I(base, offset)				\
+	INSN_I(OPCODE_OP_IMM, FUNC3(6), __RD(0),		\
+	       RS1(base), SIMM12((((offset) & 0xfe0) | 0)))
+
+#define PREFETCH_R(base, offset)				\
+	INSN_I(OPCODE_OP_IMM, FUNC3(6), __RD(0),		\
+	       RS1(base), SIMM12((((offset) & 0xfe0) | 1)))
+
+#define PREFETCH_W(base, offset)				\
+	INSN_I(OPCODE_OP_IMM, FUNC3(6), __RD(0),		\
+	       RS1(base), SIMM12((((offset) & 0xfe0) | 3)))
+
+#define CLMUL(rd, rs1, rs2)					\
+	INSN_R(OPCODE_OP, FUNC3(1), FUNC7(5),			\
+	       RD(rd), RS1(rs1), RS2(rs2))
+
+#define CLMULR(rd, rs1, rs2)					\
+	INSN_R(OPCODE_OP, FUNC3(2), FUNC7(5),			\
+	       RD(rd), RS1(rs1), RS2(rs2))
+
+#define CLMULH(rd, rs1, rs2)					\
+	INSN_R(OPCODE_OP, FUNC3(3), FUNC7(5),			\
+	       RD(rd), RS1(rs1), RS2(rs2))
+
+/* Zabha; funct7 is funct5 (AMOSWAP) followed by clear aq/rl bits */
+#define AMOSWAP_B(rd, addr, rs2)				\
+	INSN_R(OPCODE_AMO, FUNC3(0), FUNC7(4),			\
+	       RD(rd), RS1(addr), RS2(rs2))
+
+#define AMOSWAP_H(rd, addr, rs2)				\
+	INSN_R(OPCODE_AMO, FUNC3(1), FUNC7(4),			\
+	       RD(rd), RS1(addr), RS2(rs2))
+
+/*
+ * Zacas/Zabha; funct7 is funct5 (AMOCAS) followed by the aq/rl bits, and
+ * @ord selects one of the AMOCAS_FUNC7_* orderings below.
+ */
+#define AMOCAS_FUNC7_RELAXED	20
+#define AMOCAS_FUNC7_RL		21
+#define AMOCAS_FUNC7_AQ		22
+#define AMOCAS_FUNC7_AQRL	23
+
+#define AMOCAS_B(rd, addr, rs2, ord)				\
+	INSN_R(OPCODE_AMO, FUNC3(0), FUNC7(AMOCAS_FUNC7_##ord),	\
+	       RD(rd), RS1(addr), RS2(rs2))
+
+#define AMOCAS_H(rd, addr, rs2, ord)				\
+	INSN_R(OPCODE_AMO, FUNC3(1), FUNC7(AMOCAS_FUNC7_##ord),	\
+	       RD(rd), RS1(addr), RS2(rs2))
+
+#define AMOCAS_W(rd, addr, rs2, ord)				\
+	INSN_R(OPCODE_AMO, FUNC3(2), FUNC7(AMOCAS_FUNC7_##ord),	\
+	       RD(rd), RS1(addr), RS2(rs2))
+
+#define AMOCAS_D(rd, addr, rs2, ord)				\
+	INSN_R(OPCODE_AMO, FUNC3(3), FUNC7(AMOCAS_FUNC7_##ord),	\
+	       RD(rd), RS1(addr), RS2(rs2))
+
+/* RV64 only; @rd and @rs2 name the even register of a register pair */
+#define AMOCAS_Q(rd, addr, rs2, ord)				\
+	INSN_R(OPCODE_AMO, FUNC3(4), FUNC7(AMOCAS_FUNC7_##ord),	\
+	       RD(rd), RS1(addr), RS2(rs2))
+
 #endif /* __ASM_INSN_DEF_H */
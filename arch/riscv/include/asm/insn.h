@@ -134,8 +134,12 @@
 #define RVC_C2_RS1_MASK		GENMASK(4, 0)
 
 /* parts of opcode for RVG*/
+#define RVG_OPCODE_LOAD		0x03
 #define RVG_OPCODE_FENCE	0x0f
+#define RVG_OPCODE_OP_IMM	0x13
 #define RVG_OPCODE_AUIPC	0x17
+#define RVG_OPCODE_STORE	0x23
+#define RVG_OPCODE_LUI		0x37
 #define RVG_OPCODE_BRANCH	0x63
 #define RVG_OPCODE_JALR		0x67
 #define RVG_OPCODE_JAL		0x6f
@@ -167,6 +171,11 @@
 #define RVC_OPCODE_C2		0x2
 
 /* parts of funct3 code for I, M, A extension*/
+#define RVG_FUNCT3_ADDI		0x0
+#define RVG_FUNCT3_LW		0x2
+#define RVG_FUNCT3_LD		0x3
+#define RVG_FUNCT3_SW		0x2
+#define RVG_FUNCT3_SD		0x3
 #define RVG_FUNCT3_JALR		0x0
 #define RVG_FUNCT3_BEQ		0x0
 #define RVG_FUNCT3_BNE		0x1
@@ -176,18 +185,33 @@
 #define RVG_FUNCT3_BGEU		0x7
 
 /* parts of funct3 code for C extension*/
+#define RVC_FUNCT3_C_ADDI4SPN	0x0
+#define RVC_FUNCT3_C_ADDI	0x0
+#define RVC_FUNCT3_C_LI		0x2
+#define RVC_FUNCT3_C_LUI	0x3
+#define RVC_FUNCT3_C_LWSP	0x2
+#define RVC_FUNCT3_C_LDSP	0x3
+#define RVC_FUNCT3_C_SWSP	0x6
+#define RVC_FUNCT3_C_SDSP	0x7
 #define RVC_FUNCT3_C_BEQZ	0x6
 #define RVC_FUNCT3_C_BNEZ	0x7
 #define RVC_FUNCT3_C_J		0x5
 #define RVC_FUNCT3_C_JAL	0x1
 #define RVC_FUNCT4_C_JR		0x8
+#define RVC_FUNCT4_C_MV		0x8
 #define RVC_FUNCT4_C_JALR	0x9
 #define RVC_FUNCT4_C_EBREAK	0x9
 
 #define RVG_FUNCT12_EBREAK	0x1
 #define RVG_FUNCT12_SRET	0x102
 
+#define RVG_MATCH_ADDI		(RV_ENCODE_FUNCT3(ADDI) | RVG_OPCODE_OP_IMM)
 #define RVG_MATCH_AUIPC		(RVG_OPCODE_AUIPC)
+#define RVG_MATCH_LUI		(RVG_OPCODE_LUI)
+#define RVG_MATCH_LW		(RV_ENCODE_FUNCT3(LW) | RVG_OPCODE_LOAD)
+#define RVG_MATCH_LD		(RV_ENCODE_FUNCT3(LD) | RVG_OPCODE_LOAD)
+#define RVG_MATCH_SW		(RV_ENCODE_FUNCT3(SW) | RVG_OPCODE_STORE)
+#define RVG_MATCH_SD		(RV_ENCODE_FUNCT3(SD) | RVG_OPCODE_STORE)
 #define RVG_MATCH_JALR		(RV_ENCODE_FUNCT3(JALR) | RVG_OPCODE_JALR)
 #define RVG_MATCH_JAL		(RVG_OPCODE_JAL)
 #define RVG_MATCH_FENCE		(RVG_OPCODE_FENCE)
@@ -199,6 +223,15 @@
 #define RVG_MATCH_BGEU		(RV_ENCODE_FUNCT3(BGEU) | RVG_OPCODE_BRANCH)
 #define RVG_MATCH_EBREAK	(RV_ENCODE_FUNCT12(EBREAK) | RVG_OPCODE_SYSTEM)
 #define RVG_MATCH_SRET		(RV_ENCODE_FUNCT12(SRET) | RVG_OPCODE_SYSTEM)
+#define RVC_MATCH_C_ADDI4SPN	(RVC_ENCODE_FUNCT3(C_ADDI4SPN) | RVC_OPCODE_C0)
+#define RVC_MATCH_C_ADDI	(RVC_ENCODE_FUNCT3(C_ADDI) | RVC_OPCODE_C1)
+#define RVC_MATCH_C_LI		(RVC_ENCODE_FUNCT3(C_LI) | RVC_OPCODE_C1)
+#define RVC_MATCH_C_LUI		(RVC_ENCODE_FUNCT3(C_LUI) | RVC_OPCODE_C1)
+#define RVC_MATCH_C_MV		(RVC_ENCODE_FUNCT4(C_MV) | RVC_OPCODE_C2)
+#define RVC_MATCH_C_LWSP	(RVC_ENCODE_FUNCT3(C_LWSP) | RVC_OPCODE_C2)
+#define RVC_MATCH_C_LDSP	(RVC_ENCODE_FUNCT3(C_LDSP) | RVC_OPCODE_C2)
+#define RVC_MATCH_C_SWSP	(RVC_ENCODE_FUNCT3(C_SWSP) | RVC_OPCODE_C2)
+#define RVC_MATCH_C_SDSP	(RVC_ENCODE_FUNCT3(C_SDSP) | RVC_OPCODE_C2)
 #define RVC_MATCH_C_BEQZ	(RVC_ENCODE_FUNCT3(C_BEQZ) | RVC_OPCODE_C1)
 #define RVC_MATCH_C_BNEZ	(RVC_ENCODE_FUNCT3(C_BNEZ) | RVC_OPCODE_C1)
 #define RVC_MATCH_C_J		(RVC_ENCODE_FUNCT3(C_J) | RVC_OPCODE_C1)
@@ -207,10 +240,25 @@
 #define RVC_MATCH_C_JALR	(RVC_ENCODE_FUNCT4(C_JALR) | RVC_OPCODE_C2)
 #define RVC_MATCH_C_EBREAK	(RVC_ENCODE_FUNCT4(C_EBREAK) | RVC_OPCODE_C2)
 
+#define RVG_MASK_ADDI		(RV_INSN_FUNCT3_MASK | RV_INSN_OPCODE_MASK)
 #define RVG_MASK_AUIPC		(RV_INSN_OPCODE_MASK)
+#define RVG_MASK_LUI		(RV_INSN_OPCODE_MASK)
+#define RVG_MASK_LW		(RV_INSN_FUNCT3_MASK | RV_INSN_OPCODE_MASK)
+#define RVG_MASK_LD		(RV_INSN_FUNCT3_MASK | RV_INSN_OPCODE_MASK)
+#define RVG_MASK_SW		(RV_INSN_FUNCT3_MASK | RV_INSN_OPCODE_MASK)
+#define RVG_MASK_SD		(RV_INSN_FUNCT3_MASK | RV_INSN_OPCODE_MASK)
 #define RVG_MASK_JALR		(RV_INSN_FUNCT3_MASK | RV_INSN_OPCODE_MASK)
 #define RVG_MASK_JAL		(RV_INSN_OPCODE_MASK)
 #define RVG_MASK_FENCE		(RV_INSN_OPCODE_MASK)
+#define RVC_MASK_C_ADDI4SPN	(RVC_INSN_FUNCT3_MASK | RVC_INSN_OPCODE_MASK)
+#define RVC_MASK_C_ADDI		(RVC_INSN_FUNCT3_MASK | RVC_INSN_OPCODE_MASK)
+#define RVC_MASK_C_LI		(RVC_INSN_FUNCT3_MASK | RVC_INSN_OPCODE_MASK)
+#define RVC_MASK_C_LUI		(RVC_INSN_FUNCT3_MASK | RVC_INSN_OPCODE_MASK)
+#define RVC_MASK_C_MV		(RVC_INSN_FUNCT4_MASK | RVC_INSN_OPCODE_MASK)
+#define RVC_MASK_C_LWSP		(RVC_INSN_FUNCT3_MASK | RVC_INSN_OPCODE_MASK)
+#define RVC_MASK_C_LDSP		(RVC_INSN_FUNCT3_MASK | RVC_INSN_OPCODE_MASK)
+#define RVC_MASK_C_SWSP		(RVC_INSN_FUNCT3_MASK | RVC_INSN_OPCODE_MASK)
+#define RVC_MASK_C_SDSP		(RVC_INSN_FUNCT3_MASK | RVC_INSN_OPCODE_MASK)
 #define RVC_MASK_C_JALR		(RVC_INSN_FUNCT4_MASK | RVC_INSN_J_RS2_MASK | RVC_INSN_OPCODE_MASK)
 #define RVC_MASK_C_JR		(RVC_INSN_FUNCT4_MASK | RVC_INSN_J_RS2_MASK | RVC_INSN_OPCODE_MASK)
 #define RVC_MASK_C_JAL		(RVC_INSN_FUNCT3_MASK | RVC_INSN_OPCODE_MASK)
@@ -245,7 +293,24 @@ __RISCV_INSN_FUNCS(c_jal, RVC_MASK_C_JAL, RVC_MATCH_C_JAL)
 #else
 #define riscv_insn_is_c_jal(opcode) 0
 #endif
+#if __riscv_xlen == 64
+/* On RV32 these encodings are C.FLWSP and C.FSWSP, and there is no LD/SD */
+__RISCV_INSN_FUNCS(ld, RVG_MASK_LD, RVG_MATCH_LD)
+__RISCV_INSN_FUNCS(sd, RVG_MASK_SD, RVG_MATCH_SD)
+__RISCV_INSN_FUNCS(c_sdsp, RVC_MASK_C_SDSP, RVC_MATCH_C_SDSP)
+#else
+#define riscv_insn_is_ld(opcode) 0
+#define riscv_insn_is_sd(opcode) 0
+#define riscv_insn_is_c_sdsp(opcode) 0
+#endif
+__RISCV_INSN_FUNCS(lw, RVG_MASK_LW, RVG_MATCH_LW)
+__RISCV_INSN_FUNCS(sw, RVG_MASK_SW, RVG_MATCH_SW)
+__RISCV_INSN_FUNCS(c_swsp, RVC_MASK_C_SWSP, RVC_MATCH_C_SWSP)
+__RISCV_INSN_FUNCS(addi, RVG_MASK_ADDI, RVG_MATCH_ADDI)
 __RISCV_INSN_FUNCS(auipc, RVG_MASK_AUIPC, RVG_MATCH_AUIPC)
+__RISCV_INSN_FUNCS(lui, RVG_MASK_LUI, RVG_MATCH_LUI)
+__RISCV_INSN_FUNCS(c_addi, RVC_MASK_C_ADDI, RVC_MATCH_C_ADDI)
+__RISCV_INSN_FUNCS(c_li, RVC_MASK_C_LI, RVC_MATCH_C_LI)
 __RISCV_INSN_FUNCS(jalr, RVG_MASK_JALR, RVG_MATCH_JALR)
 __RISCV_INSN_FUNCS(jal, RVG_MASK_JAL, RVG_MATCH_JAL)
 __RISCV_INSN_FUNCS(c_j, RVC_MASK_C_J, RVC_MATCH_C_J)
@@ -286,6 +351,52 @@ static __always_inline bool riscv_insn_is_c_jalr(u32 code)
 	       (code & RVC_INSN_J_RS1_MASK) != 0;
 }
 
+/* C.MV shares its funct4 with C.JR, it is the one with rs2 != x0 */
+static __always_inline bool riscv_insn_is_c_mv(u32 code)
+{
+	return (code & RVC_MASK_C_MV) == RVC_MATCH_C_MV &&
+	       (code & RVC_INSN_J_RS2_MASK) != 0;
+}
+
+/* An all-zero immediate makes it the defined illegal instruction */
+static __always_inline bool riscv_insn_is_c_addi4spn(u32 code)
+{
+	return (code & RVC_MASK_C_ADDI4SPN) == RVC_MATCH_C_ADDI4SPN &&
+	       (code & GENMASK(12, 5)) != 0;
+}
+
+/* C.LWSP and C.LDSP with rd == x0 are reserved */
+static __always_inline bool riscv_insn_is_c_lwsp(u32 code)
+{
+	return (code & RVC_MASK_C_LWSP) == RVC_MATCH_C_LWSP &&
+	       (code & RVC_INSN_J_RS1_MASK) != 0;
+}
+
+static __always_inline bool riscv_insn_is_c_ldsp(u32 code)
+{
+	return __riscv_xlen == 64 &&
+	       (code & RVC_MASK_C_LDSP) == RVC_MATCH_C_LDSP &&
+	       (code & RVC_INSN_J_RS1_MASK) != 0;
+}
+
+/*
+ * C.ADDI16SP is the C.LUI encoding with rd == sp, an all-zero immediate is
+ * reserved for both.
+ */
+static __always_inline bool riscv_insn_is_c_addi16sp(u32 code)
+{
+	return (code & RVC_MASK_C_LUI) == RVC_MATCH_C_LUI &&
+	       (code & RVC_INSN_J_RS1_MASK) == (2 << RVC_C1_RD_OPOFF) &&
+	       (code & (BIT(12) | GENMASK(6, 2))) != 0;
+}
+
+static __always_inline bool riscv_insn_is_c_lui(u32 code)
+{
+	return (code & RVC_MASK_C_LUI) == RVC_MATCH_C_LUI &&
+	       (code & RVC_INSN_J_RS1_MASK) != (2 << RVC_C1_RD_OPOFF) &&
+	       (code & (BIT(12) | GENMASK(6, 2))) != 0;
+}
+
 #define RV_IMM_SIGN(x) (-(((x) >> 31) & 1))
 #define RVC_IMM_SIGN(x) (-(((x) >> 12) & 1))
 #define RV_X(X, s, mask)  (((X) >> (s)) & (mask))
@@ -92,6 +92,7 @@ extern struct kvm_device_ops kvm_riscv_aia_device_ops;
 
 void kvm_riscv_vcpu_aia_imsic_release(struct kvm_vcpu *vcpu);
 int kvm_riscv_vcpu_aia_imsic_update(struct kvm_vcpu *vcpu);
+bool kvm_riscv_vcpu_aia_imsic_has_interrupt(struct kvm_vcpu *vcpu);
 
 #define KVM_RISCV_AIA_IMSIC_TOPEI	(ISELECT_MASK + 1)
 int kvm_riscv_vcpu_aia_imsic_rmw(struct kvm_vcpu *vcpu, unsigned long isel,
@@ -103,6 +104,9 @@ int kvm_riscv_aia_imsic_has_attr(struct kvm *kvm, unsigned long type);
 void kvm_riscv_vcpu_aia_imsic_reset(struct kvm_vcpu *vcpu);
 int kvm_riscv_vcpu_aia_imsic_inject(struct kvm_vcpu *vcpu,
 				    u32 guest_index, u32 offset, u32 iid);
+int kvm_riscv_vcpu_aia_imsic_inject_ids(struct kvm_vcpu *vcpu,
+					u32 guest_index, const u32 *iids,
+					unsigned int nr);
 int kvm_riscv_vcpu_aia_imsic_init(struct kvm_vcpu *vcpu);
 void kvm_riscv_vcpu_aia_imsic_cleanup(struct kvm_vcpu *vcpu);
 
@@ -153,6 +157,9 @@ void kvm_riscv_vcpu_aia_reset(struct kvm_vcpu *vcpu);
 int kvm_riscv_vcpu_aia_init(struct kvm_vcpu *vcpu);
 void kvm_riscv_vcpu_aia_deinit(struct kvm_vcpu *vcpu);
 
+int kvm_riscv_aia_inject_msis_by_id(struct kvm *kvm, u32 hart_index,
+				    u32 guest_index, const u32 *iids,
+				    unsigned int nr);
 int kvm_riscv_aia_inject_msi_by_id(struct kvm *kvm, u32 hart_index,
 				   u32 guest_index, u32 iid);
 int kvm_riscv_aia_inject_msi(struct kvm *kvm, struct kvm_msi *msi);
@@ -30,6 +30,8 @@
 
 #define KVM_IRQCHIP_NUM_PINS		1024
 
+#define KVM_HAVE_MMU_RWLOCK
+
 #define KVM_REQ_SLEEP \
 	KVM_ARCH_REQ_FLAGS(0, KVM_REQUEST_WAIT | KVM_REQUEST_NO_WAKEUP)
 #define KVM_REQ_VCPU_RESET		KVM_ARCH_REQ(1)
@@ -42,6 +44,9 @@
 #define KVM_REQ_HFENCE			\
 	KVM_ARCH_REQ_FLAGS(5, KVM_REQUEST_WAIT | KVM_REQUEST_NO_WAKEUP)
 #define KVM_REQ_STEAL_UPDATE		KVM_ARCH_REQ(6)
+#define KVM_REQ_APF_READY		KVM_ARCH_REQ(7)
+
+#define ASYNC_PF_PER_VCPU		64
 
 enum kvm_riscv_hfence_type {
 	KVM_RISCV_HFENCE_UNKNOWN = 0,
@@ -59,7 +64,7 @@ struct kvm_riscv_hfence {
 	gpa_t size;
 };
 
-#define KVM_RISCV_VCPU_MAX_HFENCE	64
+#define KVM_RISCV_VCPU_MAX_HFENCE	128
 
 struct kvm_vm_stat {
 	struct kvm_vm_stat_generic generic;
@@ -71,10 +76,30 @@ struct kvm_vcpu_stat {
 	u64 wfi_exit_stat;
 	u64 mmio_exit_user;
 	u64 mmio_exit_kernel;
+	u64 mmio_insn_fetch;
 	u64 csr_exit_user;
 	u64 csr_exit_kernel;
 	u64 signal_exits;
 	u64 exits;
+	u64 hfence_merged;
+	u64 hfence_queue_full;
+	u64 wfi_wakeup_hist[HALT_POLL_HIST_COUNT];
+	/* Indexed by KVM_RISCV_SBI_EXT_*, the base extension goes last */
+	u64 sbi_ext_hist[KVM_RISCV_SBI_EXT_MAX + 1];
+	u64 sbi_unsupported;
+	u64 gstage_fault_load;
+	u64 gstage_fault_store;
+	u64 gstage_fault_exec;
+	u64 gstage_fault_dirty_log;
+	u64 fence_i_rcvd;
+	u64 hfence_gvma_vmid_all;
+	u64 hfence_gvma_vmid_gpa;
+	u64 hfence_vvma_all;
+	u64 hfence_vvma_asid_gva;
+	u64 hfence_vvma_asid_all;
+	u64 hfence_vvma_gva;
+	u64 imsic_swfile_fallback;
+	u64 imsic_swfile_emul;
 };
 
 struct kvm_arch_memory_slot {
@@ -97,11 +122,20 @@ struct kvm_arch {
 	pgd_t *pgd;
 	phys_addr_t pgd_phys;
 
+	/*
+	 * Page table pages for eagerly splitting huge G-stage mappings when
+	 * dirty logging is enabled. Only used under kvm->slots_lock.
+	 */
+	struct kvm_mmu_memory_cache split_page_cache;
+
 	/* Guest Timer */
 	struct kvm_guest_timer timer;
 
 	/* AIA Guest/VM context */
 	struct kvm_aia aia;
+
+	/* KVM_RISCV_*_VM */
+	unsigned long vm_type;
 };
 
 struct kvm_cpu_trap {
@@ -203,9 +237,25 @@ struct kvm_vcpu_arch {
 	/* CPU context of Guest VCPU */
 	struct kvm_cpu_context guest_context;
 
+	/*
+	 * Guest FP and vector registers are loaded on first use after
+	 * kvm_arch_vcpu_load(); until then the guest sstatus.FS/VS are
+	 * kept here and the guest runs with them Off.
+	 */
+	unsigned long guest_fs;
+	unsigned long guest_vs;
+	bool guest_fp_loaded;
+	bool guest_vector_loaded;
+
 	/* CPU CSR context of Guest VCPU */
 	struct kvm_vcpu_csr guest_csr;
 
+	/*
+	 * Host CPU whose VS CSRs held guest_csr and cfg at the last put,
+	 * -1 once either has been changed in memory.
+	 */
+	int csr_cpu;
+
 	/* CPU Smstateen CSR context of Guest VCPU */
 	struct kvm_vcpu_smstateen_csr smstateen_csr;
 
@@ -258,6 +308,9 @@ struct kvm_vcpu_arch {
 	/* Don't run the VCPU (blocked) */
 	bool pause;
 
+	/* Kicked through SBI PVLOCK, wakes the VCPU from its next WFI */
+	bool pvlock_kicked;
+
 	/* Performance monitoring context */
 	struct kvm_pmu pmu_context;
 
@@ -269,6 +322,19 @@ struct kvm_vcpu_arch {
 		gpa_t shmem;
 		u64 last_steal;
 	} sta;
+
+	/* SBI asynchronous page faults */
+	struct {
+		gpa_t shmem;
+		u32 id;
+	} apf;
+};
+
+struct kvm_arch_async_pf {
+	u32 token;
+	/* The fault redirected to the guest while the page is brought in */
+	unsigned long scause;
+	unsigned long stval;
 };
 
 static inline void kvm_arch_sync_events(struct kvm *kvm) {}
@@ -331,7 +397,11 @@ void kvm_riscv_gstage_iounmap(struct kvm *kvm, gpa_t gpa,
 			      unsigned long size);
 int kvm_riscv_gstage_map(struct kvm_vcpu *vcpu,
 			 struct kvm_memory_slot *memslot,
-			 gpa_t gpa, unsigned long hva, bool is_write);
+			 gpa_t gpa, unsigned long hva, bool is_write,
+			 struct kvm_cpu_trap *trap);
+int kvm_riscv_gstage_gmem_map(struct kvm_vcpu *vcpu,
+			      struct kvm_memory_slot *memslot,
+			      gpa_t gpa, bool is_write, bool is_exec);
 int kvm_riscv_gstage_alloc_pgd(struct kvm *kvm);
 void kvm_riscv_gstage_free_pgd(struct kvm *kvm);
 void kvm_riscv_gstage_update_hgatp(struct kvm_vcpu *vcpu);
@@ -368,6 +438,8 @@ int kvm_riscv_vcpu_get_reg(struct kvm_vcpu *vcpu,
 			   const struct kvm_one_reg *reg);
 int kvm_riscv_vcpu_set_reg(struct kvm_vcpu *vcpu,
 			   const struct kvm_one_reg *reg);
+void kvm_riscv_vcpu_sync_regs(struct kvm_vcpu *vcpu);
+void kvm_riscv_vcpu_store_regs(struct kvm_vcpu *vcpu);
 
 int kvm_riscv_vcpu_set_interrupt(struct kvm_vcpu *vcpu, unsigned int irq);
 int kvm_riscv_vcpu_unset_interrupt(struct kvm_vcpu *vcpu, unsigned int irq);
@@ -377,7 +449,29 @@ bool kvm_riscv_vcpu_has_interrupts(struct kvm_vcpu *vcpu, u64 mask);
 void kvm_riscv_vcpu_power_off(struct kvm_vcpu *vcpu);
 void kvm_riscv_vcpu_power_on(struct kvm_vcpu *vcpu);
 
+void kvm_riscv_vcpu_forget_former(void);
+
 void kvm_riscv_vcpu_sbi_sta_reset(struct kvm_vcpu *vcpu);
+void kvm_riscv_vcpu_sbi_apf_reset(struct kvm_vcpu *vcpu);
+bool kvm_riscv_vcpu_apf_can_inject(struct kvm_vcpu *vcpu);
+bool kvm_riscv_vcpu_apf_setup(struct kvm_vcpu *vcpu, struct kvm_cpu_trap *trap,
+			      gpa_t gpa, unsigned long hva);
+
+bool kvm_arch_async_page_not_present(struct kvm_vcpu *vcpu,
+				     struct kvm_async_pf *work);
+void kvm_arch_async_page_present(struct kvm_vcpu *vcpu,
+				 struct kvm_async_pf *work);
+void kvm_arch_async_page_ready(struct kvm_vcpu *vcpu,
+			       struct kvm_async_pf *work);
+void kvm_arch_async_page_present_queued(struct kvm_vcpu *vcpu);
+bool kvm_arch_can_dequeue_async_page_present(struct kvm_vcpu *vcpu);
 void kvm_riscv_vcpu_record_steal_time(struct kvm_vcpu *vcpu);
+void kvm_riscv_vcpu_set_preempted(struct kvm_vcpu *vcpu);
+
+#ifdef CONFIG_KVM_PRIVATE_MEM
+#define kvm_arch_has_private_mem(kvm) ((kvm)->arch.vm_type != KVM_RISCV_DEFAULT_VM)
+#else
+#define kvm_arch_has_private_mem(kvm) false
+#endif
 
 #endif /* __RISCV_KVM_HOST_H__ */
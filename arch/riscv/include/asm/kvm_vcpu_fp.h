@@ -27,10 +27,23 @@ void kvm_riscv_vcpu_guest_fp_restore(struct kvm_cpu_context *cntx,
 				     const unsigned long *isa);
 void kvm_riscv_vcpu_host_fp_save(struct kvm_cpu_context *cntx);
 void kvm_riscv_vcpu_host_fp_restore(struct kvm_cpu_context *cntx);
+void kvm_riscv_vcpu_fp_load(struct kvm_vcpu *vcpu);
+void kvm_riscv_vcpu_fp_put(struct kvm_vcpu *vcpu);
+bool kvm_riscv_vcpu_fp_trap(struct kvm_vcpu *vcpu);
 #else
 static inline void kvm_riscv_vcpu_fp_reset(struct kvm_vcpu *vcpu)
 {
 }
+static inline void kvm_riscv_vcpu_fp_load(struct kvm_vcpu *vcpu)
+{
+}
+static inline void kvm_riscv_vcpu_fp_put(struct kvm_vcpu *vcpu)
+{
+}
+static inline bool kvm_riscv_vcpu_fp_trap(struct kvm_vcpu *vcpu)
+{
+	return false;
+}
 static inline void kvm_riscv_vcpu_guest_fp_save(struct kvm_cpu_context *cntx,
 						const unsigned long *isa)
 {
@@ -33,6 +33,9 @@ void kvm_riscv_vcpu_guest_vector_restore(struct kvm_cpu_context *cntx,
 					 unsigned long *isa);
 void kvm_riscv_vcpu_host_vector_save(struct kvm_cpu_context *cntx);
 void kvm_riscv_vcpu_host_vector_restore(struct kvm_cpu_context *cntx);
+void kvm_riscv_vcpu_vector_load(struct kvm_vcpu *vcpu);
+void kvm_riscv_vcpu_vector_put(struct kvm_vcpu *vcpu);
+bool kvm_riscv_vcpu_vector_trap(struct kvm_vcpu *vcpu);
 int kvm_riscv_vcpu_alloc_vector_context(struct kvm_vcpu *vcpu,
 					struct kvm_cpu_context *cntx);
 void kvm_riscv_vcpu_free_vector_context(struct kvm_vcpu *vcpu);
@@ -62,6 +65,19 @@ static inline void kvm_riscv_vcpu_host_vector_restore(struct kvm_cpu_context *cn
 {
 }
 
+static inline void kvm_riscv_vcpu_vector_load(struct kvm_vcpu *vcpu)
+{
+}
+
+static inline void kvm_riscv_vcpu_vector_put(struct kvm_vcpu *vcpu)
+{
+}
+
+static inline bool kvm_riscv_vcpu_vector_trap(struct kvm_vcpu *vcpu)
+{
+	return false;
+}
+
 static inline int kvm_riscv_vcpu_alloc_vector_context(struct kvm_vcpu *vcpu,
 						      struct kvm_cpu_context *cntx)
 {
@@ -9,6 +9,8 @@
 
 #ifndef __ASSEMBLY__
 
+struct misaligned_report;
+
 typedef struct {
 #ifndef CONFIG_MMU
 	unsigned long	end_brk;
@@ -24,6 +26,10 @@ typedef struct {
 	unsigned long exec_fdpic_loadmap;
 	unsigned long interp_fdpic_loadmap;
 #endif
+#ifdef CONFIG_RISCV_MISALIGNED
+	/* Most frequent pcs of reported misaligned accesses */
+	struct misaligned_report *misaligned_report;
+#endif
 } mm_context_t;
 
 void __init create_pgd_mapping(pgd_t *pgdp, uintptr_t va, phys_addr_t pa,
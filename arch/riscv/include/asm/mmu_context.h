@@ -13,6 +13,8 @@
 #include <linux/mm.h>
 #include <linux/sched.h>
 
+#include <asm/cpufeature.h>
+
 void switch_mm(struct mm_struct *prev, struct mm_struct *next,
 	struct task_struct *task);
 
@@ -29,10 +31,19 @@ static inline int init_new_context(struct task_struct *tsk,
 {
 #ifdef CONFIG_MMU
 	atomic_long_set(&mm->context.id, 0);
+#endif
+#ifdef CONFIG_RISCV_MISALIGNED
+	mm->context.misaligned_report = NULL;
 #endif
 	return 0;
 }
 
+#define destroy_context destroy_context
+static inline void destroy_context(struct mm_struct *mm)
+{
+	misaligned_report_free(mm);
+}
+
 DECLARE_STATIC_KEY_FALSE(use_asid_allocator);
 
 #include <asm-generic/mmu_context.h>
@@ -46,14 +46,21 @@
 
 #ifdef CONFIG_RISCV_ISA_ZICBOZ
 void clear_page(void *page);
+/* Clears npages physically contiguous pages, e.g. a huge page. */
+void clear_pages(void *addr, unsigned int npages);
 #else
 #define clear_page(pgaddr)			memset((pgaddr), 0, PAGE_SIZE)
+#define clear_pages(addr, npages) \
+			memset((addr), 0, (size_t)(npages) << PAGE_SHIFT)
 #endif
+#ifdef CONFIG_RISCV_ISA_V
+void copy_page(void *to, void *from);
+#else
 #define copy_page(to, from)			memcpy((to), (from), PAGE_SIZE)
+#endif
 
 #define clear_user_page(pgaddr, vaddr, page)	clear_page(pgaddr)
-#define copy_user_page(vto, vfrom, vaddr, topg) \
-			memcpy((vto), (vfrom), PAGE_SIZE)
+#define copy_user_page(vto, vfrom, vaddr, topg)	copy_page(vto, vfrom)
 
 /*
  * Use struct definitions to apply C type checking
@@ -3,6 +3,7 @@
 #define _ASM_RISCV_PARAVIRT_H
 
 #ifdef CONFIG_PARAVIRT
+#include <linux/jump_label.h>
 #include <linux/static_call_types.h>
 
 struct static_key;
@@ -18,11 +19,52 @@ static inline u64 paravirt_steal_clock(int cpu)
 	return static_call(pv_steal_clock)(cpu);
 }
 
+bool dummy_vcpu_is_preempted(int cpu);
+
+DECLARE_STATIC_CALL(pv_vcpu_is_preempted, dummy_vcpu_is_preempted);
+
+static inline bool paravirt_vcpu_is_preempted(int cpu)
+{
+	return static_call(pv_vcpu_is_preempted)(cpu);
+}
+
 int __init pv_time_init(void);
 
+struct pt_regs;
+
+DECLARE_STATIC_KEY_FALSE(pv_apf_enabled);
+
+bool __pv_apf_page_not_present(struct pt_regs *regs);
+void __pv_apf_page_ready(void);
+
+static __always_inline bool pv_apf_page_not_present(struct pt_regs *regs)
+{
+	if (static_branch_unlikely(&pv_apf_enabled))
+		return __pv_apf_page_not_present(regs);
+	return false;
+}
+
+static __always_inline void pv_apf_page_ready(void)
+{
+	if (static_branch_unlikely(&pv_apf_enabled))
+		__pv_apf_page_ready();
+}
+
+void __init pv_apf_init(void);
+
 #else
 
 #define pv_time_init() do {} while (0)
 
+struct pt_regs;
+
+static inline bool pv_apf_page_not_present(struct pt_regs *regs)
+{
+	return false;
+}
+
+static inline void pv_apf_page_ready(void) {}
+static inline void pv_apf_init(void) {}
+
 #endif /* CONFIG_PARAVIRT */
 #endif /* _ASM_RISCV_PARAVIRT_H */
@@ -12,6 +12,9 @@
 
 #include <vdso/processor.h>
 
+#include <asm/alternative-macros.h>
+#include <asm/hwcap.h>
+#include <asm/insn-def.h>
 #include <asm/ptrace.h>
 
 /*
@@ -119,9 +122,17 @@ struct thread_struct {
 	unsigned long bad_cause;
 	u32 riscv_v_flags;
 	u32 vstate_ctrl;
+	/* Context switches and syscalls seen without user space using V */
+	u32 vstate_idle;
+	/* A syscall clobbered the V registers since they matched vstate */
+	bool vstate_discarded;
 	struct __riscv_v_ext_state vstate;
 	unsigned long align_ctl;
+	/* Misaligned accesses emulated on behalf of the task */
+	unsigned long misaligned_count;
 	struct __riscv_v_ext_state kernel_vstate;
+	/* CPU whose vector registers last matched kernel_vstate */
+	unsigned int kernel_vstate_cpu;
 };
 
 /* Whitelist the fstate from the task_struct for hardened usercopy */
@@ -157,6 +168,28 @@ static inline void wait_for_interrupt(void)
 	__asm__ __volatile__ ("wfi");
 }
 
+#define PREFETCH_ASM(x)							\
+	ALTERNATIVE("nop", PREFETCH_R(x, 0), 0,			\
+		    RISCV_ISA_EXT_ZICBOP, CONFIG_RISCV_ISA_ZICBOP)
+
+#define PREFETCHW_ASM(x)						\
+	ALTERNATIVE("nop", PREFETCH_W(x, 0), 0,			\
+		    RISCV_ISA_EXT_ZICBOP, CONFIG_RISCV_ISA_ZICBOP)
+
+#ifdef CONFIG_RISCV_ISA_ZICBOP
+#define ARCH_HAS_PREFETCH
+static inline void prefetch(const void *x)
+{
+	__asm__ __volatile__(PREFETCH_ASM(%0) : : "r" (x) : "memory");
+}
+
+#define ARCH_HAS_PREFETCHW
+static inline void prefetchw(const void *x)
+{
+	__asm__ __volatile__(PREFETCHW_ASM(%0) : : "r" (x) : "memory");
+}
+#endif /* CONFIG_RISCV_ISA_ZICBOP */
+
 extern phys_addr_t dma32_phys_limit;
 
 struct device_node;
@@ -33,6 +33,7 @@ enum sbi_ext_id {
 	SBI_EXT_PMU = 0x504D55,
 	SBI_EXT_DBCN = 0x4442434E,
 	SBI_EXT_STA = 0x535441,
+	SBI_EXT_FWFT = 0x46574654,
 
 	/* Experimentals extensions must lie within this range */
 	SBI_EXT_EXPERIMENTAL_START = 0x08000000,
@@ -41,6 +42,10 @@ enum sbi_ext_id {
 	/* Vendor extensions must lie within this range */
 	SBI_EXT_VENDOR_START = 0x09000000,
 	SBI_EXT_VENDOR_END = 0x09FFFFFF,
+
+	/* Paravirt extensions implemented by KVM, not in the SBI spec */
+	SBI_EXT_PVLOCK = 0x09AB0401,
+	SBI_EXT_APF = 0x09AB0402,
 };
 
 enum sbi_ext_base_fid {
@@ -131,6 +136,8 @@ enum sbi_ext_pmu_fid {
 	SBI_EXT_PMU_COUNTER_START,
 	SBI_EXT_PMU_COUNTER_STOP,
 	SBI_EXT_PMU_COUNTER_FW_READ,
+	SBI_EXT_PMU_COUNTER_FW_READ_HI,
+	SBI_EXT_PMU_SNAPSHOT_SET_SHMEM,
 };
 
 union sbi_pmu_ctr_info {
@@ -243,9 +250,18 @@ enum sbi_pmu_ctr_type {
 
 /* Flags defined for counter start function */
 #define SBI_PMU_START_FLAG_SET_INIT_VALUE (1 << 0)
+#define SBI_PMU_START_FLAG_INIT_SNAPSHOT (1 << 1)
 
 /* Flags defined for counter stop function */
 #define SBI_PMU_STOP_FLAG_RESET (1 << 0)
+#define SBI_PMU_STOP_FLAG_TAKE_SNAPSHOT (1 << 1)
+
+/* Data structure to contain the pmu snapshot data */
+struct riscv_pmu_snapshot_data {
+	u64 ctr_overflow_mask;
+	u64 ctr_values[64];
+	u64 reserved[447];
+};
 
 enum sbi_ext_dbcn_fid {
 	SBI_EXT_DBCN_CONSOLE_WRITE = 0,
@@ -268,6 +284,54 @@ struct sbi_sta_struct {
 
 #define SBI_STA_SHMEM_DISABLE		-1
 
+/* SBI FWFT (firmware features) extension */
+enum sbi_ext_fwft_fid {
+	SBI_EXT_FWFT_SET = 0,
+	SBI_EXT_FWFT_GET,
+};
+
+enum sbi_fwft_feature_t {
+	SBI_FWFT_MISALIGNED_EXC_DELEG		= 0x0,
+	SBI_FWFT_LANDING_PAD			= 0x1,
+	SBI_FWFT_SHADOW_STACK			= 0x2,
+	SBI_FWFT_DOUBLE_TRAP			= 0x3,
+	SBI_FWFT_PTE_AD_HW_UPDATING		= 0x4,
+	SBI_FWFT_POINTER_MASKING_PMLEN		= 0x5,
+};
+
+#define SBI_FWFT_SET_FLAG_LOCK		BIT(0)
+
+/* SBI PVLOCK (paravirt spinlock) extension, only provided by KVM */
+enum sbi_ext_pvlock_fid {
+	SBI_EXT_PVLOCK_KICK_CPU = 0,
+};
+
+/* SBI APF (asynchronous page fault) extension, only provided by KVM */
+enum sbi_ext_apf_fid {
+	SBI_EXT_APF_SET_SHMEM = 0,
+	SBI_EXT_APF_READY_ACK,
+};
+
+/*
+ * flags and token describe the page fault last redirected to the guest,
+ * ready_token the page that became ready. The guest clears flags when it
+ * takes the fault, and ready_token before acknowledging it.
+ */
+struct sbi_apf_struct {
+	__le32 flags;
+	__le32 token;
+	__le32 ready_token;
+	u8 pad[52];
+} __packed;
+
+#define SBI_APF_PAGE_NOT_PRESENT	BIT(0)
+
+/* ready_token asking the guest to wake up every waiting task */
+#define SBI_APF_WAKE_ALL		0xffffffff
+
+/* Used by the set_shmem functions of SBI v2.0 extensions to disable the area */
+#define SBI_SHMEM_DISABLE		-1
+
 /* SBI spec version fields */
 #define SBI_SPEC_VERSION_DEFAULT	0x1
 #define SBI_SPEC_VERSION_MAJOR_SHIFT	24
@@ -284,6 +348,7 @@ struct sbi_sta_struct {
 #define SBI_ERR_ALREADY_AVAILABLE -6
 #define SBI_ERR_ALREADY_STARTED -7
 #define SBI_ERR_ALREADY_STOPPED -8
+#define SBI_ERR_NO_SHMEM	-9
 
 extern unsigned long sbi_spec_version;
 struct sbiret {
@@ -310,6 +375,7 @@ long sbi_get_mimpid(void);
 void sbi_set_timer(uint64_t stime_value);
 void sbi_shutdown(void);
 void sbi_send_ipi(unsigned int cpu);
+void sbi_send_ipi_mask(const struct cpumask *cpu_mask);
 int sbi_remote_fence_i(const struct cpumask *cpu_mask);
 
 int sbi_remote_sfence_vma_asid(const struct cpumask *cpu_mask,
@@ -365,9 +431,13 @@ extern bool sbi_debug_console_available;
 int sbi_debug_console_write(const char *bytes, unsigned int num_bytes);
 int sbi_debug_console_read(char *bytes, unsigned int num_bytes);
 
+int sbi_fwft_set(u32 feature, unsigned long value, unsigned long flags);
+
 #else /* CONFIG_RISCV_SBI */
 static inline int sbi_remote_fence_i(const struct cpumask *cpu_mask) { return -1; }
 static inline void sbi_init(void) {}
+static inline int sbi_fwft_set(u32 feature, unsigned long value,
+			       unsigned long flags) { return -EOPNOTSUPP; }
 #endif /* CONFIG_RISCV_SBI */
 
 unsigned long riscv_cached_mvendorid(unsigned int cpu_id);
@@ -52,6 +52,21 @@ static __must_check inline bool may_use_simd(void)
 	return !irqs_disabled() && !(riscv_v_flags() & RISCV_KERNEL_MODE_V);
 }
 
+/*
+ * riscv_v_kernel_preemptible - whether kernel_vector_begin() would currently
+ *                              leave preemption enabled
+ *
+ * If so, callers that process a lot of data gain nothing in scheduling latency
+ * by splitting it into several kernel-mode vector sections, as long as they
+ * don't sleep while the vector unit is held.
+ */
+static __must_check inline bool riscv_v_kernel_preemptible(void)
+{
+	return IS_ENABLED(CONFIG_RISCV_ISA_V_PREEMPTIVE) &&
+	       current->thread.kernel_vstate.datap &&
+	       !riscv_preempt_v_started(current);
+}
+
 #else /* ! CONFIG_RISCV_ISA_V */
 
 static __must_check inline bool may_use_simd(void)
@@ -59,6 +74,11 @@ static __must_check inline bool may_use_simd(void)
 	return false;
 }
 
+static __must_check inline bool riscv_v_kernel_preemptible(void)
+{
+	return false;
+}
+
 #endif /* ! CONFIG_RISCV_ISA_V */
 
 #endif
@@ -15,6 +15,14 @@
 struct seq_file;
 extern unsigned long boot_cpu_hartid;
 
+/* Kinds of remote fences with separately measured IPI and SBI costs */
+enum riscv_rfence_kind {
+	RISCV_RFENCE_TLB_RANGE,
+	RISCV_RFENCE_TLB_ALL,
+	RISCV_RFENCE_ICACHE,
+	RISCV_RFENCE_NR_KINDS,
+};
+
 #ifdef CONFIG_SMP
 
 #include <linux/jump_label.h>
@@ -56,6 +64,9 @@ DECLARE_STATIC_KEY_FALSE(riscv_ipi_for_rfence);
 #define riscv_use_ipi_for_rfence() \
 	static_branch_unlikely(&riscv_ipi_for_rfence)
 
+/* Pick IPIs or SBI RFENCE for a remote fence targeting @cmask (NULL: all) */
+bool riscv_rfence_use_ipi(enum riscv_rfence_kind kind, const struct cpumask *cmask);
+
 /* Check other CPUs stop or not */
 bool smp_crash_stop_failed(void);
 
@@ -114,6 +125,12 @@ static inline bool riscv_use_ipi_for_rfence(void)
 	return false;
 }
 
+static inline bool riscv_rfence_use_ipi(enum riscv_rfence_kind kind,
+					const struct cpumask *cmask)
+{
+	return false;
+}
+
 #endif /* CONFIG_SMP */
 
 #if defined(CONFIG_HOTPLUG_CPU) && (CONFIG_SMP)
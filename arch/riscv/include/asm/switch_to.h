@@ -9,6 +9,7 @@
 #include <linux/jump_label.h>
 #include <linux/sched/task_stack.h>
 #include <asm/vector.h>
+#include <asm/cacheflush.h>
 #include <asm/cpufeature.h>
 #include <asm/processor.h>
 #include <asm/ptrace.h>
@@ -83,6 +84,24 @@ static __always_inline bool has_fpu(void) { return false; }
 #define __switch_to_fpu(__prev, __next) do { } while (0)
 #endif
 
+/*
+ * switch_mm() returns early for a thread moving to a hart that already runs
+ * its MM, so it never sees the stale bit a local flush on the old hart left
+ * behind.  Catch up here, only when that bit is actually set.  The atomic
+ * test-and-clear orders the bit against the fence.i, as the barrier does in
+ * flush_icache_deferred().
+ */
+static inline void __switch_to_icache(struct task_struct *next)
+{
+#ifdef CONFIG_SMP
+	struct mm_struct *mm = next->mm;
+
+	if (mm && unlikely(cpumask_test_and_clear_cpu(smp_processor_id(),
+						      &mm->context.icache_stale_mask)))
+		local_flush_icache_all();
+#endif
+}
+
 extern struct task_struct *__switch_to(struct task_struct *,
 				       struct task_struct *);
 
@@ -94,6 +113,7 @@ do {							\
 		__switch_to_fpu(__prev, __next);	\
 	if (has_vector())					\
 		__switch_to_vector(__prev, __next);	\
+	__switch_to_icache(__next);			\
 	((last) = __switch_to(__prev, __next));		\
 } while (0)
 
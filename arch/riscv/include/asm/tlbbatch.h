@@ -8,8 +8,22 @@
 
 #include <linux/cpumask.h>
 
+/*
+ * Number of (asid, start, end) ranges recorded by a batch before the ranges
+ * are flushed and the batch starts over.
+ */
+#define ARCH_TLBBATCH_NR_RANGES	8
+
+struct arch_tlbflush_unmap_range {
+	unsigned long asid;
+	unsigned long start;
+	unsigned long end;
+};
+
 struct arch_tlbflush_unmap_batch {
 	struct cpumask cpumask;
+	unsigned int nr_ranges;
+	struct arch_tlbflush_unmap_range ranges[ARCH_TLBBATCH_NR_RANGES];
 };
 
 #endif /* _ASM_RISCV_TLBBATCH_H */
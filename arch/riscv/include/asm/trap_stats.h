@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Per-CPU counts and time spent in SBI calls and in trap handlers.
+ *
+ * Accounting is off by default and enabled at runtime through
+ * debugfs (riscv_trap_stats/enable), so that the hooks cost a single
+ * static branch otherwise.
+ */
+
+#ifndef _ASM_RISCV_TRAP_STATS_H
+#define _ASM_RISCV_TRAP_STATS_H
+
+#include <linux/jump_label.h>
+#include <asm/csr.h>
+#include <asm/timex.h>
+
+/* Exception causes, plus the illegal instructions that were V first-use. */
+#define RISCV_TRAP_STATS_V_FIRST_USE	(EXC_STORE_GUEST_PAGE_FAULT + 1)
+#define RISCV_TRAP_STATS_NR_CAUSES	(RISCV_TRAP_STATS_V_FIRST_USE + 1)
+
+#ifdef CONFIG_DEBUG_FS
+
+DECLARE_STATIC_KEY_FALSE(riscv_trap_stats_enabled);
+
+void __riscv_sbi_stats_account(int ext, int fid, u64 ticks);
+void __riscv_trap_stats_account(unsigned long cause, u64 ticks);
+
+static __always_inline u64 riscv_trap_stats_start(void)
+{
+	if (static_branch_unlikely(&riscv_trap_stats_enabled))
+		return get_cycles64();
+
+	return 0;
+}
+
+/*
+ * A zero start means accounting was enabled in between, the sample is
+ * then dropped.
+ */
+static __always_inline void riscv_sbi_stats_end(int ext, int fid, u64 start)
+{
+	if (static_branch_unlikely(&riscv_trap_stats_enabled) && start)
+		__riscv_sbi_stats_account(ext, fid, get_cycles64() - start);
+}
+
+static __always_inline void riscv_trap_stats_end(unsigned long cause, u64 start)
+{
+	if (static_branch_unlikely(&riscv_trap_stats_enabled) && start)
+		__riscv_trap_stats_account(cause, get_cycles64() - start);
+}
+
+#else
+
+static inline u64 riscv_trap_stats_start(void) { return 0; }
+static inline void riscv_sbi_stats_end(int ext, int fid, u64 start) { }
+static inline void riscv_trap_stats_end(unsigned long cause, u64 start) { }
+
+#endif /* CONFIG_DEBUG_FS */
+
+#endif /* _ASM_RISCV_TRAP_STATS_H */
@@ -2,16 +2,37 @@
 #ifndef __RISCV_ASM_VDSO_DATA_H
 #define __RISCV_ASM_VDSO_DATA_H
 
+#include <linux/threads.h>
 #include <linux/types.h>
 #include <vdso/datapage.h>
 #include <asm/hwprobe.h>
 
+/* Distinct per-CPU hwprobe answer sets the vDSO can hold */
+#define RISCV_VDSO_HWPROBE_NR_CLASSES	8
+/* cpu_hwprobe_class[] value for offline (or not yet probed) CPUs */
+#define RISCV_VDSO_HWPROBE_NO_CLASS	0xff
+
 struct arch_vdso_data {
-	/* Stash static answers to the hwprobe queries when all CPUs are selected. */
-	__u64 all_cpu_hwprobe_values[RISCV_HWPROBE_MAX_KEY + 1];
+	/*
+	 * Stash static answers to the hwprobe queries when all CPUs are
+	 * selected, indexed by riscv_hwprobe_key_slot().
+	 */
+	__u64 all_cpu_hwprobe_values[RISCV_HWPROBE_NR_SLOTS];
 
 	/* Boolean indicating all CPUs have the same static hwprobe values. */
 	__u8 homogeneous_cpus;
+
+	/*
+	 * Boolean indicating cpu_hwprobe_class[] is complete for the online
+	 * CPUs, so that the vDSO can answer queries for arbitrary masks.
+	 */
+	__u8 cpu_classes_valid;
+
+	/* Index into class_hwprobe_values[] of each online CPU. */
+	__u8 cpu_hwprobe_class[NR_CPUS];
+
+	/* Answers to every key for a single CPU of each class. */
+	__u64 class_hwprobe_values[RISCV_VDSO_HWPROBE_NR_CLASSES][RISCV_HWPROBE_NR_SLOTS];
 };
 
 #endif /* __RISCV_ASM_VDSO_DATA_H */
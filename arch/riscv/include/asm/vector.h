@@ -20,6 +20,7 @@
 #include <asm/asm.h>
 
 extern unsigned long riscv_v_vsize;
+extern unsigned int riscv_v_idle_threshold;
 int riscv_v_setup_vsize(void);
 bool riscv_v_first_use_handler(struct pt_regs *regs);
 void kernel_vector_begin(void);
@@ -100,6 +101,22 @@ static __always_inline void __vstate_csr_restore(struct __riscv_v_ext_state *src
 		    "r" (src->vcsr) :);
 }
 
+#ifdef CONFIG_RISCV_ISA_V_PREEMPTIVE
+/*
+ * The preempt_v context whose saved copy still matches this CPU's vector
+ * registers, if any. It lets a preempted task skip reloading its kernel
+ * vector state when no one else touched V on this CPU in the meantime.
+ */
+DECLARE_PER_CPU(struct __riscv_v_ext_state *, riscv_v_kernel_live_vstate);
+
+static __always_inline void riscv_preempt_v_drop_live(void)
+{
+	this_cpu_write(riscv_v_kernel_live_vstate, NULL);
+}
+#else
+#define riscv_preempt_v_drop_live()	do {} while (0)
+#endif /* CONFIG_RISCV_ISA_V_PREEMPTIVE */
+
 static inline void __riscv_v_vstate_save(struct __riscv_v_ext_state *save_to,
 					 void *datap)
 {
@@ -128,6 +145,7 @@ static inline void __riscv_v_vstate_restore(struct __riscv_v_ext_state *restore_
 {
 	unsigned long vl;
 
+	riscv_preempt_v_drop_live();
 	riscv_v_enable();
 	asm volatile (
 		".option push\n\t"
@@ -150,6 +168,7 @@ static inline void __riscv_v_vstate_discard(void)
 {
 	unsigned long vl, vtype_inval = 1UL << (BITS_PER_LONG - 1);
 
+	riscv_preempt_v_drop_live();
 	riscv_v_enable();
 	asm volatile (
 		".option push\n\t"
@@ -165,13 +184,36 @@ static inline void __riscv_v_vstate_discard(void)
 	riscv_v_disable();
 }
 
+/*
+ * Track how long the user vector state has gone untouched. A clean VS
+ * proves that user space did not use V since the registers were last
+ * loaded or saved. A dirty VS proves that it did only if no syscall has
+ * discarded the registers in the meantime.
+ */
+static inline void riscv_v_vstate_account(struct task_struct *task,
+					  struct pt_regs *regs)
+{
+	switch (regs->status & SR_VS) {
+	case SR_VS_CLEAN:
+		if (task->thread.vstate_idle < U32_MAX)
+			task->thread.vstate_idle++;
+		break;
+	case SR_VS_DIRTY:
+		if (!task->thread.vstate_discarded)
+			task->thread.vstate_idle = 0;
+		break;
+	}
+}
+
 static inline void riscv_v_vstate_discard(struct pt_regs *regs)
 {
 	if ((regs->status & SR_VS) == SR_VS_OFF)
 		return;
 
+	riscv_v_vstate_account(current, regs);
 	__riscv_v_vstate_discard();
 	__riscv_v_vstate_dirty(regs);
+	current->thread.vstate_discarded = true;
 }
 
 static inline void riscv_v_vstate_save(struct __riscv_v_ext_state *vstate,
@@ -201,6 +243,44 @@ static inline void riscv_v_vstate_set_restore(struct task_struct *task,
 	}
 }
 
+/*
+ * A task that has not used V for riscv_v_idle_threshold observations is
+ * "parked": VS is turned off so that its registers are neither saved nor
+ * restored on context switch, while its last state is kept in vstate. The
+ * first-use trap, or anything that needs to look at the state, unparks it.
+ */
+static inline bool riscv_v_vstate_parked(struct task_struct *task,
+					 struct pt_regs *regs)
+{
+	return (regs->status & SR_VS) == SR_VS_OFF && task->thread.vstate.datap;
+}
+
+static inline void riscv_v_vstate_park(struct task_struct *task,
+				       struct pt_regs *regs)
+{
+	unsigned int threshold = READ_ONCE(riscv_v_idle_threshold);
+
+	if (!threshold || task->thread.vstate_idle < threshold)
+		return;
+
+	if ((regs->status & SR_VS) != SR_VS_CLEAN)
+		return;
+
+	riscv_v_vstate_off(regs);
+	task->thread.vstate_idle = 0;
+}
+
+static inline void riscv_v_vstate_unpark(struct task_struct *task,
+					 struct pt_regs *regs)
+{
+	if (!riscv_v_vstate_parked(task, regs))
+		return;
+
+	task->thread.vstate_idle = 0;
+	riscv_v_vstate_on(regs);
+	riscv_v_vstate_set_restore(task, regs);
+}
+
 #ifdef CONFIG_RISCV_ISA_V_PREEMPTIVE
 static inline bool riscv_preempt_v_dirty(struct task_struct *task)
 {
@@ -229,12 +309,26 @@ static inline bool riscv_preempt_v_started(struct task_struct *task)
 	return !!(task->thread.riscv_v_flags & RISCV_PREEMPT_V);
 }
 
+/* Called right after @task's preempt_v context was saved or restored */
+static inline void riscv_preempt_v_set_live(struct task_struct *task)
+{
+	this_cpu_write(riscv_v_kernel_live_vstate, &task->thread.kernel_vstate);
+	task->thread.kernel_vstate_cpu = smp_processor_id();
+}
+
+static inline bool riscv_preempt_v_live(struct task_struct *task)
+{
+	return this_cpu_read(riscv_v_kernel_live_vstate) == &task->thread.kernel_vstate &&
+	       task->thread.kernel_vstate_cpu == smp_processor_id();
+}
+
 #else /* !CONFIG_RISCV_ISA_V_PREEMPTIVE */
 static inline bool riscv_preempt_v_dirty(struct task_struct *task) { return false; }
 static inline bool riscv_preempt_v_restore(struct task_struct *task) { return false; }
 static inline bool riscv_preempt_v_started(struct task_struct *task) { return false; }
 #define riscv_preempt_v_clear_dirty(tsk)	do {} while (0)
 #define riscv_preempt_v_set_restore(tsk)	do {} while (0)
+#define riscv_preempt_v_set_live(tsk)		do {} while (0)
 #endif /* CONFIG_RISCV_ISA_V_PREEMPTIVE */
 
 static inline void __switch_to_vector(struct task_struct *prev,
@@ -247,10 +341,14 @@ static inline void __switch_to_vector(struct task_struct *prev,
 			__riscv_v_vstate_save(&prev->thread.kernel_vstate,
 					      prev->thread.kernel_vstate.datap);
 			riscv_preempt_v_clear_dirty(prev);
+			riscv_preempt_v_set_live(prev);
 		}
 	} else {
 		regs = task_pt_regs(prev);
+		riscv_v_vstate_account(prev, regs);
 		riscv_v_vstate_save(&prev->thread.vstate, regs);
+		prev->thread.vstate_discarded = false;
+		riscv_v_vstate_park(prev, regs);
 	}
 
 	if (riscv_preempt_v_started(next))
@@ -273,6 +371,7 @@ static inline bool riscv_v_vstate_query(struct pt_regs *regs) { return false; }
 static inline bool riscv_v_vstate_ctrl_user_allowed(void) { return false; }
 #define riscv_v_vsize (0)
 #define riscv_v_vstate_discard(regs)		do {} while (0)
+#define riscv_v_vstate_unpark(task, regs)	do {} while (0)
 #define riscv_v_vstate_save(vstate, regs)	do {} while (0)
 #define riscv_v_vstate_restore(vstate, regs)	do {} while (0)
 #define __switch_to_vector(__prev, __next)	do {} while (0)
@@ -48,12 +48,22 @@ static void xor_vector_5(unsigned long bytes, unsigned long *__restrict p1,
 	kernel_vector_end();
 }
 
+static void xor_vector_n(unsigned long bytes, unsigned long *__restrict p1,
+			 unsigned int src_count,
+			 const unsigned long * const *srcs)
+{
+	kernel_vector_begin();
+	xor_regs_n_(bytes, p1, src_count, srcs);
+	kernel_vector_end();
+}
+
 static struct xor_block_template xor_block_rvv = {
 	.name = "rvv",
 	.do_2 = xor_vector_2,
 	.do_3 = xor_vector_3,
 	.do_4 = xor_vector_4,
-	.do_5 = xor_vector_5
+	.do_5 = xor_vector_5,
+	.do_n = xor_vector_n
 };
 
 #undef XOR_TRY_TEMPLATES
@@ -67,6 +67,12 @@ struct riscv_hwprobe {
 #define		RISCV_HWPROBE_MISALIGNED_UNSUPPORTED	(4 << 0)
 #define		RISCV_HWPROBE_MISALIGNED_MASK		(7 << 0)
 #define RISCV_HWPROBE_KEY_ZICBOZ_BLOCK_SIZE	6
+#define RISCV_HWPROBE_KEY_TIME_CSR_FREQ	7
+#define RISCV_HWPROBE_KEY_VECTOR_USERCOPY_THRESHOLD	17
+#define RISCV_HWPROBE_KEY_TIME_CSR	18
+#define		RISCV_HWPROBE_TIME_CSR_UNKNOWN		0
+#define		RISCV_HWPROBE_TIME_CSR_EMULATED		1
+#define		RISCV_HWPROBE_TIME_CSR_FAST		2
 /* Increase RISCV_HWPROBE_MAX_KEY when adding items. */
 
 /* Flags */
@@ -18,10 +18,15 @@
 #define __KVM_HAVE_IRQ_LINE
 
 #define KVM_COALESCED_MMIO_PAGE_OFFSET 1
+#define KVM_DIRTY_LOG_PAGE_OFFSET 64
 
 #define KVM_INTERRUPT_SET	-1U
 #define KVM_INTERRUPT_UNSET	-2U
 
+/* VM types for KVM_CREATE_VM, see KVM_CAP_VM_TYPES */
+#define KVM_RISCV_DEFAULT_VM		0
+#define KVM_RISCV_SW_PROTECTED_VM	1
+
 /* for KVM_GET_REGS and KVM_SET_REGS */
 struct kvm_regs {
 };
@@ -38,10 +43,6 @@ struct kvm_debug_exit_arch {
 struct kvm_guest_debug_arch {
 };
 
-/* definition of registers in kvm_run */
-struct kvm_sync_regs {
-};
-
 /* for KVM_GET_SREGS and KVM_SET_SREGS */
 struct kvm_sregs {
 };
@@ -82,6 +83,24 @@ struct kvm_riscv_csr {
 	unsigned long senvcfg;
 };
 
+/* Register sets for kvm_run->kvm_valid_regs and kvm_dirty_regs */
+#define KVM_SYNC_RISCV_CORE	(1UL << 0)
+#define KVM_SYNC_RISCV_CSR	(1UL << 1)
+#define KVM_SYNC_RISCV_FP	(1UL << 2)
+#define KVM_SYNC_RISCV_VALID_FIELDS \
+	(KVM_SYNC_RISCV_CORE | KVM_SYNC_RISCV_CSR | KVM_SYNC_RISCV_FP)
+
+/*
+ * definition of registers in kvm_run, same layout and semantics as the
+ * KVM_REG_RISCV_CORE, KVM_REG_RISCV_CSR_GENERAL and KVM_REG_RISCV_FP_*
+ * ONE_REG registers
+ */
+struct kvm_sync_regs {
+	struct kvm_riscv_core core;
+	struct kvm_riscv_csr csr;
+	union __riscv_fp_state fp;
+};
+
 /* AIA CSR registers for KVM_GET_ONE_REG and KVM_SET_ONE_REG */
 struct kvm_riscv_aia_csr {
 	unsigned long siselect;
@@ -167,6 +186,18 @@ enum KVM_RISCV_ISA_EXT_ID {
 	KVM_RISCV_ISA_EXT_ZFA,
 	KVM_RISCV_ISA_EXT_ZTSO,
 	KVM_RISCV_ISA_EXT_ZACAS,
+	KVM_RISCV_ISA_EXT_SSCOFPMF,
+	KVM_RISCV_ISA_EXT_ZIMOP,
+	KVM_RISCV_ISA_EXT_ZCA,
+	KVM_RISCV_ISA_EXT_ZCB,
+	KVM_RISCV_ISA_EXT_ZCD,
+	KVM_RISCV_ISA_EXT_ZCF,
+	KVM_RISCV_ISA_EXT_ZCMOP,
+	KVM_RISCV_ISA_EXT_ZAWRS,
+	KVM_RISCV_ISA_EXT_SMNPM,
+	KVM_RISCV_ISA_EXT_SSNPM,
+	KVM_RISCV_ISA_EXT_SVADE,
+	KVM_RISCV_ISA_EXT_SVADU,
 	KVM_RISCV_ISA_EXT_MAX,
 };
 
@@ -186,6 +217,11 @@ enum KVM_RISCV_SBI_EXT_ID {
 	KVM_RISCV_SBI_EXT_VENDOR,
 	KVM_RISCV_SBI_EXT_DBCN,
 	KVM_RISCV_SBI_EXT_STA,
+	KVM_RISCV_SBI_EXT_SUSP,
+	KVM_RISCV_SBI_EXT_FWFT,
+	KVM_RISCV_SBI_EXT_MPXY,
+	KVM_RISCV_SBI_EXT_PVLOCK,
+	KVM_RISCV_SBI_EXT_APF,
 	KVM_RISCV_SBI_EXT_MAX,
 };
 
@@ -195,6 +231,12 @@ struct kvm_riscv_sbi_sta {
 	unsigned long shmem_hi;
 };
 
+/* SBI APF extension registers for KVM_GET_ONE_REG and KVM_SET_ONE_REG */
+struct kvm_riscv_sbi_apf {
+	unsigned long shmem_lo;
+	unsigned long shmem_hi;
+};
+
 /* Possible states for kvm_riscv_timer */
 #define KVM_RISCV_TIMER_STATE_OFF	0
 #define KVM_RISCV_TIMER_STATE_ON	1
@@ -281,6 +323,9 @@ struct kvm_riscv_sbi_sta {
 #define KVM_REG_RISCV_SBI_STA		(0x0 << KVM_REG_RISCV_SUBTYPE_SHIFT)
 #define KVM_REG_RISCV_SBI_STA_REG(name)		\
 		(offsetof(struct kvm_riscv_sbi_sta, name) / sizeof(unsigned long))
+#define KVM_REG_RISCV_SBI_APF		(0x1 << KVM_REG_RISCV_SUBTYPE_SHIFT)
+#define KVM_REG_RISCV_SBI_APF_REG(name)		\
+		(offsetof(struct kvm_riscv_sbi_apf, name) / sizeof(unsigned long))
 
 /* Device Control API: RISC-V AIA */
 #define KVM_DEV_RISCV_APLIC_ALIGN		0x1000
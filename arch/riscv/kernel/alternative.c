@@ -11,6 +11,7 @@
 #include <linux/cpu.h>
 #include <linux/uaccess.h>
 #include <asm/alternative.h>
+#include <asm/cacheflush.h>
 #include <asm/module.h>
 #include <asm/sections.h>
 #include <asm/vdso.h>
@@ -83,7 +84,7 @@ static void riscv_alternative_fix_auipc_jalr(void *ptr, u32 auipc_insn,
 	riscv_insn_insert_utype_itype_imm(&call[0], &call[1], imm);
 
 	/* patch the call place again */
-	patch_text_nosync(ptr, call, sizeof(u32) * 2);
+	patch_insn_write(ptr, call, sizeof(u32) * 2);
 }
 
 static void riscv_alternative_fix_jal(void *ptr, u32 jal_insn, int patch_offset)
@@ -98,7 +99,7 @@ static void riscv_alternative_fix_jal(void *ptr, u32 jal_insn, int patch_offset)
 	riscv_insn_insert_jtype_imm(&jal_insn, imm);
 
 	/* patch the call place again */
-	patch_text_nosync(ptr, &jal_insn, sizeof(u32));
+	patch_insn_write(ptr, &jal_insn, sizeof(u32));
 }
 
 void riscv_alternative_fix_offsets(void *alt_ptr, unsigned int len,
@@ -148,6 +149,9 @@ void riscv_alternative_fix_offsets(void *alt_ptr, unsigned int len,
  * This is called very early in the boot process (directly after we run
  * a feature detect on the boot CPU). No need to worry about other CPUs
  * here.
+ *
+ * The patch functions only write the new instructions; the icache is
+ * flushed once here for the whole set rather than once per entry.
  */
 static void __init_or_module _apply_alternatives(struct alt_entry *begin,
 						 struct alt_entry *end,
@@ -159,13 +163,14 @@ static void __init_or_module _apply_alternatives(struct alt_entry *begin,
 
 	riscv_cpufeature_patch_func(begin, end, stage);
 
-	if (!cpu_mfr_info.patch_func)
-		return;
+	if (cpu_mfr_info.patch_func)
+		cpu_mfr_info.patch_func(begin, end,
+					cpu_mfr_info.arch_id,
+					cpu_mfr_info.imp_id,
+					stage);
 
-	cpu_mfr_info.patch_func(begin, end,
-				cpu_mfr_info.arch_id,
-				cpu_mfr_info.imp_id,
-				stage);
+	if (stage != RISCV_ALTERNATIVES_EARLY_BOOT)
+		flush_icache_all();
 }
 
 #ifdef CONFIG_MMU
@@ -6,6 +6,7 @@
 
 #define GENERATING_ASM_OFFSETS
 
+#include <linux/ftrace.h>
 #include <linux/kbuild.h>
 #include <linux/mm.h>
 #include <linux/sched.h>
@@ -488,4 +489,8 @@ void asm_offsets(void)
 	DEFINE(STACKFRAME_SIZE_ON_STACK, ALIGN(sizeof(struct stackframe), STACK_ALIGN));
 	OFFSET(STACKFRAME_FP, stackframe, fp);
 	OFFSET(STACKFRAME_RA, stackframe, ra);
+
+#ifdef CONFIG_DYNAMIC_FTRACE_WITH_CALL_OPS
+	DEFINE(FTRACE_OPS_FUNC, offsetof(struct ftrace_ops, func));
+#endif
 }
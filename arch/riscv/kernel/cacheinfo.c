@@ -3,6 +3,7 @@
  * Copyright (C) 2017 SiFive
  */
 
+#include <linux/arch_topology.h>
 #include <linux/cpu.h>
 #include <linux/of.h>
 #include <asm/cacheinfo.h>
@@ -108,3 +109,43 @@ int populate_cache_leaves(unsigned int cpu)
 
 	return 0;
 }
+
+/*
+ * Firmware rarely describes clusters on RISC-V, even though many core
+ * complexes share an L2 below a wider last level cache. Without a cluster
+ * from DT or PPTT, make the CPUs sharing the smallest such cache with @cpuid
+ * cluster siblings, so that the scheduler builds a domain for them.
+ */
+void riscv_update_cluster_siblings(unsigned int cpuid)
+{
+	struct cpu_topology *cpuid_topo = &cpu_topology[cpuid];
+	struct cpu_cacheinfo *this_cpu_ci = get_cpu_cacheinfo(cpuid);
+	struct cacheinfo *this_leaf, *shared_leaf = NULL;
+	unsigned int cpu;
+	int index;
+
+	if (cpuid_topo->cluster_id != -1 || !this_cpu_ci->info_list)
+		return;
+
+	/* The last leaf is the LLC, which already has its own domain. */
+	for (index = 0; index < (int)this_cpu_ci->num_leaves - 1; index++) {
+		this_leaf = this_cpu_ci->info_list + index;
+		if (this_leaf->type == CACHE_TYPE_INST)
+			continue;
+		if (cpumask_weight(&this_leaf->shared_cpu_map) > 1) {
+			shared_leaf = this_leaf;
+			break;
+		}
+	}
+
+	if (!shared_leaf)
+		return;
+
+	for_each_cpu(cpu, &shared_leaf->shared_cpu_map) {
+		if (cpu_topology[cpu].package_id != cpuid_topo->package_id)
+			continue;
+
+		cpumask_set_cpu(cpu, &cpuid_topo->cluster_sibling);
+		cpumask_set_cpu(cpuid, &cpu_topology[cpu].cluster_sibling);
+	}
+}
@@ -93,6 +93,15 @@ static bool riscv_isa_extension_check(int id)
 			return false;
 		}
 		return true;
+	case RISCV_ISA_EXT_ZICBOP:
+		if (!riscv_cbop_block_size) {
+			pr_err("Zicbop detected in ISA string, disabling as no cbop-block-size found\n");
+			return false;
+		} else if (!is_power_of_2(riscv_cbop_block_size)) {
+			pr_err("Zicbop disabled as cbop-block-size present, but is not a power-of-2\n");
+			return false;
+		}
+		return true;
 	case RISCV_ISA_EXT_INVALID:
 		return false;
 	}
@@ -248,7 +257,9 @@ const struct riscv_isa_ext_data riscv_isa_ext[] = {
 	__RISCV_ISA_EXT_DATA(v, RISCV_ISA_EXT_v),
 	__RISCV_ISA_EXT_DATA(h, RISCV_ISA_EXT_h),
 	__RISCV_ISA_EXT_SUPERSET(zicbom, RISCV_ISA_EXT_ZICBOM, riscv_xlinuxenvcfg_exts),
+	__RISCV_ISA_EXT_DATA(zicbop, RISCV_ISA_EXT_ZICBOP),
 	__RISCV_ISA_EXT_SUPERSET(zicboz, RISCV_ISA_EXT_ZICBOZ, riscv_xlinuxenvcfg_exts),
+	__RISCV_ISA_EXT_DATA(ziccrse, RISCV_ISA_EXT_ZICCRSE),
 	__RISCV_ISA_EXT_DATA(zicntr, RISCV_ISA_EXT_ZICNTR),
 	__RISCV_ISA_EXT_DATA(zicond, RISCV_ISA_EXT_ZICOND),
 	__RISCV_ISA_EXT_DATA(zicsr, RISCV_ISA_EXT_ZICSR),
@@ -256,7 +267,9 @@ const struct riscv_isa_ext_data riscv_isa_ext[] = {
 	__RISCV_ISA_EXT_DATA(zihintntl, RISCV_ISA_EXT_ZIHINTNTL),
 	__RISCV_ISA_EXT_DATA(zihintpause, RISCV_ISA_EXT_ZIHINTPAUSE),
 	__RISCV_ISA_EXT_DATA(zihpm, RISCV_ISA_EXT_ZIHPM),
+	__RISCV_ISA_EXT_DATA(zabha, RISCV_ISA_EXT_ZABHA),
 	__RISCV_ISA_EXT_DATA(zacas, RISCV_ISA_EXT_ZACAS),
+	__RISCV_ISA_EXT_DATA(zawrs, RISCV_ISA_EXT_ZAWRS),
 	__RISCV_ISA_EXT_DATA(zfa, RISCV_ISA_EXT_ZFA),
 	__RISCV_ISA_EXT_DATA(zfh, RISCV_ISA_EXT_ZFH),
 	__RISCV_ISA_EXT_DATA(zfhmin, RISCV_ISA_EXT_ZFHMIN),
@@ -301,6 +314,8 @@ const struct riscv_isa_ext_data riscv_isa_ext[] = {
 	__RISCV_ISA_EXT_DATA(ssaia, RISCV_ISA_EXT_SSAIA),
 	__RISCV_ISA_EXT_DATA(sscofpmf, RISCV_ISA_EXT_SSCOFPMF),
 	__RISCV_ISA_EXT_DATA(sstc, RISCV_ISA_EXT_SSTC),
+	__RISCV_ISA_EXT_DATA(svade, RISCV_ISA_EXT_SVADE),
+	__RISCV_ISA_EXT_DATA(svadu, RISCV_ISA_EXT_SVADU),
 	__RISCV_ISA_EXT_DATA(svinval, RISCV_ISA_EXT_SVINVAL),
 	__RISCV_ISA_EXT_DATA(svnapot, RISCV_ISA_EXT_SVNAPOT),
 	__RISCV_ISA_EXT_DATA(svpbmt, RISCV_ISA_EXT_SVPBMT),
@@ -636,6 +651,58 @@ static int __init riscv_fill_hwcap_from_ext_list(unsigned long *isa2hwcap)
 	return 0;
 }
 
+/*
+ * Svadu on its own means that the hardware updates the A/D bits. If Svade is
+ * listed as well, A/D faults are raised until the supervisor asks for hardware
+ * updating, through SBI FWFT. An M-mode kernel has no firmware to ask and no
+ * other way to know the reset value, so it always sets menvcfg.ADUE itself.
+ */
+static bool riscv_svadu_needs_enable(void)
+{
+	return IS_ENABLED(CONFIG_RISCV_M_MODE) ||
+	       riscv_isa_extension_available(NULL, SVADE);
+}
+
+static int riscv_hw_ad_updating_enable(void)
+{
+	if (IS_ENABLED(CONFIG_RISCV_M_MODE)) {
+#ifdef CONFIG_32BIT
+		csr_set(CSR_MENVCFGH, ENVCFG_ADUE >> 32);
+#else
+		csr_set(CSR_MENVCFG, ENVCFG_ADUE);
+#endif
+		return 0;
+	}
+
+	return sbi_fwft_set(SBI_FWFT_PTE_AD_HW_UPDATING, 1, 0);
+}
+
+static void __init riscv_svadu_resolve(void)
+{
+	unsigned int cpu;
+
+	if (!riscv_isa_extension_available(NULL, SVADU) ||
+	    !riscv_svadu_needs_enable() || !riscv_hw_ad_updating_enable())
+		return;
+
+	pr_info("Svadu disabled, hardware A/D updating could not be enabled\n");
+	clear_bit(RISCV_ISA_EXT_SVADU, riscv_isa);
+	for_each_possible_cpu(cpu)
+		clear_bit(RISCV_ISA_EXT_SVADU, hart_isa[cpu].isa);
+}
+
+/*
+ * A hart that fails this still takes A/D faults, which are handled as on a
+ * system without Svadu, so there is nothing to undo.
+ */
+void riscv_svadu_enable(void)
+{
+	if (riscv_has_extension_unlikely(RISCV_ISA_EXT_SVADU) &&
+	    riscv_svadu_needs_enable() && riscv_hw_ad_updating_enable())
+		pr_warn("CPU%d: hardware A/D updating could not be enabled\n",
+			smp_processor_id());
+}
+
 #ifdef CONFIG_RISCV_ISA_FALLBACK
 bool __initdata riscv_isa_fallback = true;
 #else
@@ -693,6 +760,8 @@ void __init riscv_fill_hwcap(void)
 			elf_hwcap &= ~COMPAT_HWCAP_ISA_V;
 	}
 
+	riscv_svadu_resolve();
+
 	memset(print_str, 0, sizeof(print_str));
 	for (i = 0, j = 0; i < NUM_ALPHA_EXTS; i++)
 		if (riscv_isa[0] & BIT_MASK(i))
@@ -791,7 +860,7 @@ void __init_or_module riscv_cpufeature_patch_func(struct alt_entry *begin,
 		altptr = ALT_ALT_PTR(alt);
 
 		mutex_lock(&text_mutex);
-		patch_text_nosync(oldptr, altptr, alt->alt_len);
+		patch_insn_write(oldptr, altptr, alt->alt_len);
 		riscv_alternative_fix_offsets(oldptr, alt->alt_len, oldptr - altptr);
 		mutex_unlock(&text_mutex);
 	}
@@ -81,6 +81,9 @@ void put_cpu_vector_context(void)
 }
 
 #ifdef CONFIG_RISCV_ISA_V_PREEMPTIVE
+DEFINE_PER_CPU(struct __riscv_v_ext_state *, riscv_v_kernel_live_vstate);
+EXPORT_PER_CPU_SYMBOL_GPL(riscv_v_kernel_live_vstate);
+
 static __always_inline u32 *riscv_v_flags_ptr(void)
 {
 	return &current->thread.riscv_v_flags;
@@ -180,7 +183,19 @@ asmlinkage void riscv_v_context_nesting_end(struct pt_regs *regs)
 	depth = riscv_v_ctx_get_depth();
 	if (depth == 0) {
 		if (riscv_preempt_v_restore(current)) {
-			__riscv_v_vstate_restore(vstate, vstate->datap);
+			/*
+			 * Saving only changes vl and vtype; if nothing else
+			 * used V on this CPU since, the data registers are
+			 * still ours and only the CSRs need reloading.
+			 */
+			if (riscv_preempt_v_live(current)) {
+				riscv_v_enable();
+				__vstate_csr_restore(vstate);
+				riscv_v_disable();
+			} else {
+				__riscv_v_vstate_restore(vstate, vstate->datap);
+				riscv_preempt_v_set_live(current);
+			}
 			__riscv_v_vstate_clean(regs);
 			riscv_preempt_v_reset_flags();
 		}
@@ -221,6 +236,8 @@ void kernel_vector_begin(void)
 	if (!nested)
 		riscv_v_vstate_set_restore(current, task_pt_regs(current));
 
+	/* The caller is about to overwrite the vector registers */
+	riscv_preempt_v_drop_live();
 	riscv_v_enable();
 }
 EXPORT_SYMBOL_GPL(kernel_vector_begin);
@@ -9,6 +9,8 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/moduleloader.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
 
 unsigned long module_emit_got_entry(struct module *mod, unsigned long val)
 {
@@ -55,44 +57,74 @@ unsigned long module_emit_plt_entry(struct module *mod, unsigned long val)
 	return (unsigned long)&plt[i];
 }
 
-static int is_rela_equal(const Elf_Rela *x, const Elf_Rela *y)
+static int cmp_rela(const void *a, const void *b)
 {
-	return x->r_info == y->r_info && x->r_addend == y->r_addend;
+	const Elf_Rela *x = a, *y = b;
+
+	/* sort by type, symbol index and addend */
+	if (x->r_info != y->r_info)
+		return x->r_info < y->r_info ? -1 : 1;
+	if (x->r_addend != y->r_addend)
+		return x->r_addend < y->r_addend ? -1 : 1;
+	return 0;
 }
 
 static bool duplicate_rela(const Elf_Rela *rela, int idx)
 {
-	int i;
-	for (i = 0; i < idx; i++) {
-		if (is_rela_equal(&rela[i], &rela[idx]))
-			return true;
+	/*
+	 * Entries are sorted by type, symbol index and addend, so a duplicate
+	 * of an entry can only be in the slot right before it.
+	 */
+	return idx > 0 && cmp_rela(rela + idx, rela + idx - 1) == 0;
+}
+
+static bool rela_needs_plt_got_entry(const Elf_Rela *rela)
+{
+	switch (ELF_RISCV_R_TYPE(rela->r_info)) {
+	case R_RISCV_CALL_PLT:
+	case R_RISCV_PLT32:
+	case R_RISCV_GOT_HI20:
+		return true;
+	default:
+		return false;
 	}
-	return false;
 }
 
-static void count_max_entries(Elf_Rela *relas, int num,
+static void count_max_entries(const Elf_Rela *relas, int num,
 			      unsigned int *plts, unsigned int *gots)
 {
-	unsigned int type, i;
+	int i;
 
 	for (i = 0; i < num; i++) {
-		type = ELF_RISCV_R_TYPE(relas[i].r_info);
-		if (type == R_RISCV_CALL_PLT) {
-			if (!duplicate_rela(relas, i))
-				(*plts)++;
-		} else if (type == R_RISCV_GOT_HI20) {
-			if (!duplicate_rela(relas, i))
-				(*gots)++;
-		}
+		if (duplicate_rela(relas, i))
+			continue;
+
+		if (ELF_RISCV_R_TYPE(relas[i].r_info) == R_RISCV_GOT_HI20)
+			(*gots)++;
+		else
+			(*plts)++;
 	}
 }
 
+static bool rela_sec_needs_entries(const Elf_Shdr *sechdrs, int i)
+{
+	const Elf_Shdr *dst_sec = sechdrs + sechdrs[i].sh_info;
+
+	if (sechdrs[i].sh_type != SHT_RELA)
+		return false;
+
+	/* ignore relocations that operate on non-exec sections */
+	return dst_sec->sh_flags & SHF_EXECINSTR;
+}
+
 int module_frob_arch_sections(Elf_Ehdr *ehdr, Elf_Shdr *sechdrs,
 			      char *secstrings, struct module *mod)
 {
 	unsigned int num_plts = 0;
 	unsigned int num_gots = 0;
-	int i;
+	Elf_Rela *scratch;
+	int num_scratch = 0;
+	int i, j;
 
 	/*
 	 * Find the empty .got and .plt sections.
@@ -119,20 +151,47 @@ int module_frob_arch_sections(Elf_Ehdr *ehdr, Elf_Shdr *sechdrs,
 		return -ENOEXEC;
 	}
 
-	/* Calculate the maxinum number of entries */
+	/*
+	 * Calculate the maximum number of entries. Gather the relocations
+	 * that may need an entry into a scratch copy and sort it, so that
+	 * duplicates end up adjacent and can be skipped in linear time.
+	 * apply_relocate_add() relies on HI20/LO12 pairs staying close
+	 * together, so the sections themselves must not be reordered.
+	 */
 	for (i = 0; i < ehdr->e_shnum; i++) {
 		Elf_Rela *relas = (void *)ehdr + sechdrs[i].sh_offset;
 		int num_rela = sechdrs[i].sh_size / sizeof(Elf_Rela);
-		Elf_Shdr *dst_sec = sechdrs + sechdrs[i].sh_info;
 
-		if (sechdrs[i].sh_type != SHT_RELA)
+		if (!rela_sec_needs_entries(sechdrs, i))
 			continue;
 
-		/* ignore relocations that operate on non-exec sections */
-		if (!(dst_sec->sh_flags & SHF_EXECINSTR))
-			continue;
+		for (j = 0; j < num_rela; j++)
+			if (rela_needs_plt_got_entry(&relas[j]))
+				num_scratch++;
+	}
+
+	if (num_scratch) {
+		scratch = kvmalloc_array(num_scratch, sizeof(*scratch),
+					 GFP_KERNEL);
+		if (!scratch)
+			return -ENOMEM;
+
+		num_scratch = 0;
+		for (i = 0; i < ehdr->e_shnum; i++) {
+			Elf_Rela *relas = (void *)ehdr + sechdrs[i].sh_offset;
+			int num_rela = sechdrs[i].sh_size / sizeof(Elf_Rela);
+
+			if (!rela_sec_needs_entries(sechdrs, i))
+				continue;
+
+			for (j = 0; j < num_rela; j++)
+				if (rela_needs_plt_got_entry(&relas[j]))
+					scratch[num_scratch++] = relas[j];
+		}
 
-		count_max_entries(relas, num_rela, &num_plts, &num_gots);
+		sort(scratch, num_scratch, sizeof(*scratch), cmp_rela, NULL);
+		count_max_entries(scratch, num_scratch, &num_plts, &num_gots);
+		kvfree(scratch);
 	}
 
 	mod->arch.plt.shdr->sh_type = SHT_NOBITS;
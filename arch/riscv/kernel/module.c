@@ -4,6 +4,7 @@
  *  Copyright (C) 2017 Zihao Yu
  */
 
+#include <linux/bsearch.h>
 #include <linux/elf.h>
 #include <linux/err.h>
 #include <linux/errno.h>
@@ -13,6 +14,7 @@
 #include <linux/moduleloader.h>
 #include <linux/vmalloc.h>
 #include <linux/sizes.h>
+#include <linux/sort.h>
 #include <linux/pgtable.h>
 #include <asm/alternative.h>
 #include <asm/sections.h>
@@ -774,6 +776,66 @@ initialize_relocation_hashtable(unsigned int num_relocations,
 	return hashtable_bits;
 }
 
+static bool is_hi20_pair_type(unsigned int type)
+{
+	return type == R_RISCV_PCREL_HI20 || type == R_RISCV_GOT_HI20;
+}
+
+static int cmp_rela_offset(const void *a, const void *b)
+{
+	const Elf_Rela *x = *(const Elf_Rela **)a;
+	const Elf_Rela *y = *(const Elf_Rela **)b;
+
+	if (x->r_offset != y->r_offset)
+		return x->r_offset < y->r_offset ? -1 : 1;
+	return 0;
+}
+
+/*
+ * PCREL_LO12 relocations point at the auipc carrying the matching HI20
+ * relocation through their symbol. Index the HI20 relocations of a
+ * section by offset once, so each LO12 is paired by binary search rather
+ * than by rescanning the relocation table.
+ */
+static const Elf_Rela **build_hi20_index(const Elf_Rela *rel,
+					 unsigned int num_relocations,
+					 unsigned int *num_hi20)
+{
+	const Elf_Rela **index;
+	unsigned int i, n = 0;
+
+	for (i = 0; i < num_relocations; i++)
+		if (is_hi20_pair_type(ELF_RISCV_R_TYPE(rel[i].r_info)))
+			n++;
+
+	index = kvmalloc_array(n, sizeof(*index), GFP_KERNEL);
+	if (!index)
+		return NULL;
+
+	n = 0;
+	for (i = 0; i < num_relocations; i++)
+		if (is_hi20_pair_type(ELF_RISCV_R_TYPE(rel[i].r_info)))
+			index[n++] = &rel[i];
+
+	sort(index, n, sizeof(*index), cmp_rela_offset, NULL);
+	*num_hi20 = n;
+
+	return index;
+}
+
+static const Elf_Rela *find_hi20_rela(const Elf_Rela **index,
+				      unsigned int num_hi20, Elf_Addr offset)
+{
+	Elf_Rela key = { .r_offset = offset };
+	const Elf_Rela *keyp = &key;
+	const Elf_Rela **found;
+
+	found = bsearch(&keyp, index, num_hi20, sizeof(*index),
+			cmp_rela_offset);
+
+	return found ? *found : NULL;
+}
+
 int apply_relocate_add(Elf_Shdr *sechdrs, const char *strtab,
 		       unsigned int symindex, unsigned int relsec,
 		       struct module *me)
@@ -783,9 +845,10 @@ int apply_relocate_add(Elf_Shdr *sechdrs, const char *strtab,
 	Elf_Sym *sym;
 	void *location;
 	unsigned int i, type;
-	unsigned int j_idx = 0;
+	const Elf_Rela **hi20_index = NULL;
+	unsigned int num_hi20 = 0;
 	Elf_Addr v;
-	int res;
+	int res = 0;
 	unsigned int num_relocations = sechdrs[relsec].sh_size / sizeof(*rel);
 	struct hlist_head *relocation_hashtable;
 	struct list_head used_buckets_list;
@@ -815,7 +878,8 @@ int apply_relocate_add(Elf_Shdr *sechdrs, const char *strtab,
 				continue;
 			pr_warn("%s: Unknown symbol %s\n",
 				me->name, strtab + sym->st_name);
-			return -ENOENT;
+			res = -ENOENT;
+			goto out;
 		}
 
 		type = ELF_RISCV_R_TYPE(rel[i].r_info);
@@ -828,64 +892,57 @@ int apply_relocate_add(Elf_Shdr *sechdrs, const char *strtab,
 		if (!handler) {
 			pr_err("%s: Unknown relocation type %u\n",
 			       me->name, type);
-			return -EINVAL;
+			res = -EINVAL;
+			goto out;
 		}
 
 		v = sym->st_value + rel[i].r_addend;
 
 		if (type == R_RISCV_PCREL_LO12_I || type == R_RISCV_PCREL_LO12_S) {
-			unsigned int j = j_idx;
-			bool found = false;
-
-			do {
-				unsigned long hi20_loc =
-					sechdrs[sechdrs[relsec].sh_info].sh_addr
-					+ rel[j].r_offset;
-				u32 hi20_type = ELF_RISCV_R_TYPE(rel[j].r_info);
-
-				/* Find the corresponding HI20 relocation entry */
-				if (hi20_loc == sym->st_value
-				    && (hi20_type == R_RISCV_PCREL_HI20
-					|| hi20_type == R_RISCV_GOT_HI20)) {
-					s32 hi20, lo12;
-					Elf_Sym *hi20_sym =
-						(Elf_Sym *)sechdrs[symindex].sh_addr
-						+ ELF_RISCV_R_SYM(rel[j].r_info);
-					unsigned long hi20_sym_val =
-						hi20_sym->st_value
-						+ rel[j].r_addend;
-
-					/* Calculate lo12 */
-					size_t offset = hi20_sym_val - hi20_loc;
-					if (IS_ENABLED(CONFIG_MODULE_SECTIONS)
-					    && hi20_type == R_RISCV_GOT_HI20) {
-						offset = module_emit_got_entry(
-							 me, hi20_sym_val);
-						offset = offset - hi20_loc;
-					}
-					hi20 = (offset + 0x800) & 0xfffff000;
-					lo12 = offset - hi20;
-					v = lo12;
-					found = true;
-
-					break;
+			Elf_Addr sec_addr = sechdrs[sechdrs[relsec].sh_info].sh_addr;
+			const Elf_Rela *hi20_rel;
+			unsigned long hi20_loc, hi20_sym_val;
+			Elf_Sym *hi20_sym;
+			u32 hi20_type;
+			s32 hi20, lo12;
+			size_t offset;
+
+			if (!hi20_index) {
+				hi20_index = build_hi20_index(rel, num_relocations,
+							      &num_hi20);
+				if (!hi20_index) {
+					res = -ENOMEM;
+					goto out;
 				}
+			}
 
-				j++;
-				if (j > sechdrs[relsec].sh_size / sizeof(*rel))
-					j = 0;
-
-			} while (j_idx != j);
-
-			if (!found) {
+			/* Find the corresponding HI20 relocation entry */
+			hi20_rel = find_hi20_rela(hi20_index, num_hi20,
+						  sym->st_value - sec_addr);
+			if (!hi20_rel) {
 				pr_err(
 				  "%s: Can not find HI20 relocation information\n",
 				  me->name);
-				return -EINVAL;
+				res = -EINVAL;
+				goto out;
 			}
 
-			/* Record the previous j-loop end index */
-			j_idx = j;
+			hi20_loc = sec_addr + hi20_rel->r_offset;
+			hi20_type = ELF_RISCV_R_TYPE(hi20_rel->r_info);
+			hi20_sym = (Elf_Sym *)sechdrs[symindex].sh_addr
+				   + ELF_RISCV_R_SYM(hi20_rel->r_info);
+			hi20_sym_val = hi20_sym->st_value + hi20_rel->r_addend;
+
+			/* Calculate lo12 */
+			offset = hi20_sym_val - hi20_loc;
+			if (IS_ENABLED(CONFIG_MODULE_SECTIONS)
+			    && hi20_type == R_RISCV_GOT_HI20) {
+				offset = module_emit_got_entry(me, hi20_sym_val);
+				offset = offset - hi20_loc;
+			}
+			hi20 = (offset + 0x800) & 0xfffff000;
+			lo12 = offset - hi20;
+			v = lo12;
 		}
 
 		if (reloc_handlers[type].accumulate_handler)
@@ -896,13 +953,15 @@ int apply_relocate_add(Elf_Shdr *sechdrs, const char *strtab,
 		else
 			res = handler(me, location, v);
 		if (res)
-			return res;
+			goto out;
 	}
 
 	process_accumulated_relocations(me, &relocation_hashtable,
 					&used_buckets_list);
 
-	return 0;
+out:
+	kvfree(hi20_index);
+	return res;
 }
 
 #if defined(CONFIG_MMU) && defined(CONFIG_64BIT)
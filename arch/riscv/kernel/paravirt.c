@@ -32,6 +32,13 @@ static u64 native_steal_clock(int cpu)
 
 DEFINE_STATIC_CALL(pv_steal_clock, native_steal_clock);
 
+static bool native_vcpu_is_preempted(int cpu)
+{
+	return false;
+}
+
+DEFINE_STATIC_CALL(pv_vcpu_is_preempted, native_vcpu_is_preempted);
+
 static bool steal_acc = true;
 static int __init parse_no_stealacc(char *arg)
 {
@@ -109,6 +116,17 @@ static u64 pv_time_steal_clock(int cpu)
 	return le64_to_cpu(steal);
 }
 
+/*
+ * The hypervisor sets the preempted byte when it schedules the VCPU out
+ * and clears it before the VCPU runs again, so it needs no sequence check.
+ */
+static bool pv_time_vcpu_is_preempted(int cpu)
+{
+	struct sbi_sta_struct *st = per_cpu_ptr(&steal_time, cpu);
+
+	return !!READ_ONCE(st->preempted);
+}
+
 int __init pv_time_init(void)
 {
 	int ret;
@@ -124,6 +142,7 @@ int __init pv_time_init(void)
 		return ret;
 
 	static_call_update(pv_steal_clock, pv_time_steal_clock);
+	static_call_update(pv_vcpu_is_preempted, pv_time_vcpu_is_preempted);
 
 	static_key_slow_inc(&paravirt_steal_enabled);
 	if (steal_acc)
@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Asynchronous page faults on top of the SBI APF extension.
+ *
+ * When a user mode access hits a guest page the hypervisor has to bring in
+ * first, it redirects a page fault with SBI_APF_PAGE_NOT_PRESENT set. The
+ * faulting task sleeps until the hypervisor reports the token as ready
+ * through a software interrupt, then retries the access.
+ */
+
+#define pr_fmt(fmt) "riscv-pv: " fmt
+
+#include <linux/cpuhotplug.h>
+#include <linux/hash.h>
+#include <linux/init.h>
+#include <linux/jump_label.h>
+#include <linux/list.h>
+#include <linux/percpu-defs.h>
+#include <linux/printk.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/swait.h>
+
+#include <asm/page.h>
+#include <asm/paravirt.h>
+#include <asm/ptrace.h>
+#include <asm/sbi.h>
+
+DEFINE_STATIC_KEY_FALSE(pv_apf_enabled);
+
+static DEFINE_PER_CPU(struct sbi_apf_struct, apf_data) __aligned(64);
+
+#define APF_HASH_BITS	8
+
+struct apf_sleeper {
+	struct hlist_node link;
+	struct swait_queue_head wq;
+	u32 token;
+	int cpu;
+};
+
+static struct apf_bucket {
+	raw_spinlock_t lock;
+	struct hlist_head list;
+} apf_buckets[1 << APF_HASH_BITS];
+
+static bool pv_apf_disabled;
+static int __init parse_no_kvmapf(char *arg)
+{
+	pv_apf_disabled = true;
+	return 0;
+}
+
+early_param("no-kvmapf", parse_no_kvmapf);
+
+static void apf_wake_one(struct apf_sleeper *n)
+{
+	hlist_del_init(&n->link);
+	swake_up_one(&n->wq);
+}
+
+/*
+ * Called with interrupts still disabled from the trap so that the wake up
+ * for the token, which comes as an interrupt on this CPU, can't overtake
+ * the registration below.
+ */
+static void pv_apf_wait(u32 token)
+{
+	struct apf_bucket *b = &apf_buckets[hash_32(token, APF_HASH_BITS)];
+	struct apf_sleeper n;
+	DECLARE_SWAITQUEUE(wait);
+	bool woken;
+
+	n.token = token;
+	n.cpu = smp_processor_id();
+	init_swait_queue_head(&n.wq);
+
+	raw_spin_lock(&b->lock);
+	hlist_add_head(&n.link, &b->list);
+	raw_spin_unlock(&b->lock);
+
+	local_irq_enable();
+
+	for (;;) {
+		prepare_to_swait_exclusive(&n.wq, &wait, TASK_UNINTERRUPTIBLE);
+		/* The waker is done with n once it dropped the lock. */
+		raw_spin_lock_irq(&b->lock);
+		woken = hlist_unhashed(&n.link);
+		raw_spin_unlock_irq(&b->lock);
+		if (woken)
+			break;
+		schedule();
+	}
+	finish_swait(&n.wq, &wait);
+}
+
+static void pv_apf_wake(u32 token, int cpu)
+{
+	struct apf_sleeper *n;
+	struct hlist_node *tmp;
+	unsigned long flags;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(apf_buckets); i++) {
+		struct apf_bucket *b = &apf_buckets[i];
+
+		if (token != SBI_APF_WAKE_ALL &&
+		    i != hash_32(token, APF_HASH_BITS))
+			continue;
+
+		raw_spin_lock_irqsave(&b->lock, flags);
+		hlist_for_each_entry_safe(n, tmp, &b->list, link) {
+			if (token == SBI_APF_WAKE_ALL ?
+			    (cpu < 0 || n->cpu == cpu) : n->token == token)
+				apf_wake_one(n);
+		}
+		raw_spin_unlock_irqrestore(&b->lock, flags);
+	}
+}
+
+bool __pv_apf_page_not_present(struct pt_regs *regs)
+{
+	struct sbi_apf_struct *apf = this_cpu_ptr(&apf_data);
+	u32 token;
+
+	if (!(le32_to_cpu(READ_ONCE(apf->flags)) & SBI_APF_PAGE_NOT_PRESENT))
+		return false;
+
+	token = le32_to_cpu(READ_ONCE(apf->token));
+	WRITE_ONCE(apf->flags, 0);
+
+	/* The hypervisor only does this to user mode. */
+	if (WARN_ON_ONCE(!user_mode(regs)))
+		return false;
+
+	pv_apf_wait(token);
+
+	return true;
+}
+
+/* Runs from the software interrupt, before the muxed IPIs. */
+void __pv_apf_page_ready(void)
+{
+	struct sbi_apf_struct *apf = this_cpu_ptr(&apf_data);
+	u32 token;
+
+	token = le32_to_cpu(READ_ONCE(apf->ready_token));
+	if (!token)
+		return;
+
+	WRITE_ONCE(apf->ready_token, 0);
+	pv_apf_wake(token, -1);
+
+	sbi_ecall(SBI_EXT_APF, SBI_EXT_APF_READY_ACK, 0, 0, 0, 0, 0, 0);
+}
+
+static int sbi_apf_set_shmem(unsigned long lo, unsigned long hi)
+{
+	struct sbiret ret;
+
+	ret = sbi_ecall(SBI_EXT_APF, SBI_EXT_APF_SET_SHMEM,
+			lo, hi, 0, 0, 0, 0);
+	if (ret.error) {
+		pr_warn("Failed to set async page fault shmem");
+		return sbi_err_map_linux_errno(ret.error);
+	}
+
+	return 0;
+}
+
+static int pv_apf_cpu_online(unsigned int cpu)
+{
+	struct sbi_apf_struct *apf = this_cpu_ptr(&apf_data);
+	phys_addr_t pa = __pa(apf);
+	unsigned long lo = (unsigned long)pa;
+	unsigned long hi = IS_ENABLED(CONFIG_32BIT) ? upper_32_bits((u64)pa) : 0;
+
+	return sbi_apf_set_shmem(lo, hi);
+}
+
+static int pv_apf_cpu_down_prepare(unsigned int cpu)
+{
+	int ret;
+
+	ret = sbi_apf_set_shmem(SBI_SHMEM_DISABLE, SBI_SHMEM_DISABLE);
+
+	/*
+	 * Ready pages of tasks that faulted here won't be reported anymore,
+	 * let them retry the access and fault synchronously instead.
+	 */
+	pv_apf_wake(SBI_APF_WAKE_ALL, cpu);
+
+	return ret;
+}
+
+/*
+ * Called once the software interrupt is set up for IPIs through SBI, which
+ * also delivers the ready notifications.
+ */
+void __init pv_apf_init(void)
+{
+	int i, ret;
+
+	if (pv_apf_disabled ||
+	    sbi_spec_version < sbi_mk_version(2, 0) ||
+	    sbi_probe_extension(SBI_EXT_APF) <= 0)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(apf_buckets); i++)
+		raw_spin_lock_init(&apf_buckets[i].lock);
+
+	/* Faults can be redirected as soon as the boot CPU registered. */
+	static_branch_enable(&pv_apf_enabled);
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "riscv/pv_apf:online",
+				pv_apf_cpu_online, pv_apf_cpu_down_prepare);
+	if (ret < 0) {
+		static_branch_disable(&pv_apf_enabled);
+		return;
+	}
+
+	pr_info("SBI APF extension detected, using async page faults\n");
+}
@@ -137,6 +137,21 @@ static int __patch_insn_write(void *addr, const void *insn, size_t len)
 	return ret;
 }
 NOKPROBE_SYMBOL(__patch_insn_write);
+
+static int __patch_literal_write(void *addr, unsigned long val)
+{
+	unsigned long *waddr;
+
+	if (!riscv_patch_in_stop_machine)
+		lockdep_assert_held(&text_mutex);
+
+	waddr = patch_map(addr, FIX_TEXT_POKE0);
+	WRITE_ONCE(*waddr, val);
+	patch_unmap(FIX_TEXT_POKE0);
+
+	return 0;
+}
+NOKPROBE_SYMBOL(__patch_literal_write);
 #else
 static int __patch_insn_set(void *addr, u8 c, size_t len)
 {
@@ -151,6 +166,14 @@ static int __patch_insn_write(void *addr, const void *insn, size_t len)
 	return copy_to_kernel_nofault(addr, insn, len);
 }
 NOKPROBE_SYMBOL(__patch_insn_write);
+
+static int __patch_literal_write(void *addr, unsigned long val)
+{
+	WRITE_ONCE(*(unsigned long *)addr, val);
+
+	return 0;
+}
+NOKPROBE_SYMBOL(__patch_literal_write);
 #endif /* CONFIG_MMU */
 
 static int patch_insn_set(void *addr, u8 c, size_t len)
@@ -188,7 +211,7 @@ int patch_text_set_nosync(void *addr, u8 c, size_t len)
 }
 NOKPROBE_SYMBOL(patch_text_set_nosync);
 
-static int patch_insn_write(void *addr, const void *insn, size_t len)
+int patch_insn_write(void *addr, const void *insn, size_t len)
 {
 	size_t patched = 0;
 	size_t size;
@@ -209,6 +232,20 @@ static int patch_insn_write(void *addr, const void *insn, size_t len)
 }
 NOKPROBE_SYMBOL(patch_insn_write);
 
+/*
+ * Update data that other harts load while it is live, such as the ftrace ops
+ * pointer in front of a function.  It must be naturally aligned so that the
+ * single store here cannot be observed torn.
+ */
+int patch_literal_write(void *addr, unsigned long val)
+{
+	if (WARN_ON_ONCE(!IS_ALIGNED((uintptr_t)addr, sizeof(val))))
+		return -EINVAL;
+
+	return __patch_literal_write(addr, val);
+}
+NOKPROBE_SYMBOL(patch_literal_write);
+
 int patch_text_nosync(void *addr, const void *insns, size_t len)
 {
 	u32 *tp = addr;
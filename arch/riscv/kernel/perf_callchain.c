@@ -6,23 +6,61 @@
 
 #include <asm/stacktrace.h>
 
+/*
+ * Frame records of consecutive calls are usually a few dozen bytes apart, so
+ * the user stack is read a window at a time rather than a record at a time.
+ */
+#define USER_STACK_WINDOW	256
+
+struct user_stack_window {
+	unsigned long base;
+	unsigned long len;
+	u8 buf[USER_STACK_WINDOW];
+};
+
+static bool user_stack_read(struct user_stack_window *win, unsigned long addr,
+			    struct stackframe *frame)
+{
+	unsigned long len;
+
+	/* Written so that a user controlled addr can't wrap around */
+	if (win->len < sizeof(*frame) || addr < win->base ||
+	    addr - win->base > win->len - sizeof(*frame)) {
+		/*
+		 * Don't cross into the next page, which may not be mapped and
+		 * would make the whole copy fail.
+		 */
+		len = min_t(unsigned long, USER_STACK_WINDOW,
+			    PAGE_SIZE - offset_in_page(addr));
+		if (len < sizeof(*frame))
+			len = sizeof(*frame);
+
+		if (!access_ok((void __user *)addr, len))
+			return false;
+		if (__copy_from_user_inatomic(win->buf, (void __user *)addr, len))
+			return false;
+
+		win->base = addr;
+		win->len = len;
+	}
+
+	memcpy(frame, win->buf + (addr - win->base), sizeof(*frame));
+
+	return true;
+}
+
 /*
  * Get the return address for a single stackframe and return a pointer to the
  * next frame tail.
  */
 static unsigned long user_backtrace(struct perf_callchain_entry_ctx *entry,
+				    struct user_stack_window *win,
 				    unsigned long fp, unsigned long reg_ra)
 {
 	struct stackframe buftail;
 	unsigned long ra = 0;
-	unsigned long __user *user_frame_tail =
-		(unsigned long __user *)(fp - sizeof(struct stackframe));
 
-	/* Check accessibility of one struct frame_tail beyond */
-	if (!access_ok(user_frame_tail, sizeof(buftail)))
-		return 0;
-	if (__copy_from_user_inatomic(&buftail, user_frame_tail,
-				      sizeof(buftail)))
+	if (!user_stack_read(win, fp - sizeof(struct stackframe), &buftail))
 		return 0;
 
 	if (reg_ra != 0)
@@ -56,14 +94,15 @@ static unsigned long user_backtrace(struct perf_callchain_entry_ctx *entry,
 void perf_callchain_user(struct perf_callchain_entry_ctx *entry,
 			 struct pt_regs *regs)
 {
+	struct user_stack_window win = { 0 };
 	unsigned long fp = 0;
 
 	fp = regs->s0;
 	perf_callchain_store(entry, regs->epc);
 
-	fp = user_backtrace(entry, fp, regs->ra);
+	fp = user_backtrace(entry, &win, fp, regs->ra);
 	while (fp && !(fp & 0x3) && entry->nr < entry->max_stack)
-		fp = user_backtrace(entry, fp, 0);
+		fp = user_backtrace(entry, &win, fp, 0);
 }
 
 static bool fill_callchain(void *entry, unsigned long pc)
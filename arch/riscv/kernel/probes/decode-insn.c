@@ -37,12 +37,51 @@ riscv_probe_decode_insn(probe_opcode_t *addr, struct arch_probe_insn *api)
 	RISCV_INSN_SET_SIMULATE(c_jalr,		insn);
 	RISCV_INSN_SET_SIMULATE(c_beqz,		insn);
 	RISCV_INSN_SET_SIMULATE(c_bnez,		insn);
+	RISCV_INSN_SET_SIMULATE(c_addi,		insn);
+	RISCV_INSN_SET_SIMULATE(c_addi16sp,	insn);
+	RISCV_INSN_SET_SIMULATE(c_addi4spn,	insn);
+	RISCV_INSN_SET_SIMULATE(c_li,		insn);
+	RISCV_INSN_SET_SIMULATE(c_lui,		insn);
+	RISCV_INSN_SET_SIMULATE(c_mv,		insn);
 #endif
 
 	RISCV_INSN_SET_SIMULATE(jal,		insn);
 	RISCV_INSN_SET_SIMULATE(jalr,		insn);
 	RISCV_INSN_SET_SIMULATE(auipc,		insn);
 	RISCV_INSN_SET_SIMULATE(branch,		insn);
+	RISCV_INSN_SET_SIMULATE(addi,		insn);
+	RISCV_INSN_SET_SIMULATE(lui,		insn);
+
+	return INSN_GOOD;
+}
+
+/*
+ * Uprobes may in addition simulate loads and stores, with uaccess helpers
+ * that fail rather than fault. Their handlers return false when the access
+ * fails, and the instruction is then stepped out of line to take the fault
+ * as usual.
+ */
+enum probe_insn
+riscv_probe_decode_user_insn(probe_opcode_t *addr, struct arch_probe_insn *api)
+{
+	probe_opcode_t insn = *addr;
+	enum probe_insn ret;
+
+	ret = riscv_probe_decode_insn(addr, api);
+	if (ret != INSN_GOOD)
+		return ret;
+
+#ifdef CONFIG_RISCV_ISA_C
+	RISCV_INSN_SET_SIMULATE(c_lwsp,		insn);
+	RISCV_INSN_SET_SIMULATE(c_ldsp,		insn);
+	RISCV_INSN_SET_SIMULATE(c_swsp,		insn);
+	RISCV_INSN_SET_SIMULATE(c_sdsp,		insn);
+#endif
+
+	RISCV_INSN_SET_SIMULATE(lw,		insn);
+	RISCV_INSN_SET_SIMULATE(ld,		insn);
+	RISCV_INSN_SET_SIMULATE(sw,		insn);
+	RISCV_INSN_SET_SIMULATE(sd,		insn);
 
 	return INSN_GOOD;
 }
@@ -14,5 +14,7 @@ enum probe_insn {
 
 enum probe_insn __kprobes
 riscv_probe_decode_insn(probe_opcode_t *addr, struct arch_probe_insn *asi);
+enum probe_insn
+riscv_probe_decode_user_insn(probe_opcode_t *addr, struct arch_probe_insn *asi);
 
 #endif /* _RISCV_KERNEL_KPROBES_DECODE_INSN_H */
@@ -1,8 +1,10 @@
 // SPDX-License-Identifier: GPL-2.0+
 
 #include <linux/bitops.h>
+#include <linux/compat.h>
 #include <linux/kernel.h>
 #include <linux/kprobes.h>
+#include <linux/uaccess.h>
 
 #include "decode-insn.h"
 #include "simulate-insn.h"
@@ -293,3 +295,380 @@ bool __kprobes simulate_c_beqz(u32 opcode, unsigned long addr, struct pt_regs *r
 {
 	return simulate_c_bnez_beqz(opcode, addr, regs, false);
 }
+
+bool __kprobes simulate_addi(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	/*
+	 * 31       20 19 15 14 12 11 7 6      0
+	 * | imm[11:0] | rs1 | 000 | rd | opcode |
+	 *      12        5     3    5     OP-IMM
+	 */
+
+	u32 rd = (opcode >> 7) & 0x1f;
+	u32 rs1 = (opcode >> 15) & 0x1f;
+	unsigned long rs1_val;
+
+	if (!rv_insn_reg_get_val(regs, rs1, &rs1_val))
+		return false;
+
+	if (!rv_insn_reg_set_val(regs, rd, rs1_val + sign_extend32(opcode >> 20, 11)))
+		return false;
+
+	instruction_pointer_set(regs, addr + 4);
+
+	return true;
+}
+
+bool __kprobes simulate_lui(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	/*
+	 *  31        12 11 7 6      0
+	 * | imm[31:12] | rd | opcode |
+	 *       20       5     LUI
+	 */
+
+	u32 rd = (opcode >> 7) & 0x1f;
+
+	if (!rv_insn_reg_set_val(regs, rd, (long)(s32)(opcode & 0xfffff000)))
+		return false;
+
+	instruction_pointer_set(regs, addr + 4);
+
+	return true;
+}
+
+/* The 6-bit immediate of C.ADDI, C.LI and C.LUI: imm[5] at 12, imm[4:0] at 6:2 */
+static inline s32 rvc_ci_imm(u32 opcode)
+{
+	return sign_extend32((((opcode >> 12) & 0x1) << 5) |
+			     ((opcode >> 2) & 0x1f), 5);
+}
+
+bool __kprobes simulate_c_addi(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	/*
+	 *  15    13 12     11   7 6        2 1  0
+	 * | funct3 | imm[5] | rd | imm[4:0] | op |
+	 *     3        1      5       5       2
+	 */
+
+	u32 rd = (opcode >> 7) & 0x1f;
+	unsigned long rd_val;
+
+	if (!rv_insn_reg_get_val(regs, rd, &rd_val))
+		return false;
+
+	if (!rv_insn_reg_set_val(regs, rd, rd_val + rvc_ci_imm(opcode)))
+		return false;
+
+	instruction_pointer_set(regs, addr + 2);
+
+	return true;
+}
+
+bool __kprobes simulate_c_li(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	u32 rd = (opcode >> 7) & 0x1f;
+
+	if (!rv_insn_reg_set_val(regs, rd, rvc_ci_imm(opcode)))
+		return false;
+
+	instruction_pointer_set(regs, addr + 2);
+
+	return true;
+}
+
+bool __kprobes simulate_c_lui(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	u32 rd = (opcode >> 7) & 0x1f;
+
+	if (!rv_insn_reg_set_val(regs, rd, (long)rvc_ci_imm(opcode) << 12))
+		return false;
+
+	instruction_pointer_set(regs, addr + 2);
+
+	return true;
+}
+
+bool __kprobes simulate_c_addi16sp(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	/*
+	 *  15    13 12       11 7 6                 2 1  0
+	 * | funct3 | imm[9] | 2 | imm[4|6|8:7|5]    | op |
+	 *     3        1      5           5           2
+	 */
+
+	s32 imm;
+
+	imm  = ((opcode >> 6)  & 0x1) << 4;
+	imm |= ((opcode >> 2)  & 0x1) << 5;
+	imm |= ((opcode >> 5)  & 0x1) << 6;
+	imm |= ((opcode >> 3)  & 0x3) << 7;
+	imm |= ((opcode >> 12) & 0x1) << 9;
+
+	regs->sp += sign_extend32(imm, 9);
+	instruction_pointer_set(regs, addr + 2);
+
+	return true;
+}
+
+bool __kprobes simulate_c_addi4spn(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	/*
+	 *  15    13 12                   5 4   2 1  0
+	 * | funct3 | nzuimm[5:4|9:6|2|3] | rd' | op |
+	 *     3              8              3    2
+	 */
+
+	u32 rd = 0x8 | ((opcode >> 2) & 0x7);
+	u32 imm;
+
+	imm  = ((opcode >> 6)  & 0x1) << 2;
+	imm |= ((opcode >> 5)  & 0x1) << 3;
+	imm |= ((opcode >> 11) & 0x3) << 4;
+	imm |= ((opcode >> 7)  & 0xf) << 6;
+
+	if (!rv_insn_reg_set_val(regs, rd, regs->sp + imm))
+		return false;
+
+	instruction_pointer_set(regs, addr + 2);
+
+	return true;
+}
+
+bool __kprobes simulate_c_mv(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	/*
+	 *  15    12 11  7 6   2 1  0
+	 * | funct4 | rd  | rs2 | op |
+	 *     4       5     5    2
+	 */
+
+	u32 rd = (opcode >> 7) & 0x1f;
+	u32 rs2 = (opcode >> 2) & 0x1f;
+	unsigned long rs2_val;
+
+	if (!rv_insn_reg_get_val(regs, rs2, &rs2_val))
+		return false;
+
+	if (!rv_insn_reg_set_val(regs, rd, rs2_val))
+		return false;
+
+	instruction_pointer_set(regs, addr + 2);
+
+	return true;
+}
+
+/*
+ * User loads and stores, for uprobes only. Nothing is changed when the access
+ * fails, so that the instruction can still be stepped out of line.
+ *
+ * The decoder matches the RV64 encodings. A compat task has no LD/SD, and
+ * C.LDSP/C.SDSP are C.FLWSP/C.FSWSP there, so 8 byte accesses are left to
+ * be stepped out of line. Its effective addresses wrap at 32 bits.
+ */
+static bool __kprobes simulate_user_addr(int size, unsigned long *uaddr)
+{
+	if (!is_compat_task())
+		return true;
+
+	if (size != 4)
+		return false;
+
+	*uaddr = (u32)*uaddr;
+
+	return true;
+}
+
+static bool __kprobes simulate_user_load(u32 rd, unsigned long uaddr, int size,
+					 unsigned long addr, int len,
+					 struct pt_regs *regs)
+{
+	void __user *p;
+	unsigned long val;
+
+	if (!simulate_user_addr(size, &uaddr))
+		return false;
+
+	p = (void __user *)uaddr;
+	if (size == 4) {
+		s32 val32;
+
+		if (get_user(val32, (s32 __user *)p))
+			return false;
+		val = val32;
+	} else {
+		u64 val64;
+
+		if (get_user(val64, (u64 __user *)p))
+			return false;
+		val = val64;
+	}
+
+	if (!rv_insn_reg_set_val(regs, rd, val))
+		return false;
+
+	instruction_pointer_set(regs, addr + len);
+
+	return true;
+}
+
+static bool __kprobes simulate_user_store(u32 rs2, unsigned long uaddr, int size,
+					  unsigned long addr, int len,
+					  struct pt_regs *regs)
+{
+	void __user *p;
+	unsigned long val;
+	int err;
+
+	if (!simulate_user_addr(size, &uaddr))
+		return false;
+
+	if (!rv_insn_reg_get_val(regs, rs2, &val))
+		return false;
+
+	p = (void __user *)uaddr;
+	if (size == 4)
+		err = put_user((u32)val, (u32 __user *)p);
+	else
+		err = put_user((u64)val, (u64 __user *)p);
+	if (err)
+		return false;
+
+	instruction_pointer_set(regs, addr + len);
+
+	return true;
+}
+
+static bool __kprobes simulate_load(u32 opcode, unsigned long addr,
+				    struct pt_regs *regs, int size)
+{
+	/*
+	 * 31       20 19 15 14    12 11 7 6      0
+	 * | imm[11:0] | rs1 | funct3 | rd | opcode |
+	 *      12        5      3      5     LOAD
+	 */
+
+	u32 rd = (opcode >> 7) & 0x1f;
+	u32 rs1 = (opcode >> 15) & 0x1f;
+	unsigned long base;
+
+	if (!rv_insn_reg_get_val(regs, rs1, &base))
+		return false;
+
+	return simulate_user_load(rd, base + sign_extend32(opcode >> 20, 11),
+				  size, addr, 4, regs);
+}
+
+static bool __kprobes simulate_store(u32 opcode, unsigned long addr,
+				     struct pt_regs *regs, int size)
+{
+	/*
+	 * 31       25 24 20 19 15 14    12 11       7 6      0
+	 * | imm[11:5] | rs2 | rs1 | funct3 | imm[4:0] | opcode |
+	 *      7         5     5      3         5        STORE
+	 */
+
+	u32 rs1 = (opcode >> 15) & 0x1f;
+	u32 rs2 = (opcode >> 20) & 0x1f;
+	unsigned long base;
+	u32 imm;
+
+	if (!rv_insn_reg_get_val(regs, rs1, &base))
+		return false;
+
+	imm = (((opcode >> 25) & 0x7f) << 5) | ((opcode >> 7) & 0x1f);
+
+	return simulate_user_store(rs2, base + sign_extend32(imm, 11),
+				   size, addr, 4, regs);
+}
+
+bool __kprobes simulate_lw(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	return simulate_load(opcode, addr, regs, 4);
+}
+
+bool __kprobes simulate_ld(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	return simulate_load(opcode, addr, regs, 8);
+}
+
+bool __kprobes simulate_sw(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	return simulate_store(opcode, addr, regs, 4);
+}
+
+bool __kprobes simulate_sd(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	return simulate_store(opcode, addr, regs, 8);
+}
+
+bool __kprobes simulate_c_lwsp(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	/*
+	 *  15    13 12        11 7 6                 2 1  0
+	 * | funct3 | uimm[5] | rd | uimm[4:2|7:6]    | op |
+	 *     3        1       5           5           2
+	 */
+
+	u32 imm;
+
+	imm  = ((opcode >> 4)  & 0x7) << 2;
+	imm |= ((opcode >> 12) & 0x1) << 5;
+	imm |= ((opcode >> 2)  & 0x3) << 6;
+
+	return simulate_user_load((opcode >> 7) & 0x1f, regs->sp + imm, 4,
+				  addr, 2, regs);
+}
+
+bool __kprobes simulate_c_ldsp(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	/*
+	 *  15    13 12        11 7 6                 2 1  0
+	 * | funct3 | uimm[5] | rd | uimm[4:3|8:6]    | op |
+	 *     3        1       5           5           2
+	 */
+
+	u32 imm;
+
+	imm  = ((opcode >> 5)  & 0x3) << 3;
+	imm |= ((opcode >> 12) & 0x1) << 5;
+	imm |= ((opcode >> 2)  & 0x7) << 6;
+
+	return simulate_user_load((opcode >> 7) & 0x1f, regs->sp + imm, 8,
+				  addr, 2, regs);
+}
+
+bool __kprobes simulate_c_swsp(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	/*
+	 *  15    13 12               7 6   2 1  0
+	 * | funct3 | uimm[5:2|7:6]    | rs2 | op |
+	 *     3             6            5    2
+	 */
+
+	u32 imm;
+
+	imm  = ((opcode >> 9) & 0xf) << 2;
+	imm |= ((opcode >> 7) & 0x3) << 6;
+
+	return simulate_user_store((opcode >> 2) & 0x1f, regs->sp + imm, 4,
+				   addr, 2, regs);
+}
+
+bool __kprobes simulate_c_sdsp(u32 opcode, unsigned long addr, struct pt_regs *regs)
+{
+	/*
+	 *  15    13 12               7 6   2 1  0
+	 * | funct3 | uimm[5:3|8:6]    | rs2 | op |
+	 *     3             6            5    2
+	 */
+
+	u32 imm;
+
+	imm  = ((opcode >> 10) & 0x7) << 3;
+	imm |= ((opcode >> 7)  & 0x7) << 6;
+
+	return simulate_user_store((opcode >> 2) & 0x1f, regs->sp + imm, 8,
+				   addr, 2, regs);
+}
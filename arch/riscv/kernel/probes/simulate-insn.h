@@ -29,5 +29,21 @@ bool simulate_c_jr(u32 opcode, unsigned long addr, struct pt_regs *regs);
 bool simulate_c_jalr(u32 opcode, unsigned long addr, struct pt_regs *regs);
 bool simulate_c_bnez(u32 opcode, unsigned long addr, struct pt_regs *regs);
 bool simulate_c_beqz(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_addi(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_lui(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_c_addi(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_c_addi16sp(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_c_addi4spn(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_c_li(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_c_lui(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_c_mv(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_lw(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_ld(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_sw(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_sd(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_c_lwsp(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_c_ldsp(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_c_swsp(u32 opcode, unsigned long addr, struct pt_regs *regs);
+bool simulate_c_sdsp(u32 opcode, unsigned long addr, struct pt_regs *regs);
 
 #endif /* _RISCV_KERNEL_PROBES_SIMULATE_INSN_H */
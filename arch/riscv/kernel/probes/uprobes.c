@@ -37,7 +37,7 @@ int arch_uprobe_analyze_insn(struct arch_uprobe *auprobe, struct mm_struct *mm,
 
 	auprobe->insn_size = GET_INSN_LENGTH(opcode);
 
-	switch (riscv_probe_decode_insn(&opcode, &auprobe->api)) {
+	switch (riscv_probe_decode_user_insn(&opcode, &auprobe->api)) {
 	case INSN_REJECTED:
 		return -EINVAL;
 
@@ -99,8 +99,9 @@ bool arch_uprobe_skip_sstep(struct arch_uprobe *auprobe, struct pt_regs *regs)
 	insn = *(probe_opcode_t *)(&auprobe->insn[0]);
 	addr = instruction_pointer(regs);
 
+	/* Step out of line if the simulation couldn't complete */
 	if (auprobe->api.handler)
-		auprobe->api.handler(insn, addr, regs);
+		return auprobe->api.handler(insn, addr, regs);
 
 	return true;
 }
@@ -92,6 +92,7 @@ static int riscv_vr_get(struct task_struct *target,
 	struct __riscv_v_ext_state *vstate = &target->thread.vstate;
 	struct __riscv_v_regset_state ptrace_vstate;
 
+	riscv_v_vstate_unpark(target, task_pt_regs(target));
 	if (!riscv_v_vstate_query(task_pt_regs(target)))
 		return -EINVAL;
 
@@ -127,6 +128,7 @@ static int riscv_vr_set(struct task_struct *target,
 	struct __riscv_v_ext_state *vstate = &target->thread.vstate;
 	struct __riscv_v_regset_state ptrace_vstate;
 
+	riscv_v_vstate_unpark(target, task_pt_regs(target));
 	if (!riscv_v_vstate_query(task_pt_regs(target)))
 		return -EINVAL;
 
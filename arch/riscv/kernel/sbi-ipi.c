@@ -11,6 +11,7 @@
 #include <linux/irq.h>
 #include <linux/irqchip/chained_irq.h>
 #include <linux/irqdomain.h>
+#include <asm/paravirt.h>
 #include <asm/sbi.h>
 
 static int sbi_ipi_virq;
@@ -22,6 +23,7 @@ static void sbi_ipi_handle(struct irq_desc *desc)
 	chained_irq_enter(chip, desc);
 
 	csr_clear(CSR_IP, IE_SIE);
+	pv_apf_page_ready();
 	ipi_mux_process();
 
 	chained_irq_exit(chip, desc);
@@ -54,7 +56,8 @@ void __init sbi_ipi_init(void)
 		return;
 	}
 
-	virq = ipi_mux_create(BITS_PER_BYTE, sbi_send_ipi);
+	virq = ipi_mux_create_mask(BITS_PER_BYTE, sbi_send_ipi,
+				   sbi_send_ipi_mask);
 	if (virq <= 0) {
 		pr_err("unable to create muxed IPIs\n");
 		irq_dispose_mapping(sbi_ipi_virq);
@@ -74,4 +77,7 @@ void __init sbi_ipi_init(void)
 
 	riscv_ipi_set_virq_range(virq, BITS_PER_BYTE, false);
 	pr_info("providing IPIs using SBI IPI extension\n");
+
+	/* Page ready notifications share the software interrupt. */
+	pv_apf_init();
 }
@@ -13,6 +13,7 @@
 #include <asm/sbi.h>
 #include <asm/smp.h>
 #include <asm/tlbflush.h>
+#include <asm/trap_stats.h>
 
 /* default SBI version is 0.1 */
 unsigned long sbi_spec_version __ro_after_init = SBI_SPEC_VERSION_DEFAULT;
@@ -20,6 +21,7 @@ EXPORT_SYMBOL(sbi_spec_version);
 
 static void (*__sbi_set_timer)(uint64_t stime) __ro_after_init;
 static void (*__sbi_send_ipi)(unsigned int cpu) __ro_after_init;
+static void (*__sbi_send_ipi_mask)(const struct cpumask *cpu_mask) __ro_after_init;
 static int (*__sbi_rfence)(int fid, const struct cpumask *cpu_mask,
 			   unsigned long start, unsigned long size,
 			   unsigned long arg4, unsigned long arg5) __ro_after_init;
@@ -30,6 +32,7 @@ struct sbiret sbi_ecall(int ext, int fid, unsigned long arg0,
 			unsigned long arg5)
 {
 	struct sbiret ret;
+	u64 start = riscv_trap_stats_start();
 
 	register uintptr_t a0 asm ("a0") = (uintptr_t)(arg0);
 	register uintptr_t a1 asm ("a1") = (uintptr_t)(arg1);
@@ -46,6 +49,8 @@ struct sbiret sbi_ecall(int ext, int fid, unsigned long arg0,
 	ret.error = a0;
 	ret.value = a1;
 
+	riscv_sbi_stats_end(ext, fid, start);
+
 	return ret;
 }
 EXPORT_SYMBOL(sbi_ecall);
@@ -156,6 +161,14 @@ static void __sbi_send_ipi_v01(unsigned int cpu)
 		  0, 0, 0, 0, 0);
 }
 
+static void __sbi_send_ipi_mask_v01(const struct cpumask *cpu_mask)
+{
+	unsigned long hart_mask = __sbi_v01_cpumask_to_hartmask(cpu_mask);
+
+	sbi_ecall(SBI_EXT_0_1_SEND_IPI, 0, (unsigned long)(&hart_mask),
+		  0, 0, 0, 0, 0);
+}
+
 static int __sbi_rfence_v01(int fid, const struct cpumask *cpu_mask,
 			    unsigned long start, unsigned long size,
 			    unsigned long arg4, unsigned long arg5)
@@ -208,6 +221,12 @@ static void __sbi_send_ipi_v01(unsigned int cpu)
 		sbi_major_version(), sbi_minor_version());
 }
 
+static void __sbi_send_ipi_mask_v01(const struct cpumask *cpu_mask)
+{
+	pr_warn("IPI extension is not available in SBI v%lu.%lu\n",
+		sbi_major_version(), sbi_minor_version());
+}
+
 static int __sbi_rfence_v01(int fid, const struct cpumask *cpu_mask,
 			    unsigned long start, unsigned long size,
 			    unsigned long arg4, unsigned long arg5)
@@ -246,6 +265,49 @@ static void __sbi_send_ipi_v02(unsigned int cpu)
 	}
 }
 
+static void __sbi_send_ipi_v02_call(unsigned long hmask, unsigned long hbase)
+{
+	struct sbiret ret;
+
+	ret = sbi_ecall(SBI_EXT_IPI, SBI_EXT_IPI_SEND_IPI,
+			hmask, hbase, 0, 0, 0, 0);
+	if (ret.error)
+		pr_err("%s: hbase = [%lu] hmask = [0x%lx] failed (error [%d])\n",
+		       __func__, hbase, hmask,
+		       sbi_err_map_linux_errno(ret.error));
+}
+
+/* One ecall per BITS_PER_LONG window of hart IDs, as for remote fences. */
+static void __sbi_send_ipi_mask_v02(const struct cpumask *cpu_mask)
+{
+	unsigned long hartid, cpuid, hmask = 0, hbase = 0, htop = 0;
+
+	for_each_cpu(cpuid, cpu_mask) {
+		hartid = cpuid_to_hartid_map(cpuid);
+		if (hmask) {
+			if (hartid + BITS_PER_LONG <= htop ||
+			    hbase + BITS_PER_LONG <= hartid) {
+				__sbi_send_ipi_v02_call(hmask, hbase);
+				hmask = 0;
+			} else if (hartid < hbase) {
+				/* shift the mask to fit lower hartid */
+				hmask <<= hbase - hartid;
+				hbase = hartid;
+			}
+		}
+		if (!hmask) {
+			hbase = hartid;
+			htop = hartid;
+		} else if (hartid > htop) {
+			htop = hartid;
+		}
+		hmask |= BIT(hartid - hbase);
+	}
+
+	if (hmask)
+		__sbi_send_ipi_v02_call(hmask, hbase);
+}
+
 static int __sbi_rfence_v02_call(unsigned long fid, unsigned long hmask,
 				 unsigned long hbase, unsigned long start,
 				 unsigned long size, unsigned long arg4,
@@ -365,6 +427,16 @@ void sbi_send_ipi(unsigned int cpu)
 }
 EXPORT_SYMBOL(sbi_send_ipi);
 
+/**
+ * sbi_send_ipi_mask() - Send an IPI to a set of harts.
+ * @cpu_mask: Logical ids of the target CPUs.
+ */
+void sbi_send_ipi_mask(const struct cpumask *cpu_mask)
+{
+	__sbi_send_ipi_mask(cpu_mask);
+}
+EXPORT_SYMBOL(sbi_send_ipi_mask);
+
 /**
  * sbi_remote_fence_i() - Execute FENCE.I instruction on given remote harts.
  * @cpu_mask: A cpu mask containing all the target harts.
@@ -632,6 +704,25 @@ int sbi_debug_console_read(char *bytes, unsigned int num_bytes)
 	return ret.error ? sbi_err_map_linux_errno(ret.error) : ret.value;
 }
 
+static bool sbi_fwft_available;
+
+/*
+ * Sets a firmware feature for the calling hart only; FWFT settings are per
+ * hart, so this has to be called on each of them.
+ */
+int sbi_fwft_set(u32 feature, unsigned long value, unsigned long flags)
+{
+	struct sbiret ret;
+
+	if (!sbi_fwft_available)
+		return -EOPNOTSUPP;
+
+	ret = sbi_ecall(SBI_EXT_FWFT, SBI_EXT_FWFT_SET,
+			feature, value, flags, 0, 0, 0);
+
+	return sbi_err_map_linux_errno(ret.error);
+}
+
 void __init sbi_init(void)
 {
 	int ret;
@@ -655,9 +746,11 @@ void __init sbi_init(void)
 		}
 		if (sbi_probe_extension(SBI_EXT_IPI)) {
 			__sbi_send_ipi	= __sbi_send_ipi_v02;
+			__sbi_send_ipi_mask = __sbi_send_ipi_mask_v02;
 			pr_info("SBI IPI extension detected\n");
 		} else {
 			__sbi_send_ipi	= __sbi_send_ipi_v01;
+			__sbi_send_ipi_mask = __sbi_send_ipi_mask_v01;
 		}
 		if (sbi_probe_extension(SBI_EXT_RFENCE)) {
 			__sbi_rfence	= __sbi_rfence_v02;
@@ -678,9 +771,15 @@ void __init sbi_init(void)
 			pr_info("SBI DBCN extension detected\n");
 			sbi_debug_console_available = true;
 		}
+		if ((sbi_spec_version >= sbi_mk_version(3, 0)) &&
+		    (sbi_probe_extension(SBI_EXT_FWFT) > 0)) {
+			pr_info("SBI FWFT extension detected\n");
+			sbi_fwft_available = true;
+		}
 	} else {
 		__sbi_set_timer = __sbi_set_timer_v01;
 		__sbi_send_ipi	= __sbi_send_ipi_v01;
+		__sbi_send_ipi_mask = __sbi_send_ipi_mask_v01;
 		__sbi_rfence	= __sbi_rfence_v01;
 	}
 }
@@ -19,7 +19,9 @@
 #include <linux/sched/task.h>
 #include <linux/smp.h>
 #include <linux/efi.h>
+#include <linux/export.h>
 #include <linux/crash_dump.h>
+#include <linux/jump_label.h>
 #include <linux/panic_notifier.h>
 
 #include <asm/acpi.h>
@@ -28,6 +30,7 @@
 #include <asm/cpufeature.h>
 #include <asm/early_ioremap.h>
 #include <asm/pgtable.h>
+#include <asm/qspinlock_paravirt.h>
 #include <asm/setup.h>
 #include <asm/set_memory.h>
 #include <asm/sections.h>
@@ -246,6 +249,45 @@ static void __init parse_dtb(void)
 
 extern void __init init_rt_signal_env(void);
 
+#ifdef CONFIG_RISCV_COMBO_SPINLOCKS
+DEFINE_STATIC_KEY_TRUE(qspinlock_key);
+EXPORT_SYMBOL(qspinlock_key);
+#endif
+
+/*
+ * Must run while the boot hart is alone and holds no spinlock: with combo
+ * spinlocks, every lock changes implementation when the key is flipped.
+ */
+static void __init riscv_spinlock_init(void)
+{
+	char *using_ext = NULL;
+
+	if (IS_ENABLED(CONFIG_RISCV_TICKET_SPINLOCKS)) {
+		pr_info("Ticket spinlock: enabled\n");
+		return;
+	}
+
+	if (riscv_isa_extension_available(NULL, ZABHA))
+		using_ext = "using Zabha";
+	else if (riscv_isa_extension_available(NULL, ZICCRSE))
+		using_ext = "using Ziccrse";
+#if defined(CONFIG_RISCV_COMBO_SPINLOCKS)
+	else {
+		static_branch_disable(&qspinlock_key);
+		pr_info("Ticket spinlock: enabled\n");
+		return;
+	}
+#endif
+
+	if (!using_ext)
+		pr_err("Queued spinlock without Zabha or Ziccrse\n");
+	else
+		pr_info("Queued spinlock %s: enabled\n", using_ext);
+
+	if (IS_ENABLED(CONFIG_PARAVIRT_SPINLOCKS))
+		pv_qspinlock_init();
+}
+
 void __init setup_arch(char **cmdline_p)
 {
 	parse_dtb();
@@ -281,8 +323,10 @@ void __init setup_arch(char **cmdline_p)
 	setup_smp();
 #endif
 
-	if (!acpi_disabled)
+	if (!acpi_disabled) {
 		acpi_init_rintc_map();
+		acpi_map_cpus_to_nodes();
+	}
 
 	riscv_init_cbo_blocksizes();
 	riscv_fill_hwcap();
@@ -295,6 +339,7 @@ void __init setup_arch(char **cmdline_p)
 	riscv_set_dma_cache_alignment();
 
 	riscv_user_isa_enable();
+	riscv_spinlock_init();
 }
 
 bool arch_cpu_is_hotpluggable(int cpu)
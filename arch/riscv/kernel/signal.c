@@ -188,6 +188,7 @@ static long restore_sigcontext(struct pt_regs *regs,
 
 			return 0;
 		case RISCV_V_MAGIC:
+			riscv_v_vstate_unpark(current, regs);
 			if (!has_vector() || !riscv_v_vstate_query(regs) ||
 			    size != riscv_v_sc_size)
 				return -EINVAL;
@@ -323,7 +324,11 @@ static int setup_rt_frame(struct ksignal *ksig, sigset_t *set,
 	struct rt_sigframe __user *frame;
 	long err = 0;
 	unsigned long __maybe_unused addr;
-	size_t frame_size = get_rt_frame_size(false);
+	size_t frame_size;
+
+	/* The signal frame must carry the V state even if it is parked */
+	riscv_v_vstate_unpark(current, regs);
+	frame_size = get_rt_frame_size(false);
 
 	frame = get_sigframe(ksig, regs, frame_size);
 	if (!access_ok(frame, frame_size))
@@ -26,6 +26,7 @@
 #include <linux/sched/task_stack.h>
 #include <linux/sched/mm.h>
 
+#include <asm/cacheinfo.h>
 #include <asm/cpufeature.h>
 #include <asm/cpu_ops.h>
 #include <asm/irq.h>
@@ -50,6 +51,7 @@ void __init smp_prepare_cpus(unsigned int max_cpus)
 
 	curr_cpuid = smp_processor_id();
 	store_cpu_topology(curr_cpuid);
+	riscv_update_cluster_siblings(curr_cpuid);
 	numa_store_cpu_info(curr_cpuid);
 	numa_add_cpu(curr_cpuid);
 
@@ -219,6 +221,7 @@ asmlinkage __visible void smp_callin(void)
 	current->active_mm = mm;
 
 	store_cpu_topology(curr_cpuid);
+	riscv_update_cluster_siblings(curr_cpuid);
 	notify_cpu_starting(curr_cpuid);
 
 	riscv_ipi_enable();
@@ -232,6 +235,7 @@ asmlinkage __visible void smp_callin(void)
 	}
 
 	riscv_user_isa_enable();
+	riscv_svadu_enable();
 
 	/*
 	 * Remote TLB flushes are ignored while the CPU is offline, so emit
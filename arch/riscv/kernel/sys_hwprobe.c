@@ -4,9 +4,12 @@
  * are supported by the hardware.  See Documentation/arch/riscv/hwprobe.rst for
  * more details.
  */
+#include <linux/cpu.h>
+#include <linux/cpuhotplug.h>
 #include <linux/syscalls.h>
 #include <asm/cacheflush.h>
 #include <asm/cpufeature.h>
+#include <asm/delay.h>
 #include <asm/hwprobe.h>
 #include <asm/sbi.h>
 #include <asm/switch_to.h>
@@ -183,6 +186,28 @@ static u64 hwprobe_misaligned(const struct cpumask *cpus)
 }
 #endif
 
+#if defined(CONFIG_RISCV_ISA_V) && defined(CONFIG_MMU)
+static u64 hwprobe_vector_usercopy_threshold(const struct cpumask *cpus)
+{
+	u64 threshold = 0;
+	int cpu;
+
+	if (!has_vector())
+		return 0;
+
+	/* Report the size above which vector copies pay off on all the CPUs. */
+	for_each_cpu(cpu, cpus)
+		threshold = max_t(u64, threshold, per_cpu(riscv_v_usercopy_threshold, cpu));
+
+	return threshold;
+}
+#else
+static u64 hwprobe_vector_usercopy_threshold(const struct cpumask *cpus)
+{
+	return 0;
+}
+#endif
+
 static void hwprobe_one_pair(struct riscv_hwprobe *pair,
 			     const struct cpumask *cpus)
 {
@@ -216,6 +241,18 @@ static void hwprobe_one_pair(struct riscv_hwprobe *pair,
 			pair->value = riscv_cboz_block_size;
 		break;
 
+	case RISCV_HWPROBE_KEY_TIME_CSR_FREQ:
+		pair->value = riscv_timebase;
+		break;
+
+	case RISCV_HWPROBE_KEY_VECTOR_USERCOPY_THRESHOLD:
+		pair->value = hwprobe_vector_usercopy_threshold(cpus);
+		break;
+
+	case RISCV_HWPROBE_KEY_TIME_CSR:
+		pair->value = riscv_time_csr_perf;
+		break;
+
 	/*
 	 * For forward compatibility, unknown keys don't fail the whole
 	 * call, but get their element key set to -1 and value set to 0
@@ -373,12 +410,100 @@ static int do_riscv_hwprobe(struct riscv_hwprobe __user *pairs,
 
 #ifdef CONFIG_MMU
 
+static int hwprobe_vdso_nr_classes;
+
+/*
+ * Record which answer set @cpu belongs to, so that the vDSO can answer
+ * queries for any mask of online CPUs by combining the sets of its CPUs.
+ * Callers are serialized by the CPU hotplug lock.
+ */
+static void hwprobe_vdso_classify_cpu(struct arch_vdso_data *avd, unsigned int cpu)
+{
+	u64 values[RISCV_HWPROBE_NR_SLOTS];
+	struct riscv_hwprobe pair;
+	int key, class;
+
+	for (key = 0; key <= RISCV_HWPROBE_MAX_KEY; key++) {
+		if (!riscv_hwprobe_key_is_valid(key))
+			continue;
+		pair.key = key;
+		hwprobe_one_pair(&pair, cpumask_of(cpu));
+		values[riscv_hwprobe_key_slot(key)] = pair.value;
+	}
+
+	for (class = 0; class < hwprobe_vdso_nr_classes; class++) {
+		if (!memcmp(avd->class_hwprobe_values[class], values, sizeof(values)))
+			break;
+	}
+
+	if (class == hwprobe_vdso_nr_classes) {
+		if (class == RISCV_VDSO_HWPROBE_NR_CLASSES) {
+			pr_warn_once("hwprobe: too many CPU classes, vDSO falls back to the syscall\n");
+			WRITE_ONCE(avd->cpu_classes_valid, 0);
+			return;
+		}
+
+		memcpy(avd->class_hwprobe_values[class], values, sizeof(values));
+		hwprobe_vdso_nr_classes++;
+	}
+
+	/* Publish the answers before the CPU points at them. */
+	smp_wmb();
+	WRITE_ONCE(avd->cpu_hwprobe_class[cpu], class);
+}
+
+static int hwprobe_vdso_online_cpu(unsigned int cpu)
+{
+	hwprobe_vdso_classify_cpu(&__arch_get_k_vdso_data()->arch_data, cpu);
+	return 0;
+}
+
+static int hwprobe_vdso_offline_cpu(unsigned int cpu)
+{
+	struct arch_vdso_data *avd = &__arch_get_k_vdso_data()->arch_data;
+
+	WRITE_ONCE(avd->cpu_hwprobe_class[cpu], RISCV_VDSO_HWPROBE_NO_CLASS);
+	return 0;
+}
+
+/*
+ * The class table must reproduce what the syscall reports for all online
+ * CPUs, otherwise riscv_hwprobe_combine() has gone out of sync with
+ * hwprobe_one_pair() and the vDSO must not use it.
+ */
+static bool __init hwprobe_vdso_classes_match(struct arch_vdso_data *avd)
+{
+	int cpu, key, slot;
+	u64 value, this;
+	bool first;
+
+	for (key = 0; key <= RISCV_HWPROBE_MAX_KEY; key++) {
+		slot = riscv_hwprobe_key_slot(key);
+		if (slot < 0)
+			continue;
+
+		value = 0;
+		first = true;
+		for_each_online_cpu(cpu) {
+			this = avd->class_hwprobe_values[avd->cpu_hwprobe_class[cpu]][slot];
+			value = first ? this : riscv_hwprobe_combine(key, value, this);
+			first = false;
+		}
+
+		if (value != avd->all_cpu_hwprobe_values[slot])
+			return false;
+	}
+
+	return true;
+}
+
 static int __init init_hwprobe_vdso_data(void)
 {
 	struct vdso_data *vd = __arch_get_k_vdso_data();
 	struct arch_vdso_data *avd = &vd->arch_data;
 	u64 id_bitsmash = 0;
 	struct riscv_hwprobe pair;
+	unsigned int cpu;
 	int key;
 
 	/*
@@ -386,12 +511,14 @@ static int __init init_hwprobe_vdso_data(void)
 	 * save a syscall in the common case.
 	 */
 	for (key = 0; key <= RISCV_HWPROBE_MAX_KEY; key++) {
+		if (!riscv_hwprobe_key_is_valid(key))
+			continue;
 		pair.key = key;
 		hwprobe_one_pair(&pair, cpu_online_mask);
 
 		WARN_ON_ONCE(pair.key < 0);
 
-		avd->all_cpu_hwprobe_values[key] = pair.value;
+		avd->all_cpu_hwprobe_values[riscv_hwprobe_key_slot(key)] = pair.value;
 		/*
 		 * Smash together the vendor, arch, and impl IDs to see if
 		 * they're all 0 or any negative.
@@ -408,6 +535,29 @@ static int __init init_hwprobe_vdso_data(void)
 	 * vDSO should defer to the kernel for exotic cpu masks.
 	 */
 	avd->homogeneous_cpus = id_bitsmash != 0 && id_bitsmash != -1;
+
+	/*
+	 * Classify the CPUs now and as they come and go, so that the vDSO
+	 * can also answer queries for arbitrary masks on heterogeneous
+	 * systems, including the per-CPU misaligned access speed.
+	 */
+	BUILD_BUG_ON(sizeof(struct vdso_data) * CS_BASES > PAGE_SIZE);
+	memset(avd->cpu_hwprobe_class, RISCV_VDSO_HWPROBE_NO_CLASS,
+	       sizeof(avd->cpu_hwprobe_class));
+	avd->cpu_classes_valid = 1;
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu)
+		hwprobe_vdso_classify_cpu(avd, cpu);
+	if (avd->cpu_classes_valid && !hwprobe_vdso_classes_match(avd)) {
+		WARN_ONCE(1, "hwprobe: vDSO CPU classes don't match the syscall\n");
+		avd->cpu_classes_valid = 0;
+	}
+	cpuhp_setup_state_nocalls_cpuslocked(CPUHP_AP_ONLINE_DYN, "riscv/hwprobe_vdso:online",
+					     hwprobe_vdso_online_cpu,
+					     hwprobe_vdso_offline_cpu);
+	cpus_read_unlock();
+
 	return 0;
 }
 
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * IPI round-trip latency microbenchmark
+ *
+ * Measures synchronous smp_call_function_single() to another online CPU,
+ * which is one IPI there and a completion back, the same path taken by
+ * remote TLB shootdowns and icache flushes.
+ */
+
+#include <linux/cpumask.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/smp.h>
+#include <kunit/test.h>
+
+#define IPI_LATENCY_WARMUP	100
+#define IPI_LATENCY_ITERS	10000
+
+static void ipi_latency_nop(void *info)
+{
+}
+
+static void ipi_latency_measure(struct kunit *test)
+{
+	u64 start, elapsed, min = U64_MAX, max = 0, total = 0;
+	int this_cpu, target, i, ret;
+
+	if (num_online_cpus() < 2)
+		kunit_skip(test, "needs at least two online CPUs");
+
+	cpus_read_lock();
+
+	this_cpu = get_cpu();
+	target = cpumask_any_but(cpu_online_mask, this_cpu);
+	put_cpu();
+
+	for (i = 0; i < IPI_LATENCY_WARMUP; i++)
+		smp_call_function_single(target, ipi_latency_nop, NULL, 1);
+
+	for (i = 0; i < IPI_LATENCY_ITERS; i++) {
+		start = ktime_get_ns();
+		ret = smp_call_function_single(target, ipi_latency_nop, NULL, 1);
+		elapsed = ktime_get_ns() - start;
+		if (ret)
+			break;
+
+		total += elapsed;
+		min = min(min, elapsed);
+		max = max(max, elapsed);
+	}
+
+	cpus_read_unlock();
+
+	KUNIT_ASSERT_EQ(test, ret, 0);
+
+	kunit_info(test, "IPI round trip to CPU%d: avg %llu ns, min %llu ns, max %llu ns\n",
+		   target, div_u64(total, IPI_LATENCY_ITERS), min, max);
+}
+
+static struct kunit_case riscv_ipi_latency_test_cases[] = {
+	KUNIT_CASE_SLOW(ipi_latency_measure),
+	{}
+};
+
+static struct kunit_suite riscv_ipi_latency_test_suite = {
+	.name = "riscv_ipi_latency",
+	.test_cases = riscv_ipi_latency_test_cases,
+};
+
+kunit_test_suites(&riscv_ipi_latency_test_suite);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("RISC-V IPI latency microbenchmark");
@@ -9,6 +9,7 @@
 #include <linux/clockchips.h>
 #include <linux/clocksource.h>
 #include <linux/delay.h>
+#include <asm/hwprobe.h>
 #include <asm/sbi.h>
 #include <asm/processor.h>
 #include <asm/timex.h>
@@ -17,6 +18,41 @@
 unsigned long riscv_timebase __ro_after_init;
 EXPORT_SYMBOL_GPL(riscv_timebase);
 
+unsigned int riscv_time_csr_perf __ro_after_init = RISCV_HWPROBE_TIME_CSR_UNKNOWN;
+
+#define TIME_CSR_PROBE_READS	256
+#define TIME_CSR_EMULATED_NS	100
+
+/*
+ * Some firmware emulates the time CSR, which turns every read, including the
+ * ones of the vDSO clock_gettime(), into a trap to M-mode. A native read takes
+ * a few cycles, an emulated one hundreds of nanoseconds, so time a burst of
+ * reads against the timebase and let user space know through hwprobe. Only
+ * the boot hart is measured, the other harts are assumed to behave alike.
+ */
+static void __init riscv_time_csr_probe(void)
+{
+	u64 start, end = 0, ns;
+	int i;
+
+	if (IS_ENABLED(CONFIG_RISCV_M_MODE))
+		return;
+
+	start = get_cycles64();
+	for (i = 0; i < TIME_CSR_PROBE_READS; i++)
+		end = get_cycles64();
+
+	ns = div_u64((end - start) * NSEC_PER_SEC, riscv_timebase);
+	ns = div_u64(ns, TIME_CSR_PROBE_READS);
+
+	if (ns >= TIME_CSR_EMULATED_NS) {
+		pr_info("time CSR reads are emulated, %llu ns each\n", ns);
+		riscv_time_csr_perf = RISCV_HWPROBE_TIME_CSR_EMULATED;
+	} else {
+		riscv_time_csr_perf = RISCV_HWPROBE_TIME_CSR_FAST;
+	}
+}
+
 void __init time_init(void)
 {
 	struct device_node *cpu;
@@ -43,6 +79,8 @@ void __init time_init(void)
 
 	lpj_fine = riscv_timebase / HZ;
 
+	riscv_time_csr_probe();
+
 	timer_probe();
 
 	tick_setup_hrtimer_broadcast();
@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Frequency invariance from the cycle and time counters.
+ *
+ * The cycle counter runs at the current frequency of the hart and the time
+ * counter at the constant timebase, so their ratio over a tick, scaled by the
+ * maximum frequency of the hart, is the frequency scale the scheduler wants.
+ * This is the RISC-V counterpart of the arm64 AMU based invariance.
+ */
+
+#include <linux/arch_topology.h>
+#include <linux/cpufreq.h>
+#include <linux/delay.h>
+#include <linux/init.h>
+#include <linux/percpu.h>
+#include <linux/smp.h>
+#include <linux/stringify.h>
+
+#include <asm/asm-extable.h>
+#include <asm/cpufeature.h>
+#include <asm/csr.h>
+#include <asm/timex.h>
+#include <asm/topology.h>
+
+/*
+ * Make cycle_fie_scale_freq_tick() return SCHED_CAPACITY_SCALE until the
+ * maximum frequency of the hart is known.
+ */
+static DEFINE_PER_CPU_READ_MOSTLY(unsigned long, arch_max_freq_scale) = 1UL << (2 * SCHED_CAPACITY_SHIFT);
+static DEFINE_PER_CPU(u64, arch_time_prev);
+static DEFINE_PER_CPU(u64, arch_cycles_prev);
+static cpumask_var_t cycle_fie_cpus;
+
+static u64 read_cycles64(void)
+{
+#ifdef CONFIG_64BIT
+	return csr_read(CSR_CYCLE);
+#else
+	u32 hi, lo;
+
+	do {
+		hi = csr_read(CSR_CYCLEH);
+		lo = csr_read(CSR_CYCLE);
+	} while (hi != csr_read(CSR_CYCLEH));
+
+	return ((u64)hi << 32) | lo;
+#endif
+}
+
+void freq_inv_set_max_ratio(int cpu, u64 max_rate)
+{
+	u64 ratio, ref_rate = riscv_timebase;
+
+	if (unlikely(!max_rate || !ref_rate)) {
+		WARN_ONCE(1, "CPU%d: invalid maximum or reference frequency.\n",
+			  cpu);
+		return;
+	}
+
+	/*
+	 *			    ref_rate
+	 * arch_max_freq_scale =   ---------- * SCHED_CAPACITY_SCALE²
+	 *			    max_rate
+	 *
+	 * The extra SCHED_CAPACITY_SCALE keeps the resolution for timebases
+	 * far below the CPU frequency.
+	 */
+	ratio = ref_rate << (2 * SCHED_CAPACITY_SHIFT);
+	ratio = div64_u64(ratio, max_rate);
+	if (!ratio) {
+		WARN_ONCE(1, "Reference frequency too low.\n");
+		return;
+	}
+
+	WRITE_ONCE(per_cpu(arch_max_freq_scale, cpu), (unsigned long)ratio);
+}
+
+static void cycle_fie_scale_freq_tick(void)
+{
+	u64 prev_cycles, prev_time, cycles, time, scale;
+
+	prev_cycles = this_cpu_read(arch_cycles_prev);
+	prev_time = this_cpu_read(arch_time_prev);
+
+	cycles = read_cycles64();
+	time = get_cycles64();
+	this_cpu_write(arch_cycles_prev, cycles);
+	this_cpu_write(arch_time_prev, time);
+
+	/* First tick, or the counters were reset by suspend. */
+	if (unlikely(cycles <= prev_cycles || time <= prev_time))
+		return;
+
+	/*
+	 *	    /\cycles   arch_max_freq_scale
+	 * scale =  -------- * --------------------
+	 *	    /\time     SCHED_CAPACITY_SCALE
+	 */
+	scale = cycles - prev_cycles;
+	scale *= this_cpu_read(arch_max_freq_scale);
+	scale = div64_u64(scale >> SCHED_CAPACITY_SHIFT, time - prev_time);
+
+	scale = min_t(unsigned long, scale, SCHED_CAPACITY_SCALE);
+	this_cpu_write(arch_freq_scale, (unsigned long)scale);
+}
+
+static struct scale_freq_data cycle_sfd = {
+	.source = SCALE_FREQ_SOURCE_ARCH,
+	.set_freq_scale = cycle_fie_scale_freq_tick,
+};
+
+/*
+ * The read raises an illegal instruction exception when firmware leaves
+ * mcounteren.CY clear, and in guests whose hypervisor doesn't back the
+ * counter, so probe it with a fixup.
+ */
+static bool cycle_csr_read_safe(unsigned long *cycles)
+{
+	unsigned long val;
+	int err = 0;
+
+	asm volatile("1:	csrr	%1, " __stringify(CSR_CYCLE) "\n"
+		     "2:\n"
+		     _ASM_EXTABLE_UACCESS_ERR_ZERO(1b, 2b, %0, %1)
+		     : "+r" (err), "=&r" (val));
+	*cycles = val;
+
+	return !err;
+}
+
+/*
+ * Firmware may leave the cycle counter inhibited or inaccessible, and a
+ * hypervisor may not count it for the guest. Only use it where it can be
+ * read and is seen advancing.
+ */
+static void cycle_fie_check(void *info)
+{
+	unsigned long start, end;
+	bool *ok = info;
+
+	if (!cycle_csr_read_safe(&start)) {
+		*ok = false;
+		return;
+	}
+
+	udelay(1);
+	*ok = cycle_csr_read_safe(&end) && end != start;
+}
+
+static void cycle_fie_setup(const struct cpumask *cpus)
+{
+	bool ok;
+	int cpu;
+
+	if (unlikely(cpumask_subset(cpus, cycle_fie_cpus)))
+		return;
+
+	for_each_cpu(cpu, cpus) {
+		if (smp_call_function_single(cpu, cycle_fie_check, &ok, 1) ||
+		    !ok) {
+			pr_debug("CPU%d: cycle counter not usable for FIE\n", cpu);
+			return;
+		}
+	}
+
+	cpumask_or(cycle_fie_cpus, cycle_fie_cpus, cpus);
+
+	topology_set_scale_freq_source(&cycle_sfd, cycle_fie_cpus);
+
+	pr_debug("CPUs[%*pbl]: cycle counter will be used for FIE\n",
+		 cpumask_pr_args(cpus));
+}
+
+static int init_cycle_fie_callback(struct notifier_block *nb,
+				   unsigned long val, void *data)
+{
+	struct cpufreq_policy *policy = data;
+
+	/*
+	 * As with AMUs, the counters keep working without the cpufreq driver,
+	 * so there is nothing to undo on CPUFREQ_REMOVE_POLICY.
+	 */
+	if (val == CPUFREQ_CREATE_POLICY)
+		cycle_fie_setup(policy->related_cpus);
+
+	return 0;
+}
+
+static struct notifier_block init_cycle_fie_notifier = {
+	.notifier_call = init_cycle_fie_callback,
+};
+
+static int __init init_cycle_fie(void)
+{
+	int ret;
+
+	if (!riscv_isa_extension_available(NULL, ZICNTR))
+		return 0;
+
+	if (!zalloc_cpumask_var(&cycle_fie_cpus, GFP_KERNEL))
+		return -ENOMEM;
+
+	ret = cpufreq_register_notifier(&init_cycle_fie_notifier,
+					CPUFREQ_POLICY_NOTIFIER);
+	if (ret)
+		free_cpumask_var(cycle_fie_cpus);
+
+	return ret;
+}
+core_initcall(init_cycle_fie);
@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Per-CPU SBI call and trap statistics.
+ *
+ * Time is measured in timebase ticks around sbi_ecall() and around the
+ * C trap handlers, so it includes the firmware (or the emulation) but not
+ * the trap entry and exit code. Each SBI extension and each trap cause
+ * has a count, the total time and a log2 histogram of the time per event,
+ * and each function of an SBI extension has a count and a total time.
+ */
+
+#include <linux/bitops.h>
+#include <linux/cpumask.h>
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/minmax.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include <asm/delay.h>
+#include <asm/sbi.h>
+#include <asm/trap_stats.h>
+
+/* Bucket 0 is below 2^5 ticks, bucket b is [2^(b+4), 2^(b+5)) ticks. */
+#define STATS_HIST_BUCKETS	16
+#define STATS_HIST_SHIFT	5
+/* Function IDs at or beyond this share the last slot. */
+#define STATS_MAX_FID		16
+
+struct stats_time {
+	u64 count;
+	u64 ticks;
+};
+
+struct stats_hist {
+	struct stats_time total;
+	u64 hist[STATS_HIST_BUCKETS];
+};
+
+static const struct {
+	int ext;
+	const char *name;
+} sbi_stats_exts[] = {
+	/* Legacy extensions, accounted with the extension ID as function. */
+	{ 0,			"LEGACY" },
+	{ SBI_EXT_BASE,		"BASE" },
+	{ SBI_EXT_TIME,		"TIME" },
+	{ SBI_EXT_IPI,		"IPI" },
+	{ SBI_EXT_RFENCE,	"RFENCE" },
+	{ SBI_EXT_HSM,		"HSM" },
+	{ SBI_EXT_SRST,		"SRST" },
+	{ SBI_EXT_SUSP,		"SUSP" },
+	{ SBI_EXT_PMU,		"PMU" },
+	{ SBI_EXT_DBCN,		"DBCN" },
+	{ SBI_EXT_STA,		"STA" },
+	{ SBI_EXT_FWFT,		"FWFT" },
+	{ SBI_EXT_PVLOCK,	"PVLOCK" },
+	/* Anything else, the function slots are unused. */
+	{ -1,			"OTHER" },
+};
+#define NR_SBI_STATS_EXTS	ARRAY_SIZE(sbi_stats_exts)
+
+static const char * const trap_stats_names[RISCV_TRAP_STATS_NR_CAUSES] = {
+	[EXC_INST_MISALIGNED]		= "insn_misaligned",
+	[EXC_INST_ACCESS]		= "insn_access",
+	[EXC_INST_ILLEGAL]		= "insn_illegal",
+	[EXC_BREAKPOINT]		= "breakpoint",
+	[EXC_LOAD_MISALIGNED]		= "load_misaligned",
+	[EXC_LOAD_ACCESS]		= "load_access",
+	[EXC_STORE_MISALIGNED]		= "store_misaligned",
+	[EXC_STORE_ACCESS]		= "store_access",
+	[EXC_SYSCALL]			= "ecall_u",
+	[EXC_HYPERVISOR_SYSCALL]	= "ecall_vs",
+	[EXC_SUPERVISOR_SYSCALL]	= "ecall_s",
+	[EXC_INST_PAGE_FAULT]		= "insn_page_fault",
+	[EXC_LOAD_PAGE_FAULT]		= "load_page_fault",
+	[EXC_STORE_PAGE_FAULT]		= "store_page_fault",
+	[EXC_INST_GUEST_PAGE_FAULT]	= "insn_guest_page_fault",
+	[EXC_LOAD_GUEST_PAGE_FAULT]	= "load_guest_page_fault",
+	[EXC_VIRTUAL_INST_FAULT]	= "virtual_insn",
+	[EXC_STORE_GUEST_PAGE_FAULT]	= "store_guest_page_fault",
+	[RISCV_TRAP_STATS_V_FIRST_USE]	= "v_first_use",
+};
+
+struct riscv_trap_stats {
+	struct stats_hist sbi[NR_SBI_STATS_EXTS];
+	struct stats_time sbi_fid[NR_SBI_STATS_EXTS][STATS_MAX_FID];
+	struct stats_hist trap[RISCV_TRAP_STATS_NR_CAUSES];
+};
+
+DEFINE_STATIC_KEY_FALSE(riscv_trap_stats_enabled);
+static struct riscv_trap_stats __percpu *trap_stats;
+static DEFINE_MUTEX(trap_stats_lock);
+
+static unsigned int sbi_stats_ext_index(int *ext, int *fid)
+{
+	unsigned int i;
+
+	if (*ext >= 0 && *ext < SBI_EXT_BASE) {
+		*fid = *ext;
+		return 0;
+	}
+
+	for (i = 1; i < NR_SBI_STATS_EXTS - 1; i++) {
+		if (sbi_stats_exts[i].ext == *ext)
+			return i;
+	}
+
+	return NR_SBI_STATS_EXTS - 1;
+}
+
+static __always_inline void stats_hist_add(struct stats_hist __percpu *h,
+					   u64 ticks)
+{
+	unsigned int b = clamp_t(int, fls64(ticks) - STATS_HIST_SHIFT, 0,
+				 STATS_HIST_BUCKETS - 1);
+
+	this_cpu_inc(h->total.count);
+	this_cpu_add(h->total.ticks, ticks);
+	this_cpu_inc(h->hist[b]);
+}
+
+void __riscv_sbi_stats_account(int ext, int fid, u64 ticks)
+{
+	unsigned int i = sbi_stats_ext_index(&ext, &fid);
+	struct stats_time __percpu *t;
+
+	stats_hist_add(&trap_stats->sbi[i], ticks);
+
+	if (i == NR_SBI_STATS_EXTS - 1)
+		return;
+
+	t = &trap_stats->sbi_fid[i][min_t(unsigned int, fid, STATS_MAX_FID - 1)];
+	this_cpu_inc(t->count);
+	this_cpu_add(t->ticks, ticks);
+}
+
+void __riscv_trap_stats_account(unsigned long cause, u64 ticks)
+{
+	if (cause < RISCV_TRAP_STATS_NR_CAUSES)
+		stats_hist_add(&trap_stats->trap[cause], ticks);
+}
+
+static void stats_hist_sum(struct stats_hist *sum, struct stats_hist __percpu *h)
+{
+	struct stats_hist *p;
+	int cpu, b;
+
+	memset(sum, 0, sizeof(*sum));
+	for_each_possible_cpu(cpu) {
+		p = per_cpu_ptr(h, cpu);
+		sum->total.count += READ_ONCE(p->total.count);
+		sum->total.ticks += READ_ONCE(p->total.ticks);
+		for (b = 0; b < STATS_HIST_BUCKETS; b++)
+			sum->hist[b] += READ_ONCE(p->hist[b]);
+	}
+}
+
+static void stats_hist_show(struct seq_file *m, const char *name,
+			    struct stats_hist *sum)
+{
+	int b;
+
+	seq_printf(m, "%-22s %4s %12llu %16llu", name, "*",
+		   sum->total.count, sum->total.ticks);
+	for (b = 0; b < STATS_HIST_BUCKETS; b++)
+		seq_printf(m, " %llu", sum->hist[b]);
+	seq_putc(m, '\n');
+}
+
+static void stats_header_show(struct seq_file *m)
+{
+	seq_printf(m, "timebase: %lu Hz, hist bucket b: [2^(b+4), 2^(b+5)) ticks\n",
+		   riscv_timebase);
+	seq_printf(m, "%-22s %4s %12s %16s hist\n", "name", "fid", "count", "ticks");
+}
+
+static int sbi_stats_show(struct seq_file *m, void *v)
+{
+	struct stats_hist sum;
+	struct stats_time *p;
+	u64 count, ticks;
+	int i, fid, cpu;
+
+	stats_header_show(m);
+
+	for (i = 0; i < NR_SBI_STATS_EXTS; i++) {
+		stats_hist_sum(&sum, &trap_stats->sbi[i]);
+		if (!sum.total.count)
+			continue;
+
+		stats_hist_show(m, sbi_stats_exts[i].name, &sum);
+
+		for (fid = 0; i < NR_SBI_STATS_EXTS - 1 && fid < STATS_MAX_FID; fid++) {
+			count = ticks = 0;
+			for_each_possible_cpu(cpu) {
+				p = &per_cpu_ptr(trap_stats, cpu)->sbi_fid[i][fid];
+				count += READ_ONCE(p->count);
+				ticks += READ_ONCE(p->ticks);
+			}
+			if (count)
+				seq_printf(m, "%-22s %4d %12llu %16llu\n",
+					   sbi_stats_exts[i].name, fid, count, ticks);
+		}
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(sbi_stats);
+
+static int trap_stats_show(struct seq_file *m, void *v)
+{
+	struct stats_hist sum;
+	int i;
+
+	stats_header_show(m);
+
+	for (i = 0; i < RISCV_TRAP_STATS_NR_CAUSES; i++) {
+		stats_hist_sum(&sum, &trap_stats->trap[i]);
+		if (sum.total.count)
+			stats_hist_show(m, trap_stats_names[i] ? : "reserved", &sum);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(trap_stats);
+
+static int trap_stats_enable_get(void *data, u64 *val)
+{
+	*val = static_key_enabled(&riscv_trap_stats_enabled);
+
+	return 0;
+}
+
+/* Writing 1 clears the statistics and starts accounting, 0 stops it. */
+static int trap_stats_enable_set(void *data, u64 val)
+{
+	int cpu;
+
+	mutex_lock(&trap_stats_lock);
+	if (val) {
+		static_branch_disable(&riscv_trap_stats_enabled);
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(trap_stats, cpu), 0, sizeof(*trap_stats));
+		static_branch_enable(&riscv_trap_stats_enabled);
+	} else {
+		static_branch_disable(&riscv_trap_stats_enabled);
+	}
+	mutex_unlock(&trap_stats_lock);
+
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(trap_stats_enable_fops, trap_stats_enable_get,
+			 trap_stats_enable_set, "%llu\n");
+
+static int __init trap_stats_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	trap_stats = alloc_percpu(struct riscv_trap_stats);
+	if (!trap_stats)
+		return -ENOMEM;
+
+	dir = debugfs_create_dir("riscv_trap_stats", NULL);
+	debugfs_create_file_unsafe("enable", 0600, dir, NULL,
+				   &trap_stats_enable_fops);
+	debugfs_create_file("sbi", 0400, dir, NULL, &sbi_stats_fops);
+	debugfs_create_file("traps", 0400, dir, NULL, &trap_stats_fops);
+
+	return 0;
+}
+late_initcall(trap_stats_debugfs_init);
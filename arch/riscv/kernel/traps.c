@@ -30,6 +30,7 @@
 #include <asm/ptrace.h>
 #include <asm/syscall.h>
 #include <asm/thread_info.h>
+#include <asm/trap_stats.h>
 #include <asm/vector.h>
 #include <asm/irq_stack.h>
 
@@ -170,9 +171,11 @@ DO_ERROR_INFO(do_trap_insn_fault,
 asmlinkage __visible __trap_section void do_trap_insn_illegal(struct pt_regs *regs)
 {
 	bool handled;
+	u64 start;
 
 	if (user_mode(regs)) {
 		irqentry_enter_from_user_mode(regs);
+		start = riscv_trap_stats_start();
 
 		local_irq_enable();
 
@@ -184,6 +187,8 @@ asmlinkage __visible __trap_section void do_trap_insn_illegal(struct pt_regs *re
 			do_trap_error(regs, SIGILL, ILL_ILLOPC, regs->epc,
 				      "Oops - illegal instruction");
 
+		riscv_trap_stats_end(handled ? RISCV_TRAP_STATS_V_FIRST_USE :
+				     EXC_INST_ILLEGAL, start);
 		irqentry_exit_to_user_mode(regs);
 	} else {
 		irqentry_state_t state = irqentry_nmi_enter(regs);
@@ -200,42 +205,56 @@ DO_ERROR_INFO(do_trap_load_fault,
 
 asmlinkage __visible __trap_section void do_trap_load_misaligned(struct pt_regs *regs)
 {
+	u64 start;
+
 	if (user_mode(regs)) {
 		irqentry_enter_from_user_mode(regs);
+		start = riscv_trap_stats_start();
 
 		if (handle_misaligned_load(regs))
 			do_trap_error(regs, SIGBUS, BUS_ADRALN, regs->epc,
 			      "Oops - load address misaligned");
 
+		riscv_trap_stats_end(EXC_LOAD_MISALIGNED, start);
 		irqentry_exit_to_user_mode(regs);
 	} else {
 		irqentry_state_t state = irqentry_nmi_enter(regs);
 
+		start = riscv_trap_stats_start();
+
 		if (handle_misaligned_load(regs))
 			do_trap_error(regs, SIGBUS, BUS_ADRALN, regs->epc,
 			      "Oops - load address misaligned");
 
+		riscv_trap_stats_end(EXC_LOAD_MISALIGNED, start);
 		irqentry_nmi_exit(regs, state);
 	}
 }
 
 asmlinkage __visible __trap_section void do_trap_store_misaligned(struct pt_regs *regs)
 {
+	u64 start;
+
 	if (user_mode(regs)) {
 		irqentry_enter_from_user_mode(regs);
+		start = riscv_trap_stats_start();
 
 		if (handle_misaligned_store(regs))
 			do_trap_error(regs, SIGBUS, BUS_ADRALN, regs->epc,
 				"Oops - store (or AMO) address misaligned");
 
+		riscv_trap_stats_end(EXC_STORE_MISALIGNED, start);
 		irqentry_exit_to_user_mode(regs);
 	} else {
 		irqentry_state_t state = irqentry_nmi_enter(regs);
 
+		start = riscv_trap_stats_start();
+
 		if (handle_misaligned_store(regs))
 			do_trap_error(regs, SIGBUS, BUS_ADRALN, regs->epc,
 				"Oops - store (or AMO) address misaligned");
 
+		riscv_trap_stats_end(EXC_STORE_MISALIGNED, start);
 		irqentry_nmi_exit(regs, state);
 	}
 }
@@ -358,10 +377,12 @@ void do_trap_ecall_u(struct pt_regs *regs)
 asmlinkage __visible noinstr void do_page_fault(struct pt_regs *regs)
 {
 	irqentry_state_t state = irqentry_enter(regs);
+	u64 start = riscv_trap_stats_start();
 
 	handle_page_fault(regs);
 
 	local_irq_disable();
+	riscv_trap_stats_end(regs->cause, start);
 
 	irqentry_exit(regs, state);
 }
@@ -3,11 +3,16 @@
  * Copyright (C) 2020 Western Digital Corporation or its affiliates.
  */
 #include <linux/kernel.h>
+#include <linux/cpuhotplug.h>
 #include <linux/init.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/perf_event.h>
 #include <linux/irq.h>
+#include <linux/proc_fs.h>
+#include <linux/sched/mm.h>
+#include <linux/slab.h>
+#include <linux/seq_file.h>
 #include <linux/stringify.h>
 
 #include <asm/processor.h>
@@ -16,6 +21,7 @@
 #include <asm/entry-common.h>
 #include <asm/hwprobe.h>
 #include <asm/cpufeature.h>
+#include <asm/sbi.h>
 
 #define INSN_MATCH_LB			0x3
 #define INSN_MASK_LB			0x707f
@@ -265,11 +271,11 @@ static unsigned long get_f32_rs(unsigned long insn, u8 fp_reg_offset,
 #define GET_F32_RS2S(insn, regs) (get_f32_rs(RVC_RS2S(insn), 0, regs))
 
 #ifdef CONFIG_RISCV_M_MODE
-static inline int load_u8(struct pt_regs *regs, const u8 *addr, u8 *r_val)
+static inline int load_ulong(struct pt_regs *regs, const void *addr, ulong *r_val)
 {
-	u8 val;
+	ulong val;
 
-	asm volatile("lbu %0, %1" : "=&r" (val) : "m" (*addr));
+	asm volatile(REG_L " %0, %1" : "=&r" (val) : "m" (*(const ulong *)addr));
 	*r_val = val;
 
 	return 0;
@@ -282,6 +288,20 @@ static inline int store_u8(struct pt_regs *regs, u8 *addr, u8 val)
 	return 0;
 }
 
+static inline int store_u16(struct pt_regs *regs, void *addr, u16 val)
+{
+	asm volatile ("sh %0, %1\n" : : "r" (val), "m" (*(u16 *)addr));
+
+	return 0;
+}
+
+static inline int store_u32(struct pt_regs *regs, void *addr, u32 val)
+{
+	asm volatile ("sw %0, %1\n" : : "r" (val), "m" (*(u32 *)addr));
+
+	return 0;
+}
+
 static inline int get_insn(struct pt_regs *regs, ulong mepc, ulong *r_insn)
 {
 	register ulong __mepc asm ("a2") = mepc;
@@ -316,12 +336,12 @@ static inline int get_insn(struct pt_regs *regs, ulong mepc, ulong *r_insn)
 	return 0;
 }
 #else
-static inline int load_u8(struct pt_regs *regs, const u8 *addr, u8 *r_val)
+static inline int load_ulong(struct pt_regs *regs, const void *addr, ulong *r_val)
 {
 	if (user_mode(regs)) {
-		return __get_user(*r_val, (u8 __user *)addr);
+		return __get_user(*r_val, (const ulong __user *)addr);
 	} else {
-		*r_val = *addr;
+		*r_val = *(const ulong *)addr;
 		return 0;
 	}
 }
@@ -336,6 +356,26 @@ static inline int store_u8(struct pt_regs *regs, u8 *addr, u8 val)
 	}
 }
 
+static inline int store_u16(struct pt_regs *regs, void *addr, u16 val)
+{
+	if (user_mode(regs)) {
+		return __put_user(val, (u16 __user *)addr);
+	} else {
+		*(u16 *)addr = val;
+		return 0;
+	}
+}
+
+static inline int store_u32(struct pt_regs *regs, void *addr, u32 val)
+{
+	if (user_mode(regs)) {
+		return __put_user(val, (u32 __user *)addr);
+	} else {
+		*(u32 *)addr = val;
+		return 0;
+	}
+}
+
 #define __read_insn(regs, insn, insn_addr)		\
 ({							\
 	int __ret;					\
@@ -398,35 +438,22 @@ union reg_data {
 	u64 data_u64;
 };
 
-static bool unaligned_ctl __read_mostly;
-
-/* sysctl hooks */
-int unaligned_enabled __read_mostly = 1;	/* Enabled by default */
+/*
+ * A decoded misaligned load or store: the access width, the register it
+ * loads into or stores from, and how to sign extend a loaded value.
+ */
+struct misaligned_op {
+	u8 len;
+	u8 insn_len;
+	u8 shift;
+	u8 reg;
+	u8 fp;
+};
 
-int handle_misaligned_load(struct pt_regs *regs)
+static bool decode_misaligned_load(unsigned long insn, struct misaligned_op *op)
 {
-	union reg_data val;
-	unsigned long epc = regs->epc;
-	unsigned long insn;
-	unsigned long addr = regs->badaddr;
-	int i, fp = 0, shift = 0, len = 0;
-
-	perf_sw_event(PERF_COUNT_SW_ALIGNMENT_FAULTS, 1, regs, addr);
-
-#ifdef CONFIG_RISCV_PROBE_UNALIGNED_ACCESS
-	*this_cpu_ptr(&misaligned_access_speed) = RISCV_HWPROBE_MISALIGNED_EMULATED;
-#endif
-
-	if (!unaligned_enabled)
-		return -1;
-
-	if (user_mode(regs) && (current->thread.align_ctl & PR_UNALIGN_SIGBUS))
-		return -1;
-
-	if (get_insn(regs, epc, &insn))
-		return -1;
-
-	regs->epc = 0;
+	int fp = 0, shift = 0, len = 0;
+	int reg = RV_X(insn, SH_RD, 5);
 
 	if ((insn & INSN_MASK_LW) == INSN_MATCH_LW) {
 		len = 4;
@@ -453,7 +480,7 @@ int handle_misaligned_load(struct pt_regs *regs)
 	} else if ((insn & INSN_MASK_C_LD) == INSN_MATCH_C_LD) {
 		len = 8;
 		shift = 8 * (sizeof(unsigned long) - len);
-		insn = RVC_RS2S(insn) << SH_RD;
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_LDSP) == INSN_MATCH_C_LDSP &&
 		   ((insn >> SH_RD) & 0x1f)) {
 		len = 8;
@@ -462,7 +489,7 @@ int handle_misaligned_load(struct pt_regs *regs)
 	} else if ((insn & INSN_MASK_C_LW) == INSN_MATCH_C_LW) {
 		len = 4;
 		shift = 8 * (sizeof(unsigned long) - len);
-		insn = RVC_RS2S(insn) << SH_RD;
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_LWSP) == INSN_MATCH_C_LWSP &&
 		   ((insn >> SH_RD) & 0x1f)) {
 		len = 4;
@@ -470,7 +497,7 @@ int handle_misaligned_load(struct pt_regs *regs)
 	} else if ((insn & INSN_MASK_C_FLD) == INSN_MATCH_C_FLD) {
 		fp = 1;
 		len = 8;
-		insn = RVC_RS2S(insn) << SH_RD;
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_FLDSP) == INSN_MATCH_C_FLDSP) {
 		fp = 1;
 		len = 8;
@@ -478,59 +505,28 @@ int handle_misaligned_load(struct pt_regs *regs)
 	} else if ((insn & INSN_MASK_C_FLW) == INSN_MATCH_C_FLW) {
 		fp = 1;
 		len = 4;
-		insn = RVC_RS2S(insn) << SH_RD;
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_FLWSP) == INSN_MATCH_C_FLWSP) {
 		fp = 1;
 		len = 4;
 #endif
 	} else {
-		regs->epc = epc;
-		return -1;
+		return false;
 	}
 
-	if (!IS_ENABLED(CONFIG_FPU) && fp)
-		return -EOPNOTSUPP;
-
-	val.data_u64 = 0;
-	for (i = 0; i < len; i++) {
-		if (load_u8(regs, (void *)(addr + i), &val.data_bytes[i]))
-			return -1;
-	}
-
-	if (!fp)
-		SET_RD(insn, regs, val.data_ulong << shift >> shift);
-	else if (len == 8)
-		set_f64_rd(insn, regs, val.data_u64);
-	else
-		set_f32_rd(insn, regs, val.data_ulong);
+	op->len = len;
+	op->insn_len = INSN_LEN(insn);
+	op->shift = shift;
+	op->reg = reg;
+	op->fp = fp;
 
-	regs->epc = epc + INSN_LEN(insn);
-
-	return 0;
+	return true;
 }
 
-int handle_misaligned_store(struct pt_regs *regs)
+static bool decode_misaligned_store(unsigned long insn, struct misaligned_op *op)
 {
-	union reg_data val;
-	unsigned long epc = regs->epc;
-	unsigned long insn;
-	unsigned long addr = regs->badaddr;
-	int i, len = 0, fp = 0;
-
-	perf_sw_event(PERF_COUNT_SW_ALIGNMENT_FAULTS, 1, regs, addr);
-
-	if (!unaligned_enabled)
-		return -1;
-
-	if (user_mode(regs) && (current->thread.align_ctl & PR_UNALIGN_SIGBUS))
-		return -1;
-
-	if (get_insn(regs, epc, &insn))
-		return -1;
-
-	regs->epc = 0;
-
-	val.data_ulong = GET_RS2(insn, regs);
+	int len = 0, fp = 0;
+	int reg = RV_X(insn, SH_RS2, 5);
 
 	if ((insn & INSN_MASK_SW) == INSN_MATCH_SW) {
 		len = 4;
@@ -541,63 +537,338 @@ int handle_misaligned_store(struct pt_regs *regs)
 	} else if ((insn & INSN_MASK_FSD) == INSN_MATCH_FSD) {
 		fp = 1;
 		len = 8;
-		val.data_u64 = GET_F64_RS2(insn, regs);
 	} else if ((insn & INSN_MASK_FSW) == INSN_MATCH_FSW) {
 		fp = 1;
 		len = 4;
-		val.data_ulong = GET_F32_RS2(insn, regs);
 	} else if ((insn & INSN_MASK_SH) == INSN_MATCH_SH) {
 		len = 2;
 #if defined(CONFIG_64BIT)
 	} else if ((insn & INSN_MASK_C_SD) == INSN_MATCH_C_SD) {
 		len = 8;
-		val.data_ulong = GET_RS2S(insn, regs);
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_SDSP) == INSN_MATCH_C_SDSP) {
 		len = 8;
-		val.data_ulong = GET_RS2C(insn, regs);
+		reg = RVC_RS2(insn);
 #endif
 	} else if ((insn & INSN_MASK_C_SW) == INSN_MATCH_C_SW) {
 		len = 4;
-		val.data_ulong = GET_RS2S(insn, regs);
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_SWSP) == INSN_MATCH_C_SWSP) {
 		len = 4;
-		val.data_ulong = GET_RS2C(insn, regs);
+		reg = RVC_RS2(insn);
 	} else if ((insn & INSN_MASK_C_FSD) == INSN_MATCH_C_FSD) {
 		fp = 1;
 		len = 8;
-		val.data_u64 = GET_F64_RS2S(insn, regs);
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_FSDSP) == INSN_MATCH_C_FSDSP) {
 		fp = 1;
 		len = 8;
-		val.data_u64 = GET_F64_RS2C(insn, regs);
+		reg = RVC_RS2(insn);
 #if !defined(CONFIG_64BIT)
 	} else if ((insn & INSN_MASK_C_FSW) == INSN_MATCH_C_FSW) {
 		fp = 1;
 		len = 4;
-		val.data_ulong = GET_F32_RS2S(insn, regs);
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_FSWSP) == INSN_MATCH_C_FSWSP) {
 		fp = 1;
 		len = 4;
-		val.data_ulong = GET_F32_RS2C(insn, regs);
+		reg = RVC_RS2(insn);
 #endif
 	} else {
-		regs->epc = epc;
-		return -1;
+		return false;
 	}
 
-	if (!IS_ENABLED(CONFIG_FPU) && fp)
-		return -EOPNOTSUPP;
+	op->len = len;
+	op->insn_len = INSN_LEN(insn);
+	op->shift = 0;
+	op->reg = reg;
+	op->fp = fp;
+
+	return true;
+}
 
-	for (i = 0; i < len; i++) {
-		if (store_u8(regs, (void *)(addr + i), val.data_bytes[i]))
+/*
+ * Loads the @len bytes at @addr with the naturally aligned words that cover
+ * them. These are in the same page as the bytes, so they can't fault where a
+ * byte by byte copy would not.
+ */
+static int load_misaligned(struct pt_regs *regs, unsigned long addr, int len,
+			   union reg_data *val)
+{
+	unsigned long buf[3];
+	unsigned long base = addr & ~(sizeof(ulong) - 1);
+	unsigned long off = addr - base;
+	int i, nr = DIV_ROUND_UP(off + len, sizeof(ulong));
+
+	for (i = 0; i < nr; i++) {
+		if (load_ulong(regs, (void *)(base + i * sizeof(ulong)), &buf[i]))
 			return -1;
 	}
 
-	regs->epc = epc + INSN_LEN(insn);
+	val->data_u64 = 0;
+	memcpy(val->data_bytes, (u8 *)buf + off, len);
+
+	return 0;
+}
+
+/*
+ * Stores @len bytes at @addr in naturally aligned pieces. Unlike loads, the
+ * covering words can't be merged and written back, as that would race with
+ * stores to their other bytes.
+ */
+static int store_misaligned(struct pt_regs *regs, unsigned long addr, int len,
+			    const union reg_data *val)
+{
+	int i = 0, ret;
+
+	while (i < len) {
+		unsigned long p = addr + i;
+		u64 data = val->data_u64 >> (8 * i);
+
+		if (!(p & 3) && len - i >= 4) {
+			ret = store_u32(regs, (void *)p, data);
+			i += 4;
+		} else if (!(p & 1) && len - i >= 2) {
+			ret = store_u16(regs, (void *)p, data);
+			i += 2;
+		} else {
+			ret = store_u8(regs, (void *)p, data);
+			i += 1;
+		}
+
+		if (ret)
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Tasks that clear PR_UNALIGN_NOPRINT get their emulated accesses reported:
+ * the most frequent pcs are kept in a per-mm table, using the space-saving
+ * algorithm, and a rate-limited message is printed.
+ */
+#define MISALIGNED_REPORT_PCS	8
+
+struct misaligned_report {
+	raw_spinlock_t lock;
+	struct {
+		unsigned long pc;
+		unsigned long count;
+	} pcs[MISALIGNED_REPORT_PCS];
+};
+
+void misaligned_report_free(struct mm_struct *mm)
+{
+	kfree(mm->context.misaligned_report);
+	mm->context.misaligned_report = NULL;
+}
+
+static struct misaligned_report *misaligned_report_get(struct mm_struct *mm)
+{
+	struct misaligned_report *report = READ_ONCE(mm->context.misaligned_report);
+
+	if (likely(report))
+		return report;
+
+	/* The first report of the mm, possibly after an exec. */
+	report = kzalloc(sizeof(*report), GFP_ATOMIC | __GFP_NOWARN);
+	if (!report)
+		return NULL;
+
+	raw_spin_lock_init(&report->lock);
+	if (cmpxchg(&mm->context.misaligned_report, NULL, report)) {
+		kfree(report);
+		report = READ_ONCE(mm->context.misaligned_report);
+	}
+
+	return report;
+}
+
+static void misaligned_report(struct pt_regs *regs, unsigned long epc,
+			      unsigned long addr, bool store)
+{
+	struct misaligned_report *report;
+	unsigned long flags;
+	int i, min = 0;
+
+	pr_info_ratelimited("%s[%d]: emulated misaligned %s at pc 0x%lx, address 0x%lx\n",
+			    current->comm, task_pid_nr(current),
+			    store ? "store" : "load", epc, addr);
+
+	report = misaligned_report_get(current->mm);
+	if (!report)
+		return;
+
+	raw_spin_lock_irqsave(&report->lock, flags);
+	for (i = 0; i < MISALIGNED_REPORT_PCS; i++) {
+		if (report->pcs[i].pc == epc) {
+			report->pcs[i].count++;
+			goto out;
+		}
+		if (report->pcs[i].count < report->pcs[min].count)
+			min = i;
+	}
+
+	/* Evict the least frequent pc, which may still be this one's count. */
+	report->pcs[min].pc = epc;
+	report->pcs[min].count++;
+out:
+	raw_spin_unlock_irqrestore(&report->lock, flags);
+}
+
+static void misaligned_emulated(struct pt_regs *regs, unsigned long epc,
+				unsigned long addr, bool store)
+{
+	perf_sw_event(PERF_COUNT_SW_EMULATION_FAULTS, 1, regs, addr);
+
+	if (!user_mode(regs))
+		return;
+
+	current->thread.misaligned_count++;
+
+	if (!(current->thread.align_ctl & PR_UNALIGN_NOPRINT))
+		misaligned_report(regs, epc, addr, store);
+}
+
+static bool unaligned_ctl __read_mostly;
+
+/* sysctl hooks */
+int unaligned_enabled __read_mostly = 1;	/* Enabled by default */
+
+int handle_misaligned_load(struct pt_regs *regs)
+{
+	union reg_data val;
+	struct misaligned_op op;
+	unsigned long epc = regs->epc;
+	unsigned long insn;
+	unsigned long addr = regs->badaddr;
+
+	perf_sw_event(PERF_COUNT_SW_ALIGNMENT_FAULTS, 1, regs, addr);
+
+#ifdef CONFIG_RISCV_PROBE_UNALIGNED_ACCESS
+	*this_cpu_ptr(&misaligned_access_speed) = RISCV_HWPROBE_MISALIGNED_EMULATED;
+#endif
+
+	if (!unaligned_enabled)
+		return -1;
+
+	if (user_mode(regs) && (current->thread.align_ctl & PR_UNALIGN_SIGBUS))
+		return -1;
+
+	if (get_insn(regs, epc, &insn))
+		return -1;
+
+	if (!decode_misaligned_load(insn, &op))
+		return -1;
+
+	if (!IS_ENABLED(CONFIG_FPU) && op.fp)
+		return -EOPNOTSUPP;
+
+	regs->epc = 0;
+
+	if (load_misaligned(regs, addr, op.len, &val))
+		return -1;
+
+	if (!op.fp)
+		SET_RD(op.reg << SH_RD, regs, val.data_ulong << op.shift >> op.shift);
+	else if (op.len == 8)
+		set_f64_rd(op.reg << SH_RD, regs, val.data_u64);
+	else
+		set_f32_rd(op.reg << SH_RD, regs, val.data_ulong);
+
+	regs->epc = epc + op.insn_len;
+	misaligned_emulated(regs, epc, addr, false);
 
 	return 0;
 }
 
+int handle_misaligned_store(struct pt_regs *regs)
+{
+	union reg_data val;
+	struct misaligned_op op;
+	unsigned long epc = regs->epc;
+	unsigned long insn;
+	unsigned long addr = regs->badaddr;
+
+	perf_sw_event(PERF_COUNT_SW_ALIGNMENT_FAULTS, 1, regs, addr);
+
+	if (!unaligned_enabled)
+		return -1;
+
+	if (user_mode(regs) && (current->thread.align_ctl & PR_UNALIGN_SIGBUS))
+		return -1;
+
+	if (get_insn(regs, epc, &insn))
+		return -1;
+
+	if (!decode_misaligned_store(insn, &op))
+		return -1;
+
+	if (!IS_ENABLED(CONFIG_FPU) && op.fp)
+		return -EOPNOTSUPP;
+
+	regs->epc = 0;
+
+	if (!op.fp)
+		val.data_ulong = *REG_PTR(op.reg, 0, regs);
+	else if (op.len == 8)
+		val.data_u64 = get_f64_rs(op.reg, 0, regs);
+	else
+		val.data_ulong = get_f32_rs(op.reg, 0, regs);
+
+	if (store_misaligned(regs, addr, op.len, &val))
+		return -1;
+
+	regs->epc = epc + op.insn_len;
+	misaligned_emulated(regs, epc, addr, true);
+
+	return 0;
+}
+
+#ifdef CONFIG_PROC_FS
+static void misaligned_report_show(struct seq_file *m, struct mm_struct *mm)
+{
+	struct misaligned_report *report = READ_ONCE(mm->context.misaligned_report);
+	typeof(report->pcs[0]) pcs[MISALIGNED_REPORT_PCS], tmp;
+	unsigned long flags;
+	int i, j;
+
+	if (!report)
+		return;
+
+	raw_spin_lock_irqsave(&report->lock, flags);
+	memcpy(pcs, report->pcs, sizeof(pcs));
+	raw_spin_unlock_irqrestore(&report->lock, flags);
+
+	/* Most frequent first. */
+	for (i = 1; i < MISALIGNED_REPORT_PCS; i++) {
+		tmp = pcs[i];
+		for (j = i; j > 0 && pcs[j - 1].count < tmp.count; j--)
+			pcs[j] = pcs[j - 1];
+		pcs[j] = tmp;
+	}
+
+	seq_puts(m, "Misaligned_pcs:\t");
+	for (i = 0; i < MISALIGNED_REPORT_PCS && pcs[i].count; i++)
+		seq_printf(m, "%s0x%lx:%lu", i ? " " : "", pcs[i].pc, pcs[i].count);
+	seq_putc(m, '\n');
+}
+
+void arch_proc_pid_thread_features(struct seq_file *m, struct task_struct *task)
+{
+	struct mm_struct *mm;
+
+	seq_printf(m, "Misaligned_emulated:\t%lu\n", task->thread.misaligned_count);
+
+	mm = get_task_mm(task);
+	if (mm) {
+		misaligned_report_show(m, mm);
+		mmput(mm);
+	}
+}
+#endif
+
 static bool check_unaligned_access_emulated(int cpu)
 {
 	long *mas_ptr = per_cpu_ptr(&misaligned_access_speed, cpu);
@@ -625,10 +896,68 @@ static bool check_unaligned_access_emulated(int cpu)
 	return misaligned_emu_detected;
 }
 
+static void misaligned_traps_deleg_on(void *info)
+{
+	atomic_t *failed = info;
+
+	if (sbi_fwft_set(SBI_FWFT_MISALIGNED_EXC_DELEG, 1, 0))
+		atomic_inc(failed);
+}
+
+static void misaligned_traps_deleg_off(void *info)
+{
+	sbi_fwft_set(SBI_FWFT_MISALIGNED_EXC_DELEG, 0, 0);
+}
+
+/*
+ * A CPU that comes up later must delegate as well. Its accesses would
+ * otherwise be emulated by the firmware, behind the back of PR_UNALIGN and
+ * of the reports, so refuse to bring it online. This runs before the CPU
+ * becomes active, so no task is scheduled on it before it delegates.
+ */
+static int misaligned_traps_deleg_online(unsigned int cpu)
+{
+	int ret;
+
+	ret = sbi_fwft_set(SBI_FWFT_MISALIGNED_EXC_DELEG, 1, 0);
+	if (ret)
+		pr_err("CPU%u: misaligned access exception delegation failed (%d)\n",
+		       cpu, ret);
+
+	return ret;
+}
+
+/*
+ * Without hardware support, misaligned accesses trap to M-mode and the
+ * firmware emulates them, which costs a round trip to M-mode every time and
+ * hides them from PR_UNALIGN and the per-mm reports. Ask the firmware to
+ * delegate the exceptions to us instead; check_unaligned_access_emulated()
+ * then sees them trapping in S-mode.
+ */
+static void misaligned_traps_delegate_all_cpus(void)
+{
+	atomic_t failed = ATOMIC_INIT(0);
+
+	on_each_cpu(misaligned_traps_deleg_on, &failed, 1);
+
+	if (atomic_read(&failed)) {
+		/* Don't leave the CPUs that did accept it different */
+		if (atomic_read(&failed) < num_online_cpus())
+			on_each_cpu(misaligned_traps_deleg_off, NULL, 1);
+		return;
+	}
+
+	cpuhp_setup_state_nocalls(CPUHP_AP_ONLINE_DYN, "riscv/misaligned:online",
+				  misaligned_traps_deleg_online, NULL);
+	pr_info("SBI misaligned access exception delegation ok\n");
+}
+
 bool check_unaligned_access_emulated_all_cpus(void)
 {
 	int cpu;
 
+	misaligned_traps_delegate_all_cpus();
+
 	/*
 	 * We can only support PR_UNALIGN controls if all CPUs have misaligned
 	 * accesses emulated since tasks requesting such control can run on any
@@ -5,12 +5,16 @@
 
 #include <linux/cpu.h>
 #include <linux/cpumask.h>
+#include <linux/device.h>
 #include <linux/jump_label.h>
 #include <linux/mm.h>
 #include <linux/smp.h>
 #include <linux/types.h>
+#include <asm/asm-prototypes.h>
 #include <asm/cpufeature.h>
 #include <asm/hwprobe.h>
+#include <asm/sbi.h>
+#include <asm/vector.h>
 
 #include "copy-unaligned.h"
 
@@ -21,16 +25,47 @@
 
 DEFINE_PER_CPU(long, misaligned_access_speed);
 
+/*
+ * For a fixed amount of time, repeatedly try the copy function, and return
+ * the best time in cycles as the measurement.
+ */
+static u64 __maybe_unused measure_copy_cycles(void (*copy)(void *dst, const void *src, size_t size),
+					      void *dst, const void *src, size_t size,
+					      unsigned int jiffies_lg2)
+{
+	u64 start_cycles, end_cycles;
+	u64 best_cycles = -1ULL;
+	unsigned long start_jiffies, now;
+
+	/* Do a warmup. */
+	copy(dst, src, size);
+	start_jiffies = jiffies;
+	while ((now = jiffies) == start_jiffies)
+		cpu_relax();
+
+	while (time_before(jiffies, now + (1 << jiffies_lg2))) {
+		start_cycles = get_cycles64();
+		/* Ensure the CSR read can't reorder WRT to the copy. */
+		mb();
+		copy(dst, src, size);
+		/* Ensure the copy ends before the end time is snapped. */
+		mb();
+		end_cycles = get_cycles64();
+		if ((end_cycles - start_cycles) < best_cycles)
+			best_cycles = end_cycles - start_cycles;
+	}
+
+	return best_cycles;
+}
+
 #ifdef CONFIG_RISCV_PROBE_UNALIGNED_ACCESS
 static cpumask_t fast_misaligned_access;
 static int check_unaligned_access(void *param)
 {
 	int cpu = smp_processor_id();
-	u64 start_cycles, end_cycles;
 	u64 word_cycles;
 	u64 byte_cycles;
 	int ratio;
-	unsigned long start_jiffies, now;
 	struct page *page = param;
 	void *dst;
 	void *src;
@@ -44,46 +79,14 @@ static int check_unaligned_access(void *param)
 	/* Unalign src as well, but differently (off by 1 + 2 = 3). */
 	src = dst + (MISALIGNED_BUFFER_SIZE / 2);
 	src += 2;
-	word_cycles = -1ULL;
-	/* Do a warmup. */
-	__riscv_copy_words_unaligned(dst, src, MISALIGNED_COPY_SIZE);
-	preempt_disable();
-	start_jiffies = jiffies;
-	while ((now = jiffies) == start_jiffies)
-		cpu_relax();
-
-	/*
-	 * For a fixed amount of time, repeatedly try the function, and take
-	 * the best time in cycles as the measurement.
-	 */
-	while (time_before(jiffies, now + (1 << MISALIGNED_ACCESS_JIFFIES_LG2))) {
-		start_cycles = get_cycles64();
-		/* Ensure the CSR read can't reorder WRT to the copy. */
-		mb();
-		__riscv_copy_words_unaligned(dst, src, MISALIGNED_COPY_SIZE);
-		/* Ensure the copy ends before the end time is snapped. */
-		mb();
-		end_cycles = get_cycles64();
-		if ((end_cycles - start_cycles) < word_cycles)
-			word_cycles = end_cycles - start_cycles;
-	}
-
-	byte_cycles = -1ULL;
-	__riscv_copy_bytes_unaligned(dst, src, MISALIGNED_COPY_SIZE);
-	start_jiffies = jiffies;
-	while ((now = jiffies) == start_jiffies)
-		cpu_relax();
-
-	while (time_before(jiffies, now + (1 << MISALIGNED_ACCESS_JIFFIES_LG2))) {
-		start_cycles = get_cycles64();
-		mb();
-		__riscv_copy_bytes_unaligned(dst, src, MISALIGNED_COPY_SIZE);
-		mb();
-		end_cycles = get_cycles64();
-		if ((end_cycles - start_cycles) < byte_cycles)
-			byte_cycles = end_cycles - start_cycles;
-	}
 
+	preempt_disable();
+	word_cycles = measure_copy_cycles(__riscv_copy_words_unaligned, dst, src,
+					  MISALIGNED_COPY_SIZE,
+					  MISALIGNED_ACCESS_JIFFIES_LG2);
+	byte_cycles = measure_copy_cycles(__riscv_copy_bytes_unaligned, dst, src,
+					  MISALIGNED_COPY_SIZE,
+					  MISALIGNED_ACCESS_JIFFIES_LG2);
 	preempt_enable();
 
 	/* Don't divide by zero. */
@@ -279,3 +282,188 @@ static int check_unaligned_access_all_cpus(void)
 #endif
 
 arch_initcall(check_unaligned_access_all_cpus);
+
+#if defined(CONFIG_RISCV_ISA_V) && defined(CONFIG_MMU)
+#define VECTOR_USERCOPY_JIFFIES_LG2 0
+#define VECTOR_USERCOPY_MIN_SIZE 128
+#define VECTOR_USERCOPY_MAX_SIZE (MISALIGNED_BUFFER_SIZE / 2)
+
+static cpumask_t vector_usercopy_calibrated;
+
+/*
+ * Both usercopy routines are fine with kernel buffers, which saves setting
+ * up user mappings for the measurement. The vector one is timed together
+ * with claiming the vector unit, as done by enter_vector_usercopy().
+ */
+static void copy_scalar_usercopy(void *dst, const void *src, size_t size)
+{
+	fallback_scalar_usercopy(dst, (void *)src, size);
+}
+
+static void copy_vector_usercopy(void *dst, const void *src, size_t size)
+{
+	kernel_vector_begin();
+	__asm_vector_usercopy(dst, (void *)src, size);
+	kernel_vector_end();
+}
+
+/*
+ * Find the smallest power-of-two copy size for which the vector usercopy
+ * beats the scalar one on this CPU.
+ */
+static int check_vector_usercopy_threshold(void *param)
+{
+	int cpu = smp_processor_id();
+	struct page *page = param;
+	u64 scalar_cycles, vector_cycles;
+	size_t size, threshold = 0;
+	void *dst, *src;
+
+	dst = page_address(page);
+	src = dst + (MISALIGNED_BUFFER_SIZE / 2);
+
+	for (size = VECTOR_USERCOPY_MIN_SIZE; size <= VECTOR_USERCOPY_MAX_SIZE; size *= 2) {
+		scalar_cycles = measure_copy_cycles(copy_scalar_usercopy, dst, src,
+						    size, VECTOR_USERCOPY_JIFFIES_LG2);
+		vector_cycles = measure_copy_cycles(copy_vector_usercopy, dst, src,
+						    size, VECTOR_USERCOPY_JIFFIES_LG2);
+
+		/* Don't trust a timer which can't tell the two apart. */
+		if (!scalar_cycles || !vector_cycles) {
+			pr_warn("cpu%d: rdtime lacks granularity needed to measure vector usercopy speed\n",
+				cpu);
+			return 0;
+		}
+
+		if (vector_cycles < scalar_cycles) {
+			threshold = size;
+			break;
+		}
+	}
+
+	/* Vector never won: only use it for copies larger than we measured. */
+	if (!threshold)
+		threshold = VECTOR_USERCOPY_MAX_SIZE * 2;
+
+	per_cpu(riscv_v_usercopy_threshold, cpu) = threshold;
+	cpumask_set_cpu(cpu, &vector_usercopy_calibrated);
+	pr_info("cpu%d: vector usercopy threshold is %zu bytes\n", cpu, threshold);
+
+	return 0;
+}
+
+static bool same_cpu_class(unsigned int cpu, unsigned int other)
+{
+	/* Without IDs there's no telling the core types apart. */
+	if (!riscv_cached_marchid(cpu) && !riscv_cached_mimpid(cpu))
+		return false;
+
+	return riscv_cached_mvendorid(cpu) == riscv_cached_mvendorid(other) &&
+	       riscv_cached_marchid(cpu) == riscv_cached_marchid(other) &&
+	       riscv_cached_mimpid(cpu) == riscv_cached_mimpid(other);
+}
+
+/*
+ * The crossover point only depends on the core type, so CPUs which share
+ * their vendor, arch and implementation IDs with an already calibrated CPU
+ * inherit its threshold instead of being measured again.
+ */
+static bool inherit_vector_usercopy_threshold(unsigned int cpu)
+{
+	unsigned int other;
+
+	for_each_cpu(other, &vector_usercopy_calibrated) {
+		if (other == cpu || !same_cpu_class(cpu, other))
+			continue;
+
+		per_cpu(riscv_v_usercopy_threshold, cpu) =
+			per_cpu(riscv_v_usercopy_threshold, other);
+		cpumask_set_cpu(cpu, &vector_usercopy_calibrated);
+		return true;
+	}
+
+	return false;
+}
+
+static int riscv_vector_usercopy_online_cpu(unsigned int cpu)
+{
+	struct page *buf;
+
+	if (cpumask_test_cpu(cpu, &vector_usercopy_calibrated) ||
+	    inherit_vector_usercopy_threshold(cpu))
+		return 0;
+
+	buf = alloc_pages(GFP_KERNEL, MISALIGNED_BUFFER_ORDER);
+	if (!buf) {
+		pr_warn("Allocation failure, not measuring vector usercopy speed\n");
+		return 0;
+	}
+
+	check_vector_usercopy_threshold(buf);
+	__free_pages(buf, MISALIGNED_BUFFER_ORDER);
+
+	return 0;
+}
+
+static int check_vector_usercopy_threshold_all_cpus(void)
+{
+	unsigned int cpu;
+	struct page *buf;
+
+	if (!has_vector())
+		return 0;
+
+	buf = alloc_pages(GFP_KERNEL, MISALIGNED_BUFFER_ORDER);
+	if (!buf) {
+		pr_warn("Allocation failure, not measuring vector usercopy speed\n");
+		return 0;
+	}
+
+	/*
+	 * The measurement needs kernel-mode vector, hence task context on the
+	 * target CPU. Only one CPU of each class is measured, so it's done one
+	 * CPU at a time.
+	 */
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		if (!inherit_vector_usercopy_threshold(cpu))
+			smp_call_on_cpu(cpu, check_vector_usercopy_threshold, buf, true);
+	}
+
+	cpuhp_setup_state_cpuslocked(CPUHP_AP_ONLINE_DYN, "riscv/vector_usercopy:online",
+				     riscv_vector_usercopy_online_cpu, NULL);
+	cpus_read_unlock();
+
+	__free_pages(buf, MISALIGNED_BUFFER_ORDER);
+
+	return 0;
+}
+
+arch_initcall(check_vector_usercopy_threshold_all_cpus);
+
+static ssize_t vector_usercopy_threshold_show(struct device *dev,
+					      struct device_attribute *attr,
+					      char *buf)
+{
+	return sysfs_emit(buf, "%zu\n", per_cpu(riscv_v_usercopy_threshold, dev->id));
+}
+static DEVICE_ATTR_RO(vector_usercopy_threshold);
+
+static int __init vector_usercopy_threshold_sysfs_init(void)
+{
+	struct device *dev;
+	unsigned int cpu;
+
+	if (!has_vector())
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		dev = get_cpu_device(cpu);
+		if (dev)
+			device_create_file(dev, &dev_attr_vector_usercopy_threshold);
+	}
+
+	return 0;
+}
+late_initcall(vector_usercopy_threshold_sysfs_init);
+#endif /* CONFIG_RISCV_ISA_V && CONFIG_MMU */
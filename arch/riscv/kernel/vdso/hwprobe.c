@@ -3,6 +3,8 @@
  * Copyright 2023 Rivos, Inc
  */
 
+#include <linux/bits.h>
+#include <linux/compiler.h>
 #include <linux/string.h>
 #include <linux/types.h>
 #include <vdso/datapage.h>
@@ -12,6 +14,64 @@ extern int riscv_hwprobe(struct riscv_hwprobe *pairs, size_t pair_count,
 			 size_t cpusetsize, unsigned long *cpus,
 			 unsigned int flags);
 
+/* Bytes of a user cpu set that the syscall looks at. */
+#define VDSO_CPUSET_BYTES	\
+	(((NR_CPUS + BITS_PER_LONG - 1) / BITS_PER_LONG) * sizeof(long))
+
+/*
+ * Collect the classes of the online CPUs selected by @cpus, or 0 if the
+ * vDSO can't tell (the syscall then either answers or fails the query).
+ */
+static unsigned long riscv_vdso_cpu_classes(const struct arch_vdso_data *avd,
+					    size_t cpusetsize, const unsigned char *c)
+{
+	unsigned long classes = 0;
+	unsigned int cpu, class;
+	size_t i;
+
+	if (!READ_ONCE(avd->cpu_classes_valid))
+		return 0;
+
+	if (cpusetsize > VDSO_CPUSET_BYTES)
+		cpusetsize = VDSO_CPUSET_BYTES;
+
+	for (i = 0; i < cpusetsize; i++) {
+		if (!c[i])
+			continue;
+
+		for (cpu = i * BITS_PER_BYTE; cpu < (i + 1) * BITS_PER_BYTE && cpu < NR_CPUS; cpu++) {
+			if (!(c[i] & BIT(cpu % BITS_PER_BYTE)))
+				continue;
+
+			class = READ_ONCE(avd->cpu_hwprobe_class[cpu]);
+			if (class != RISCV_VDSO_HWPROBE_NO_CLASS)
+				classes |= BIT(class);
+		}
+	}
+
+	return classes;
+}
+
+static __u64 riscv_vdso_class_value(const struct arch_vdso_data *avd,
+				    unsigned long classes, __s64 key)
+{
+	int slot = riscv_hwprobe_key_slot(key);
+	bool first = true;
+	__u64 value = 0;
+	unsigned int class;
+
+	for (class = 0; class < RISCV_VDSO_HWPROBE_NR_CLASSES; class++) {
+		if (!(classes & BIT(class)))
+			continue;
+
+		value = first ? avd->class_hwprobe_values[class][slot] :
+			riscv_hwprobe_combine(key, value, avd->class_hwprobe_values[class][slot]);
+		first = false;
+	}
+
+	return value;
+}
+
 static int riscv_vdso_get_values(struct riscv_hwprobe *pairs, size_t pair_count,
 				 size_t cpusetsize, unsigned long *cpus,
 				 unsigned int flags)
@@ -21,21 +81,33 @@ static int riscv_vdso_get_values(struct riscv_hwprobe *pairs, size_t pair_count,
 	bool all_cpus = !cpusetsize && !cpus;
 	struct riscv_hwprobe *p = pairs;
 	struct riscv_hwprobe *end = pairs + pair_count;
+	unsigned long classes = 0;
 
 	/*
 	 * Defer to the syscall for exotic requests. The vdso has answers
-	 * stashed away only for the "all cpus" case. If all CPUs are
-	 * homogeneous, then this function can handle requests for arbitrary
-	 * masks.
+	 * stashed away for the "all cpus" case, and per class of CPUs for
+	 * any other mask of online CPUs.
 	 */
-	if ((flags != 0) || (!all_cpus && !avd->homogeneous_cpus))
+	if (flags != 0)
 		return riscv_hwprobe(pairs, pair_count, cpusetsize, cpus, flags);
 
+	if (!all_cpus) {
+		if (cpusetsize && cpus)
+			classes = riscv_vdso_cpu_classes(avd, cpusetsize,
+							 (unsigned char *)cpus);
+		if (!classes && !avd->homogeneous_cpus)
+			return riscv_hwprobe(pairs, pair_count, cpusetsize, cpus, flags);
+	}
+
 	/* This is something we can handle, fill out the pairs. */
 	while (p < end) {
-		if (riscv_hwprobe_key_is_valid(p->key)) {
-			p->value = avd->all_cpu_hwprobe_values[p->key];
+		int slot = riscv_hwprobe_key_slot(p->key);
 
+		if (slot >= 0) {
+			if (classes)
+				p->value = riscv_vdso_class_value(avd, classes, p->key);
+			else
+				p->value = avd->all_cpu_hwprobe_values[slot];
 		} else {
 			p->key = -1;
 			p->value = 0;
@@ -58,11 +130,18 @@ static int riscv_vdso_get_cpus(struct riscv_hwprobe *pairs, size_t pair_count,
 	unsigned char *c = (unsigned char *)cpus;
 	bool empty_cpus = true;
 	bool clear_all = false;
-	int i;
+	unsigned int cpu, class;
+	size_t i;
 
 	if (!cpusetsize || !cpus)
 		return -EINVAL;
 
+	if (flags != RISCV_HWPROBE_WHICH_CPUS || !READ_ONCE(avd->cpu_classes_valid))
+		return riscv_hwprobe(pairs, pair_count, cpusetsize, cpus, flags);
+
+	if (cpusetsize > VDSO_CPUSET_BYTES)
+		cpusetsize = VDSO_CPUSET_BYTES;
+
 	for (i = 0; i < cpusetsize; i++) {
 		if (c[i]) {
 			empty_cpus = false;
@@ -70,19 +149,8 @@ static int riscv_vdso_get_cpus(struct riscv_hwprobe *pairs, size_t pair_count,
 		}
 	}
 
-	if (empty_cpus || flags != RISCV_HWPROBE_WHICH_CPUS || !avd->homogeneous_cpus)
-		return riscv_hwprobe(pairs, pair_count, cpusetsize, cpus, flags);
-
 	while (p < end) {
-		if (riscv_hwprobe_key_is_valid(p->key)) {
-			struct riscv_hwprobe t = {
-				.key = p->key,
-				.value = avd->all_cpu_hwprobe_values[p->key],
-			};
-
-			if (!riscv_hwprobe_pair_cmp(&t, p))
-				clear_all = true;
-		} else {
+		if (!riscv_hwprobe_key_is_valid(p->key)) {
 			clear_all = true;
 			p->key = -1;
 			p->value = 0;
@@ -90,9 +158,38 @@ static int riscv_vdso_get_cpus(struct riscv_hwprobe *pairs, size_t pair_count,
 		p++;
 	}
 
-	if (clear_all) {
-		for (i = 0; i < cpusetsize; i++)
-			c[i] = 0;
+	/*
+	 * Keep the online CPUs (all of them for an empty set) whose class
+	 * matches every pair.
+	 */
+	for (cpu = 0; cpu < cpusetsize * BITS_PER_BYTE; cpu++) {
+		unsigned char bit = BIT(cpu % BITS_PER_BYTE);
+
+		if (!empty_cpus && !(c[cpu / BITS_PER_BYTE] & bit))
+			continue;
+
+		c[cpu / BITS_PER_BYTE] &= ~bit;
+		if (clear_all || cpu >= NR_CPUS)
+			continue;
+
+		class = READ_ONCE(avd->cpu_hwprobe_class[cpu]);
+		if (class == RISCV_VDSO_HWPROBE_NO_CLASS)
+			continue;
+
+		/* All keys are valid here, clear_all is set otherwise */
+		for (p = pairs; p < end; p++) {
+			int slot = riscv_hwprobe_key_slot(p->key);
+			struct riscv_hwprobe t = {
+				.key = p->key,
+				.value = avd->class_hwprobe_values[class][slot],
+			};
+
+			if (!riscv_hwprobe_pair_cmp(&t, p))
+				break;
+		}
+
+		if (p == end)
+			c[cpu / BITS_PER_BYTE] |= bit;
 	}
 
 	return 0;
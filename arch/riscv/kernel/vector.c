@@ -29,6 +29,9 @@ static struct kmem_cache *riscv_v_kernel_cachep;
 unsigned long riscv_v_vsize __read_mostly;
 EXPORT_SYMBOL_GPL(riscv_v_vsize);
 
+/* Park the V state of tasks idle for this many switches/syscalls, 0: never */
+unsigned int riscv_v_idle_threshold __read_mostly = 64;
+
 int riscv_v_setup_vsize(void)
 {
 	unsigned long this_vsize;
@@ -191,8 +194,11 @@ bool riscv_v_first_use_handler(struct pt_regs *regs)
 	if (!insn_is_vector(insn))
 		return false;
 
-	/* Sanity check. datap should be null by the time of the first-use trap */
-	WARN_ON(current->thread.vstate.datap);
+	/* A parked task gets its saved state back rather than a fresh one */
+	if (current->thread.vstate.datap) {
+		riscv_v_vstate_unpark(current, regs);
+		return true;
+	}
 
 	/*
 	 * Now we sure that this is a V instruction. And it executes in the
@@ -292,6 +298,13 @@ static struct ctl_table riscv_v_default_vstate_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dobool,
 	},
+	{
+		.procname	= "riscv_v_idle_threshold",
+		.data		= &riscv_v_idle_threshold,
+		.maxlen		= sizeof(riscv_v_idle_threshold),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
 };
 
 static int __init riscv_v_sysctl_init(void)
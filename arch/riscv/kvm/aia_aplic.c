@@ -7,12 +7,12 @@
  *	Anup Patel <apatel@ventanamicro.com>
  */
 
+#include <linux/irqchip/riscv-aplic.h>
 #include <linux/kvm_host.h>
 #include <linux/math.h>
 #include <linux/spinlock.h>
 #include <linux/swab.h>
 #include <kvm/iodev.h>
-#include <asm/kvm_aia_aplic.h>
 
 struct aplic_irq {
 	raw_spinlock_t lock;
@@ -26,6 +26,15 @@ struct aplic_irq {
 	u32 target;
 };
 
+/* MSIs to the same hart and guest found by one update, delivered at once */
+#define APLIC_MSI_BATCH			32
+
+struct aplic_msi_batch {
+	u32 dest;
+	unsigned int nr;
+	u32 eiids[APLIC_MSI_BATCH];
+};
+
 struct aplic {
 	struct kvm_io_device iodev;
 
@@ -39,19 +48,10 @@ struct aplic {
 
 static u32 aplic_read_sourcecfg(struct aplic *aplic, u32 irq)
 {
-	u32 ret;
-	unsigned long flags;
-	struct aplic_irq *irqd;
-
 	if (!irq || aplic->nr_irqs <= irq)
 		return 0;
-	irqd = &aplic->irqs[irq];
 
-	raw_spin_lock_irqsave(&irqd->lock, flags);
-	ret = irqd->sourcecfg;
-	raw_spin_unlock_irqrestore(&irqd->lock, flags);
-
-	return ret;
+	return READ_ONCE(aplic->irqs[irq].sourcecfg);
 }
 
 static void aplic_write_sourcecfg(struct aplic *aplic, u32 irq, u32 val)
@@ -69,25 +69,16 @@ static void aplic_write_sourcecfg(struct aplic *aplic, u32 irq, u32 val)
 		val &= APLIC_SOURCECFG_SM_MASK;
 
 	raw_spin_lock_irqsave(&irqd->lock, flags);
-	irqd->sourcecfg = val;
+	WRITE_ONCE(irqd->sourcecfg, val);
 	raw_spin_unlock_irqrestore(&irqd->lock, flags);
 }
 
 static u32 aplic_read_target(struct aplic *aplic, u32 irq)
 {
-	u32 ret;
-	unsigned long flags;
-	struct aplic_irq *irqd;
-
 	if (!irq || aplic->nr_irqs <= irq)
 		return 0;
-	irqd = &aplic->irqs[irq];
-
-	raw_spin_lock_irqsave(&irqd->lock, flags);
-	ret = irqd->target;
-	raw_spin_unlock_irqrestore(&irqd->lock, flags);
 
-	return ret;
+	return READ_ONCE(aplic->irqs[irq].target);
 }
 
 static void aplic_write_target(struct aplic *aplic, u32 irq, u32 val)
@@ -104,25 +95,21 @@ static void aplic_write_target(struct aplic *aplic, u32 irq, u32 val)
 	       (APLIC_TARGET_GUEST_IDX_MASK << APLIC_TARGET_GUEST_IDX_SHIFT);
 
 	raw_spin_lock_irqsave(&irqd->lock, flags);
-	irqd->target = val;
+	WRITE_ONCE(irqd->target, val);
 	raw_spin_unlock_irqrestore(&irqd->lock, flags);
 }
 
-static bool aplic_read_pending(struct aplic *aplic, u32 irq)
+static u32 aplic_read_state(struct aplic *aplic, u32 irq)
 {
-	bool ret;
-	unsigned long flags;
-	struct aplic_irq *irqd;
-
 	if (!irq || aplic->nr_irqs <= irq)
-		return false;
-	irqd = &aplic->irqs[irq];
+		return 0;
 
-	raw_spin_lock_irqsave(&irqd->lock, flags);
-	ret = (irqd->state & APLIC_IRQ_STATE_PENDING) ? true : false;
-	raw_spin_unlock_irqrestore(&irqd->lock, flags);
+	return READ_ONCE(aplic->irqs[irq].state);
+}
 
-	return ret;
+static bool aplic_read_pending(struct aplic *aplic, u32 irq)
+{
+	return aplic_read_state(aplic, irq) & APLIC_IRQ_STATE_PENDING;
 }
 
 static void aplic_write_pending(struct aplic *aplic, u32 irq, bool pending)
@@ -143,9 +130,9 @@ static void aplic_write_pending(struct aplic *aplic, u32 irq, bool pending)
 		goto skip_write_pending;
 
 	if (pending)
-		irqd->state |= APLIC_IRQ_STATE_PENDING;
+		WRITE_ONCE(irqd->state, irqd->state | APLIC_IRQ_STATE_PENDING);
 	else
-		irqd->state &= ~APLIC_IRQ_STATE_PENDING;
+		WRITE_ONCE(irqd->state, irqd->state & ~APLIC_IRQ_STATE_PENDING);
 
 skip_write_pending:
 	raw_spin_unlock_irqrestore(&irqd->lock, flags);
@@ -153,19 +140,7 @@ static void aplic_write_pending(struct aplic *aplic, u32 irq, bool pending)
 
 static bool aplic_read_enabled(struct aplic *aplic, u32 irq)
 {
-	bool ret;
-	unsigned long flags;
-	struct aplic_irq *irqd;
-
-	if (!irq || aplic->nr_irqs <= irq)
-		return false;
-	irqd = &aplic->irqs[irq];
-
-	raw_spin_lock_irqsave(&irqd->lock, flags);
-	ret = (irqd->state & APLIC_IRQ_STATE_ENABLED) ? true : false;
-	raw_spin_unlock_irqrestore(&irqd->lock, flags);
-
-	return ret;
+	return aplic_read_state(aplic, irq) & APLIC_IRQ_STATE_ENABLED;
 }
 
 static void aplic_write_enabled(struct aplic *aplic, u32 irq, bool enabled)
@@ -179,39 +154,52 @@ static void aplic_write_enabled(struct aplic *aplic, u32 irq, bool enabled)
 
 	raw_spin_lock_irqsave(&irqd->lock, flags);
 	if (enabled)
-		irqd->state |= APLIC_IRQ_STATE_ENABLED;
+		WRITE_ONCE(irqd->state, irqd->state | APLIC_IRQ_STATE_ENABLED);
 	else
-		irqd->state &= ~APLIC_IRQ_STATE_ENABLED;
+		WRITE_ONCE(irqd->state, irqd->state & ~APLIC_IRQ_STATE_ENABLED);
 	raw_spin_unlock_irqrestore(&irqd->lock, flags);
 }
 
 static bool aplic_read_input(struct aplic *aplic, u32 irq)
 {
-	bool ret;
-	unsigned long flags;
-	struct aplic_irq *irqd;
+	return aplic_read_state(aplic, irq) & APLIC_IRQ_STATE_INPUT;
+}
 
-	if (!irq || aplic->nr_irqs <= irq)
-		return false;
-	irqd = &aplic->irqs[irq];
+static void aplic_flush_msis(struct kvm *kvm, struct aplic_msi_batch *batch)
+{
+	u32 hart_idx, guest_idx;
 
-	raw_spin_lock_irqsave(&irqd->lock, flags);
-	ret = (irqd->state & APLIC_IRQ_STATE_INPUT) ? true : false;
-	raw_spin_unlock_irqrestore(&irqd->lock, flags);
+	if (!batch->nr)
+		return;
 
-	return ret;
+	hart_idx = batch->dest >> APLIC_TARGET_HART_IDX_SHIFT;
+	hart_idx &= APLIC_TARGET_HART_IDX_MASK;
+	guest_idx = batch->dest >> APLIC_TARGET_GUEST_IDX_SHIFT;
+	guest_idx &= APLIC_TARGET_GUEST_IDX_MASK;
+	kvm_riscv_aia_inject_msis_by_id(kvm, hart_idx, guest_idx,
+					batch->eiids, batch->nr);
+	batch->nr = 0;
+}
+
+static void aplic_queue_msi(struct kvm *kvm, struct aplic_msi_batch *batch,
+			    u32 target)
+{
+	u32 dest = target & ~APLIC_TARGET_EIID_MASK;
+
+	if (batch->nr && (batch->dest != dest ||
+			  batch->nr == APLIC_MSI_BATCH))
+		aplic_flush_msis(kvm, batch);
+
+	batch->dest = dest;
+	batch->eiids[batch->nr++] = target & APLIC_TARGET_EIID_MASK;
 }
 
 static void aplic_inject_msi(struct kvm *kvm, u32 irq, u32 target)
 {
-	u32 hart_idx, guest_idx, eiid;
+	struct aplic_msi_batch batch = { .nr = 0 };
 
-	hart_idx = target >> APLIC_TARGET_HART_IDX_SHIFT;
-	hart_idx &= APLIC_TARGET_HART_IDX_MASK;
-	guest_idx = target >> APLIC_TARGET_GUEST_IDX_SHIFT;
-	guest_idx &= APLIC_TARGET_GUEST_IDX_MASK;
-	eiid = target & APLIC_TARGET_EIID_MASK;
-	kvm_riscv_aia_inject_msi_by_id(kvm, hart_idx, guest_idx, eiid);
+	aplic_queue_msi(kvm, &batch, target);
+	aplic_flush_msis(kvm, &batch);
 }
 
 static void aplic_update_irq_range(struct kvm *kvm, u32 first, u32 last)
@@ -221,35 +209,49 @@ static void aplic_update_irq_range(struct kvm *kvm, u32 first, u32 last)
 	unsigned long flags;
 	struct aplic_irq *irqd;
 	struct aplic *aplic = kvm->arch.aia.aplic_state;
+	struct aplic_msi_batch batch = { .nr = 0 };
 
 	if (!(aplic->domaincfg & APLIC_DOMAINCFG_IE))
 		return;
 
+	first = max(first, 1U);
+	last = min(last, aplic->nr_irqs - 1);
+
 	for (irq = first; irq <= last; irq++) {
-		if (!irq || aplic->nr_irqs <= irq)
-			continue;
 		irqd = &aplic->irqs[irq];
 
+		/*
+		 * Most sources are not both enabled and pending. Whoever
+		 * makes one so updates it on its own afterwards, so a stale
+		 * look here can't lose an interrupt.
+		 */
+		if ((READ_ONCE(irqd->state) & APLIC_IRQ_STATE_ENPEND) !=
+		    APLIC_IRQ_STATE_ENPEND)
+			continue;
+
 		raw_spin_lock_irqsave(&irqd->lock, flags);
 
 		inject = false;
 		target = irqd->target;
 		if ((irqd->state & APLIC_IRQ_STATE_ENPEND) ==
 		    APLIC_IRQ_STATE_ENPEND) {
-			irqd->state &= ~APLIC_IRQ_STATE_PENDING;
+			WRITE_ONCE(irqd->state,
+				   irqd->state & ~APLIC_IRQ_STATE_PENDING);
 			inject = true;
 		}
 
 		raw_spin_unlock_irqrestore(&irqd->lock, flags);
 
 		if (inject)
-			aplic_inject_msi(kvm, irq, target);
+			aplic_queue_msi(kvm, &batch, target);
 	}
+
+	aplic_flush_msis(kvm, &batch);
 }
 
 int kvm_riscv_aia_aplic_inject(struct kvm *kvm, u32 source, bool level)
 {
-	u32 target;
+	u32 state, target;
 	bool inject = false, ie;
 	unsigned long flags;
 	struct aplic_irq *irqd;
@@ -265,39 +267,40 @@ int kvm_riscv_aia_aplic_inject(struct kvm *kvm, u32 source, bool level)
 	if (irqd->sourcecfg & APLIC_SOURCECFG_D)
 		goto skip_unlock;
 
+	state = irqd->state;
 	switch (irqd->sourcecfg & APLIC_SOURCECFG_SM_MASK) {
 	case APLIC_SOURCECFG_SM_EDGE_RISE:
-		if (level && !(irqd->state & APLIC_IRQ_STATE_INPUT) &&
-		    !(irqd->state & APLIC_IRQ_STATE_PENDING))
-			irqd->state |= APLIC_IRQ_STATE_PENDING;
+		if (level && !(state & APLIC_IRQ_STATE_INPUT))
+			state |= APLIC_IRQ_STATE_PENDING;
 		break;
 	case APLIC_SOURCECFG_SM_EDGE_FALL:
-		if (!level && (irqd->state & APLIC_IRQ_STATE_INPUT) &&
-		    !(irqd->state & APLIC_IRQ_STATE_PENDING))
-			irqd->state |= APLIC_IRQ_STATE_PENDING;
+		if (!level && (state & APLIC_IRQ_STATE_INPUT))
+			state |= APLIC_IRQ_STATE_PENDING;
 		break;
 	case APLIC_SOURCECFG_SM_LEVEL_HIGH:
-		if (level && !(irqd->state & APLIC_IRQ_STATE_PENDING))
-			irqd->state |= APLIC_IRQ_STATE_PENDING;
+		if (level)
+			state |= APLIC_IRQ_STATE_PENDING;
 		break;
 	case APLIC_SOURCECFG_SM_LEVEL_LOW:
-		if (!level && !(irqd->state & APLIC_IRQ_STATE_PENDING))
-			irqd->state |= APLIC_IRQ_STATE_PENDING;
+		if (!level)
+			state |= APLIC_IRQ_STATE_PENDING;
 		break;
 	}
 
 	if (level)
-		irqd->state |= APLIC_IRQ_STATE_INPUT;
+		state |= APLIC_IRQ_STATE_INPUT;
 	else
-		irqd->state &= ~APLIC_IRQ_STATE_INPUT;
+		state &= ~APLIC_IRQ_STATE_INPUT;
 
 	target = irqd->target;
-	if (ie && ((irqd->state & APLIC_IRQ_STATE_ENPEND) ==
+	if (ie && ((state & APLIC_IRQ_STATE_ENPEND) ==
 		   APLIC_IRQ_STATE_ENPEND)) {
-		irqd->state &= ~APLIC_IRQ_STATE_PENDING;
+		state &= ~APLIC_IRQ_STATE_PENDING;
 		inject = true;
 	}
 
+	WRITE_ONCE(irqd->state, state);
+
 skip_unlock:
 	raw_spin_unlock_irqrestore(&irqd->lock, flags);
 
@@ -426,25 +429,34 @@ static int aplic_mmio_read(struct kvm_vcpu *vcpu, struct kvm_io_device *dev,
 
 static int aplic_mmio_write_offset(struct kvm *kvm, gpa_t off, u32 val32)
 {
-	u32 i;
+	u32 i, first = 1, last = 0;
 	struct aplic *aplic = kvm->arch.aia.aplic_state;
 
 	if ((off & 0x3) != 0)
 		return -EOPNOTSUPP;
 
+	/*
+	 * Only look for sources to deliver among the ones the write may
+	 * have made enabled and pending, or retargeted.
+	 */
 	if (off == APLIC_DOMAINCFG) {
 		/* Only IE bit writeable */
 		aplic->domaincfg = val32 & APLIC_DOMAINCFG_IE;
+		last = aplic->nr_irqs - 1;
 	} else if ((off >= APLIC_SOURCECFG_BASE) &&
 		 (off < (APLIC_SOURCECFG_BASE + (aplic->nr_irqs - 1) * 4))) {
 		i = ((off - APLIC_SOURCECFG_BASE) >> 2) + 1;
 		aplic_write_sourcecfg(aplic, i, val32);
+		first = last = i;
 	} else if ((off >= APLIC_SETIP_BASE) &&
 		   (off < (APLIC_SETIP_BASE + aplic->nr_words * 4))) {
 		i = (off - APLIC_SETIP_BASE) >> 2;
 		aplic_write_pending_word(aplic, i, val32, true);
+		first = i * 32;
+		last = first + 31;
 	} else if (off == APLIC_SETIPNUM) {
 		aplic_write_pending(aplic, val32, true);
+		first = last = val32;
 	} else if ((off >= APLIC_CLRIP_BASE) &&
 		   (off < (APLIC_CLRIP_BASE + aplic->nr_words * 4))) {
 		i = (off - APLIC_CLRIP_BASE) >> 2;
@@ -455,8 +467,11 @@ static int aplic_mmio_write_offset(struct kvm *kvm, gpa_t off, u32 val32)
 		   (off < (APLIC_SETIE_BASE + aplic->nr_words * 4))) {
 		i = (off - APLIC_SETIE_BASE) >> 2;
 		aplic_write_enabled_word(aplic, i, val32, true);
+		first = i * 32;
+		last = first + 31;
 	} else if (off == APLIC_SETIENUM) {
 		aplic_write_enabled(aplic, val32, true);
+		first = last = val32;
 	} else if ((off >= APLIC_CLRIE_BASE) &&
 		   (off < (APLIC_CLRIE_BASE + aplic->nr_words * 4))) {
 		i = (off - APLIC_CLRIE_BASE) >> 2;
@@ -465,8 +480,10 @@ static int aplic_mmio_write_offset(struct kvm *kvm, gpa_t off, u32 val32)
 		aplic_write_enabled(aplic, val32, false);
 	} else if (off == APLIC_SETIPNUM_LE) {
 		aplic_write_pending(aplic, val32, true);
+		first = last = val32;
 	} else if (off == APLIC_SETIPNUM_BE) {
 		aplic_write_pending(aplic, __swab32(val32), true);
+		first = last = __swab32(val32);
 	} else if (off == APLIC_GENMSI) {
 		aplic->genmsi = val32 & ~(APLIC_TARGET_GUEST_IDX_MASK <<
 					  APLIC_TARGET_GUEST_IDX_SHIFT);
@@ -477,10 +494,11 @@ static int aplic_mmio_write_offset(struct kvm *kvm, gpa_t off, u32 val32)
 		   (off < (APLIC_TARGET_BASE + (aplic->nr_irqs - 1) * 4))) {
 		i = ((off - APLIC_TARGET_BASE) >> 2) + 1;
 		aplic_write_target(aplic, i, val32);
+		first = last = i;
 	} else
 		return -ENODEV;
 
-	aplic_update_irq_range(kvm, 1, aplic->nr_irqs - 1);
+	aplic_update_irq_range(kvm, first, last);
 
 	return 0;
 }
@@ -8,9 +8,9 @@
  */
 
 #include <linux/bits.h>
+#include <linux/irqchip/riscv-imsic.h>
 #include <linux/kvm_host.h>
 #include <linux/uaccess.h>
-#include <asm/kvm_aia_imsic.h>
 
 static void unlock_vcpus(struct kvm *kvm, int vcpu_lock_idx)
 {
@@ -571,8 +571,9 @@ void kvm_riscv_vcpu_aia_deinit(struct kvm_vcpu *vcpu)
 	kvm_riscv_vcpu_aia_imsic_cleanup(vcpu);
 }
 
-int kvm_riscv_aia_inject_msi_by_id(struct kvm *kvm, u32 hart_index,
-				   u32 guest_index, u32 iid)
+int kvm_riscv_aia_inject_msis_by_id(struct kvm *kvm, u32 hart_index,
+				    u32 guest_index, const u32 *iids,
+				    unsigned int nr)
 {
 	unsigned long idx;
 	struct kvm_vcpu *vcpu;
@@ -581,17 +582,24 @@ int kvm_riscv_aia_inject_msi_by_id(struct kvm *kvm, u32 hart_index,
 	if (!kvm_riscv_aia_initialized(kvm))
 		return -EBUSY;
 
-	/* Inject MSI to matching VCPU */
+	/* Inject MSIs to matching VCPU */
 	kvm_for_each_vcpu(idx, vcpu, kvm) {
 		if (vcpu->arch.aia_context.hart_index == hart_index)
-			return kvm_riscv_vcpu_aia_imsic_inject(vcpu,
-							       guest_index,
-							       0, iid);
+			return kvm_riscv_vcpu_aia_imsic_inject_ids(vcpu,
+								   guest_index,
+								   iids, nr);
 	}
 
 	return 0;
 }
 
+int kvm_riscv_aia_inject_msi_by_id(struct kvm *kvm, u32 hart_index,
+				   u32 guest_index, u32 iid)
+{
+	return kvm_riscv_aia_inject_msis_by_id(kvm, hart_index, guest_index,
+					       &iid, 1);
+}
+
 int kvm_riscv_aia_inject_msi(struct kvm *kvm, struct kvm_msi *msi)
 {
 	gpa_t tppn, ippn;
@@ -9,13 +9,13 @@
 
 #include <linux/atomic.h>
 #include <linux/bitmap.h>
+#include <linux/irqchip/riscv-imsic.h>
 #include <linux/kvm_host.h>
 #include <linux/math.h>
 #include <linux/spinlock.h>
 #include <linux/swab.h>
 #include <kvm/iodev.h>
 #include <asm/csr.h>
-#include <asm/kvm_aia_imsic.h>
 
 #define IMSIC_MAX_EIX	(IMSIC_MAX_ID / BITS_PER_TYPE(u64))
 
@@ -770,6 +770,8 @@ int kvm_riscv_vcpu_aia_imsic_update(struct kvm_vcpu *vcpu)
 		if (old_vsfile_cpu >= 0)
 			kvm_riscv_vcpu_aia_imsic_release(vcpu);
 
+		vcpu->stat.imsic_swfile_fallback++;
+
 		/* For automatic mode, we continue */
 		goto done;
 	}
@@ -838,6 +840,29 @@ int kvm_riscv_vcpu_aia_imsic_update(struct kvm_vcpu *vcpu)
 	return ret;
 }
 
+/*
+ * Check the VS-file of @vcpu for a pending interrupt. This is called for
+ * every halt-polling iteration, so only look at HGEIP when the VS-file
+ * belongs to the current CPU. Everything else, including a VCPU that was
+ * migrated while polling, is left to the HGEI wakeup path.
+ */
+bool kvm_riscv_vcpu_aia_imsic_has_interrupt(struct kvm_vcpu *vcpu)
+{
+	struct imsic *imsic = vcpu->arch.aia_context.imsic_state;
+	unsigned long flags;
+	bool ret = false;
+
+	if (!imsic)
+		return false;
+
+	read_lock_irqsave(&imsic->vsfile_lock, flags);
+	if (imsic->vsfile_cpu == smp_processor_id() && imsic->vsfile_hgei > 0)
+		ret = !!(csr_read(CSR_HGEIP) & BIT(imsic->vsfile_hgei));
+	read_unlock_irqrestore(&imsic->vsfile_lock, flags);
+
+	return ret;
+}
+
 int kvm_riscv_vcpu_aia_imsic_rmw(struct kvm_vcpu *vcpu, unsigned long isel,
 				 unsigned long *val, unsigned long new_val,
 				 unsigned long wr_mask)
@@ -847,6 +872,8 @@ int kvm_riscv_vcpu_aia_imsic_rmw(struct kvm_vcpu *vcpu, unsigned long isel,
 	int r, rc = KVM_INSN_CONTINUE_NEXT_SEPC;
 	struct imsic *imsic = vcpu->arch.aia_context.imsic_state;
 
+	vcpu->stat.imsic_swfile_emul++;
+
 	if (isel == KVM_RISCV_AIA_IMSIC_TOPEI) {
 		/* Read pending and enabled interrupt with highest priority */
 		topei = imsic_mrif_topei(imsic->swfile, imsic->nr_eix,
@@ -953,39 +980,74 @@ void kvm_riscv_vcpu_aia_imsic_reset(struct kvm_vcpu *vcpu)
 	memset(imsic->swfile, 0, sizeof(*imsic->swfile));
 }
 
-int kvm_riscv_vcpu_aia_imsic_inject(struct kvm_vcpu *vcpu,
-				    u32 guest_index, u32 offset, u32 iid)
+/*
+ * Deliver @nr interrupt identities at once, with a single pass over the
+ * VS-file lock and a single SW-file external interrupt update. Identities
+ * that are zero or out of range are skipped.
+ */
+int kvm_riscv_vcpu_aia_imsic_inject_ids(struct kvm_vcpu *vcpu,
+					u32 guest_index, const u32 *iids,
+					unsigned int nr)
 {
 	unsigned long flags;
 	struct imsic_mrif_eix *eix;
 	struct imsic *imsic = vcpu->arch.aia_context.imsic_state;
+	bool swfile_update = false;
+	unsigned int i;
+	u32 iid;
 
 	/* We only emulate one IMSIC MMIO page for each Guest VCPU */
-	if (!imsic || !iid || guest_index ||
-	    (offset != IMSIC_MMIO_SETIPNUM_LE &&
-	     offset != IMSIC_MMIO_SETIPNUM_BE))
+	if (!imsic || guest_index)
 		return -ENODEV;
 
-	iid = (offset == IMSIC_MMIO_SETIPNUM_BE) ? __swab32(iid) : iid;
-	if (imsic->nr_msis <= iid)
-		return -EINVAL;
-
 	read_lock_irqsave(&imsic->vsfile_lock, flags);
 
-	if (imsic->vsfile_cpu >= 0) {
-		writel(iid, imsic->vsfile_va + IMSIC_MMIO_SETIPNUM_LE);
-		kvm_vcpu_kick(vcpu);
-	} else {
-		eix = &imsic->swfile->eix[iid / BITS_PER_TYPE(u64)];
-		set_bit(iid & (BITS_PER_TYPE(u64) - 1), eix->eip);
-		imsic_swfile_extirq_update(vcpu);
+	/*
+	 * A write to the VS-file needs no kick. A running VCPU takes the
+	 * interrupt directly, a VCPU in the run-loop samples it on guest
+	 * entry, and a blocked VCPU has HGEIE set so that hgei_interrupt()
+	 * wakes it up.
+	 */
+	for (i = 0; i < nr; i++) {
+		iid = iids[i];
+		if (!iid || imsic->nr_msis <= iid)
+			continue;
+
+		if (imsic->vsfile_cpu >= 0) {
+			writel(iid, imsic->vsfile_va + IMSIC_MMIO_SETIPNUM_LE);
+		} else {
+			eix = &imsic->swfile->eix[iid / BITS_PER_TYPE(u64)];
+			set_bit(iid & (BITS_PER_TYPE(u64) - 1), eix->eip);
+			swfile_update = true;
+		}
 	}
 
+	if (swfile_update)
+		imsic_swfile_extirq_update(vcpu);
+
 	read_unlock_irqrestore(&imsic->vsfile_lock, flags);
 
 	return 0;
 }
 
+int kvm_riscv_vcpu_aia_imsic_inject(struct kvm_vcpu *vcpu,
+				    u32 guest_index, u32 offset, u32 iid)
+{
+	struct imsic *imsic = vcpu->arch.aia_context.imsic_state;
+
+	/* We only emulate one IMSIC MMIO page for each Guest VCPU */
+	if (!imsic || !iid || guest_index ||
+	    (offset != IMSIC_MMIO_SETIPNUM_LE &&
+	     offset != IMSIC_MMIO_SETIPNUM_BE))
+		return -ENODEV;
+
+	iid = (offset == IMSIC_MMIO_SETIPNUM_BE) ? __swab32(iid) : iid;
+	if (imsic->nr_msis <= iid)
+		return -EINVAL;
+
+	return kvm_riscv_vcpu_aia_imsic_inject_ids(vcpu, guest_index, &iid, 1);
+}
+
 static int imsic_mmio_read(struct kvm_vcpu *vcpu, struct kvm_io_device *dev,
 			   gpa_t addr, int len, void *val)
 {
@@ -43,6 +43,7 @@ int kvm_arch_hardware_enable(void)
 	csr_write(CSR_HCOUNTEREN, 0x02);
 
 	csr_write(CSR_HVIP, 0);
+	kvm_riscv_vcpu_forget_former();
 
 	kvm_riscv_aia_enable();
 
@@ -63,6 +64,7 @@ void kvm_arch_hardware_disable(void)
 	csr_write(CSR_HVIP, 0);
 	csr_write(CSR_HEDELEG, 0);
 	csr_write(CSR_HIDELEG, 0);
+	kvm_riscv_vcpu_forget_former();
 }
 
 static int __init riscv_kvm_init(void)
@@ -103,7 +103,7 @@ static bool gstage_get_leaf_entry(struct kvm *kvm, gpa_t addr,
 	*ptep_level = current_level;
 	ptep = (pte_t *)kvm->arch.pgd;
 	ptep = &ptep[gstage_pte_index(addr, current_level)];
-	while (ptep && pte_val(ptep_get(ptep))) {
+	while (ptep && pte_val(__ptep_get(ptep))) {
 		if (gstage_pte_leaf(ptep)) {
 			*ptep_level = current_level;
 			*ptepp = ptep;
@@ -113,7 +113,7 @@ static bool gstage_get_leaf_entry(struct kvm *kvm, gpa_t addr,
 		if (current_level) {
 			current_level--;
 			*ptep_level = current_level;
-			ptep = (pte_t *)gstage_pte_page_vaddr(ptep_get(ptep));
+			ptep = (pte_t *)gstage_pte_page_vaddr(__ptep_get(ptep));
 			ptep = &ptep[gstage_pte_index(addr, current_level)];
 		} else {
 			ptep = NULL;
@@ -134,46 +134,236 @@ static void gstage_remote_tlb_flush(struct kvm *kvm, u32 level, gpa_t addr)
 	kvm_riscv_hfence_gvma_vmid_gpa(kvm, -1UL, 0, addr, BIT(order), order);
 }
 
-static int gstage_set_pte(struct kvm *kvm, u32 level,
+/*
+ * G-stage faults only hold kvm->mmu_lock for read, so entries are installed
+ * with cmpxchg against the value the walker saw. Everything that clears or
+ * shrinks a mapping, or frees a table, still holds the lock for write.
+ */
+static bool gstage_pte_try_set(pte_t *ptep, pte_t old_pte, pte_t new_pte)
+{
+	return cmpxchg(&pte_val(*ptep), pte_val(old_pte),
+		       pte_val(new_pte)) == pte_val(old_pte);
+}
+
+/*
+ * Replace the huge leaf at @ptep with a table of leaves one level down that
+ * map the same memory with the same permissions. The translation does not
+ * change, so stale TLB entries for the huge mapping are harmless and the
+ * caller decides when to flush. Returns -EAGAIN if the leaf changed under
+ * us, in which case the caller should walk again.
+ */
+static int gstage_split_leaf(struct kvm *kvm,
+			     struct kvm_mmu_memory_cache *pcache,
+			     pte_t *ptep, u32 level)
+{
+	unsigned long child_size, pfn, prot;
+	pte_t pte = __ptep_get(ptep);
+	pte_t *child_ptep;
+	int i, ret;
+
+	ret = gstage_level_to_page_size(level - 1, &child_size);
+	if (ret)
+		return ret;
+
+	child_ptep = kvm_mmu_memory_cache_alloc(pcache);
+	if (!child_ptep)
+		return -ENOMEM;
+
+	pfn = __page_val_to_pfn(pte_val(pte));
+	prot = pte_val(pte) & ~_PAGE_PFN_MASK;
+	for (i = 0; i < PTRS_PER_PTE; i++)
+		set_pte(&child_ptep[i],
+			pfn_pte(pfn + i * (child_size >> PAGE_SHIFT), __pgprot(prot)));
+
+	if (!gstage_pte_try_set(ptep, pte, pfn_pte(PFN_DOWN(__pa(child_ptep)),
+						 __pgprot(_PAGE_TABLE)))) {
+		free_page((unsigned long)child_ptep);
+		return -EAGAIN;
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_RISCV_ISA_SVNAPOT
+#define GSTAGE_NAPOT_ORDER	NAPOT_CONT64KB_ORDER
+#define GSTAGE_NAPOT_SIZE	napot_cont_size(GSTAGE_NAPOT_ORDER)
+#define GSTAGE_NAPOT_NR		napot_pte_num(GSTAGE_NAPOT_ORDER)
+
+static inline bool gstage_pte_napot(pte_t pte)
+{
+	return has_svnapot() && pte_napot(pte);
+}
+
+/* First entry of the NAPOT group that maps @addr at level 0 */
+static inline pte_t *gstage_napot_first(pte_t *ptep, gpa_t addr)
+{
+	return ptep - (gstage_pte_index(addr, 0) & (GSTAGE_NAPOT_NR - 1));
+}
+
+static void gstage_napot_flush(struct kvm *kvm, gpa_t addr)
+{
+	kvm_riscv_hfence_gvma_vmid_gpa(kvm, -1UL, 0, addr & ~(GSTAGE_NAPOT_SIZE - 1),
+				       GSTAGE_NAPOT_SIZE, PAGE_SHIFT);
+}
+
+/*
+ * Every PTE of a NAPOT group has to agree, so before one of them gets a
+ * different mapping turn the whole group back into ordinary 4K leaves
+ * for the same memory and permissions.
+ */
+static void gstage_napot_demote(struct kvm *kvm, pte_t *ptep, gpa_t addr)
+{
+	pte_t *first = gstage_napot_first(ptep, addr);
+	pte_t old_pte;
+	unsigned long pfn, prot;
+	int i;
+
+	for (i = 0; i < GSTAGE_NAPOT_NR; i++) {
+		old_pte = __ptep_get(&first[i]);
+		if (!gstage_pte_napot(old_pte))
+			continue;
+		pfn = pte_pfn(old_pte);
+		prot = pte_val(old_pte) & ~(_PAGE_PFN_MASK | _PAGE_NAPOT);
+		gstage_pte_try_set(&first[i], old_pte,
+				   pfn_pte(pfn + i, __pgprot(prot)));
+	}
+
+	gstage_napot_flush(kvm, addr);
+}
+#else
+#define GSTAGE_NAPOT_SIZE	0
+
+static inline bool gstage_pte_napot(pte_t pte)
+{
+	return false;
+}
+
+static inline void gstage_napot_demote(struct kvm *kvm, pte_t *ptep,
+				       gpa_t addr)
+{
+}
+#endif
+
+/*
+ * Walk down to the entry for @addr at @level, allocating any missing
+ * table from @pcache and splitting any huge leaf in the way.
+ */
+static int gstage_get_ptep(struct kvm *kvm, u32 level,
 			   struct kvm_mmu_memory_cache *pcache,
-			   gpa_t addr, const pte_t *new_pte)
+			   gpa_t addr, pte_t **ptepp)
 {
 	u32 current_level = gstage_pgd_levels - 1;
 	pte_t *next_ptep = (pte_t *)kvm->arch.pgd;
 	pte_t *ptep = &next_ptep[gstage_pte_index(addr, current_level)];
+	pte_t old_pte;
+	int ret;
 
 	if (current_level < level)
 		return -EINVAL;
 
 	while (current_level != level) {
-		if (gstage_pte_leaf(ptep))
-			return -EEXIST;
+		old_pte = __ptep_get(ptep);
+
+		/*
+		 * A smaller mapping inside a huge one, e.g. a write fault on a
+		 * huge page that was write-protected for dirty logging and not
+		 * split eagerly. Demote the huge leaf first.
+		 */
+		if (pte_val(old_pte) && gstage_pte_leaf(&old_pte)) {
+			if (!pcache)
+				return -EEXIST;
+			ret = gstage_split_leaf(kvm, pcache, ptep, current_level);
+			if (ret == -EAGAIN)
+				continue;
+			if (ret)
+				return -EEXIST;
+			old_pte = __ptep_get(ptep);
+		}
 
-		if (!pte_val(ptep_get(ptep))) {
+		if (!pte_val(old_pte)) {
 			if (!pcache)
 				return -ENOMEM;
 			next_ptep = kvm_mmu_memory_cache_alloc(pcache);
 			if (!next_ptep)
 				return -ENOMEM;
-			set_pte(ptep, pfn_pte(PFN_DOWN(__pa(next_ptep)),
-					      __pgprot(_PAGE_TABLE)));
+			/* Another vCPU installed a table first, use that one */
+			if (!gstage_pte_try_set(ptep, old_pte,
+						pfn_pte(PFN_DOWN(__pa(next_ptep)),
+							__pgprot(_PAGE_TABLE)))) {
+				free_page((unsigned long)next_ptep);
+				continue;
+			}
 		} else {
-			if (gstage_pte_leaf(ptep))
-				return -EEXIST;
-			next_ptep = (pte_t *)gstage_pte_page_vaddr(ptep_get(ptep));
+			next_ptep = (pte_t *)gstage_pte_page_vaddr(old_pte);
 		}
 
 		current_level--;
 		ptep = &next_ptep[gstage_pte_index(addr, current_level)];
 	}
 
-	set_pte(ptep, *new_pte);
-	if (gstage_pte_leaf(ptep))
-		gstage_remote_tlb_flush(kvm, current_level, addr);
+	*ptepp = ptep;
+	return 0;
+}
+
+static int gstage_set_pte(struct kvm *kvm, u32 level,
+			   struct kvm_mmu_memory_cache *pcache,
+			   gpa_t addr, const pte_t *new_pte)
+{
+	pte_t *ptep, old_pte;
+	int ret;
+
+	ret = gstage_get_ptep(kvm, level, pcache, addr, &ptep);
+	if (ret)
+		return ret;
+
+	old_pte = __ptep_get(ptep);
+	if (!level && gstage_pte_napot(old_pte) &&
+	    pte_val(old_pte) != pte_val(*new_pte)) {
+		gstage_napot_demote(kvm, ptep, addr);
+		old_pte = __ptep_get(ptep);
+	}
+
+	/*
+	 * Losing the race here means another vCPU faulted on the same address
+	 * and has already installed a mapping, so let the guest retry.
+	 */
+	if (!gstage_pte_try_set(ptep, old_pte, *new_pte))
+		return -EAGAIN;
+	if (gstage_pte_leaf(new_pte))
+		gstage_remote_tlb_flush(kvm, level, addr);
 
 	return 0;
 }
 
+#ifdef CONFIG_RISCV_ISA_SVNAPOT
+/*
+ * Install @new_pte, already encoded with pte_mknapot(), in all the level 0
+ * entries of the NAPOT group covering @addr with a single TLB flush.
+ */
+static int gstage_set_napot(struct kvm *kvm,
+			    struct kvm_mmu_memory_cache *pcache,
+			    gpa_t addr, const pte_t *new_pte)
+{
+	pte_t *ptep, old_pte;
+	int i, ret;
+
+	addr &= ~(GSTAGE_NAPOT_SIZE - 1);
+	ret = gstage_get_ptep(kvm, 0, pcache, addr, &ptep);
+	if (ret)
+		return ret;
+
+	/* A racing vCPU can only be installing the same group */
+	for (i = 0; i < GSTAGE_NAPOT_NR; i++) {
+		old_pte = __ptep_get(&ptep[i]);
+		gstage_pte_try_set(&ptep[i], old_pte, *new_pte);
+	}
+
+	gstage_napot_flush(kvm, addr);
+
+	return 0;
+}
+#endif
+
 static int gstage_map_page(struct kvm *kvm,
 			   struct kvm_mmu_memory_cache *pcache,
 			   gpa_t gpa, phys_addr_t hpa,
@@ -185,9 +375,14 @@ static int gstage_map_page(struct kvm *kvm,
 	pte_t new_pte;
 	pgprot_t prot;
 
-	ret = gstage_page_size_to_level(page_size, &level);
-	if (ret)
-		return ret;
+	if (GSTAGE_NAPOT_SIZE && page_size == GSTAGE_NAPOT_SIZE) {
+		if (!has_svnapot())
+			return -EINVAL;
+	} else {
+		ret = gstage_page_size_to_level(page_size, &level);
+		if (ret)
+			return ret;
+	}
 
 	/*
 	 * A RISC-V implementation can choose to either:
@@ -216,6 +411,13 @@ static int gstage_map_page(struct kvm *kvm,
 	new_pte = pfn_pte(PFN_DOWN(hpa), prot);
 	new_pte = pte_mkdirty(new_pte);
 
+#ifdef CONFIG_RISCV_ISA_SVNAPOT
+	if (page_size == GSTAGE_NAPOT_SIZE) {
+		new_pte = pte_mknapot(new_pte, GSTAGE_NAPOT_ORDER);
+		return gstage_set_napot(kvm, pcache, gpa, &new_pte);
+	}
+#endif
+
 	return gstage_set_pte(kvm, level, pcache, gpa, &new_pte);
 }
 
@@ -225,6 +427,35 @@ enum gstage_op {
 	GSTAGE_OP_WP,		/* Write-protect */
 };
 
+#ifdef CONFIG_RISCV_ISA_SVNAPOT
+/*
+ * Clearing or write-protecting part of a NAPOT group would leave it
+ * inconsistent, so always operate on the whole group. Doing more than
+ * asked is fine for both operations.
+ */
+static void gstage_op_napot(struct kvm *kvm, gpa_t addr,
+			    pte_t *ptep, enum gstage_op op)
+{
+	pte_t *first = gstage_napot_first(ptep, addr);
+	int i;
+
+	for (i = 0; i < GSTAGE_NAPOT_NR; i++) {
+		if (op == GSTAGE_OP_CLEAR)
+			set_pte(&first[i], __pte(0));
+		else if (op == GSTAGE_OP_WP)
+			set_pte(&first[i],
+				__pte(pte_val(__ptep_get(&first[i])) & ~_PAGE_WRITE));
+	}
+
+	gstage_napot_flush(kvm, addr);
+}
+#else
+static inline void gstage_op_napot(struct kvm *kvm, gpa_t addr,
+				   pte_t *ptep, enum gstage_op op)
+{
+}
+#endif
+
 static void gstage_op_pte(struct kvm *kvm, gpa_t addr,
 			  pte_t *ptep, u32 ptep_level, enum gstage_op op)
 {
@@ -239,11 +470,11 @@ static void gstage_op_pte(struct kvm *kvm, gpa_t addr,
 
 	BUG_ON(addr & (page_size - 1));
 
-	if (!pte_val(ptep_get(ptep)))
+	if (!pte_val(__ptep_get(ptep)))
 		return;
 
 	if (ptep_level && !gstage_pte_leaf(ptep)) {
-		next_ptep = (pte_t *)gstage_pte_page_vaddr(ptep_get(ptep));
+		next_ptep = (pte_t *)gstage_pte_page_vaddr(__ptep_get(ptep));
 		next_ptep_level = ptep_level - 1;
 		ret = gstage_level_to_page_size(next_ptep_level,
 						&next_page_size);
@@ -257,11 +488,13 @@ static void gstage_op_pte(struct kvm *kvm, gpa_t addr,
 					&next_ptep[i], next_ptep_level, op);
 		if (op == GSTAGE_OP_CLEAR)
 			put_page(virt_to_page(next_ptep));
+	} else if (!ptep_level && gstage_pte_napot(__ptep_get(ptep))) {
+		gstage_op_napot(kvm, addr, ptep, op);
 	} else {
 		if (op == GSTAGE_OP_CLEAR)
 			set_pte(ptep, __pte(0));
 		else if (op == GSTAGE_OP_WP)
-			set_pte(ptep, __pte(pte_val(ptep_get(ptep)) & ~_PAGE_WRITE));
+			set_pte(ptep, __pte(pte_val(__ptep_get(ptep)) & ~_PAGE_WRITE));
 		gstage_remote_tlb_flush(kvm, ptep_level, addr);
 	}
 }
@@ -298,7 +531,7 @@ static void gstage_unmap_range(struct kvm *kvm, gpa_t start,
 		 * to prevent starvation and lockup detector warnings.
 		 */
 		if (may_block && addr < end)
-			cond_resched_lock(&kvm->mmu_lock);
+			cond_resched_rwlock_write(&kvm->mmu_lock);
 	}
 }
 
@@ -330,6 +563,80 @@ static void gstage_wp_range(struct kvm *kvm, gpa_t start, gpa_t end)
 	}
 }
 
+/*
+ * Split every huge leaf in [*addr, end) down to PAGE_SIZE. Returns -EAGAIN
+ * with *addr updated when @pcache runs dry or the lock is contended, so the
+ * caller can refill the cache outside of kvm->mmu_lock and resume.
+ */
+static int gstage_split_range(struct kvm *kvm, gpa_t *addr, gpa_t end,
+			      struct kvm_mmu_memory_cache *pcache)
+{
+	int ret;
+	pte_t *ptep;
+	u32 ptep_level;
+	bool found_leaf;
+	unsigned long page_size;
+
+	while (*addr < end) {
+		found_leaf = gstage_get_leaf_entry(kvm, *addr,
+						   &ptep, &ptep_level);
+		ret = gstage_level_to_page_size(ptep_level, &page_size);
+		if (ret)
+			return ret;
+
+		if (found_leaf && ptep_level) {
+			if (!kvm_mmu_memory_cache_nr_free_objects(pcache))
+				return -EAGAIN;
+			ret = gstage_split_leaf(kvm, pcache, ptep, ptep_level);
+			if (ret && ret != -EAGAIN)
+				return ret;
+			/* Walk again, down to the new leaves */
+			continue;
+		}
+
+		*addr = (*addr & ~(page_size - 1)) + page_size;
+
+		if (need_resched() || rwlock_needbreak(&kvm->mmu_lock))
+			return -EAGAIN;
+	}
+
+	return 0;
+}
+
+/*
+ * Without this, every huge mapping of the slot gets demoted on its first
+ * write fault after dirty logging starts, which shows up as a burst of
+ * G-stage faults at the start of migration. Split them all up front, with
+ * page tables allocated outside of kvm->mmu_lock, so vCPUs only ever wait
+ * for one cache worth of splitting.
+ */
+#define GSTAGE_SPLIT_CACHE_CAPACITY	PTRS_PER_PTE
+
+static void gstage_split_memory_region(struct kvm *kvm, int slot)
+{
+	struct kvm_memslots *slots = kvm_memslots(kvm);
+	struct kvm_memory_slot *memslot = id_to_memslot(slots, slot);
+	struct kvm_mmu_memory_cache *pcache = &kvm->arch.split_page_cache;
+	gpa_t addr = memslot->base_gfn << PAGE_SHIFT;
+	gpa_t end = (memslot->base_gfn + memslot->npages) << PAGE_SHIFT;
+	int ret;
+
+	lockdep_assert_held(&kvm->slots_lock);
+
+	do {
+		/* On failure, the fault path will split what is left lazily */
+		if (__kvm_mmu_topup_memory_cache(pcache, GSTAGE_SPLIT_CACHE_CAPACITY, 1))
+			break;
+
+		write_lock(&kvm->mmu_lock);
+		ret = gstage_split_range(kvm, &addr, end, pcache);
+		write_unlock(&kvm->mmu_lock);
+		cond_resched();
+	} while (ret == -EAGAIN);
+
+	kvm_mmu_free_memory_cache(pcache);
+}
+
 static void gstage_wp_memory_region(struct kvm *kvm, int slot)
 {
 	struct kvm_memslots *slots = kvm_memslots(kvm);
@@ -337,9 +644,9 @@ static void gstage_wp_memory_region(struct kvm *kvm, int slot)
 	phys_addr_t start = memslot->base_gfn << PAGE_SHIFT;
 	phys_addr_t end = (memslot->base_gfn + memslot->npages) << PAGE_SHIFT;
 
-	spin_lock(&kvm->mmu_lock);
+	write_lock(&kvm->mmu_lock);
 	gstage_wp_range(kvm, start, end);
-	spin_unlock(&kvm->mmu_lock);
+	write_unlock(&kvm->mmu_lock);
 	kvm_flush_remote_tlbs(kvm);
 }
 
@@ -369,9 +676,9 @@ int kvm_riscv_gstage_ioremap(struct kvm *kvm, gpa_t gpa,
 		if (ret)
 			goto out;
 
-		spin_lock(&kvm->mmu_lock);
+		write_lock(&kvm->mmu_lock);
 		ret = gstage_set_pte(kvm, 0, &pcache, addr, &pte);
-		spin_unlock(&kvm->mmu_lock);
+		write_unlock(&kvm->mmu_lock);
 		if (ret)
 			goto out;
 
@@ -385,9 +692,9 @@ int kvm_riscv_gstage_ioremap(struct kvm *kvm, gpa_t gpa,
 
 void kvm_riscv_gstage_iounmap(struct kvm *kvm, gpa_t gpa, unsigned long size)
 {
-	spin_lock(&kvm->mmu_lock);
+	write_lock(&kvm->mmu_lock);
 	gstage_unmap_range(kvm, gpa, size, false);
-	spin_unlock(&kvm->mmu_lock);
+	write_unlock(&kvm->mmu_lock);
 }
 
 void kvm_arch_mmu_enable_log_dirty_pt_masked(struct kvm *kvm,
@@ -425,9 +732,9 @@ void kvm_arch_flush_shadow_memslot(struct kvm *kvm,
 	gpa_t gpa = slot->base_gfn << PAGE_SHIFT;
 	phys_addr_t size = slot->npages << PAGE_SHIFT;
 
-	spin_lock(&kvm->mmu_lock);
+	write_lock(&kvm->mmu_lock);
 	gstage_unmap_range(kvm, gpa, size, false);
-	spin_unlock(&kvm->mmu_lock);
+	write_unlock(&kvm->mmu_lock);
 }
 
 void kvm_arch_commit_memory_region(struct kvm *kvm,
@@ -438,10 +745,15 @@ void kvm_arch_commit_memory_region(struct kvm *kvm,
 	/*
 	 * At this point memslot has been committed and there is an
 	 * allocated dirty_bitmap[], dirty pages will be tracked while
-	 * the memory slot is write protected.
+	 * the memory slot is write protected. Split huge mappings first so
+	 * the write-protect, and the TLB flush that comes with it, covers
+	 * the final PAGE_SIZE leaves.
 	 */
-	if (change != KVM_MR_DELETE && new->flags & KVM_MEM_LOG_DIRTY_PAGES)
+	if (change != KVM_MR_DELETE && new->flags & KVM_MEM_LOG_DIRTY_PAGES) {
+		if (!old || !(old->flags & KVM_MEM_LOG_DIRTY_PAGES))
+			gstage_split_memory_region(kvm, new->id);
 		gstage_wp_memory_region(kvm, new->id);
+	}
 }
 
 int kvm_arch_prepare_memory_region(struct kvm *kvm,
@@ -550,6 +862,45 @@ bool kvm_unmap_gfn_range(struct kvm *kvm, struct kvm_gfn_range *range)
 	return false;
 }
 
+#ifdef CONFIG_KVM_GENERIC_MEMORY_ATTRIBUTES
+bool kvm_arch_pre_set_memory_attributes(struct kvm *kvm,
+					struct kvm_gfn_range *range)
+{
+	/*
+	 * Converted pages must no longer be reached through their old
+	 * backing, the next fault maps them from the new one.
+	 */
+	if (WARN_ON_ONCE(!kvm_arch_has_private_mem(kvm)))
+		return false;
+
+	return kvm_unmap_gfn_range(kvm, range);
+}
+
+bool kvm_arch_post_set_memory_attributes(struct kvm *kvm,
+					 struct kvm_gfn_range *range)
+{
+	/* Huge mappings are checked against the attributes at fault time. */
+	return false;
+}
+
+/* A huge G-stage mapping must not mix private and shared pages. */
+static bool gstage_attrs_uniform(struct kvm *kvm, gfn_t gfn, unsigned long nr,
+				 bool private)
+{
+	if (!kvm_arch_has_private_mem(kvm))
+		return true;
+
+	return kvm_range_has_memory_attributes(kvm, gfn, gfn + nr,
+			private ? KVM_MEMORY_ATTRIBUTE_PRIVATE : 0);
+}
+#else
+static inline bool gstage_attrs_uniform(struct kvm *kvm, gfn_t gfn,
+					unsigned long nr, bool private)
+{
+	return true;
+}
+#endif
+
 bool kvm_set_spte_gfn(struct kvm *kvm, struct kvm_gfn_range *range)
 {
 	int ret;
@@ -585,7 +936,7 @@ bool kvm_age_gfn(struct kvm *kvm, struct kvm_gfn_range *range)
 				   &ptep, &ptep_level))
 		return false;
 
-	return ptep_test_and_clear_young(NULL, 0, ptep);
+	return __ptep_test_and_clear_young(NULL, 0, ptep);
 }
 
 bool kvm_test_age_gfn(struct kvm *kvm, struct kvm_gfn_range *range)
@@ -603,22 +954,42 @@ bool kvm_test_age_gfn(struct kvm *kvm, struct kvm_gfn_range *range)
 				   &ptep, &ptep_level))
 		return false;
 
-	return pte_young(ptep_get(ptep));
+	return pte_young(__ptep_get(ptep));
+}
+
+/*
+ * A 64K hugetlb page can only become a G-stage NAPOT group if the guest
+ * and host addresses are equally aligned and the whole group lies in the
+ * memslot. Anything else is mapped with 4K pages.
+ */
+static bool gstage_napot_fits(struct kvm_memory_slot *memslot, gpa_t gpa)
+{
+	unsigned long nr = GSTAGE_NAPOT_SIZE >> PAGE_SHIFT;
+	gfn_t gfn = ALIGN_DOWN(gpa >> PAGE_SHIFT, nr);
+
+	if (!has_svnapot())
+		return false;
+	if ((memslot->base_gfn ^ (memslot->userspace_addr >> PAGE_SHIFT)) & (nr - 1))
+		return false;
+
+	return gfn >= memslot->base_gfn &&
+	       gfn + nr <= memslot->base_gfn + memslot->npages;
 }
 
 int kvm_riscv_gstage_map(struct kvm_vcpu *vcpu,
 			 struct kvm_memory_slot *memslot,
-			 gpa_t gpa, unsigned long hva, bool is_write)
+			 gpa_t gpa, unsigned long hva, bool is_write,
+			 struct kvm_cpu_trap *trap)
 {
 	int ret;
 	kvm_pfn_t hfn;
-	bool writable;
+	bool writable, async = false;
 	short vma_pageshift;
 	gfn_t gfn = gpa >> PAGE_SHIFT;
 	struct vm_area_struct *vma;
 	struct kvm *kvm = vcpu->kvm;
 	struct kvm_mmu_memory_cache *pcache = &vcpu->arch.mmu_page_cache;
-	bool logging = (memslot->dirty_bitmap &&
+	bool logging = (kvm_slot_dirty_track_enabled(memslot) &&
 			!(memslot->flags & KVM_MEM_READONLY)) ? true : false;
 	unsigned long vma_pagesize, mmu_seq;
 
@@ -645,8 +1016,16 @@ int kvm_riscv_gstage_map(struct kvm_vcpu *vcpu,
 	vma_pagesize = 1ULL << vma_pageshift;
 	if (logging || (vma->vm_flags & VM_PFNMAP))
 		vma_pagesize = PAGE_SIZE;
+	if (GSTAGE_NAPOT_SIZE && vma_pagesize == GSTAGE_NAPOT_SIZE &&
+	    !gstage_napot_fits(memslot, gpa))
+		vma_pagesize = PAGE_SIZE;
+	if (vma_pagesize != PAGE_SIZE &&
+	    !gstage_attrs_uniform(kvm, ALIGN_DOWN(gfn, vma_pagesize >> PAGE_SHIFT),
+				  vma_pagesize >> PAGE_SHIFT, false))
+		vma_pagesize = PAGE_SIZE;
 
-	if (vma_pagesize == PMD_SIZE || vma_pagesize == PUD_SIZE)
+	if (vma_pagesize == PMD_SIZE || vma_pagesize == PUD_SIZE ||
+	    (GSTAGE_NAPOT_SIZE && vma_pagesize == GSTAGE_NAPOT_SIZE))
 		gfn = (gpa & huge_page_mask(hstate_vma(vma))) >> PAGE_SHIFT;
 
 	/*
@@ -660,14 +1039,41 @@ int kvm_riscv_gstage_map(struct kvm_vcpu *vcpu,
 	mmu_seq = kvm->mmu_invalidate_seq;
 	mmap_read_unlock(current->mm);
 
+	/*
+	 * A conversion to private since gstage_page_fault() looked at the
+	 * attributes bumps mmu_invalidate_seq, so it is either seen here or
+	 * caught by mmu_invalidate_retry(). Let userspace resolve it.
+	 */
+	if (kvm_slot_can_be_private(memslot) &&
+	    kvm_mem_is_private(kvm, gpa >> PAGE_SHIFT)) {
+		kvm_prepare_memory_fault_exit(vcpu, gpa & PAGE_MASK, PAGE_SIZE,
+					      is_write,
+					      trap->scause == EXC_INST_GUEST_PAGE_FAULT,
+					      false);
+		return -EFAULT;
+	}
+
 	if (vma_pagesize != PUD_SIZE &&
 	    vma_pagesize != PMD_SIZE &&
+	    (!GSTAGE_NAPOT_SIZE || vma_pagesize != GSTAGE_NAPOT_SIZE) &&
 	    vma_pagesize != PAGE_SIZE) {
 		kvm_err("Invalid VMA page size 0x%lx\n", vma_pagesize);
 		return -EFAULT;
 	}
 
-	hfn = gfn_to_pfn_prot(kvm, gfn, is_write, &writable);
+	/*
+	 * A page that first has to be read back from swap or fetched by
+	 * userfaultfd is brought in by a worker when the guest can run
+	 * another task meanwhile, see kvm_riscv_vcpu_apf_setup().
+	 */
+	hfn = __gfn_to_pfn_memslot(gfn_to_memslot(kvm, gfn), gfn, false, false,
+				   kvm_riscv_vcpu_apf_can_inject(vcpu) ?
+				   &async : NULL, is_write, &writable, NULL);
+	if (async) {
+		if (kvm_riscv_vcpu_apf_setup(vcpu, trap, gpa, hva))
+			return 0;
+		hfn = gfn_to_pfn_prot(kvm, gfn, is_write, &writable);
+	}
 	if (hfn == KVM_PFN_ERR_HWPOISON) {
 		send_sig_mceerr(BUS_MCEERR_AR, (void __user *)hva,
 				vma_pageshift, current);
@@ -683,12 +1089,18 @@ int kvm_riscv_gstage_map(struct kvm_vcpu *vcpu,
 	if (logging && !is_write)
 		writable = false;
 
-	spin_lock(&kvm->mmu_lock);
+	/*
+	 * Faults only ever add or widen mappings, so they can run in parallel
+	 * and serialize against each other with cmpxchg in gstage_set_pte().
+	 */
+	read_lock(&kvm->mmu_lock);
 
 	if (mmu_invalidate_retry(kvm, mmu_seq))
 		goto out_unlock;
 
 	if (writable) {
+		if (logging)
+			vcpu->stat.gstage_fault_dirty_log++;
 		kvm_set_pfn_dirty(hfn);
 		mark_page_dirty(kvm, gfn);
 		ret = gstage_map_page(kvm, pcache, gpa, hfn << PAGE_SHIFT,
@@ -698,16 +1110,107 @@ int kvm_riscv_gstage_map(struct kvm_vcpu *vcpu,
 				      vma_pagesize, true, true);
 	}
 
-	if (ret)
+	if (ret == -EAGAIN)
+		ret = 0;
+	else if (ret)
 		kvm_err("Failed to map in G-stage\n");
 
 out_unlock:
-	spin_unlock(&kvm->mmu_lock);
+	read_unlock(&kvm->mmu_lock);
 	kvm_set_pfn_accessed(hfn);
 	kvm_release_pfn_clean(hfn);
 	return ret;
 }
 
+/*
+ * A guest_memfd folio backs a PMD mapping if it covers the block, the gfn
+ * and file index are equally aligned, and the block lies in the memslot
+ * with only private pages.
+ */
+static unsigned long gstage_gmem_pagesize(struct kvm *kvm,
+					  struct kvm_memory_slot *memslot,
+					  gfn_t gfn, int max_order)
+{
+	unsigned long nr = PMD_SIZE >> PAGE_SHIFT;
+	gfn_t base = ALIGN_DOWN(gfn, nr);
+
+	if (max_order < PMD_SHIFT - PAGE_SHIFT)
+		return PAGE_SIZE;
+	if ((memslot->base_gfn ^ memslot->gmem.pgoff) & (nr - 1))
+		return PAGE_SIZE;
+	if (base < memslot->base_gfn ||
+	    base + nr > memslot->base_gfn + memslot->npages)
+		return PAGE_SIZE;
+	if (!gstage_attrs_uniform(kvm, base, nr, true))
+		return PAGE_SIZE;
+
+	return PMD_SIZE;
+}
+
+/*
+ * Map a private page straight from the guest_memfd bound to the memslot,
+ * without going through a userspace mapping. Such a memslot can't be
+ * read-only nor dirty logged, so the mapping is always writable.
+ */
+int kvm_riscv_gstage_gmem_map(struct kvm_vcpu *vcpu,
+			      struct kvm_memory_slot *memslot,
+			      gpa_t gpa, bool is_write, bool is_exec)
+{
+	struct kvm_mmu_memory_cache *pcache = &vcpu->arch.mmu_page_cache;
+	gfn_t gfn = gpa >> PAGE_SHIFT;
+	struct kvm *kvm = vcpu->kvm;
+	unsigned long pagesize, mmu_seq;
+	kvm_pfn_t pfn, hfn;
+	int max_order, ret;
+
+	ret = kvm_mmu_topup_memory_cache(pcache, gstage_pgd_levels);
+	if (ret) {
+		kvm_err("Failed to topup G-stage cache\n");
+		return ret;
+	}
+
+	mmu_seq = kvm->mmu_invalidate_seq;
+	/*
+	 * Read mmu_seq before the attributes and the pfn, pairs with
+	 * kvm_mmu_invalidate_end().
+	 */
+	smp_rmb();
+
+	/* As in kvm_riscv_gstage_map(), for a conversion to shared. */
+	if (!kvm_mem_is_private(kvm, gfn)) {
+		kvm_prepare_memory_fault_exit(vcpu, gpa & PAGE_MASK, PAGE_SIZE,
+					      is_write, is_exec, true);
+		return -EFAULT;
+	}
+
+	ret = kvm_gmem_get_pfn(kvm, memslot, gfn, &pfn, &max_order);
+	if (ret) {
+		kvm_prepare_memory_fault_exit(vcpu, gpa & PAGE_MASK, PAGE_SIZE,
+					      is_write, is_exec, true);
+		return ret;
+	}
+
+	pagesize = gstage_gmem_pagesize(kvm, memslot, gfn, max_order);
+	hfn = ALIGN_DOWN(pfn, pagesize >> PAGE_SHIFT);
+
+	read_lock(&kvm->mmu_lock);
+
+	if (mmu_invalidate_retry(kvm, mmu_seq))
+		goto out_unlock;
+
+	ret = gstage_map_page(kvm, pcache, ALIGN_DOWN(gpa, pagesize),
+			      hfn << PAGE_SHIFT, pagesize, false, true);
+	if (ret == -EAGAIN)
+		ret = 0;
+	else if (ret)
+		kvm_err("Failed to map in G-stage\n");
+
+out_unlock:
+	read_unlock(&kvm->mmu_lock);
+	kvm_release_pfn_clean(pfn);
+	return ret;
+}
+
 int kvm_riscv_gstage_alloc_pgd(struct kvm *kvm)
 {
 	struct page *pgd_page;
@@ -731,14 +1234,14 @@ void kvm_riscv_gstage_free_pgd(struct kvm *kvm)
 {
 	void *pgd = NULL;
 
-	spin_lock(&kvm->mmu_lock);
+	write_lock(&kvm->mmu_lock);
 	if (kvm->arch.pgd) {
 		gstage_unmap_range(kvm, 0UL, gstage_gpa_size, false);
 		pgd = READ_ONCE(kvm->arch.pgd);
 		kvm->arch.pgd = NULL;
 		kvm->arch.pgd_phys = 0;
 	}
-	spin_unlock(&kvm->mmu_lock);
+	write_unlock(&kvm->mmu_lock);
 
 	if (pgd)
 		free_pages((unsigned long)pgd, get_order(gstage_pgd_size));
@@ -8,6 +8,7 @@
 #include <linux/errno.h>
 #include <linux/err.h>
 #include <linux/module.h>
+#include <linux/overflow.h>
 #include <linux/smp.h>
 #include <linux/kvm_host.h>
 #include <asm/cacheflush.h>
@@ -181,6 +182,7 @@ void kvm_riscv_local_tlb_sanitize(struct kvm_vcpu *vcpu)
 void kvm_riscv_fence_i_process(struct kvm_vcpu *vcpu)
 {
 	kvm_riscv_vcpu_pmu_incr_fw(vcpu, SBI_PMU_FW_FENCE_I_RCVD);
+	vcpu->stat.fence_i_rcvd++;
 	local_flush_icache_all();
 }
 
@@ -188,6 +190,7 @@ void kvm_riscv_hfence_gvma_vmid_all_process(struct kvm_vcpu *vcpu)
 {
 	struct kvm_vmid *vmid;
 
+	vcpu->stat.hfence_gvma_vmid_all++;
 	vmid = &vcpu->kvm->arch.vmid;
 	kvm_riscv_local_hfence_gvma_vmid_all(READ_ONCE(vmid->vmid));
 }
@@ -196,6 +199,7 @@ void kvm_riscv_hfence_vvma_all_process(struct kvm_vcpu *vcpu)
 {
 	struct kvm_vmid *vmid;
 
+	vcpu->stat.hfence_vvma_all++;
 	vmid = &vcpu->kvm->arch.vmid;
 	kvm_riscv_local_hfence_vvma_all(READ_ONCE(vmid->vmid));
 }
@@ -225,15 +229,56 @@ static bool vcpu_hfence_dequeue(struct kvm_vcpu *vcpu,
 	return ret;
 }
 
+/*
+ * Try to fold @data into the pending request @prev. Same-kind ranges
+ * that overlap or touch are widened into one, and anything covered by
+ * a pending ASID-wide flush is dropped.
+ */
+static bool vcpu_hfence_merge(struct kvm_riscv_hfence *prev,
+			      const struct kvm_riscv_hfence *data)
+{
+	gpa_t prev_end, data_end;
+
+	if (prev->type == KVM_RISCV_HFENCE_VVMA_ASID_ALL)
+		return (data->type == KVM_RISCV_HFENCE_VVMA_ASID_ALL ||
+			data->type == KVM_RISCV_HFENCE_VVMA_ASID_GVA) &&
+		       data->asid == prev->asid;
+
+	if (prev->type != data->type || prev->asid != data->asid ||
+	    prev->order != data->order)
+		return false;
+
+	if (check_add_overflow(prev->addr, prev->size, &prev_end) ||
+	    check_add_overflow(data->addr, data->size, &data_end))
+		return false;
+	if (data->addr > prev_end || prev->addr > data_end)
+		return false;
+
+	prev->addr = min(prev->addr, data->addr);
+	prev->size = max(prev_end, data_end) - prev->addr;
+	return true;
+}
+
 static bool vcpu_hfence_enqueue(struct kvm_vcpu *vcpu,
 				const struct kvm_riscv_hfence *data)
 {
 	bool ret = false;
 	struct kvm_vcpu_arch *varch = &vcpu->arch;
+	struct kvm_riscv_hfence *prev;
 
 	spin_lock(&varch->hfence_lock);
 
-	if (!varch->hfence_queue[varch->hfence_tail].type) {
+	/*
+	 * The most recent entry is still pending as long as it has a type,
+	 * because the dequeue side clears it under hfence_lock.
+	 */
+	prev = &varch->hfence_queue[varch->hfence_tail ?
+				    varch->hfence_tail - 1 :
+				    KVM_RISCV_VCPU_MAX_HFENCE - 1];
+	if (prev->type && vcpu_hfence_merge(prev, data)) {
+		vcpu->stat.hfence_merged++;
+		ret = true;
+	} else if (!varch->hfence_queue[varch->hfence_tail].type) {
 		memcpy(&varch->hfence_queue[varch->hfence_tail],
 		       data, sizeof(*data));
 
@@ -242,6 +287,8 @@ static bool vcpu_hfence_enqueue(struct kvm_vcpu *vcpu,
 			varch->hfence_tail = 0;
 
 		ret = true;
+	} else {
+		vcpu->stat.hfence_queue_full++;
 	}
 
 	spin_unlock(&varch->hfence_lock);
@@ -259,23 +306,27 @@ void kvm_riscv_hfence_process(struct kvm_vcpu *vcpu)
 		case KVM_RISCV_HFENCE_UNKNOWN:
 			break;
 		case KVM_RISCV_HFENCE_GVMA_VMID_GPA:
+			vcpu->stat.hfence_gvma_vmid_gpa++;
 			kvm_riscv_local_hfence_gvma_vmid_gpa(
 						READ_ONCE(v->vmid),
 						d.addr, d.size, d.order);
 			break;
 		case KVM_RISCV_HFENCE_VVMA_ASID_GVA:
 			kvm_riscv_vcpu_pmu_incr_fw(vcpu, SBI_PMU_FW_HFENCE_VVMA_ASID_RCVD);
+			vcpu->stat.hfence_vvma_asid_gva++;
 			kvm_riscv_local_hfence_vvma_asid_gva(
 						READ_ONCE(v->vmid), d.asid,
 						d.addr, d.size, d.order);
 			break;
 		case KVM_RISCV_HFENCE_VVMA_ASID_ALL:
 			kvm_riscv_vcpu_pmu_incr_fw(vcpu, SBI_PMU_FW_HFENCE_VVMA_ASID_RCVD);
+			vcpu->stat.hfence_vvma_asid_all++;
 			kvm_riscv_local_hfence_vvma_asid_all(
 						READ_ONCE(v->vmid), d.asid);
 			break;
 		case KVM_RISCV_HFENCE_VVMA_GVA:
 			kvm_riscv_vcpu_pmu_incr_fw(vcpu, SBI_PMU_FW_HFENCE_VVMA_RCVD);
+			vcpu->stat.hfence_vvma_gva++;
 			kvm_riscv_local_hfence_vvma_gva(
 						READ_ONCE(v->vmid),
 						d.addr, d.size, d.order);
@@ -27,12 +27,36 @@ const struct _kvm_stats_desc kvm_vcpu_stats_desc[] = {
 	STATS_DESC_COUNTER(VCPU, wfi_exit_stat),
 	STATS_DESC_COUNTER(VCPU, mmio_exit_user),
 	STATS_DESC_COUNTER(VCPU, mmio_exit_kernel),
+	STATS_DESC_COUNTER(VCPU, mmio_insn_fetch),
 	STATS_DESC_COUNTER(VCPU, csr_exit_user),
 	STATS_DESC_COUNTER(VCPU, csr_exit_kernel),
 	STATS_DESC_COUNTER(VCPU, signal_exits),
-	STATS_DESC_COUNTER(VCPU, exits)
+	STATS_DESC_COUNTER(VCPU, exits),
+	STATS_DESC_COUNTER(VCPU, hfence_merged),
+	STATS_DESC_COUNTER(VCPU, hfence_queue_full),
+	STATS_DESC_LOGHIST_TIME_NSEC(VCPU, wfi_wakeup_hist, HALT_POLL_HIST_COUNT),
+	STATS_DESC_LINEAR_HIST(VCPU, sbi_ext_hist, KVM_STATS_UNIT_NONE,
+			       KVM_STATS_BASE_POW10, 0,
+			       KVM_RISCV_SBI_EXT_MAX + 1, 1),
+	STATS_DESC_COUNTER(VCPU, sbi_unsupported),
+	STATS_DESC_COUNTER(VCPU, gstage_fault_load),
+	STATS_DESC_COUNTER(VCPU, gstage_fault_store),
+	STATS_DESC_COUNTER(VCPU, gstage_fault_exec),
+	STATS_DESC_COUNTER(VCPU, gstage_fault_dirty_log),
+	STATS_DESC_COUNTER(VCPU, fence_i_rcvd),
+	STATS_DESC_COUNTER(VCPU, hfence_gvma_vmid_all),
+	STATS_DESC_COUNTER(VCPU, hfence_gvma_vmid_gpa),
+	STATS_DESC_COUNTER(VCPU, hfence_vvma_all),
+	STATS_DESC_COUNTER(VCPU, hfence_vvma_asid_gva),
+	STATS_DESC_COUNTER(VCPU, hfence_vvma_asid_all),
+	STATS_DESC_COUNTER(VCPU, hfence_vvma_gva),
+	STATS_DESC_COUNTER(VCPU, imsic_swfile_fallback),
+	STATS_DESC_COUNTER(VCPU, imsic_swfile_emul),
 };
 
+/* VCPU last put on this CPU, its VS CSRs are still in the hardware. */
+static DEFINE_PER_CPU(struct kvm_vcpu *, kvm_former_vcpu);
+
 const struct kvm_stats_header kvm_vcpu_stats_header = {
 	.name_size = KVM_STATS_NAME_SIZE,
 	.num_desc = ARRAY_SIZE(kvm_vcpu_stats_desc),
@@ -50,6 +74,9 @@ static void kvm_riscv_reset_vcpu(struct kvm_vcpu *vcpu)
 	struct kvm_cpu_context *reset_cntx = &vcpu->arch.guest_reset_context;
 	bool loaded;
 
+	/* Waits for the workers, so do it before disabling preemption. */
+	kvm_clear_async_pf_completion_queue(vcpu);
+
 	/**
 	 * The preemption should be disabled here because it races with
 	 * kvm_sched_out/kvm_sched_in(called from preempt notifiers) which
@@ -61,6 +88,7 @@ static void kvm_riscv_reset_vcpu(struct kvm_vcpu *vcpu)
 		kvm_arch_vcpu_put(vcpu);
 
 	vcpu->arch.last_exit_cpu = -1;
+	vcpu->arch.csr_cpu = -1;
 
 	memcpy(csr, reset_csr, sizeof(*csr));
 
@@ -85,6 +113,8 @@ static void kvm_riscv_reset_vcpu(struct kvm_vcpu *vcpu)
 
 	kvm_riscv_vcpu_sbi_sta_reset(vcpu);
 
+	kvm_riscv_vcpu_sbi_apf_reset(vcpu);
+
 	/* Reset the guest CSRs for hotplug usecase */
 	if (loaded)
 		kvm_arch_vcpu_load(vcpu, smp_processor_id());
@@ -168,6 +198,8 @@ void kvm_arch_vcpu_postcreate(struct kvm_vcpu *vcpu)
 
 void kvm_arch_vcpu_destroy(struct kvm_vcpu *vcpu)
 {
+	kvm_clear_async_pf_completion_queue(vcpu);
+
 	/* Cleanup VCPU AIA context */
 	kvm_riscv_vcpu_aia_deinit(vcpu);
 
@@ -200,7 +232,9 @@ void kvm_arch_vcpu_unblocking(struct kvm_vcpu *vcpu)
 
 int kvm_arch_vcpu_runnable(struct kvm_vcpu *vcpu)
 {
-	return (kvm_riscv_vcpu_has_interrupts(vcpu, -1UL) &&
+	return ((kvm_riscv_vcpu_has_interrupts(vcpu, -1UL) ||
+		 READ_ONCE(vcpu->arch.pvlock_kicked) ||
+		 kvm_test_request(KVM_REQ_APF_READY, vcpu)) &&
 		!vcpu->arch.power_off && !vcpu->arch.pause);
 }
 
@@ -256,10 +290,12 @@ long kvm_arch_vcpu_ioctl(struct file *filp,
 		if (copy_from_user(&reg, argp, sizeof(reg)))
 			break;
 
-		if (ioctl == KVM_SET_ONE_REG)
+		if (ioctl == KVM_SET_ONE_REG) {
 			r = kvm_riscv_vcpu_set_reg(vcpu, &reg);
-		else
+			vcpu->arch.csr_cpu = -1;
+		} else {
 			r = kvm_riscv_vcpu_get_reg(vcpu, &reg);
+		}
 		break;
 	}
 	case KVM_GET_REG_LIST: {
@@ -496,6 +532,11 @@ static void kvm_riscv_vcpu_setup_config(struct kvm_vcpu *vcpu)
 	if (riscv_isa_extension_available(isa, ZICBOZ))
 		cfg->henvcfg |= ENVCFG_CBZE;
 
+	/* With both, the guest starts with A/D faults as on a host. */
+	if (riscv_isa_extension_available(isa, SVADU) &&
+	    !riscv_isa_extension_available(isa, SVADE))
+		cfg->henvcfg |= ENVCFG_ADUE;
+
 	if (riscv_has_extension_unlikely(RISCV_ISA_EXT_SMSTATEEN)) {
 		cfg->hstateen0 |= SMSTATEEN0_HSENVCFG;
 		if (riscv_isa_extension_available(isa, SSAIA))
@@ -505,6 +546,17 @@ static void kvm_riscv_vcpu_setup_config(struct kvm_vcpu *vcpu)
 		if (riscv_isa_extension_available(isa, SMSTATEEN))
 			cfg->hstateen0 |= SMSTATEEN0_SSTATEEN0;
 	}
+
+	vcpu->arch.csr_cpu = -1;
+}
+
+/*
+ * Called with the VS CSRs about to be clobbered outside of VCPU context,
+ * e.g. when virtualization is disabled on this CPU.
+ */
+void kvm_riscv_vcpu_forget_former(void)
+{
+	__this_cpu_write(kvm_former_vcpu, NULL);
 }
 
 void kvm_arch_vcpu_load(struct kvm_vcpu *vcpu, int cpu)
@@ -512,6 +564,15 @@ void kvm_arch_vcpu_load(struct kvm_vcpu *vcpu, int cpu)
 	struct kvm_vcpu_csr *csr = &vcpu->arch.guest_csr;
 	struct kvm_vcpu_config *cfg = &vcpu->arch.cfg;
 
+	/*
+	 * Nothing else ran on the VS CSRs since this VCPU was put here,
+	 * and none of their saved values changed. Only the state that is
+	 * switched lazily or depends on the VM needs loading.
+	 */
+	if (vcpu->arch.csr_cpu == cpu &&
+	    __this_cpu_read(kvm_former_vcpu) == vcpu)
+		goto skip_csr_load;
+
 	csr_write(CSR_VSSTATUS, csr->vsstatus);
 	csr_write(CSR_VSIE, csr->vsie);
 	csr_write(CSR_VSTVEC, csr->vstvec);
@@ -530,16 +591,13 @@ void kvm_arch_vcpu_load(struct kvm_vcpu *vcpu, int cpu)
 			csr_write(CSR_HSTATEEN0H, cfg->hstateen0 >> 32);
 	}
 
+skip_csr_load:
 	kvm_riscv_gstage_update_hgatp(vcpu);
 
 	kvm_riscv_vcpu_timer_restore(vcpu);
 
-	kvm_riscv_vcpu_host_fp_save(&vcpu->arch.host_context);
-	kvm_riscv_vcpu_guest_fp_restore(&vcpu->arch.guest_context,
-					vcpu->arch.isa);
-	kvm_riscv_vcpu_host_vector_save(&vcpu->arch.host_context);
-	kvm_riscv_vcpu_guest_vector_restore(&vcpu->arch.guest_context,
-					    vcpu->arch.isa);
+	kvm_riscv_vcpu_fp_load(vcpu);
+	kvm_riscv_vcpu_vector_load(vcpu);
 
 	kvm_riscv_vcpu_aia_load(vcpu, cpu);
 
@@ -551,19 +609,22 @@ void kvm_arch_vcpu_load(struct kvm_vcpu *vcpu, int cpu)
 void kvm_arch_vcpu_put(struct kvm_vcpu *vcpu)
 {
 	struct kvm_vcpu_csr *csr = &vcpu->arch.guest_csr;
+	int idx;
+
+	if (vcpu->preempted) {
+		idx = srcu_read_lock(&vcpu->kvm->srcu);
+		kvm_riscv_vcpu_set_preempted(vcpu);
+		srcu_read_unlock(&vcpu->kvm->srcu, idx);
+	}
 
 	vcpu->cpu = -1;
 
 	kvm_riscv_vcpu_aia_put(vcpu);
 
-	kvm_riscv_vcpu_guest_fp_save(&vcpu->arch.guest_context,
-				     vcpu->arch.isa);
-	kvm_riscv_vcpu_host_fp_restore(&vcpu->arch.host_context);
+	kvm_riscv_vcpu_fp_put(vcpu);
 
 	kvm_riscv_vcpu_timer_save(vcpu);
-	kvm_riscv_vcpu_guest_vector_save(&vcpu->arch.guest_context,
-					 vcpu->arch.isa);
-	kvm_riscv_vcpu_host_vector_restore(&vcpu->arch.host_context);
+	kvm_riscv_vcpu_vector_put(vcpu);
 
 	csr->vsstatus = csr_read(CSR_VSSTATUS);
 	csr->vsie = csr_read(CSR_VSIE);
@@ -574,9 +635,16 @@ void kvm_arch_vcpu_put(struct kvm_vcpu *vcpu)
 	csr->vstval = csr_read(CSR_VSTVAL);
 	csr->hvip = csr_read(CSR_HVIP);
 	csr->vsatp = csr_read(CSR_VSATP);
+
+	vcpu->arch.csr_cpu = smp_processor_id();
+	__this_cpu_write(kvm_former_vcpu, vcpu);
 }
 
-static void kvm_riscv_check_vcpu_requests(struct kvm_vcpu *vcpu)
+/*
+ * Returns 1 if the vcpu can enter the guest, 0 if it has to exit to
+ * userspace first.
+ */
+static int kvm_riscv_check_vcpu_requests(struct kvm_vcpu *vcpu)
 {
 	struct rcuwait *wait = kvm_arch_vcpu_get_wait(vcpu);
 
@@ -621,7 +689,15 @@ static void kvm_riscv_check_vcpu_requests(struct kvm_vcpu *vcpu)
 
 		if (kvm_check_request(KVM_REQ_STEAL_UPDATE, vcpu))
 			kvm_riscv_vcpu_record_steal_time(vcpu);
+
+		if (kvm_check_request(KVM_REQ_APF_READY, vcpu))
+			kvm_check_async_pf_completion(vcpu);
+
+		if (kvm_dirty_ring_check_request(vcpu))
+			return 0;
 	}
+
+	return 1;
 }
 
 static void kvm_riscv_update_hvip(struct kvm_vcpu *vcpu)
@@ -689,6 +765,16 @@ int kvm_arch_vcpu_ioctl_run(struct kvm_vcpu *vcpu)
 
 	kvm_vcpu_srcu_read_lock(vcpu);
 
+	if ((run->kvm_valid_regs & ~KVM_SYNC_RISCV_VALID_FIELDS) ||
+	    (run->kvm_dirty_regs & ~KVM_SYNC_RISCV_VALID_FIELDS)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* Before the exit completions, which may write a GPR or sepc. */
+	if (run->kvm_dirty_regs)
+		kvm_riscv_vcpu_sync_regs(vcpu);
+
 	switch (run->exit_reason) {
 	case KVM_EXIT_MMIO:
 		/* Process MMIO value returned from user-space */
@@ -706,14 +792,12 @@ int kvm_arch_vcpu_ioctl_run(struct kvm_vcpu *vcpu)
 		ret = 0;
 		break;
 	}
-	if (ret) {
-		kvm_vcpu_srcu_read_unlock(vcpu);
-		return ret;
-	}
+	if (ret)
+		goto out;
 
 	if (run->immediate_exit) {
-		kvm_vcpu_srcu_read_unlock(vcpu);
-		return -EINTR;
+		ret = -EINTR;
+		goto out;
 	}
 
 	vcpu_load(vcpu);
@@ -731,7 +815,9 @@ int kvm_arch_vcpu_ioctl_run(struct kvm_vcpu *vcpu)
 
 		kvm_riscv_gstage_vmid_update(vcpu);
 
-		kvm_riscv_check_vcpu_requests(vcpu);
+		ret = kvm_riscv_check_vcpu_requests(vcpu);
+		if (ret <= 0)
+			continue;
 
 		preempt_disable();
 
@@ -831,6 +917,10 @@ int kvm_arch_vcpu_ioctl_run(struct kvm_vcpu *vcpu)
 
 	vcpu_put(vcpu);
 
+out:
+	if (run->kvm_valid_regs)
+		kvm_riscv_vcpu_store_regs(vcpu);
+
 	kvm_vcpu_srcu_read_unlock(vcpu);
 
 	return ret;
@@ -9,6 +9,7 @@
 #include <linux/kvm_host.h>
 #include <asm/csr.h>
 #include <asm/insn-def.h>
+#include <asm/kvm_vcpu_vector.h>
 
 static int gstage_page_fault(struct kvm_vcpu *vcpu, struct kvm_run *run,
 			     struct kvm_cpu_trap *trap)
@@ -19,9 +20,36 @@ static int gstage_page_fault(struct kvm_vcpu *vcpu, struct kvm_run *run,
 	gfn_t gfn;
 	int ret;
 
+	switch (trap->scause) {
+	case EXC_LOAD_GUEST_PAGE_FAULT:
+		vcpu->stat.gstage_fault_load++;
+		break;
+	case EXC_STORE_GUEST_PAGE_FAULT:
+		vcpu->stat.gstage_fault_store++;
+		break;
+	default:
+		vcpu->stat.gstage_fault_exec++;
+		break;
+	}
+
 	fault_addr = (trap->htval << 2) | (trap->stval & 0x3);
 	gfn = fault_addr >> PAGE_SHIFT;
 	memslot = gfn_to_memslot(vcpu->kvm, gfn);
+
+	/* Private memory only lives in the guest_memfd, never in the hva. */
+	if (kvm_slot_can_be_private(memslot) &&
+	    kvm_mem_is_private(vcpu->kvm, gfn)) {
+		bool is_write = trap->scause == EXC_STORE_GUEST_PAGE_FAULT;
+		bool is_exec = trap->scause == EXC_INST_GUEST_PAGE_FAULT;
+
+		ret = kvm_riscv_gstage_gmem_map(vcpu, memslot, fault_addr,
+						is_write, is_exec);
+		if (ret < 0)
+			return ret;
+
+		return 1;
+	}
+
 	hva = gfn_to_hva_memslot_prot(memslot, gfn, &writable);
 
 	if (kvm_is_error_hva(hva) ||
@@ -41,7 +69,8 @@ static int gstage_page_fault(struct kvm_vcpu *vcpu, struct kvm_run *run,
 	}
 
 	ret = kvm_riscv_gstage_map(vcpu, memslot, fault_addr, hva,
-		(trap->scause == EXC_STORE_GUEST_PAGE_FAULT) ? true : false);
+		(trap->scause == EXC_STORE_GUEST_PAGE_FAULT) ? true : false,
+		trap);
 	if (ret < 0)
 		return ret;
 
@@ -165,6 +194,55 @@ void kvm_riscv_vcpu_trap_redirect(struct kvm_vcpu *vcpu,
 	vcpu->arch.guest_context.sstatus |= SR_SPP;
 }
 
+/* Whether @insn, if known, is a vector instruction or CSR access. */
+static bool insn_is_vector(unsigned long insn)
+{
+	unsigned long csr;
+
+	switch (insn & 0x7f) {
+	case 0x57:	/* OP-V */
+		return true;
+	case 0x07:	/* LOAD-FP */
+	case 0x27:	/* STORE-FP */
+		/* Widths other than the scalar H/W/D/Q ones are vector. */
+		switch ((insn >> 12) & 0x7) {
+		case 1: case 2: case 3: case 4:
+			return false;
+		default:
+			return true;
+		}
+	case 0x73:	/* SYSTEM */
+		csr = insn >> 20;
+		return (csr >= CSR_VSTART && csr <= CSR_VCSR) ||
+		       (csr >= CSR_VL && csr <= CSR_VLENB);
+	default:
+		return false;
+	}
+}
+
+/*
+ * The guest FP and vector registers are loaded on first use, so an illegal
+ * instruction trap may come from a guest FP or vector instruction while its
+ * state is not loaded. Load the state the instruction most likely needs and
+ * retry it; an instruction needing both traps once more. Only when there is
+ * nothing left to load was the instruction really illegal for the guest.
+ */
+static bool kvm_riscv_vcpu_fp_vector_trap(struct kvm_vcpu *vcpu,
+					  struct kvm_cpu_trap *trap)
+{
+	bool ret;
+
+	/* vcpu_put()/vcpu_load() from preempt notifiers must not interleave. */
+	preempt_disable();
+	if (insn_is_vector(trap->stval))
+		ret = kvm_riscv_vcpu_vector_trap(vcpu) || kvm_riscv_vcpu_fp_trap(vcpu);
+	else
+		ret = kvm_riscv_vcpu_fp_trap(vcpu) || kvm_riscv_vcpu_vector_trap(vcpu);
+	preempt_enable();
+
+	return ret;
+}
+
 /*
  * Return > 0 to return to guest, < 0 on error, 0 (and set exit_reason) on
  * proper exit to userspace.
@@ -183,6 +261,12 @@ int kvm_riscv_vcpu_exit(struct kvm_vcpu *vcpu, struct kvm_run *run,
 	run->exit_reason = KVM_EXIT_UNKNOWN;
 	switch (trap->scause) {
 	case EXC_INST_ILLEGAL:
+		if ((vcpu->arch.guest_context.hstatus & HSTATUS_SPV) &&
+		    kvm_riscv_vcpu_fp_vector_trap(vcpu, trap)) {
+			ret = 1;
+			break;
+		}
+		fallthrough;
 	case EXC_LOAD_MISALIGNED:
 	case EXC_STORE_MISALIGNED:
 		if (vcpu->arch.guest_context.hstatus & HSTATUS_SPV) {
@@ -208,8 +292,8 @@ int kvm_riscv_vcpu_exit(struct kvm_vcpu *vcpu, struct kvm_run *run,
 		break;
 	}
 
-	/* Print details in-case of error */
-	if (ret < 0) {
+	/* Print details in-case of error, userspace handles memory faults */
+	if (ret < 0 && run->exit_reason != KVM_EXIT_MEMORY_FAULT) {
 		kvm_err("VCPU exit error %d\n", ret);
 		kvm_err("SEPC=0x%lx SSTATUS=0x%lx HSTATUS=0x%lx\n",
 			vcpu->arch.guest_context.sepc,
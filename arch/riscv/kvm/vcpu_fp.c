@@ -72,6 +72,49 @@ void kvm_riscv_vcpu_host_fp_restore(struct kvm_cpu_context *cntx)
 	else if (riscv_isa_extension_available(NULL, f))
 		__kvm_riscv_fp_f_restore(cntx);
 }
+
+/*
+ * Defer the FP switch to the guest's first FP instruction: with sstatus.FS
+ * Off, it traps with an illegal instruction exception instead.
+ */
+void kvm_riscv_vcpu_fp_load(struct kvm_vcpu *vcpu)
+{
+	struct kvm_cpu_context *cntx = &vcpu->arch.guest_context;
+
+	vcpu->arch.guest_fs = cntx->sstatus & SR_FS;
+	vcpu->arch.guest_fp_loaded = false;
+	cntx->sstatus &= ~SR_FS;
+}
+
+void kvm_riscv_vcpu_fp_put(struct kvm_vcpu *vcpu)
+{
+	struct kvm_cpu_context *cntx = &vcpu->arch.guest_context;
+
+	if (!vcpu->arch.guest_fp_loaded) {
+		cntx->sstatus |= vcpu->arch.guest_fs;
+		return;
+	}
+
+	kvm_riscv_vcpu_guest_fp_save(cntx, vcpu->arch.isa);
+	kvm_riscv_vcpu_host_fp_restore(&vcpu->arch.host_context);
+	vcpu->arch.guest_fp_loaded = false;
+}
+
+/* Returns true if the guest FP state was loaded, and the trap is handled. */
+bool kvm_riscv_vcpu_fp_trap(struct kvm_vcpu *vcpu)
+{
+	struct kvm_cpu_context *cntx = &vcpu->arch.guest_context;
+
+	if (vcpu->arch.guest_fp_loaded || vcpu->arch.guest_fs == SR_FS_OFF)
+		return false;
+
+	kvm_riscv_vcpu_host_fp_save(&vcpu->arch.host_context);
+	cntx->sstatus |= vcpu->arch.guest_fs;
+	kvm_riscv_vcpu_guest_fp_restore(cntx, vcpu->arch.isa);
+	vcpu->arch.guest_fp_loaded = true;
+
+	return true;
+}
 #endif
 
 int kvm_riscv_vcpu_get_reg_fp(struct kvm_vcpu *vcpu,
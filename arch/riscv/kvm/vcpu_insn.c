@@ -189,11 +189,19 @@ static int truly_virtual_insn(struct kvm_vcpu *vcpu, struct kvm_run *run,
  */
 void kvm_riscv_vcpu_wfi(struct kvm_vcpu *vcpu)
 {
+	ktime_t start;
+
 	if (!kvm_arch_vcpu_runnable(vcpu)) {
+		start = ktime_get();
 		kvm_vcpu_srcu_read_unlock(vcpu);
 		kvm_vcpu_halt(vcpu);
 		kvm_vcpu_srcu_read_lock(vcpu);
+		KVM_STATS_LOG_HIST_UPDATE(vcpu->stat.wfi_wakeup_hist,
+				ktime_to_ns(ktime_sub(ktime_get(), start)));
 	}
+
+	/* A pending PVLOCK kick is consumed by the WFI it ends */
+	WRITE_ONCE(vcpu->arch.pvlock_kicked, false);
 }
 
 static int wfi_insn(struct kvm_vcpu *vcpu, struct kvm_run *run, ulong insn)
@@ -451,6 +459,40 @@ int kvm_riscv_vcpu_virtual_insn(struct kvm_vcpu *vcpu, struct kvm_run *run,
 	}
 }
 
+static int mmio_get_insn(struct kvm_vcpu *vcpu, unsigned long fault_addr,
+			 unsigned long htinst, unsigned long *insn,
+			 int *insn_len)
+{
+	struct kvm_cpu_context *ct = &vcpu->arch.guest_context;
+	struct kvm_cpu_trap utrap = { 0 };
+
+	if (htinst & 0x1) {
+		/*
+		 * Bit[0] == 1 implies trapped instruction value is
+		 * transformed instruction or custom instruction.
+		 */
+		*insn = htinst | INSN_16BIT_MASK;
+		*insn_len = (htinst & BIT(1)) ? INSN_LEN(*insn) : 2;
+		return 0;
+	}
+
+	/*
+	 * Bit[0] == 0 implies trapped instruction value is
+	 * zero or special value.
+	 */
+	vcpu->stat.mmio_insn_fetch++;
+	*insn = kvm_riscv_vcpu_unpriv_read(vcpu, true, ct->sepc, &utrap);
+	if (utrap.scause) {
+		/* Redirect trap if we failed to read instruction */
+		utrap.sepc = ct->sepc;
+		kvm_riscv_vcpu_trap_redirect(vcpu, &utrap);
+		return 1;
+	}
+	*insn_len = INSN_LEN(*insn);
+
+	return 0;
+}
+
 /**
  * kvm_riscv_vcpu_mmio_load -- Emulate MMIO load instruction
  *
@@ -470,32 +512,10 @@ int kvm_riscv_vcpu_mmio_load(struct kvm_vcpu *vcpu, struct kvm_run *run,
 	u8 data_buf[8];
 	unsigned long insn;
 	int shift = 0, len = 0, insn_len = 0;
-	struct kvm_cpu_trap utrap = { 0 };
-	struct kvm_cpu_context *ct = &vcpu->arch.guest_context;
 
 	/* Determine trapped instruction */
-	if (htinst & 0x1) {
-		/*
-		 * Bit[0] == 1 implies trapped instruction value is
-		 * transformed instruction or custom instruction.
-		 */
-		insn = htinst | INSN_16BIT_MASK;
-		insn_len = (htinst & BIT(1)) ? INSN_LEN(insn) : 2;
-	} else {
-		/*
-		 * Bit[0] == 0 implies trapped instruction value is
-		 * zero or special value.
-		 */
-		insn = kvm_riscv_vcpu_unpriv_read(vcpu, true, ct->sepc,
-						  &utrap);
-		if (utrap.scause) {
-			/* Redirect trap if we failed to read instruction */
-			utrap.sepc = ct->sepc;
-			kvm_riscv_vcpu_trap_redirect(vcpu, &utrap);
-			return 1;
-		}
-		insn_len = INSN_LEN(insn);
-	}
+	if (mmio_get_insn(vcpu, fault_addr, htinst, &insn, &insn_len))
+		return 1;
 
 	/* Decode length of MMIO and shift */
 	if ((insn & INSN_MASK_LW) == INSN_MATCH_LW) {
@@ -596,32 +616,10 @@ int kvm_riscv_vcpu_mmio_store(struct kvm_vcpu *vcpu, struct kvm_run *run,
 	ulong data;
 	unsigned long insn;
 	int len = 0, insn_len = 0;
-	struct kvm_cpu_trap utrap = { 0 };
-	struct kvm_cpu_context *ct = &vcpu->arch.guest_context;
 
 	/* Determine trapped instruction */
-	if (htinst & 0x1) {
-		/*
-		 * Bit[0] == 1 implies trapped instruction value is
-		 * transformed instruction or custom instruction.
-		 */
-		insn = htinst | INSN_16BIT_MASK;
-		insn_len = (htinst & BIT(1)) ? INSN_LEN(insn) : 2;
-	} else {
-		/*
-		 * Bit[0] == 0 implies trapped instruction value is
-		 * zero or special value.
-		 */
-		insn = kvm_riscv_vcpu_unpriv_read(vcpu, true, ct->sepc,
-						  &utrap);
-		if (utrap.scause) {
-			/* Redirect trap if we failed to read instruction */
-			utrap.sepc = ct->sepc;
-			kvm_riscv_vcpu_trap_redirect(vcpu, &utrap);
-			return 1;
-		}
-		insn_len = INSN_LEN(insn);
-	}
+	if (mmio_get_insn(vcpu, fault_addr, htinst, &insn, &insn_len))
+		return 1;
 
 	data = GET_RS2(insn, &vcpu->arch.guest_context);
 	data8 = data16 = data32 = data64 = data;
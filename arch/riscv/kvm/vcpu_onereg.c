@@ -37,6 +37,8 @@ static const unsigned long kvm_isa_ext_arr[] = {
 	KVM_ISA_EXT_ARR(SMSTATEEN),
 	KVM_ISA_EXT_ARR(SSAIA),
 	KVM_ISA_EXT_ARR(SSTC),
+	KVM_ISA_EXT_ARR(SVADE),
+	KVM_ISA_EXT_ARR(SVADU),
 	KVM_ISA_EXT_ARR(SVINVAL),
 	KVM_ISA_EXT_ARR(SVNAPOT),
 	KVM_ISA_EXT_ARR(SVPBMT),
@@ -80,6 +82,8 @@ static const unsigned long kvm_isa_ext_arr[] = {
 	KVM_ISA_EXT_ARR(ZVKSED),
 	KVM_ISA_EXT_ARR(ZVKSH),
 	KVM_ISA_EXT_ARR(ZVKT),
+	/* Known to userspace, but not supported for guests yet */
+	[KVM_RISCV_ISA_EXT_SSCOFPMF ... KVM_RISCV_ISA_EXT_SSNPM] = RISCV_ISA_EXT_INVALID,
 };
 
 static unsigned long kvm_riscv_vcpu_base2isa_ext(unsigned long base_ext)
@@ -101,6 +105,12 @@ static bool kvm_riscv_vcpu_isa_enable_allowed(unsigned long ext)
 		return false;
 	case KVM_RISCV_ISA_EXT_V:
 		return riscv_v_vstate_ctrl_user_allowed();
+	case KVM_RISCV_ISA_EXT_SVADU:
+		/*
+		 * henvcfg.ADUE is read-only zero unless the host has hardware
+		 * A/D updating enabled in menvcfg.ADUE.
+		 */
+		return arch_has_hw_pte_young();
 	default:
 		break;
 	}
@@ -161,6 +171,12 @@ static bool kvm_riscv_vcpu_isa_disable_allowed(unsigned long ext)
 	/* Extensions which can be disabled using Smstateen */
 	case KVM_RISCV_ISA_EXT_SSAIA:
 		return riscv_has_extension_unlikely(RISCV_ISA_EXT_SMSTATEEN);
+	case KVM_RISCV_ISA_EXT_SVADE:
+		/*
+		 * Svade can only be hidden from the guest by turning hardware
+		 * A/D updating on for it, which needs the host to have it.
+		 */
+		return arch_has_hw_pte_young();
 	default:
 		break;
 	}
@@ -1043,6 +1059,25 @@ static int copy_sbi_reg_indices(struct kvm_vcpu *vcpu, u64 __user *uindices)
 		total += n;
 	}
 
+	if (scontext->ext_status[KVM_RISCV_SBI_EXT_APF] == KVM_RISCV_SBI_EXT_STATUS_ENABLED) {
+		u64 size = IS_ENABLED(CONFIG_32BIT) ? KVM_REG_SIZE_U32 : KVM_REG_SIZE_U64;
+		int n = sizeof(struct kvm_riscv_sbi_apf) / sizeof(unsigned long);
+
+		for (int i = 0; i < n; i++) {
+			u64 reg = KVM_REG_RISCV | size |
+				  KVM_REG_RISCV_SBI_STATE |
+				  KVM_REG_RISCV_SBI_APF | i;
+
+			if (uindices) {
+				if (put_user(reg, uindices))
+					return -EFAULT;
+				uindices++;
+			}
+		}
+
+		total += n;
+	}
+
 	return total;
 }
 
@@ -1249,3 +1284,66 @@ int kvm_riscv_vcpu_get_reg(struct kvm_vcpu *vcpu,
 
 	return -ENOENT;
 }
+
+/*
+ * KVM_CAP_SYNC_REGS: KVM_RUN moves whole register sets through kvm_run,
+ * saving an ioctl per register on snapshot and migration. Called while
+ * the VCPU is not loaded, so the guest state is in memory.
+ */
+void kvm_riscv_vcpu_sync_regs(struct kvm_vcpu *vcpu)
+{
+	struct kvm_cpu_context *cntx = &vcpu->arch.guest_context;
+	struct kvm_sync_regs *regs = &vcpu->run->s.regs;
+	u64 dirty = vcpu->run->kvm_dirty_regs;
+	unsigned long i;
+
+	if (dirty & KVM_SYNC_RISCV_CORE) {
+		/* Only pc and mode differ from the kvm_cpu_context layout. */
+		memcpy(&cntx->ra, &regs->core.regs.ra,
+		       sizeof(regs->core.regs) - sizeof(regs->core.regs.pc));
+		cntx->sepc = regs->core.regs.pc;
+		if (regs->core.mode == KVM_RISCV_MODE_S)
+			cntx->sstatus |= SR_SPP;
+		else
+			cntx->sstatus &= ~SR_SPP;
+	}
+
+	if (dirty & KVM_SYNC_RISCV_CSR) {
+		for (i = 0; i < sizeof(regs->csr) / sizeof(unsigned long); i++)
+			kvm_riscv_vcpu_general_set_csr(vcpu, i,
+					((unsigned long *)&regs->csr)[i]);
+		vcpu->arch.csr_cpu = -1;
+	}
+
+	if (dirty & KVM_SYNC_RISCV_FP)
+		memcpy(&cntx->fp, &regs->fp, sizeof(regs->fp));
+
+	vcpu->run->kvm_dirty_regs = 0;
+}
+
+void kvm_riscv_vcpu_store_regs(struct kvm_vcpu *vcpu)
+{
+	struct kvm_cpu_context *cntx = &vcpu->arch.guest_context;
+	struct kvm_sync_regs *regs = &vcpu->run->s.regs;
+	u64 valid = vcpu->run->kvm_valid_regs;
+	unsigned long i;
+
+	BUILD_BUG_ON(sizeof(struct kvm_sync_regs) > SYNC_REGS_SIZE_BYTES);
+
+	if (valid & KVM_SYNC_RISCV_CORE) {
+		memcpy(&regs->core.regs.ra, &cntx->ra,
+		       sizeof(regs->core.regs) - sizeof(regs->core.regs.pc));
+		regs->core.regs.pc = cntx->sepc;
+		regs->core.mode = (cntx->sstatus & SR_SPP) ?
+				  KVM_RISCV_MODE_S : KVM_RISCV_MODE_U;
+	}
+
+	if (valid & KVM_SYNC_RISCV_CSR) {
+		for (i = 0; i < sizeof(regs->csr) / sizeof(unsigned long); i++)
+			kvm_riscv_vcpu_general_get_csr(vcpu, i,
+					&((unsigned long *)&regs->csr)[i]);
+	}
+
+	if (valid & KVM_SYNC_RISCV_FP)
+		memcpy(&regs->fp, &cntx->fp, sizeof(regs->fp));
+}
@@ -74,6 +74,14 @@ static const struct kvm_riscv_sbi_extension_entry sbi_ext[] = {
 		.ext_idx = KVM_RISCV_SBI_EXT_STA,
 		.ext_ptr = &vcpu_sbi_ext_sta,
 	},
+	{
+		.ext_idx = KVM_RISCV_SBI_EXT_PVLOCK,
+		.ext_ptr = &vcpu_sbi_ext_pvlock,
+	},
+	{
+		.ext_idx = KVM_RISCV_SBI_EXT_APF,
+		.ext_ptr = &vcpu_sbi_ext_apf,
+	},
 	{
 		.ext_idx = KVM_RISCV_SBI_EXT_EXPERIMENTAL,
 		.ext_ptr = &vcpu_sbi_ext_experimental,
@@ -347,6 +355,8 @@ int kvm_riscv_vcpu_set_reg_sbi(struct kvm_vcpu *vcpu,
 	switch (reg_subtype) {
 	case KVM_REG_RISCV_SBI_STA:
 		return kvm_riscv_vcpu_set_reg_sbi_sta(vcpu, reg_num, reg_val);
+	case KVM_REG_RISCV_SBI_APF:
+		return kvm_riscv_vcpu_set_reg_sbi_apf(vcpu, reg_num, reg_val);
 	default:
 		return -EINVAL;
 	}
@@ -375,6 +385,9 @@ int kvm_riscv_vcpu_get_reg_sbi(struct kvm_vcpu *vcpu,
 	case KVM_REG_RISCV_SBI_STA:
 		ret = kvm_riscv_vcpu_get_reg_sbi_sta(vcpu, reg_num, &reg_val);
 		break;
+	case KVM_REG_RISCV_SBI_APF:
+		ret = kvm_riscv_vcpu_get_reg_sbi_apf(vcpu, reg_num, &reg_val);
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -388,8 +401,8 @@ int kvm_riscv_vcpu_get_reg_sbi(struct kvm_vcpu *vcpu,
 	return 0;
 }
 
-const struct kvm_vcpu_sbi_extension *kvm_vcpu_sbi_find_ext(
-				struct kvm_vcpu *vcpu, unsigned long extid)
+static const struct kvm_riscv_sbi_extension_entry *
+kvm_vcpu_sbi_find_entry(struct kvm_vcpu *vcpu, unsigned long extid)
 {
 	struct kvm_vcpu_sbi_context *scontext = &vcpu->arch.sbi_context;
 	const struct kvm_riscv_sbi_extension_entry *entry;
@@ -404,7 +417,7 @@ const struct kvm_vcpu_sbi_extension *kvm_vcpu_sbi_find_ext(
 			if (entry->ext_idx >= KVM_RISCV_SBI_EXT_MAX ||
 			    scontext->ext_status[entry->ext_idx] ==
 						KVM_RISCV_SBI_EXT_STATUS_ENABLED)
-				return ext;
+				return entry;
 
 			return NULL;
 		}
@@ -413,12 +426,23 @@ const struct kvm_vcpu_sbi_extension *kvm_vcpu_sbi_find_ext(
 	return NULL;
 }
 
+const struct kvm_vcpu_sbi_extension *kvm_vcpu_sbi_find_ext(
+				struct kvm_vcpu *vcpu, unsigned long extid)
+{
+	const struct kvm_riscv_sbi_extension_entry *entry;
+
+	entry = kvm_vcpu_sbi_find_entry(vcpu, extid);
+
+	return entry ? entry->ext_ptr : NULL;
+}
+
 int kvm_riscv_vcpu_sbi_ecall(struct kvm_vcpu *vcpu, struct kvm_run *run)
 {
 	int ret = 1;
 	bool next_sepc = true;
 	struct kvm_cpu_context *cp = &vcpu->arch.guest_context;
-	const struct kvm_vcpu_sbi_extension *sbi_ext;
+	const struct kvm_riscv_sbi_extension_entry *entry;
+	const struct kvm_vcpu_sbi_extension *sbi_ext = NULL;
 	struct kvm_cpu_trap utrap = {0};
 	struct kvm_vcpu_sbi_return sbi_ret = {
 		.out_val = 0,
@@ -427,8 +451,12 @@ int kvm_riscv_vcpu_sbi_ecall(struct kvm_vcpu *vcpu, struct kvm_run *run)
 	};
 	bool ext_is_v01 = false;
 
-	sbi_ext = kvm_vcpu_sbi_find_ext(vcpu, cp->a7);
+	entry = kvm_vcpu_sbi_find_entry(vcpu, cp->a7);
+	if (entry)
+		sbi_ext = entry->ext_ptr;
 	if (sbi_ext && sbi_ext->handler) {
+		KVM_STATS_LINEAR_HIST_UPDATE(vcpu->stat.sbi_ext_hist,
+					     entry->ext_idx, 1);
 #ifdef CONFIG_RISCV_SBI_V01
 		if (cp->a7 >= SBI_EXT_0_1_SET_TIMER &&
 		    cp->a7 <= SBI_EXT_0_1_SHUTDOWN)
@@ -437,6 +465,7 @@ int kvm_riscv_vcpu_sbi_ecall(struct kvm_vcpu *vcpu, struct kvm_run *run)
 		ret = sbi_ext->handler(vcpu, run, &sbi_ret);
 	} else {
 		/* Return error for unsupported SBI calls */
+		vcpu->stat.sbi_unsupported++;
 		cp->a0 = SBI_ERR_NOT_SUPPORTED;
 		goto ecall_done;
 	}
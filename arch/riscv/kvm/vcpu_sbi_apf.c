@@ -0,0 +1,286 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * SBI APF extension: lets a guest run another task while KVM brings in a
+ * page that has to be read back from swap or fetched by userfaultfd.
+ *
+ * When such a page faults in the G-stage while the guest is in user mode,
+ * the fault is redirected to the guest as a regular page fault, with
+ * SBI_APF_PAGE_NOT_PRESENT and a token set in the shared memory. The guest
+ * puts the faulting task to sleep on the token. Once the page is in, its
+ * token is written to ready_token and a VS-level software interrupt is
+ * raised; the guest wakes the task up and acknowledges with
+ * SBI_EXT_APF_READY_ACK, after which the next ready page can be reported.
+ */
+
+#include <linux/errno.h>
+#include <linux/err.h>
+#include <linux/kvm_host.h>
+#include <linux/sizes.h>
+#include <asm/csr.h>
+#include <asm/kvm_vcpu_sbi.h>
+#include <asm/sbi.h>
+
+void kvm_riscv_vcpu_sbi_apf_reset(struct kvm_vcpu *vcpu)
+{
+	vcpu->arch.apf.shmem = INVALID_GPA;
+}
+
+static int kvm_riscv_apf_write(struct kvm_vcpu *vcpu, unsigned long offset,
+			       u32 val)
+{
+	__le32 val_le = cpu_to_le32(val);
+
+	return kvm_vcpu_write_guest(vcpu, vcpu->arch.apf.shmem + offset,
+				    &val_le, sizeof(val_le));
+}
+
+bool kvm_riscv_vcpu_apf_can_inject(struct kvm_vcpu *vcpu)
+{
+	/*
+	 * Only a fault from user mode can be turned into a sleep, the guest
+	 * kernel may be in a context that can't schedule.
+	 */
+	return vcpu->arch.apf.shmem != INVALID_GPA &&
+	       !(vcpu->arch.guest_context.hstatus & HSTATUS_SPVP);
+}
+
+static u32 kvm_riscv_apf_token(struct kvm_vcpu *vcpu)
+{
+	/* Never zero, which is the empty slot, nor SBI_APF_WAKE_ALL. */
+	BUILD_BUG_ON(KVM_MAX_VCPU_IDS > SZ_4K);
+
+	if (!(vcpu->arch.apf.id << 12))
+		vcpu->arch.apf.id = 1;
+
+	return (vcpu->arch.apf.id++ << 12) | vcpu->vcpu_id;
+}
+
+bool kvm_riscv_vcpu_apf_setup(struct kvm_vcpu *vcpu, struct kvm_cpu_trap *trap,
+			      gpa_t gpa, unsigned long hva)
+{
+	struct kvm_arch_async_pf arch;
+
+	switch (trap->scause) {
+	case EXC_INST_GUEST_PAGE_FAULT:
+		arch.scause = EXC_INST_PAGE_FAULT;
+		break;
+	case EXC_LOAD_GUEST_PAGE_FAULT:
+		arch.scause = EXC_LOAD_PAGE_FAULT;
+		break;
+	case EXC_STORE_GUEST_PAGE_FAULT:
+		arch.scause = EXC_STORE_PAGE_FAULT;
+		break;
+	default:
+		return false;
+	}
+	arch.stval = trap->stval;
+	arch.token = kvm_riscv_apf_token(vcpu);
+
+	return kvm_setup_async_pf(vcpu, gpa, hva, &arch);
+}
+
+bool kvm_arch_async_page_not_present(struct kvm_vcpu *vcpu,
+				     struct kvm_async_pf *work)
+{
+	struct kvm_cpu_trap utrap = { 0 };
+
+	if (kvm_riscv_apf_write(vcpu, offsetof(struct sbi_apf_struct, token),
+				work->arch.token) ||
+	    kvm_riscv_apf_write(vcpu, offsetof(struct sbi_apf_struct, flags),
+				SBI_APF_PAGE_NOT_PRESENT)) {
+		/* Retry synchronously rather than faulting again and again. */
+		vcpu->arch.apf.shmem = INVALID_GPA;
+		return false;
+	}
+
+	utrap.sepc = vcpu->arch.guest_context.sepc;
+	utrap.scause = work->arch.scause;
+	utrap.stval = work->arch.stval;
+	kvm_riscv_vcpu_trap_redirect(vcpu, &utrap);
+
+	return true;
+}
+
+void kvm_arch_async_page_present(struct kvm_vcpu *vcpu,
+				 struct kvm_async_pf *work)
+{
+	u32 token = work->wakeup_all ? SBI_APF_WAKE_ALL : work->arch.token;
+
+	if (vcpu->arch.apf.shmem == INVALID_GPA)
+		return;
+
+	if (kvm_riscv_apf_write(vcpu,
+				offsetof(struct sbi_apf_struct, ready_token),
+				token))
+		return;
+
+	kvm_riscv_vcpu_set_interrupt(vcpu, IRQ_VS_SOFT);
+}
+
+/*
+ * The guest retries the access once woken up, which maps the page through
+ * the regular G-stage fault path.
+ */
+void kvm_arch_async_page_ready(struct kvm_vcpu *vcpu,
+			       struct kvm_async_pf *work)
+{
+}
+
+void kvm_arch_async_page_present_queued(struct kvm_vcpu *vcpu)
+{
+	kvm_make_request(KVM_REQ_APF_READY, vcpu);
+	kvm_vcpu_kick(vcpu);
+}
+
+bool kvm_arch_can_dequeue_async_page_present(struct kvm_vcpu *vcpu)
+{
+	__le32 token;
+
+	if (vcpu->arch.apf.shmem == INVALID_GPA)
+		return true;
+
+	/* The guest has not acknowledged the previous ready page yet. */
+	if (kvm_vcpu_read_guest(vcpu, vcpu->arch.apf.shmem +
+				offsetof(struct sbi_apf_struct, ready_token),
+				&token, sizeof(token)))
+		return true;
+
+	return !token;
+}
+
+static int kvm_sbi_apf_set_shmem(struct kvm_vcpu *vcpu)
+{
+	struct kvm_cpu_context *cp = &vcpu->arch.guest_context;
+	unsigned long shmem_phys_lo = cp->a0;
+	unsigned long shmem_phys_hi = cp->a1;
+	u32 flags = cp->a2;
+	struct sbi_apf_struct zero_apf = {0};
+	unsigned long hva;
+	bool writable;
+	gpa_t shmem;
+
+	if (flags != 0)
+		return SBI_ERR_INVALID_PARAM;
+
+	if (shmem_phys_lo == SBI_SHMEM_DISABLE &&
+	    shmem_phys_hi == SBI_SHMEM_DISABLE) {
+		vcpu->arch.apf.shmem = INVALID_GPA;
+		return 0;
+	}
+
+	if (shmem_phys_lo & (SZ_64 - 1))
+		return SBI_ERR_INVALID_PARAM;
+
+	shmem = shmem_phys_lo;
+
+	if (shmem_phys_hi != 0) {
+		if (IS_ENABLED(CONFIG_32BIT))
+			shmem |= ((gpa_t)shmem_phys_hi << 32);
+		else
+			return SBI_ERR_INVALID_ADDRESS;
+	}
+
+	hva = kvm_vcpu_gfn_to_hva_prot(vcpu, shmem >> PAGE_SHIFT, &writable);
+	if (kvm_is_error_hva(hva) || !writable)
+		return SBI_ERR_INVALID_ADDRESS;
+
+	if (kvm_vcpu_write_guest(vcpu, shmem, &zero_apf, sizeof(zero_apf)))
+		return SBI_ERR_FAILURE;
+
+	vcpu->arch.apf.shmem = shmem;
+
+	return 0;
+}
+
+static int kvm_sbi_ext_apf_handler(struct kvm_vcpu *vcpu, struct kvm_run *run,
+				   struct kvm_vcpu_sbi_return *retdata)
+{
+	struct kvm_cpu_context *cp = &vcpu->arch.guest_context;
+	unsigned long funcid = cp->a6;
+	int ret;
+
+	switch (funcid) {
+	case SBI_EXT_APF_SET_SHMEM:
+		ret = kvm_sbi_apf_set_shmem(vcpu);
+		break;
+	case SBI_EXT_APF_READY_ACK:
+		/* ready_token is free again, report the next ready page. */
+		if (!list_empty_careful(&vcpu->async_pf.done))
+			kvm_make_request(KVM_REQ_APF_READY, vcpu);
+		ret = SBI_SUCCESS;
+		break;
+	default:
+		ret = SBI_ERR_NOT_SUPPORTED;
+		break;
+	}
+
+	retdata->err_val = ret;
+
+	return 0;
+}
+
+const struct kvm_vcpu_sbi_extension vcpu_sbi_ext_apf = {
+	.extid_start = SBI_EXT_APF,
+	.extid_end = SBI_EXT_APF,
+	.handler = kvm_sbi_ext_apf_handler,
+};
+
+int kvm_riscv_vcpu_get_reg_sbi_apf(struct kvm_vcpu *vcpu,
+				   unsigned long reg_num,
+				   unsigned long *reg_val)
+{
+	switch (reg_num) {
+	case KVM_REG_RISCV_SBI_APF_REG(shmem_lo):
+		*reg_val = (unsigned long)vcpu->arch.apf.shmem;
+		break;
+	case KVM_REG_RISCV_SBI_APF_REG(shmem_hi):
+		if (IS_ENABLED(CONFIG_32BIT))
+			*reg_val = upper_32_bits(vcpu->arch.apf.shmem);
+		else
+			*reg_val = 0;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int kvm_riscv_vcpu_set_reg_sbi_apf(struct kvm_vcpu *vcpu,
+				   unsigned long reg_num,
+				   unsigned long reg_val)
+{
+	switch (reg_num) {
+	case KVM_REG_RISCV_SBI_APF_REG(shmem_lo):
+		if (IS_ENABLED(CONFIG_32BIT)) {
+			gpa_t hi = upper_32_bits(vcpu->arch.apf.shmem);
+
+			vcpu->arch.apf.shmem = reg_val;
+			vcpu->arch.apf.shmem |= hi << 32;
+		} else {
+			vcpu->arch.apf.shmem = reg_val;
+		}
+		break;
+	case KVM_REG_RISCV_SBI_APF_REG(shmem_hi):
+		if (IS_ENABLED(CONFIG_32BIT)) {
+			gpa_t lo = lower_32_bits(vcpu->arch.apf.shmem);
+
+			vcpu->arch.apf.shmem = ((gpa_t)reg_val << 32);
+			vcpu->arch.apf.shmem |= lo;
+		} else if (reg_val != 0) {
+			return -EINVAL;
+		}
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/*
+	 * Tasks the guest put to sleep on the source of a migration would
+	 * wait for tokens this VCPU never handed out.
+	 */
+	if (vcpu->arch.apf.shmem != INVALID_GPA)
+		kvm_async_pf_wakeup_all(vcpu);
+
+	return 0;
+}
@@ -9,6 +9,7 @@
 #include <linux/errno.h>
 #include <linux/err.h>
 #include <linux/kvm_host.h>
+#include <linux/overflow.h>
 #include <asm/sbi.h>
 #include <asm/kvm_vcpu_timer.h>
 #include <asm/kvm_vcpu_pmu.h>
@@ -80,6 +81,26 @@ const struct kvm_vcpu_sbi_extension vcpu_sbi_ext_ipi = {
 	.handler = kvm_sbi_ext_ipi_handler,
 };
 
+/*
+ * Linux guests ask for a full flush with size == -1, and remote hart
+ * queues would flush everything anyway past PTRS_PER_PTE pages, so catch
+ * those here instead of queueing a range. Otherwise round the range out
+ * to whole pages so that neighbouring requests can be merged.
+ */
+static bool kvm_sbi_rfence_range(unsigned long *start, unsigned long *size)
+{
+	unsigned long end;
+
+	if (!*start && !*size)
+		return false;
+	if (check_add_overflow(*start, *size, &end))
+		return false;
+
+	*start = round_down(*start, PAGE_SIZE);
+	*size = round_up(end, PAGE_SIZE) - *start;
+	return *size && (*size >> PAGE_SHIFT) <= PTRS_PER_PTE;
+}
+
 static int kvm_sbi_ext_rfence_handler(struct kvm_vcpu *vcpu, struct kvm_run *run,
 				      struct kvm_vcpu_sbi_return *retdata)
 {
@@ -87,6 +108,8 @@ static int kvm_sbi_ext_rfence_handler(struct kvm_vcpu *vcpu, struct kvm_run *run
 	unsigned long hmask = cp->a0;
 	unsigned long hbase = cp->a1;
 	unsigned long funcid = cp->a6;
+	unsigned long start = cp->a2;
+	unsigned long size = cp->a3;
 
 	switch (funcid) {
 	case SBI_EXT_RFENCE_REMOTE_FENCE_I:
@@ -94,21 +117,21 @@ static int kvm_sbi_ext_rfence_handler(struct kvm_vcpu *vcpu, struct kvm_run *run
 		kvm_riscv_vcpu_pmu_incr_fw(vcpu, SBI_PMU_FW_FENCE_I_SENT);
 		break;
 	case SBI_EXT_RFENCE_REMOTE_SFENCE_VMA:
-		if (cp->a2 == 0 && cp->a3 == 0)
+		if (!kvm_sbi_rfence_range(&start, &size))
 			kvm_riscv_hfence_vvma_all(vcpu->kvm, hbase, hmask);
 		else
 			kvm_riscv_hfence_vvma_gva(vcpu->kvm, hbase, hmask,
-						  cp->a2, cp->a3, PAGE_SHIFT);
+						  start, size, PAGE_SHIFT);
 		kvm_riscv_vcpu_pmu_incr_fw(vcpu, SBI_PMU_FW_HFENCE_VVMA_SENT);
 		break;
 	case SBI_EXT_RFENCE_REMOTE_SFENCE_VMA_ASID:
-		if (cp->a2 == 0 && cp->a3 == 0)
+		if (!kvm_sbi_rfence_range(&start, &size))
 			kvm_riscv_hfence_vvma_asid_all(vcpu->kvm,
 						       hbase, hmask, cp->a4);
 		else
 			kvm_riscv_hfence_vvma_asid_gva(vcpu->kvm,
 						       hbase, hmask,
-						       cp->a2, cp->a3,
+						       start, size,
 						       PAGE_SHIFT, cp->a4);
 		kvm_riscv_vcpu_pmu_incr_fw(vcpu, SBI_PMU_FW_HFENCE_VVMA_ASID_SENT);
 		break;
@@ -8,6 +8,7 @@
 #include <linux/kvm_host.h>
 #include <linux/mm.h>
 #include <linux/sizes.h>
+#include <linux/uaccess.h>
 
 #include <asm/bug.h>
 #include <asm/current.h>
@@ -28,6 +29,7 @@ void kvm_riscv_vcpu_record_steal_time(struct kvm_vcpu *vcpu)
 	u64 last_steal = vcpu->arch.sta.last_steal;
 	__le32 __user *sequence_ptr;
 	__le64 __user *steal_ptr;
+	u8 __user *preempted_ptr;
 	__le32 sequence_le;
 	__le64 steal_le;
 	u32 sequence;
@@ -55,6 +57,8 @@ void kvm_riscv_vcpu_record_steal_time(struct kvm_vcpu *vcpu)
 			       offsetof(struct sbi_sta_struct, sequence));
 	steal_ptr = (__le64 __user *)(hva + offset_in_page(shmem) +
 			    offsetof(struct sbi_sta_struct, steal));
+	preempted_ptr = (u8 __user *)(hva + offset_in_page(shmem) +
+			    offsetof(struct sbi_sta_struct, preempted));
 
 	if (WARN_ON(get_user(sequence_le, sequence_ptr)))
 		return;
@@ -75,6 +79,38 @@ void kvm_riscv_vcpu_record_steal_time(struct kvm_vcpu *vcpu)
 	sequence += 1;
 	WARN_ON(put_user(cpu_to_le32(sequence), sequence_ptr));
 
+	/* The VCPU is about to run, see kvm_riscv_vcpu_set_preempted() */
+	WARN_ON(put_user(0, preempted_ptr));
+
+	kvm_vcpu_mark_page_dirty(vcpu, gfn);
+}
+
+/*
+ * Tell the guest that this VCPU was scheduled out while runnable so that
+ * its vcpu_is_preempted() stops other VCPUs from spinning on it. This is
+ * called from the preempt notifier, so don't fault the page in; missing
+ * an update only costs the guest some spinning.
+ */
+void kvm_riscv_vcpu_set_preempted(struct kvm_vcpu *vcpu)
+{
+	gpa_t shmem = vcpu->arch.sta.shmem;
+	u8 preempted = 1;
+	unsigned long hva;
+	gfn_t gfn;
+
+	if (shmem == INVALID_GPA)
+		return;
+
+	gfn = shmem >> PAGE_SHIFT;
+	hva = kvm_vcpu_gfn_to_hva(vcpu, gfn);
+	if (kvm_is_error_hva(hva))
+		return;
+
+	if (copy_to_user_nofault((u8 __user *)(hva + offset_in_page(shmem) +
+			offsetof(struct sbi_sta_struct, preempted)),
+			&preempted, sizeof(preempted)))
+		return;
+
 	kvm_vcpu_mark_page_dirty(vcpu, gfn);
 }
 
@@ -9,12 +9,23 @@
 #include <linux/errno.h>
 #include <linux/err.h>
 #include <linux/kvm_host.h>
+#include <linux/moduleparam.h>
 #include <linux/uaccess.h>
 #include <clocksource/timer-riscv.h>
 #include <asm/csr.h>
 #include <asm/delay.h>
 #include <asm/kvm_vcpu_timer.h>
 
+/*
+ * How late the wakeup of a blocked Sstc VCPU may come. A non-zero slack
+ * lets the hrtimer core serve the wakeups of many mostly idle VCPUs on a
+ * CPU with a single clockevent programming.
+ */
+static unsigned int blocking_timer_slack_ns;
+module_param(blocking_timer_slack_ns, uint, 0644);
+MODULE_PARM_DESC(blocking_timer_slack_ns,
+		 "Slack of the wakeup timer of blocked Sstc VCPUs in ns (default 0)");
+
 static u64 kvm_riscv_current_cycles(struct kvm_guest_timer *gt)
 {
 	return get_cycles64() + gt->time_delta;
@@ -146,8 +157,17 @@ static void kvm_riscv_vcpu_timer_blocking(struct kvm_vcpu *vcpu)
 	if (!t->init_done)
 		return;
 
+	/*
+	 * A VCPU with its timer off, parked at the maximum compare value,
+	 * only wakes up for other interrupts and needs no hrtimer at all.
+	 */
+	if (t->next_cycles == -1ULL)
+		return;
+
 	delta_ns = kvm_riscv_delta_cycles2ns(t->next_cycles, gt, t);
-	hrtimer_start(&t->hrt, ktime_set(0, delta_ns), HRTIMER_MODE_REL);
+	hrtimer_start_range_ns(&t->hrt, ktime_set(0, delta_ns),
+			       READ_ONCE(blocking_timer_slack_ns),
+			       HRTIMER_MODE_REL);
 	t->next_set = true;
 }
 
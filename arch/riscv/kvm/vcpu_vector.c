@@ -51,8 +51,11 @@ void kvm_riscv_vcpu_guest_vector_restore(struct kvm_cpu_context *cntx,
 					 unsigned long *isa)
 {
 	if ((cntx->sstatus & SR_VS) != SR_VS_OFF) {
-		if (riscv_isa_extension_available(isa, v))
+		if (riscv_isa_extension_available(isa, v)) {
+			/* No preempt_v context is live in the registers after this */
+			riscv_preempt_v_drop_live();
 			__kvm_riscv_vector_restore(cntx);
+		}
 		kvm_riscv_vcpu_vector_clean(cntx);
 	}
 }
@@ -70,6 +73,49 @@ void kvm_riscv_vcpu_host_vector_restore(struct kvm_cpu_context *cntx)
 		__kvm_riscv_vector_restore(cntx);
 }
 
+/*
+ * As for FP, the vector registers are only switched when the guest first
+ * uses them, which matters the more the wider they are.
+ */
+void kvm_riscv_vcpu_vector_load(struct kvm_vcpu *vcpu)
+{
+	struct kvm_cpu_context *cntx = &vcpu->arch.guest_context;
+
+	vcpu->arch.guest_vs = cntx->sstatus & SR_VS;
+	vcpu->arch.guest_vector_loaded = false;
+	cntx->sstatus &= ~SR_VS;
+}
+
+void kvm_riscv_vcpu_vector_put(struct kvm_vcpu *vcpu)
+{
+	struct kvm_cpu_context *cntx = &vcpu->arch.guest_context;
+
+	if (!vcpu->arch.guest_vector_loaded) {
+		cntx->sstatus |= vcpu->arch.guest_vs;
+		return;
+	}
+
+	kvm_riscv_vcpu_guest_vector_save(cntx, vcpu->arch.isa);
+	kvm_riscv_vcpu_host_vector_restore(&vcpu->arch.host_context);
+	vcpu->arch.guest_vector_loaded = false;
+}
+
+/* Returns true if the guest vector state was loaded, and the trap is handled. */
+bool kvm_riscv_vcpu_vector_trap(struct kvm_vcpu *vcpu)
+{
+	struct kvm_cpu_context *cntx = &vcpu->arch.guest_context;
+
+	if (vcpu->arch.guest_vector_loaded || vcpu->arch.guest_vs == SR_VS_OFF)
+		return false;
+
+	kvm_riscv_vcpu_host_vector_save(&vcpu->arch.host_context);
+	cntx->sstatus |= vcpu->arch.guest_vs;
+	kvm_riscv_vcpu_guest_vector_restore(cntx, vcpu->arch.isa);
+	vcpu->arch.guest_vector_loaded = true;
+
+	return true;
+}
+
 int kvm_riscv_vcpu_alloc_vector_context(struct kvm_vcpu *vcpu,
 					struct kvm_cpu_context *cntx)
 {
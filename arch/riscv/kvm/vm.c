@@ -6,9 +6,11 @@
  *     Anup Patel <anup.patel@wdc.com>
  */
 
+#include <linux/debugfs.h>
 #include <linux/errno.h>
 #include <linux/err.h>
 #include <linux/module.h>
+#include <linux/seq_file.h>
 #include <linux/uaccess.h>
 #include <linux/kvm_host.h>
 
@@ -27,10 +29,22 @@ const struct kvm_stats_header kvm_vm_stats_header = {
 		       sizeof(kvm_vm_stats_desc),
 };
 
+static bool kvm_riscv_vm_type_supported(unsigned long type)
+{
+	return type == KVM_RISCV_DEFAULT_VM ||
+	       (type == KVM_RISCV_SW_PROTECTED_VM &&
+		IS_ENABLED(CONFIG_KVM_RISCV_SW_PROTECTED_VM));
+}
+
 int kvm_arch_init_vm(struct kvm *kvm, unsigned long type)
 {
 	int r;
 
+	if (!kvm_riscv_vm_type_supported(type))
+		return -EINVAL;
+
+	kvm->arch.vm_type = type;
+
 	r = kvm_riscv_gstage_alloc_pgd(kvm);
 	if (r)
 		return r;
@@ -55,6 +69,37 @@ void kvm_arch_destroy_vm(struct kvm *kvm)
 	kvm_riscv_aia_destroy_vm(kvm);
 }
 
+/*
+ * Sum of the per-VCPU wfi_wakeup_hist stats. Each line is the lower bound
+ * of a bucket in nanoseconds followed by its count, with bucket b holding
+ * WFI exits that took [2^(b-1), 2^b) ns to wake up again.
+ */
+static int wfi_wakeup_hist_show(struct seq_file *m, void *v)
+{
+	u64 hist[HALT_POLL_HIST_COUNT] = { 0 };
+	struct kvm *kvm = m->private;
+	struct kvm_vcpu *vcpu;
+	unsigned long i;
+	int b;
+
+	kvm_for_each_vcpu(i, vcpu, kvm) {
+		for (b = 0; b < HALT_POLL_HIST_COUNT; b++)
+			hist[b] += READ_ONCE(vcpu->stat.wfi_wakeup_hist[b]);
+	}
+
+	for (b = 0; b < HALT_POLL_HIST_COUNT; b++)
+		seq_printf(m, "%llu %llu\n", b ? BIT_ULL(b - 1) : 0, hist[b]);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(wfi_wakeup_hist);
+
+void kvm_arch_create_vm_debugfs(struct kvm *kvm)
+{
+	debugfs_create_file("wfi_wakeup_hist", 0444, kvm->debugfs_dentry,
+			    kvm, &wfi_wakeup_hist_fops);
+}
+
 int kvm_vm_ioctl_irq_line(struct kvm *kvm, struct kvm_irq_level *irql,
 			  bool line_status)
 {
@@ -200,6 +245,14 @@ int kvm_vm_ioctl_check_extension(struct kvm *kvm, long ext)
 	case KVM_CAP_VM_GPA_BITS:
 		r = kvm_riscv_gstage_gpa_bits();
 		break;
+	case KVM_CAP_SYNC_REGS:
+		r = KVM_SYNC_RISCV_VALID_FIELDS;
+		break;
+	case KVM_CAP_VM_TYPES:
+		r = BIT(KVM_RISCV_DEFAULT_VM);
+		if (kvm_riscv_vm_type_supported(KVM_RISCV_SW_PROTECTED_VM))
+			r |= BIT(KVM_RISCV_SW_PROTECTED_VM);
+		break;
 	default:
 		r = 0;
 		break;
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Accelerated CRC32 and CRC32C using the RISC-V Zbc carry-less multiply
+ * instructions, overriding the weak table-driven lib/crc32.c routines.
+ */
+
+#include <linux/crc32.h>
+#include <linux/crc32poly.h>
+
+#include <asm/cpufeature.h>
+#include <asm/crc-zbc.h>
+#include <asm/hwcap.h>
+
+/*
+ * floor(x^96 / P(x)) with the x^64 term dropped, and its bit-reflected
+ * counterpart for the little-endian variants.
+ */
+#define CRC32_POLY_QT_BE	0x04d101df481b4e5aULL
+#define CRC32_POLY_QT_LE	0x5a72d812fb808b20ULL
+#define CRC32C_POLY_QT_LE	0xa434f61c6f5389f8ULL
+
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!riscv_has_extension_likely(RISCV_ISA_EXT_ZBC))
+		return crc32_le_base(crc, p, len);
+
+	return crc32_le_generic_zbc(crc, p, len, CRC32_POLY_LE,
+				    CRC32_POLY_QT_LE);
+}
+
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!riscv_has_extension_likely(RISCV_ISA_EXT_ZBC))
+		return __crc32c_le_base(crc, p, len);
+
+	return crc32_le_generic_zbc(crc, p, len, CRC32C_POLY_LE,
+				    CRC32C_POLY_QT_LE);
+}
+
+u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!riscv_has_extension_likely(RISCV_ISA_EXT_ZBC))
+		return crc32_be_base(crc, p, len);
+
+	return crc32_be_generic_zbc(crc, p, len, CRC32_POLY_BE,
+				    CRC32_POLY_QT_BE);
+}
@@ -10,8 +10,11 @@
 #include <linux/jump_label.h>
 #include <linux/kasan-checks.h>
 #include <linux/kernel.h>
+#include <linux/string.h>
 
 #include <asm/cpufeature.h>
+#include <asm/simd.h>
+#include <asm/vector.h>
 
 #include <net/checksum.h>
 
@@ -298,6 +301,92 @@ do_csum_no_alignment(const unsigned char *buff, int len)
 	return csum >> 16;
 }
 
+#if defined(CONFIG_RISCV_ISA_V) && defined(CONFIG_64BIT)
+/*
+ * Below this size the cost of kernel_vector_begin()/end() is not paid back
+ * by the wider loads.
+ */
+#define CSUM_VECTOR_MIN_LEN 256
+
+u64 __asm_csum_vector(const void *buf, size_t len);
+u64 __asm_csum_copy_vector(const void *src, void *dst, size_t len);
+
+static inline bool csum_use_vector(int len)
+{
+	return has_vector() && len >= CSUM_VECTOR_MIN_LEN && may_use_simd();
+}
+
+/*
+ * The vector routines sum the buffer as 32-bit words starting at its first
+ * byte, so there is no alignment to undo. Add the trailing 0-3 bytes as a
+ * zero padded word and fold the 64-bit sum down to 16 bits.
+ */
+static unsigned int csum_vector_finish(u64 sum, const unsigned char *tail,
+				       int tail_len)
+{
+	u32 data = 0, csum, hi;
+
+	memcpy(&data, tail, tail_len);
+	sum += data;
+
+	csum = lower_32_bits(sum);
+	hi = upper_32_bits(sum);
+	csum += hi;
+	csum += csum < hi;
+	csum = csum + ror32(csum, 16);
+	return csum >> 16;
+}
+
+static unsigned int do_csum_vector(const unsigned char *buff, int len)
+{
+	int body = len & ~3;
+	u64 sum;
+
+	kasan_check_read(buff, len);
+	kernel_vector_begin();
+	sum = __asm_csum_vector(buff, body);
+	kernel_vector_end();
+
+	return csum_vector_finish(sum, buff + body, len - body);
+}
+
+/*
+ * Copy and checksum in a single pass, so the data is only brought into the
+ * core once. Used for the network receive path when the NIC does not
+ * offload the checksum.
+ */
+__wsum csum_partial_copy_nocheck(const void *src, void *dst, int len)
+{
+	int body = len & ~3;
+	u64 sum;
+
+	if (!csum_use_vector(len)) {
+		memcpy(dst, src, len);
+		return csum_partial(dst, len, 0);
+	}
+
+	kasan_check_read(src, len);
+	kasan_check_write(dst, len);
+	kernel_vector_begin();
+	sum = __asm_csum_copy_vector(src, dst, body);
+	kernel_vector_end();
+	memcpy(dst + body, src + body, len - body);
+
+	return (__force __wsum)csum_vector_finish(sum, src + body, len - body);
+}
+EXPORT_SYMBOL(csum_partial_copy_nocheck);
+#else
+static inline bool csum_use_vector(int len)
+{
+	return false;
+}
+
+static inline unsigned int do_csum_vector(const unsigned char *buff, int len)
+{
+	return 0;
+}
+#endif /* CONFIG_RISCV_ISA_V && CONFIG_64BIT */
+
 /*
  * Perform a checksum on an arbitrary memory address.
  * Will do a light-weight address alignment if buff is misaligned, unless
@@ -308,6 +397,9 @@ unsigned int do_csum(const unsigned char *buff, int len)
 	if (unlikely(len <= 0))
 		return 0;
 
+	if (csum_use_vector(len))
+		return do_csum_vector(buff, len);
+
 	/*
 	 * Significant performance gains can be seen by not doing alignment
 	 * on machines with fast misaligned accesses.
@@ -3,9 +3,16 @@
  * Copyright (C) 2023 SiFive
  * Author: Andy Chiu <andy.chiu@sifive.com>
  */
+#define __NO_FORTIFY
 #include <linux/linkage.h>
+#include <linux/export.h>
+#include <linux/init.h>
+#include <linux/mm.h>
+#include <linux/percpu.h>
+#include <linux/string.h>
 #include <asm/asm.h>
 
+#include <asm/timex.h>
 #include <asm/vector.h>
 #include <asm/simd.h>
 
@@ -14,9 +21,9 @@
 #endif
 
 #ifdef CONFIG_MMU
-size_t riscv_v_usercopy_threshold = CONFIG_RISCV_ISA_V_UCOPY_THRESHOLD;
-int __asm_vector_usercopy(void *dst, void *src, size_t n);
-int fallback_scalar_usercopy(void *dst, void *src, size_t n);
+/* Calibrated at boot for each CPU, see unaligned_access_speed.c */
+DEFINE_PER_CPU(size_t, riscv_v_usercopy_threshold) = CONFIG_RISCV_ISA_V_UCOPY_THRESHOLD;
+
 asmlinkage int enter_vector_usercopy(void *dst, void *src, size_t n)
 {
 	size_t remain, copied;
@@ -43,3 +50,118 @@ asmlinkage int enter_vector_usercopy(void *dst, void *src, size_t n)
 	return fallback_scalar_usercopy(dst, src, n);
 }
 #endif
+
+void __asm_copy_page_vector(void *to, void *from);
+
+/* A whole page is always well above the size where the vector loop wins. */
+void copy_page(void *to, void *from)
+{
+	if (has_vector() && may_use_simd()) {
+		kernel_vector_begin();
+		__asm_copy_page_vector(to, from);
+		kernel_vector_end();
+		return;
+	}
+	__memcpy(to, from, PAGE_SIZE);
+}
+EXPORT_SYMBOL(copy_page);
+
+/*
+ * KASAN provides its own instrumented mem* wrappers on top of the __mem*
+ * routines, so the vector variants are only wired up without it.
+ */
+#ifndef CONFIG_KASAN
+/* Minimum size for the vector mem* routines, tuned at boot. */
+size_t riscv_v_mem_threshold __read_mostly = CONFIG_RISCV_ISA_V_UCOPY_THRESHOLD;
+
+void *__asm_memcpy_vector(void *dst, const void *src, size_t n);
+void *__asm_memset_vector(void *dst, int c, size_t n);
+void *__asm_memmove_vector(void *dst, const void *src, size_t n);
+
+#define V_OPT_TEMPLATE3(prefix, type_r, type_0, type_1)			\
+type_r prefix(type_0 a0, type_1 a1, size_t n)					\
+{										\
+	type_r ret;								\
+										\
+	if (has_vector() && n >= riscv_v_mem_threshold && may_use_simd()) {	\
+		kernel_vector_begin();						\
+		ret = __asm_##prefix##_vector(a0, a1, n);			\
+		kernel_vector_end();						\
+		return ret;							\
+	}									\
+	return __##prefix(a0, a1, n);						\
+}
+
+V_OPT_TEMPLATE3(memcpy, void *, void *, const void *)
+V_OPT_TEMPLATE3(memset, void *, void *, int)
+V_OPT_TEMPLATE3(memmove, void *, void *, const void *)
+
+#define RISCV_V_MEM_CAL_MIN	64
+#define RISCV_V_MEM_CAL_MAX	(PAGE_SIZE * 2)
+#define RISCV_V_MEM_CAL_ITERS	32
+
+static u64 __init riscv_v_mem_time(void *dst, void *src, size_t n, bool vec)
+{
+	u64 start_cycles, end_cycles, best = -1ULL;
+	int i;
+
+	for (i = 0; i < RISCV_V_MEM_CAL_ITERS; i++) {
+		start_cycles = get_cycles64();
+		/* Ensure the CSR read can't reorder WRT to the copy. */
+		mb();
+		if (vec) {
+			kernel_vector_begin();
+			__asm_memcpy_vector(dst, src, n);
+			kernel_vector_end();
+		} else {
+			__memcpy(dst, src, n);
+		}
+		/* Ensure the copy ends before the end time is snapped. */
+		mb();
+		end_cycles = get_cycles64();
+		if ((end_cycles - start_cycles) < best)
+			best = end_cycles - start_cycles;
+	}
+
+	return best;
+}
+
+/*
+ * Find the smallest copy size for which the vector routine, including the
+ * cost of kernel_vector_begin()/end(), beats the scalar one.
+ */
+static int __init riscv_v_mem_calibrate(void)
+{
+	size_t n, threshold = 0;
+	void *dst, *src;
+
+	if (!has_vector())
+		return 0;
+
+	dst = (void *)__get_free_pages(GFP_KERNEL, 1);
+	if (!dst)
+		return 0;
+	src = dst + PAGE_SIZE;
+
+	for (n = RISCV_V_MEM_CAL_MIN; n <= RISCV_V_MEM_CAL_MAX / 2; n *= 2) {
+		u64 scalar_cycles = riscv_v_mem_time(dst, src, n, false);
+		u64 vector_cycles = riscv_v_mem_time(dst, src, n, true);
+
+		if (vector_cycles < scalar_cycles) {
+			threshold = n;
+			break;
+		}
+	}
+
+	free_pages((unsigned long)dst, 1);
+
+	/* Keep the default if the timer can't tell the difference. */
+	if (threshold) {
+		riscv_v_mem_threshold = threshold;
+		pr_info("vector mem* routines used from %zu bytes\n", threshold);
+	}
+
+	return 0;
+}
+late_initcall(riscv_v_mem_calibrate);
+#endif
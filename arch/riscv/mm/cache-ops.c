@@ -13,5 +13,7 @@ riscv_noncoherent_register_cache_ops(const struct riscv_nonstd_cache_ops *ops)
 	if (!ops)
 		return;
 	noncoherent_cache_ops = *ops;
+	if (WARN_ON(ops->wback_inv_all && !ops->wback_inv_all_size))
+		noncoherent_cache_ops.wback_inv_all = NULL;
 }
 EXPORT_SYMBOL_GPL(riscv_noncoherent_register_cache_ops);
@@ -10,6 +10,8 @@
 
 #ifdef CONFIG_SMP
 
+#include <linux/sched.h>
+#include <linux/sync_core.h>
 #include <asm/sbi.h>
 
 static void ipi_remote_fence_i(void *info)
@@ -21,7 +23,8 @@ void flush_icache_all(void)
 {
 	local_flush_icache_all();
 
-	if (IS_ENABLED(CONFIG_RISCV_SBI) && !riscv_use_ipi_for_rfence())
+	if (IS_ENABLED(CONFIG_RISCV_SBI) &&
+	    !riscv_rfence_use_ipi(RISCV_RFENCE_ICACHE, NULL))
 		sbi_remote_fence_i(NULL);
 	else
 		on_each_cpu(ipi_remote_fence_i, NULL, 1);
@@ -38,9 +41,11 @@ EXPORT_SYMBOL(flush_icache_all);
  * schedule a deferred local instruction cache flush to be performed before
  * execution resumes on each hart.
  */
+DEFINE_PER_CPU(struct mm_struct *, icache_running_mm);
+
 void flush_icache_mm(struct mm_struct *mm, bool local)
 {
-	unsigned int cpu;
+	unsigned int cpu, other;
 	cpumask_t others, *mask;
 
 	preempt_disable();
@@ -54,23 +59,30 @@ void flush_icache_mm(struct mm_struct *mm, bool local)
 	local_flush_icache_all();
 
 	/*
-	 * Flush the I$ of other harts concurrently executing, and mark them as
-	 * flushed.
+	 * Order the stale mask against reading which harts run the MM, this
+	 * pairs with the barrier in flush_icache_deferred(): either we see a
+	 * hart switching to the MM and fence it, or it sees its stale bit.
 	 */
-	cpumask_andnot(&others, mm_cpumask(mm), cpumask_of(cpu));
-	local |= cpumask_empty(&others);
-	if (mm == current->active_mm && local) {
-		/*
-		 * It's assumed that at least one strongly ordered operation is
-		 * performed on this hart between setting a hart's cpumask bit
-		 * and scheduling this MM context on that hart.  Sending an SBI
-		 * remote message will do this, but in the case where no
-		 * messages are sent we still need to order this hart's writes
-		 * with flush_icache_deferred().
-		 */
-		smp_mb();
+	smp_mb();
+
+	/*
+	 * With ASIDs the mm_cpumask also holds harts that ran the MM some time
+	 * ago, only the ones actually running it now need a remote fence.
+	 * Everybody else catches up in flush_icache_deferred().
+	 */
+	cpumask_clear(&others);
+	if (!local) {
+		for_each_cpu(other, mm_cpumask(mm)) {
+			if (other != cpu &&
+			    READ_ONCE(per_cpu(icache_running_mm, other)) == mm)
+				cpumask_set_cpu(other, &others);
+		}
+	}
+
+	if (cpumask_empty(&others)) {
+		/* Nothing to send, the barrier above orders the stale mask */
 	} else if (IS_ENABLED(CONFIG_RISCV_SBI) &&
-		   !riscv_use_ipi_for_rfence()) {
+		   !riscv_rfence_use_ipi(RISCV_RFENCE_ICACHE, &others)) {
 		sbi_remote_fence_i(&others);
 	} else {
 		on_each_cpu_mask(&others, ipi_remote_fence_i, NULL, 1);
@@ -79,6 +91,38 @@ void flush_icache_mm(struct mm_struct *mm, bool local)
 	preempt_enable();
 }
 
+/*
+ * RISC-V implements return to user-space through an xRET instruction, which is
+ * not core serializing, so this needs a fence.i. But membarrier SYNC_CORE marks
+ * every hart stale for the MM in prepare_sync_core_cmd() before looking for the
+ * harts to IPI, and a hart only clears its bit along with a fence.i. A hart
+ * whose bit is clear is therefore already in sync: this saves the fence.i when
+ * switching back to the MM through a kernel thread, and the one
+ * flush_icache_deferred() would otherwise do after the membarrier IPI.
+ */
+void sync_core_before_usermode(void)
+{
+	struct mm_struct *mm = current->mm;
+	unsigned int cpu = smp_processor_id();
+
+	if (mm) {
+		cpumask_t *mask = &mm->context.icache_stale_mask;
+
+		/*
+		 * Order the store to rq->curr against the stale mask, this
+		 * pairs with the barrier in membarrier_private_expedited().
+		 */
+		smp_mb();
+		if (!cpumask_test_cpu(cpu, mask))
+			return;
+		cpumask_clear_cpu(cpu, mask);
+		/* As in flush_icache_deferred(), clear the bit before the fence.i. */
+		smp_mb();
+	}
+
+	local_flush_icache_all();
+}
+
 #endif /* CONFIG_SMP */
 
 #ifdef CONFIG_MMU
@@ -99,6 +143,9 @@ EXPORT_SYMBOL_GPL(riscv_cbom_block_size);
 unsigned int riscv_cboz_block_size;
 EXPORT_SYMBOL_GPL(riscv_cboz_block_size);
 
+unsigned int riscv_cbop_block_size;
+EXPORT_SYMBOL_GPL(riscv_cbop_block_size);
+
 static void __init cbo_get_block_size(struct device_node *node,
 				      const char *name, u32 *block_size,
 				      unsigned long *first_hartid)
@@ -123,26 +170,29 @@ static void __init cbo_get_block_size(struct device_node *node,
 
 void __init riscv_init_cbo_blocksizes(void)
 {
-	unsigned long cbom_hartid, cboz_hartid;
-	u32 cbom_block_size = 0, cboz_block_size = 0;
+	unsigned long cbom_hartid, cboz_hartid, cbop_hartid;
+	u32 cbom_block_size = 0, cboz_block_size = 0, cbop_block_size = 0;
 	struct device_node *node;
 	struct acpi_table_header *rhct;
 	acpi_status status;
 
 	if (acpi_disabled) {
 		for_each_of_cpu_node(node) {
-			/* set block-size for cbom and/or cboz extension if available */
+			/* set block-size for cbom, cboz and/or cbop extension if available */
 			cbo_get_block_size(node, "riscv,cbom-block-size",
 					   &cbom_block_size, &cbom_hartid);
 			cbo_get_block_size(node, "riscv,cboz-block-size",
 					   &cboz_block_size, &cboz_hartid);
+			cbo_get_block_size(node, "riscv,cbop-block-size",
+					   &cbop_block_size, &cbop_hartid);
 		}
 	} else {
 		status = acpi_get_table(ACPI_SIG_RHCT, 0, &rhct);
 		if (ACPI_FAILURE(status))
 			return;
 
-		acpi_get_cbo_block_size(rhct, &cbom_block_size, &cboz_block_size, NULL);
+		acpi_get_cbo_block_size(rhct, &cbom_block_size, &cboz_block_size,
+					&cbop_block_size);
 		acpi_put_table((struct acpi_table_header *)rhct);
 	}
 
@@ -151,4 +201,7 @@ void __init riscv_init_cbo_blocksizes(void)
 
 	if (cboz_block_size)
 		riscv_cboz_block_size = cboz_block_size;
+
+	if (cbop_block_size)
+		riscv_cbop_block_size = cbop_block_size;
 }
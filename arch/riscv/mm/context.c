@@ -7,6 +7,7 @@
 
 #include <linux/bitops.h>
 #include <linux/cpumask.h>
+#include <linux/debugfs.h>
 #include <linux/mm.h>
 #include <linux/percpu.h>
 #include <linux/slab.h>
@@ -15,6 +16,7 @@
 #include <asm/tlbflush.h>
 #include <asm/cacheflush.h>
 #include <asm/mmu_context.h>
+#include <asm/timex.h>
 
 #ifdef CONFIG_MMU
 
@@ -33,6 +35,28 @@ static unsigned long *context_asid_map;
 static DEFINE_PER_CPU(atomic_long_t, active_context);
 static DEFINE_PER_CPU(unsigned long, reserved_context);
 
+/*
+ * Each CPU keeps a small stash of free ASIDs of the current version which
+ * are handed out to brand new mms without taking context_lock. The stash
+ * is refilled in batches whenever the CPU has to take the lock anyway and
+ * is implicitly discarded on rollover, when its version goes stale.
+ */
+#define ASID_CACHE_MAX_BATCH	16
+
+struct asid_cache {
+	unsigned long version;
+	unsigned int nr;
+	unsigned long asids[ASID_CACHE_MAX_BATCH];
+};
+
+static unsigned int asid_cache_batch;
+static DEFINE_PER_CPU(struct asid_cache, asid_cache);
+
+/* Allocator statistics, exposed in debugfs and updated under context_lock */
+static u64 asid_stat_rollovers;
+static u64 asid_stat_lock_taken;
+static u64 asid_stat_lock_cycles;
+
 static bool check_update_reserved_context(unsigned long cntx,
 					  unsigned long newcntx)
 {
@@ -129,6 +153,7 @@ static unsigned long __new_context(struct mm_struct *mm)
 
 	/* We're out of ASIDs, so increment current_version */
 	ver = atomic_long_add_return_relaxed(num_asids, &current_version);
+	asid_stat_rollovers++;
 
 	/* Flush everything  */
 	__flush_context();
@@ -142,11 +167,78 @@ static unsigned long __new_context(struct mm_struct *mm)
 	return asid | ver;
 }
 
+static void __refill_asid_cache(struct asid_cache *cache)
+{
+	static u32 cur_idx = 1;
+	unsigned long ver = atomic_long_read(&current_version);
+	unsigned long asid;
+
+	/* Must be called with context_lock held */
+	lockdep_assert_held(&context_lock);
+
+	if (cache->version != ver) {
+		cache->version = ver;
+		cache->nr = 0;
+	}
+
+	/*
+	 * Only take ASIDs which are free right now: running out of ASIDs is
+	 * left to __new_context(), which knows how to roll over.
+	 */
+	while (cache->nr < asid_cache_batch) {
+		asid = find_next_zero_bit(context_asid_map, num_asids, cur_idx);
+		if (asid == num_asids) {
+			cur_idx = 1;
+			break;
+		}
+
+		__set_bit(asid, context_asid_map);
+		cache->asids[cache->nr++] = asid;
+		cur_idx = asid;
+	}
+}
+
+/*
+ * Hand out an ASID from the local stash to an mm which never had one. This
+ * is done without context_lock, so it follows the same rules as the fast
+ * path of set_mm_asid(): the active_context update must go through a
+ * cmpxchg against a non-zero value, otherwise a rollover is in progress
+ * and the caller has to take the slow path.
+ */
+static bool set_mm_asid_cached(struct mm_struct *mm, unsigned int cpu,
+			       unsigned long *cntxp)
+{
+	struct asid_cache *cache = per_cpu_ptr(&asid_cache, cpu);
+	unsigned long ver = atomic_long_read(&current_version);
+	unsigned long cntx, old_active_cntx;
+
+	if (!cache->nr || cache->version != ver)
+		return false;
+
+	cntx = ver | cache->asids[cache->nr - 1];
+
+	/* Somebody else raced with us to give this mm its first ASID. */
+	if (atomic_long_cmpxchg_relaxed(&mm->context.id, 0, cntx))
+		return false;
+
+	cache->nr--;
+
+	old_active_cntx = atomic_long_read(&per_cpu(active_context, cpu));
+	if (!old_active_cntx ||
+	    !atomic_long_cmpxchg_relaxed(&per_cpu(active_context, cpu),
+					 old_active_cntx, cntx))
+		return false;
+
+	*cntxp = cntx;
+	return true;
+}
+
 static void set_mm_asid(struct mm_struct *mm, unsigned int cpu)
 {
 	unsigned long flags;
 	bool need_flush_tlb = false;
 	unsigned long cntx, old_active_cntx;
+	u64 lock_start;
 
 	cntx = atomic_long_read(&mm->context.id);
 
@@ -173,13 +265,36 @@ static void set_mm_asid(struct mm_struct *mm, unsigned int cpu)
 					old_active_cntx, cntx))
 		goto switch_mm_fast;
 
+	/*
+	 * A brand new mm can pick an ASID from the local stash. Note that an
+	 * mm with a previous ASID must go through __new_context() so that a
+	 * reserved ASID still in use on another CPU gets picked up again.
+	 */
+	if (!cntx && set_mm_asid_cached(mm, cpu, &cntx))
+		goto switch_mm_fast;
+
 	raw_spin_lock_irqsave(&context_lock, flags);
+	lock_start = get_cycles64();
 
-	/* Check that our ASID belongs to the current_version. */
+	/*
+	 * Check that our ASID belongs to the current_version. The mm may be
+	 * given its first ASID from another CPU's stash behind our back, in
+	 * which case we check again: the ASID we allocated stays marked as
+	 * used until the next rollover, which is harmless.
+	 */
 	cntx = atomic_long_read(&mm->context.id);
-	if ((cntx & ~asid_mask) != atomic_long_read(&current_version)) {
-		cntx = __new_context(mm);
-		atomic_long_set(&mm->context.id, cntx);
+	while ((cntx & ~asid_mask) != atomic_long_read(&current_version)) {
+		unsigned long newcntx = __new_context(mm);
+		unsigned long oldcntx;
+
+		oldcntx = atomic_long_cmpxchg_relaxed(&mm->context.id, cntx,
+						      newcntx);
+		if (oldcntx == cntx) {
+			cntx = newcntx;
+			break;
+		}
+
+		cntx = oldcntx;
 	}
 
 	if (cpumask_test_and_clear_cpu(cpu, &context_tlb_flush_pending))
@@ -187,6 +302,11 @@ static void set_mm_asid(struct mm_struct *mm, unsigned int cpu)
 
 	atomic_long_set(&per_cpu(active_context, cpu), cntx);
 
+	if (asid_cache_batch)
+		__refill_asid_cache(per_cpu_ptr(&asid_cache, cpu));
+
+	asid_stat_lock_taken++;
+	asid_stat_lock_cycles += get_cycles64() - lock_start;
 	raw_spin_unlock_irqrestore(&context_lock, flags);
 
 switch_mm_fast:
@@ -264,6 +384,15 @@ static int __init asids_init(void)
 
 		__set_bit(0, context_asid_map);
 
+		/*
+		 * Keep the stashed ASIDs to a quarter of the ASID space so
+		 * that generations don't get noticeably shorter.
+		 */
+		asid_cache_batch = min_t(unsigned long, ASID_CACHE_MAX_BATCH,
+					 num_asids / (4 * num_possible_cpus()));
+		if (asid_cache_batch < 2)
+			asid_cache_batch = 0;
+
 		static_branch_enable(&use_asid_allocator);
 
 		pr_info("ASID allocator using %lu bits (%lu entries)\n",
@@ -275,6 +404,25 @@ static int __init asids_init(void)
 	return 0;
 }
 early_initcall(asids_init);
+
+#ifdef CONFIG_DEBUG_FS
+static int __init asids_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	if (!static_branch_unlikely(&use_asid_allocator))
+		return 0;
+
+	dir = debugfs_create_dir("riscv_asid", NULL);
+	debugfs_create_u64("rollovers", 0400, dir, &asid_stat_rollovers);
+	debugfs_create_u64("lock_taken", 0400, dir, &asid_stat_lock_taken);
+	debugfs_create_u64("lock_hold_cycles", 0400, dir, &asid_stat_lock_cycles);
+	debugfs_create_u32("cache_batch", 0400, dir, &asid_cache_batch);
+
+	return 0;
+}
+late_initcall(asids_debugfs_init);
+#endif
 #else
 static inline void set_mm(struct mm_struct *prev,
 			  struct mm_struct *next, unsigned int cpu)
@@ -302,6 +450,14 @@ static inline void flush_icache_deferred(struct mm_struct *mm, unsigned int cpu)
 #ifdef CONFIG_SMP
 	cpumask_t *mask = &mm->context.icache_stale_mask;
 
+	/*
+	 * Publish that this hart runs the MM before looking at its stale bit.
+	 * This pairs with a barrier in flush_icache_mm, which only fences the
+	 * harts it sees running the MM.
+	 */
+	WRITE_ONCE(per_cpu(icache_running_mm, cpu), mm);
+	smp_mb();
+
 	if (cpumask_test_cpu(cpu, mask)) {
 		cpumask_clear_cpu(cpu, mask);
 		/*
@@ -0,0 +1,416 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Transparent Svnapot mappings of large folios, derived from the arm64
+ * contpte implementation.
+ */
+
+#include <linux/mm.h>
+#include <linux/efi.h>
+#include <linux/export.h>
+#include <asm/tlbflush.h>
+
+static inline bool mm_is_user(struct mm_struct *mm)
+{
+	/*
+	 * Don't attempt to fold kernel mappings: unfolding has to invalidate
+	 * the whole range first, and kernel mappings can't tolerate the
+	 * resulting faults. User space faults are serialized on the PTL.
+	 */
+	if (unlikely(mm_is_efi(mm)))
+		return false;
+	return mm != &init_mm;
+}
+
+static inline pte_t *contpte_align_down(pte_t *ptep)
+{
+	return PTR_ALIGN_DOWN(ptep, sizeof(*ptep) * CONT_PTES);
+}
+
+/*
+ * The pte of the page mapped at @ptep, given the value read from it. That is
+ * @pte itself unless it is a NAPOT encoded one, which is the same for all the
+ * pages of the range.
+ */
+static inline pte_t contpte_subpte(pte_t *ptep, pte_t pte)
+{
+	unsigned long idx = ptep - contpte_align_down(ptep);
+
+	if (!pte_napot(pte))
+		return pte;
+
+	return __pte(pte_val(pte_mknoncont(pte)) + (idx << _PAGE_PFN_SHIFT));
+}
+
+/* The pte of the first page of the range that the page of @pte is in. */
+static inline pte_t contpte_first_pte(pte_t pte)
+{
+	return __pte(pte_val(pte) &
+		     ~((unsigned long)(CONT_PTES - 1) << _PAGE_PFN_SHIFT));
+}
+
+static inline unsigned long contpte_addr_end(unsigned long addr,
+					     unsigned long end)
+{
+	unsigned long boundary = (addr + CONT_PTE_SIZE) & CONT_PTE_MASK;
+
+	return (boundary - 1 < end - 1) ? boundary : end;
+}
+
+static pte_t contpte_get_and_clear(struct mm_struct *mm, pte_t *ptep)
+{
+	pte_t pte = __pte(atomic_long_xchg((atomic_long_t *)ptep, 0));
+
+	pte = contpte_subpte(ptep, pte);
+	page_table_check_pte_clear(mm, pte);
+
+	return pte;
+}
+
+/* Maps the whole range at @ptep with the NAPOT version of @pte. */
+static void contpte_set_range(struct mm_struct *mm, pte_t *ptep, pte_t pte)
+{
+	pte_t cont = pte_mkcont(pte);
+	int i;
+
+	page_table_check_ptes_set(mm, ptep, pte, CONT_PTES);
+
+	if (pte_exec(pte))
+		flush_icache_pte(mm, pte);
+
+	for (i = 0; i < CONT_PTES; i++, ptep++)
+		set_pte(ptep, cont);
+}
+
+static void contpte_try_unfold_partial(struct mm_struct *mm, unsigned long addr,
+				       pte_t *ptep, unsigned int nr)
+{
+	/*
+	 * Unfold any partially covered NAPOT range at the beginning and end
+	 * of the range.
+	 */
+	if (ptep != contpte_align_down(ptep) || nr < CONT_PTES)
+		contpte_try_unfold(mm, addr, ptep, __ptep_get(ptep));
+
+	if (ptep + nr != contpte_align_down(ptep + nr)) {
+		unsigned long last_addr = addr + PAGE_SIZE * (nr - 1);
+		pte_t *last_ptep = ptep + nr - 1;
+
+		contpte_try_unfold(mm, last_addr, last_ptep,
+				   __ptep_get(last_ptep));
+	}
+}
+
+/*
+ * Switches the range containing @addr between a NAPOT and a per-page mapping,
+ * @fold saying which. @pte is the pte of the first page of the range. The
+ * privileged specification requires all the old ptes to be invalidated and
+ * fenced before any of them gets the new size, like break-before-make on arm64.
+ */
+static void contpte_convert(struct mm_struct *mm, unsigned long addr,
+			    pte_t *ptep, pte_t pte, bool fold)
+{
+	struct vm_area_struct vma = TLB_FLUSH_VMA(mm, 0);
+	unsigned long start_addr;
+	pte_t *start_ptep;
+	int i;
+
+	start_ptep = ptep = contpte_align_down(ptep);
+	start_addr = addr = ALIGN_DOWN(addr, CONT_PTE_SIZE);
+
+	for (i = 0; i < CONT_PTES; i++, ptep++, addr += PAGE_SIZE) {
+		pte_t ptent = contpte_get_and_clear(mm, ptep);
+
+		if (pte_dirty(ptent))
+			pte = pte_mkdirty(pte);
+
+		if (pte_young(ptent))
+			pte = pte_mkyoung(pte);
+	}
+
+	flush_tlb_range(&vma, start_addr, addr);
+
+	if (fold)
+		contpte_set_range(mm, start_ptep, pte);
+	else
+		__set_ptes(mm, start_addr, start_ptep, pte, CONT_PTES);
+}
+
+void __contpte_try_fold(struct mm_struct *mm, unsigned long addr,
+			pte_t *ptep, pte_t pte)
+{
+	/*
+	 * contpte_try_fold() already checked that the virtual and physical
+	 * addresses are aligned for a NAPOT mapping and that the pte is not
+	 * special. What is left is to make sure that the range is covered by a
+	 * single folio and that all its ptes are valid, with contiguous pfns
+	 * and the same prot. The access and dirty bits don't matter, the NAPOT
+	 * ptes will get the logical OR of them.
+	 */
+	unsigned long folio_start, folio_end;
+	unsigned long cont_start, cont_end;
+	pte_t expected_pte, subpte;
+	struct folio *folio;
+	struct page *page;
+	pte_t *orig_ptep;
+	int i;
+
+	if (!mm_is_user(mm))
+		return;
+
+	page = pte_page(pte);
+	folio = page_folio(page);
+	folio_start = addr - (page - &folio->page) * PAGE_SIZE;
+	folio_end = folio_start + folio_nr_pages(folio) * PAGE_SIZE;
+	cont_start = ALIGN_DOWN(addr, CONT_PTE_SIZE);
+	cont_end = cont_start + CONT_PTE_SIZE;
+
+	if (folio_start > cont_start || folio_end < cont_end)
+		return;
+
+	pte = contpte_first_pte(pte);
+	expected_pte = pte_mkold(pte_mkclean(pte));
+	orig_ptep = ptep;
+	ptep = contpte_align_down(ptep);
+
+	for (i = 0; i < CONT_PTES; i++) {
+		subpte = pte_mkold(pte_mkclean(__ptep_get(ptep)));
+		if (!pte_same(subpte, expected_pte))
+			return;
+		pte_val(expected_pte) += 1 << _PAGE_PFN_SHIFT;
+		ptep++;
+	}
+
+	contpte_convert(mm, addr, orig_ptep, pte, true);
+}
+EXPORT_SYMBOL_GPL(__contpte_try_fold);
+
+void __contpte_try_unfold(struct mm_struct *mm, unsigned long addr,
+			  pte_t *ptep, pte_t pte)
+{
+	/*
+	 * contpte_try_unfold() already checked that this is a NAPOT pte, so
+	 * just check that the mm is user space.
+	 */
+	if (!mm_is_user(mm))
+		return;
+
+	contpte_convert(mm, addr, ptep, pte_mknoncont(pte), false);
+}
+EXPORT_SYMBOL_GPL(__contpte_try_unfold);
+
+pte_t contpte_ptep_get(pte_t *ptep, pte_t orig_pte)
+{
+	/*
+	 * Gather the access/dirty bits, which the hardware may have set in any
+	 * of the ptes of the range. We hold the PTL, so the range can't be
+	 * unfolded or otherwise modified under our feet.
+	 */
+	pte_t *p = contpte_align_down(ptep);
+	pte_t pte;
+	int i;
+
+	orig_pte = contpte_subpte(ptep, orig_pte);
+
+	for (i = 0; i < CONT_PTES; i++, p++) {
+		pte = __ptep_get(p);
+
+		if (pte_dirty(pte))
+			orig_pte = pte_mkdirty(orig_pte);
+
+		if (pte_young(pte))
+			orig_pte = pte_mkyoung(orig_pte);
+	}
+
+	return orig_pte;
+}
+EXPORT_SYMBOL_GPL(contpte_ptep_get);
+
+pte_t contpte_ptep_get_lockless(pte_t *orig_ptep)
+{
+	/*
+	 * Without the PTL, the range may be unfolded, modified or refolded
+	 * while we gather the access/dirty bits. Only accept a consistent read,
+	 * where all the ptes hold the same NAPOT value ignoring access/dirty,
+	 * and start again otherwise. A pte without the NAPOT bit is consistent
+	 * on its own.
+	 */
+	unsigned long orig_val;
+	pte_t orig_pte;
+	pte_t *ptep;
+	pte_t pte;
+	int i;
+
+retry:
+	orig_pte = __ptep_get(orig_ptep);
+
+	if (!pte_valid_cont(orig_pte))
+		return orig_pte;
+
+	orig_val = pte_val(pte_mkold(pte_mkclean(orig_pte)));
+	ptep = contpte_align_down(orig_ptep);
+
+	for (i = 0; i < CONT_PTES; i++, ptep++) {
+		pte = __ptep_get(ptep);
+
+		if (pte_val(pte_mkold(pte_mkclean(pte))) != orig_val)
+			goto retry;
+
+		if (pte_dirty(pte))
+			orig_pte = pte_mkdirty(orig_pte);
+
+		if (pte_young(pte))
+			orig_pte = pte_mkyoung(orig_pte);
+	}
+
+	return contpte_subpte(orig_ptep, orig_pte);
+}
+EXPORT_SYMBOL_GPL(contpte_ptep_get_lockless);
+
+void contpte_set_ptes(struct mm_struct *mm, unsigned long addr,
+		      pte_t *ptep, pte_t pte, unsigned int nr)
+{
+	unsigned long next;
+	unsigned long end;
+	unsigned long pfn;
+	bool can_fold;
+
+	/*
+	 * The set_ptes() spec guarantees that when nr > 1, the initial state of
+	 * all ptes is not-present and that they map a single folio. Therefore we
+	 * never need to unfold before setting them, and any fully covered,
+	 * aligned range can be mapped with NAPOT ptes right away.
+	 */
+	VM_WARN_ON(nr == 1);
+
+	can_fold = has_svnapot() && mm_is_user(mm) &&
+		   (pte_val(pte) & _PAGE_PRESENT) && !pte_special(pte);
+	if (!can_fold)
+		return __set_ptes(mm, addr, ptep, pte, nr);
+
+	end = addr + (nr << PAGE_SHIFT);
+	pfn = pte_pfn(pte);
+
+	do {
+		next = contpte_addr_end(addr, end);
+		nr = (next - addr) >> PAGE_SHIFT;
+
+		if (((addr | next | (pfn << PAGE_SHIFT)) & ~CONT_PTE_MASK) == 0)
+			contpte_set_range(mm, ptep, pte);
+		else
+			__set_ptes(mm, addr, ptep, pte, nr);
+
+		addr = next;
+		ptep += nr;
+		pfn += nr;
+		pte_val(pte) += (unsigned long)nr << _PAGE_PFN_SHIFT;
+	} while (addr != end);
+}
+EXPORT_SYMBOL_GPL(contpte_set_ptes);
+
+void contpte_clear_full_ptes(struct mm_struct *mm, unsigned long addr,
+			     pte_t *ptep, unsigned int nr, int full)
+{
+	contpte_try_unfold_partial(mm, addr, ptep, nr);
+
+	for (; nr; nr--, ptep++)
+		contpte_get_and_clear(mm, ptep);
+}
+EXPORT_SYMBOL_GPL(contpte_clear_full_ptes);
+
+pte_t contpte_get_and_clear_full_ptes(struct mm_struct *mm,
+				      unsigned long addr, pte_t *ptep,
+				      unsigned int nr, int full)
+{
+	pte_t pte, tmp_pte;
+
+	contpte_try_unfold_partial(mm, addr, ptep, nr);
+
+	pte = contpte_get_and_clear(mm, ptep);
+	while (--nr) {
+		ptep++;
+		tmp_pte = contpte_get_and_clear(mm, ptep);
+		if (pte_dirty(tmp_pte))
+			pte = pte_mkdirty(pte);
+		if (pte_young(tmp_pte))
+			pte = pte_mkyoung(pte);
+	}
+
+	return pte;
+}
+EXPORT_SYMBOL_GPL(contpte_get_and_clear_full_ptes);
+
+int contpte_ptep_test_and_clear_young(struct vm_area_struct *vma,
+				      unsigned long addr, pte_t *ptep)
+{
+	/*
+	 * ptep_test_and_clear_young() technically works on a single pte, but
+	 * the core-mm tracks access per folio, and a NAPOT range is always
+	 * covered by a single folio, so clear young for the whole range rather
+	 * than unfolding it.
+	 */
+	int young = 0;
+	int i;
+
+	ptep = contpte_align_down(ptep);
+	addr = ALIGN_DOWN(addr, CONT_PTE_SIZE);
+
+	for (i = 0; i < CONT_PTES; i++, ptep++, addr += PAGE_SIZE)
+		young |= __ptep_test_and_clear_young(vma, addr, ptep);
+
+	return young;
+}
+EXPORT_SYMBOL_GPL(contpte_ptep_test_and_clear_young);
+
+void contpte_wrprotect_ptes(struct mm_struct *mm, unsigned long addr,
+			    pte_t *ptep, unsigned int nr)
+{
+	/*
+	 * A fully covered range stays NAPOT: all its ptes lose the write bit,
+	 * and the TLB flush that the caller does anyway makes it effective. A
+	 * partially covered one has to be unfolded, as the ptes of a NAPOT
+	 * range must not differ.
+	 */
+	contpte_try_unfold_partial(mm, addr, ptep, nr);
+	__wrprotect_ptes(mm, addr, ptep, nr);
+}
+EXPORT_SYMBOL_GPL(contpte_wrprotect_ptes);
+
+int contpte_ptep_set_access_flags(struct vm_area_struct *vma,
+				  unsigned long addr, pte_t *ptep,
+				  pte_t entry, int dirty)
+{
+	pte_t orig_pte = ptep_get(ptep);
+	unsigned long old;
+	pte_t cont;
+	int i;
+
+	/* Like __ptep_set_access_flags(), always let update_mmu_cache() run. */
+	if (pte_val(orig_pte) == pte_val(entry))
+		return 1;
+
+	/*
+	 * The access/dirty bits can be fixed up without unfolding, but only
+	 * if nothing else changes. Without Svadu, every pte of the range needs
+	 * them or each page takes its own fault. With Svadu, the hardware may
+	 * set A/D in a neighbouring pte concurrently, so or the bits in with
+	 * a cmpxchg rather than a plain store that could drop them.
+	 */
+	if (pte_val(pte_mkold(pte_mkclean(orig_pte))) ==
+	    pte_val(pte_mkold(pte_mkclean(entry)))) {
+		cont = pte_mkcont(entry);
+		ptep = contpte_align_down(ptep);
+
+		for (i = 0; i < CONT_PTES; i++, ptep++) {
+			old = pte_val(__ptep_get(ptep));
+			while (!try_cmpxchg(&pte_val(*ptep), &old,
+					    old | pte_val(cont)))
+				;
+		}
+	} else {
+		__contpte_try_unfold(vma->vm_mm, addr, ptep, __ptep_get(ptep));
+		__ptep_set_access_flags(vma, addr, ptep, entry, dirty);
+	}
+
+	return 1;
+}
+EXPORT_SYMBOL_GPL(contpte_ptep_set_access_flags);
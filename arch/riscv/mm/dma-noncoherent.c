@@ -7,6 +7,7 @@
 
 #include <linux/dma-direct.h>
 #include <linux/dma-map-ops.h>
+#include <linux/iommu.h>
 #include <linux/mm.h>
 #include <asm/cacheflush.h>
 #include <asm/dma-noncoherent.h>
@@ -15,13 +16,30 @@ static bool noncoherent_supported __ro_after_init;
 int dma_cache_alignment __ro_after_init = ARCH_DMA_MINALIGN;
 EXPORT_SYMBOL_GPL(dma_cache_alignment);
 
+#ifdef CONFIG_RISCV_NONSTANDARD_CACHE_OPS
+/*
+ * For large ranges, flushing the whole cache is much cheaper than operating on
+ * every line of the range.  This is also fine in place of an invalidation: the
+ * buffer was cleaned before the device wrote to it and the CPU must not have
+ * written to it since, so none of its lines can be dirty.
+ */
+static inline bool arch_dma_cache_use_all(size_t size)
+{
+	return noncoherent_cache_ops.wback_inv_all &&
+	       size >= noncoherent_cache_ops.wback_inv_all_size;
+}
+#endif
+
 static inline void arch_dma_cache_wback(phys_addr_t paddr, size_t size)
 {
 	void *vaddr = phys_to_virt(paddr);
 
 #ifdef CONFIG_RISCV_NONSTANDARD_CACHE_OPS
 	if (unlikely(noncoherent_cache_ops.wback)) {
-		noncoherent_cache_ops.wback(paddr, size);
+		if (arch_dma_cache_use_all(size))
+			noncoherent_cache_ops.wback_inv_all();
+		else
+			noncoherent_cache_ops.wback(paddr, size);
 		return;
 	}
 #endif
@@ -34,7 +52,10 @@ static inline void arch_dma_cache_inv(phys_addr_t paddr, size_t size)
 
 #ifdef CONFIG_RISCV_NONSTANDARD_CACHE_OPS
 	if (unlikely(noncoherent_cache_ops.inv)) {
-		noncoherent_cache_ops.inv(paddr, size);
+		if (arch_dma_cache_use_all(size))
+			noncoherent_cache_ops.wback_inv_all();
+		else
+			noncoherent_cache_ops.inv(paddr, size);
 		return;
 	}
 #endif
@@ -48,7 +69,10 @@ static inline void arch_dma_cache_wback_inv(phys_addr_t paddr, size_t size)
 
 #ifdef CONFIG_RISCV_NONSTANDARD_CACHE_OPS
 	if (unlikely(noncoherent_cache_ops.wback_inv)) {
-		noncoherent_cache_ops.wback_inv(paddr, size);
+		if (arch_dma_cache_use_all(size))
+			noncoherent_cache_ops.wback_inv_all();
+		else
+			noncoherent_cache_ops.wback_inv(paddr, size);
 		return;
 	}
 #endif
@@ -120,7 +144,11 @@ void arch_dma_prep_coherent(struct page *page, size_t size)
 
 #ifdef CONFIG_RISCV_NONSTANDARD_CACHE_OPS
 	if (unlikely(noncoherent_cache_ops.wback_inv)) {
-		noncoherent_cache_ops.wback_inv(page_to_phys(page), size);
+		if (arch_dma_cache_use_all(size))
+			noncoherent_cache_ops.wback_inv_all();
+		else
+			noncoherent_cache_ops.wback_inv(page_to_phys(page),
+							size);
 		return;
 	}
 #endif
@@ -142,6 +170,9 @@ void arch_setup_dma_ops(struct device *dev, u64 dma_base, u64 size,
 		   dev_driver_string(dev), dev_name(dev));
 
 	dev->dma_coherent = coherent;
+
+	if (device_iommu_mapped(dev))
+		iommu_setup_dma_ops(dev, dma_base, dma_base + size - 1);
 }
 
 void riscv_noncoherent_supported(void)
@@ -17,6 +17,7 @@
 #include <linux/kfence.h>
 #include <linux/entry-common.h>
 
+#include <asm/paravirt.h>
 #include <asm/ptrace.h>
 #include <asm/tlbflush.h>
 
@@ -235,6 +236,10 @@ void handle_page_fault(struct pt_regs *regs)
 	tsk = current;
 	mm = tsk->mm;
 
+	/* The hypervisor is bringing the page in, wait for it elsewhere. */
+	if (pv_apf_page_not_present(regs))
+		return;
+
 	if (kprobe_page_fault(regs, cause))
 		return;
 
@@ -253,6 +253,7 @@ static int __split_linear_mapping_pgd(pgd_t *pgdp,
 	return 0;
 }
 
+/* Despite its name, this also works for leaf entries outside the linear map */
 static int split_linear_mapping(unsigned long start, unsigned long end)
 {
 	return __split_linear_mapping_pgd(pgd_offset_k(start), start, end);
@@ -304,6 +305,14 @@ static int __set_memory(unsigned long addr, int numpages, pgprot_t set_mask,
 			if (ret)
 				goto unlock;
 		}
+
+		/*
+		 * A huge vmalloc area is mapped with leaf PMDs or PUDs as well,
+		 * and only the requested range must change.
+		 */
+		ret = split_linear_mapping(start, end);
+		if (ret)
+			goto unlock;
 	} else if (is_kernel_mapping(start) || is_linear_mapping(start)) {
 		if (is_kernel_mapping(start)) {
 			lm_start = (unsigned long)lm_alias(start);
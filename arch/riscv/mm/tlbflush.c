@@ -4,8 +4,18 @@
 #include <linux/smp.h>
 #include <linux/sched.h>
 #include <linux/hugetlb.h>
+#include <linux/cpuhotplug.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/vmalloc.h>
 #include <asm/sbi.h>
+#include <asm/cacheflush.h>
 #include <asm/mmu_context.h>
+#include <asm/cpufeature.h>
+#include <asm/insn-def.h>
+#include <asm/timex.h>
+
+#define has_svinval()	riscv_has_extension_unlikely(RISCV_ISA_EXT_SVINVAL)
 
 static inline void local_flush_tlb_all_asid(unsigned long asid)
 {
@@ -30,11 +40,57 @@ static inline void local_flush_tlb_page_asid(unsigned long addr,
 		local_flush_tlb_page(addr);
 }
 
+static inline void local_sinval_vma_asid(unsigned long addr,
+					 unsigned long asid)
+{
+	if (asid != FLUSH_TLB_NO_ASID)
+		asm volatile(SINVAL_VMA(%0, %1) : : "r" (addr), "r" (asid) : "memory");
+	else
+		asm volatile(SINVAL_VMA(%0, zero) : : "r" (addr) : "memory");
+}
+
 /*
  * Flush entire TLB if number of entries to be flushed is greater
- * than the threshold below.
+ * than the threshold below. The per-CPU value is calibrated at boot and
+ * when a CPU comes online, see tlb_flush_threshold_calibrate() below.
  */
 static unsigned long tlb_flush_all_threshold __read_mostly = 64;
+static DEFINE_PER_CPU_READ_MOSTLY(unsigned long, tlb_flush_threshold);
+
+static inline unsigned long local_tlb_flush_all_threshold(void)
+{
+	unsigned long threshold = this_cpu_read(tlb_flush_threshold);
+
+	return threshold ? threshold : tlb_flush_all_threshold;
+}
+
+static void local_flush_tlb_pages_asid(unsigned long start,
+				       unsigned long nr_ptes_in_range,
+				       unsigned long stride,
+				       unsigned long asid)
+{
+	unsigned long i;
+
+	/*
+	 * With Svinval, the invalidations themselves are not ordered against
+	 * each other, so a single sfence.w.inval/sfence.inval.ir pair around
+	 * the whole burst is enough instead of a full fence per page.
+	 */
+	if (has_svinval()) {
+		asm volatile(SFENCE_W_INVAL() ::: "memory");
+		for (i = 0; i < nr_ptes_in_range; ++i) {
+			local_sinval_vma_asid(start, asid);
+			start += stride;
+		}
+		asm volatile(SFENCE_INVAL_IR() ::: "memory");
+		return;
+	}
+
+	for (i = 0; i < nr_ptes_in_range; ++i) {
+		local_flush_tlb_page_asid(start, asid);
+		start += stride;
+	}
+}
 
 static void local_flush_tlb_range_threshold_asid(unsigned long start,
 						 unsigned long size,
@@ -42,17 +98,13 @@ static void local_flush_tlb_range_threshold_asid(unsigned long start,
 						 unsigned long asid)
 {
 	unsigned long nr_ptes_in_range = DIV_ROUND_UP(size, stride);
-	int i;
 
-	if (nr_ptes_in_range > tlb_flush_all_threshold) {
+	if (nr_ptes_in_range > local_tlb_flush_all_threshold()) {
 		local_flush_tlb_all_asid(asid);
 		return;
 	}
 
-	for (i = 0; i < nr_ptes_in_range; ++i) {
-		local_flush_tlb_page_asid(start, asid);
-		start += stride;
-	}
+	local_flush_tlb_pages_asid(start, nr_ptes_in_range, stride, asid);
 }
 
 static inline void local_flush_tlb_range_asid(unsigned long start,
@@ -72,6 +124,63 @@ void local_flush_tlb_kernel_range(unsigned long start, unsigned long end)
 	local_flush_tlb_range_asid(start, end - start, PAGE_SIZE, FLUSH_TLB_NO_ASID);
 }
 
+/*
+ * Remote fence policy. When IPIs are the boot-time choice for remote
+ * fences they are always used: page tables are then freed without RCU in
+ * pgalloc.h, which relies on the IPI to synchronize with lockless walkers.
+ * Otherwise the SBI RFENCE calls are the default, but sending the fences
+ * as IPIs is also safe, so the cost of both paths is measured at boot for
+ * each kind of fence and the cheaper one is picked per call from the
+ * number of target harts.
+ */
+struct rfence_cost {
+	/* Cost in timer ticks of base + per_cpu * nr_target_cpus */
+	u64 ipi_base;
+	u64 ipi_per_cpu;
+	u64 sbi_base;
+	u64 sbi_per_cpu;
+};
+
+static struct rfence_cost rfence_costs[RISCV_RFENCE_NR_KINDS] __read_mostly;
+static DEFINE_STATIC_KEY_FALSE(rfence_adaptive);
+static DEFINE_PER_CPU(unsigned long [RISCV_RFENCE_NR_KINDS][2], rfence_calls);
+
+static const char * const rfence_kind_names[RISCV_RFENCE_NR_KINDS] = {
+	[RISCV_RFENCE_TLB_RANGE]	= "tlb_range",
+	[RISCV_RFENCE_TLB_ALL]		= "tlb_all",
+	[RISCV_RFENCE_ICACHE]		= "icache",
+};
+
+bool riscv_rfence_use_ipi(enum riscv_rfence_kind kind, const struct cpumask *cmask)
+{
+	const struct rfence_cost *c;
+	unsigned int nr;
+	bool ipi;
+
+	if (riscv_use_ipi_for_rfence())
+		return true;
+
+	if (!static_branch_unlikely(&rfence_adaptive))
+		return false;
+
+	c = &rfence_costs[kind];
+	nr = cmask ? cpumask_weight(cmask) : num_online_cpus();
+	ipi = c->ipi_base + nr * c->ipi_per_cpu < c->sbi_base + nr * c->sbi_per_cpu;
+	this_cpu_inc(rfence_calls[kind][ipi]);
+
+	return ipi;
+}
+
+static inline enum riscv_rfence_kind tlb_rfence_kind(unsigned long size,
+						     unsigned long stride)
+{
+	if (size == FLUSH_TLB_MAX_SIZE ||
+	    DIV_ROUND_UP(size, stride) > local_tlb_flush_all_threshold())
+		return RISCV_RFENCE_TLB_ALL;
+
+	return RISCV_RFENCE_TLB_RANGE;
+}
+
 static void __ipi_flush_tlb_all(void *info)
 {
 	local_flush_tlb_all();
@@ -79,7 +188,7 @@ static void __ipi_flush_tlb_all(void *info)
 
 void flush_tlb_all(void)
 {
-	if (riscv_use_ipi_for_rfence())
+	if (riscv_rfence_use_ipi(RISCV_RFENCE_TLB_ALL, NULL))
 		on_each_cpu(__ipi_flush_tlb_all, NULL, 1);
 	else
 		sbi_remote_sfence_vma_asid(NULL, 0, FLUSH_TLB_MAX_SIZE, FLUSH_TLB_NO_ASID);
@@ -120,7 +229,7 @@ static void __flush_tlb_range(struct cpumask *cmask, unsigned long asid,
 	}
 
 	if (broadcast) {
-		if (riscv_use_ipi_for_rfence()) {
+		if (riscv_rfence_use_ipi(tlb_rfence_kind(size, stride), cmask)) {
 			ftd.asid = asid;
 			ftd.start = start;
 			ftd.size = size;
@@ -211,6 +320,13 @@ void flush_pmd_tlb_range(struct vm_area_struct *vma, unsigned long start,
 	__flush_tlb_range(mm_cpumask(vma->vm_mm), get_mm_asid(vma->vm_mm),
 			  start, end - start, PMD_SIZE);
 }
+
+void flush_pud_tlb_range(struct vm_area_struct *vma, unsigned long start,
+			unsigned long end)
+{
+	__flush_tlb_range(mm_cpumask(vma->vm_mm), get_mm_asid(vma->vm_mm),
+			  start, end - start, PUD_SIZE);
+}
 #endif
 
 bool arch_tlbbatch_should_defer(struct mm_struct *mm)
@@ -218,11 +334,44 @@ bool arch_tlbbatch_should_defer(struct mm_struct *mm)
 	return true;
 }
 
+/*
+ * Record the unmapped address in the batch: pages of the same address space
+ * are merged into a single [start, end) range, which degrades naturally into
+ * a per-ASID flush once it grows beyond the flush-all threshold. Only the
+ * ASID is recorded since the mm may go away before the batch is flushed, in
+ * which case flushing a recycled ASID is harmless.
+ */
 void arch_tlbbatch_add_pending(struct arch_tlbflush_unmap_batch *batch,
 			       struct mm_struct *mm,
 			       unsigned long uaddr)
 {
+	unsigned long asid = get_mm_asid(mm);
+	struct arch_tlbflush_unmap_range *range;
+	unsigned int i;
+
+	uaddr &= PAGE_MASK;
+
+	for (i = 0; i < batch->nr_ranges; i++) {
+		range = &batch->ranges[i];
+		if (range->asid != asid)
+			continue;
+
+		cpumask_or(&batch->cpumask, &batch->cpumask, mm_cpumask(mm));
+		range->start = min(range->start, uaddr);
+		range->end = max(range->end, uaddr + PAGE_SIZE);
+		return;
+	}
+
+	/* Full: flush the ranges recorded so far and start over */
+	if (batch->nr_ranges == ARCH_TLBBATCH_NR_RANGES)
+		arch_tlbbatch_flush(batch);
+
 	cpumask_or(&batch->cpumask, &batch->cpumask, mm_cpumask(mm));
+
+	range = &batch->ranges[batch->nr_ranges++];
+	range->asid = asid;
+	range->start = uaddr;
+	range->end = uaddr + PAGE_SIZE;
 }
 
 void arch_flush_tlb_batched_pending(struct mm_struct *mm)
@@ -230,9 +379,321 @@ void arch_flush_tlb_batched_pending(struct mm_struct *mm)
 	flush_tlb_mm(mm);
 }
 
+static void local_flush_tlb_batch(struct arch_tlbflush_unmap_batch *batch)
+{
+	struct arch_tlbflush_unmap_range *range;
+	unsigned int i;
+
+	for (i = 0; i < batch->nr_ranges; i++) {
+		range = &batch->ranges[i];
+		local_flush_tlb_range_asid(range->start, range->end - range->start,
+					   PAGE_SIZE, range->asid);
+	}
+}
+
+static void __ipi_flush_tlb_batch(void *info)
+{
+	local_flush_tlb_batch(info);
+}
+
 void arch_tlbbatch_flush(struct arch_tlbflush_unmap_batch *batch)
 {
-	__flush_tlb_range(&batch->cpumask, FLUSH_TLB_NO_ASID, 0,
-			  FLUSH_TLB_MAX_SIZE, PAGE_SIZE);
+	struct arch_tlbflush_unmap_range *range;
+	unsigned int i, cpuid;
+
+	if (cpumask_empty(&batch->cpumask))
+		goto out;
+
+	cpuid = get_cpu();
+	if (cpumask_any_but(&batch->cpumask, cpuid) >= nr_cpu_ids) {
+		local_flush_tlb_batch(batch);
+	} else if (riscv_rfence_use_ipi(RISCV_RFENCE_TLB_RANGE, &batch->cpumask)) {
+		/* A single IPI per target hart for all the ranges. */
+		on_each_cpu_mask(&batch->cpumask, __ipi_flush_tlb_batch, batch, 1);
+	} else {
+		for (i = 0; i < batch->nr_ranges; i++) {
+			range = &batch->ranges[i];
+			sbi_remote_sfence_vma_asid(&batch->cpumask, range->start,
+						   range->end - range->start,
+						   range->asid);
+		}
+	}
+	put_cpu();
+
+out:
 	cpumask_clear(&batch->cpumask);
+	batch->nr_ranges = 0;
+}
+
+#define TLB_CALIBRATE_PAGES	256
+#define TLB_CALIBRATE_ITERS	16
+
+static u64 tlb_calibrate_touch(volatile u8 *buf)
+{
+	u64 start_cycles, end_cycles;
+	int i;
+
+	start_cycles = get_cycles64();
+	mb();
+	for (i = 0; i < TLB_CALIBRATE_PAGES; i++)
+		(void)buf[i * PAGE_SIZE];
+	mb();
+	end_cycles = get_cycles64();
+
+	return end_cycles - start_cycles;
+}
+
+/*
+ * Estimate at which number of pages a full local flush becomes cheaper
+ * than invalidating the pages one by one: the cost of a full flush is the
+ * sfence.vma itself plus refilling a working set of TLB_CALIBRATE_PAGES
+ * base pages, which is compared against the cost of a single page
+ * invalidation as performed by local_flush_tlb_pages_asid(). That one is
+ * called directly, the threshold being calibrated must not turn it into a
+ * full flush.
+ */
+static void tlb_flush_threshold_calibrate(void *param)
+{
+	int cpu = smp_processor_id();
+	unsigned long start = (unsigned long)param;
+	u64 start_cycles, end_cycles;
+	u64 page_cycles = 0, full_cycles = 0, warm_cycles = 0;
+	unsigned long threshold;
+	int i;
+
+	/* Warm up the TLB with the working set. */
+	tlb_calibrate_touch(param);
+
+	for (i = 0; i < TLB_CALIBRATE_ITERS; i++) {
+		warm_cycles += tlb_calibrate_touch(param);
+
+		start_cycles = get_cycles64();
+		mb();
+		local_flush_tlb_pages_asid(start, TLB_CALIBRATE_PAGES,
+					   PAGE_SIZE, FLUSH_TLB_NO_ASID);
+		mb();
+		end_cycles = get_cycles64();
+		page_cycles += end_cycles - start_cycles;
+		tlb_calibrate_touch(param);
+
+		start_cycles = get_cycles64();
+		mb();
+		local_flush_tlb_all();
+		mb();
+		end_cycles = get_cycles64();
+		full_cycles += end_cycles - start_cycles;
+		full_cycles += tlb_calibrate_touch(param);
+	}
+
+	full_cycles = full_cycles > warm_cycles ? full_cycles - warm_cycles : 0;
+
+	/* Don't divide by zero. */
+	if (!page_cycles || !full_cycles) {
+		pr_warn("cpu%d: rdtime lacks granularity needed to calibrate TLB flush threshold\n",
+			cpu);
+		return;
+	}
+
+	threshold = div64_u64(full_cycles * TLB_CALIBRATE_PAGES, page_cycles);
+	threshold = clamp_t(unsigned long, threshold, 1, PTRS_PER_PTE);
+
+	per_cpu(tlb_flush_threshold, cpu) = threshold;
+	pr_info("cpu%d: TLB flush-all threshold calibrated to %lu pages%s\n",
+		cpu, threshold, has_svinval() ? " (svinval)" : "");
+}
+
+static int tlb_flush_threshold_online_cpu(unsigned int cpu)
+{
+	void *buf;
+
+	if (per_cpu(tlb_flush_threshold, cpu))
+		return 0;
+
+	buf = vmalloc(TLB_CALIBRATE_PAGES * PAGE_SIZE);
+	if (!buf)
+		return 0;
+
+	memset(buf, 0, TLB_CALIBRATE_PAGES * PAGE_SIZE);
+	tlb_flush_threshold_calibrate(buf);
+	vfree(buf);
+
+	return 0;
 }
+
+static int __init tlb_flush_threshold_calibrate_all_cpus(void)
+{
+	void *buf;
+
+	buf = vmalloc(TLB_CALIBRATE_PAGES * PAGE_SIZE);
+	if (!buf) {
+		pr_warn("Allocation failure, not calibrating TLB flush threshold\n");
+		return 0;
+	}
+
+	/* vmalloc() uses base pages, so every page needs its own TLB entry. */
+	memset(buf, 0, TLB_CALIBRATE_PAGES * PAGE_SIZE);
+	on_each_cpu(tlb_flush_threshold_calibrate, buf, 1);
+	vfree(buf);
+
+	cpuhp_setup_state_nocalls(CPUHP_AP_ONLINE_DYN, "riscv/tlbflush:online",
+				  tlb_flush_threshold_online_cpu, NULL);
+
+	return 0;
+}
+arch_initcall(tlb_flush_threshold_calibrate_all_cpus);
+
+#define RFENCE_CALIBRATE_ITERS	32
+
+static void __ipi_flush_icache(void *info)
+{
+	local_flush_icache_all();
+}
+
+static void rfence_issue(enum riscv_rfence_kind kind, const struct cpumask *cmask,
+			 bool ipi)
+{
+	struct flush_tlb_range_data ftd = {
+		.asid	= FLUSH_TLB_NO_ASID,
+		.start	= PAGE_OFFSET,
+		.size	= kind == RISCV_RFENCE_TLB_ALL ? FLUSH_TLB_MAX_SIZE : PAGE_SIZE,
+		.stride	= PAGE_SIZE,
+	};
+
+	if (kind == RISCV_RFENCE_ICACHE) {
+		if (ipi)
+			on_each_cpu_mask(cmask, __ipi_flush_icache, NULL, 1);
+		else
+			sbi_remote_fence_i(cmask);
+	} else {
+		if (ipi)
+			on_each_cpu_mask(cmask, __ipi_flush_tlb_range_asid, &ftd, 1);
+		else
+			sbi_remote_sfence_vma_asid(cmask, ftd.start, ftd.size, ftd.asid);
+	}
+}
+
+static u64 rfence_measure(enum riscv_rfence_kind kind, const struct cpumask *cmask,
+			  bool ipi)
+{
+	u64 start_cycles, total = 0;
+	int i;
+
+	/* The first round only warms up both paths. */
+	rfence_issue(kind, cmask, ipi);
+
+	for (i = 0; i < RFENCE_CALIBRATE_ITERS; i++) {
+		start_cycles = get_cycles64();
+		rfence_issue(kind, cmask, ipi);
+		total += get_cycles64() - start_cycles;
+	}
+
+	return div_u64(total, RFENCE_CALIBRATE_ITERS);
+}
+
+/*
+ * Fit base + per_cpu * nr_cpus from one measurement targeting this hart and
+ * one other, and one targeting every online hart.
+ */
+static void rfence_fit(u64 t_pair, u64 t_all, unsigned int nr_all,
+		       u64 *base, u64 *per_cpu)
+{
+	*per_cpu = 0;
+	if (nr_all > 2 && t_all > t_pair)
+		*per_cpu = div_u64(t_all - t_pair, nr_all - 2);
+
+	*base = t_pair > 2 * *per_cpu ? t_pair - 2 * *per_cpu : 0;
+}
+
+static int __init rfence_calibrate(void)
+{
+	unsigned int cpu, other, nr_all, kind;
+	u64 ipi_pair, ipi_all, sbi_pair, sbi_all;
+	struct rfence_cost *c;
+	cpumask_var_t pair;
+
+	if (!IS_ENABLED(CONFIG_RISCV_SBI) || riscv_use_ipi_for_rfence())
+		return 0;
+
+	if (!riscv_ipi_have_virq_range() || num_online_cpus() < 2)
+		return 0;
+
+	if (!zalloc_cpumask_var(&pair, GFP_KERNEL))
+		return 0;
+
+	cpus_read_lock();
+
+	cpu = get_cpu();
+	other = cpumask_any_but(cpu_online_mask, cpu);
+	cpumask_set_cpu(cpu, pair);
+	cpumask_set_cpu(other, pair);
+	nr_all = num_online_cpus();
+
+	for (kind = 0; kind < RISCV_RFENCE_NR_KINDS; kind++) {
+		c = &rfence_costs[kind];
+
+		ipi_pair = rfence_measure(kind, pair, true);
+		ipi_all = rfence_measure(kind, cpu_online_mask, true);
+		sbi_pair = rfence_measure(kind, pair, false);
+		sbi_all = rfence_measure(kind, cpu_online_mask, false);
+
+		rfence_fit(ipi_pair, ipi_all, nr_all, &c->ipi_base, &c->ipi_per_cpu);
+		rfence_fit(sbi_pair, sbi_all, nr_all, &c->sbi_base, &c->sbi_per_cpu);
+	}
+
+	put_cpu();
+	cpus_read_unlock();
+	free_cpumask_var(pair);
+
+	for (kind = 0; kind < RISCV_RFENCE_NR_KINDS; kind++) {
+		c = &rfence_costs[kind];
+		pr_info("%s remote fence: ipi %llu+%llu/cpu, sbi %llu+%llu/cpu ticks\n",
+			rfence_kind_names[kind], c->ipi_base, c->ipi_per_cpu,
+			c->sbi_base, c->sbi_per_cpu);
+	}
+
+	static_branch_enable(&rfence_adaptive);
+
+	return 0;
+}
+late_initcall(rfence_calibrate);
+
+#ifdef CONFIG_DEBUG_FS
+static int rfence_cost_show(struct seq_file *m, void *v)
+{
+	unsigned long calls[2];
+	struct rfence_cost *c;
+	unsigned int kind;
+	int cpu;
+
+	seq_printf(m, "mode: %s\n", riscv_use_ipi_for_rfence() ? "ipi" :
+		   static_branch_unlikely(&rfence_adaptive) ? "adaptive" : "sbi");
+	seq_puts(m, "kind       ipi_base ipi_per_cpu   sbi_base sbi_per_cpu  ipi_calls  sbi_calls\n");
+
+	for (kind = 0; kind < RISCV_RFENCE_NR_KINDS; kind++) {
+		c = &rfence_costs[kind];
+		calls[0] = calls[1] = 0;
+		for_each_possible_cpu(cpu) {
+			calls[0] += per_cpu(rfence_calls, cpu)[kind][0];
+			calls[1] += per_cpu(rfence_calls, cpu)[kind][1];
+		}
+
+		seq_printf(m, "%-10s %8llu %11llu %10llu %11llu %10lu %10lu\n",
+			   rfence_kind_names[kind], c->ipi_base, c->ipi_per_cpu,
+			   c->sbi_base, c->sbi_per_cpu, calls[1], calls[0]);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(rfence_cost);
+
+static int __init rfence_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("riscv_rfence", NULL);
+	debugfs_create_file("cost", 0400, dir, NULL, &rfence_cost_fops);
+
+	return 0;
+}
+late_initcall(rfence_debugfs_init);
+#endif
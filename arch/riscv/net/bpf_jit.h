@@ -18,11 +18,21 @@ static inline bool rvc_enabled(void)
 	return IS_ENABLED(CONFIG_RISCV_ISA_C);
 }
 
+static inline bool rvzba_enabled(void)
+{
+	return IS_ENABLED(CONFIG_RISCV_ISA_ZBA) && riscv_has_extension_likely(RISCV_ISA_EXT_ZBA);
+}
+
 static inline bool rvzbb_enabled(void)
 {
 	return IS_ENABLED(CONFIG_RISCV_ISA_ZBB) && riscv_has_extension_likely(RISCV_ISA_EXT_ZBB);
 }
 
+static inline bool rvzicond_enabled(void)
+{
+	return riscv_has_extension_unlikely(RISCV_ISA_EXT_ZICOND);
+}
+
 enum {
 	RV_REG_ZERO =	0,	/* The constant value 0 */
 	RV_REG_RA =	1,	/* Return address */
@@ -78,6 +88,7 @@ struct rv_jit_context {
 	int prologue_len;
 	int epilogue_offset;
 	int *offset;		/* BPF to RV */
+	unsigned long *jmp_targets;	/* BPF insns that are branched to */
 	int nexentries;
 	unsigned long flags;
 	int stack_size;
@@ -394,6 +405,11 @@ static inline u32 rv_sub(u8 rd, u8 rs1, u8 rs2)
 	return rv_r_insn(0x20, rs2, rs1, 0, rd, 0x33);
 }
 
+static inline u32 rv_slt(u8 rd, u8 rs1, u8 rs2)
+{
+	return rv_r_insn(0, rs2, rs1, 2, rd, 0x33);
+}
+
 static inline u32 rv_sltu(u8 rd, u8 rs1, u8 rs2)
 {
 	return rv_r_insn(0, rs2, rs1, 3, rd, 0x33);
@@ -735,6 +751,12 @@ static inline u16 rvc_swsp(u32 imm8, u8 rs2)
 	return rv_css_insn(0x6, imm, rs2, 0x2);
 }
 
+/* RVZBA instructions. */
+static inline u32 rvzba_sh3add(u8 rd, u8 rs1, u8 rs2)
+{
+	return rv_r_insn(0x10, rs2, rs1, 6, rd, 0x33);
+}
+
 /* RVZBB instrutions. */
 static inline u32 rvzbb_sextb(u8 rd, u8 rs1)
 {
@@ -762,6 +784,17 @@ static inline u32 rvzbb_rev8(u8 rd, u8 rs)
 	return rv_i_insn(0x698, rs, 5, rd, 0x13);
 }
 
+/* RVZICOND instructions. */
+static inline u32 rvzicond_czero_eqz(u8 rd, u8 rs1, u8 rs2)
+{
+	return rv_r_insn(0x7, rs2, rs1, 5, rd, 0x33);
+}
+
+static inline u32 rvzicond_czero_nez(u8 rd, u8 rs1, u8 rs2)
+{
+	return rv_r_insn(0x7, rs2, rs1, 7, rd, 0x33);
+}
+
 /*
  * RV64-only instructions.
  *
@@ -776,6 +809,11 @@ static inline u32 rv_addiw(u8 rd, u8 rs1, u16 imm11_0)
 	return rv_i_insn(imm11_0, rs1, 0, rd, 0x1b);
 }
 
+static inline u32 rvzba_adduw(u8 rd, u8 rs1, u8 rs2)
+{
+	return rv_r_insn(0x04, rs2, rs1, 0, rd, 0x3b);
+}
+
 static inline u32 rv_slliw(u8 rd, u8 rs1, u16 imm11_0)
 {
 	return rv_i_insn(imm11_0, rs1, 1, rd, 0x1b);
@@ -1159,10 +1197,27 @@ static inline void emit_zexth(u8 rd, u8 rs, struct rv_jit_context *ctx)
 
 static inline void emit_zextw(u8 rd, u8 rs, struct rv_jit_context *ctx)
 {
+	if (rvzba_enabled()) {
+		emit(rvzba_adduw(rd, rs, RV_REG_ZERO), ctx);
+		return;
+	}
+
 	emit_slli(rd, rs, 32, ctx);
 	emit_srli(rd, rd, 32, ctx);
 }
 
+/* rd = (rs1 << 3) + rs2, rd must not be rs2 */
+static inline void emit_sh3add(u8 rd, u8 rs1, u8 rs2, struct rv_jit_context *ctx)
+{
+	if (rvzba_enabled()) {
+		emit(rvzba_sh3add(rd, rs1, rs2), ctx);
+		return;
+	}
+
+	emit_slli(rd, rs1, 3, ctx);
+	emit_add(rd, rd, rs2, ctx);
+}
+
 static inline void emit_bswap(u8 rd, s32 imm, struct rv_jit_context *ctx)
 {
 	if (rvzbb_enabled()) {
@@ -210,6 +210,15 @@ static void emit_imm(u8 rd, s64 val, struct rv_jit_context *ctx)
 		return;
 	}
 
+	/* A zero-extended 32-bit value with a non-zero low part needs at
+	 * least three instructions below, lui/addiw/zext.w is never longer.
+	 */
+	if (rvzba_enabled() && !((u64)val >> 32) && lower) {
+		emit_imm(rd, (s32)val, ctx);
+		emit_zextw(rd, rd, ctx);
+		return;
+	}
+
 	shift = __ffs(upper);
 	upper >>= shift;
 	shift += 12;
@@ -374,8 +383,7 @@ static int emit_bpf_tail_call(int insn, struct rv_jit_context *ctx)
 	 * if (!prog)
 	 *     goto out;
 	 */
-	emit_slli(RV_REG_T2, RV_REG_A2, 3, ctx);
-	emit_add(RV_REG_T2, RV_REG_T2, RV_REG_A1, ctx);
+	emit_sh3add(RV_REG_T2, RV_REG_A2, RV_REG_A1, ctx);
 	off = offsetof(struct bpf_array, ptrs);
 	if (is_12b_check(off, insn))
 		return -1;
@@ -945,7 +953,7 @@ static int __arch_prepare_bpf_trampoline(struct bpf_tramp_image *im,
 			goto out;
 		emit_sd(RV_REG_FP, -retval_off, RV_REG_A0, ctx);
 		emit_sd(RV_REG_FP, -(retval_off - 8), regmap[BPF_REG_0], ctx);
-		im->ip_after_call = ctx->insns + ctx->ninsns;
+		im->ip_after_call = ctx->ro_insns + ctx->ninsns;
 		/* 2 nops reserved for auipc+jalr pair */
 		emit(rv_nop(), ctx);
 		emit(rv_nop(), ctx);
@@ -966,7 +974,7 @@ static int __arch_prepare_bpf_trampoline(struct bpf_tramp_image *im,
 	}
 
 	if (flags & BPF_TRAMP_F_CALL_ORIG) {
-		im->ip_epilogue = ctx->insns + ctx->ninsns;
+		im->ip_epilogue = ctx->ro_insns + ctx->ninsns;
 		emit_imm(RV_REG_A0, (const s64)im, ctx);
 		ret = emit_call((const u64)__bpf_tramp_exit, true, ctx);
 		if (ret)
@@ -1029,31 +1037,176 @@ int arch_bpf_trampoline_size(const struct btf_func_model *m, u32 flags,
 	return ret < 0 ? ret : ninsns_rvoff(ctx.ninsns);
 }
 
-int arch_prepare_bpf_trampoline(struct bpf_tramp_image *im, void *image,
-				void *image_end, const struct btf_func_model *m,
+void *arch_alloc_bpf_trampoline(unsigned int size)
+{
+	return bpf_prog_pack_alloc(size, bpf_fill_ill_insns);
+}
+
+void arch_free_bpf_trampoline(void *image, unsigned int size)
+{
+	bpf_prog_pack_free(image, size);
+}
+
+void arch_protect_bpf_trampoline(void *image, unsigned int size)
+{
+}
+
+void arch_unprotect_bpf_trampoline(void *image, unsigned int size)
+{
+}
+
+int arch_prepare_bpf_trampoline(struct bpf_tramp_image *im, void *ro_image,
+				void *ro_image_end, const struct btf_func_model *m,
 				u32 flags, struct bpf_tramp_links *tlinks,
 				void *func_addr)
 {
 	int ret;
+	void *image, *res;
 	struct rv_jit_context ctx;
+	u32 size = ro_image_end - ro_image;
 
-	ctx.ninsns = 0;
 	/*
-	 * The bpf_int_jit_compile() uses a RW buffer (ctx.insns) to write the
-	 * JITed instructions and later copies it to a RX region (ctx.ro_insns).
-	 * It also uses ctx.ro_insns to calculate offsets for jumps etc. As the
-	 * trampoline image uses the same memory area for writing and execution,
-	 * both ctx.insns and ctx.ro_insns can be set to image.
+	 * The trampoline lives in a shared bpf_prog_pack, which is never
+	 * writable. Build it in a scratch buffer, using ro_image for all
+	 * offset calculations, and copy it in place once done.
 	 */
+	image = kvmalloc(size, GFP_KERNEL);
+	if (!image)
+		return -ENOMEM;
+
+	ctx.ninsns = 0;
 	ctx.insns = image;
-	ctx.ro_insns = image;
+	ctx.ro_insns = ro_image;
 	ret = __arch_prepare_bpf_trampoline(im, m, tlinks, func_addr, flags, &ctx);
 	if (ret < 0)
-		return ret;
+		goto out;
+
+	if (WARN_ON(size < ninsns_rvoff(ctx.ninsns))) {
+		ret = -E2BIG;
+		goto out;
+	}
+
+	res = bpf_arch_text_copy(ro_image, image, ninsns_rvoff(ctx.ninsns));
+	if (IS_ERR(res)) {
+		ret = PTR_ERR(res);
+		goto out;
+	}
+
+	bpf_flush_icache(ro_image, ro_image_end);
+	ret = ninsns_rvoff(ret);
+out:
+	kvfree(image);
+	return ret;
+}
+
+/*
+ * "if (a op b) goto +1; dst = src;" is a conditional move. With Zicond, emit
+ * it without a branch, as the condition is often data dependent and hard to
+ * predict. Returns true if the move was emitted too.
+ */
+static bool emit_cond_mov(const struct bpf_insn *insn, u8 rd, u8 rs, bool is64,
+			  struct rv_jit_context *ctx)
+{
+	const struct bpf_insn *mov = insn + 1;
+	int i = insn - ctx->prog->insnsi;
+	u8 op = BPF_OP(insn->code), t = RV_REG_T1, mrd, mrs;
+	bool keep_if_zero;
+
+	if (!rvzicond_enabled() || insn->off != 1 || i + 1 >= ctx->prog->len ||
+	    test_bit(i + 1, ctx->jmp_targets))
+		return false;
+	if ((mov->code != (BPF_ALU64 | BPF_MOV | BPF_X) &&
+	     mov->code != (BPF_ALU64 | BPF_MOV | BPF_K)) || mov->off)
+		return false;
+
+	if (BPF_SRC(insn->code) == BPF_K) {
+		rs = insn->imm ? RV_REG_T1 : RV_REG_ZERO;
+		if (insn->imm)
+			emit_imm(rs, insn->imm, ctx);
+	}
+
+	if (!is64) {
+		if (is_signed_bpf_cond(op)) {
+			/* An immediate has been sign extended */
+			if (BPF_SRC(insn->code) == BPF_X)
+				emit_sextw_alt(&rs, RV_REG_T1, ctx);
+			emit_sextw_alt(&rd, RV_REG_T2, ctx);
+		} else {
+			if (BPF_SRC(insn->code) == BPF_X)
+				emit_zextw_alt(&rs, RV_REG_T1, ctx);
+			else if (insn->imm)
+				emit_zextw(rs, rs, ctx);
+			emit_zextw_alt(&rd, RV_REG_T2, ctx);
+		}
+	}
+
+	/* The branch is taken, i.e. dst is kept, iff t is (non)zero */
+	switch (op) {
+	case BPF_JEQ:
+		emit_xor(t, rd, rs, ctx);
+		keep_if_zero = true;
+		break;
+	case BPF_JNE:
+		emit_xor(t, rd, rs, ctx);
+		keep_if_zero = false;
+		break;
+	case BPF_JSET:
+		emit_and(t, rd, rs, ctx);
+		keep_if_zero = false;
+		break;
+	case BPF_JGT:
+		emit(rv_sltu(t, rs, rd), ctx);
+		keep_if_zero = false;
+		break;
+	case BPF_JLT:
+		emit(rv_sltu(t, rd, rs), ctx);
+		keep_if_zero = false;
+		break;
+	case BPF_JGE:
+		emit(rv_sltu(t, rd, rs), ctx);
+		keep_if_zero = true;
+		break;
+	case BPF_JLE:
+		emit(rv_sltu(t, rs, rd), ctx);
+		keep_if_zero = true;
+		break;
+	case BPF_JSGT:
+		emit(rv_slt(t, rs, rd), ctx);
+		keep_if_zero = false;
+		break;
+	case BPF_JSLT:
+		emit(rv_slt(t, rd, rs), ctx);
+		keep_if_zero = false;
+		break;
+	case BPF_JSGE:
+		emit(rv_slt(t, rd, rs), ctx);
+		keep_if_zero = true;
+		break;
+	case BPF_JSLE:
+	default:
+		emit(rv_slt(t, rs, rd), ctx);
+		keep_if_zero = true;
+		break;
+	}
+
+	mrd = bpf_to_rv_reg(mov->dst_reg, ctx);
+	if (BPF_SRC(mov->code) == BPF_X) {
+		mrs = bpf_to_rv_reg(mov->src_reg, ctx);
+	} else {
+		mrs = RV_REG_T2;
+		emit_imm(mrs, mov->imm, ctx);
+	}
 
-	bpf_flush_icache(ctx.insns, ctx.insns + ctx.ninsns);
+	if (keep_if_zero) {
+		emit(rvzicond_czero_eqz(RV_REG_T2, mrs, t), ctx);
+		emit(rvzicond_czero_nez(t, mrd, t), ctx);
+	} else {
+		emit(rvzicond_czero_nez(RV_REG_T2, mrs, t), ctx);
+		emit(rvzicond_czero_eqz(t, mrd, t), ctx);
+	}
+	emit_or(mrd, t, RV_REG_T2, ctx);
 
-	return ninsns_rvoff(ret);
+	return true;
 }
 
 int bpf_jit_emit_insn(const struct bpf_insn *insn, struct rv_jit_context *ctx,
@@ -1078,6 +1231,27 @@ int bpf_jit_emit_insn(const struct bpf_insn *insn, struct rv_jit_context *ctx,
 			emit_zextw(rd, rd, ctx);
 			break;
 		}
+		if (is64 && insn_is_mov_percpu_addr(insn)) {
+			if (rd != rs)
+				emit_mv(rd, rs, ctx);
+#ifdef CONFIG_SMP
+			/* Load current CPU number in T1 */
+			emit_lw(RV_REG_T1, offsetof(struct thread_info, cpu),
+				RV_REG_TP, ctx);
+			/* Load address of __per_cpu_offset array in T2 */
+			ret = emit_addr(RV_REG_T2, (u64)&__per_cpu_offset,
+					extra_pass, ctx);
+			if (ret)
+				return ret;
+			/* Get address of __per_cpu_offset[cpu] in T1 */
+			emit_sh3add(RV_REG_T1, RV_REG_T1, RV_REG_T2, ctx);
+			/* Load __per_cpu_offset[cpu] in T1 */
+			emit_ld(RV_REG_T1, 0, RV_REG_T1, ctx);
+			/* Add the offset to Rd */
+			emit_add(rd, rd, RV_REG_T1, ctx);
+#endif
+			break;
+		}
 		switch (insn->off) {
 		case 0:
 			emit_mv(rd, rs, ctx);
@@ -1237,6 +1411,8 @@ int bpf_jit_emit_insn(const struct bpf_insn *insn, struct rv_jit_context *ctx,
 	case BPF_ALU64 | BPF_AND | BPF_K:
 		if (is_12b_int(imm)) {
 			emit_andi(rd, rd, imm, ctx);
+		} else if (imm == 0xffff) {
+			emit_zexth(rd, rd, ctx);
 		} else {
 			emit_imm(RV_REG_T1, imm, ctx);
 			emit_and(rd, rd, RV_REG_T1, ctx);
@@ -1361,6 +1537,9 @@ int bpf_jit_emit_insn(const struct bpf_insn *insn, struct rv_jit_context *ctx,
 	case BPF_JMP32 | BPF_JSLE | BPF_X:
 	case BPF_JMP | BPF_JSET | BPF_X:
 	case BPF_JMP32 | BPF_JSET | BPF_X:
+		if (emit_cond_mov(insn, rd, rs, is64, ctx))
+			return 1;
+
 		rvoff = rv_offset(i, off, ctx);
 		if (!is64) {
 			s = ctx->ninsns;
@@ -1408,6 +1587,9 @@ int bpf_jit_emit_insn(const struct bpf_insn *insn, struct rv_jit_context *ctx,
 	case BPF_JMP32 | BPF_JSGE | BPF_K:
 	case BPF_JMP | BPF_JSLE | BPF_K:
 	case BPF_JMP32 | BPF_JSLE | BPF_K:
+		if (emit_cond_mov(insn, rd, rs, is64, ctx))
+			return 1;
+
 		rvoff = rv_offset(i, off, ctx);
 		s = ctx->ninsns;
 		if (imm)
@@ -1432,6 +1614,9 @@ int bpf_jit_emit_insn(const struct bpf_insn *insn, struct rv_jit_context *ctx,
 
 	case BPF_JMP | BPF_JSET | BPF_K:
 	case BPF_JMP32 | BPF_JSET | BPF_K:
+		if (emit_cond_mov(insn, rd, rs, is64, ctx))
+			return 1;
+
 		rvoff = rv_offset(i, off, ctx);
 		s = ctx->ninsns;
 		if (is_12b_int(imm)) {
@@ -1457,6 +1642,19 @@ int bpf_jit_emit_insn(const struct bpf_insn *insn, struct rv_jit_context *ctx,
 		bool fixed_addr;
 		u64 addr;
 
+		/* Inline calls to bpf_get_smp_processor_id()
+		 *
+		 * RV_REG_TP holds the address of the current task_struct
+		 * and thread_info is at offset 0 in task_struct. Load the cpu
+		 * field of thread_info straight into R0.
+		 */
+		if (insn->src_reg == 0 && imm == BPF_FUNC_get_smp_processor_id) {
+			emit_lw(bpf_to_rv_reg(BPF_REG_0, ctx),
+				offsetof(struct thread_info, cpu),
+				RV_REG_TP, ctx);
+			break;
+		}
+
 		mark_call(ctx);
 		ret = bpf_jit_get_func_addr(ctx->prog, insn, extra_pass,
 					    &addr, &fixed_addr);
@@ -1823,3 +2021,18 @@ bool bpf_jit_supports_ptr_xchg(void)
 {
 	return true;
 }
+
+bool bpf_jit_supports_percpu_insn(void)
+{
+	return true;
+}
+
+bool bpf_jit_inlines_helper_call(s32 imm)
+{
+	switch (imm) {
+	case BPF_FUNC_get_smp_processor_id:
+		return true;
+	default:
+		return false;
+	}
+}
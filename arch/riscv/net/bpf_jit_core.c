@@ -26,9 +26,15 @@ static int build_body(struct rv_jit_context *ctx, bool extra_pass, int *offset)
 		int ret;
 
 		ret = bpf_jit_emit_insn(insn, ctx, extra_pass);
-		/* BPF_LD | BPF_IMM | BPF_DW: skip the next instruction. */
-		if (ret > 0)
+		/*
+		 * BPF_LD | BPF_IMM | BPF_DW, or a branch fused with the next
+		 * instruction: skip the next instruction.
+		 */
+		if (ret > 0) {
+			if (offset)
+				offset[i] = ctx->ninsns;
 			i++;
+		}
 		if (offset)
 			offset[i] = ctx->ninsns;
 		if (ret < 0)
@@ -42,6 +48,31 @@ bool bpf_jit_needs_zext(void)
 	return true;
 }
 
+/* An instruction can only be fused with its predecessor if it isn't one. */
+static void mark_jmp_targets(struct rv_jit_context *ctx)
+{
+	const struct bpf_prog *prog = ctx->prog;
+	int i, target;
+
+	for (i = 0; i < prog->len; i++) {
+		const struct bpf_insn *insn = &prog->insnsi[i];
+		u8 class = BPF_CLASS(insn->code), op = BPF_OP(insn->code);
+
+		if (class != BPF_JMP && class != BPF_JMP32)
+			continue;
+		if (op == BPF_CALL || op == BPF_EXIT || op == BPF_TAIL_CALL)
+			continue;
+
+		if (class == BPF_JMP32 && op == BPF_JA)
+			target = i + 1 + insn->imm;
+		else
+			target = i + 1 + insn->off;
+
+		if (target >= 0 && target < prog->len)
+			__set_bit(target, ctx->jmp_targets);
+	}
+}
+
 struct bpf_prog *bpf_int_jit_compile(struct bpf_prog *prog)
 {
 	unsigned int prog_size = 0, extable_size = 0;
@@ -82,10 +113,12 @@ struct bpf_prog *bpf_int_jit_compile(struct bpf_prog *prog)
 
 	ctx->prog = prog;
 	ctx->offset = kcalloc(prog->len, sizeof(int), GFP_KERNEL);
-	if (!ctx->offset) {
+	ctx->jmp_targets = bitmap_zalloc(prog->len, GFP_KERNEL);
+	if (!ctx->offset || !ctx->jmp_targets) {
 		prog = orig_prog;
 		goto out_offset;
 	}
+	mark_jmp_targets(ctx);
 
 	if (build_body(ctx, extra_pass, NULL)) {
 		prog = orig_prog;
@@ -195,6 +228,7 @@ struct bpf_prog *bpf_int_jit_compile(struct bpf_prog *prog)
 		bpf_prog_fill_jited_linfo(prog, ctx->offset);
 out_offset:
 		kfree(ctx->offset);
+		bitmap_free(ctx->jmp_targets);
 		kfree(jit_data);
 		prog->aux->jit_data = NULL;
 	}
@@ -232,12 +266,17 @@ void bpf_jit_free_exec(void *addr)
 	return vfree(addr);
 }
 
+/*
+ * Only copy here, the caller owns the icache maintenance: the JIT flushes
+ * the image once after bpf_jit_binary_pack_finalize(), so flushing here
+ * as well would cost every program load a second round of remote FENCE.I.
+ */
 void *bpf_arch_text_copy(void *dst, void *src, size_t len)
 {
 	int ret;
 
 	mutex_lock(&text_mutex);
-	ret = patch_text_nosync(dst, src, len);
+	ret = patch_insn_write(dst, src, len);
 	mutex_unlock(&text_mutex);
 
 	if (ret)
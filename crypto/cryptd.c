@@ -31,6 +31,10 @@ static unsigned int cryptd_max_cpu_qlen = 1000;
 module_param(cryptd_max_cpu_qlen, uint, 0);
 MODULE_PARM_DESC(cryptd_max_cpu_qlen, "Set cryptd Max queue depth");
 
+static unsigned int cryptd_worker_batch = 8;
+module_param(cryptd_worker_batch, uint, 0644);
+MODULE_PARM_DESC(cryptd_worker_batch, "Max requests handled per cryptd worker run");
+
 static struct workqueue_struct *cryptd_wq;
 
 struct cryptd_cpu_queue {
@@ -156,29 +160,36 @@ static int cryptd_enqueue_request(struct cryptd_queue *queue,
 	return err;
 }
 
-/* Called in workqueue context, do one real cryption work (via
- * req->complete) and reschedule itself if there are more work to
- * do. */
+/*
+ * Called in workqueue context, do up to cryptd_worker_batch real
+ * cryption works (via req->complete) and reschedule itself if there
+ * are more work to do.
+ */
 static void cryptd_queue_worker(struct work_struct *work)
 {
 	struct cryptd_cpu_queue *cpu_queue;
 	struct crypto_async_request *req, *backlog;
+	unsigned int done = 0;
 
 	cpu_queue = container_of(work, struct cryptd_cpu_queue, work);
 	/*
-	 * Only handle one request at a time to avoid hogging crypto workqueue.
+	 * Only handle a bounded number of requests at a time to avoid
+	 * hogging crypto workqueue, but don't pay for a work item round
+	 * trip per request when several submitters keep the queue full.
 	 */
-	local_bh_disable();
-	backlog = crypto_get_backlog(&cpu_queue->queue);
-	req = crypto_dequeue_request(&cpu_queue->queue);
-	local_bh_enable();
-
-	if (!req)
-		return;
-
-	if (backlog)
-		crypto_request_complete(backlog, -EINPROGRESS);
-	crypto_request_complete(req, 0);
+	do {
+		local_bh_disable();
+		backlog = crypto_get_backlog(&cpu_queue->queue);
+		req = crypto_dequeue_request(&cpu_queue->queue);
+		local_bh_enable();
+
+		if (!req)
+			return;
+
+		if (backlog)
+			crypto_request_complete(backlog, -EINPROGRESS);
+		crypto_request_complete(req, 0);
+	} while (++done < cryptd_worker_batch && !need_resched());
 
 	if (cpu_queue->queue.qlen)
 		queue_work(cryptd_wq, &cpu_queue->work);
@@ -116,8 +116,8 @@ static int scomp_acomp_comp_decomp(struct acomp_req *req, int dir)
 	void **tfm_ctx = acomp_tfm_ctx(tfm);
 	struct crypto_scomp *scomp = *tfm_ctx;
 	void **ctx = acomp_request_ctx(req);
-	struct scomp_scratch *scratch;
-	void *src, *dst;
+	struct scomp_scratch *scratch = NULL;
+	void *src = NULL, *dst = NULL;
 	unsigned int dlen;
 	int ret;
 
@@ -132,21 +132,29 @@ static int scomp_acomp_comp_decomp(struct acomp_req *req, int dir)
 
 	dlen = req->dlen;
 
-	scratch = raw_cpu_ptr(&scomp_scratch);
-	spin_lock(&scratch->lock);
-
-	if (sg_nents(req->src) == 1 && !PageHighMem(sg_page(req->src))) {
+	if (sg_nents(req->src) == 1 && !PageHighMem(sg_page(req->src)))
 		src = page_to_virt(sg_page(req->src)) + req->src->offset;
-	} else {
-		scatterwalk_map_and_copy(scratch->src, req->src, 0,
-					 req->slen, 0);
-		src = scratch->src;
-	}
 
 	if (req->dst && sg_nents(req->dst) == 1 && !PageHighMem(sg_page(req->dst)))
 		dst = page_to_virt(sg_page(req->dst)) + req->dst->offset;
-	else
-		dst = scratch->dst;
+
+	/*
+	 * Requests on single lowmem pages, which is what zswap and zram send,
+	 * don't need the scratch buffers, so don't serialize them on the
+	 * per-CPU lock or run the whole compression with preemption off.
+	 */
+	if (!src || !dst) {
+		scratch = raw_cpu_ptr(&scomp_scratch);
+		spin_lock(&scratch->lock);
+
+		if (!src) {
+			scatterwalk_map_and_copy(scratch->src, req->src, 0,
+						 req->slen, 0);
+			src = scratch->src;
+		}
+		if (!dst)
+			dst = scratch->dst;
+	}
 
 	if (dir)
 		ret = crypto_scomp_compress(scomp, src, req->slen,
@@ -165,7 +173,7 @@ static int scomp_acomp_comp_decomp(struct acomp_req *req, int dir)
 			ret = -ENOSPC;
 			goto out;
 		}
-		if (dst == scratch->dst) {
+		if (scratch && dst == scratch->dst) {
 			scatterwalk_map_and_copy(scratch->dst, req->dst, 0,
 						 req->dlen, 1);
 		} else {
@@ -178,7 +186,8 @@ static int scomp_acomp_comp_decomp(struct acomp_req *req, int dir)
 		}
 	}
 out:
-	spin_unlock(&scratch->lock);
+	if (scratch)
+		spin_unlock(&scratch->lock);
 	return ret;
 }
 
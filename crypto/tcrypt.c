@@ -70,6 +70,7 @@ static unsigned int klen;
 static char *tvmem[TVMEMSIZE];
 
 static const int block_sizes[] = { 16, 64, 128, 256, 1024, 1420, 4096, 0 };
+static const int sector_sizes[] = { 512, 4096, 0 };
 static const int aead_sizes[] = { 16, 64, 256, 512, 1024, 1420, 4096, 8192, 0 };
 
 #define XBUFSIZE 8
@@ -1057,9 +1058,10 @@ static int test_mb_acipher_cycles(struct test_mb_skcipher_data *data, int enc,
 	return ret;
 }
 
-static void test_mb_skcipher_speed(const char *algo, int enc, int secs,
-				   struct cipher_speed_template *template,
-				   unsigned int tcount, u8 *keysize, u32 num_mb)
+static void __test_mb_skcipher_speed(const char *algo, int enc, int secs,
+				     struct cipher_speed_template *template,
+				     unsigned int tcount, u8 *keysize,
+				     u32 num_mb, const int *b_sizes)
 {
 	struct test_mb_skcipher_data *data;
 	struct crypto_skcipher *tfm;
@@ -1116,7 +1118,7 @@ static void test_mb_skcipher_speed(const char *algo, int enc, int secs,
 
 	i = 0;
 	do {
-		b_size = block_sizes;
+		b_size = b_sizes;
 		do {
 			u32 bs = round_up(*b_size, crypto_skcipher_blocksize(tfm));
 
@@ -1211,6 +1213,25 @@ static void test_mb_skcipher_speed(const char *algo, int enc, int secs,
 	kfree(data);
 }
 
+static void test_mb_skcipher_speed(const char *algo, int enc, int secs,
+				   struct cipher_speed_template *template,
+				   unsigned int tcount, u8 *keysize, u32 num_mb)
+{
+	__test_mb_skcipher_speed(algo, enc, secs, template, tcount, keysize,
+				 num_mb, block_sizes);
+}
+
+/*
+ * Like test_mb_skcipher_speed(), but with disk sector sized requests only, as
+ * issued by dm-crypt and fscrypt.
+ */
+static void test_mb_sector_speed(const char *algo, int enc, int secs,
+				 u8 *keysize, u32 num_mb)
+{
+	__test_mb_skcipher_speed(algo, enc, secs, NULL, 0, keysize, num_mb,
+				 sector_sizes);
+}
+
 static inline int do_one_acipher_op(struct skcipher_request *req, int ret)
 {
 	struct crypto_wait *wait = req->base.data;
@@ -2314,6 +2335,10 @@ static int do_test(const char *alg, u32 type, u32 mask, int m, u32 num_mb)
 				generic_hash_speed_template);
 		if (mode > 300 && mode < 400) break;
 		fallthrough;
+	case 329:
+		test_hash_speed("crc32", sec, generic_hash_speed_template);
+		if (mode > 300 && mode < 400) break;
+		fallthrough;
 	case 399:
 		break;
 
@@ -2807,6 +2832,17 @@ static int do_test(const char *alg, u32 type, u32 mask, int m, u32 num_mb)
 				       speed_template_16_32, num_mb);
 		break;
 
+	case 611:
+		test_mb_sector_speed("xts(aes)", ENCRYPT, sec,
+				     speed_template_32_64, num_mb);
+		test_mb_sector_speed("xts(aes)", DECRYPT, sec,
+				     speed_template_32_64, num_mb);
+		test_mb_sector_speed("cts(cbc(aes))", ENCRYPT, sec,
+				     speed_template_16_32, num_mb);
+		test_mb_sector_speed("cts(cbc(aes))", DECRYPT, sec,
+				     speed_template_16_32, num_mb);
+		break;
+
 	}
 
 	return ret;
@@ -28,6 +28,18 @@ xor_blocks(unsigned int src_count, unsigned int bytes, void *dest, void **srcs)
 {
 	unsigned long *p1, *p2, *p3, *p4;
 
+	if (src_count > MAX_XOR_BLOCKS && active_template->do_n) {
+		active_template->do_n(bytes, dest, src_count,
+				      (const unsigned long * const *) srcs);
+		return;
+	}
+
+	while (src_count > MAX_XOR_BLOCKS) {
+		xor_blocks(MAX_XOR_BLOCKS, bytes, dest, srcs);
+		src_count -= MAX_XOR_BLOCKS;
+		srcs += MAX_XOR_BLOCKS;
+	}
+
 	p1 = (unsigned long *) srcs[0];
 	if (src_count == 1) {
 		active_template->do_2(bytes, dest, p1);
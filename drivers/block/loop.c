@@ -1091,7 +1091,13 @@ static int loop_configure(struct loop_device *lo, blk_mode_t mode,
 		goto out_unlock;
 
 	loop_update_rotational(lo);
-	loop_update_dio(lo);
+	/*
+	 * Buffered I/O caches every page twice, once for the loop device and
+	 * once for the backing file.  Use direct I/O whenever the backing
+	 * file and the block size allow it, __loop_update_dio() falls back to
+	 * buffered I/O otherwise.
+	 */
+	__loop_update_dio(lo, true);
 	loop_sysfs_init(lo);
 
 	size = get_loop_size(lo, file);
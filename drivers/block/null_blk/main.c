@@ -1485,14 +1485,23 @@ static void null_map_queues(struct blk_mq_tag_set *set)
 static int null_poll(struct blk_mq_hw_ctx *hctx, struct io_comp_batch *iob)
 {
 	struct nullb_queue *nq = hctx->driver_data;
+	bool timer = nq->dev->irqmode == NULL_IRQ_TIMER;
+	u64 now = timer ? ktime_get_ns() : 0;
+	struct request *rq, *tmp;
 	LIST_HEAD(list);
 	int nr = 0;
-	struct request *rq;
 
 	spin_lock(&nq->poll_lock);
-	list_splice_init(&nq->poll_list, &list);
-	list_for_each_entry(rq, &list, queuelist)
+	/*
+	 * completion_nsec can't change while the device is up, so the poll
+	 * list is sorted by deadline and we can stop at the first pending one.
+	 */
+	list_for_each_entry_safe(rq, tmp, &nq->poll_list, queuelist) {
+		if (timer && blk_mq_rq_to_pdu(rq)->deadline > now)
+			break;
+		list_move_tail(&rq->queuelist, &list);
 		blk_mq_set_request_complete(rq);
+	}
 	spin_unlock(&nq->poll_lock);
 
 	while (!list_empty(&list)) {
@@ -1589,6 +1598,8 @@ static blk_status_t null_queue_rq(struct blk_mq_hw_ctx *hctx,
 	blk_mq_start_request(rq);
 
 	if (is_poll) {
+		if (nq->dev->irqmode == NULL_IRQ_TIMER)
+			cmd->deadline = ktime_get_ns() + nq->dev->completion_nsec;
 		spin_lock(&nq->poll_lock);
 		list_add_tail(&rq->queuelist, &nq->poll_list);
 		spin_unlock(&nq->poll_lock);
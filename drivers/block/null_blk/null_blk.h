@@ -19,7 +19,10 @@ struct nullb_cmd {
 	blk_status_t error;
 	bool fake_timeout;
 	struct nullb_queue *nq;
-	struct hrtimer timer;
+	union {
+		struct hrtimer timer;
+		u64 deadline;		/* poll queues in timer mode */
+	};
 };
 
 struct nullb_queue {
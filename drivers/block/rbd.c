@@ -34,6 +34,7 @@
 #include <linux/ceph/cls_lock_client.h>
 #include <linux/ceph/striper.h>
 #include <linux/ceph/decode.h>
+#include <linux/backing-dev.h>
 #include <linux/fs_parser.h>
 #include <linux/bsearch.h>
 
@@ -5001,6 +5002,13 @@ static int rbd_init_disk(struct rbd_device *rbd_dev)
 	blk_queue_flag_set(QUEUE_FLAG_NONROT, q);
 	/* QUEUE_FLAG_ADD_RANDOM is off by default for blk-mq */
 
+	/*
+	 * Each read is an OSD round trip, let the readahead window of a
+	 * sequential stream grow up to a whole object.
+	 */
+	disk->bdi->ra_pages = max_t(unsigned long, disk->bdi->ra_pages,
+				    rbd_dev->layout.object_size >> PAGE_SHIFT);
+
 	if (!ceph_test_opt(rbd_dev->rbd_client->client, NOCRC))
 		blk_queue_flag_set(QUEUE_FLAG_STABLE_WRITES, q);
 
@@ -137,25 +137,44 @@ static inline struct virtio_blk_vq *get_virtio_blk_vq(struct blk_mq_hw_ctx *hctx
 	return vq;
 }
 
-static int virtblk_add_req(struct virtqueue *vq, struct virtblk_req *vbr)
-{
+/* Scatterlists describing one request to the virtqueue. */
+struct virtblk_sgs {
 	struct scatterlist out_hdr, in_hdr, *sgs[3];
+};
+
+static void virtblk_init_sgs(struct virtqueue *vq, struct virtblk_req *vbr,
+			     struct virtblk_sgs *s, struct virtqueue_buf *buf)
+{
 	unsigned int num_out = 0, num_in = 0;
 
-	sg_init_one(&out_hdr, &vbr->out_hdr, sizeof(vbr->out_hdr));
-	sgs[num_out++] = &out_hdr;
+	sg_init_one(&s->out_hdr, &vbr->out_hdr, sizeof(vbr->out_hdr));
+	s->sgs[num_out++] = &s->out_hdr;
 
 	if (vbr->sg_table.nents) {
 		if (vbr->out_hdr.type & cpu_to_virtio32(vq->vdev, VIRTIO_BLK_T_OUT))
-			sgs[num_out++] = vbr->sg_table.sgl;
+			s->sgs[num_out++] = vbr->sg_table.sgl;
 		else
-			sgs[num_out + num_in++] = vbr->sg_table.sgl;
+			s->sgs[num_out + num_in++] = vbr->sg_table.sgl;
 	}
 
-	sg_init_one(&in_hdr, &vbr->in_hdr.status, vbr->in_hdr_len);
-	sgs[num_out + num_in++] = &in_hdr;
+	sg_init_one(&s->in_hdr, &vbr->in_hdr.status, vbr->in_hdr_len);
+	s->sgs[num_out + num_in++] = &s->in_hdr;
+
+	buf->sgs = s->sgs;
+	buf->out_sgs = num_out;
+	buf->in_sgs = num_in;
+	buf->data = vbr;
+}
+
+static int virtblk_add_req(struct virtqueue *vq, struct virtblk_req *vbr)
+{
+	struct virtqueue_buf buf;
+	struct virtblk_sgs s;
+
+	virtblk_init_sgs(vq, vbr, &s, &buf);
 
-	return virtqueue_add_sgs(vq, sgs, num_out, num_in, vbr, GFP_ATOMIC);
+	return virtqueue_add_sgs(vq, buf.sgs, buf.out_sgs, buf.in_sgs, vbr,
+				 GFP_ATOMIC);
 }
 
 static int virtblk_setup_discard_write_zeroes_erase(struct request *req, bool unmap)
@@ -348,31 +367,65 @@ static inline void virtblk_request_done(struct request *req)
 	blk_mq_end_request(req, status);
 }
 
+static void virtblk_complete_batch(struct io_comp_batch *iob)
+{
+	struct request *req;
+
+	rq_list_for_each(&iob->req_list, req) {
+		virtblk_unmap_data(req, blk_mq_rq_to_pdu(req));
+		virtblk_cleanup_cmd(req);
+	}
+	blk_mq_end_request_batch(iob);
+}
+
+/*
+ * Completes all the used buffers of @vq, adding those that can be ended
+ * together to @iob. Called with the virtqueue lock held.
+ */
+static int virtblk_drain_vq(struct virtio_blk_vq *vq, struct io_comp_batch *iob)
+{
+	struct virtblk_req *vbr;
+	unsigned int len;
+	int found = 0;
+
+	while ((vbr = virtqueue_get_buf(vq->vq, &len)) != NULL) {
+		struct request *req = blk_mq_rq_from_pdu(vbr);
+
+		found++;
+		if (unlikely(blk_should_fake_timeout(req->q)))
+			continue;
+		if (!blk_mq_complete_request_remote(req) &&
+		    !blk_mq_add_to_batch(req, iob, virtblk_vbr_status(vbr),
+					 virtblk_complete_batch))
+			virtblk_request_done(req);
+	}
+
+	return found;
+}
+
 static void virtblk_done(struct virtqueue *vq)
 {
 	struct virtio_blk *vblk = vq->vdev->priv;
+	struct virtio_blk_vq *blk_vq = &vblk->vqs[vq->index];
+	DEFINE_IO_COMP_BATCH(iob);
 	bool req_done = false;
-	int qid = vq->index;
-	struct virtblk_req *vbr;
 	unsigned long flags;
-	unsigned int len;
 
-	spin_lock_irqsave(&vblk->vqs[qid].lock, flags);
+	spin_lock_irqsave(&blk_vq->lock, flags);
 	do {
 		virtqueue_disable_cb(vq);
-		while ((vbr = virtqueue_get_buf(vblk->vqs[qid].vq, &len)) != NULL) {
-			struct request *req = blk_mq_rq_from_pdu(vbr);
-
-			if (likely(!blk_should_fake_timeout(req->q)))
-				blk_mq_complete_request(req);
+		if (virtblk_drain_vq(blk_vq, &iob))
 			req_done = true;
-		}
 	} while (!virtqueue_enable_cb(vq));
 
 	/* In case queue is stopped waiting for more buffers. */
 	if (req_done)
 		blk_mq_start_stopped_hw_queues(vblk->disk->queue, true);
-	spin_unlock_irqrestore(&vblk->vqs[qid].lock, flags);
+	spin_unlock_irqrestore(&blk_vq->lock, flags);
+
+	/* End the batched requests once the virtqueue lock is dropped. */
+	if (!rq_list_empty(iob.req_list))
+		iob.complete(&iob);
 }
 
 static void virtio_commit_rqs(struct blk_mq_hw_ctx *hctx)
@@ -471,24 +524,36 @@ static bool virtblk_prep_rq_batch(struct request *req)
 	return virtblk_prep_rq(req->mq_hctx, vblk, req, vbr) == BLK_STS_OK;
 }
 
+/* Requests handed to the virtqueue at once by virtio_queue_rqs(). */
+#define VIRTBLK_ADD_BATCH	8
+
 static bool virtblk_add_req_batch(struct virtio_blk_vq *vq,
 					struct request **rqlist)
 {
+	struct virtqueue_buf bufs[VIRTBLK_ADD_BATCH];
+	struct virtblk_sgs sgs[VIRTBLK_ADD_BATCH];
+	struct request *reqs[VIRTBLK_ADD_BATCH];
 	unsigned long flags;
-	int err;
+	int i, n, added;
 	bool kick;
 
 	spin_lock_irqsave(&vq->lock, flags);
 
 	while (!rq_list_empty(*rqlist)) {
-		struct request *req = rq_list_pop(rqlist);
-		struct virtblk_req *vbr = blk_mq_rq_to_pdu(req);
+		for (n = 0; n < VIRTBLK_ADD_BATCH && !rq_list_empty(*rqlist); n++) {
+			reqs[n] = rq_list_pop(rqlist);
+			virtblk_init_sgs(vq->vq, blk_mq_rq_to_pdu(reqs[n]),
+					 &sgs[n], &bufs[n]);
+		}
 
-		err = virtblk_add_req(vq->vq, vbr);
-		if (err) {
-			virtblk_unmap_data(req, vbr);
-			virtblk_cleanup_cmd(req);
-			blk_mq_requeue_request(req, true);
+		added = max(virtqueue_add_batch(vq->vq, bufs, n, GFP_ATOMIC), 0);
+
+		for (i = added; i < n; i++) {
+			struct virtblk_req *vbr = blk_mq_rq_to_pdu(reqs[i]);
+
+			virtblk_unmap_data(reqs[i], vbr);
+			virtblk_cleanup_cmd(reqs[i]);
+			blk_mq_requeue_request(reqs[i], true);
 		}
 	}
 
@@ -1191,40 +1256,23 @@ static void virtblk_map_queues(struct blk_mq_tag_set *set)
 	}
 }
 
-static void virtblk_complete_batch(struct io_comp_batch *iob)
-{
-	struct request *req;
-
-	rq_list_for_each(&iob->req_list, req) {
-		virtblk_unmap_data(req, blk_mq_rq_to_pdu(req));
-		virtblk_cleanup_cmd(req);
-	}
-	blk_mq_end_request_batch(iob);
-}
-
+/*
+ * Polled queues are created without a callback, so the device is told not
+ * to interrupt for them and the used ring is only ever drained from here.
+ */
 static int virtblk_poll(struct blk_mq_hw_ctx *hctx, struct io_comp_batch *iob)
 {
-	struct virtio_blk *vblk = hctx->queue->queuedata;
 	struct virtio_blk_vq *vq = get_virtio_blk_vq(hctx);
-	struct virtblk_req *vbr;
 	unsigned long flags;
-	unsigned int len;
-	int found = 0;
+	int found;
 
 	spin_lock_irqsave(&vq->lock, flags);
 
-	while ((vbr = virtqueue_get_buf(vq->vq, &len)) != NULL) {
-		struct request *req = blk_mq_rq_from_pdu(vbr);
-
-		found++;
-		if (!blk_mq_complete_request_remote(req) &&
-		    !blk_mq_add_to_batch(req, iob, virtblk_vbr_status(vbr),
-						virtblk_complete_batch))
-			virtblk_request_done(req);
-	}
+	found = virtblk_drain_vq(vq, iob);
 
+	/* Each polled virtqueue backs exactly one hardware context. */
 	if (found)
-		blk_mq_start_stopped_hw_queues(vblk->disk->queue, true);
+		blk_mq_start_stopped_hw_queue(hctx, true);
 
 	spin_unlock_irqrestore(&vq->lock, flags);
 
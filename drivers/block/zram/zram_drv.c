@@ -33,6 +33,7 @@
 #include <linux/debugfs.h>
 #include <linux/cpuhotplug.h>
 #include <linux/part_stat.h>
+#include <linux/workqueue.h>
 
 #include "zram_drv.h"
 
@@ -57,18 +58,39 @@ static void zram_free_page(struct zram *zram, size_t index);
 static int zram_read_page(struct zram *zram, struct page *page, u32 index,
 			  struct bio *parent);
 
+/*
+ * With ZRAM_SEQ_SHIFT the slot lock doubles as the write side of a
+ * seqcount for zram_read_same_lockless(): LOCK is made visible before any
+ * update of the slot, as in write_seqcount_begin(), and the updates before
+ * the unlock count bump, as in write_seqcount_end().
+ */
 static int zram_slot_trylock(struct zram *zram, u32 index)
 {
-	return bit_spin_trylock(ZRAM_LOCK, &zram->table[index].flags);
+	if (!bit_spin_trylock(ZRAM_LOCK, &zram->table[index].flags))
+		return 0;
+#ifdef ZRAM_SEQ_SHIFT
+	/* Pairs with smp_rmb() in zram_read_same_lockless() */
+	smp_wmb();
+#endif
+	return 1;
 }
 
 static void zram_slot_lock(struct zram *zram, u32 index)
 {
 	bit_spin_lock(ZRAM_LOCK, &zram->table[index].flags);
+#ifdef ZRAM_SEQ_SHIFT
+	/* Pairs with smp_rmb() in zram_read_same_lockless() */
+	smp_wmb();
+#endif
 }
 
 static void zram_slot_unlock(struct zram *zram, u32 index)
 {
+#ifdef ZRAM_SEQ_SHIFT
+	/* Pairs with smp_load_acquire() in zram_read_same_lockless() */
+	smp_wmb();
+	zram->table[index].flags += BIT(ZRAM_SEQ_SHIFT);
+#endif
 	bit_spin_unlock(ZRAM_LOCK, &zram->table[index].flags);
 }
 
@@ -213,8 +235,14 @@ static bool page_same_filled(void *ptr, unsigned long *element)
 	if (val != page[last_pos])
 		return false;
 
-	for (pos = 1; pos < last_pos; pos++) {
-		if (val != page[pos])
+	/*
+	 * Compare four words per iteration and test the result once, the
+	 * loads are independent so this runs at memory bandwidth. The page
+	 * size is a multiple of four words.
+	 */
+	for (pos = 0; pos < last_pos; pos += 4) {
+		if ((page[pos] ^ val) | (page[pos + 1] ^ val) |
+		    (page[pos + 2] ^ val) | (page[pos + 3] ^ val))
 			return false;
 	}
 
@@ -1251,7 +1279,7 @@ static bool zram_meta_alloc(struct zram *zram, u64 disksize)
  */
 static void zram_free_page(struct zram *zram, size_t index)
 {
-	unsigned long handle;
+	unsigned long handle, flags;
 
 #ifdef CONFIG_ZRAM_TRACK_ENTRY_ACTIME
 	zram->table[index].ac_time = 0;
@@ -1297,8 +1325,12 @@ static void zram_free_page(struct zram *zram, size_t index)
 	atomic64_dec(&zram->stats.pages_stored);
 	zram_set_handle(zram, index, 0);
 	zram_set_obj_size(zram, index, 0);
-	WARN_ON_ONCE(zram->table[index].flags &
-		~(1UL << ZRAM_LOCK | 1UL << ZRAM_UNDER_WB));
+	flags = zram->table[index].flags;
+#ifdef ZRAM_SEQ_SHIFT
+	/* The unlock count is not a page flag */
+	flags &= GENMASK(ZRAM_SEQ_SHIFT - 1, 0);
+#endif
+	WARN_ON_ONCE(flags & ~(1UL << ZRAM_LOCK | 1UL << ZRAM_UNDER_WB));
 }
 
 /*
@@ -1350,11 +1382,51 @@ static int zram_read_from_zspool(struct zram *zram, struct page *page,
 	return ret;
 }
 
+/*
+ * Fills @page without taking the slot lock if the slot is same-filled or
+ * empty. The flags, with their unlock count, are read before and after
+ * the element, like a seqcount, and the caller falls back to the locked
+ * path if they changed or the slot was locked or holds other data.
+ */
+static bool zram_read_same_lockless(struct zram *zram, struct page *page,
+				    u32 index)
+{
+#ifdef ZRAM_SEQ_SHIFT
+	struct zram_table_entry *entry = &zram->table[index];
+	unsigned long flags, value;
+	void *mem;
+
+	/* Pairs with the release in bit_spin_unlock(). */
+	flags = smp_load_acquire(&entry->flags);
+	if (flags & (BIT(ZRAM_LOCK) | BIT(ZRAM_WB)))
+		return false;
+
+	value = READ_ONCE(entry->element);
+	if (!(flags & BIT(ZRAM_SAME)) && value)
+		return false;
+
+	/* Re-read the flags after the element, as read_seqcount_retry(). */
+	smp_rmb();
+	if (READ_ONCE(entry->flags) != flags)
+		return false;
+
+	mem = kmap_local_page(page);
+	zram_fill_page(mem, PAGE_SIZE, flags & BIT(ZRAM_SAME) ? value : 0);
+	kunmap_local(mem);
+	return true;
+#else
+	return false;
+#endif
+}
+
 static int zram_read_page(struct zram *zram, struct page *page, u32 index,
 			  struct bio *parent)
 {
 	int ret;
 
+	if (zram_read_same_lockless(zram, page, index))
+		return 0;
+
 	zram_slot_lock(zram, index);
 	if (!zram_test_flag(zram, index, ZRAM_WB)) {
 		/* Slot should be locked through out the function call */
@@ -1702,6 +1774,91 @@ static int zram_recompress(struct zram *zram, u32 index, struct page *page,
 #define RECOMPRESS_IDLE		(1 << 0)
 #define RECOMPRESS_HUGE		(1 << 1)
 
+/*
+ * Slots are recompressed in chunks of this many, which are spread over up
+ * to one worker per online CPU. Slot locks and compression streams are per
+ * slot and per CPU, so the workers do not contend with each other.
+ */
+#define RECOMPRESS_CHUNK_PAGES	256
+
+struct zram_recompress_ctl {
+	struct zram *zram;
+	unsigned long nr_pages;
+	unsigned int nr_workers;
+	u32 mode, threshold, prio, prio_max;
+	/* Set on the first error, stops all workers. */
+	int err;
+};
+
+struct zram_recompress_work {
+	struct work_struct work;
+	struct zram_recompress_ctl *ctl;
+	unsigned int id;
+};
+
+static int zram_recompress_slots(struct zram_recompress_ctl *ctl,
+				 unsigned int id)
+{
+	struct zram *zram = ctl->zram;
+	unsigned long chunk, index, end;
+	struct page *page;
+	int err = 0;
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page)
+		return -ENOMEM;
+
+	for (chunk = (unsigned long)id * RECOMPRESS_CHUNK_PAGES;
+	     chunk < ctl->nr_pages && !err;
+	     chunk += (unsigned long)ctl->nr_workers * RECOMPRESS_CHUNK_PAGES) {
+		end = min(chunk + RECOMPRESS_CHUNK_PAGES, ctl->nr_pages);
+
+		for (index = chunk; index < end && !err; index++) {
+			zram_slot_lock(zram, index);
+
+			if (!zram_allocated(zram, index))
+				goto next;
+
+			if (ctl->mode & RECOMPRESS_IDLE &&
+			    !zram_test_flag(zram, index, ZRAM_IDLE))
+				goto next;
+
+			if (ctl->mode & RECOMPRESS_HUGE &&
+			    !zram_test_flag(zram, index, ZRAM_HUGE))
+				goto next;
+
+			if (zram_test_flag(zram, index, ZRAM_WB) ||
+			    zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+			    zram_test_flag(zram, index, ZRAM_SAME) ||
+			    zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
+				goto next;
+
+			err = zram_recompress(zram, index, page, ctl->threshold,
+					      ctl->prio, ctl->prio_max);
+next:
+			zram_slot_unlock(zram, index);
+			cond_resched();
+		}
+
+		if (!err)
+			err = READ_ONCE(ctl->err);
+	}
+
+	__free_page(page);
+	return err;
+}
+
+static void zram_recompress_workfn(struct work_struct *work)
+{
+	struct zram_recompress_work *rw =
+		container_of(work, struct zram_recompress_work, work);
+	int err;
+
+	err = zram_recompress_slots(rw->ctl, rw->id);
+	if (err)
+		cmpxchg(&rw->ctl->err, 0, err);
+}
+
 static ssize_t recompress_store(struct device *dev,
 				struct device_attribute *attr,
 				const char *buf, size_t len)
@@ -1711,8 +1868,9 @@ static ssize_t recompress_store(struct device *dev,
 	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
 	char *args, *param, *val, *algo = NULL;
 	u32 mode = 0, threshold = 0;
-	unsigned long index;
-	struct page *page;
+	struct zram_recompress_work *works;
+	struct zram_recompress_ctl ctl;
+	unsigned int i;
 	ssize_t ret;
 
 	args = skip_spaces(buf);
@@ -1778,48 +1936,37 @@ static ssize_t recompress_store(struct device *dev,
 		}
 	}
 
-	page = alloc_page(GFP_KERNEL);
-	if (!page) {
-		ret = -ENOMEM;
-		goto release_init_lock;
-	}
-
-	ret = len;
-	for (index = 0; index < nr_pages; index++) {
-		int err = 0;
-
-		zram_slot_lock(zram, index);
-
-		if (!zram_allocated(zram, index))
-			goto next;
-
-		if (mode & RECOMPRESS_IDLE &&
-		    !zram_test_flag(zram, index, ZRAM_IDLE))
-			goto next;
-
-		if (mode & RECOMPRESS_HUGE &&
-		    !zram_test_flag(zram, index, ZRAM_HUGE))
-			goto next;
-
-		if (zram_test_flag(zram, index, ZRAM_WB) ||
-		    zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
-		    zram_test_flag(zram, index, ZRAM_SAME) ||
-		    zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
-			goto next;
-
-		err = zram_recompress(zram, index, page, threshold,
-				      prio, prio_max);
-next:
-		zram_slot_unlock(zram, index);
-		if (err) {
-			ret = err;
-			break;
+	ctl.zram = zram;
+	ctl.nr_pages = nr_pages;
+	ctl.mode = mode;
+	ctl.threshold = threshold;
+	ctl.prio = prio;
+	ctl.prio_max = prio_max;
+	ctl.err = 0;
+	ctl.nr_workers = min_t(unsigned long, num_online_cpus(),
+			       DIV_ROUND_UP(nr_pages, RECOMPRESS_CHUNK_PAGES));
+
+	works = NULL;
+	if (ctl.nr_workers > 1)
+		works = kcalloc(ctl.nr_workers, sizeof(*works), GFP_KERNEL);
+
+	if (!works) {
+		/* Too small to split, or no memory to: do it all here. */
+		ctl.nr_workers = 1;
+		ctl.err = zram_recompress_slots(&ctl, 0);
+	} else {
+		for (i = 0; i < ctl.nr_workers; i++) {
+			works[i].ctl = &ctl;
+			works[i].id = i;
+			INIT_WORK(&works[i].work, zram_recompress_workfn);
+			queue_work(system_unbound_wq, &works[i].work);
 		}
-
-		cond_resched();
+		for (i = 0; i < ctl.nr_workers; i++)
+			flush_work(&works[i].work);
+		kfree(works);
 	}
 
-	__free_page(page);
+	ret = ctl.err ? : len;
 
 release_init_lock:
 	up_read(&zram->init_lock);
@@ -1884,9 +2031,17 @@ static void zram_bio_read(struct zram *zram, struct bio *bio)
 		}
 		flush_dcache_page(bv.bv_page);
 
-		zram_slot_lock(zram, index);
-		zram_accessed(zram, index);
-		zram_slot_unlock(zram, index);
+		/*
+		 * Reads only need the lock to clear ZRAM_IDLE. Missing an idle
+		 * marking that races with this read is fine, it is as if the
+		 * read happened just before it.
+		 */
+		if (IS_ENABLED(CONFIG_ZRAM_TRACK_ENTRY_ACTIME) ||
+		    READ_ONCE(zram->table[index].flags) & BIT(ZRAM_IDLE)) {
+			zram_slot_lock(zram, index);
+			zram_accessed(zram, index);
+			zram_slot_unlock(zram, index);
+		}
 
 		bio_advance_iter_single(bio, &iter, bv.bv_len);
 	} while (iter.bi_size);
@@ -2396,6 +2551,9 @@ static int __init zram_init(void)
 	int ret;
 
 	BUILD_BUG_ON(__NR_ZRAM_PAGEFLAGS > BITS_PER_LONG);
+#ifdef ZRAM_SEQ_SHIFT
+	BUILD_BUG_ON(__NR_ZRAM_PAGEFLAGS > ZRAM_SEQ_SHIFT);
+#endif
 
 	ret = cpuhp_setup_state_multi(CPUHP_ZCOMP_PREPARE, "block/zram:prepare",
 				      zcomp_cpu_up_prepare, zcomp_cpu_dead);
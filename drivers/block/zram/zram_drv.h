@@ -40,6 +40,15 @@
  */
 #define ZRAM_FLAG_SHIFT (PAGE_SHIFT + 1)
 
+#ifdef CONFIG_64BIT
+/*
+ * The upper half of the flags counts the times the slot was unlocked, so
+ * that readers can check that nothing changed under them without taking
+ * the slot lock.
+ */
+#define ZRAM_SEQ_SHIFT	32
+#endif
+
 /* Only 2 bits are allowed for comp priority index */
 #define ZRAM_COMP_PRIORITY_MASK	0x3
 
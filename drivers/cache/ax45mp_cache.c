@@ -8,8 +8,12 @@
 #include <linux/cacheflush.h>
 #include <linux/cacheinfo.h>
 #include <linux/dma-direction.h>
+#include <linux/gfp.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/of_address.h>
 #include <linux/of_platform.h>
+#include <linux/sizes.h>
 
 #include <asm/dma-noncoherent.h>
 
@@ -23,6 +27,7 @@
 /* D-cache operation */
 #define AX45MP_CCTL_L1D_VA_INVAL		0 /* Invalidate an L1 cache entry */
 #define AX45MP_CCTL_L1D_VA_WB			1 /* Write-back an L1 cache entry */
+#define AX45MP_CCTL_L1D_WBINVAL_ALL		6 /* Write-back and invalidate the L1 cache */
 
 /* L2 CCTL status */
 #define AX45MP_CCTL_L2_STATUS_IDLE		0
@@ -33,6 +38,7 @@
 /* L2 cache operation */
 #define AX45MP_CCTL_L2_PA_INVAL			0x8 /* Invalidate an L2 cache entry */
 #define AX45MP_CCTL_L2_PA_WB			0x9 /* Write-back an L2 cache entry */
+#define AX45MP_CCTL_L2_WBINVAL_ALL		0x12 /* Write-back and invalidate the L2 cache */
 
 #define AX45MP_L2C_REG_PER_CORE_OFFSET		0x10
 #define AX45MP_CCTL_L2_STATUS_PER_CORE_OFFSET	4
@@ -49,6 +55,9 @@
 
 #define AX45MP_CACHE_LINE_SIZE			64
 
+/* Buffer size timed to find where the whole-cache flush gets cheaper */
+#define AX45MP_CALIBRATE_SIZE			SZ_64K
+
 struct ax45mp_priv {
 	void __iomem *l2c_base;
 	u32 ax45mp_cache_line_size;
@@ -146,6 +155,70 @@ static void ax45mp_dma_cache_wback_inv(phys_addr_t paddr, size_t size)
 	ax45mp_dma_cache_inv(paddr, size);
 }
 
+/*
+ * Same coherence assumptions as the range operations above, which also only
+ * operate on the local L1.
+ */
+static void ax45mp_dma_cache_wback_inv_all(void)
+{
+	void __iomem *base = ax45mp_priv.l2c_base;
+	unsigned long flags;
+	int mhartid;
+
+	local_irq_save(flags);
+
+	mhartid = smp_processor_id();
+	csr_write(AX45MP_CCTL_REG_UCCTLCOMMAND_NUM, AX45MP_CCTL_L1D_WBINVAL_ALL);
+	writel(AX45MP_CCTL_L2_WBINVAL_ALL,
+	       base + AX45MP_L2C_REG_CN_CMD_OFFSET(mhartid));
+	while ((ax45mp_cpu_l2c_get_cctl_status() &
+		AX45MP_CCTL_L2_STATUS_CN_MASK(mhartid)) !=
+		AX45MP_CCTL_L2_STATUS_IDLE)
+		;
+
+	local_irq_restore(flags);
+}
+
+/*
+ * How long the whole-cache flush takes depends on the L2 size and on how fast
+ * the L2 controller walks it, not on the range, so time one against the range
+ * flush of a dirty buffer and switch over where they cost the same.
+ */
+static size_t __init ax45mp_calibrate_wback_inv_all(size_t cache_size)
+{
+	unsigned int order = get_order(AX45MP_CALIBRATE_SIZE);
+	u64 range_ns, all_ns, size;
+	struct page *page;
+	ktime_t start;
+
+	page = alloc_pages(GFP_KERNEL, order);
+	if (!page)
+		return cache_size;
+
+	memset(page_address(page), 0, AX45MP_CALIBRATE_SIZE);
+	start = ktime_get();
+	ax45mp_dma_cache_wback_inv(page_to_phys(page), AX45MP_CALIBRATE_SIZE);
+	range_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	memset(page_address(page), 0, AX45MP_CALIBRATE_SIZE);
+	start = ktime_get();
+	ax45mp_dma_cache_wback_inv_all();
+	all_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	__free_pages(page, order);
+
+	if (!range_ns)
+		return cache_size;
+
+	size = div64_u64(all_ns * AX45MP_CALIBRATE_SIZE, range_ns);
+	size = clamp_t(u64, size, PAGE_SIZE, cache_size);
+
+	pr_info("ax45mp: %u KiB range flush %llu ns, full flush %llu ns, using full flush from %llu KiB\n",
+		AX45MP_CALIBRATE_SIZE / SZ_1K, range_ns, all_ns, size / SZ_1K);
+
+	return size;
+}
+
 static int ax45mp_get_l2_line_size(struct device_node *np)
 {
 	int ret;
@@ -178,8 +251,10 @@ static const struct of_device_id ax45mp_cache_ids[] = {
 
 static int __init ax45mp_cache_init(void)
 {
+	struct riscv_nonstd_cache_ops ops = ax45mp_cmo_ops;
 	struct device_node *np;
 	struct resource res;
+	u32 cache_size;
 	int ret;
 
 	np = of_find_matching_node(NULL, ax45mp_cache_ids);
@@ -210,7 +285,17 @@ static int __init ax45mp_cache_init(void)
 		return ret;
 	}
 
-	riscv_noncoherent_register_cache_ops(&ax45mp_cmo_ops);
+	/*
+	 * A range at least as large as the L2 is cheaper to handle with one
+	 * whole-cache command than with one command per line, and smaller
+	 * ones often are too.
+	 */
+	if (!of_property_read_u32(np, "cache-size", &cache_size) && cache_size) {
+		ops.wback_inv_all = &ax45mp_dma_cache_wback_inv_all;
+		ops.wback_inv_all_size = ax45mp_calibrate_wback_inv_all(cache_size);
+	}
+
+	riscv_noncoherent_register_cache_ops(&ops);
 
 	return 0;
 }
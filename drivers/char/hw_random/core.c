@@ -29,6 +29,8 @@
 #define RNG_MODULE_NAME		"hw_random"
 
 #define RNG_BUFFER_SIZE (SMP_CACHE_BYTES < 32 ? 32 : SMP_CACHE_BYTES)
+/* The fill thread collects this much before handing it to the CRNG */
+#define RNG_FILLBUF_SIZE 256
 
 static struct hwrng *current_rng;
 /* the current rng has been explicitly chosen by user via sysfs */
@@ -497,6 +499,31 @@ static int __init register_miscdev(void)
 	return misc_register(&rng_miscdev);
 }
 
+/*
+ * Many RNGs return no more than a register bank worth of data per read, so
+ * gather a batch of reads before crediting, to wake up random and the crng
+ * fewer times. The lock is dropped between reads to let /dev/hwrng readers
+ * in. Only ->read() takes a size, ->data_read() RNGs are read once.
+ */
+static long hwrng_fill_batch(struct hwrng *rng)
+{
+	size_t len = 0;
+	long rc;
+
+	do {
+		mutex_lock(&reading_mutex);
+		rc = rng_get_data(rng, rng_fillbuf + len,
+				  RNG_FILLBUF_SIZE - len, 1);
+		mutex_unlock(&reading_mutex);
+		if (rc <= 0)
+			break;
+		len += rc;
+	} while (rng->read && len < RNG_FILLBUF_SIZE &&
+		 !kthread_should_stop());
+
+	return len ? : rc;
+}
+
 static int hwrng_fillfn(void *unused)
 {
 	size_t entropy, entropy_credit = 0; /* in 1/1024 of a bit */
@@ -509,9 +536,9 @@ static int hwrng_fillfn(void *unused)
 		rng = get_current_rng();
 		if (IS_ERR(rng) || !rng)
 			break;
+		rc = hwrng_fill_batch(rng);
+
 		mutex_lock(&reading_mutex);
-		rc = rng_get_data(rng, rng_fillbuf,
-				  rng_buffer_size(), 1);
 		if (current_quality != rng->quality)
 			rng->quality = current_quality; /* obsolete */
 		quality = rng->quality;
@@ -701,7 +728,7 @@ static int __init hwrng_modinit(void)
 	if (!rng_buffer)
 		return -ENOMEM;
 
-	rng_fillbuf = kmalloc(rng_buffer_size(), GFP_KERNEL);
+	rng_fillbuf = kmalloc(RNG_FILLBUF_SIZE, GFP_KERNEL);
 	if (!rng_fillbuf) {
 		kfree(rng_buffer);
 		return -ENOMEM;
@@ -14,6 +14,7 @@
 #include <linux/clocksource.h>
 #include <linux/clockchips.h>
 #include <linux/cpu.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/irq.h>
 #include <linux/irqdomain.h>
@@ -23,6 +24,7 @@
 #include <linux/interrupt.h>
 #include <linux/of_irq.h>
 #include <linux/limits.h>
+#include <linux/seq_file.h>
 #include <clocksource/timer-riscv.h>
 #include <asm/smp.h>
 #include <asm/cpufeature.h>
@@ -32,6 +34,30 @@
 static DEFINE_STATIC_KEY_FALSE(riscv_sstc_available);
 static bool riscv_timer_cannot_wake_cpu;
 
+/*
+ * Without Sstc every timer write is an SBI call. Track what the firmware
+ * currently has armed (U64_MAX while the interrupt is masked) so identical
+ * reprograms are dropped, and count the calls that are actually made.
+ */
+struct riscv_timer_sbi_stat {
+	u64 armed;
+	unsigned long calls;
+	unsigned long skipped;
+};
+
+static DEFINE_PER_CPU(struct riscv_timer_sbi_stat, riscv_timer_sbi_stat) = {
+	.armed = U64_MAX,
+};
+
+static void riscv_timer_sbi_set(u64 stime)
+{
+	struct riscv_timer_sbi_stat *stat = this_cpu_ptr(&riscv_timer_sbi_stat);
+
+	sbi_set_timer(stime);
+	stat->armed = stime;
+	stat->calls++;
+}
+
 static void riscv_clock_event_stop(void)
 {
 	if (static_branch_likely(&riscv_sstc_available)) {
@@ -39,7 +65,24 @@ static void riscv_clock_event_stop(void)
 		if (IS_ENABLED(CONFIG_32BIT))
 			csr_write(CSR_STIMECMPH, ULONG_MAX);
 	} else {
-		sbi_set_timer(U64_MAX);
+		riscv_timer_sbi_set(U64_MAX);
+	}
+}
+
+/*
+ * Acknowledge a timer interrupt. With Sstc the compare register has to be
+ * pushed out to drop the pending bit. Through SBI that costs an ecall, and
+ * the event handler almost always reprograms the timer right away, which
+ * clears the pending bit in the firmware anyway. So only mask the timer
+ * interrupt here and unmask it again when the next event is programmed.
+ */
+static void riscv_clock_event_ack(void)
+{
+	if (static_branch_likely(&riscv_sstc_available)) {
+		riscv_clock_event_stop();
+	} else {
+		csr_clear(CSR_IE, IE_TIE);
+		this_cpu_write(riscv_timer_sbi_stat.armed, U64_MAX);
 	}
 }
 
@@ -55,8 +98,12 @@ static int riscv_clock_next_event(unsigned long delta,
 #else
 		csr_write(CSR_STIMECMP, next_tval);
 #endif
-	} else
-		sbi_set_timer(next_tval);
+	} else if (next_tval == this_cpu_read(riscv_timer_sbi_stat.armed)) {
+		this_cpu_inc(riscv_timer_sbi_stat.skipped);
+	} else {
+		riscv_timer_sbi_set(next_tval);
+		csr_set(CSR_IE, IE_TIE);
+	}
 
 	return 0;
 }
@@ -142,7 +189,7 @@ static irqreturn_t riscv_timer_interrupt(int irq, void *dev_id)
 {
 	struct clock_event_device *evdev = this_cpu_ptr(&riscv_clock_event);
 
-	riscv_clock_event_stop();
+	riscv_clock_event_ack();
 	evdev->event_handler(evdev);
 
 	return IRQ_HANDLED;
@@ -245,3 +292,33 @@ static int __init riscv_timer_acpi_init(struct acpi_table_header *table)
 TIMER_ACPI_DECLARE(aclint_mtimer, ACPI_SIG_RHCT, riscv_timer_acpi_init);
 
 #endif
+
+#ifdef CONFIG_DEBUG_FS
+static int riscv_timer_sbi_stat_show(struct seq_file *m, void *v)
+{
+	struct riscv_timer_sbi_stat *stat;
+	int cpu;
+
+	seq_puts(m, "cpu\tset_timer\tskipped\n");
+	for_each_online_cpu(cpu) {
+		stat = per_cpu_ptr(&riscv_timer_sbi_stat, cpu);
+		seq_printf(m, "%d\t%lu\t%lu\n", cpu, READ_ONCE(stat->calls),
+			   READ_ONCE(stat->skipped));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(riscv_timer_sbi_stat);
+
+static int __init riscv_timer_debugfs_init(void)
+{
+	if (static_branch_likely(&riscv_sstc_available))
+		return 0;
+
+	debugfs_create_file("riscv_timer_sbi_stat", 0400, NULL, NULL,
+			    &riscv_timer_sbi_stat_fops);
+
+	return 0;
+}
+late_initcall(riscv_timer_debugfs_init);
+#endif
@@ -13,6 +13,7 @@
 #include <linux/cpumask.h>
 #include <linux/cpu_pm.h>
 #include <linux/cpu_cooling.h>
+#include <linux/instrumentation.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/of.h>
@@ -20,6 +21,8 @@
 #include <linux/platform_device.h>
 #include <linux/pm_domain.h>
 #include <linux/pm_runtime.h>
+#include <linux/sysfs.h>
+#include <linux/timekeeping.h>
 #include <asm/cpuidle.h>
 #include <asm/sbi.h>
 #include <asm/smp.h>
@@ -28,8 +31,24 @@
 #include "dt_idle_states.h"
 #include "dt_idle_genpd.h"
 
+/*
+ * Wakeup latency observed for one idle state. A sample is the time between
+ * the expiry of the next hrtimer, which is what was meant to wake the hart
+ * up, and the hart running again after the SBI suspend call. Wakeups caused
+ * by anything else happen before that expiry and are not sampled.
+ */
+struct sbi_cpuidle_stats {
+	u64 samples;
+	u64 avg_ns;
+	u64 max_ns;
+	s64 declared_exit_latency_ns;
+	s64 declared_target_residency_ns;
+};
+
 struct sbi_cpuidle_data {
 	u32 *states;
+	struct sbi_cpuidle_stats *stats;
+	unsigned int state_count;
 	struct device *dev;
 };
 
@@ -44,6 +63,16 @@ static bool sbi_cpuidle_use_osi;
 static bool sbi_cpuidle_use_cpuhp;
 static bool sbi_cpuidle_pd_allow_domain_state;
 
+/* Samples needed before the measured latency replaces the declared one. */
+#define SBI_CPUIDLE_MIN_SAMPLES		64
+/* Longer delays are not attributable to the idle state itself. */
+#define SBI_CPUIDLE_MAX_SAMPLE_NS	(10 * NSEC_PER_MSEC)
+
+static bool adaptive_latency = true;
+module_param(adaptive_latency, bool, 0644);
+MODULE_PARM_DESC(adaptive_latency,
+		 "Replace declared exit latencies with the measured ones");
+
 static inline void sbi_set_domain_state(u32 state)
 {
 	struct sbi_domain_state *data = this_cpu_ptr(&domain_state);
@@ -73,17 +102,79 @@ static inline bool sbi_is_domain_state_available(void)
 	return data->available;
 }
 
+static void sbi_cpuidle_update_state(struct cpuidle_state *s,
+				     struct sbi_cpuidle_stats *st)
+{
+	s64 exit_ns = st->declared_exit_latency_ns;
+	s64 residency_ns = st->declared_target_residency_ns;
+
+	/*
+	 * Move the target residency along with the exit latency so that the
+	 * break-even margin the platform declared on top of it is preserved.
+	 */
+	if (adaptive_latency && st->samples >= SBI_CPUIDLE_MIN_SAMPLES) {
+		exit_ns = max_t(s64, st->avg_ns, NSEC_PER_USEC);
+		residency_ns = max(residency_ns - st->declared_exit_latency_ns +
+				   exit_ns, exit_ns);
+	}
+
+	WRITE_ONCE(s->exit_latency_ns, exit_ns);
+	WRITE_ONCE(s->exit_latency, div_u64(exit_ns, NSEC_PER_USEC));
+	WRITE_ONCE(s->target_residency_ns, residency_ns);
+	WRITE_ONCE(s->target_residency, div_u64(residency_ns, NSEC_PER_USEC));
+}
+
+static __cpuidle void sbi_cpuidle_account_wakeup(struct cpuidle_device *dev,
+						 struct cpuidle_driver *drv,
+						 int idx)
+{
+	struct sbi_cpuidle_stats *st;
+	u64 expires, now, delta;
+
+	expires = ktime_to_ns(READ_ONCE(dev->next_hrtimer));
+	if (!expires)
+		return;
+
+	instrumentation_begin();
+	now = ktime_get_mono_fast_ns();
+	if (now <= expires)
+		goto out;
+
+	delta = now - expires;
+	if (delta > SBI_CPUIDLE_MAX_SAMPLE_NS)
+		goto out;
+
+	/* Each driver, and with it drv->states, is private to this CPU. */
+	st = &__this_cpu_read(sbi_cpuidle_data.stats)[idx];
+	if (!st->samples)
+		st->avg_ns = delta;
+	else
+		st->avg_ns = st->avg_ns - (st->avg_ns >> 3) + (delta >> 3);
+	st->max_ns = max(st->max_ns, delta);
+	st->samples++;
+
+	sbi_cpuidle_update_state(&drv->states[idx], st);
+out:
+	instrumentation_end();
+}
+
 static __cpuidle int sbi_cpuidle_enter_state(struct cpuidle_device *dev,
 					     struct cpuidle_driver *drv, int idx)
 {
 	u32 *states = __this_cpu_read(sbi_cpuidle_data.states);
 	u32 state = states[idx];
+	int ret;
 
 	if (state & SBI_HSM_SUSP_NON_RET_BIT)
-		return CPU_PM_CPU_IDLE_ENTER_PARAM(riscv_sbi_hart_suspend, idx, state);
+		ret = CPU_PM_CPU_IDLE_ENTER_PARAM(riscv_sbi_hart_suspend, idx, state);
 	else
-		return CPU_PM_CPU_IDLE_ENTER_RETENTION_PARAM(riscv_sbi_hart_suspend,
-							     idx, state);
+		ret = CPU_PM_CPU_IDLE_ENTER_RETENTION_PARAM(riscv_sbi_hart_suspend,
+							    idx, state);
+
+	if (ret == idx)
+		sbi_cpuidle_account_wakeup(dev, drv, idx);
+
+	return ret;
 }
 
 static __cpuidle int __sbi_enter_domain_idle_state(struct cpuidle_device *dev,
@@ -126,6 +217,11 @@ static __cpuidle int __sbi_enter_domain_idle_state(struct cpuidle_device *dev,
 
 	/* Clear the domain state to start fresh when back from idle. */
 	sbi_clear_domain_state();
+
+	/* A domain state has its own latency, keep it out of the CPU state. */
+	if (ret == idx && !s2idle && state == states[idx])
+		sbi_cpuidle_account_wakeup(dev, drv, idx);
+
 	return ret;
 }
 
@@ -237,6 +333,7 @@ static int sbi_cpuidle_dt_init_states(struct device *dev,
 	struct sbi_cpuidle_data *data = per_cpu_ptr(&sbi_cpuidle_data, cpu);
 	struct device_node *state_node;
 	struct device_node *cpu_node;
+	struct sbi_cpuidle_stats *stats;
 	u32 *states;
 	int i, ret;
 
@@ -250,6 +347,12 @@ static int sbi_cpuidle_dt_init_states(struct device *dev,
 		goto fail;
 	}
 
+	stats = devm_kcalloc(dev, state_count, sizeof(*stats), GFP_KERNEL);
+	if (!stats) {
+		ret = -ENOMEM;
+		goto fail;
+	}
+
 	/* Parse SBI specific details from state DT nodes */
 	for (i = 1; i < state_count; i++) {
 		state_node = of_get_cpu_state_node(cpu_node, i - 1);
@@ -262,6 +365,10 @@ static int sbi_cpuidle_dt_init_states(struct device *dev,
 		if (ret)
 			return ret;
 
+		stats[i].declared_exit_latency_ns = drv->states[i].exit_latency_ns;
+		stats[i].declared_target_residency_ns =
+					drv->states[i].target_residency_ns;
+
 		pr_debug("sbi-state %#x index %d\n", states[i], i);
 	}
 	if (i != state_count) {
@@ -276,6 +383,8 @@ static int sbi_cpuidle_dt_init_states(struct device *dev,
 
 	/* Store states in the per-cpu struct. */
 	data->states = states;
+	data->stats = stats;
+	data->state_count = state_count;
 
 fail:
 	of_node_put(cpu_node);
@@ -505,6 +614,49 @@ static inline int sbi_genpd_probe(struct device_node *np)
 
 #endif
 
+static ssize_t latency_stats_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct sbi_cpuidle_data *data;
+	struct sbi_cpuidle_stats *st;
+	struct cpuidle_device *cdev;
+	struct cpuidle_driver *drv;
+	int cpu, i, len = 0;
+
+	len += sysfs_emit_at(buf, len,
+			     "cpu state samples avg_ns max_ns declared_latency_ns latency_ns residency_ns\n");
+
+	for_each_possible_cpu(cpu) {
+		data = per_cpu_ptr(&sbi_cpuidle_data, cpu);
+		cdev = per_cpu(cpuidle_devices, cpu);
+		drv = cpuidle_get_cpu_driver(cdev);
+		if (!data->stats || !drv)
+			continue;
+
+		for (i = 1; i < data->state_count; i++) {
+			st = &data->stats[i];
+			len += sysfs_emit_at(buf, len,
+					     "%d %s %llu %llu %llu %lld %lld %lld\n",
+					     cpu, drv->states[i].name,
+					     READ_ONCE(st->samples),
+					     READ_ONCE(st->avg_ns),
+					     READ_ONCE(st->max_ns),
+					     st->declared_exit_latency_ns,
+					     READ_ONCE(drv->states[i].exit_latency_ns),
+					     READ_ONCE(drv->states[i].target_residency_ns));
+		}
+	}
+
+	return len;
+}
+static DEVICE_ATTR_RO(latency_stats);
+
+static struct attribute *sbi_cpuidle_attrs[] = {
+	&dev_attr_latency_stats.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(sbi_cpuidle);
+
 static int sbi_cpuidle_probe(struct platform_device *pdev)
 {
 	int cpu, ret;
@@ -567,6 +719,7 @@ static struct platform_driver sbi_cpuidle_driver = {
 	.probe = sbi_cpuidle_probe,
 	.driver = {
 		.name = "sbi-cpuidle",
+		.dev_groups = sbi_cpuidle_groups,
 		.sync_state = sbi_cpuidle_domain_sync_state,
 	},
 };
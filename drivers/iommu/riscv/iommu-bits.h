@@ -0,0 +1,337 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Register, data structure and command layouts of the RISC-V IOMMU
+ * architecture specification, version 1.0.
+ */
+
+#ifndef _RISCV_IOMMU_BITS_H_
+#define _RISCV_IOMMU_BITS_H_
+
+#include <linux/bitfield.h>
+#include <linux/bits.h>
+#include <linux/types.h>
+
+/* Size of the register file, and of one page of the queues and tables */
+#define RISCV_IOMMU_REG_SIZE		0x1000
+#define RISCV_IOMMU_PAGE_SHIFT		12
+
+/* 5.3 Capabilities (64 bits) */
+#define RISCV_IOMMU_REG_CAPABILITIES		0x0000
+#define RISCV_IOMMU_CAPABILITIES_VERSION	GENMASK_ULL(7, 0)
+#define RISCV_IOMMU_CAPABILITIES_SV39		BIT_ULL(9)
+#define RISCV_IOMMU_CAPABILITIES_SV48		BIT_ULL(10)
+#define RISCV_IOMMU_CAPABILITIES_SV57		BIT_ULL(11)
+#define RISCV_IOMMU_CAPABILITIES_MSI_FLAT	BIT_ULL(22)
+#define RISCV_IOMMU_CAPABILITIES_AMO_HWAD	BIT_ULL(24)
+#define RISCV_IOMMU_CAPABILITIES_ATS		BIT_ULL(25)
+#define RISCV_IOMMU_CAPABILITIES_IGS		GENMASK_ULL(29, 28)
+#define RISCV_IOMMU_CAPABILITIES_PAS		GENMASK_ULL(37, 32)
+#define RISCV_IOMMU_CAPABILITIES_PD8		BIT_ULL(38)
+#define RISCV_IOMMU_CAPABILITIES_PD17		BIT_ULL(39)
+#define RISCV_IOMMU_CAPABILITIES_PD20		BIT_ULL(40)
+
+/* Interrupt generation support, capabilities.IGS */
+#define RISCV_IOMMU_CAPABILITIES_IGS_MSI	0
+#define RISCV_IOMMU_CAPABILITIES_IGS_WSI	1
+#define RISCV_IOMMU_CAPABILITIES_IGS_BOTH	2
+
+/* 5.4 Features control (32 bits) */
+#define RISCV_IOMMU_REG_FCTL		0x0008
+#define RISCV_IOMMU_FCTL_BE		BIT(0)
+#define RISCV_IOMMU_FCTL_WSI		BIT(1)
+
+/* 5.5 Device-directory-table pointer (64 bits) */
+#define RISCV_IOMMU_REG_DDTP		0x0010
+#define RISCV_IOMMU_DDTP_IOMMU_MODE	GENMASK_ULL(3, 0)
+#define RISCV_IOMMU_DDTP_BUSY		BIT_ULL(4)
+#define RISCV_IOMMU_DDTP_PPN		GENMASK_ULL(53, 10)
+
+#define RISCV_IOMMU_DDTP_IOMMU_MODE_OFF		0
+#define RISCV_IOMMU_DDTP_IOMMU_MODE_BARE	1
+#define RISCV_IOMMU_DDTP_IOMMU_MODE_1LVL	2
+#define RISCV_IOMMU_DDTP_IOMMU_MODE_2LVL	3
+#define RISCV_IOMMU_DDTP_IOMMU_MODE_3LVL	4
+
+/* 5.6 - 5.14 Command, fault and page-request queue registers */
+#define RISCV_IOMMU_REG_CQB		0x0018
+#define RISCV_IOMMU_REG_CQH		0x0020
+#define RISCV_IOMMU_REG_CQT		0x0024
+#define RISCV_IOMMU_REG_FQB		0x0028
+#define RISCV_IOMMU_REG_FQH		0x0030
+#define RISCV_IOMMU_REG_FQT		0x0034
+#define RISCV_IOMMU_REG_PQB		0x0038
+#define RISCV_IOMMU_REG_PQH		0x0040
+#define RISCV_IOMMU_REG_PQT		0x0044
+
+/* Layout shared by the three queue base registers */
+#define RISCV_IOMMU_QUEUE_LOG2SZ	GENMASK_ULL(4, 0)
+#define RISCV_IOMMU_QUEUE_PPN		GENMASK_ULL(53, 10)
+
+/* 5.15 - 5.17 Queue control and status registers (32 bits) */
+#define RISCV_IOMMU_REG_CQCSR		0x0048
+#define RISCV_IOMMU_REG_FQCSR		0x004c
+#define RISCV_IOMMU_REG_PQCSR		0x0050
+
+/* Bits common to the three queue CSRs */
+#define RISCV_IOMMU_QUEUE_ENABLE	BIT(0)
+#define RISCV_IOMMU_QUEUE_INTR_ENABLE	BIT(1)
+#define RISCV_IOMMU_QUEUE_MEM_FAULT	BIT(8)
+#define RISCV_IOMMU_QUEUE_OVERFLOW	BIT(9)
+#define RISCV_IOMMU_QUEUE_ACTIVE	BIT(16)
+#define RISCV_IOMMU_QUEUE_BUSY		BIT(17)
+
+/* Command queue specific errors */
+#define RISCV_IOMMU_CQCSR_CMD_TO	BIT(9)
+#define RISCV_IOMMU_CQCSR_CMD_ILL	BIT(10)
+#define RISCV_IOMMU_CQCSR_FENCE_W_IP	BIT(11)
+
+/* 5.18 Interrupt pending status (32 bits), write 1 to clear */
+#define RISCV_IOMMU_REG_IPSR		0x0054
+#define RISCV_IOMMU_IPSR_CIP		BIT(0)
+#define RISCV_IOMMU_IPSR_FIP		BIT(1)
+#define RISCV_IOMMU_IPSR_PMIP		BIT(2)
+#define RISCV_IOMMU_IPSR_PIP		BIT(3)
+
+/* 5.27 Interrupt cause to vector (64 bits), one nibble per cause */
+#define RISCV_IOMMU_REG_ICVEC		0x02f8
+#define RISCV_IOMMU_ICVEC_CIV		GENMASK_ULL(3, 0)
+#define RISCV_IOMMU_ICVEC_FIV		GENMASK_ULL(7, 4)
+#define RISCV_IOMMU_ICVEC_PMIV		GENMASK_ULL(11, 8)
+#define RISCV_IOMMU_ICVEC_PIV		GENMASK_ULL(15, 12)
+
+/* Interrupt causes, in ICVEC and IPSR order */
+#define RISCV_IOMMU_INTR_CQ		0
+#define RISCV_IOMMU_INTR_FQ		1
+#define RISCV_IOMMU_INTR_PM		2
+#define RISCV_IOMMU_INTR_PQ		3
+#define RISCV_IOMMU_INTR_COUNT		4
+
+/* 5.28 MSI configuration table, also the PCIe MSI-X table location */
+#define RISCV_IOMMU_REG_MSI_CONFIG	0x0300
+
+/* 2.1 Device context, 32 bytes in base format, 64 in extended format */
+struct riscv_iommu_dc {
+	u64 tc;
+	u64 iohgatp;
+	u64 ta;
+	u64 fsc;
+	u64 msiptp;
+	u64 msi_addr_mask;
+	u64 msi_addr_pattern;
+	u64 _reserved;
+};
+
+#define RISCV_IOMMU_DC_TC_V		BIT_ULL(0)
+#define RISCV_IOMMU_DC_TC_EN_ATS	BIT_ULL(1)
+#define RISCV_IOMMU_DC_TC_EN_PRI	BIT_ULL(2)
+#define RISCV_IOMMU_DC_TC_PDTV		BIT_ULL(5)
+#define RISCV_IOMMU_DC_TC_PRPR		BIT_ULL(6)
+#define RISCV_IOMMU_DC_TC_SADE		BIT_ULL(8)
+#define RISCV_IOMMU_DC_TC_DPE		BIT_ULL(9)
+
+#define RISCV_IOMMU_DC_TA_PSCID		GENMASK_ULL(31, 12)
+
+#define RISCV_IOMMU_DC_FSC_PPN		GENMASK_ULL(43, 0)
+#define RISCV_IOMMU_DC_FSC_MODE		GENMASK_ULL(63, 60)
+
+/* DC.fsc.MODE when DC.tc.PDTV is set */
+#define RISCV_IOMMU_DC_FSC_PDTP_MODE_BARE	0
+#define RISCV_IOMMU_DC_FSC_PDTP_MODE_PD8	1
+#define RISCV_IOMMU_DC_FSC_PDTP_MODE_PD17	2
+#define RISCV_IOMMU_DC_FSC_PDTP_MODE_PD20	3
+
+/* First-stage iosatp.MODE, same encoding as the satp CSR on RV64 */
+#define RISCV_IOMMU_IOSATP_MODE_BARE	0
+#define RISCV_IOMMU_IOSATP_MODE_SV39	8
+#define RISCV_IOMMU_IOSATP_MODE_SV48	9
+#define RISCV_IOMMU_IOSATP_MODE_SV57	10
+
+/* Non-leaf device-directory and process-directory table entries */
+#define RISCV_IOMMU_DDTE_V		BIT_ULL(0)
+#define RISCV_IOMMU_DDTE_PPN		GENMASK_ULL(53, 10)
+#define RISCV_IOMMU_PDTE_V		BIT_ULL(0)
+#define RISCV_IOMMU_PDTE_PPN		GENMASK_ULL(53, 10)
+
+/* 2.2 Process context, 16 bytes */
+struct riscv_iommu_pc {
+	u64 ta;
+	u64 fsc;
+};
+
+#define RISCV_IOMMU_PC_TA_V		BIT_ULL(0)
+#define RISCV_IOMMU_PC_TA_ENS		BIT_ULL(1)
+#define RISCV_IOMMU_PC_TA_SUM		BIT_ULL(2)
+#define RISCV_IOMMU_PC_TA_PSCID		GENMASK_ULL(31, 12)
+
+#define RISCV_IOMMU_PC_FSC_PPN		GENMASK_ULL(43, 0)
+#define RISCV_IOMMU_PC_FSC_MODE		GENMASK_ULL(63, 60)
+
+/* 3.1 Commands, 16 bytes */
+struct riscv_iommu_command {
+	u64 dword0;
+	u64 dword1;
+};
+
+#define RISCV_IOMMU_CMD_OPCODE		GENMASK_ULL(6, 0)
+#define RISCV_IOMMU_CMD_FUNC		GENMASK_ULL(9, 7)
+
+#define RISCV_IOMMU_CMD_IOTINVAL_OPCODE		1
+#define RISCV_IOMMU_CMD_IOTINVAL_FUNC_VMA	0
+#define RISCV_IOMMU_CMD_IOTINVAL_FUNC_GVMA	1
+#define RISCV_IOMMU_CMD_IOTINVAL_AV		BIT_ULL(10)
+#define RISCV_IOMMU_CMD_IOTINVAL_PSCID		GENMASK_ULL(31, 12)
+#define RISCV_IOMMU_CMD_IOTINVAL_PSCV		BIT_ULL(32)
+#define RISCV_IOMMU_CMD_IOTINVAL_ADDR		GENMASK_ULL(61, 10)
+
+#define RISCV_IOMMU_CMD_IOFENCE_OPCODE		2
+#define RISCV_IOMMU_CMD_IOFENCE_FUNC_C		0
+#define RISCV_IOMMU_CMD_IOFENCE_AV		BIT_ULL(10)
+#define RISCV_IOMMU_CMD_IOFENCE_WSI		BIT_ULL(11)
+#define RISCV_IOMMU_CMD_IOFENCE_PR		BIT_ULL(12)
+#define RISCV_IOMMU_CMD_IOFENCE_PW		BIT_ULL(13)
+
+#define RISCV_IOMMU_CMD_IODIR_OPCODE		3
+#define RISCV_IOMMU_CMD_IODIR_FUNC_INVAL_DDT	0
+#define RISCV_IOMMU_CMD_IODIR_FUNC_INVAL_PDT	1
+#define RISCV_IOMMU_CMD_IODIR_PID		GENMASK_ULL(31, 12)
+#define RISCV_IOMMU_CMD_IODIR_DV		BIT_ULL(33)
+#define RISCV_IOMMU_CMD_IODIR_DID		GENMASK_ULL(63, 40)
+
+#define RISCV_IOMMU_CMD_ATS_OPCODE		4
+#define RISCV_IOMMU_CMD_ATS_FUNC_INVAL		0
+#define RISCV_IOMMU_CMD_ATS_FUNC_PRGR		1
+#define RISCV_IOMMU_CMD_ATS_PID			GENMASK_ULL(31, 12)
+#define RISCV_IOMMU_CMD_ATS_PV			BIT_ULL(32)
+#define RISCV_IOMMU_CMD_ATS_DSV			BIT_ULL(33)
+#define RISCV_IOMMU_CMD_ATS_RID			GENMASK_ULL(55, 40)
+#define RISCV_IOMMU_CMD_ATS_DSEG		GENMASK_ULL(63, 56)
+
+/* ATS.INVAL payload: PCIe Invalidate Request message body */
+#define RISCV_IOMMU_CMD_ATS_INVAL_G		BIT_ULL(0)
+#define RISCV_IOMMU_CMD_ATS_INVAL_S		BIT_ULL(11)
+#define RISCV_IOMMU_CMD_ATS_INVAL_ADDR		GENMASK_ULL(63, 12)
+/* S set with every address bit but the top one: the whole address space */
+#define RISCV_IOMMU_CMD_ATS_INVAL_ALL		GENMASK_ULL(62, 11)
+
+/* ATS.PRGR payload: PCIe Page Request Group Response message body */
+#define RISCV_IOMMU_CMD_ATS_PRGR_PRG_INDEX	GENMASK_ULL(40, 32)
+#define RISCV_IOMMU_CMD_ATS_PRGR_RESP_CODE	GENMASK_ULL(47, 44)
+#define RISCV_IOMMU_CMD_ATS_PRGR_DST_ID		GENMASK_ULL(63, 48)
+
+#define RISCV_IOMMU_CMD_ATS_PRGR_RESP_SUCCESS	0x0
+#define RISCV_IOMMU_CMD_ATS_PRGR_RESP_INVALID	0x1
+#define RISCV_IOMMU_CMD_ATS_PRGR_RESP_FAILURE	0xf
+
+/* 4.1 Fault queue record, 32 bytes */
+struct riscv_iommu_fq_record {
+	u64 hdr;
+	u64 _reserved;
+	u64 iotval;
+	u64 iotval2;
+};
+
+#define RISCV_IOMMU_FQ_HDR_CAUSE	GENMASK_ULL(11, 0)
+#define RISCV_IOMMU_FQ_HDR_PID		GENMASK_ULL(31, 12)
+#define RISCV_IOMMU_FQ_HDR_PV		BIT_ULL(32)
+#define RISCV_IOMMU_FQ_HDR_PRIV		BIT_ULL(33)
+#define RISCV_IOMMU_FQ_HDR_TTYP		GENMASK_ULL(39, 34)
+#define RISCV_IOMMU_FQ_HDR_DID		GENMASK_ULL(63, 40)
+
+/* 4.2 Page request queue record, 16 bytes */
+struct riscv_iommu_pq_record {
+	u64 hdr;
+	u64 payload;
+};
+
+#define RISCV_IOMMU_PQ_HDR_PID		GENMASK_ULL(31, 12)
+#define RISCV_IOMMU_PQ_HDR_PV		BIT_ULL(32)
+#define RISCV_IOMMU_PQ_HDR_PRIV		BIT_ULL(33)
+#define RISCV_IOMMU_PQ_HDR_EXEC		BIT_ULL(34)
+#define RISCV_IOMMU_PQ_HDR_DID		GENMASK_ULL(63, 40)
+
+#define RISCV_IOMMU_PQ_PAYLOAD_R	BIT_ULL(0)
+#define RISCV_IOMMU_PQ_PAYLOAD_W	BIT_ULL(1)
+#define RISCV_IOMMU_PQ_PAYLOAD_L	BIT_ULL(2)
+#define RISCV_IOMMU_PQ_PAYLOAD_PRGI	GENMASK_ULL(11, 3)
+#define RISCV_IOMMU_PQ_PAYLOAD_ADDR	GENMASK_ULL(63, 12)
+
+/* Command builders */
+
+static inline void riscv_iommu_cmd_inval_vma(struct riscv_iommu_command *cmd)
+{
+	cmd->dword0 = FIELD_PREP(RISCV_IOMMU_CMD_OPCODE, RISCV_IOMMU_CMD_IOTINVAL_OPCODE) |
+		      FIELD_PREP(RISCV_IOMMU_CMD_FUNC, RISCV_IOMMU_CMD_IOTINVAL_FUNC_VMA);
+	cmd->dword1 = 0;
+}
+
+static inline void riscv_iommu_cmd_inval_set_addr(struct riscv_iommu_command *cmd,
+						  u64 addr)
+{
+	cmd->dword1 = FIELD_PREP(RISCV_IOMMU_CMD_IOTINVAL_ADDR,
+				 addr >> RISCV_IOMMU_PAGE_SHIFT);
+	cmd->dword0 |= RISCV_IOMMU_CMD_IOTINVAL_AV;
+}
+
+static inline void riscv_iommu_cmd_inval_set_pscid(struct riscv_iommu_command *cmd,
+						   int pscid)
+{
+	cmd->dword0 |= FIELD_PREP(RISCV_IOMMU_CMD_IOTINVAL_PSCID, pscid) |
+		       RISCV_IOMMU_CMD_IOTINVAL_PSCV;
+}
+
+static inline void riscv_iommu_cmd_iofence(struct riscv_iommu_command *cmd)
+{
+	cmd->dword0 = FIELD_PREP(RISCV_IOMMU_CMD_OPCODE, RISCV_IOMMU_CMD_IOFENCE_OPCODE) |
+		      FIELD_PREP(RISCV_IOMMU_CMD_FUNC, RISCV_IOMMU_CMD_IOFENCE_FUNC_C) |
+		      RISCV_IOMMU_CMD_IOFENCE_PR | RISCV_IOMMU_CMD_IOFENCE_PW;
+	cmd->dword1 = 0;
+}
+
+static inline void riscv_iommu_cmd_iodir_inval_ddt(struct riscv_iommu_command *cmd)
+{
+	cmd->dword0 = FIELD_PREP(RISCV_IOMMU_CMD_OPCODE, RISCV_IOMMU_CMD_IODIR_OPCODE) |
+		      FIELD_PREP(RISCV_IOMMU_CMD_FUNC, RISCV_IOMMU_CMD_IODIR_FUNC_INVAL_DDT);
+	cmd->dword1 = 0;
+}
+
+static inline void riscv_iommu_cmd_iodir_inval_pdt(struct riscv_iommu_command *cmd)
+{
+	cmd->dword0 = FIELD_PREP(RISCV_IOMMU_CMD_OPCODE, RISCV_IOMMU_CMD_IODIR_OPCODE) |
+		      FIELD_PREP(RISCV_IOMMU_CMD_FUNC, RISCV_IOMMU_CMD_IODIR_FUNC_INVAL_PDT);
+	cmd->dword1 = 0;
+}
+
+static inline void riscv_iommu_cmd_iodir_set_did(struct riscv_iommu_command *cmd,
+						 unsigned int devid)
+{
+	cmd->dword0 |= FIELD_PREP(RISCV_IOMMU_CMD_IODIR_DID, devid) |
+		       RISCV_IOMMU_CMD_IODIR_DV;
+}
+
+static inline void riscv_iommu_cmd_iodir_set_pid(struct riscv_iommu_command *cmd,
+						 unsigned int pasid)
+{
+	cmd->dword0 |= FIELD_PREP(RISCV_IOMMU_CMD_IODIR_PID, pasid);
+}
+
+/* ATS commands address the device by its 16-bit RID and 8-bit segment. */
+static inline void riscv_iommu_cmd_ats(struct riscv_iommu_command *cmd,
+				       unsigned int func, unsigned int devid)
+{
+	cmd->dword0 = FIELD_PREP(RISCV_IOMMU_CMD_OPCODE, RISCV_IOMMU_CMD_ATS_OPCODE) |
+		      FIELD_PREP(RISCV_IOMMU_CMD_FUNC, func) |
+		      FIELD_PREP(RISCV_IOMMU_CMD_ATS_RID, devid & 0xffff);
+	if (devid >> 16)
+		cmd->dword0 |= FIELD_PREP(RISCV_IOMMU_CMD_ATS_DSEG, devid >> 16) |
+			       RISCV_IOMMU_CMD_ATS_DSV;
+	cmd->dword1 = 0;
+}
+
+static inline void riscv_iommu_cmd_ats_set_pid(struct riscv_iommu_command *cmd,
+					       unsigned int pasid)
+{
+	cmd->dword0 |= FIELD_PREP(RISCV_IOMMU_CMD_ATS_PID, pasid) |
+		       RISCV_IOMMU_CMD_ATS_PV;
+}
+
+#endif /* _RISCV_IOMMU_BITS_H_ */
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * RISC-V IOMMU as a platform device, with wired interrupts.
+ */
+
+#include <linux/bitfield.h>
+#include <linux/mod_devicetable.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+
+#include "iommu.h"
+
+static int riscv_iommu_platform_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct riscv_iommu_device *iommu;
+	struct resource *res;
+	int irq, vec;
+
+	iommu = devm_kzalloc(dev, sizeof(*iommu), GFP_KERNEL);
+	if (!iommu)
+		return -ENOMEM;
+
+	iommu->dev = dev;
+	iommu->reg = devm_platform_get_and_ioremap_resource(pdev, 0, &res);
+	if (IS_ERR(iommu->reg))
+		return dev_err_probe(dev, PTR_ERR(iommu->reg),
+				     "could not map register region\n");
+
+	dev_set_drvdata(dev, iommu);
+
+	iommu->caps = riscv_iommu_readq(iommu, RISCV_IOMMU_REG_CAPABILITIES);
+	iommu->fctl = riscv_iommu_readl(iommu, RISCV_IOMMU_REG_FCTL);
+
+	/* Platform MSIs are not supported, the IOMMU must signal by wire. */
+	if (FIELD_GET(RISCV_IOMMU_CAPABILITIES_IGS, iommu->caps) ==
+	    RISCV_IOMMU_CAPABILITIES_IGS_MSI)
+		return dev_err_probe(dev, -ENODEV, "no wired interrupt support\n");
+	iommu->fctl |= RISCV_IOMMU_FCTL_WSI;
+
+	iommu->irqs_count = platform_irq_count(pdev);
+	if (!iommu->irqs_count)
+		return dev_err_probe(dev, -ENODEV, "no interrupt lines\n");
+	if (iommu->irqs_count > RISCV_IOMMU_INTR_COUNT)
+		iommu->irqs_count = RISCV_IOMMU_INTR_COUNT;
+
+	for (vec = 0; vec < iommu->irqs_count; vec++) {
+		irq = platform_get_irq(pdev, vec);
+		if (irq < 0)
+			return irq;
+		iommu->irqs[vec] = irq;
+	}
+
+	return riscv_iommu_init(iommu);
+}
+
+static void riscv_iommu_platform_remove(struct platform_device *pdev)
+{
+	riscv_iommu_remove(dev_get_drvdata(&pdev->dev));
+}
+
+static const struct of_device_id riscv_iommu_of_match[] = {
+	{ .compatible = "riscv,iommu", },
+	{},
+};
+
+static struct platform_driver riscv_iommu_platform_driver = {
+	.probe = riscv_iommu_platform_probe,
+	.remove_new = riscv_iommu_platform_remove,
+	.driver = {
+		.name = "riscv,iommu",
+		.of_match_table = riscv_iommu_of_match,
+		.suppress_bind_attrs = true,
+	},
+};
+
+builtin_platform_driver(riscv_iommu_platform_driver);
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Shared virtual addressing for RISC-V IOMMU implementations.
+ *
+ * The first-stage table format is the CPU one, so the process context of
+ * a PASID points straight at the mm page tables. An mmu_notifier forwards
+ * the CPU TLB invalidations to the IOTLBs and address translation caches.
+ */
+
+#include <linux/bitfield.h>
+#include <linux/mm.h>
+#include <linux/mmu_context.h>
+#include <linux/mmu_notifier.h>
+#include <linux/mutex.h>
+#include <linux/rculist.h>
+#include <linux/slab.h>
+
+#include "iommu.h"
+
+/* Serialises notifier registration with attach and detach. */
+static DEFINE_MUTEX(riscv_iommu_sva_lock);
+
+static void riscv_iommu_mm_invalidate(struct mmu_notifier *mn,
+				      struct mm_struct *mm,
+				      unsigned long start, unsigned long end)
+{
+	struct riscv_iommu_domain *domain =
+		container_of(mn, struct riscv_iommu_domain, mn);
+
+	/* The notifier range is exclusive of end, the invalidation inclusive. */
+	riscv_iommu_iotlb_inval(domain, start, end - 1, PAGE_SIZE);
+}
+
+static void riscv_iommu_mm_release(struct mmu_notifier *mn,
+				   struct mm_struct *mm)
+{
+	struct riscv_iommu_domain *domain =
+		container_of(mn, struct riscv_iommu_domain, mn);
+	struct riscv_iommu_bond *bond;
+
+	/*
+	 * The page tables are about to go. Block DMA of the bound devices
+	 * until their drivers unbind, any access now raises a fault rather
+	 * than a translation from freed tables.
+	 */
+	mutex_lock(&riscv_iommu_sva_lock);
+	list_for_each_entry(bond, &domain->bonds, list)
+		riscv_iommu_pc_update(bond->dev, bond->pasid, 0, 0);
+	mutex_unlock(&riscv_iommu_sva_lock);
+
+	riscv_iommu_iotlb_inval(domain, 0, ULONG_MAX, PAGE_SIZE);
+}
+
+static const struct mmu_notifier_ops riscv_iommu_mmu_notifier_ops = {
+	.arch_invalidate_secondary_tlbs	= riscv_iommu_mm_invalidate,
+	.release			= riscv_iommu_mm_release,
+};
+
+static int riscv_iommu_sva_set_dev_pasid(struct iommu_domain *iommu_domain,
+					 struct device *dev, ioasid_t pasid)
+{
+	struct riscv_iommu_domain *domain = iommu_domain_to_riscv(iommu_domain);
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+	struct mm_struct *mm = iommu_domain->mm;
+	u64 fsc, ta;
+	int ret;
+
+	if (!info->sva_enabled || pasid == IOMMU_NO_PASID)
+		return -EINVAL;
+	if (!riscv_iommu_pgd_mode_supported(info->iommu, domain->pgd_mode))
+		return -ENODEV;
+
+	mutex_lock(&riscv_iommu_sva_lock);
+	if (!domain->mn.ops) {
+		domain->mn.ops = &riscv_iommu_mmu_notifier_ops;
+		ret = mmu_notifier_register(&domain->mn, mm);
+		if (ret) {
+			domain->mn.ops = NULL;
+			goto out_unlock;
+		}
+	}
+
+	ret = riscv_iommu_bond_link(domain, dev, pasid);
+	if (ret)
+		goto out_unlock;
+
+	fsc = FIELD_PREP(RISCV_IOMMU_PC_FSC_MODE, domain->pgd_mode) |
+	      FIELD_PREP(RISCV_IOMMU_PC_FSC_PPN, virt_to_pfn(mm->pgd));
+	ta = FIELD_PREP(RISCV_IOMMU_PC_TA_PSCID, domain->pscid) |
+	     RISCV_IOMMU_PC_TA_V;
+	ret = riscv_iommu_pc_update(dev, pasid, fsc, ta);
+	if (ret)
+		riscv_iommu_bond_unlink(domain, dev, pasid);
+
+out_unlock:
+	mutex_unlock(&riscv_iommu_sva_lock);
+	return ret;
+}
+
+void riscv_iommu_sva_remove_dev_pasid(struct iommu_domain *iommu_domain,
+				      struct device *dev, ioasid_t pasid)
+{
+	struct riscv_iommu_domain *domain = iommu_domain_to_riscv(iommu_domain);
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+
+	mutex_lock(&riscv_iommu_sva_lock);
+	riscv_iommu_pc_update(dev, pasid, 0, 0);
+	riscv_iommu_bond_unlink(domain, dev, pasid);
+	mutex_unlock(&riscv_iommu_sva_lock);
+
+	/* Page requests already queued for the PASID must not outlive it. */
+	if (info->pri_enabled)
+		iopf_queue_flush_dev(dev);
+}
+
+static void riscv_iommu_sva_domain_free(struct iommu_domain *iommu_domain)
+{
+	struct riscv_iommu_domain *domain = iommu_domain_to_riscv(iommu_domain);
+
+	WARN_ON(!list_empty(&domain->bonds));
+
+	/* Waits for the notifier callbacks, the PSCID is unused after. */
+	if (domain->mn.ops)
+		mmu_notifier_unregister(&domain->mn, iommu_domain->mm);
+
+	riscv_iommu_free_pscid(domain->pscid);
+	kfree(domain);
+}
+
+static const struct iommu_domain_ops riscv_iommu_sva_domain_ops = {
+	.set_dev_pasid		= riscv_iommu_sva_set_dev_pasid,
+	.free			= riscv_iommu_sva_domain_free,
+};
+
+struct iommu_domain *riscv_iommu_sva_domain_alloc(void)
+{
+	struct riscv_iommu_domain *domain;
+
+	domain = kzalloc(sizeof(*domain), GFP_KERNEL);
+	if (!domain)
+		return ERR_PTR(-ENOMEM);
+
+	INIT_LIST_HEAD(&domain->bonds);
+	spin_lock_init(&domain->lock);
+	domain->numa_node = NUMA_NO_NODE;
+	domain->pgd_mode = satp_mode >> SATP_MODE_SHIFT;
+	domain->pscid = riscv_iommu_alloc_pscid();
+	if (domain->pscid < 0) {
+		kfree(domain);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	domain->domain.ops = &riscv_iommu_sva_domain_ops;
+
+	return &domain->domain;
+}
+
+/* Sharing CPU page tables needs their format and hardware A/D updates. */
+bool riscv_iommu_sva_supported(struct riscv_iommu_device *iommu)
+{
+	return iommu->iopf &&
+	       (iommu->caps & RISCV_IOMMU_CAPABILITIES_AMO_HWAD) &&
+	       riscv_iommu_pgd_mode_supported(iommu, satp_mode >> SATP_MODE_SHIFT);
+}
@@ -0,0 +1,1873 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * IOMMU API for RISC-V IOMMU implementations.
+ *
+ * Devices are described by device contexts in a one to three level device
+ * directory. PCIe functions that support PASIDs get a process directory,
+ * whose context 0 holds the translation for requests without a PASID and
+ * the others the shared address spaces. Paging domains use the first-stage
+ * Sv39/Sv48/Sv57 page table format, which is also the CPU one, so that SVA
+ * domains point the IOMMU at the process page tables directly.
+ */
+
+#include <linux/bitfield.h>
+#include <linux/compiler.h>
+#include <linux/delay.h>
+#include <linux/dma-map-ops.h>
+#include <linux/dma-mapping.h>
+#include <linux/idr.h>
+#include <linux/interrupt.h>
+#include <linux/iopoll.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/pci.h>
+#include <linux/pci-ats.h>
+#include <linux/rculist.h>
+#include <linux/slab.h>
+
+#include "iommu.h"
+
+/* Timeouts in microseconds */
+#define RISCV_IOMMU_QUEUE_TIMEOUT	USEC_PER_SEC
+#define RISCV_IOMMU_DDTP_TIMEOUT	(10 * USEC_PER_MSEC)
+
+/* Queue CSR error bits, write 1 to clear */
+#define RISCV_IOMMU_CQCSR_ERRORS	(RISCV_IOMMU_QUEUE_MEM_FAULT | \
+					 RISCV_IOMMU_CQCSR_CMD_TO | \
+					 RISCV_IOMMU_CQCSR_CMD_ILL | \
+					 RISCV_IOMMU_CQCSR_FENCE_W_IP)
+#define RISCV_IOMMU_QUEUE_ERRORS	(RISCV_IOMMU_QUEUE_MEM_FAULT | \
+					 RISCV_IOMMU_QUEUE_OVERFLOW)
+
+/*
+ * Above this many IOTINVAL.VMA commands for one range, invalidate the
+ * whole address space of the domain instead.
+ */
+#define RISCV_IOMMU_IOTLB_INVAL_LIMIT	512
+
+/* Outstanding page requests granted to a PRI capable function. */
+#define RISCV_IOMMU_PRI_REQUESTS	32
+
+#define RISCV_IOMMU_MAX_PSCID		(BIT(20) - 1)
+
+static DEFINE_IDA(riscv_iommu_pscids);
+
+int riscv_iommu_alloc_pscid(void)
+{
+	return ida_alloc_range(&riscv_iommu_pscids, 1, RISCV_IOMMU_MAX_PSCID,
+			       GFP_KERNEL);
+}
+
+void riscv_iommu_free_pscid(int pscid)
+{
+	ida_free(&riscv_iommu_pscids, pscid);
+}
+
+/* Queue management, shared by the command, fault and page-request queues */
+
+static void riscv_iommu_queue_init(struct riscv_iommu_device *iommu,
+				   struct riscv_iommu_queue *queue,
+				   unsigned int qid, unsigned int qbr,
+				   unsigned int qcr, size_t entry_size)
+{
+	queue->iommu = iommu;
+	queue->qid = qid;
+	queue->qbr = qbr;
+	queue->qhr = qbr + 8;
+	queue->qtr = qbr + 12;
+	queue->qcr = qcr;
+	queue->entry_size = entry_size;
+	spin_lock_init(&queue->lock);
+}
+
+static int riscv_iommu_queue_alloc(struct riscv_iommu_device *iommu,
+				   struct riscv_iommu_queue *queue,
+				   unsigned int log2sz)
+{
+	size_t size;
+	u64 qb;
+
+	/* The size field is WARL, use whatever the hardware kept. */
+	riscv_iommu_writeq(iommu, queue->qbr,
+			   FIELD_PREP(RISCV_IOMMU_QUEUE_LOG2SZ, log2sz - 1));
+	qb = riscv_iommu_readq(iommu, queue->qbr);
+	log2sz = FIELD_GET(RISCV_IOMMU_QUEUE_LOG2SZ, qb) + 1;
+
+	/* Queues are at least 4K, and naturally aligned above that. */
+	size = max_t(size_t, queue->entry_size << log2sz, SZ_4K);
+	queue->base = dmam_alloc_coherent(iommu->dev, size, &queue->phys,
+					  GFP_KERNEL);
+	if (!queue->base)
+		return -ENOMEM;
+
+	queue->mask = BIT(log2sz) - 1;
+	queue->head = 0;
+	queue->tail = 0;
+
+	qb = FIELD_PREP(RISCV_IOMMU_QUEUE_LOG2SZ, log2sz - 1) |
+	     FIELD_PREP(RISCV_IOMMU_QUEUE_PPN,
+			queue->phys >> RISCV_IOMMU_PAGE_SHIFT);
+	riscv_iommu_writeq(iommu, queue->qbr, qb);
+	if (riscv_iommu_readq(iommu, queue->qbr) != qb) {
+		dev_err(iommu->dev, "queue %u base not accepted\n", queue->qid);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+static irqreturn_t riscv_iommu_queue_irq(int irq, void *data)
+{
+	struct riscv_iommu_queue *queue = data;
+
+	if (riscv_iommu_readl(queue->iommu, RISCV_IOMMU_REG_IPSR) & BIT(queue->qid))
+		return IRQ_WAKE_THREAD;
+
+	return IRQ_NONE;
+}
+
+static int riscv_iommu_queue_enable(struct riscv_iommu_device *iommu,
+				    struct riscv_iommu_queue *queue,
+				    irq_handler_t thread_fn)
+{
+	unsigned int vec = (iommu->icvec >> (4 * queue->qid)) & 0xf;
+	u32 errs, csr;
+	int ret;
+
+	if (vec >= iommu->irqs_count)
+		return -ENODEV;
+
+	ret = request_threaded_irq(iommu->irqs[vec], riscv_iommu_queue_irq,
+				   thread_fn, IRQF_ONESHOT | IRQF_SHARED,
+				   dev_name(iommu->dev), queue);
+	if (ret) {
+		dev_err(iommu->dev, "failed to request irq %u for queue %u\n",
+			iommu->irqs[vec], queue->qid);
+		return ret;
+	}
+	queue->irq = iommu->irqs[vec];
+
+	/* The driver owns the tail of the command queue, the head of others. */
+	if (queue->qid == RISCV_IOMMU_INTR_CQ) {
+		riscv_iommu_writel(iommu, queue->qtr, 0);
+		errs = RISCV_IOMMU_CQCSR_ERRORS;
+	} else {
+		riscv_iommu_writel(iommu, queue->qhr, 0);
+		errs = RISCV_IOMMU_QUEUE_ERRORS;
+	}
+
+	riscv_iommu_writel(iommu, queue->qcr, RISCV_IOMMU_QUEUE_ENABLE |
+			   RISCV_IOMMU_QUEUE_INTR_ENABLE | errs);
+	ret = riscv_iommu_readl_timeout(iommu, queue->qcr, csr,
+					!(csr & RISCV_IOMMU_QUEUE_BUSY),
+					10, RISCV_IOMMU_QUEUE_TIMEOUT);
+	if (ret || !(csr & RISCV_IOMMU_QUEUE_ACTIVE) || (csr & errs)) {
+		dev_err(iommu->dev, "queue %u failed to start (csr 0x%x)\n",
+			queue->qid, csr);
+		riscv_iommu_writel(iommu, queue->qcr, 0);
+		free_irq(queue->irq, queue);
+		queue->irq = 0;
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
+static void riscv_iommu_queue_disable(struct riscv_iommu_device *iommu,
+				      struct riscv_iommu_queue *queue)
+{
+	u32 csr;
+
+	if (!queue->irq)
+		return;
+
+	riscv_iommu_writel(iommu, queue->qcr, 0);
+	if (riscv_iommu_readl_timeout(iommu, queue->qcr, csr,
+				      !(csr & (RISCV_IOMMU_QUEUE_ACTIVE |
+					       RISCV_IOMMU_QUEUE_BUSY)),
+				      10, RISCV_IOMMU_QUEUE_TIMEOUT))
+		dev_err(iommu->dev, "queue %u failed to stop (csr 0x%x)\n",
+			queue->qid, csr);
+
+	free_irq(queue->irq, queue);
+	queue->irq = 0;
+}
+
+/* Hand consumed fault or page-request records back to the hardware. */
+static void riscv_iommu_queue_release(struct riscv_iommu_device *iommu,
+				      struct riscv_iommu_queue *queue)
+{
+	/* The records must have been read before their slots are reused. */
+	mb();
+	riscv_iommu_writel(iommu, queue->qhr, queue->head & queue->mask);
+}
+
+/* Command queue, called with the queue lock held */
+
+static void riscv_iommu_cmdq_update_head(struct riscv_iommu_device *iommu,
+					 struct riscv_iommu_queue *q)
+{
+	unsigned int head = riscv_iommu_readl(iommu, q->qhr) & q->mask;
+
+	/* At most mask commands are in flight, so this cannot alias. */
+	q->head += (head - q->head) & q->mask;
+}
+
+static int riscv_iommu_cmdq_wait_space(struct riscv_iommu_device *iommu,
+				       struct riscv_iommu_queue *q)
+{
+	ktime_t timeout;
+
+	/* One slot stays empty, a full queue would look empty otherwise. */
+	if (q->tail - q->head < q->mask)
+		return 0;
+
+	/* Publish what is queued already and let the IOMMU catch up. */
+	writel(q->tail & q->mask, iommu->reg + q->qtr);
+
+	timeout = ktime_add_us(ktime_get(), RISCV_IOMMU_QUEUE_TIMEOUT);
+	do {
+		riscv_iommu_cmdq_update_head(iommu, q);
+		if (q->tail - q->head < q->mask)
+			return 0;
+		cpu_relax();
+	} while (ktime_before(ktime_get(), timeout));
+
+	return -ETIMEDOUT;
+}
+
+/*
+ * Write @count commands, followed for @sync by an IOFENCE.C, with a single
+ * doorbell. For @sync, wait until the IOMMU has consumed the fence, by then
+ * every command before it has completed, ATS invalidations included.
+ */
+static void riscv_iommu_cmdq_submit(struct riscv_iommu_device *iommu,
+				    struct riscv_iommu_command *cmds,
+				    unsigned int count, bool sync)
+{
+	struct riscv_iommu_queue *q = &iommu->cmdq;
+	struct riscv_iommu_command *ring = q->base;
+	struct riscv_iommu_command fence;
+	unsigned long flags;
+	unsigned int i, idx;
+	ktime_t timeout;
+	bool done;
+
+	riscv_iommu_cmd_iofence(&fence);
+
+	spin_lock_irqsave(&q->lock, flags);
+	for (i = 0; i < count + sync; i++) {
+		if (riscv_iommu_cmdq_wait_space(iommu, q)) {
+			spin_unlock_irqrestore(&q->lock, flags);
+			dev_err_ratelimited(iommu->dev,
+					    "command queue stalled, %u commands dropped\n",
+					    count + sync - i);
+			return;
+		}
+		ring[q->tail & q->mask] = i < count ? cmds[i] : fence;
+		q->tail++;
+	}
+	idx = q->tail;
+	/* writel() orders the ring updates before the doorbell. */
+	writel(q->tail & q->mask, iommu->reg + q->qtr);
+	spin_unlock_irqrestore(&q->lock, flags);
+
+	if (!sync)
+		return;
+
+	timeout = ktime_add_us(ktime_get(), RISCV_IOMMU_QUEUE_TIMEOUT);
+	do {
+		spin_lock_irqsave(&q->lock, flags);
+		riscv_iommu_cmdq_update_head(iommu, q);
+		done = (int)(q->head - idx) >= 0;
+		spin_unlock_irqrestore(&q->lock, flags);
+		if (done)
+			return;
+		cpu_relax();
+	} while (ktime_before(ktime_get(), timeout));
+
+	dev_err_ratelimited(iommu->dev, "command queue sync timeout\n");
+}
+
+void riscv_iommu_batch_add(struct riscv_iommu_cmd_batch *batch,
+			   struct riscv_iommu_device *iommu,
+			   struct riscv_iommu_command *cmd)
+{
+	if (batch->iommu && batch->iommu != iommu)
+		riscv_iommu_batch_submit(batch);
+
+	/* Full: write out without a fence, the final submit adds one. */
+	if (batch->num == RISCV_IOMMU_CMD_BATCH_SIZE) {
+		riscv_iommu_cmdq_submit(iommu, batch->cmds, batch->num, false);
+		batch->num = 0;
+	}
+
+	batch->iommu = iommu;
+	batch->cmds[batch->num++] = *cmd;
+}
+
+void riscv_iommu_batch_submit(struct riscv_iommu_cmd_batch *batch)
+{
+	if (!batch->iommu)
+		return;
+
+	riscv_iommu_cmdq_submit(batch->iommu, batch->cmds, batch->num, true);
+	batch->iommu = NULL;
+	batch->num = 0;
+}
+
+static irqreturn_t riscv_iommu_cmdq_process(int irq, void *data)
+{
+	struct riscv_iommu_queue *queue = data;
+	struct riscv_iommu_device *iommu = queue->iommu;
+	struct riscv_iommu_command *cmd;
+	unsigned long flags;
+	unsigned int head;
+	u32 csr;
+
+	riscv_iommu_writel(iommu, RISCV_IOMMU_REG_IPSR, BIT(queue->qid));
+
+	csr = riscv_iommu_readl(iommu, queue->qcr);
+	if (!(csr & RISCV_IOMMU_CQCSR_ERRORS))
+		return IRQ_HANDLED;
+
+	if (csr & RISCV_IOMMU_CQCSR_CMD_ILL) {
+		/* The queue stops at the offending command, turn it into a fence. */
+		spin_lock_irqsave(&queue->lock, flags);
+		head = riscv_iommu_readl(iommu, queue->qhr) & queue->mask;
+		cmd = (struct riscv_iommu_command *)queue->base + head;
+		dev_err_ratelimited(iommu->dev, "illegal command %016llx %016llx\n",
+				    cmd->dword0, cmd->dword1);
+		riscv_iommu_cmd_iofence(cmd);
+		spin_unlock_irqrestore(&queue->lock, flags);
+	}
+	if (csr & RISCV_IOMMU_CQCSR_CMD_TO)
+		dev_err_ratelimited(iommu->dev, "command timeout\n");
+	if (csr & RISCV_IOMMU_QUEUE_MEM_FAULT)
+		dev_err_ratelimited(iommu->dev, "command queue memory fault\n");
+
+	riscv_iommu_writel(iommu, queue->qcr, RISCV_IOMMU_QUEUE_ENABLE |
+			   RISCV_IOMMU_QUEUE_INTR_ENABLE |
+			   (csr & RISCV_IOMMU_CQCSR_ERRORS));
+
+	return IRQ_HANDLED;
+}
+
+/* Fault and page-request queues */
+
+static void riscv_iommu_fault_report(struct riscv_iommu_device *iommu,
+				     struct riscv_iommu_fq_record *event)
+{
+	dev_warn_ratelimited(iommu->dev,
+			     "fault: cause %llu devid 0x%llx pasid %lld ttyp %llu iotval 0x%llx iotval2 0x%llx\n",
+			     FIELD_GET(RISCV_IOMMU_FQ_HDR_CAUSE, event->hdr),
+			     FIELD_GET(RISCV_IOMMU_FQ_HDR_DID, event->hdr),
+			     event->hdr & RISCV_IOMMU_FQ_HDR_PV ?
+			     (s64)FIELD_GET(RISCV_IOMMU_FQ_HDR_PID, event->hdr) : -1,
+			     FIELD_GET(RISCV_IOMMU_FQ_HDR_TTYP, event->hdr),
+			     event->iotval, event->iotval2);
+}
+
+static irqreturn_t riscv_iommu_fltq_process(int irq, void *data)
+{
+	struct riscv_iommu_queue *queue = data;
+	struct riscv_iommu_device *iommu = queue->iommu;
+	struct riscv_iommu_fq_record *events = queue->base;
+	unsigned int tail;
+	u32 csr;
+
+	riscv_iommu_writel(iommu, RISCV_IOMMU_REG_IPSR, BIT(queue->qid));
+
+	csr = riscv_iommu_readl(iommu, queue->qcr);
+	if (csr & RISCV_IOMMU_QUEUE_ERRORS) {
+		dev_warn_ratelimited(iommu->dev, "fault queue %s\n",
+				     csr & RISCV_IOMMU_QUEUE_OVERFLOW ?
+				     "overflow" : "memory fault");
+		riscv_iommu_writel(iommu, queue->qcr, RISCV_IOMMU_QUEUE_ENABLE |
+				   RISCV_IOMMU_QUEUE_INTR_ENABLE |
+				   (csr & RISCV_IOMMU_QUEUE_ERRORS));
+	}
+
+	/* readl() orders the tail read before the record reads. */
+	tail = readl(iommu->reg + queue->qtr) & queue->mask;
+	while ((queue->head & queue->mask) != tail) {
+		riscv_iommu_fault_report(iommu, &events[queue->head & queue->mask]);
+		queue->head++;
+	}
+	riscv_iommu_queue_release(iommu, queue);
+
+	return IRQ_HANDLED;
+}
+
+static void riscv_iommu_prgr(struct riscv_iommu_device *iommu,
+			     unsigned int devid, bool pv, ioasid_t pasid,
+			     unsigned int grpid, unsigned int code)
+{
+	struct riscv_iommu_command cmd;
+
+	riscv_iommu_cmd_ats(&cmd, RISCV_IOMMU_CMD_ATS_FUNC_PRGR, devid);
+	if (pv)
+		riscv_iommu_cmd_ats_set_pid(&cmd, pasid);
+	cmd.dword1 = FIELD_PREP(RISCV_IOMMU_CMD_ATS_PRGR_PRG_INDEX, grpid) |
+		     FIELD_PREP(RISCV_IOMMU_CMD_ATS_PRGR_RESP_CODE, code) |
+		     FIELD_PREP(RISCV_IOMMU_CMD_ATS_PRGR_DST_ID, devid & 0xffff);
+
+	/* A response is fire and forget, no need for a fence. */
+	riscv_iommu_cmdq_submit(iommu, &cmd, 1, false);
+}
+
+static void riscv_iommu_priq_report(struct riscv_iommu_device *iommu,
+				    struct riscv_iommu_pq_record *req)
+{
+	unsigned int devid = FIELD_GET(RISCV_IOMMU_PQ_HDR_DID, req->hdr);
+	struct iopf_fault event = { };
+	struct iommu_fault_page_request *prm = &event.fault.prm;
+	struct riscv_iommu_info *info;
+	struct device *dev;
+
+	event.fault.type = IOMMU_FAULT_PAGE_REQ;
+	prm->grpid = FIELD_GET(RISCV_IOMMU_PQ_PAYLOAD_PRGI, req->payload);
+	prm->addr = req->payload & RISCV_IOMMU_PQ_PAYLOAD_ADDR;
+	if (req->payload & RISCV_IOMMU_PQ_PAYLOAD_L)
+		prm->flags |= IOMMU_FAULT_PAGE_REQUEST_LAST_PAGE;
+	if (req->hdr & RISCV_IOMMU_PQ_HDR_PV) {
+		prm->flags |= IOMMU_FAULT_PAGE_REQUEST_PASID_VALID;
+		prm->pasid = FIELD_GET(RISCV_IOMMU_PQ_HDR_PID, req->hdr);
+	}
+	if (req->payload & RISCV_IOMMU_PQ_PAYLOAD_R)
+		prm->perm |= IOMMU_FAULT_PERM_READ;
+	if (req->payload & RISCV_IOMMU_PQ_PAYLOAD_W)
+		prm->perm |= IOMMU_FAULT_PERM_WRITE;
+	if (req->hdr & RISCV_IOMMU_PQ_HDR_EXEC)
+		prm->perm |= IOMMU_FAULT_PERM_EXEC;
+	if (req->hdr & RISCV_IOMMU_PQ_HDR_PRIV)
+		prm->perm |= IOMMU_FAULT_PERM_PRIV;
+
+	mutex_lock(&iommu->devs_lock);
+	dev = xa_load(&iommu->devs, devid);
+	info = dev ? dev_iommu_priv_get(dev) : NULL;
+	if (info && info->pri_enabled) {
+		if (info->prg_resp_pasid)
+			prm->flags |= IOMMU_FAULT_PAGE_RESPONSE_NEEDS_PASID;
+		iommu_report_device_fault(dev, &event);
+		mutex_unlock(&iommu->devs_lock);
+		return;
+	}
+	mutex_unlock(&iommu->devs_lock);
+
+	/* Nobody is going to answer, do not leave the function waiting. */
+	if (prm->flags & IOMMU_FAULT_PAGE_REQUEST_LAST_PAGE)
+		riscv_iommu_prgr(iommu, devid, false, 0, prm->grpid,
+				 RISCV_IOMMU_CMD_ATS_PRGR_RESP_INVALID);
+}
+
+static irqreturn_t riscv_iommu_priq_process(int irq, void *data)
+{
+	struct riscv_iommu_queue *queue = data;
+	struct riscv_iommu_device *iommu = queue->iommu;
+	struct riscv_iommu_pq_record *requests = queue->base;
+	unsigned int tail;
+	u32 csr;
+
+	riscv_iommu_writel(iommu, RISCV_IOMMU_REG_IPSR, BIT(queue->qid));
+
+	csr = riscv_iommu_readl(iommu, queue->qcr);
+	if (csr & RISCV_IOMMU_QUEUE_ERRORS) {
+		dev_warn_ratelimited(iommu->dev, "page request queue %s\n",
+				     csr & RISCV_IOMMU_QUEUE_OVERFLOW ?
+				     "overflow" : "memory fault");
+		/* The last request of some groups may be lost. */
+		if (iommu->iopf)
+			iopf_queue_discard_partial(iommu->iopf);
+		riscv_iommu_writel(iommu, queue->qcr, RISCV_IOMMU_QUEUE_ENABLE |
+				   RISCV_IOMMU_QUEUE_INTR_ENABLE |
+				   (csr & RISCV_IOMMU_QUEUE_ERRORS));
+	}
+
+	tail = readl(iommu->reg + queue->qtr) & queue->mask;
+	while ((queue->head & queue->mask) != tail) {
+		riscv_iommu_priq_report(iommu, &requests[queue->head & queue->mask]);
+		queue->head++;
+	}
+	riscv_iommu_queue_release(iommu, queue);
+
+	return IRQ_HANDLED;
+}
+
+static void riscv_iommu_page_response(struct device *dev,
+				      struct iopf_fault *evt,
+				      struct iommu_page_response *msg)
+{
+	struct iommu_fwspec *fwspec = dev_iommu_fwspec_get(dev);
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+	unsigned int code;
+	bool pv;
+
+	switch (msg->code) {
+	case IOMMU_PAGE_RESP_SUCCESS:
+		code = RISCV_IOMMU_CMD_ATS_PRGR_RESP_SUCCESS;
+		break;
+	case IOMMU_PAGE_RESP_INVALID:
+		code = RISCV_IOMMU_CMD_ATS_PRGR_RESP_INVALID;
+		break;
+	default:
+		code = RISCV_IOMMU_CMD_ATS_PRGR_RESP_FAILURE;
+		break;
+	}
+
+	pv = info->prg_resp_pasid &&
+	     (evt->fault.prm.flags & IOMMU_FAULT_PAGE_REQUEST_PASID_VALID);
+	riscv_iommu_prgr(info->iommu, fwspec->ids[0], pv, msg->pasid,
+			 msg->grpid, code);
+}
+
+/* Device directory */
+
+static u64 riscv_iommu_virt_to_ppn(void *ptr)
+{
+	return virt_to_phys(ptr) >> RISCV_IOMMU_PAGE_SHIFT;
+}
+
+static void *riscv_iommu_ppn_to_virt(u64 ppn)
+{
+	return phys_to_virt(ppn << RISCV_IOMMU_PAGE_SHIFT);
+}
+
+/*
+ * Return the context of @devid, allocating the directory levels above it.
+ * Device IDs split into 7 (6 in extended format) bits for the leaf table
+ * and 9 bits per upper level, capped to 24 bits.
+ */
+static struct riscv_iommu_dc *riscv_iommu_get_dc(struct riscv_iommu_device *iommu,
+						 unsigned int devid)
+{
+	const bool base_format = !(iommu->caps & RISCV_IOMMU_CAPABILITIES_MSI_FLAT);
+	const unsigned int leaf_bits = base_format ? 7 : 6;
+	unsigned int depth = iommu->ddt_mode - RISCV_IOMMU_DDTP_IOMMU_MODE_1LVL;
+	size_t dc_size = base_format ? sizeof(struct riscv_iommu_dc) / 2 :
+				       sizeof(struct riscv_iommu_dc);
+	void *ptr = iommu->ddt_root;
+	unsigned long page;
+	u64 *ddte, old, new;
+
+	if (iommu->ddt_mode < RISCV_IOMMU_DDTP_IOMMU_MODE_1LVL ||
+	    iommu->ddt_mode > RISCV_IOMMU_DDTP_IOMMU_MODE_3LVL)
+		return NULL;
+
+	if (devid >= BIT(min(leaf_bits + 9 * depth, 24U)))
+		return NULL;
+
+	for (; depth > 0; depth--) {
+		ddte = (u64 *)ptr + ((devid >> (leaf_bits + 9 * (depth - 1))) & 0x1ff);
+		old = READ_ONCE(*ddte);
+		while (!(old & RISCV_IOMMU_DDTE_V)) {
+			page = devm_get_free_pages(iommu->dev,
+						   GFP_KERNEL | __GFP_ZERO, 0);
+			if (!page)
+				return NULL;
+
+			new = FIELD_PREP(RISCV_IOMMU_DDTE_PPN,
+					 riscv_iommu_virt_to_ppn((void *)page)) |
+			      RISCV_IOMMU_DDTE_V;
+			/* Fully ordered, the zeroed table is visible first. */
+			if (cmpxchg(ddte, old, new) == old) {
+				old = new;
+				break;
+			}
+			devm_free_pages(iommu->dev, page);
+			old = READ_ONCE(*ddte);
+		}
+		ptr = riscv_iommu_ppn_to_virt(FIELD_GET(RISCV_IOMMU_DDTE_PPN, old));
+	}
+
+	return ptr + (devid & (BIT(leaf_bits) - 1)) * dc_size;
+}
+
+static u64 riscv_iommu_dc_tc(struct riscv_iommu_info *info)
+{
+	u64 tc = RISCV_IOMMU_DC_TC_V;
+
+	if (info->iommu->caps & RISCV_IOMMU_CAPABILITIES_AMO_HWAD)
+		tc |= RISCV_IOMMU_DC_TC_SADE;
+	if (info->pdt_root)
+		tc |= RISCV_IOMMU_DC_TC_PDTV | RISCV_IOMMU_DC_TC_DPE;
+	if (info->ats_enabled)
+		tc |= RISCV_IOMMU_DC_TC_EN_ATS;
+	if (info->pri_enabled)
+		tc |= RISCV_IOMMU_DC_TC_EN_PRI;
+	if (info->prg_resp_pasid)
+		tc |= RISCV_IOMMU_DC_TC_PRPR;
+
+	return tc;
+}
+
+static void riscv_iommu_iodir_inval(struct riscv_iommu_cmd_batch *batch,
+				    struct riscv_iommu_device *iommu,
+				    unsigned int devid)
+{
+	struct riscv_iommu_command cmd;
+
+	riscv_iommu_cmd_iodir_inval_ddt(&cmd);
+	riscv_iommu_cmd_iodir_set_did(&cmd, devid);
+	riscv_iommu_batch_add(batch, iommu, &cmd);
+}
+
+static void riscv_iommu_ats_inval_dev(struct riscv_iommu_cmd_batch *batch,
+				      struct device *dev, ioasid_t pasid,
+				      u64 payload)
+{
+	struct iommu_fwspec *fwspec = dev_iommu_fwspec_get(dev);
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+	struct riscv_iommu_command cmd;
+	int i;
+
+	if (!info->ats_enabled)
+		return;
+
+	for (i = 0; i < fwspec->num_ids; i++) {
+		riscv_iommu_cmd_ats(&cmd, RISCV_IOMMU_CMD_ATS_FUNC_INVAL,
+				    fwspec->ids[i]);
+		if (pasid != IOMMU_NO_PASID)
+			riscv_iommu_cmd_ats_set_pid(&cmd, pasid);
+		cmd.dword1 = payload;
+		riscv_iommu_batch_add(batch, info->iommu, &cmd);
+	}
+}
+
+/*
+ * Write the device contexts of @dev. Contexts that are valid and change
+ * translation are turned off and invalidated first, the hardware may
+ * otherwise fetch a half written one.
+ */
+static void riscv_iommu_iodir_update(struct riscv_iommu_device *iommu,
+				     struct device *dev, u64 fsc, u64 ta, u64 tc)
+{
+	struct iommu_fwspec *fwspec = dev_iommu_fwspec_get(dev);
+	struct riscv_iommu_cmd_batch batch = { };
+	struct riscv_iommu_dc *dc;
+	bool live = false;
+	u64 old_tc;
+	int i;
+
+	for (i = 0; i < fwspec->num_ids; i++) {
+		dc = riscv_iommu_get_dc(iommu, fwspec->ids[i]);
+		old_tc = READ_ONCE(dc->tc);
+		if (!(old_tc & RISCV_IOMMU_DC_TC_V) ||
+		    (READ_ONCE(dc->fsc) == fsc && READ_ONCE(dc->ta) == ta))
+			continue;
+
+		WRITE_ONCE(dc->tc, old_tc & ~RISCV_IOMMU_DC_TC_V);
+		riscv_iommu_iodir_inval(&batch, iommu, fwspec->ids[i]);
+		live = true;
+	}
+	riscv_iommu_batch_submit(&batch);
+
+	/* Translations the function cached for the old context go as well. */
+	if (live) {
+		riscv_iommu_ats_inval_dev(&batch, dev, IOMMU_NO_PASID,
+					  RISCV_IOMMU_CMD_ATS_INVAL_ALL);
+		riscv_iommu_batch_submit(&batch);
+	}
+
+	for (i = 0; i < fwspec->num_ids; i++) {
+		dc = riscv_iommu_get_dc(iommu, fwspec->ids[i]);
+		WRITE_ONCE(dc->fsc, fsc);
+		WRITE_ONCE(dc->ta, ta);
+		dma_wmb();
+		WRITE_ONCE(dc->tc, tc);
+		riscv_iommu_iodir_inval(&batch, iommu, fwspec->ids[i]);
+	}
+	riscv_iommu_batch_submit(&batch);
+}
+
+/* Refresh the control bits of valid contexts, after PRI was toggled. */
+static void riscv_iommu_iodir_update_tc(struct device *dev)
+{
+	struct iommu_fwspec *fwspec = dev_iommu_fwspec_get(dev);
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+	struct riscv_iommu_cmd_batch batch = { };
+	struct riscv_iommu_dc *dc;
+	int i;
+
+	for (i = 0; i < fwspec->num_ids; i++) {
+		dc = riscv_iommu_get_dc(info->iommu, fwspec->ids[i]);
+		if (!(READ_ONCE(dc->tc) & RISCV_IOMMU_DC_TC_V))
+			continue;
+
+		WRITE_ONCE(dc->tc, riscv_iommu_dc_tc(info));
+		riscv_iommu_iodir_inval(&batch, info->iommu, fwspec->ids[i]);
+	}
+	riscv_iommu_batch_submit(&batch);
+}
+
+static int riscv_iommu_iodir_set_mode(struct riscv_iommu_device *iommu,
+				      unsigned int mode)
+{
+	struct riscv_iommu_command cmds[2];
+	u64 ddtp, rq_ddtp;
+
+	if (riscv_iommu_readq_timeout(iommu, RISCV_IOMMU_REG_DDTP, ddtp,
+				      !(ddtp & RISCV_IOMMU_DDTP_BUSY),
+				      10, RISCV_IOMMU_DDTP_TIMEOUT))
+		goto err_busy;
+
+	/* Changing between two translating modes goes through Off. */
+	if (FIELD_GET(RISCV_IOMMU_DDTP_IOMMU_MODE, ddtp) != RISCV_IOMMU_DDTP_IOMMU_MODE_OFF &&
+	    mode != RISCV_IOMMU_DDTP_IOMMU_MODE_OFF) {
+		riscv_iommu_writeq(iommu, RISCV_IOMMU_REG_DDTP,
+				   FIELD_PREP(RISCV_IOMMU_DDTP_IOMMU_MODE,
+					      RISCV_IOMMU_DDTP_IOMMU_MODE_OFF));
+		if (riscv_iommu_readq_timeout(iommu, RISCV_IOMMU_REG_DDTP, ddtp,
+					      !(ddtp & RISCV_IOMMU_DDTP_BUSY),
+					      10, RISCV_IOMMU_DDTP_TIMEOUT))
+			goto err_busy;
+	}
+
+	rq_ddtp = FIELD_PREP(RISCV_IOMMU_DDTP_IOMMU_MODE, mode);
+	if (mode > RISCV_IOMMU_DDTP_IOMMU_MODE_BARE)
+		rq_ddtp |= FIELD_PREP(RISCV_IOMMU_DDTP_PPN,
+				      riscv_iommu_virt_to_ppn(iommu->ddt_root));
+
+	riscv_iommu_writeq(iommu, RISCV_IOMMU_REG_DDTP, rq_ddtp);
+	if (riscv_iommu_readq_timeout(iommu, RISCV_IOMMU_REG_DDTP, ddtp,
+				      !(ddtp & RISCV_IOMMU_DDTP_BUSY),
+				      10, RISCV_IOMMU_DDTP_TIMEOUT))
+		goto err_busy;
+
+	/* The mode field is WARL, an unsupported mode is not taken. */
+	if (ddtp != rq_ddtp)
+		return -EINVAL;
+
+	if (mode > RISCV_IOMMU_DDTP_IOMMU_MODE_BARE) {
+		riscv_iommu_cmd_iodir_inval_ddt(&cmds[0]);
+		riscv_iommu_cmd_inval_vma(&cmds[1]);
+		riscv_iommu_cmdq_submit(iommu, cmds, ARRAY_SIZE(cmds), true);
+	}
+	iommu->ddt_mode = mode;
+
+	return 0;
+
+err_busy:
+	dev_err(iommu->dev, "device directory pointer stuck busy\n");
+	return -EBUSY;
+}
+
+static int riscv_iommu_iodir_init(struct riscv_iommu_device *iommu)
+{
+	unsigned int mode;
+	int ret = -EINVAL;
+
+	iommu->ddt_root = (void *)devm_get_free_pages(iommu->dev,
+						      GFP_KERNEL | __GFP_ZERO, 0);
+	if (!iommu->ddt_root)
+		return -ENOMEM;
+
+	/* The deepest directory covers all 24 device ID bits. */
+	for (mode = RISCV_IOMMU_DDTP_IOMMU_MODE_3LVL;
+	     mode >= RISCV_IOMMU_DDTP_IOMMU_MODE_1LVL && ret == -EINVAL; mode--)
+		ret = riscv_iommu_iodir_set_mode(iommu, mode);
+
+	if (ret)
+		dev_err(iommu->dev, "no usable device directory mode\n");
+
+	return ret;
+}
+
+/* Process directories */
+
+static const unsigned int riscv_iommu_pdt_bits[] = {
+	[RISCV_IOMMU_DC_FSC_PDTP_MODE_PD8]	= 8,
+	[RISCV_IOMMU_DC_FSC_PDTP_MODE_PD17]	= 17,
+	[RISCV_IOMMU_DC_FSC_PDTP_MODE_PD20]	= 20,
+};
+
+static bool riscv_iommu_pdt_mode_supported(struct riscv_iommu_device *iommu,
+					   unsigned int mode)
+{
+	return iommu->caps & (RISCV_IOMMU_CAPABILITIES_PD8 <<
+			      (mode - RISCV_IOMMU_DC_FSC_PDTP_MODE_PD8));
+}
+
+/* The smallest supported directory that covers @pasids. */
+static unsigned int riscv_iommu_pdt_mode(struct riscv_iommu_device *iommu,
+					 unsigned int pasids)
+{
+	unsigned int mode;
+
+	for (mode = RISCV_IOMMU_DC_FSC_PDTP_MODE_PD8; mode < iommu->pdt_mode; mode++) {
+		if (riscv_iommu_pdt_mode_supported(iommu, mode) &&
+		    pasids <= BIT(riscv_iommu_pdt_bits[mode]))
+			break;
+	}
+
+	return mode;
+}
+
+/* PASIDs split into 8 bits for the leaf table and 9 per upper level. */
+static struct riscv_iommu_pc *riscv_iommu_get_pc(struct riscv_iommu_info *info,
+						 ioasid_t pasid, bool alloc)
+{
+	unsigned int depth = info->pdt_mode - RISCV_IOMMU_DC_FSC_PDTP_MODE_PD8;
+	void *ptr = info->pdt_root;
+	unsigned long page;
+	u64 *pdte, old, new;
+
+	for (; depth > 0; depth--) {
+		pdte = (u64 *)ptr + ((pasid >> (8 + 9 * (depth - 1))) & 0x1ff);
+		old = READ_ONCE(*pdte);
+		while (!(old & RISCV_IOMMU_PDTE_V)) {
+			if (!alloc)
+				return NULL;
+
+			page = get_zeroed_page(GFP_KERNEL);
+			if (!page)
+				return NULL;
+
+			new = FIELD_PREP(RISCV_IOMMU_PDTE_PPN,
+					 riscv_iommu_virt_to_ppn((void *)page)) |
+			      RISCV_IOMMU_PDTE_V;
+			if (cmpxchg(pdte, old, new) == old) {
+				old = new;
+				break;
+			}
+			free_page(page);
+			old = READ_ONCE(*pdte);
+		}
+		ptr = riscv_iommu_ppn_to_virt(FIELD_GET(RISCV_IOMMU_PDTE_PPN, old));
+	}
+
+	return (struct riscv_iommu_pc *)ptr + (pasid & 0xff);
+}
+
+static void riscv_iommu_pdt_free(void *ptr, unsigned int depth)
+{
+	u64 *pdte = ptr;
+	int i;
+
+	for (i = 0; depth && i < PAGE_SIZE / sizeof(*pdte); i++) {
+		if (pdte[i] & RISCV_IOMMU_PDTE_V)
+			riscv_iommu_pdt_free(riscv_iommu_ppn_to_virt(FIELD_GET(RISCV_IOMMU_PDTE_PPN,
+									       pdte[i])),
+					     depth - 1);
+	}
+	free_page((unsigned long)ptr);
+}
+
+static void riscv_iommu_pc_inval(struct riscv_iommu_cmd_batch *batch,
+				 struct device *dev, ioasid_t pasid)
+{
+	struct iommu_fwspec *fwspec = dev_iommu_fwspec_get(dev);
+	struct riscv_iommu_command cmd;
+	int i;
+
+	for (i = 0; i < fwspec->num_ids; i++) {
+		riscv_iommu_cmd_iodir_inval_pdt(&cmd);
+		riscv_iommu_cmd_iodir_set_did(&cmd, fwspec->ids[i]);
+		riscv_iommu_cmd_iodir_set_pid(&cmd, pasid);
+		riscv_iommu_batch_add(batch, dev_to_riscv_iommu(dev), &cmd);
+	}
+}
+
+/*
+ * Write the process context of @pasid, or turn it off when @ta is not
+ * valid. As for device contexts, a live one is turned off first.
+ */
+int riscv_iommu_pc_update(struct device *dev, ioasid_t pasid, u64 fsc, u64 ta)
+{
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+	const bool valid = ta & RISCV_IOMMU_PC_TA_V;
+	struct riscv_iommu_cmd_batch batch = { };
+	struct riscv_iommu_pc *pc;
+
+	if (!info->pdt_root || pasid >= BIT(riscv_iommu_pdt_bits[info->pdt_mode]))
+		return -EINVAL;
+
+	pc = riscv_iommu_get_pc(info, pasid, valid);
+	if (!pc)
+		return valid ? -ENOMEM : 0;
+
+	if (READ_ONCE(pc->ta) & RISCV_IOMMU_PC_TA_V) {
+		WRITE_ONCE(pc->ta, 0);
+		riscv_iommu_pc_inval(&batch, dev, pasid);
+		riscv_iommu_batch_submit(&batch);
+		riscv_iommu_ats_inval_dev(&batch, dev, pasid,
+					  RISCV_IOMMU_CMD_ATS_INVAL_ALL);
+		riscv_iommu_batch_submit(&batch);
+	}
+
+	if (!valid)
+		return 0;
+
+	WRITE_ONCE(pc->fsc, fsc);
+	dma_wmb();
+	WRITE_ONCE(pc->ta, ta);
+	riscv_iommu_pc_inval(&batch, dev, pasid);
+	riscv_iommu_batch_submit(&batch);
+
+	return 0;
+}
+
+/*
+ * Point the requests of @dev without a PASID at a first-stage table, or
+ * at none for bypass, or block them.
+ */
+static void riscv_iommu_dev_set_ctx(struct device *dev, u64 fsc, int pscid,
+				    bool valid)
+{
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+	u64 ta = FIELD_PREP(RISCV_IOMMU_PC_TA_PSCID, pscid);
+
+	/* Context 0 was allocated at probe time, this cannot fail. */
+	if (info->pdt_root)
+		riscv_iommu_pc_update(dev, IOMMU_NO_PASID, fsc,
+				      valid ? ta | RISCV_IOMMU_PC_TA_V : 0);
+	else
+		riscv_iommu_iodir_update(info->iommu, dev, fsc, ta,
+					 valid ? riscv_iommu_dc_tc(info) : 0);
+}
+
+/* IOTLB and ATC invalidation */
+
+/* The smallest aligned power of two range covering [start, end]. */
+static u64 riscv_iommu_ats_inval_payload(unsigned long start, unsigned long end)
+{
+	unsigned int bits = max_t(unsigned int, fls64(start ^ end),
+				  RISCV_IOMMU_PAGE_SHIFT);
+	u64 size;
+
+	if (bits >= 63)
+		return RISCV_IOMMU_CMD_ATS_INVAL_ALL;
+
+	size = BIT_ULL(bits);
+	start &= ~(size - 1);
+	if (bits == RISCV_IOMMU_PAGE_SHIFT)
+		return start;
+
+	/* The lowest clear address bit above the S flag encodes the size. */
+	return start | (((size - 1) >> 1) & RISCV_IOMMU_CMD_ATS_INVAL_ADDR) |
+	       RISCV_IOMMU_CMD_ATS_INVAL_S;
+}
+
+/*
+ * Invalidate [start, end] of @domain in every IOMMU and ATC it is cached in.
+ * Each IOMMU is sent its IOTINVAL.VMA run in one batch, ATS invalidations
+ * follow once the IOTLBs are clean, or an ATC could refill from them. Bonds
+ * of the same IOMMU are kept next to each other by riscv_iommu_bond_link().
+ */
+void riscv_iommu_iotlb_inval(struct riscv_iommu_domain *domain,
+			     unsigned long start, unsigned long end,
+			     size_t pgsize)
+{
+	const bool flush_all = end - start >= RISCV_IOMMU_IOTLB_INVAL_LIMIT * pgsize;
+	struct riscv_iommu_device *iommu, *prev = NULL;
+	struct riscv_iommu_cmd_batch batch = { };
+	struct riscv_iommu_command cmd;
+	struct riscv_iommu_bond *bond;
+	bool ats = false;
+	unsigned long iova;
+	u64 payload;
+
+	if (end < start)
+		return;
+
+	/* Pairs with the barrier in riscv_iommu_bond_link(). */
+	smp_mb();
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(bond, &domain->bonds, list) {
+		iommu = dev_to_riscv_iommu(bond->dev);
+		ats |= ((struct riscv_iommu_info *)dev_iommu_priv_get(bond->dev))->ats_enabled;
+		if (iommu == prev)
+			continue;
+		prev = iommu;
+
+		riscv_iommu_cmd_inval_vma(&cmd);
+		riscv_iommu_cmd_inval_set_pscid(&cmd, domain->pscid);
+		if (flush_all) {
+			riscv_iommu_batch_add(&batch, iommu, &cmd);
+			continue;
+		}
+		for (iova = start; iova <= end && iova >= start; iova += pgsize) {
+			riscv_iommu_cmd_inval_set_addr(&cmd, iova);
+			riscv_iommu_batch_add(&batch, iommu, &cmd);
+		}
+	}
+	riscv_iommu_batch_submit(&batch);
+
+	if (ats) {
+		payload = flush_all ? RISCV_IOMMU_CMD_ATS_INVAL_ALL :
+				      riscv_iommu_ats_inval_payload(start, end);
+		list_for_each_entry_rcu(bond, &domain->bonds, list)
+			riscv_iommu_ats_inval_dev(&batch, bond->dev, bond->pasid,
+						  payload);
+		riscv_iommu_batch_submit(&batch);
+	}
+	rcu_read_unlock();
+}
+
+int riscv_iommu_bond_link(struct riscv_iommu_domain *domain,
+			  struct device *dev, ioasid_t pasid)
+{
+	struct riscv_iommu_device *iommu = dev_to_riscv_iommu(dev);
+	struct riscv_iommu_bond *bond, *pos;
+	struct list_head *head = &domain->bonds;
+
+	bond = kzalloc(sizeof(*bond), GFP_KERNEL);
+	if (!bond)
+		return -ENOMEM;
+	bond->dev = dev;
+	bond->pasid = pasid;
+
+	spin_lock(&domain->lock);
+	list_for_each_entry(pos, &domain->bonds, list) {
+		if (dev_to_riscv_iommu(pos->dev) == iommu) {
+			head = pos->list.next;
+			break;
+		}
+	}
+	list_add_tail_rcu(&bond->list, head);
+	spin_unlock(&domain->lock);
+
+	/*
+	 * An invalidation that does not see the new bond must not miss the
+	 * entries the device fetches once its context uses the domain.
+	 */
+	smp_mb();
+
+	return 0;
+}
+
+void riscv_iommu_bond_unlink(struct riscv_iommu_domain *domain,
+			     struct device *dev, ioasid_t pasid)
+{
+	struct riscv_iommu_device *iommu = dev_to_riscv_iommu(dev);
+	struct riscv_iommu_bond *bond, *found = NULL;
+	struct riscv_iommu_command cmd;
+	unsigned int count = 0;
+
+	if (!domain)
+		return;
+
+	spin_lock(&domain->lock);
+	list_for_each_entry(bond, &domain->bonds, list) {
+		if (!found && bond->dev == dev && bond->pasid == pasid)
+			found = bond;
+		else if (dev_to_riscv_iommu(bond->dev) == iommu)
+			count++;
+	}
+	if (found)
+		list_del_rcu(&found->list);
+	spin_unlock(&domain->lock);
+
+	if (!found)
+		return;
+	kfree_rcu(found, rcu);
+
+	/*
+	 * The PSCID is reused once the domain is freed, whatever this IOMMU
+	 * cached for it goes with the last device of the domain behind it.
+	 */
+	if (!count) {
+		riscv_iommu_cmd_inval_vma(&cmd);
+		riscv_iommu_cmd_inval_set_pscid(&cmd, domain->pscid);
+		riscv_iommu_cmdq_submit(iommu, &cmd, 1, true);
+	}
+}
+
+/* First-stage page tables */
+
+#define RISCV_IOMMU_PT_LEVEL_BITS	9
+
+#define _io_pte_present(pte)	((pte) & (_PAGE_PRESENT | _PAGE_PROT_NONE))
+#define _io_pte_leaf(pte)	((pte) & _PAGE_LEAF)
+#define _io_pte_none(pte)	((pte) == 0)
+#define _io_pte_entry(pn, prot)	((_PAGE_PFN_MASK & ((pn) << _PAGE_PFN_SHIFT)) | (prot))
+
+static int riscv_iommu_pt_levels(unsigned int pgd_mode)
+{
+	return 3 + pgd_mode - RISCV_IOMMU_IOSATP_MODE_SV39;
+}
+
+static unsigned long *riscv_iommu_pt_alloc_table(struct riscv_iommu_domain *domain,
+						 gfp_t gfp)
+{
+	struct page *page;
+
+	page = alloc_pages_node(domain->numa_node, gfp | __GFP_ZERO, 0);
+	if (!page)
+		return NULL;
+
+	return page_address(page);
+}
+
+static void riscv_iommu_pte_free(struct riscv_iommu_domain *domain,
+				 unsigned long pte, struct list_head *freelist)
+{
+	unsigned long *ptr;
+	int i;
+
+	if (!_io_pte_present(pte) || _io_pte_leaf(pte))
+		return;
+
+	ptr = (unsigned long *)pfn_to_virt(__page_val_to_pfn(pte));
+
+	/* Recursively free all sub page table pages */
+	for (i = 0; i < PTRS_PER_PTE; i++) {
+		pte = READ_ONCE(ptr[i]);
+		if (!_io_pte_none(pte) && cmpxchg_relaxed(ptr + i, pte, 0) == pte)
+			riscv_iommu_pte_free(domain, pte, freelist);
+	}
+
+	if (freelist)
+		list_add_tail(&virt_to_page(ptr)->lru, freelist);
+	else
+		free_page((unsigned long)ptr);
+}
+
+static unsigned long *riscv_iommu_pte_alloc(struct riscv_iommu_domain *domain,
+					    unsigned long iova, size_t pgsize,
+					    gfp_t gfp)
+{
+	unsigned long *ptr = (unsigned long *)domain->pgd_root;
+	int level = riscv_iommu_pt_levels(domain->pgd_mode) - 1;
+	unsigned long pte, old, *table;
+
+	do {
+		const int shift = PAGE_SHIFT + RISCV_IOMMU_PT_LEVEL_BITS * level;
+
+		ptr += ((iova >> shift) & (PTRS_PER_PTE - 1));
+		/*
+		 * Note: returned entry might be a non-leaf if there was
+		 * existing mapping with smaller granularity. Up to the caller
+		 * to replace and invalidate.
+		 */
+		if (((size_t)1 << shift) == pgsize)
+			return ptr;
+pte_retry:
+		pte = READ_ONCE(*ptr);
+		/*
+		 * This is very likely incorrect as we should not be adding
+		 * new mapping with smaller granularity on top of existing
+		 * 2M/1G mapping. Fail.
+		 */
+		if (_io_pte_present(pte) && _io_pte_leaf(pte))
+			return NULL;
+		/*
+		 * Non-leaf entry is missing, allocate and try to add to the
+		 * page table. This might race with other mappings, retry.
+		 */
+		if (_io_pte_none(pte)) {
+			table = riscv_iommu_pt_alloc_table(domain, gfp);
+			if (!table)
+				return NULL;
+			old = pte;
+			pte = _io_pte_entry(virt_to_pfn(table), _PAGE_TABLE);
+			if (cmpxchg(ptr, old, pte) != old) {
+				free_page((unsigned long)table);
+				goto pte_retry;
+			}
+		}
+		ptr = (unsigned long *)pfn_to_virt(__page_val_to_pfn(pte));
+	} while (level-- > 0);
+
+	return NULL;
+}
+
+static unsigned long *riscv_iommu_pte_fetch(struct riscv_iommu_domain *domain,
+					    unsigned long iova, size_t *pte_pgsize)
+{
+	unsigned long *ptr = (unsigned long *)domain->pgd_root;
+	int level = riscv_iommu_pt_levels(domain->pgd_mode) - 1;
+	unsigned long pte;
+
+	do {
+		const int shift = PAGE_SHIFT + RISCV_IOMMU_PT_LEVEL_BITS * level;
+
+		ptr += ((iova >> shift) & (PTRS_PER_PTE - 1));
+		pte = READ_ONCE(*ptr);
+		if (_io_pte_present(pte) && _io_pte_leaf(pte)) {
+			*pte_pgsize = (size_t)1 << shift;
+			return ptr;
+		}
+		if (_io_pte_none(pte))
+			return NULL;
+		ptr = (unsigned long *)pfn_to_virt(__page_val_to_pfn(pte));
+	} while (level-- > 0);
+
+	return NULL;
+}
+
+static int riscv_iommu_map_pages(struct iommu_domain *iommu_domain,
+				 unsigned long iova, phys_addr_t phys,
+				 size_t pgsize, size_t pgcount, int prot,
+				 gfp_t gfp, size_t *mapped)
+{
+	struct riscv_iommu_domain *domain = iommu_domain_to_riscv(iommu_domain);
+	unsigned long *ptr, old, pte_prot;
+	LIST_HEAD(freelist);
+	size_t size = 0;
+	int rc = 0;
+
+	/* Accessed and dirty are preset, the IOMMU never has to update them. */
+	pte_prot = _PAGE_BASE | _PAGE_READ;
+	if (prot & IOMMU_WRITE)
+		pte_prot |= _PAGE_WRITE | _PAGE_DIRTY;
+
+	while (pgcount) {
+		ptr = riscv_iommu_pte_alloc(domain, iova, pgsize, gfp);
+		if (!ptr) {
+			rc = -ENOMEM;
+			break;
+		}
+
+		old = READ_ONCE(*ptr);
+		WRITE_ONCE(*ptr, _io_pte_entry(phys_to_pfn(phys), pte_prot));
+		riscv_iommu_pte_free(domain, old, &freelist);
+
+		size += pgsize;
+		iova += pgsize;
+		phys += pgsize;
+		--pgcount;
+	}
+
+	*mapped = size;
+
+	if (!list_empty(&freelist)) {
+		/*
+		 * Tables replaced by a larger page may still be cached
+		 * as part of a walk, flush before returning them.
+		 */
+		riscv_iommu_iotlb_inval(domain, 0, ULONG_MAX, PAGE_SIZE);
+		put_pages_list(&freelist);
+	}
+
+	return rc;
+}
+
+static size_t riscv_iommu_unmap_pages(struct iommu_domain *iommu_domain,
+				      unsigned long iova, size_t pgsize,
+				      size_t pgcount,
+				      struct iommu_iotlb_gather *gather)
+{
+	struct riscv_iommu_domain *domain = iommu_domain_to_riscv(iommu_domain);
+	size_t size = pgcount << __ffs(pgsize);
+	unsigned long *ptr, old;
+	size_t unmapped = 0;
+	size_t pte_size;
+
+	while (unmapped < size) {
+		ptr = riscv_iommu_pte_fetch(domain, iova, &pte_size);
+		if (!ptr)
+			return unmapped;
+
+		/* partial unmap is not allowed, fail. */
+		if (iova & (pte_size - 1))
+			return unmapped;
+
+		old = READ_ONCE(*ptr);
+		if (cmpxchg_relaxed(ptr, old, 0) != old)
+			continue;
+
+		iommu_iotlb_gather_add_page(&domain->domain, gather, iova,
+					    pte_size);
+
+		iova += pte_size;
+		unmapped += pte_size;
+	}
+
+	return unmapped;
+}
+
+static phys_addr_t riscv_iommu_iova_to_phys(struct iommu_domain *iommu_domain,
+					    dma_addr_t iova)
+{
+	struct riscv_iommu_domain *domain = iommu_domain_to_riscv(iommu_domain);
+	unsigned long *ptr;
+	size_t pte_size;
+
+	ptr = riscv_iommu_pte_fetch(domain, iova, &pte_size);
+	if (!ptr)
+		return 0;
+
+	return pfn_to_phys(__page_val_to_pfn(*ptr)) | (iova & (pte_size - 1));
+}
+
+static void riscv_iommu_iotlb_flush_all(struct iommu_domain *iommu_domain)
+{
+	struct riscv_iommu_domain *domain = iommu_domain_to_riscv(iommu_domain);
+
+	riscv_iommu_iotlb_inval(domain, 0, ULONG_MAX, PAGE_SIZE);
+}
+
+/*
+ * In lazy mode the flush queue of dma-iommu skips this and calls
+ * riscv_iommu_iotlb_flush_all() once for many unmaps instead.
+ */
+static void riscv_iommu_iotlb_sync(struct iommu_domain *iommu_domain,
+				   struct iommu_iotlb_gather *gather)
+{
+	struct riscv_iommu_domain *domain = iommu_domain_to_riscv(iommu_domain);
+
+	if (!gather->pgsize)
+		return;
+
+	riscv_iommu_iotlb_inval(domain, gather->start, gather->end,
+				gather->pgsize);
+}
+
+/* Domains */
+
+static int riscv_iommu_attach_paging_domain(struct iommu_domain *iommu_domain,
+					    struct device *dev)
+{
+	struct riscv_iommu_domain *domain = iommu_domain_to_riscv(iommu_domain);
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+	u64 fsc;
+
+	if (!riscv_iommu_pgd_mode_supported(info->iommu, domain->pgd_mode))
+		return -ENODEV;
+
+	fsc = FIELD_PREP(RISCV_IOMMU_PC_FSC_MODE, domain->pgd_mode) |
+	      FIELD_PREP(RISCV_IOMMU_PC_FSC_PPN,
+			 riscv_iommu_virt_to_ppn(domain->pgd_root));
+
+	if (riscv_iommu_bond_link(domain, dev, IOMMU_NO_PASID))
+		return -ENOMEM;
+
+	riscv_iommu_dev_set_ctx(dev, fsc, domain->pscid, true);
+	riscv_iommu_bond_unlink(info->domain, dev, IOMMU_NO_PASID);
+	info->domain = domain;
+
+	return 0;
+}
+
+static void riscv_iommu_free_paging_domain(struct iommu_domain *iommu_domain)
+{
+	struct riscv_iommu_domain *domain = iommu_domain_to_riscv(iommu_domain);
+
+	WARN_ON(!list_empty(&domain->bonds));
+
+	riscv_iommu_pte_free(domain, _io_pte_entry(virt_to_pfn(domain->pgd_root),
+						   _PAGE_TABLE), NULL);
+	riscv_iommu_free_pscid(domain->pscid);
+	kfree(domain);
+}
+
+static const struct iommu_domain_ops riscv_iommu_paging_domain_ops = {
+	.attach_dev		= riscv_iommu_attach_paging_domain,
+	.free			= riscv_iommu_free_paging_domain,
+	.map_pages		= riscv_iommu_map_pages,
+	.unmap_pages		= riscv_iommu_unmap_pages,
+	.iova_to_phys		= riscv_iommu_iova_to_phys,
+	.iotlb_sync		= riscv_iommu_iotlb_sync,
+	.flush_iotlb_all	= riscv_iommu_iotlb_flush_all,
+};
+
+static struct iommu_domain *riscv_iommu_alloc_paging_domain(struct device *dev)
+{
+	struct riscv_iommu_domain *domain;
+	unsigned int pgd_mode;
+	int va_bits;
+
+	/* Without a device, use the CPU format and check it at attach. */
+	pgd_mode = dev ? dev_to_riscv_iommu(dev)->pgd_mode :
+			 satp_mode >> SATP_MODE_SHIFT;
+	va_bits = 39 + 9 * (pgd_mode - RISCV_IOMMU_IOSATP_MODE_SV39);
+
+	domain = kzalloc(sizeof(*domain), GFP_KERNEL);
+	if (!domain)
+		return ERR_PTR(-ENOMEM);
+
+	INIT_LIST_HEAD(&domain->bonds);
+	spin_lock_init(&domain->lock);
+	domain->numa_node = dev ? dev_to_node(dev_to_riscv_iommu(dev)->dev) :
+				  NUMA_NO_NODE;
+	domain->pgd_mode = pgd_mode;
+	domain->pgd_root = (u64 *)riscv_iommu_pt_alloc_table(domain, GFP_KERNEL);
+	if (!domain->pgd_root) {
+		kfree(domain);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	domain->pscid = riscv_iommu_alloc_pscid();
+	if (domain->pscid < 0) {
+		free_page((unsigned long)domain->pgd_root);
+		kfree(domain);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	/* Only the lower half, the upper one is for supervisor addresses. */
+	domain->domain.geometry.aperture_start = 0;
+	domain->domain.geometry.aperture_end = DMA_BIT_MASK(va_bits - 1);
+	domain->domain.geometry.force_aperture = true;
+	domain->domain.pgsize_bitmap = SZ_4K | SZ_2M | SZ_1G;
+	domain->domain.ops = &riscv_iommu_paging_domain_ops;
+
+	return &domain->domain;
+}
+
+static struct iommu_domain *riscv_iommu_domain_alloc(unsigned int type)
+{
+	if (type == IOMMU_DOMAIN_SVA)
+		return riscv_iommu_sva_domain_alloc();
+
+	return ERR_PTR(-EOPNOTSUPP);
+}
+
+static int riscv_iommu_attach_blocking_domain(struct iommu_domain *iommu_domain,
+					      struct device *dev)
+{
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+
+	riscv_iommu_dev_set_ctx(dev, 0, 0, false);
+	riscv_iommu_bond_unlink(info->domain, dev, IOMMU_NO_PASID);
+	info->domain = NULL;
+
+	return 0;
+}
+
+static struct iommu_domain riscv_iommu_blocking_domain = {
+	.type = IOMMU_DOMAIN_BLOCKED,
+	.ops = &(const struct iommu_domain_ops) {
+		.attach_dev = riscv_iommu_attach_blocking_domain,
+	}
+};
+
+static int riscv_iommu_attach_identity_domain(struct iommu_domain *iommu_domain,
+					      struct device *dev)
+{
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+
+	riscv_iommu_dev_set_ctx(dev, 0, 0, true);
+	riscv_iommu_bond_unlink(info->domain, dev, IOMMU_NO_PASID);
+	info->domain = NULL;
+
+	return 0;
+}
+
+static struct iommu_domain riscv_iommu_identity_domain = {
+	.type = IOMMU_DOMAIN_IDENTITY,
+	.ops = &(const struct iommu_domain_ops) {
+		.attach_dev = riscv_iommu_attach_identity_domain,
+	}
+};
+
+static void riscv_iommu_remove_dev_pasid(struct device *dev, ioasid_t pasid)
+{
+	struct iommu_domain *domain;
+
+	domain = iommu_get_domain_for_dev_pasid(dev, pasid, IOMMU_DOMAIN_SVA);
+	if (WARN_ON(IS_ERR(domain)) || !domain)
+		return;
+
+	riscv_iommu_sva_remove_dev_pasid(domain, dev, pasid);
+}
+
+/* Devices */
+
+static int riscv_iommu_enable_iopf(struct device *dev,
+				   struct riscv_iommu_info *info)
+{
+	struct riscv_iommu_device *iommu = info->iommu;
+	struct pci_dev *pdev;
+	int ret;
+
+	/* ATS is only ever enabled on PCI functions. */
+	if (!iommu->iopf || !info->ats_enabled)
+		return -ENODEV;
+
+	pdev = to_pci_dev(dev);
+	if (!pci_pri_supported(pdev))
+		return -ENODEV;
+	if (info->pri_enabled)
+		return -EBUSY;
+
+	ret = iopf_queue_add_device(iommu->iopf, dev);
+	if (ret)
+		return ret;
+
+	mutex_lock(&iommu->devs_lock);
+	info->prg_resp_pasid = pci_prg_resp_pasid_required(pdev);
+	info->pri_enabled = true;
+	mutex_unlock(&iommu->devs_lock);
+	riscv_iommu_iodir_update_tc(dev);
+
+	ret = pci_enable_pri(pdev, RISCV_IOMMU_PRI_REQUESTS);
+	if (ret) {
+		mutex_lock(&iommu->devs_lock);
+		info->pri_enabled = false;
+		info->prg_resp_pasid = false;
+		mutex_unlock(&iommu->devs_lock);
+		riscv_iommu_iodir_update_tc(dev);
+		iopf_queue_remove_device(iommu->iopf, dev);
+	}
+
+	return ret;
+}
+
+static void riscv_iommu_disable_iopf(struct device *dev,
+				     struct riscv_iommu_info *info)
+{
+	struct riscv_iommu_device *iommu = info->iommu;
+
+	pci_disable_pri(to_pci_dev(dev));
+
+	/* Page requests still queued are answered by the IOMMU driver. */
+	mutex_lock(&iommu->devs_lock);
+	info->pri_enabled = false;
+	info->prg_resp_pasid = false;
+	mutex_unlock(&iommu->devs_lock);
+	riscv_iommu_iodir_update_tc(dev);
+
+	iopf_queue_remove_device(iommu->iopf, dev);
+}
+
+static int riscv_iommu_dev_enable_feat(struct device *dev,
+				       enum iommu_dev_features feat)
+{
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+
+	switch (feat) {
+	case IOMMU_DEV_FEAT_IOPF:
+		return riscv_iommu_enable_iopf(dev, info);
+	case IOMMU_DEV_FEAT_SVA:
+		if (!info->pdt_root || !riscv_iommu_sva_supported(info->iommu))
+			return -ENODEV;
+		if (info->sva_enabled)
+			return -EBUSY;
+		info->sva_enabled = true;
+		return 0;
+	default:
+		return -ENODEV;
+	}
+}
+
+static int riscv_iommu_dev_disable_feat(struct device *dev,
+					enum iommu_dev_features feat)
+{
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+
+	switch (feat) {
+	case IOMMU_DEV_FEAT_IOPF:
+		if (!info->pri_enabled)
+			return -EINVAL;
+		if (info->sva_enabled)
+			return -EBUSY;
+		riscv_iommu_disable_iopf(dev, info);
+		return 0;
+	case IOMMU_DEV_FEAT_SVA:
+		if (!info->sva_enabled)
+			return -EINVAL;
+		info->sva_enabled = false;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static void riscv_iommu_enable_pci_caps(struct device *dev,
+					struct riscv_iommu_info *info)
+{
+	struct riscv_iommu_device *iommu = info->iommu;
+	struct pci_dev *pdev = to_pci_dev(dev);
+	int pasids;
+
+	pasids = iommu->pdt_mode ? pci_max_pasids(pdev) : 0;
+	if (pasids > 0) {
+		info->pdt_mode = riscv_iommu_pdt_mode(iommu, pasids);
+		info->pdt_root = (void *)get_zeroed_page(GFP_KERNEL);
+		/* PASID must be enabled before ATS. */
+		if (info->pdt_root &&
+		    (!riscv_iommu_get_pc(info, IOMMU_NO_PASID, true) ||
+		     pci_enable_pasid(pdev, 0))) {
+			riscv_iommu_pdt_free(info->pdt_root, info->pdt_mode -
+					     RISCV_IOMMU_DC_FSC_PDTP_MODE_PD8);
+			info->pdt_root = NULL;
+		}
+	}
+
+	if ((iommu->caps & RISCV_IOMMU_CAPABILITIES_ATS) &&
+	    pci_ats_supported(pdev) && !pci_enable_ats(pdev, PAGE_SHIFT))
+		info->ats_enabled = true;
+}
+
+static struct iommu_device *riscv_iommu_probe_device(struct device *dev)
+{
+	struct iommu_fwspec *fwspec = dev_iommu_fwspec_get(dev);
+	struct riscv_iommu_device *iommu;
+	struct riscv_iommu_info *info;
+	u64 fsc;
+	int i;
+
+	if (!fwspec || !fwspec->num_ids || !fwspec->iommu_fwnode->dev)
+		return ERR_PTR(-ENODEV);
+
+	iommu = dev_get_drvdata(fwspec->iommu_fwnode->dev);
+	if (!iommu)
+		return ERR_PTR(-ENODEV);
+
+	/* Allocate the directory down to the contexts, they start invalid. */
+	for (i = 0; i < fwspec->num_ids; i++) {
+		if (!riscv_iommu_get_dc(iommu, fwspec->ids[i]))
+			return ERR_PTR(-ENODEV);
+	}
+
+	info = kzalloc(sizeof(*info), GFP_KERNEL);
+	if (!info)
+		return ERR_PTR(-ENOMEM);
+
+	info->iommu = iommu;
+	if (dev_is_pci(dev))
+		riscv_iommu_enable_pci_caps(dev, info);
+
+	dev_iommu_priv_set(dev, info);
+
+	mutex_lock(&iommu->devs_lock);
+	for (i = 0; i < fwspec->num_ids; i++)
+		xa_store(&iommu->devs, fwspec->ids[i], dev, GFP_KERNEL);
+	mutex_unlock(&iommu->devs_lock);
+
+	/* With a process directory, the domains only ever touch its contexts. */
+	if (info->pdt_root) {
+		fsc = FIELD_PREP(RISCV_IOMMU_DC_FSC_MODE, info->pdt_mode) |
+		      FIELD_PREP(RISCV_IOMMU_DC_FSC_PPN,
+				 riscv_iommu_virt_to_ppn(info->pdt_root));
+		riscv_iommu_iodir_update(iommu, dev, fsc, 0, riscv_iommu_dc_tc(info));
+	}
+
+	return &iommu->iommu;
+}
+
+static void riscv_iommu_release_device(struct device *dev)
+{
+	struct iommu_fwspec *fwspec = dev_iommu_fwspec_get(dev);
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+	struct riscv_iommu_device *iommu = info->iommu;
+	int i;
+
+	if (info->pri_enabled)
+		riscv_iommu_disable_iopf(dev, info);
+
+	mutex_lock(&iommu->devs_lock);
+	for (i = 0; i < fwspec->num_ids; i++)
+		xa_cmpxchg(&iommu->devs, fwspec->ids[i], dev, NULL, GFP_KERNEL);
+	mutex_unlock(&iommu->devs_lock);
+
+	/* The blocking domain is attached, turn the device contexts off. */
+	riscv_iommu_iodir_update(iommu, dev, 0, 0, 0);
+
+	if (dev_is_pci(dev)) {
+		if (info->ats_enabled)
+			pci_disable_ats(to_pci_dev(dev));
+		if (info->pdt_root)
+			pci_disable_pasid(to_pci_dev(dev));
+	}
+
+	if (info->pdt_root)
+		riscv_iommu_pdt_free(info->pdt_root, info->pdt_mode -
+				     RISCV_IOMMU_DC_FSC_PDTP_MODE_PD8);
+	kfree(info);
+}
+
+static struct iommu_group *riscv_iommu_device_group(struct device *dev)
+{
+	if (dev_is_pci(dev))
+		return pci_device_group(dev);
+
+	return generic_device_group(dev);
+}
+
+static int riscv_iommu_of_xlate(struct device *dev,
+				const struct of_phandle_args *args)
+{
+	return iommu_fwspec_add_ids(dev, args->args, 1);
+}
+
+static bool riscv_iommu_capable(struct device *dev, enum iommu_cap cap)
+{
+	switch (cap) {
+	case IOMMU_CAP_CACHE_COHERENCY:
+		return dev_is_dma_coherent(dev);
+	case IOMMU_CAP_DEFERRED_FLUSH:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static const struct iommu_ops riscv_iommu_ops = {
+	.identity_domain	= &riscv_iommu_identity_domain,
+	.blocked_domain		= &riscv_iommu_blocking_domain,
+	.release_domain		= &riscv_iommu_blocking_domain,
+	.capable		= riscv_iommu_capable,
+	.domain_alloc		= riscv_iommu_domain_alloc,
+	.domain_alloc_paging	= riscv_iommu_alloc_paging_domain,
+	.probe_device		= riscv_iommu_probe_device,
+	.release_device		= riscv_iommu_release_device,
+	.device_group		= riscv_iommu_device_group,
+	.of_xlate		= riscv_iommu_of_xlate,
+	.remove_dev_pasid	= riscv_iommu_remove_dev_pasid,
+	.dev_enable_feat	= riscv_iommu_dev_enable_feat,
+	.dev_disable_feat	= riscv_iommu_dev_disable_feat,
+	.page_response		= riscv_iommu_page_response,
+	.pgsize_bitmap		= SZ_4K | SZ_2M | SZ_1G,
+};
+
+/* Probing and initialisation */
+
+static int riscv_iommu_init_check(struct riscv_iommu_device *iommu)
+{
+	u64 pas = FIELD_GET(RISCV_IOMMU_CAPABILITIES_PAS, iommu->caps);
+	unsigned int mode;
+
+	if (FIELD_GET(RISCV_IOMMU_CAPABILITIES_VERSION, iommu->caps) >> 4 != 1) {
+		dev_err(iommu->dev, "unsupported specification version 0x%llx\n",
+			FIELD_GET(RISCV_IOMMU_CAPABILITIES_VERSION, iommu->caps));
+		return -ENODEV;
+	}
+
+	/* Little-endian data structures, and the interrupts the glue wants. */
+	riscv_iommu_writel(iommu, RISCV_IOMMU_REG_FCTL, iommu->fctl);
+	if (riscv_iommu_readl(iommu, RISCV_IOMMU_REG_FCTL) != iommu->fctl) {
+		dev_err(iommu->dev, "unsupported features control 0x%x\n",
+			iommu->fctl);
+		return -ENODEV;
+	}
+
+	/* Match the CPU format when possible, SVA needs it anyway. */
+	iommu->pgd_mode = satp_mode >> SATP_MODE_SHIFT;
+	for (mode = RISCV_IOMMU_IOSATP_MODE_SV57;
+	     !riscv_iommu_pgd_mode_supported(iommu, iommu->pgd_mode) &&
+	     mode >= RISCV_IOMMU_IOSATP_MODE_SV39; mode--)
+		iommu->pgd_mode = mode;
+	if (!riscv_iommu_pgd_mode_supported(iommu, iommu->pgd_mode)) {
+		dev_err(iommu->dev, "no supported page table format\n");
+		return -ENODEV;
+	}
+
+	for (mode = RISCV_IOMMU_DC_FSC_PDTP_MODE_PD20;
+	     mode >= RISCV_IOMMU_DC_FSC_PDTP_MODE_PD8; mode--) {
+		if (riscv_iommu_pdt_mode_supported(iommu, mode)) {
+			iommu->pdt_mode = mode;
+			iommu->iommu.max_pasids = BIT(riscv_iommu_pdt_bits[mode]);
+			break;
+		}
+	}
+
+	return dma_set_mask_and_coherent(iommu->dev, DMA_BIT_MASK(pas ? : 56));
+}
+
+int riscv_iommu_init(struct riscv_iommu_device *iommu)
+{
+	u64 icvec;
+	int ret;
+
+	xa_init(&iommu->devs);
+	mutex_init(&iommu->devs_lock);
+
+	riscv_iommu_queue_init(iommu, &iommu->cmdq, RISCV_IOMMU_INTR_CQ,
+			       RISCV_IOMMU_REG_CQB, RISCV_IOMMU_REG_CQCSR,
+			       sizeof(struct riscv_iommu_command));
+	riscv_iommu_queue_init(iommu, &iommu->fltq, RISCV_IOMMU_INTR_FQ,
+			       RISCV_IOMMU_REG_FQB, RISCV_IOMMU_REG_FQCSR,
+			       sizeof(struct riscv_iommu_fq_record));
+	riscv_iommu_queue_init(iommu, &iommu->priq, RISCV_IOMMU_INTR_PQ,
+			       RISCV_IOMMU_REG_PQB, RISCV_IOMMU_REG_PQCSR,
+			       sizeof(struct riscv_iommu_pq_record));
+
+	ret = riscv_iommu_init_check(iommu);
+	if (ret)
+		return dev_err_probe(iommu->dev, ret, "unexpected device state\n");
+
+	/* A previous kernel may have left translation on, start from scratch. */
+	riscv_iommu_writel(iommu, RISCV_IOMMU_REG_CQCSR, 0);
+	riscv_iommu_writel(iommu, RISCV_IOMMU_REG_FQCSR, 0);
+	riscv_iommu_writel(iommu, RISCV_IOMMU_REG_PQCSR, 0);
+	ret = riscv_iommu_iodir_set_mode(iommu, RISCV_IOMMU_DDTP_IOMMU_MODE_OFF);
+	if (ret)
+		return ret;
+
+	/* The vector fields are WARL, fewer vectors may be implemented. */
+	icvec = FIELD_PREP(RISCV_IOMMU_ICVEC_CIV, RISCV_IOMMU_INTR_CQ % iommu->irqs_count) |
+		FIELD_PREP(RISCV_IOMMU_ICVEC_FIV, RISCV_IOMMU_INTR_FQ % iommu->irqs_count) |
+		FIELD_PREP(RISCV_IOMMU_ICVEC_PMIV, RISCV_IOMMU_INTR_PM % iommu->irqs_count) |
+		FIELD_PREP(RISCV_IOMMU_ICVEC_PIV, RISCV_IOMMU_INTR_PQ % iommu->irqs_count);
+	riscv_iommu_writeq(iommu, RISCV_IOMMU_REG_ICVEC, icvec);
+	iommu->icvec = riscv_iommu_readq(iommu, RISCV_IOMMU_REG_ICVEC);
+
+	ret = riscv_iommu_queue_alloc(iommu, &iommu->cmdq, RISCV_IOMMU_CMDQ_LOG2SZ);
+	if (ret)
+		return ret;
+	ret = riscv_iommu_queue_alloc(iommu, &iommu->fltq, RISCV_IOMMU_FLTQ_LOG2SZ);
+	if (ret)
+		return ret;
+	if (iommu->caps & RISCV_IOMMU_CAPABILITIES_ATS) {
+		ret = riscv_iommu_queue_alloc(iommu, &iommu->priq,
+					      RISCV_IOMMU_PRIQ_LOG2SZ);
+		if (ret)
+			return ret;
+	}
+
+	ret = riscv_iommu_queue_enable(iommu, &iommu->cmdq, riscv_iommu_cmdq_process);
+	if (ret)
+		return ret;
+	ret = riscv_iommu_queue_enable(iommu, &iommu->fltq, riscv_iommu_fltq_process);
+	if (ret)
+		goto err_queue_disable;
+	if (iommu->caps & RISCV_IOMMU_CAPABILITIES_ATS) {
+		ret = riscv_iommu_queue_enable(iommu, &iommu->priq,
+					       riscv_iommu_priq_process);
+		if (ret)
+			goto err_queue_disable;
+
+		if (IS_ENABLED(CONFIG_RISCV_IOMMU_SVA)) {
+			iommu->iopf = iopf_queue_alloc(dev_name(iommu->dev));
+			if (!iommu->iopf) {
+				ret = -ENOMEM;
+				goto err_queue_disable;
+			}
+		}
+	}
+
+	ret = riscv_iommu_iodir_init(iommu);
+	if (ret)
+		goto err_iopf_free;
+
+	ret = iommu_device_sysfs_add(&iommu->iommu, NULL, NULL, "riscv-iommu@%s",
+				     dev_name(iommu->dev));
+	if (ret) {
+		dev_err_probe(iommu->dev, ret, "cannot register sysfs interface\n");
+		goto err_iodir_off;
+	}
+
+	ret = iommu_device_register(&iommu->iommu, &riscv_iommu_ops, iommu->dev);
+	if (ret) {
+		dev_err_probe(iommu->dev, ret, "cannot register iommu interface\n");
+		goto err_remove_sysfs;
+	}
+
+	return 0;
+
+err_remove_sysfs:
+	iommu_device_sysfs_remove(&iommu->iommu);
+err_iodir_off:
+	riscv_iommu_iodir_set_mode(iommu, RISCV_IOMMU_DDTP_IOMMU_MODE_OFF);
+err_iopf_free:
+	iopf_queue_free(iommu->iopf);
+err_queue_disable:
+	riscv_iommu_queue_disable(iommu, &iommu->priq);
+	riscv_iommu_queue_disable(iommu, &iommu->fltq);
+	riscv_iommu_queue_disable(iommu, &iommu->cmdq);
+	return ret;
+}
+
+void riscv_iommu_remove(struct riscv_iommu_device *iommu)
+{
+	iommu_device_unregister(&iommu->iommu);
+	iommu_device_sysfs_remove(&iommu->iommu);
+	riscv_iommu_iodir_set_mode(iommu, RISCV_IOMMU_DDTP_IOMMU_MODE_OFF);
+	iopf_queue_free(iommu->iopf);
+	riscv_iommu_queue_disable(iommu, &iommu->priq);
+	riscv_iommu_queue_disable(iommu, &iommu->fltq);
+	riscv_iommu_queue_disable(iommu, &iommu->cmdq);
+}
@@ -0,0 +1,212 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * IOMMU API for RISC-V IOMMU implementations.
+ */
+
+#ifndef _RISCV_IOMMU_H_
+#define _RISCV_IOMMU_H_
+
+#include <linux/iommu.h>
+#include <linux/mmu_notifier.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/types.h>
+#include <linux/xarray.h>
+
+#include "iommu-bits.h"
+
+/* Requested queue sizes, the hardware may only support smaller ones. */
+#define RISCV_IOMMU_CMDQ_LOG2SZ		10
+#define RISCV_IOMMU_FLTQ_LOG2SZ		10
+#define RISCV_IOMMU_PRIQ_LOG2SZ		10
+
+/* Commands accumulated before they are written to the command queue. */
+#define RISCV_IOMMU_CMD_BATCH_SIZE	32
+
+struct riscv_iommu_device;
+
+struct riscv_iommu_queue {
+	struct riscv_iommu_device *iommu;
+	void *base;			/* ring buffer, in coherent memory */
+	dma_addr_t phys;
+	unsigned int mask;		/* number of entries - 1 */
+	unsigned int entry_size;
+	/* Free running indices, the hardware registers hold them & mask. */
+	unsigned int head;
+	unsigned int tail;
+	unsigned int qbr;		/* base, head, tail and CSR registers */
+	unsigned int qhr;
+	unsigned int qtr;
+	unsigned int qcr;
+	unsigned int qid;		/* interrupt cause, RISCV_IOMMU_INTR_* */
+	unsigned int irq;
+	spinlock_t lock;		/* command queue producers */
+};
+
+/*
+ * The bus glue fills in dev, reg, caps, fctl and the interrupts before
+ * calling riscv_iommu_init().
+ */
+struct riscv_iommu_device {
+	struct iommu_device iommu;
+	struct device *dev;
+	void __iomem *reg;
+
+	u64 caps;
+	u32 fctl;
+
+	/* Wired interrupts or MSI-X vectors, indexed by vector number. */
+	unsigned int irqs[RISCV_IOMMU_INTR_COUNT];
+	unsigned int irqs_count;
+	unsigned int icvec;
+
+	struct riscv_iommu_queue cmdq;
+	struct riscv_iommu_queue fltq;
+	struct riscv_iommu_queue priq;
+
+	/* Device directory */
+	unsigned int ddt_mode;
+	void *ddt_root;
+
+	/* Process directory format for PASID capable devices, 0 if none. */
+	unsigned int pdt_mode;
+	/* First-stage page table format used by paging domains. */
+	unsigned int pgd_mode;
+
+	/* Devices by device ID, to route page requests. */
+	struct xarray devs;
+	struct mutex devs_lock;
+	struct iopf_queue *iopf;
+};
+
+struct riscv_iommu_domain {
+	struct iommu_domain domain;
+	/* Attached devices, RCU protected for the invalidation paths. */
+	struct list_head bonds;
+	spinlock_t lock;		/* protects bonds updates */
+	int pscid;
+	int numa_node;
+	unsigned int pgd_mode;		/* iosatp.MODE */
+	u64 *pgd_root;
+	struct mmu_notifier mn;		/* SVA domains only */
+};
+
+#define iommu_domain_to_riscv(iommu_domain) \
+	container_of(iommu_domain, struct riscv_iommu_domain, domain)
+
+/* A device, or one PASID of a device, attached to a domain. */
+struct riscv_iommu_bond {
+	struct list_head list;
+	struct rcu_head rcu;
+	struct device *dev;
+	ioasid_t pasid;
+};
+
+/* Per device state, dev_iommu_priv. */
+struct riscv_iommu_info {
+	struct riscv_iommu_device *iommu;
+	struct riscv_iommu_domain *domain;	/* attached paging domain */
+	/* Process directory, NULL if the device does not use PASIDs. */
+	void *pdt_root;
+	unsigned int pdt_mode;
+	bool ats_enabled;
+	bool pri_enabled;
+	bool prg_resp_pasid;
+	bool sva_enabled;
+};
+
+static inline struct riscv_iommu_device *dev_to_riscv_iommu(struct device *dev)
+{
+	struct riscv_iommu_info *info = dev_iommu_priv_get(dev);
+
+	return info->iommu;
+}
+
+static inline bool riscv_iommu_pgd_mode_supported(struct riscv_iommu_device *iommu,
+						  unsigned int pgd_mode)
+{
+	switch (pgd_mode) {
+	case RISCV_IOMMU_IOSATP_MODE_SV39:
+		return iommu->caps & RISCV_IOMMU_CAPABILITIES_SV39;
+	case RISCV_IOMMU_IOSATP_MODE_SV48:
+		return iommu->caps & RISCV_IOMMU_CAPABILITIES_SV48;
+	case RISCV_IOMMU_IOSATP_MODE_SV57:
+		return iommu->caps & RISCV_IOMMU_CAPABILITIES_SV57;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Commands for one IOMMU, written to its queue with a single doorbell and
+ * one IOFENCE.C. Switching to another IOMMU submits what was gathered.
+ */
+struct riscv_iommu_cmd_batch {
+	struct riscv_iommu_device *iommu;	/* NULL when nothing is pending */
+	unsigned int num;
+	struct riscv_iommu_command cmds[RISCV_IOMMU_CMD_BATCH_SIZE];
+};
+
+int riscv_iommu_init(struct riscv_iommu_device *iommu);
+void riscv_iommu_remove(struct riscv_iommu_device *iommu);
+
+void riscv_iommu_batch_add(struct riscv_iommu_cmd_batch *batch,
+			   struct riscv_iommu_device *iommu,
+			   struct riscv_iommu_command *cmd);
+void riscv_iommu_batch_submit(struct riscv_iommu_cmd_batch *batch);
+
+void riscv_iommu_iotlb_inval(struct riscv_iommu_domain *domain,
+			     unsigned long start, unsigned long end,
+			     size_t pgsize);
+int riscv_iommu_pc_update(struct device *dev, ioasid_t pasid, u64 fsc, u64 ta);
+int riscv_iommu_bond_link(struct riscv_iommu_domain *domain,
+			  struct device *dev, ioasid_t pasid);
+void riscv_iommu_bond_unlink(struct riscv_iommu_domain *domain,
+			     struct device *dev, ioasid_t pasid);
+int riscv_iommu_alloc_pscid(void);
+void riscv_iommu_free_pscid(int pscid);
+
+#ifdef CONFIG_RISCV_IOMMU_SVA
+struct iommu_domain *riscv_iommu_sva_domain_alloc(void);
+void riscv_iommu_sva_remove_dev_pasid(struct iommu_domain *domain,
+				      struct device *dev, ioasid_t pasid);
+bool riscv_iommu_sva_supported(struct riscv_iommu_device *iommu);
+#else
+static inline struct iommu_domain *riscv_iommu_sva_domain_alloc(void)
+{
+	return ERR_PTR(-EOPNOTSUPP);
+}
+
+static inline void
+riscv_iommu_sva_remove_dev_pasid(struct iommu_domain *domain,
+				 struct device *dev, ioasid_t pasid)
+{
+}
+
+static inline bool riscv_iommu_sva_supported(struct riscv_iommu_device *iommu)
+{
+	return false;
+}
+#endif /* CONFIG_RISCV_IOMMU_SVA */
+
+#define riscv_iommu_readl(iommu, addr) \
+	readl_relaxed((iommu)->reg + (addr))
+
+#define riscv_iommu_readq(iommu, addr) \
+	readq_relaxed((iommu)->reg + (addr))
+
+#define riscv_iommu_writel(iommu, addr, val) \
+	writel_relaxed((val), (iommu)->reg + (addr))
+
+#define riscv_iommu_writeq(iommu, addr, val) \
+	writeq_relaxed((val), (iommu)->reg + (addr))
+
+#define riscv_iommu_readq_timeout(iommu, addr, val, cond, delay_us, timeout_us) \
+	readx_poll_timeout(readq_relaxed, (iommu)->reg + (addr), val, cond, \
+			   delay_us, timeout_us)
+
+#define riscv_iommu_readl_timeout(iommu, addr, val, cond, delay_us, timeout_us) \
+	readx_poll_timeout(readl_relaxed, (iommu)->reg + (addr), val, cond, \
+			   delay_us, timeout_us)
+
+#endif /* _RISCV_IOMMU_H_ */
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * RISC-V ACLINT supervisor-level software interrupt (SSWI) device
+ *
+ * Each hart has a SETSSIP register; writing one to it raises the
+ * supervisor software interrupt of that hart without going through
+ * the SBI firmware.
+ */
+
+#define pr_fmt(fmt) "riscv-aclint-sswi: " fmt
+#include <linux/cpu.h>
+#include <linux/cpuhotplug.h>
+#include <linux/init.h>
+#include <linux/interrupt.h>
+#include <linux/io.h>
+#include <linux/irq.h>
+#include <linux/irqchip.h>
+#include <linux/irqchip/chained_irq.h>
+#include <linux/irqdomain.h>
+#include <linux/of.h>
+#include <linux/of_address.h>
+#include <linux/of_irq.h>
+#include <linux/smp.h>
+
+#define ACLINT_SSWI_REGISTER_SIZE	4
+
+static int sswi_ipi_virq __ro_after_init;
+static DEFINE_PER_CPU(void __iomem *, sswi_cpu_regs);
+
+static void aclint_sswi_ipi_send(unsigned int cpu)
+{
+	writel(0x1, per_cpu(sswi_cpu_regs, cpu));
+}
+
+static void aclint_sswi_ipi_handle(struct irq_desc *desc)
+{
+	struct irq_chip *chip = irq_desc_get_chip(desc);
+
+	chained_irq_enter(chip, desc);
+
+	csr_clear(CSR_IP, IE_SIE);
+	ipi_mux_process();
+
+	chained_irq_exit(chip, desc);
+}
+
+static int aclint_sswi_starting_cpu(unsigned int cpu)
+{
+	enable_percpu_irq(sswi_ipi_virq, irq_get_trigger_type(sswi_ipi_virq));
+	return 0;
+}
+
+static int __init aclint_sswi_parse_irq(struct device_node *node, void __iomem *reg)
+{
+	struct of_phandle_args parent;
+	unsigned long hartid;
+	u32 contexts, i;
+	int rc, cpu;
+
+	contexts = of_irq_count(node);
+	if (!contexts) {
+		pr_err("%pOF: no ACLINT SSWI context available\n", node);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < contexts; i++) {
+		rc = of_irq_parse_one(node, i, &parent);
+		if (rc)
+			return rc;
+
+		rc = riscv_of_parent_hartid(parent.np, &hartid);
+		if (rc)
+			return rc;
+
+		if (parent.args[0] != RV_IRQ_SOFT)
+			return -ENOTSUPP;
+
+		cpu = riscv_hartid_to_cpuid(hartid);
+		if (cpu < 0) {
+			pr_warn("%pOF: invalid cpuid for context %d\n", node, i);
+			continue;
+		}
+
+		per_cpu(sswi_cpu_regs, cpu) = reg + i * ACLINT_SSWI_REGISTER_SIZE;
+	}
+
+	pr_info("%pOF: registered %u contexts\n", node, contexts);
+
+	return 0;
+}
+
+/*
+ * The IMSIC provides IPIs as well and takes precedence. Its node may come
+ * after ours, so it may not have registered its IPIs yet.
+ */
+static bool __init aclint_sswi_have_imsic(void)
+{
+	struct device_node *np;
+
+	for_each_compatible_node(np, NULL, "riscv,imsics") {
+		if (of_device_is_available(np)) {
+			of_node_put(np);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int __init aclint_sswi_init(struct device_node *node,
+				   struct device_node *parent)
+{
+	struct irq_domain *domain;
+	void __iomem *reg;
+	int virq, rc;
+
+	/* Another native IPI provider (such as the IMSIC) was probed first */
+	if (riscv_ipi_have_virq_range() && !sswi_ipi_virq)
+		return 0;
+
+	if (aclint_sswi_have_imsic()) {
+		pr_info("%pOF: IMSIC present, not using SSWI for IPIs\n", node);
+		return 0;
+	}
+
+	reg = of_iomap(node, 0);
+	if (!reg)
+		return -ENOMEM;
+
+	rc = aclint_sswi_parse_irq(node, reg);
+	if (rc < 0) {
+		iounmap(reg);
+		return rc;
+	}
+
+	/* Multiple SSWI devices share a single IPI mux */
+	if (sswi_ipi_virq)
+		return 0;
+
+	domain = irq_find_matching_fwnode(riscv_get_intc_hwnode(), DOMAIN_BUS_ANY);
+	if (!domain) {
+		pr_err("%pOF: failed to find INTC domain\n", node);
+		return -ENOENT;
+	}
+
+	sswi_ipi_virq = irq_create_mapping(domain, RV_IRQ_SOFT);
+	if (!sswi_ipi_virq) {
+		pr_err("unable to create ACLINT SSWI IRQ mapping\n");
+		return -ENOMEM;
+	}
+
+	virq = ipi_mux_create(BITS_PER_BYTE, aclint_sswi_ipi_send);
+	if (virq <= 0) {
+		pr_err("unable to create muxed IPIs\n");
+		irq_dispose_mapping(sswi_ipi_virq);
+		sswi_ipi_virq = 0;
+		return virq < 0 ? virq : -ENOMEM;
+	}
+
+	irq_set_chained_handler(sswi_ipi_virq, aclint_sswi_ipi_handle);
+
+	/*
+	 * Don't disable IPI when CPU goes offline because
+	 * the masking/unmasking of virtual IPIs is done
+	 * via generic IPI-Mux
+	 */
+	cpuhp_setup_state(CPUHP_AP_IRQ_RISCV_ACLINT_SSWI_STARTING,
+			  "irqchip/riscv/aclint-sswi:starting",
+			  aclint_sswi_starting_cpu, NULL);
+
+	/* IPIs no longer trap to firmware, so use them for remote fences too */
+	riscv_ipi_set_virq_range(virq, BITS_PER_BYTE, true);
+
+	pr_info("providing IPIs using ACLINT SSWI\n");
+
+	return 0;
+}
+
+IRQCHIP_DECLARE(riscv_aclint_sswi, "riscv,aclint-sswi", aclint_sswi_init);
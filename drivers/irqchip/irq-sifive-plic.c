@@ -15,6 +15,7 @@
 #include <linux/of_address.h>
 #include <linux/of_irq.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 #include <linux/spinlock.h>
 #include <linux/syscore_ops.h>
 #include <asm/smp.h>
@@ -83,6 +84,14 @@ struct plic_handler {
 	void __iomem		*enable_base;
 	u32			*enable_save;
 	struct plic_priv	*priv;
+	/*
+	 * Claim statistics, only updated by the CPU owning this context
+	 * from its chained handler.
+	 */
+	unsigned long		nr_entries;
+	unsigned long		nr_claims;
+	unsigned long		nr_spurious;
+	unsigned long		max_batch;
 };
 static int plic_parent_irq __ro_after_init;
 static bool plic_cpuhp_setup_done __ro_after_init;
@@ -354,23 +363,66 @@ static int plic_irq_domain_alloc(struct irq_domain *domain, unsigned int virq,
 	return 0;
 }
 
+#ifdef CONFIG_GENERIC_IRQ_DEBUGFS
+static void plic_irq_domain_debug_show(struct seq_file *m, struct irq_domain *d,
+				       struct irq_data *irqd, int ind)
+{
+	struct plic_handler *handler;
+	int cpu;
+
+	/* Only the domain entry carries per-context statistics */
+	if (!d || irqd)
+		return;
+
+	for_each_present_cpu(cpu) {
+		handler = per_cpu_ptr(&plic_handlers, cpu);
+		if (!handler->present || handler->priv != d->host_data)
+			continue;
+
+		seq_printf(m, "%*scpu%d: entries %lu claims %lu spurious %lu max_batch %lu\n",
+			   ind, "", cpu, READ_ONCE(handler->nr_entries),
+			   READ_ONCE(handler->nr_claims),
+			   READ_ONCE(handler->nr_spurious),
+			   READ_ONCE(handler->max_batch));
+	}
+}
+#endif
+
 static const struct irq_domain_ops plic_irqdomain_ops = {
 	.translate	= plic_irq_domain_translate,
 	.alloc		= plic_irq_domain_alloc,
 	.free		= irq_domain_free_irqs_top,
+#ifdef CONFIG_GENERIC_IRQ_DEBUGFS
+	.debug_show	= plic_irq_domain_debug_show,
+#endif
 };
 
+static void plic_account_claims(struct plic_handler *handler, unsigned long batch)
+{
+	WRITE_ONCE(handler->nr_entries, handler->nr_entries + 1);
+	WRITE_ONCE(handler->nr_claims, handler->nr_claims + batch);
+	if (unlikely(!batch))
+		WRITE_ONCE(handler->nr_spurious, handler->nr_spurious + 1);
+	if (batch > handler->max_batch)
+		WRITE_ONCE(handler->max_batch, batch);
+}
+
 /*
  * Handling an interrupt is a two-step process: first you claim the interrupt
  * by reading the claim register, then you complete the interrupt by writing
  * that source ID back to the same claim register.  This automatically enables
  * and disables the interrupt, so there's nothing else to do.
+ *
+ * Every source that became pending while the previous ones were handled is
+ * claimed before returning, so a burst costs one parent interrupt and one
+ * final empty claim rather than a trap per source.
  */
 static void plic_handle_irq(struct irq_desc *desc)
 {
 	struct plic_handler *handler = this_cpu_ptr(&plic_handlers);
 	struct irq_chip *chip = irq_desc_get_chip(desc);
 	void __iomem *claim = handler->hart_base + CONTEXT_CLAIM;
+	unsigned long batch = 0;
 	irq_hw_number_t hwirq;
 
 	WARN_ON_ONCE(!handler->present);
@@ -384,8 +436,11 @@ static void plic_handle_irq(struct irq_desc *desc)
 			dev_warn_ratelimited(handler->priv->dev,
 					     "can't find mapping for hwirq %lu\n", hwirq);
 		}
+		batch++;
 	}
 
+	plic_account_claims(handler, batch);
+
 	chained_irq_exit(chip, desc);
 }
 
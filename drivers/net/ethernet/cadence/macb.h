@@ -8,11 +8,13 @@
 #define _MACB_H
 
 #include <linux/clk.h>
+#include <linux/dim.h>
 #include <linux/phylink.h>
 #include <linux/ptp_clock_kernel.h>
 #include <linux/net_tstamp.h>
 #include <linux/interrupt.h>
 #include <linux/phy/phy.h>
+#include <net/xdp.h>
 
 #if defined(CONFIG_ARCH_DMA_ADDR_T_64BIT) || defined(CONFIG_MACB_USE_HWSTAMP)
 #define MACB_EXT_DESC
@@ -85,6 +87,7 @@
 #define GEM_PBUFRXCUT		0x0044 /* RX Partial Store and Forward */
 #define GEM_JML			0x0048 /* Jumbo Max Length */
 #define GEM_HS_MAC_CONFIG	0x0050 /* GEM high speed config */
+#define GEM_IMOD		0x005c /* Interrupt Moderation */
 #define GEM_HRB			0x0080 /* Hash Bottom */
 #define GEM_HRT			0x0084 /* Hash Top */
 #define GEM_SA1B		0x0088 /* Specific1 Bottom */
@@ -500,6 +503,12 @@
 #define GEM_HS_MAC_SPEED_OFFSET			0
 #define GEM_HS_MAC_SPEED_SIZE			3
 
+/* Bitfields in IMOD, in units of 800 ns */
+#define GEM_RXMOD_OFFSET			0
+#define GEM_RXMOD_SIZE				8
+#define GEM_TXMOD_OFFSET			16
+#define GEM_TXMOD_SIZE				8
+
 /* Bitfields in PCSCNTRL */
 #define GEM_PCSAUTONEG_OFFSET			12
 #define GEM_PCSAUTONEG_SIZE			1
@@ -733,6 +742,7 @@
 #define MACB_CAPS_NEEDS_RSTONUBR		0x00000100
 #define MACB_CAPS_MIIONRGMII			0x00000200
 #define MACB_CAPS_NEED_TSUCLK			0x00000400
+#define MACB_CAPS_IRQ_MOD			0x00000800
 #define MACB_CAPS_PCS				0x01000000
 #define MACB_CAPS_HIGH_SPEED			0x02000000
 #define MACB_CAPS_CLK_HW_CHG			0x04000000
@@ -926,19 +936,30 @@ struct macb_dma_desc_ptp {
 /* Scaled PPM fraction */
 #define PPM_FRACTION	16
 
+enum macb_tx_buff_type {
+	MACB_TYPE_SKB,
+	MACB_TYPE_XDP_TX,	/* frame in one of our page pool pages */
+	MACB_TYPE_XDP_NDO,	/* frame mapped by ndo_xdp_xmit() */
+};
+
 /* struct macb_tx_skb - data about an skb which is being transmitted
  * @skb: skb currently being transmitted, only set for the last buffer
  *       of the frame
+ * @xdpf: XDP frame currently being transmitted, set instead of @skb
  * @mapping: DMA address of the skb's fragment buffer
  * @size: size of the DMA mapped buffer
  * @mapped_as_page: true when buffer was mapped with skb_frag_dma_map(),
  *                  false when buffer was mapped with dma_map_single()
+ * @type: what the buffer belongs to, MACB_TYPE_XDP_TX buffers are mapped
+ *        by the RX page pool
  */
 struct macb_tx_skb {
 	struct sk_buff		*skb;
+	struct xdp_frame	*xdpf;
 	dma_addr_t		mapping;
 	size_t			size;
 	bool			mapped_as_page;
+	enum macb_tx_buff_type	type;
 };
 
 /* Hardware-collected statistics. Used when updating the network
@@ -1230,10 +1251,18 @@ struct macb_queue {
 	unsigned int		rx_tail;
 	unsigned int		rx_prepared_head;
 	struct macb_dma_desc	*rx_ring;
-	struct sk_buff		**rx_skbuff;
+	struct page		**rx_pages;
+	struct page_pool	*page_pool;
+	struct xdp_rxq_info	xdp_rxq;
 	void			*rx_buffers;
 	struct napi_struct	napi_rx;
 	struct queue_stats stats;
+
+	/* Adaptive interrupt moderation, events count the interrupts */
+	struct dim		rx_dim;
+	struct dim		tx_dim;
+	u16			rx_dim_events;
+	u16			tx_dim_events;
 };
 
 struct ethtool_rx_fs_item {
@@ -1329,6 +1358,14 @@ struct macb {
 
 	u32	rx_intr_mask;
 
+	/* interrupt moderation set through ethtool -C */
+	u32	rx_coalesce_usecs;
+	u32	tx_coalesce_usecs;
+	bool	rx_dim_enabled;
+	bool	tx_dim_enabled;
+
+	struct bpf_prog		*xdp_prog;
+
 	struct macb_pm_data pm_data;
 	const struct macb_usrio_config *usrio;
 };
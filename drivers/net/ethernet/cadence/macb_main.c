@@ -38,6 +38,9 @@
 #include <linux/ptp_classify.h>
 #include <linux/reset.h>
 #include <linux/firmware/xlnx-zynqmp.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <net/page_pool/helpers.h>
 #include "macb.h"
 
 /* This structure is only used for MACB on SiFive FU540 devices */
@@ -50,6 +53,12 @@ struct sifive_fu540_macb_mgmt {
 #define MACB_RX_BUFFER_SIZE	128
 #define RX_BUFFER_MULTIPLE	64  /* bytes */
 
+/* GEM receives into page pool pages, leaving room for XDP in front */
+#define GEM_RX_HEADROOM		XDP_PACKET_HEADROOM
+
+#define GEM_XDP_TX		BIT(0)
+#define GEM_XDP_REDIRECT	BIT(1)
+
 #define DEFAULT_RX_RING_SIZE	512 /* must be power of 2 */
 #define MIN_RX_RING_SIZE	64
 #define MAX_RX_RING_SIZE	8192
@@ -1032,7 +1041,7 @@ static void macb_tx_unmap(struct macb *bp, struct macb_tx_skb *tx_skb, int budge
 		if (tx_skb->mapped_as_page)
 			dma_unmap_page(&bp->pdev->dev, tx_skb->mapping,
 				       tx_skb->size, DMA_TO_DEVICE);
-		else
+		else if (tx_skb->type != MACB_TYPE_XDP_TX)
 			dma_unmap_single(&bp->pdev->dev, tx_skb->mapping,
 					 tx_skb->size, DMA_TO_DEVICE);
 		tx_skb->mapping = 0;
@@ -1042,6 +1051,11 @@ static void macb_tx_unmap(struct macb *bp, struct macb_tx_skb *tx_skb, int budge
 		napi_consume_skb(tx_skb->skb, budget);
 		tx_skb->skb = NULL;
 	}
+
+	if (tx_skb->xdpf) {
+		xdp_return_frame(tx_skb->xdpf);
+		tx_skb->xdpf = NULL;
+	}
 }
 
 static void macb_set_addr(struct macb *bp, struct macb_dma_desc *desc, dma_addr_t addr)
@@ -1131,8 +1145,8 @@ static void macb_tx_error_task(struct work_struct *work)
 		skb = tx_skb->skb;
 
 		if (ctrl & MACB_BIT(TX_USED)) {
-			/* skb is set for the last buffer of the frame */
-			while (!skb) {
+			/* skb or xdpf is set for the last buffer of the frame */
+			while (!skb && !tx_skb->xdpf) {
 				macb_tx_unmap(bp, tx_skb, 0);
 				tail++;
 				tx_skb = macb_tx_skb(queue, tail);
@@ -1143,13 +1157,15 @@ static void macb_tx_error_task(struct work_struct *work)
 			 * since it's the only one written back by the hardware
 			 */
 			if (!(ctrl & MACB_BIT(TX_BUF_EXHAUSTED))) {
-				netdev_vdbg(bp->dev, "txerr skb %u (data %p) TX complete\n",
-					    macb_tx_ring_wrap(bp, tail),
-					    skb->data);
+				unsigned int len = skb ? skb->len :
+						   tx_skb->xdpf->len;
+
+				netdev_vdbg(bp->dev, "txerr buffer %u TX complete\n",
+					    macb_tx_ring_wrap(bp, tail));
 				bp->dev->stats.tx_packets++;
 				queue->stats.tx_packets++;
-				bp->dev->stats.tx_bytes += skb->len;
-				queue->stats.tx_bytes += skb->len;
+				bp->dev->stats.tx_bytes += len;
+				queue->stats.tx_bytes += len;
 			}
 		} else {
 			/* "Buffers exhausted mid-frame" errors may only happen
@@ -1183,6 +1199,8 @@ static void macb_tx_error_task(struct work_struct *work)
 	/* Make TX ring reflect state of hardware */
 	queue->tx_head = 0;
 	queue->tx_tail = 0;
+	netdev_tx_reset_queue(netdev_get_tx_queue(bp->dev,
+						  queue - bp->queues));
 
 	/* Housework before enabling TX IRQ */
 	macb_writel(bp, TSR, macb_readl(bp, TSR));
@@ -1229,10 +1247,25 @@ static bool ptp_one_step_sync(struct sk_buff *skb)
 	return false;
 }
 
+static void macb_tx_start(struct macb *bp)
+{
+	unsigned long flags;
+
+	/* Make newly initialized descriptors visible to hardware */
+	wmb();
+
+	spin_lock_irqsave(&bp->lock, flags);
+	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
+	spin_unlock_irqrestore(&bp->lock, flags);
+}
+
 static int macb_tx_complete(struct macb_queue *queue, int budget)
 {
 	struct macb *bp = queue->bp;
 	u16 queue_index = queue - bp->queues;
+	unsigned int skb_packets = 0;
+	unsigned int skb_bytes = 0;
+	unsigned int bytes = 0;
 	unsigned int tail;
 	unsigned int head;
 	int packets = 0;
@@ -1242,6 +1275,7 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 	for (tail = queue->tx_tail; tail != head && packets < budget; tail++) {
 		struct macb_tx_skb	*tx_skb;
 		struct sk_buff		*skb;
+		struct xdp_frame	*xdpf;
 		struct macb_dma_desc	*desc;
 		u32			ctrl;
 
@@ -1262,6 +1296,7 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 		for (;; tail++) {
 			tx_skb = macb_tx_skb(queue, tail);
 			skb = tx_skb->skb;
+			xdpf = tx_skb->xdpf;
 
 			/* First, update TX stats if needed */
 			if (skb) {
@@ -1272,26 +1307,39 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 				netdev_vdbg(bp->dev, "skb %u (data %p) TX complete\n",
 					    macb_tx_ring_wrap(bp, tail),
 					    skb->data);
-				bp->dev->stats.tx_packets++;
-				queue->stats.tx_packets++;
-				bp->dev->stats.tx_bytes += skb->len;
-				queue->stats.tx_bytes += skb->len;
+				skb_packets++;
+				skb_bytes += skb->len;
+				packets++;
+				bytes += skb->len;
+			} else if (xdpf) {
 				packets++;
+				bytes += xdpf->len;
 			}
 
 			/* Now we can safely release resources */
 			macb_tx_unmap(bp, tx_skb, budget);
 
-			/* skb is set only for the last buffer of the frame.
-			 * WARNING: at this point skb has been freed by
+			/* skb or xdpf is set only for the last buffer of the
+			 * frame.
+			 * WARNING: at this point they have been freed by
 			 * macb_tx_unmap().
 			 */
-			if (skb)
+			if (skb || xdpf)
 				break;
 		}
 	}
 
 	queue->tx_tail = tail;
+
+	bp->dev->stats.tx_packets += packets;
+	queue->stats.tx_packets += packets;
+	bp->dev->stats.tx_bytes += bytes;
+	queue->stats.tx_bytes += bytes;
+
+	/* XDP frames bypass the byte queue limits, only report skbs */
+	netdev_tx_completed_queue(netdev_get_tx_queue(bp->dev, queue_index),
+				  skb_packets, skb_bytes);
+
 	if (__netif_subqueue_stopped(bp->dev, queue_index) &&
 	    CIRC_CNT(queue->tx_head, queue->tx_tail,
 		     bp->tx_ring_size) <= MACB_TX_WAKEUP_THRESH(bp))
@@ -1304,7 +1352,7 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 static void gem_rx_refill(struct macb_queue *queue)
 {
 	unsigned int		entry;
-	struct sk_buff		*skb;
+	struct page		*page;
 	dma_addr_t		paddr;
 	struct macb *bp = queue->bp;
 	struct macb_dma_desc *desc;
@@ -1318,25 +1366,21 @@ static void gem_rx_refill(struct macb_queue *queue)
 
 		desc = macb_rx_desc(queue, entry);
 
-		if (!queue->rx_skbuff[entry]) {
-			/* allocate sk_buff for this free entry in ring */
-			skb = netdev_alloc_skb(bp->dev, bp->rx_buffer_size);
-			if (unlikely(!skb)) {
+		if (!queue->rx_pages[entry]) {
+			/* allocate page for this free entry in ring, the
+			 * page pool maps it and syncs it for the device
+			 */
+			page = page_pool_dev_alloc_pages(queue->page_pool);
+			if (unlikely(!page)) {
 				netdev_err(bp->dev,
-					   "Unable to allocate sk_buff\n");
+					   "Unable to allocate RX page\n");
 				break;
 			}
 
 			/* now fill corresponding descriptor entry */
-			paddr = dma_map_single(&bp->pdev->dev, skb->data,
-					       bp->rx_buffer_size,
-					       DMA_FROM_DEVICE);
-			if (dma_mapping_error(&bp->pdev->dev, paddr)) {
-				dev_kfree_skb(skb);
-				break;
-			}
+			paddr = page_pool_get_dma_addr(page) + GEM_RX_HEADROOM;
 
-			queue->rx_skbuff[entry] = skb;
+			queue->rx_pages[entry] = page;
 
 			if (entry == bp->rx_ring_size - 1)
 				paddr |= MACB_BIT(RX_WRAP);
@@ -1346,9 +1390,6 @@ static void gem_rx_refill(struct macb_queue *queue)
 			 */
 			dma_wmb();
 			macb_set_addr(bp, desc, paddr);
-
-			/* properly align Ethernet header */
-			skb_reserve(skb, NET_IP_ALIGN);
 		} else {
 			desc->ctrl = 0;
 			dma_wmb();
@@ -1385,16 +1426,159 @@ static void discard_partial_frame(struct macb_queue *queue, unsigned int begin,
 	 */
 }
 
+static unsigned int gem_rx_frame_size(struct macb *bp)
+{
+	unsigned int size;
+
+	size = SKB_DATA_ALIGN(GEM_RX_HEADROOM + bp->rx_buffer_size) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+
+	return PAGE_SIZE << get_order(size);
+}
+
+/* Queue a linear XDP frame on one TX descriptor, the caller holds
+ * queue->tx_ptr_lock and starts the transmission.
+ */
+static int gem_xdp_submit_frame(struct macb *bp, struct macb_queue *queue,
+				struct xdp_frame *xdpf, bool dma_map)
+{
+	unsigned int entry = macb_tx_ring_wrap(bp, queue->tx_head);
+	struct macb_tx_skb *tx_skb = &queue->tx_skb[entry];
+	struct macb_dma_desc *desc;
+	dma_addr_t mapping;
+	u32 ctrl;
+
+	if (unlikely(xdp_frame_has_frags(xdpf) ||
+		     xdpf->len > bp->max_tx_length))
+		return -EINVAL;
+
+	if (CIRC_SPACE(queue->tx_head, queue->tx_tail, bp->tx_ring_size) < 1)
+		return -ENOSPC;
+
+	if (dma_map) {
+		mapping = dma_map_single(&bp->pdev->dev, xdpf->data,
+					 xdpf->len, DMA_TO_DEVICE);
+		if (dma_mapping_error(&bp->pdev->dev, mapping))
+			return -ENOMEM;
+		tx_skb->type = MACB_TYPE_XDP_NDO;
+	} else {
+		struct page *page = virt_to_head_page(xdpf->data);
+
+		mapping = page_pool_get_dma_addr(page) +
+			  (xdpf->data - page_address(page));
+		dma_sync_single_for_device(&bp->pdev->dev, mapping,
+					   xdpf->len, DMA_BIDIRECTIONAL);
+		tx_skb->type = MACB_TYPE_XDP_TX;
+	}
+
+	tx_skb->skb = NULL;
+	tx_skb->xdpf = xdpf;
+	tx_skb->mapping = mapping;
+	tx_skb->size = xdpf->len;
+	tx_skb->mapped_as_page = false;
+
+	/* Set 'TX_USED' bit in the next descriptor to end the TX queue */
+	desc = macb_tx_desc(queue, queue->tx_head + 1);
+	desc->ctrl = MACB_BIT(TX_USED);
+
+	ctrl = xdpf->len | MACB_BIT(TX_LAST);
+	if (unlikely(entry == (bp->tx_ring_size - 1)))
+		ctrl |= MACB_BIT(TX_WRAP);
+
+	desc = macb_tx_desc(queue, entry);
+	macb_set_addr(bp, desc, mapping);
+	/* desc->addr must be visible to hardware before clearing
+	 * 'TX_USED' bit in desc->ctrl.
+	 */
+	wmb();
+	desc->ctrl = ctrl;
+
+	queue->tx_head++;
+
+	return 0;
+}
+
+static bool gem_xdp_xmit_back(struct macb_queue *queue, struct xdp_buff *xdp)
+{
+	struct xdp_frame *xdpf = xdp_convert_buff_to_frame(xdp);
+	struct macb *bp = queue->bp;
+	struct netdev_queue *nq;
+	int err;
+
+	if (unlikely(!xdpf))
+		return false;
+
+	/* The TX ring of the RX queue is shared with the stack */
+	nq = netdev_get_tx_queue(bp->dev, queue - bp->queues);
+
+	spin_lock(&queue->tx_ptr_lock);
+	err = gem_xdp_submit_frame(bp, queue, xdpf, false);
+	if (!err)
+		txq_trans_cond_update(nq);
+	spin_unlock(&queue->tx_ptr_lock);
+
+	return !err;
+}
+
+/* Returns true when the program consumed the buffer */
+static bool gem_xdp_run(struct macb_queue *queue, struct bpf_prog *prog,
+			struct xdp_buff *xdp, unsigned int *status)
+{
+	unsigned int len = xdp->data_end - xdp->data_hard_start -
+			   GEM_RX_HEADROOM;
+	struct macb *bp = queue->bp;
+	unsigned int sync;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		return false;
+	case XDP_TX:
+		if (!gem_xdp_xmit_back(queue, xdp))
+			goto out_failure;
+		*status |= GEM_XDP_TX;
+		return true;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(bp->dev, xdp, prog) < 0)
+			goto out_failure;
+		*status |= GEM_XDP_REDIRECT;
+		return true;
+	default:
+		bpf_warn_invalid_xdp_action(bp->dev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(bp->dev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		/* Sync back as much as the CPU may have touched, the program
+		 * may have moved the tail.
+		 */
+		sync = xdp->data_end - xdp->data_hard_start - GEM_RX_HEADROOM;
+		sync = max(sync, len);
+		page_pool_put_page(queue->page_pool,
+				   virt_to_head_page(xdp->data), sync, true);
+		return true;
+	}
+}
+
 static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 		  int budget)
 {
 	struct macb *bp = queue->bp;
+	struct bpf_prog		*prog = READ_ONCE(bp->xdp_prog);
+	unsigned int		xdp_status = 0;
 	unsigned int		len;
 	unsigned int		entry;
 	struct sk_buff		*skb;
+	struct page		*page;
 	struct macb_dma_desc	*desc;
+	struct xdp_buff		xdp;
 	int			count = 0;
 
+	xdp_init_buff(&xdp, gem_rx_frame_size(bp), &queue->xdp_rxq);
+
 	while (count < budget) {
 		u32 ctrl;
 		dma_addr_t addr;
@@ -1427,8 +1611,8 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 			queue->stats.rx_dropped++;
 			break;
 		}
-		skb = queue->rx_skbuff[entry];
-		if (unlikely(!skb)) {
+		page = queue->rx_pages[entry];
+		if (unlikely(!page)) {
 			netdev_err(bp->dev,
 				   "inconsistent Rx descriptor chain\n");
 			bp->dev->stats.rx_dropped++;
@@ -1436,14 +1620,38 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 			break;
 		}
 		/* now everything is ready for receiving packet */
-		queue->rx_skbuff[entry] = NULL;
+		queue->rx_pages[entry] = NULL;
 		len = ctrl & bp->rx_frm_len_mask;
 
 		netdev_vdbg(bp->dev, "gem_rx %u (len %u)\n", entry, len);
 
-		skb_put(skb, len);
-		dma_unmap_single(&bp->pdev->dev, addr,
-				 bp->rx_buffer_size, DMA_FROM_DEVICE);
+		/* the frame starts NET_IP_ALIGN bytes into the buffer */
+		dma_sync_single_for_cpu(&bp->pdev->dev, addr,
+					len + NET_IP_ALIGN,
+					page_pool_get_dma_dir(queue->page_pool));
+
+		xdp_prepare_buff(&xdp, page_address(page),
+				 GEM_RX_HEADROOM + NET_IP_ALIGN, len, false);
+
+		if (prog && gem_xdp_run(queue, prog, &xdp, &xdp_status)) {
+			bp->dev->stats.rx_packets++;
+			queue->stats.rx_packets++;
+			bp->dev->stats.rx_bytes += len;
+			queue->stats.rx_bytes += len;
+			continue;
+		}
+
+		skb = napi_build_skb(xdp.data_hard_start, xdp.frame_sz);
+		if (unlikely(!skb)) {
+			page_pool_recycle_direct(queue->page_pool, page);
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			continue;
+		}
+
+		skb_reserve(skb, xdp.data - xdp.data_hard_start);
+		__skb_put(skb, xdp.data_end - xdp.data);
+		skb_mark_for_recycle(skb);
 
 		skb->protocol = eth_type_trans(skb, bp->dev);
 		skb_checksum_none_assert(skb);
@@ -1471,6 +1679,12 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 		napi_gro_receive(napi, skb);
 	}
 
+	if (xdp_status & GEM_XDP_TX)
+		macb_tx_start(bp);
+
+	if (xdp_status & GEM_XDP_REDIRECT)
+		xdp_do_flush();
+
 	gem_rx_refill(queue);
 
 	return count;
@@ -1670,6 +1884,97 @@ static bool macb_rx_pending(struct macb_queue *queue)
 	return (desc->addr & MACB_BIT(RX_USED)) != 0;
 }
 
+#define GEM_IMOD_UNIT_NS	800
+#define GEM_IMOD_MAX_USECS	(GENMASK(GEM_RXMOD_SIZE - 1, 0) * \
+				 GEM_IMOD_UNIT_NS / NSEC_PER_USEC)
+
+static u32 gem_usecs_to_imod(u32 usecs)
+{
+	return DIV_ROUND_UP(min_t(u32, usecs, GEM_IMOD_MAX_USECS) *
+			    NSEC_PER_USEC, GEM_IMOD_UNIT_NS);
+}
+
+/* A negative value leaves the moderation of that direction alone */
+static void __gem_set_imod(struct macb *bp, int rx_usecs, int tx_usecs)
+{
+	u32 imod;
+
+	lockdep_assert_held(&bp->lock);
+
+	imod = gem_readl(bp, IMOD);
+	if (rx_usecs >= 0)
+		imod = GEM_BFINS(RXMOD, gem_usecs_to_imod(rx_usecs), imod);
+	if (tx_usecs >= 0)
+		imod = GEM_BFINS(TXMOD, gem_usecs_to_imod(tx_usecs), imod);
+	gem_writel(bp, IMOD, imod);
+}
+
+static void gem_set_imod(struct macb *bp, int rx_usecs, int tx_usecs)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&bp->lock, flags);
+	__gem_set_imod(bp, rx_usecs, tx_usecs);
+	spin_unlock_irqrestore(&bp->lock, flags);
+}
+
+static void gem_init_imod(struct macb *bp)
+{
+	u32 rx_usecs = bp->rx_coalesce_usecs;
+	u32 tx_usecs = bp->tx_coalesce_usecs;
+
+	if (!(bp->caps & MACB_CAPS_IRQ_MOD))
+		return;
+
+	/* net_dim moves on from its default profile as it measures */
+	if (bp->rx_dim_enabled)
+		rx_usecs = net_dim_get_def_rx_moderation(DIM_CQ_PERIOD_MODE_START_FROM_EQE).usec;
+	if (bp->tx_dim_enabled)
+		tx_usecs = net_dim_get_def_tx_moderation(DIM_CQ_PERIOD_MODE_START_FROM_EQE).usec;
+
+	gem_set_imod(bp, rx_usecs, tx_usecs);
+}
+
+/* The moderation timers are shared by all queues. Each queue applies the
+ * profile it measured, so the timers follow whichever queues see traffic;
+ * idle queues don't sample and never override them.
+ *
+ * A poll may still queue a profile change after gem_set_coalesce() turned
+ * DIM off, so the work only writes the timers if DIM is still enabled,
+ * checked under bp->lock against the static values being applied.
+ */
+static void gem_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct macb_queue *queue = container_of(dim, struct macb_queue, rx_dim);
+	struct macb *bp = queue->bp;
+	struct dim_cq_moder moder;
+	unsigned long flags;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	spin_lock_irqsave(&bp->lock, flags);
+	if (bp->rx_dim_enabled)
+		__gem_set_imod(bp, moder.usec, -1);
+	spin_unlock_irqrestore(&bp->lock, flags);
+	dim->state = DIM_START_MEASURE;
+}
+
+static void gem_tx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct macb_queue *queue = container_of(dim, struct macb_queue, tx_dim);
+	struct macb *bp = queue->bp;
+	struct dim_cq_moder moder;
+	unsigned long flags;
+
+	moder = net_dim_get_tx_moderation(dim->mode, dim->profile_ix);
+	spin_lock_irqsave(&bp->lock, flags);
+	if (bp->tx_dim_enabled)
+		__gem_set_imod(bp, -1, moder.usec);
+	spin_unlock_irqrestore(&bp->lock, flags);
+	dim->state = DIM_START_MEASURE;
+}
+
 static int macb_rx_poll(struct napi_struct *napi, int budget)
 {
 	struct macb_queue *queue = container_of(napi, struct macb_queue, napi_rx);
@@ -1682,6 +1987,15 @@ static int macb_rx_poll(struct napi_struct *napi, int budget)
 		    (unsigned int)(queue - bp->queues), work_done, budget);
 
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
+		if (READ_ONCE(bp->rx_dim_enabled)) {
+			struct dim_sample sample = {};
+
+			dim_update_sample(queue->rx_dim_events,
+					  queue->stats.rx_packets,
+					  queue->stats.rx_bytes, &sample);
+			net_dim(&queue->rx_dim, sample);
+		}
+
 		queue_writel(queue, IER, bp->rx_intr_mask);
 
 		/* Packet completions only seem to propagate to raise
@@ -1768,6 +2082,15 @@ static int macb_tx_poll(struct napi_struct *napi, int budget)
 		    (unsigned int)(queue - bp->queues), work_done, budget);
 
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
+		if (READ_ONCE(bp->tx_dim_enabled)) {
+			struct dim_sample sample = {};
+
+			dim_update_sample(queue->tx_dim_events,
+					  queue->stats.tx_packets,
+					  queue->stats.tx_bytes, &sample);
+			net_dim(&queue->tx_dim, sample);
+		}
+
 		queue_writel(queue, IER, MACB_BIT(TCOMP));
 
 		/* Packet completions only seem to propagate to raise
@@ -1927,6 +2250,7 @@ static irqreturn_t macb_interrupt(int irq, void *dev_id)
 			if (bp->caps & MACB_CAPS_ISR_CLEAR_ON_WRITE)
 				queue_writel(queue, ISR, MACB_BIT(RCOMP));
 
+			queue->rx_dim_events++;
 			if (napi_schedule_prep(&queue->napi_rx)) {
 				netdev_vdbg(bp->dev, "scheduling RX softirq\n");
 				__napi_schedule(&queue->napi_rx);
@@ -1945,6 +2269,7 @@ static irqreturn_t macb_interrupt(int irq, void *dev_id)
 				wmb(); // ensure softirq can see update
 			}
 
+			queue->tx_dim_events++;
 			if (napi_schedule_prep(&queue->napi_tx)) {
 				netdev_vdbg(bp->dev, "scheduling TX softirq\n");
 				__napi_schedule(&queue->napi_tx);
@@ -2069,9 +2394,11 @@ static unsigned int macb_tx_map(struct macb *bp,
 
 		/* Save info to properly release resources */
 		tx_skb->skb = NULL;
+		tx_skb->xdpf = NULL;
 		tx_skb->mapping = mapping;
 		tx_skb->size = size;
 		tx_skb->mapped_as_page = false;
+		tx_skb->type = MACB_TYPE_SKB;
 
 		len -= size;
 		offset += size;
@@ -2099,9 +2426,11 @@ static unsigned int macb_tx_map(struct macb *bp,
 
 			/* Save info to properly release resources */
 			tx_skb->skb = NULL;
+			tx_skb->xdpf = NULL;
 			tx_skb->mapping = mapping;
 			tx_skb->size = size;
 			tx_skb->mapped_as_page = true;
+			tx_skb->type = MACB_TYPE_SKB;
 
 			len -= size;
 			offset += size;
@@ -2309,20 +2638,17 @@ static netdev_tx_t macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	u16 queue_index = skb_get_queue_mapping(skb);
 	struct macb *bp = netdev_priv(dev);
 	struct macb_queue *queue = &bp->queues[queue_index];
+	struct netdev_queue *nq = netdev_get_tx_queue(dev, queue_index);
 	unsigned int desc_cnt, nr_frags, frag_size, f;
 	unsigned int hdrlen;
 	bool is_lso;
 	netdev_tx_t ret = NETDEV_TX_OK;
 
-	if (macb_clear_csum(skb)) {
-		dev_kfree_skb_any(skb);
-		return ret;
-	}
+	if (macb_clear_csum(skb))
+		goto drop;
 
-	if (macb_pad_and_fcs(&skb, dev)) {
-		dev_kfree_skb_any(skb);
-		return ret;
-	}
+	if (macb_pad_and_fcs(&skb, dev))
+		goto drop;
 
 #ifdef CONFIG_MACB_USE_HWSTAMP
 	if ((skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP) &&
@@ -2342,7 +2668,8 @@ static netdev_tx_t macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 		if (skb_headlen(skb) < hdrlen) {
 			netdev_err(bp->dev, "Error - LSO headers fragmented!!!\n");
 			/* if this is required, would need to copy to single buffer */
-			return NETDEV_TX_BUSY;
+			ret = NETDEV_TX_BUSY;
+			goto kick;
 		}
 	} else
 		hdrlen = min(skb_headlen(skb), bp->max_tx_length);
@@ -2380,30 +2707,41 @@ static netdev_tx_t macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 		netdev_dbg(bp->dev, "tx_head = %u, tx_tail = %u\n",
 			   queue->tx_head, queue->tx_tail);
 		ret = NETDEV_TX_BUSY;
-		goto unlock;
+		goto tx_start;
 	}
 
 	/* Map socket buffer for DMA transfer */
 	if (!macb_tx_map(bp, queue, skb, hdrlen)) {
 		dev_kfree_skb_any(skb);
-		goto unlock;
+		goto tx_start;
 	}
 
-	/* Make newly initialized descriptor visible to hardware */
-	wmb();
 	skb_tx_timestamp(skb);
 
-	spin_lock_irq(&bp->lock);
-	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
-	spin_unlock_irq(&bp->lock);
-
 	if (CIRC_SPACE(queue->tx_head, queue->tx_tail, bp->tx_ring_size) < 1)
 		netif_stop_subqueue(dev, queue_index);
 
+	/* Leave TSTART to the last skb of a batch, unless the queue stopped */
+	if (!__netdev_tx_sent_queue(nq, skb->len, netdev_xmit_more()))
+		goto unlock;
+
+tx_start:
+	/* Earlier skbs of the batch may still wait for TSTART */
+	macb_tx_start(bp);
+
 unlock:
 	spin_unlock_bh(&queue->tx_ptr_lock);
 
 	return ret;
+
+drop:
+	dev_kfree_skb_any(skb);
+	if (netdev_xmit_more())
+		return ret;
+kick:
+	/* Don't strand what earlier skbs of the batch have queued */
+	spin_lock_bh(&queue->tx_ptr_lock);
+	goto tx_start;
 }
 
 static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
@@ -2428,34 +2766,30 @@ static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 
 static void gem_free_rx_buffers(struct macb *bp)
 {
-	struct sk_buff		*skb;
-	struct macb_dma_desc	*desc;
 	struct macb_queue *queue;
-	dma_addr_t		addr;
+	struct page *page;
 	unsigned int q;
 	int i;
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
-		if (!queue->rx_skbuff)
-			continue;
-
-		for (i = 0; i < bp->rx_ring_size; i++) {
-			skb = queue->rx_skbuff[i];
-
-			if (!skb)
-				continue;
+		if (queue->rx_pages) {
+			for (i = 0; i < bp->rx_ring_size; i++) {
+				page = queue->rx_pages[i];
 
-			desc = macb_rx_desc(queue, i);
-			addr = macb_get_addr(bp, desc);
+				if (page)
+					page_pool_put_full_page(queue->page_pool,
+								page, false);
+			}
 
-			dma_unmap_single(&bp->pdev->dev, addr, bp->rx_buffer_size,
-					DMA_FROM_DEVICE);
-			dev_kfree_skb_any(skb);
-			skb = NULL;
+			kfree(queue->rx_pages);
+			queue->rx_pages = NULL;
 		}
 
-		kfree(queue->rx_skbuff);
-		queue->rx_skbuff = NULL;
+		if (xdp_rxq_info_is_reg(&queue->xdp_rxq))
+			xdp_rxq_info_unreg(&queue->xdp_rxq);
+
+		page_pool_destroy(queue->page_pool);
+		queue->page_pool = NULL;
 	}
 }
 
@@ -2471,12 +2805,32 @@ static void macb_free_rx_buffers(struct macb *bp)
 	}
 }
 
+/* Release what the stopped hardware did not complete: skbs, and XDP frames
+ * which keep their page pool pages in flight until they are returned.
+ */
+static void macb_free_tx_buffers(struct macb *bp)
+{
+	struct macb_queue *queue;
+	unsigned int q, tail;
+
+	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		if (!queue->tx_skb)
+			continue;
+
+		for (tail = queue->tx_tail; tail != queue->tx_head; tail++)
+			macb_tx_unmap(bp, macb_tx_skb(queue, tail), 0);
+		queue->tx_tail = queue->tx_head;
+	}
+}
+
 static void macb_free_consistent(struct macb *bp)
 {
 	struct macb_queue *queue;
 	unsigned int q;
 	int size;
 
+	/* Before the page pools go away */
+	macb_free_tx_buffers(bp);
 	bp->macbgem_ops.mog_free_rx_buffers(bp);
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
@@ -2497,21 +2851,59 @@ static void macb_free_consistent(struct macb *bp)
 	}
 }
 
+static int gem_create_page_pool(struct macb_queue *queue, unsigned int q)
+{
+	struct macb *bp = queue->bp;
+	struct page_pool_params pp_params = {
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.order = get_order(gem_rx_frame_size(bp)),
+		.pool_size = bp->rx_ring_size,
+		.nid = NUMA_NO_NODE,
+		.dev = &bp->pdev->dev,
+		.netdev = bp->dev,
+		.napi = &queue->napi_rx,
+		/* XDP_TX sends frames straight from the RX pages */
+		.dma_dir = bp->xdp_prog ? DMA_BIDIRECTIONAL : DMA_FROM_DEVICE,
+		.max_len = bp->rx_buffer_size,
+		.offset = GEM_RX_HEADROOM,
+	};
+	int err;
+
+	queue->page_pool = page_pool_create(&pp_params);
+	if (IS_ERR(queue->page_pool)) {
+		err = PTR_ERR(queue->page_pool);
+		queue->page_pool = NULL;
+		return err;
+	}
+
+	err = xdp_rxq_info_reg(&queue->xdp_rxq, bp->dev, q,
+			       queue->napi_rx.napi_id);
+	if (err)
+		return err;
+
+	return xdp_rxq_info_reg_mem_model(&queue->xdp_rxq, MEM_TYPE_PAGE_POOL,
+					  queue->page_pool);
+}
+
 static int gem_alloc_rx_buffers(struct macb *bp)
 {
 	struct macb_queue *queue;
 	unsigned int q;
-	int size;
+	int size, err;
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
-		size = bp->rx_ring_size * sizeof(struct sk_buff *);
-		queue->rx_skbuff = kzalloc(size, GFP_KERNEL);
-		if (!queue->rx_skbuff)
+		err = gem_create_page_pool(queue, q);
+		if (err)
+			return err;
+
+		size = bp->rx_ring_size * sizeof(struct page *);
+		queue->rx_pages = kzalloc(size, GFP_KERNEL);
+		if (!queue->rx_pages)
 			return -ENOMEM;
 		else
 			netdev_dbg(bp->dev,
-				   "Allocated %d RX struct sk_buff entries at %p\n",
-				   bp->rx_ring_size, queue->rx_skbuff);
+				   "Allocated %d RX page entries at %p\n",
+				   bp->rx_ring_size, queue->rx_pages);
 	}
 	return 0;
 }
@@ -2591,6 +2983,7 @@ static void gem_init_rings(struct macb *bp)
 		desc->ctrl |= MACB_BIT(TX_WRAP);
 		queue->tx_head = 0;
 		queue->tx_tail = 0;
+		netdev_tx_reset_queue(netdev_get_tx_queue(bp->dev, q));
 
 		queue->rx_tail = 0;
 		queue->rx_prepared_head = 0;
@@ -2614,6 +3007,7 @@ static void macb_init_rings(struct macb *bp)
 	}
 	bp->queues[0].tx_head = 0;
 	bp->queues[0].tx_tail = 0;
+	netdev_tx_reset_queue(netdev_get_tx_queue(bp->dev, 0));
 	desc->ctrl |= MACB_BIT(TX_WRAP);
 }
 
@@ -2801,6 +3195,8 @@ static void macb_init_hw(struct macb *bp)
 	/* Enable RX partial store and forward and set watermark */
 	if (bp->rx_watermark)
 		gem_writel(bp, PBUFRXCUT, (bp->rx_watermark | GEM_BIT(ENCUTTHRU)));
+
+	gem_init_imod(bp);
 }
 
 /* The hash address register is 64 bits long and takes up two
@@ -2949,6 +3345,10 @@ static int macb_open(struct net_device *dev)
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
 		napi_enable(&queue->napi_rx);
 		napi_enable(&queue->napi_tx);
+		netif_queue_set_napi(dev, q, NETDEV_QUEUE_TYPE_RX,
+				     &queue->napi_rx);
+		netif_queue_set_napi(dev, q, NETDEV_QUEUE_TYPE_TX,
+				     &queue->napi_tx);
 	}
 
 	macb_init_hw(bp);
@@ -2974,6 +3374,8 @@ static int macb_open(struct net_device *dev)
 reset_hw:
 	macb_reset_hw(bp);
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		netif_queue_set_napi(dev, q, NETDEV_QUEUE_TYPE_RX, NULL);
+		netif_queue_set_napi(dev, q, NETDEV_QUEUE_TYPE_TX, NULL);
 		napi_disable(&queue->napi_rx);
 		napi_disable(&queue->napi_tx);
 	}
@@ -2993,8 +3395,12 @@ static int macb_close(struct net_device *dev)
 	netif_tx_stop_all_queues(dev);
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		netif_queue_set_napi(dev, q, NETDEV_QUEUE_TYPE_RX, NULL);
+		netif_queue_set_napi(dev, q, NETDEV_QUEUE_TYPE_TX, NULL);
 		napi_disable(&queue->napi_rx);
 		napi_disable(&queue->napi_tx);
+		cancel_work_sync(&queue->rx_dim.work);
+		cancel_work_sync(&queue->tx_dim.work);
 	}
 
 	phylink_stop(bp->phylink);
@@ -3681,6 +4087,76 @@ static int gem_get_all_flow_entries(struct net_device *netdev,
 	return 0;
 }
 
+static int gem_get_coalesce(struct net_device *netdev,
+			    struct ethtool_coalesce *ec,
+			    struct kernel_ethtool_coalesce *kec,
+			    struct netlink_ext_ack *extack)
+{
+	struct macb *bp = netdev_priv(netdev);
+
+	if (!(bp->caps & MACB_CAPS_IRQ_MOD))
+		return -EOPNOTSUPP;
+
+	ec->rx_coalesce_usecs = bp->rx_coalesce_usecs;
+	ec->tx_coalesce_usecs = bp->tx_coalesce_usecs;
+	ec->use_adaptive_rx_coalesce = bp->rx_dim_enabled;
+	ec->use_adaptive_tx_coalesce = bp->tx_dim_enabled;
+
+	return 0;
+}
+
+static int gem_set_coalesce(struct net_device *netdev,
+			    struct ethtool_coalesce *ec,
+			    struct kernel_ethtool_coalesce *kec,
+			    struct netlink_ext_ack *extack)
+{
+	struct macb *bp = netdev_priv(netdev);
+	struct macb_queue *queue;
+	unsigned long flags;
+	unsigned int q;
+
+	if (!(bp->caps & MACB_CAPS_IRQ_MOD))
+		return -EOPNOTSUPP;
+
+	if (ec->rx_coalesce_usecs > GEM_IMOD_MAX_USECS ||
+	    ec->tx_coalesce_usecs > GEM_IMOD_MAX_USECS) {
+		NL_SET_ERR_MSG_FMT_MOD(extack,
+				       "interrupt moderation is limited to %lu usecs",
+				       GEM_IMOD_MAX_USECS);
+		return -EINVAL;
+	}
+
+	/* Serialises against the DIM work, which checks the flags under it */
+	spin_lock_irqsave(&bp->lock, flags);
+	bp->rx_coalesce_usecs = ec->rx_coalesce_usecs;
+	bp->tx_coalesce_usecs = ec->tx_coalesce_usecs;
+	WRITE_ONCE(bp->rx_dim_enabled, ec->use_adaptive_rx_coalesce);
+	WRITE_ONCE(bp->tx_dim_enabled, ec->use_adaptive_tx_coalesce);
+	spin_unlock_irqrestore(&bp->lock, flags);
+
+	/* Don't let a pending profile change override the new setting */
+	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		cancel_work_sync(&queue->rx_dim.work);
+		cancel_work_sync(&queue->tx_dim.work);
+	}
+
+	/* Otherwise macb_init_hw() applies it on open */
+	if (netif_running(netdev))
+		gem_init_imod(bp);
+
+	return 0;
+}
+
+static void gem_get_channels(struct net_device *netdev,
+			     struct ethtool_channels *ch)
+{
+	struct macb *bp = netdev_priv(netdev);
+
+	/* Each hardware queue has its own RX and TX ring and interrupt */
+	ch->max_combined = bp->num_queues;
+	ch->combined_count = bp->num_queues;
+}
+
 static int gem_get_rxnfc(struct net_device *netdev, struct ethtool_rxnfc *cmd,
 		u32 *rule_locs)
 {
@@ -3749,6 +4225,8 @@ static const struct ethtool_ops macb_ethtool_ops = {
 };
 
 static const struct ethtool_ops gem_ethtool_ops = {
+	.supported_coalesce_params = ETHTOOL_COALESCE_USECS |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE,
 	.get_regs_len		= macb_get_regs_len,
 	.get_regs		= macb_get_regs,
 	.get_wol		= macb_get_wol,
@@ -3762,6 +4240,9 @@ static const struct ethtool_ops gem_ethtool_ops = {
 	.set_link_ksettings     = macb_set_link_ksettings,
 	.get_ringparam		= macb_get_ringparam,
 	.set_ringparam		= macb_set_ringparam,
+	.get_coalesce		= gem_get_coalesce,
+	.set_coalesce		= gem_set_coalesce,
+	.get_channels		= gem_get_channels,
 	.get_rxnfc			= gem_get_rxnfc,
 	.set_rxnfc			= gem_set_rxnfc,
 };
@@ -3889,6 +4370,76 @@ static void macb_restore_features(struct macb *bp)
 	macb_set_rxflow_feature(bp, features);
 }
 
+static int gem_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			 struct netlink_ext_ack *extack)
+{
+	struct macb *bp = netdev_priv(dev);
+	bool running = netif_running(dev);
+	bool reset = !bp->xdp_prog != !prog;
+	struct bpf_prog *old_prog;
+
+	/* The RX page pools are recreated for the new DMA direction */
+	if (running && reset)
+		macb_close(dev);
+
+	old_prog = xchg(&bp->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (running && reset)
+		return macb_open(dev);
+
+	return 0;
+}
+
+static int gem_bpf(struct net_device *dev, struct netdev_bpf *xdp)
+{
+	struct macb *bp = netdev_priv(dev);
+
+	if (!macb_is_gem(bp))
+		return -EOPNOTSUPP;
+
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return gem_xdp_setup(dev, xdp->prog, xdp->extack);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int gem_xdp_xmit(struct net_device *dev, int n,
+			struct xdp_frame **frames, u32 flags)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct macb_queue *queue;
+	struct netdev_queue *nq;
+	int i, nxmit = 0;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(dev) || !macb_is_gem(bp)))
+		return -ENETDOWN;
+
+	queue = &bp->queues[smp_processor_id() % bp->num_queues];
+	nq = netdev_get_tx_queue(dev, queue - bp->queues);
+
+	spin_lock(&queue->tx_ptr_lock);
+	for (i = 0; i < n; i++) {
+		if (gem_xdp_submit_frame(bp, queue, frames[i], true))
+			break;
+		nxmit++;
+	}
+	if (nxmit)
+		txq_trans_cond_update(nq);
+	spin_unlock(&queue->tx_ptr_lock);
+
+	if (nxmit && (flags & XDP_XMIT_FLUSH))
+		macb_tx_start(bp);
+
+	return nxmit;
+}
+
 static const struct net_device_ops macb_netdev_ops = {
 	.ndo_open		= macb_open,
 	.ndo_stop		= macb_close,
@@ -3906,6 +4457,8 @@ static const struct net_device_ops macb_netdev_ops = {
 	.ndo_features_check	= macb_features_check,
 	.ndo_hwtstamp_set	= macb_hwtstamp_set,
 	.ndo_hwtstamp_get	= macb_hwtstamp_get,
+	.ndo_bpf		= gem_bpf,
+	.ndo_xdp_xmit		= gem_xdp_xmit,
 };
 
 /* Configure peripheral capabilities according to device tree
@@ -3933,6 +4486,11 @@ static void macb_configure_caps(struct macb *bp,
 		dcfg = gem_readl(bp, DCFG2);
 		if ((dcfg & (GEM_BIT(RX_PKT_BUFF) | GEM_BIT(TX_PKT_BUFF))) == 0)
 			bp->caps |= MACB_CAPS_FIFO_MODE;
+		/* IMOD isn't described in the design configuration, probe it */
+		gem_writel(bp, IMOD, GEM_BF(RXMOD, 1));
+		if (gem_readl(bp, IMOD))
+			bp->caps |= MACB_CAPS_IRQ_MOD;
+		gem_writel(bp, IMOD, 0);
 		if (gem_has_ptp(bp)) {
 			if (!GEM_BFEXT(TSU, gem_readl(bp, DCFG5)))
 				dev_err(&bp->pdev->dev,
@@ -4070,6 +4628,22 @@ static int macb_clk_init(struct platform_device *pdev, struct clk **pclk,
 	return err;
 }
 
+/* Spread the TX queues over the CPUs closest to the controller, so that
+ * flows sent from different CPUs don't contend on one tx_ptr_lock.
+ */
+static void macb_set_xps(struct macb *bp)
+{
+	int node = dev_to_node(&bp->pdev->dev);
+	unsigned int q;
+
+	if (bp->num_queues == 1)
+		return;
+
+	for (q = 0; q < bp->num_queues; q++)
+		netif_set_xps_queue(bp->dev,
+				    cpumask_of(cpumask_local_spread(q, node)), q);
+}
+
 static int macb_init(struct platform_device *pdev)
 {
 	struct net_device *dev = platform_get_drvdata(pdev);
@@ -4140,12 +4714,22 @@ static int macb_init(struct platform_device *pdev)
 			return err;
 		}
 
+		netif_napi_set_irq(&queue->napi_rx, queue->irq);
+		netif_napi_set_irq(&queue->napi_tx, queue->irq);
+
+		INIT_WORK(&queue->rx_dim.work, gem_rx_dim_work);
+		queue->rx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+		INIT_WORK(&queue->tx_dim.work, gem_tx_dim_work);
+		queue->tx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+
 		INIT_WORK(&queue->tx_error_task, macb_tx_error_task);
 		q++;
 	}
 
 	dev->netdev_ops = &macb_netdev_ops;
 
+	macb_set_xps(bp);
+
 	/* setup appropriated routines according to adapter type */
 	if (macb_is_gem(bp)) {
 		bp->macbgem_ops.mog_alloc_rx_buffers = gem_alloc_rx_buffers;
@@ -4153,6 +4737,13 @@ static int macb_init(struct platform_device *pdev)
 		bp->macbgem_ops.mog_init_rings = gem_init_rings;
 		bp->macbgem_ops.mog_rx = gem_rx;
 		dev->ethtool_ops = &gem_ethtool_ops;
+		dev->xdp_features = NETDEV_XDP_ACT_BASIC |
+				    NETDEV_XDP_ACT_REDIRECT |
+				    NETDEV_XDP_ACT_NDO_XMIT;
+		if (bp->caps & MACB_CAPS_IRQ_MOD) {
+			bp->rx_dim_enabled = true;
+			bp->tx_dim_enabled = true;
+		}
 	} else {
 		bp->macbgem_ops.mog_alloc_rx_buffers = macb_alloc_rx_buffers;
 		bp->macbgem_ops.mog_free_rx_buffers = macb_free_rx_buffers;
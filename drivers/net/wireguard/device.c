@@ -176,7 +176,13 @@ static netdev_tx_t wg_xmit(struct sk_buff *skb, struct net_device *dev)
 	if (!skb_is_gso(skb)) {
 		skb_mark_not_on_list(skb);
 	} else {
-		struct sk_buff *segs = skb_gso_segment(skb, 0);
+		struct sk_buff *segs;
+
+		/* Hash the flow once here rather than once per segment in
+		 * encrypt_packet(), the segments inherit it.
+		 */
+		skb_get_hash(skb);
+		segs = skb_gso_segment(skb, 0);
 
 		if (IS_ERR(segs)) {
 			ret = PTR_ERR(segs);
@@ -707,15 +707,20 @@ struct nvmet_ns *nvmet_ns_alloc(struct nvmet_subsys *subsys, u32 nsid)
 
 static void nvmet_update_sq_head(struct nvmet_req *req)
 {
-	if (req->sq->size) {
-		u32 old_sqhd, new_sqhd;
+	u32 old_sqhd, new_sqhd;
 
-		old_sqhd = READ_ONCE(req->sq->sqhd);
+	old_sqhd = READ_ONCE(req->sq->sqhd);
+	if (req->sq->size) {
+		/* Every completion goes through here, avoid the division */
 		do {
-			new_sqhd = (old_sqhd + 1) % req->sq->size;
+			new_sqhd = old_sqhd + 1;
+			if (new_sqhd >= req->sq->size)
+				new_sqhd = 0;
 		} while (!try_cmpxchg(&req->sq->sqhd, &old_sqhd, new_sqhd));
+	} else {
+		new_sqhd = old_sqhd;
 	}
-	req->cqe->sq_head = cpu_to_le16(req->sq->sqhd & 0x0000FFFF);
+	req->cqe->sq_head = cpu_to_le16(new_sqhd & 0x0000FFFF);
 }
 
 static void nvmet_set_error(struct nvmet_req *req, u16 status)
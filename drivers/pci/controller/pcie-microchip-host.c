@@ -426,12 +426,27 @@ static void mc_handle_msi(struct irq_desc *desc)
 	status = readl_relaxed(bridge_base_addr + ISTATUS_LOCAL);
 	if (status & PM_MSI_INT_MSI_MASK) {
 		writel_relaxed(status & PM_MSI_INT_MSI_MASK, bridge_base_addr + ISTATUS_LOCAL);
-		status = readl_relaxed(bridge_base_addr + ISTATUS_MSI);
-		for_each_set_bit(bit, &status, msi->num_vectors) {
-			ret = generic_handle_domain_irq(msi->dev_domain, bit);
-			if (ret)
-				dev_err_ratelimited(dev, "bad MSI IRQ %d\n",
-						    bit);
+		/*
+		 * All vectors share this one parent interrupt, so under load
+		 * more of them arrive while the first batch is handled. Keep
+		 * going until ISTATUS_MSI is clear instead of taking another
+		 * trip through the event demux for each batch.
+		 *
+		 * A bit nobody handles is cleared here, as it would not be
+		 * acked otherwise and the loop would never end.
+		 */
+		while ((status = readl_relaxed(bridge_base_addr + ISTATUS_MSI) &
+				 GENMASK(msi->num_vectors - 1, 0))) {
+			for_each_set_bit(bit, &status, msi->num_vectors) {
+				ret = generic_handle_domain_irq(msi->dev_domain,
+								bit);
+				if (ret) {
+					dev_err_ratelimited(dev, "bad MSI IRQ %d\n",
+							    bit);
+					writel_relaxed(BIT(bit),
+						       bridge_base_addr + ISTATUS_MSI);
+				}
+			}
 		}
 	}
 
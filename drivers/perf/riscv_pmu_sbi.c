@@ -89,6 +89,8 @@ static unsigned int riscv_pmu_irq;
 /* Cache the available counters in a bitmask */
 static unsigned long cmask;
 
+static DEFINE_STATIC_KEY_FALSE(sbi_pmu_snapshot_available);
+
 struct sbi_pmu_event_data {
 	union {
 		union {
@@ -361,6 +363,48 @@ static unsigned long pmu_sbi_get_filter_flags(struct perf_event *event)
 	return cflags;
 }
 
+/*
+ * Deleting an event used to reset its counter in the firmware, so that the
+ * next event scheduled in had to go through CFG_MATCH again even when it
+ * was the very same event coming back, as happens all the time when events
+ * are multiplexed. Instead, leave the counter configured in the firmware
+ * and remember its configuration. A later event with the same event index,
+ * config and filter flags can then claim the counter without an SBI call.
+ */
+static bool pmu_sbi_ctr_cfg_match(struct riscv_pmu_ctr_cfg *cfg,
+				  struct hw_perf_event *hwc, unsigned long cflags)
+{
+	return cfg->event_base == hwc->event_base && cfg->config == hwc->config &&
+	       cfg->cflags == cflags;
+}
+
+static int pmu_sbi_find_cached_ctr(struct cpu_hw_events *cpuc,
+				   struct hw_perf_event *hwc, unsigned long cflags)
+{
+	int idx;
+
+	for_each_set_bit(idx, cpuc->cached_ctrs, RISCV_MAX_COUNTERS) {
+		if (pmu_sbi_ctr_cfg_match(&cpuc->ctr_cfg[idx], hwc, cflags))
+			return idx;
+	}
+
+	return -ENOENT;
+}
+
+static void pmu_sbi_release_cached_ctrs(struct cpu_hw_events *cpuc)
+{
+	int i;
+
+	for (i = 0; i < BITS_TO_LONGS(RISCV_MAX_COUNTERS); i++) {
+		if (!cpuc->cached_ctrs[i])
+			continue;
+		/* The counters are already stopped, this only drops the mapping */
+		sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_STOP, i * BITS_PER_LONG,
+			  cpuc->cached_ctrs[i], SBI_PMU_STOP_FLAG_RESET, 0, 0, 0);
+	}
+	bitmap_zero(cpuc->cached_ctrs, RISCV_MAX_COUNTERS);
+}
+
 static int pmu_sbi_ctr_get_idx(struct perf_event *event)
 {
 	struct hw_perf_event *hwc = &event->hw;
@@ -388,7 +432,16 @@ static int pmu_sbi_ctr_get_idx(struct perf_event *event)
 		}
 	}
 
+	if (!(cflags & SBI_PMU_CFG_FLAG_SKIP_MATCH)) {
+		idx = pmu_sbi_find_cached_ctr(cpuc, hwc, cflags);
+		if (idx >= 0) {
+			clear_bit(idx, cpuc->cached_ctrs);
+			goto claim;
+		}
+	}
+
 	/* retrieve the available counter index */
+retry:
 #if defined(CONFIG_32BIT)
 	ret = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_CFG_MATCH, cbase,
 			cmask, cflags, hwc->event_base, hwc->config,
@@ -398,6 +451,11 @@ static int pmu_sbi_ctr_get_idx(struct perf_event *event)
 			cmask, cflags, hwc->event_base, hwc->config, 0);
 #endif
 	if (ret.error) {
+		/* The firmware may only be out of counters because of the cached ones */
+		if (!bitmap_empty(cpuc->cached_ctrs, RISCV_MAX_COUNTERS)) {
+			pmu_sbi_release_cached_ctrs(cpuc);
+			goto retry;
+		}
 		pr_debug("Not able to find a counter for event %lx config %llx\n",
 			hwc->event_base, hwc->config);
 		return sbi_err_map_linux_errno(ret.error);
@@ -407,6 +465,13 @@ static int pmu_sbi_ctr_get_idx(struct perf_event *event)
 	if (!test_bit(idx, &rvpmu->cmask) || !pmu_ctr_list[idx].value)
 		return -ENOENT;
 
+	/* A fixed counter requested with SKIP_MATCH may have been cached */
+	clear_bit(idx, cpuc->cached_ctrs);
+	cpuc->ctr_cfg[idx].event_base = hwc->event_base;
+	cpuc->ctr_cfg[idx].config = hwc->config;
+	cpuc->ctr_cfg[idx].cflags = cflags;
+
+claim:
 	/* Additional sanity check for the counter id */
 	if (pmu_sbi_ctr_is_fw(idx)) {
 		if (!test_and_set_bit(idx, cpuc->used_fw_ctrs))
@@ -506,6 +571,89 @@ static int pmu_sbi_event_map(struct perf_event *event, u64 *econfig)
 	return ret;
 }
 
+static void pmu_sbi_snapshot_free(struct riscv_pmu *pmu)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct cpu_hw_events *cpu_hw_evt = per_cpu_ptr(pmu->hw_events, cpu);
+
+		if (!cpu_hw_evt->snapshot_addr)
+			continue;
+
+		free_page((unsigned long)cpu_hw_evt->snapshot_addr);
+		cpu_hw_evt->snapshot_addr = NULL;
+		cpu_hw_evt->snapshot_addr_phys = 0;
+	}
+}
+
+static int pmu_sbi_snapshot_alloc(struct riscv_pmu *pmu)
+{
+	int cpu;
+	struct page *snapshot_page;
+
+	for_each_possible_cpu(cpu) {
+		struct cpu_hw_events *cpu_hw_evt = per_cpu_ptr(pmu->hw_events, cpu);
+
+		snapshot_page = alloc_page(GFP_ATOMIC | __GFP_ZERO);
+		if (!snapshot_page) {
+			pmu_sbi_snapshot_free(pmu);
+			return -ENOMEM;
+		}
+		cpu_hw_evt->snapshot_addr = page_to_virt(snapshot_page);
+		cpu_hw_evt->snapshot_addr_phys = page_to_phys(snapshot_page);
+	}
+
+	return 0;
+}
+
+static int pmu_sbi_snapshot_disable(void)
+{
+	struct sbiret ret;
+
+	ret = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_SNAPSHOT_SET_SHMEM, SBI_SHMEM_DISABLE,
+			SBI_SHMEM_DISABLE, 0, 0, 0, 0);
+	if (ret.error) {
+		pr_warn("failed to disable snapshot shared memory\n");
+		return sbi_err_map_linux_errno(ret.error);
+	}
+
+	return 0;
+}
+
+static int pmu_sbi_snapshot_setup(struct riscv_pmu *pmu, int cpu)
+{
+	struct cpu_hw_events *cpu_hw_evt;
+	struct sbiret ret = {0};
+
+	cpu_hw_evt = per_cpu_ptr(pmu->hw_events, cpu);
+	if (!cpu_hw_evt->snapshot_addr_phys)
+		return -EINVAL;
+
+	if (cpu_hw_evt->snapshot_set_done)
+		return 0;
+
+	if (IS_ENABLED(CONFIG_32BIT))
+		ret = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_SNAPSHOT_SET_SHMEM,
+				cpu_hw_evt->snapshot_addr_phys,
+				(u64)(cpu_hw_evt->snapshot_addr_phys) >> 32, 0, 0, 0, 0);
+	else
+		ret = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_SNAPSHOT_SET_SHMEM,
+				cpu_hw_evt->snapshot_addr_phys, 0, 0, 0, 0, 0);
+
+	/* Free up the snapshot area memory and fall back to SBI PMU calls without snapshot */
+	if (ret.error) {
+		if (ret.error != SBI_ERR_NOT_SUPPORTED)
+			pr_warn("pmu snapshot setup failed with error %ld\n", ret.error);
+		return sbi_err_map_linux_errno(ret.error);
+	}
+
+	memset(cpu_hw_evt->snapshot_cval_shcopy, 0, sizeof(u64) * RISCV_MAX_COUNTERS);
+	cpu_hw_evt->snapshot_set_done = true;
+
+	return 0;
+}
+
 static u64 pmu_sbi_ctr_read(struct perf_event *event)
 {
 	struct hw_perf_event *hwc = &event->hw;
@@ -513,6 +661,17 @@ static u64 pmu_sbi_ctr_read(struct perf_event *event)
 	struct sbiret ret;
 	union sbi_pmu_ctr_info info;
 	u64 val = 0;
+	struct riscv_pmu *pmu = to_riscv_pmu(event->pmu);
+	struct cpu_hw_events *cpu_hw_evt = this_cpu_ptr(pmu->hw_events);
+	struct riscv_pmu_snapshot_data *sdata = cpu_hw_evt->snapshot_addr;
+
+	/*
+	 * A stopped counter has already been saved to the snapshot area by
+	 * the firmware, so there is no need to trap into M-mode to read it.
+	 */
+	if (static_branch_likely(&sbi_pmu_snapshot_available) &&
+	    (hwc->state & PERF_HES_STOPPED))
+		return sdata->ctr_values[idx];
 
 	if (pmu_sbi_is_fw_event(event)) {
 		ret = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_FW_READ,
@@ -573,16 +732,43 @@ static void pmu_sbi_ctr_stop(struct perf_event *event, unsigned long flag)
 {
 	struct sbiret ret;
 	struct hw_perf_event *hwc = &event->hw;
+	struct riscv_pmu *pmu = to_riscv_pmu(event->pmu);
+	struct cpu_hw_events *cpu_hw_evt = this_cpu_ptr(pmu->hw_events);
+	struct riscv_pmu_snapshot_data *sdata = cpu_hw_evt->snapshot_addr;
 
 	if ((hwc->flags & PERF_EVENT_FLAG_USER_ACCESS) &&
 	    (hwc->flags & PERF_EVENT_FLAG_USER_READ_CNT))
 		pmu_sbi_reset_scounteren((void *)event);
 
+	/*
+	 * The counter has already been stopped by riscv_pmu_stop(). Keep the
+	 * mapping alive in the firmware so pmu_sbi_ctr_get_idx() can reuse it.
+	 */
+	if ((flag & SBI_PMU_STOP_FLAG_RESET) && !(hwc->flags & PERF_EVENT_FLAG_LEGACY)) {
+		set_bit(hwc->idx, cpu_hw_evt->cached_ctrs);
+		return;
+	}
+
+	if (static_branch_likely(&sbi_pmu_snapshot_available))
+		flag |= SBI_PMU_STOP_FLAG_TAKE_SNAPSHOT;
+
 	ret = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_STOP, hwc->idx, 1, flag, 0, 0, 0);
-	if (ret.error && (ret.error != SBI_ERR_ALREADY_STOPPED) &&
-		flag != SBI_PMU_STOP_FLAG_RESET)
+	if (!ret.error && static_branch_likely(&sbi_pmu_snapshot_available) &&
+	    (flag & SBI_PMU_STOP_FLAG_TAKE_SNAPSHOT)) {
+		/*
+		 * The snapshot area is indexed relative to the counter_idx_base
+		 * passed to the stop call, which is always hwc->idx here. Move the
+		 * value to the absolute index so that ctr_read() can find it.
+		 */
+		if (hwc->idx > 0) {
+			sdata->ctr_values[hwc->idx] = sdata->ctr_values[0];
+			sdata->ctr_values[0] = 0;
+		}
+	} else if (ret.error && (ret.error != SBI_ERR_ALREADY_STOPPED) &&
+		   flag != SBI_PMU_STOP_FLAG_RESET) {
 		pr_err("Stopping counter idx %d failed with error %d\n",
 			hwc->idx, sbi_err_map_linux_errno(ret.error));
+	}
 }
 
 static int pmu_sbi_find_num_ctrs(void)
@@ -640,10 +826,42 @@ static inline void pmu_sbi_stop_all(struct riscv_pmu *pmu)
 static inline void pmu_sbi_stop_hw_ctrs(struct riscv_pmu *pmu)
 {
 	struct cpu_hw_events *cpu_hw_evt = this_cpu_ptr(pmu->hw_events);
+	struct riscv_pmu_snapshot_data *sdata = cpu_hw_evt->snapshot_addr;
+	unsigned long flag = 0;
+	int i, idx;
+	struct sbiret ret;
+	u64 temp_ctr_overflow_mask = 0;
+
+	if (static_branch_likely(&sbi_pmu_snapshot_available))
+		flag = SBI_PMU_STOP_FLAG_TAKE_SNAPSHOT;
+
+	/* Reset the shadow copy to avoid save/restore any value from previous overflow */
+	memset(cpu_hw_evt->snapshot_cval_shcopy, 0, sizeof(u64) * RISCV_MAX_COUNTERS);
 
-	/* No need to check the error here as we can't do anything about the error */
-	sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_STOP, 0,
-		  cpu_hw_evt->used_hw_ctrs[0], 0, 0, 0, 0);
+	for (i = 0; i < BITS_TO_LONGS(RISCV_MAX_COUNTERS); i++) {
+		/* No need to check the error here as we can't do anything about the error */
+		ret = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_STOP, i * BITS_PER_LONG,
+				cpu_hw_evt->used_hw_ctrs[i], flag, 0, 0, 0);
+		if (!ret.error && static_branch_likely(&sbi_pmu_snapshot_available)) {
+			/*
+			 * Each call overwrites the snapshot area relative to its own
+			 * counter base, so stash the values before the next call.
+			 */
+			for_each_set_bit(idx, &cpu_hw_evt->used_hw_ctrs[i], BITS_PER_LONG)
+				cpu_hw_evt->snapshot_cval_shcopy[i * BITS_PER_LONG + idx] =
+							sdata->ctr_values[idx];
+			/* Save the overflow mask to avoid clobbering it in the next call */
+			temp_ctr_overflow_mask |= sdata->ctr_overflow_mask << (i * BITS_PER_LONG);
+		}
+	}
+
+	/* Restore the counter values to the shared memory in absolute index order */
+	if (static_branch_likely(&sbi_pmu_snapshot_available)) {
+		for_each_set_bit(idx, cpu_hw_evt->used_hw_ctrs, RISCV_MAX_COUNTERS)
+			sdata->ctr_values[idx] = cpu_hw_evt->snapshot_cval_shcopy[idx];
+		if (temp_ctr_overflow_mask)
+			sdata->ctr_overflow_mask = temp_ctr_overflow_mask;
+	}
 }
 
 /*
@@ -652,17 +870,16 @@ static inline void pmu_sbi_stop_hw_ctrs(struct riscv_pmu *pmu)
  * while the overflowed counters need to be started with updated initialization
  * value.
  */
-static inline void pmu_sbi_start_overflow_mask(struct riscv_pmu *pmu,
-					       unsigned long ctr_ovf_mask)
+static inline void pmu_sbi_start_ovf_ctrs_sbi(struct cpu_hw_events *cpu_hw_evt,
+					      unsigned long ctr_ovf_mask)
 {
-	int idx = 0;
-	struct cpu_hw_events *cpu_hw_evt = this_cpu_ptr(pmu->hw_events);
+	int idx, i;
 	struct perf_event *event;
 	unsigned long flag = SBI_PMU_START_FLAG_SET_INIT_VALUE;
 	unsigned long ctr_start_mask = 0;
+	unsigned long ctr_init_mask;
 	uint64_t max_period;
-	struct hw_perf_event *hwc;
-	u64 init_val = 0;
+	u64 init_val[BITS_PER_LONG];
 
 	ctr_start_mask = cpu_hw_evt->used_hw_ctrs[0] & ~ctr_ovf_mask;
 
@@ -670,27 +887,89 @@ static inline void pmu_sbi_start_overflow_mask(struct riscv_pmu *pmu,
 	sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_START, 0, ctr_start_mask,
 		  0, 0, 0, 0);
 
-	/* Reinitialize and start all the counter that overflowed */
+	for_each_set_bit(idx, &ctr_ovf_mask, BITS_PER_LONG) {
+		event = cpu_hw_evt->events[idx];
+		max_period = riscv_pmu_ctr_get_width_mask(event);
+		init_val[idx] = local64_read(&event->hw.prev_count) & max_period;
+	}
+
+	/*
+	 * Reinitialize and start all the counter that overflowed. Counters
+	 * sampling with the same period come back with the same initial value,
+	 * so start each such group with one call.
+	 */
 	while (ctr_ovf_mask) {
-		if (ctr_ovf_mask & 0x01) {
+		idx = __ffs(ctr_ovf_mask);
+		ctr_init_mask = 0;
+		for_each_set_bit(i, &ctr_ovf_mask, BITS_PER_LONG) {
+			if (init_val[i] == init_val[idx])
+				ctr_init_mask |= BIT(i);
+		}
+#if defined(CONFIG_32BIT)
+		sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_START, 0, ctr_init_mask,
+			  flag, init_val[idx], init_val[idx] >> 32, 0);
+#else
+		sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_START, 0, ctr_init_mask,
+			  flag, init_val[idx], 0, 0);
+#endif
+		for_each_set_bit(i, &ctr_init_mask, BITS_PER_LONG)
+			perf_event_update_userpage(cpu_hw_evt->events[i]);
+		ctr_ovf_mask &= ~ctr_init_mask;
+	}
+}
+
+/*
+ * With the snapshot area, the initial values of all the used counters are
+ * written to the shared memory and every counter is restarted with a
+ * single SBI call per XLEN-sized group, instead of one call per overflowed
+ * counter.
+ */
+static inline void pmu_sbi_start_ovf_ctrs_snapshot(struct cpu_hw_events *cpu_hw_evt,
+						   unsigned long ctr_ovf_mask)
+{
+	int i, idx = 0;
+	struct perf_event *event;
+	unsigned long flag = SBI_PMU_START_FLAG_INIT_SNAPSHOT;
+	u64 max_period, init_val = 0;
+	struct hw_perf_event *hwc;
+	struct riscv_pmu_snapshot_data *sdata = cpu_hw_evt->snapshot_addr;
+
+	for_each_set_bit(idx, cpu_hw_evt->used_hw_ctrs, RISCV_MAX_COUNTERS) {
+		if (ctr_ovf_mask & BIT(idx)) {
 			event = cpu_hw_evt->events[idx];
 			hwc = &event->hw;
 			max_period = riscv_pmu_ctr_get_width_mask(event);
 			init_val = local64_read(&hwc->prev_count) & max_period;
-#if defined(CONFIG_32BIT)
-			sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_START, idx, 1,
-				  flag, init_val, init_val >> 32, 0);
-#else
-			sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_START, idx, 1,
-				  flag, init_val, 0, 0);
-#endif
-			perf_event_update_userpage(event);
+			cpu_hw_evt->snapshot_cval_shcopy[idx] = init_val;
 		}
-		ctr_ovf_mask = ctr_ovf_mask >> 1;
-		idx++;
+		/*
+		 * We do not need to update the non-overflow counters the previous
+		 * value should have been there already.
+		 */
+	}
+
+	for (i = 0; i < BITS_TO_LONGS(RISCV_MAX_COUNTERS); i++) {
+		/* Restore the counter values to relative indices for used hw counters */
+		for_each_set_bit(idx, &cpu_hw_evt->used_hw_ctrs[i], BITS_PER_LONG)
+			sdata->ctr_values[idx] =
+					cpu_hw_evt->snapshot_cval_shcopy[idx + i * BITS_PER_LONG];
+		/* Start all the counters in a single shot */
+		sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_START, i * BITS_PER_LONG,
+			  cpu_hw_evt->used_hw_ctrs[i], flag, 0, 0, 0);
 	}
 }
 
+static void pmu_sbi_start_overflow_mask(struct riscv_pmu *pmu,
+					unsigned long ctr_ovf_mask)
+{
+	struct cpu_hw_events *cpu_hw_evt = this_cpu_ptr(pmu->hw_events);
+
+	if (static_branch_likely(&sbi_pmu_snapshot_available))
+		pmu_sbi_start_ovf_ctrs_snapshot(cpu_hw_evt, ctr_ovf_mask);
+	else
+		pmu_sbi_start_ovf_ctrs_sbi(cpu_hw_evt, ctr_ovf_mask);
+}
+
 static irqreturn_t pmu_sbi_ovf_handler(int irq, void *dev)
 {
 	struct perf_sample_data data;
@@ -704,6 +983,7 @@ static irqreturn_t pmu_sbi_ovf_handler(int irq, void *dev)
 	unsigned long overflowed_ctrs = 0;
 	struct cpu_hw_events *cpu_hw_evt = dev;
 	u64 start_clock = sched_clock();
+	struct riscv_pmu_snapshot_data *sdata = cpu_hw_evt->snapshot_addr;
 
 	if (WARN_ON_ONCE(!cpu_hw_evt))
 		return IRQ_NONE;
@@ -724,8 +1004,11 @@ static irqreturn_t pmu_sbi_ovf_handler(int irq, void *dev)
 	pmu = to_riscv_pmu(event->pmu);
 	pmu_sbi_stop_hw_ctrs(pmu);
 
-	/* Overflow status register should only be read after counter are stopped */
-	ALT_SBI_PMU_OVERFLOW(overflow);
+	if (static_branch_likely(&sbi_pmu_snapshot_available))
+		overflow = sdata->ctr_overflow_mask;
+	else
+		/* Overflow status register should only be read after counter are stopped */
+		ALT_SBI_PMU_OVERFLOW(overflow);
 
 	/*
 	 * Overflow interrupt pending bit should only be cleared after stopping
@@ -751,11 +1034,17 @@ static irqreturn_t pmu_sbi_ovf_handler(int irq, void *dev)
 		if (!info || info->type != SBI_PMU_CTR_TYPE_HW)
 			continue;
 
-		/* compute hardware counter index */
-		hidx = info->csr - CSR_CYCLE;
-		/* check if the corresponding bit is set in sscountovf */
-		if (!(overflow & BIT(hidx)))
-			continue;
+		if (static_branch_likely(&sbi_pmu_snapshot_available)) {
+			/* The snapshot overflow mask is indexed by logical counter */
+			if (!(overflow & BIT(lidx)))
+				continue;
+		} else {
+			/* compute hardware counter index */
+			hidx = info->csr - CSR_CYCLE;
+			/* check if the corresponding bit is set in sscountovf */
+			if (!(overflow & BIT(hidx)))
+				continue;
+		}
 
 		/*
 		 * Keep a track of overflowed counters so that they can be started
@@ -807,11 +1096,17 @@ static int pmu_sbi_starting_cpu(unsigned int cpu, struct hlist_node *node)
 		enable_percpu_irq(riscv_pmu_irq, IRQ_TYPE_NONE);
 	}
 
+	if (static_branch_likely(&sbi_pmu_snapshot_available))
+		return pmu_sbi_snapshot_setup(pmu, cpu);
+
 	return 0;
 }
 
 static int pmu_sbi_dying_cpu(unsigned int cpu, struct hlist_node *node)
 {
+	struct riscv_pmu *pmu = hlist_entry_safe(node, struct riscv_pmu, node);
+	struct cpu_hw_events *cpu_hw_evt = this_cpu_ptr(pmu->hw_events);
+
 	if (riscv_pmu_use_irq) {
 		disable_percpu_irq(riscv_pmu_irq);
 	}
@@ -819,6 +1114,13 @@ static int pmu_sbi_dying_cpu(unsigned int cpu, struct hlist_node *node)
 	/* Disable all counters access for user mode now */
 	csr_write(CSR_SCOUNTEREN, 0x0);
 
+	pmu_sbi_release_cached_ctrs(cpu_hw_evt);
+
+	if (static_branch_likely(&sbi_pmu_snapshot_available)) {
+		cpu_hw_evt->snapshot_set_done = false;
+		return pmu_sbi_snapshot_disable();
+	}
+
 	return 0;
 }
 
@@ -927,6 +1229,10 @@ static inline void riscv_pm_pmu_unregister(struct riscv_pmu *pmu) { }
 
 static void riscv_pmu_destroy(struct riscv_pmu *pmu)
 {
+	if (static_branch_likely(&sbi_pmu_snapshot_available)) {
+		pmu_sbi_snapshot_disable();
+		pmu_sbi_snapshot_free(pmu);
+	}
 	riscv_pm_pmu_unregister(pmu);
 	cpuhp_state_remove_instance(CPUHP_AP_PERF_RISCV_STARTING, &pmu->node);
 }
@@ -1094,6 +1400,32 @@ static int pmu_sbi_device_probe(struct platform_device *pdev)
 	pmu->event_unmapped = pmu_sbi_event_unmapped;
 	pmu->csr_index = pmu_sbi_csr_index;
 
+	/* SBI PMU snapshot is only available in SBI v2.0 */
+	if (sbi_spec_version >= sbi_mk_version(2, 0)) {
+		int cpu;
+
+		ret = pmu_sbi_snapshot_alloc(pmu);
+		if (ret)
+			goto out_free;
+
+		cpu = get_cpu();
+		ret = pmu_sbi_snapshot_setup(pmu, cpu);
+		put_cpu();
+		if (ret) {
+			/* Snapshot is an optional feature. Continue if not available */
+			pmu_sbi_snapshot_free(pmu);
+		} else {
+			pr_info("SBI PMU snapshot detected\n");
+			/*
+			 * We enable it once here for the boot cpu. If snapshot shmem setup
+			 * fails during cpu hotplug process, it will fail to start the cpu
+			 * as we can not handle heterogeneous PMUs with different snapshot
+			 * capability.
+			 */
+			static_branch_enable(&sbi_pmu_snapshot_available);
+		}
+	}
+
 	ret = cpuhp_state_add_instance(CPUHP_AP_PERF_RISCV_STARTING, &pmu->node);
 	if (ret)
 		return ret;
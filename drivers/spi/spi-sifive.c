@@ -93,7 +93,10 @@ struct sifive_spi {
 	struct clk        *clk;         /* bus clock */
 	unsigned int      fifo_depth;   /* fifo depth in words */
 	u32               cs_inactive;  /* level of the CS pins when inactive */
-	struct completion done;         /* wake-up from interrupt */
+	const u8          *tx_ptr;      /* next word to queue */
+	u8                *rx_ptr;      /* next word to receive, NULL if tx only */
+	unsigned int      tx_words;     /* words left to queue */
+	unsigned int      rx_words;     /* words left to receive */
 };
 
 static void sifive_spi_write(struct sifive_spi *spi, int offset, u32 value)
@@ -205,50 +208,94 @@ sifive_spi_prep_transfer(struct sifive_spi *spi, struct spi_device *device,
 	return 1600000 * spi->fifo_depth <= t->speed_hz * mode;
 }
 
-static irqreturn_t sifive_spi_irq(int irq, void *dev_id)
+static void sifive_spi_tx(struct sifive_spi *spi, const u8 *tx_ptr)
 {
-	struct sifive_spi *spi = dev_id;
-	u32 ip = sifive_spi_read(spi, SIFIVE_SPI_REG_IP);
+	WARN_ON_ONCE((sifive_spi_read(spi, SIFIVE_SPI_REG_TXDATA)
+				& SIFIVE_SPI_TXDATA_FULL) != 0);
+	sifive_spi_write(spi, SIFIVE_SPI_REG_TXDATA,
+			 *tx_ptr & SIFIVE_SPI_TXDATA_DATA_MASK);
+}
 
-	if (ip & (SIFIVE_SPI_IP_TXWM | SIFIVE_SPI_IP_RXWM)) {
-		/* Disable interrupts until next transfer */
-		sifive_spi_write(spi, SIFIVE_SPI_REG_IE, 0);
-		complete(&spi->done);
-		return IRQ_HANDLED;
-	}
+/* Queue as many words as fit next to the @used FIFO entries */
+static void sifive_spi_fill(struct sifive_spi *spi, unsigned int used)
+{
+	unsigned int n_words = min(spi->tx_words, spi->fifo_depth - used);
 
-	return IRQ_NONE;
+	spi->tx_words -= n_words;
+	while (n_words--)
+		sifive_spi_tx(spi, spi->tx_ptr++);
 }
 
-static void sifive_spi_wait(struct sifive_spi *spi, u32 bit, int poll)
+/*
+ * Move the transfer along: read out what was received, top the FIFO up
+ * and program the watermark to fire once it is about half empty again, or
+ * once the last word is out. Returns true when the transfer is complete.
+ *
+ * When receiving, the words queued but not read back yet are bounded by the
+ * FIFO depth, so the RX FIFO can't overflow while we are away.
+ */
+static bool sifive_spi_pump(struct sifive_spi *spi)
 {
-	if (poll) {
-		u32 cr;
+	unsigned int mark = DIV_ROUND_UP(spi->fifo_depth, 2);
+
+	if (spi->rx_ptr) {
+		while (spi->rx_words > spi->tx_words) {
+			u32 data = sifive_spi_read(spi, SIFIVE_SPI_REG_RXDATA);
 
-		do {
-			cr = sifive_spi_read(spi, SIFIVE_SPI_REG_IP);
-		} while (!(cr & bit));
+			if (data & SIFIVE_SPI_RXDATA_EMPTY)
+				break;
+			*spi->rx_ptr++ = data & SIFIVE_SPI_RXDATA_DATA_MASK;
+			spi->rx_words--;
+		}
+		if (!spi->rx_words)
+			return true;
+
+		sifive_spi_fill(spi, spi->rx_words - spi->tx_words);
+		if (!spi->tx_words)
+			mark = spi->rx_words;
+		/* RXWM is pending while the RX FIFO holds more than RXMARK */
+		sifive_spi_write(spi, SIFIVE_SPI_REG_RXMARK, mark - 1);
 	} else {
-		reinit_completion(&spi->done);
-		sifive_spi_write(spi, SIFIVE_SPI_REG_IE, bit);
-		wait_for_completion(&spi->done);
+		/* TXMARK was 1 and the FIFO drained, all words are out */
+		if (!spi->tx_words)
+			return true;
+
+		sifive_spi_fill(spi, mark - 1);
+		if (!spi->tx_words)
+			mark = 1;
+		/* TXWM is pending while the TX FIFO holds less than TXMARK */
+		sifive_spi_write(spi, SIFIVE_SPI_REG_TXMARK, mark);
 	}
+
+	return false;
 }
 
-static void sifive_spi_tx(struct sifive_spi *spi, const u8 *tx_ptr)
+static irqreturn_t sifive_spi_irq(int irq, void *dev_id)
 {
-	WARN_ON_ONCE((sifive_spi_read(spi, SIFIVE_SPI_REG_TXDATA)
-				& SIFIVE_SPI_TXDATA_FULL) != 0);
-	sifive_spi_write(spi, SIFIVE_SPI_REG_TXDATA,
-			 *tx_ptr & SIFIVE_SPI_TXDATA_DATA_MASK);
+	struct spi_controller *host = dev_id;
+	struct sifive_spi *spi = spi_controller_get_devdata(host);
+	u32 ie = sifive_spi_read(spi, SIFIVE_SPI_REG_IE);
+	u32 ip = sifive_spi_read(spi, SIFIVE_SPI_REG_IP);
+
+	if (!(ip & ie))
+		return IRQ_NONE;
+
+	if (sifive_spi_pump(spi)) {
+		/* Disable interrupts until next transfer */
+		sifive_spi_write(spi, SIFIVE_SPI_REG_IE, 0);
+		spi_finalize_current_transfer(host);
+	}
+
+	return IRQ_HANDLED;
 }
 
-static void sifive_spi_rx(struct sifive_spi *spi, u8 *rx_ptr)
+static void sifive_spi_wait(struct sifive_spi *spi, u32 bit)
 {
-	u32 data = sifive_spi_read(spi, SIFIVE_SPI_REG_RXDATA);
+	u32 cr;
 
-	WARN_ON_ONCE((data & SIFIVE_SPI_RXDATA_EMPTY) != 0);
-	*rx_ptr = data & SIFIVE_SPI_RXDATA_DATA_MASK;
+	do {
+		cr = sifive_spi_read(spi, SIFIVE_SPI_REG_IP);
+	} while (!(cr & bit));
 }
 
 static int
@@ -257,36 +304,42 @@ sifive_spi_transfer_one(struct spi_controller *host, struct spi_device *device,
 {
 	struct sifive_spi *spi = spi_controller_get_devdata(host);
 	int poll = sifive_spi_prep_transfer(spi, device, t);
-	const u8 *tx_ptr = t->tx_buf;
-	u8 *rx_ptr = t->rx_buf;
-	unsigned int remaining_words = t->len;
-
-	while (remaining_words) {
-		unsigned int n_words = min(remaining_words, spi->fifo_depth);
-		unsigned int i;
-
-		/* Enqueue n_words for transmission */
-		for (i = 0; i < n_words; i++)
-			sifive_spi_tx(spi, tx_ptr++);
-
-		if (rx_ptr) {
-			/* Wait for transmission + reception to complete */
-			sifive_spi_write(spi, SIFIVE_SPI_REG_RXMARK,
-					 n_words - 1);
-			sifive_spi_wait(spi, SIFIVE_SPI_IP_RXWM, poll);
-
-			/* Read out all the data from the RX FIFO */
-			for (i = 0; i < n_words; i++)
-				sifive_spi_rx(spi, rx_ptr++);
-		} else {
-			/* Wait for transmission to complete */
-			sifive_spi_wait(spi, SIFIVE_SPI_IP_TXWM, poll);
-		}
+	u32 bit = t->rx_buf ? SIFIVE_SPI_IP_RXWM : SIFIVE_SPI_IP_TXWM;
+
+	spi->tx_ptr = t->tx_buf;
+	spi->rx_ptr = t->rx_buf;
+	spi->tx_words = t->len;
+	spi->rx_words = t->rx_buf ? t->len : 0;
 
-		remaining_words -= n_words;
+	if (poll) {
+		while (!sifive_spi_pump(spi))
+			sifive_spi_wait(spi, bit);
+		return 0;
 	}
 
-	return 0;
+	/*
+	 * The interrupt handler keeps the FIFO going and finalizes the
+	 * transfer, so there is one interrupt per half FIFO rather than a
+	 * thread wake-up per FIFO fill.
+	 */
+	if (sifive_spi_pump(spi))
+		return 0;
+	sifive_spi_write(spi, SIFIVE_SPI_REG_IE, bit);
+
+	return 1;
+}
+
+static void sifive_spi_handle_err(struct spi_controller *host,
+				  struct spi_message *msg)
+{
+	struct sifive_spi *spi = spi_controller_get_devdata(host);
+
+	sifive_spi_write(spi, SIFIVE_SPI_REG_IE, 0);
+
+	/* Don't let the next transfer read what is left of this one */
+	while (!(sifive_spi_read(spi, SIFIVE_SPI_REG_RXDATA) &
+		 SIFIVE_SPI_RXDATA_EMPTY))
+		;
 }
 
 static int sifive_spi_probe(struct platform_device *pdev)
@@ -303,7 +356,6 @@ static int sifive_spi_probe(struct platform_device *pdev)
 	}
 
 	spi = spi_controller_get_devdata(host);
-	init_completion(&spi->done);
 	platform_set_drvdata(pdev, host);
 
 	spi->regs = devm_platform_ioremap_resource(pdev, 0);
@@ -383,6 +435,7 @@ static int sifive_spi_probe(struct platform_device *pdev)
 	host->prepare_message = sifive_spi_prepare_message;
 	host->set_cs = sifive_spi_set_cs;
 	host->transfer_one = sifive_spi_transfer_one;
+	host->handle_err = sifive_spi_handle_err;
 
 	pdev->dev.dma_mask = NULL;
 	/* Configure the SPI host hardware */
@@ -390,7 +443,7 @@ static int sifive_spi_probe(struct platform_device *pdev)
 
 	/* Register for SPI Interrupt */
 	ret = devm_request_irq(&pdev->dev, irq, sifive_spi_irq, 0,
-			       dev_name(&pdev->dev), spi);
+			       dev_name(&pdev->dev), host);
 	if (ret) {
 		dev_err(&pdev->dev, "Unable to bind to interrupt\n");
 		goto disable_clk;
@@ -8,13 +8,30 @@
 #include <linux/console.h>
 #include <linux/err.h>
 #include <linux/init.h>
+#include <linux/irq_work.h>
 #include <linux/moduleparam.h>
+#include <linux/printk.h>
+#include <linux/spinlock.h>
 #include <linux/types.h>
 
 #include <asm/sbi.h>
 
 #include "hvc_console.h"
 
+/*
+ * The console hands over output in chunks of a few bytes, so it is staged
+ * here and written with one DBCN call when the console flushes, the buffer
+ * fills up or the irq_work runs for tty output. The buffer is aligned to its
+ * size so it never crosses a page and each write takes a single call.
+ */
+#define DBCN_OUTBUF_SIZE	1024
+
+static u8 dbcn_outbuf[DBCN_OUTBUF_SIZE] __aligned(DBCN_OUTBUF_SIZE);
+static size_t dbcn_outbuf_len;
+
+/* Lock to serialize access to the staging buffer */
+static DEFINE_RAW_SPINLOCK(dbcn_lock);
+
 static ssize_t hvc_sbi_tty_put(uint32_t vtermno, const u8 *buf, size_t count)
 {
 	size_t i;
@@ -45,9 +62,79 @@ static const struct hv_ops hvc_sbi_v01_ops = {
 	.put_chars = hvc_sbi_tty_put,
 };
 
+/* Called with dbcn_lock held */
+static void hvc_sbi_dbcn_drain(void)
+{
+	size_t done = 0;
+	int ret;
+
+	while (done < dbcn_outbuf_len) {
+		ret = sbi_debug_console_write(dbcn_outbuf + done,
+					      dbcn_outbuf_len - done);
+		/* Throw away the output on error, as hvc does. */
+		if (ret <= 0)
+			break;
+		done += ret;
+	}
+
+	dbcn_outbuf_len = 0;
+}
+
+static void hvc_sbi_dbcn_work(struct irq_work *work)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&dbcn_lock, flags);
+	hvc_sbi_dbcn_drain();
+	raw_spin_unlock_irqrestore(&dbcn_lock, flags);
+}
+
+static struct irq_work dbcn_work = IRQ_WORK_INIT_LAZY(hvc_sbi_dbcn_work);
+
 static ssize_t hvc_sbi_dbcn_tty_put(uint32_t vtermno, const u8 *buf, size_t count)
 {
-	return sbi_debug_console_write(buf, count);
+	unsigned long flags;
+	size_t len;
+
+	/*
+	 * Nothing may be left behind in a panic, write through. The lock may
+	 * be held by a CPU that was stopped, don't wait for it then.
+	 */
+	if (unlikely(oops_in_progress)) {
+		if (raw_spin_trylock_irqsave(&dbcn_lock, flags)) {
+			hvc_sbi_dbcn_drain();
+			raw_spin_unlock_irqrestore(&dbcn_lock, flags);
+		}
+		return sbi_debug_console_write(buf, count);
+	}
+
+	raw_spin_lock_irqsave(&dbcn_lock, flags);
+	if (dbcn_outbuf_len == DBCN_OUTBUF_SIZE)
+		hvc_sbi_dbcn_drain();
+	len = min(count, DBCN_OUTBUF_SIZE - dbcn_outbuf_len);
+	memcpy(dbcn_outbuf + dbcn_outbuf_len, buf, len);
+	dbcn_outbuf_len += len;
+	raw_spin_unlock_irqrestore(&dbcn_lock, flags);
+
+	/*
+	 * The tty side doesn't flush, make sure its output goes out. This is
+	 * also the console write path, which may run under the scheduler's
+	 * locks, so it can't use a workqueue.
+	 */
+	irq_work_queue(&dbcn_work);
+
+	return len;
+}
+
+static int hvc_sbi_dbcn_flush(uint32_t vtermno, bool wait)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&dbcn_lock, flags);
+	hvc_sbi_dbcn_drain();
+	raw_spin_unlock_irqrestore(&dbcn_lock, flags);
+
+	return 0;
 }
 
 static ssize_t hvc_sbi_dbcn_tty_get(uint32_t vtermno, u8 *buf, size_t count)
@@ -58,6 +145,7 @@ static ssize_t hvc_sbi_dbcn_tty_get(uint32_t vtermno, u8 *buf, size_t count)
 static const struct hv_ops hvc_sbi_dbcn_ops = {
 	.put_chars = hvc_sbi_dbcn_tty_put,
 	.get_chars = hvc_sbi_dbcn_tty_get,
+	.flush = hvc_sbi_dbcn_flush,
 };
 
 static int __init hvc_sbi_init(void)
@@ -65,7 +153,8 @@ static int __init hvc_sbi_init(void)
 	int err;
 
 	if (sbi_debug_console_available) {
-		err = PTR_ERR_OR_ZERO(hvc_alloc(0, 0, &hvc_sbi_dbcn_ops, 256));
+		err = PTR_ERR_OR_ZERO(hvc_alloc(0, 0, &hvc_sbi_dbcn_ops,
+						   DBCN_OUTBUF_SIZE));
 		if (err)
 			return err;
 		hvc_instantiate(0, 0, &hvc_sbi_dbcn_ops);
@@ -40,6 +40,14 @@ module_param(experimental_zcopytx, int, 0444);
 MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 		                       " 1 -Enable; 0 - Disable");
 
+static bool busyloop_adaptive = true;
+module_param(busyloop_adaptive, bool, 0644);
+MODULE_PARM_DESC(busyloop_adaptive,
+		 "Shrink the busy polling time of idle virtqueues");
+
+/* The busy polling time shrinks down to busyloop_timeout >> this. */
+#define VHOST_NET_BUSYLOOP_SHIFT_MAX 4
+
 /* Max number of bytes transferred before requeueing the job.
  * Using this limit prevents one virtqueue from starving others. */
 #define VHOST_NET_WEIGHT 0x80000
@@ -127,6 +135,10 @@ struct vhost_net_virtqueue {
 	struct vhost_net_buf rxq;
 	/* Batched XDP buffs */
 	struct xdp_buff *xdp;
+	/* The busy polling time is busyloop_timeout >> busyloop_shift.
+	 * Protected by vq mutex.
+	 */
+	unsigned int busyloop_shift;
 };
 
 struct vhost_net {
@@ -310,6 +322,7 @@ static void vhost_net_vq_reset(struct vhost_net *n)
 		n->vqs[i].ubufs = NULL;
 		n->vqs[i].vhost_hlen = 0;
 		n->vqs[i].sock_hlen = 0;
+		n->vqs[i].busyloop_shift = 0;
 		vhost_net_buf_init(&n->vqs[i].rxq);
 	}
 
@@ -516,16 +529,31 @@ static void vhost_net_busy_poll_try_queue(struct vhost_net *net,
 	}
 }
 
+/* Halve the busy polling time of @nvq after a miss, double it after a hit. */
+static void vhost_net_busy_poll_adapt(struct vhost_net_virtqueue *nvq,
+				      bool hit)
+{
+	if (!READ_ONCE(busyloop_adaptive))
+		nvq->busyloop_shift = 0;
+	else if (hit && nvq->busyloop_shift)
+		nvq->busyloop_shift--;
+	else if (!hit && nvq->busyloop_shift < VHOST_NET_BUSYLOOP_SHIFT_MAX)
+		nvq->busyloop_shift++;
+}
+
 static void vhost_net_busy_poll(struct vhost_net *net,
 				struct vhost_virtqueue *rvq,
 				struct vhost_virtqueue *tvq,
 				bool *busyloop_intr,
 				bool poll_rx)
 {
+	struct vhost_net_virtqueue *nvq = container_of(poll_rx ? rvq : tvq,
+					struct vhost_net_virtqueue, vq);
 	unsigned long busyloop_timeout;
 	unsigned long endtime;
 	struct socket *sock;
 	struct vhost_virtqueue *vq = poll_rx ? tvq : rvq;
+	bool timed_out = true;
 
 	/* Try to hold the vq mutex of the paired virtqueue. We can't
 	 * use mutex_lock() here since we could not guarantee a
@@ -537,8 +565,7 @@ static void vhost_net_busy_poll(struct vhost_net *net,
 	vhost_disable_notify(&net->dev, vq);
 	sock = vhost_vq_get_backend(rvq);
 
-	busyloop_timeout = poll_rx ? rvq->busyloop_timeout:
-				     tvq->busyloop_timeout;
+	busyloop_timeout = nvq->vq.busyloop_timeout >> nvq->busyloop_shift;
 
 	preempt_disable();
 	endtime = busy_clock() + busyloop_timeout;
@@ -551,14 +578,20 @@ static void vhost_net_busy_poll(struct vhost_net *net,
 
 		if ((sock_has_rx_data(sock) &&
 		     !vhost_vq_avail_empty(&net->dev, rvq)) ||
-		    !vhost_vq_avail_empty(&net->dev, tvq))
+		    !vhost_vq_avail_empty(&net->dev, tvq)) {
+			timed_out = false;
 			break;
+		}
 
 		cpu_relax();
 	}
 
 	preempt_enable();
 
+	/* Being rescheduled or interrupted says nothing about the traffic. */
+	if (!*busyloop_intr && (!timed_out || time_after(busy_clock(), endtime)))
+		vhost_net_busy_poll_adapt(nvq, !timed_out);
+
 	if (poll_rx || sock_has_rx_data(sock))
 		vhost_net_busy_poll_try_queue(net, vq);
 	else if (!poll_rx) /* On tx here, sock has no rx data. */
@@ -1308,6 +1341,7 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 		n->vqs[i].vhost_hlen = 0;
 		n->vqs[i].sock_hlen = 0;
 		n->vqs[i].rx_ring = NULL;
+		n->vqs[i].busyloop_shift = 0;
 		vhost_net_buf_init(&n->vqs[i].rxq);
 	}
 	vhost_dev_init(dev, vqs, VHOST_NET_VQ_MAX,
@@ -70,6 +70,7 @@
 struct vring_desc_state_split {
 	void *data;			/* Data for callback. */
 	struct vring_desc *indir_desc;	/* Indirect descriptor, if any. */
+	u32 total_in_len;		/* Writable length, for in order. */
 };
 
 struct vring_desc_state_packed {
@@ -77,6 +78,7 @@ struct vring_desc_state_packed {
 	struct vring_packed_desc *indir_desc; /* Indirect descriptor, if any. */
 	u16 num;			/* Descriptor list length. */
 	u16 last;			/* The last desc state in a list. */
+	u32 total_in_len;		/* Writable length, for in order. */
 };
 
 struct vring_desc_extra {
@@ -133,6 +135,15 @@ struct vring_virtqueue_packed {
 	/* Index of the next avail descriptor. */
 	u16 next_avail_idx;
 
+	/*
+	 * While adding a batch, the head of its first buffer and the flags
+	 * that make it available, written last so that the device picks up
+	 * the whole batch at once.
+	 */
+	bool add_batch_pending;
+	u16 add_batch_head;
+	__le16 add_batch_head_flags;
+
 	/*
 	 * Last written value to driver->flags in
 	 * guest byte order.
@@ -172,6 +183,9 @@ struct vring_virtqueue {
 	/* Host publishes avail event idx */
 	bool event;
 
+	/* Host uses buffers in the order they were made available */
+	bool in_order;
+
 	/* Do DMA mapping by driver */
 	bool premapped;
 
@@ -196,6 +210,17 @@ struct vring_virtqueue {
 	/* Hint for event idx: already triggered no need to disable. */
 	bool event_triggered;
 
+	/*
+	 * In order only: the last buffer of a batch that the device returned
+	 * with a single used entry, and the length it reported for it. The
+	 * buffers up to and including it are used. The id is UINT_MAX when
+	 * there is no such batch.
+	 */
+	struct {
+		unsigned int id;
+		unsigned int len;
+	} batch_last;
+
 	union {
 		/* Available for split ring */
 		struct vring_virtqueue_split split;
@@ -417,6 +442,11 @@ static int vring_mapping_error(const struct vring_virtqueue *vq,
 	return dma_mapping_error(vring_dma_dev(vq), addr);
 }
 
+static bool used_batch_pending(const struct vring_virtqueue *vq)
+{
+	return vq->batch_last.id != UINT_MAX;
+}
+
 static void virtqueue_init(struct vring_virtqueue *vq, u32 num)
 {
 	vq->vq.num_free = num;
@@ -428,6 +458,11 @@ static void virtqueue_init(struct vring_virtqueue *vq, u32 num)
 
 	vq->event_triggered = false;
 	vq->num_added = 0;
+	vq->batch_last.id = UINT_MAX;
+
+	/* In order, descriptors are used starting from the head of the ring. */
+	if (vq->in_order)
+		vq->free_head = 0;
 
 #ifdef DEBUG
 	vq->in_use = false;
@@ -541,6 +576,10 @@ static inline unsigned int virtqueue_add_desc_split(struct virtqueue *vq,
 	return next;
 }
 
+/*
+ * With @batch, the new avail->idx is not published, virtqueue_add_batch()
+ * does that once for all the buffers it adds.
+ */
 static inline int virtqueue_add_split(struct virtqueue *_vq,
 				      struct scatterlist *sgs[],
 				      unsigned int total_sg,
@@ -548,12 +587,14 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 				      unsigned int in_sgs,
 				      void *data,
 				      void *ctx,
-				      gfp_t gfp)
+				      gfp_t gfp,
+				      bool batch)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
 	struct scatterlist *sg;
 	struct vring_desc *desc;
 	unsigned int i, n, avail, descs_used, prev, err_idx;
+	u32 total_in_len = 0;
 	int head;
 	bool indirect;
 
@@ -639,6 +680,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 						     VRING_DESC_F_NEXT |
 						     VRING_DESC_F_WRITE,
 						     indirect);
+			total_in_len += sg->length;
 		}
 	}
 	/* Last one doesn't continue. */
@@ -677,6 +719,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 
 	/* Store token and indirect buffer state. */
 	vq->split.desc_state[head].data = data;
+	vq->split.desc_state[head].total_in_len = total_in_len;
 	if (indirect)
 		vq->split.desc_state[head].indir_desc = desc;
 	else
@@ -686,16 +729,21 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 	 * do sync). */
 	avail = vq->split.avail_idx_shadow & (vq->split.vring.num - 1);
 	vq->split.vring.avail->ring[avail] = cpu_to_virtio16(_vq->vdev, head);
+	vq->split.avail_idx_shadow++;
+	vq->num_added++;
+
+	pr_debug("Added buffer head %i to %p\n", head, vq);
+
+	if (batch) {
+		END_USE(vq);
+		return 0;
+	}
 
 	/* Descriptors and available array need to be set before we expose the
 	 * new available array entries. */
 	virtio_wmb(vq->weak_barriers);
-	vq->split.avail_idx_shadow++;
 	vq->split.vring.avail->idx = cpu_to_virtio16(_vq->vdev,
 						vq->split.avail_idx_shadow);
-	vq->num_added++;
-
-	pr_debug("Added buffer head %i to %p\n", head, vq);
 	END_USE(vq);
 
 	/* This is very unlikely, but theoretically possible.  Kick
@@ -781,8 +829,12 @@ static void detach_buf_split(struct vring_virtqueue *vq, unsigned int head,
 	}
 
 	vring_unmap_one_split(vq, i);
-	vq->split.desc_extra[i].next = vq->free_head;
-	vq->free_head = head;
+
+	/* In order, the ring is a FIFO and the free list is implicit. */
+	if (!vq->in_order) {
+		vq->split.desc_extra[i].next = vq->free_head;
+		vq->free_head = head;
+	}
 
 	/* Plus final descriptor */
 	vq->vq.num_free++;
@@ -878,6 +930,84 @@ static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 	return ret;
 }
 
+/*
+ * With VIRTIO_F_IN_ORDER, descriptors are handed out in ring order and
+ * buffers are used in the order they were made available, so the next used
+ * buffer is always the oldest one. The device may return a whole batch with
+ * a single used entry for its last buffer: the others then report the full
+ * writable length. The used index still counts buffers, so last_used_idx
+ * moves on for each buffer returned, and the next used entry is only read
+ * once the batch is done.
+ */
+static void *virtqueue_get_buf_ctx_split_in_order(struct virtqueue *_vq,
+						  unsigned int *len,
+						  void **ctx)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	unsigned int num = vq->split.vring.num;
+	unsigned int head;
+	u16 last_used;
+	void *ret;
+
+	START_USE(vq);
+
+	if (unlikely(vq->broken)) {
+		END_USE(vq);
+		return NULL;
+	}
+
+	if (!used_batch_pending(vq)) {
+		if (!more_used_split(vq)) {
+			pr_debug("No more buffers in queue\n");
+			END_USE(vq);
+			return NULL;
+		}
+
+		/* Only get used array entries after they have been exposed by host. */
+		virtio_rmb(vq->weak_barriers);
+
+		last_used = (vq->last_used_idx & (num - 1));
+		vq->batch_last.id = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].id);
+		vq->batch_last.len = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].len);
+
+		if (unlikely(vq->batch_last.id >= num)) {
+			BAD_RING(vq, "id %u out of range\n", vq->batch_last.id);
+			return NULL;
+		}
+	}
+
+	/* The buffers in flight are the descriptors just behind free_head. */
+	head = (vq->free_head + vq->vq.num_free) & (num - 1);
+	if (unlikely(!vq->split.desc_state[head].data)) {
+		BAD_RING(vq, "id %u is not a head!\n", head);
+		return NULL;
+	}
+
+	if (head == vq->batch_last.id) {
+		*len = vq->batch_last.len;
+		vq->batch_last.id = UINT_MAX;
+	} else {
+		*len = vq->split.desc_state[head].total_in_len;
+	}
+
+	/* detach_buf_split clears data, so grab it now. */
+	ret = vq->split.desc_state[head].data;
+	detach_buf_split(vq, head, ctx);
+
+	vq->last_used_idx++;
+	if (!(vq->split.avail_flags_shadow & VRING_AVAIL_F_NO_INTERRUPT))
+		virtio_store_mb(vq->weak_barriers,
+				&vring_used_event(&vq->split.vring),
+				cpu_to_virtio16(_vq->vdev, vq->last_used_idx));
+
+	LAST_ADD_TIME_INVALID(vq);
+
+	END_USE(vq);
+	return ret;
+}
+
 static void virtqueue_disable_cb_split(struct virtqueue *_vq)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
@@ -1047,6 +1177,10 @@ static void virtqueue_vring_attach_split(struct vring_virtqueue *vq,
 
 	/* Put everything in free lists. */
 	vq->free_head = 0;
+
+	/* In order, the next descriptor of the last one is the first. */
+	if (vq->in_order)
+		vq->split.desc_extra[vq->split.vring.num - 1].next = 0;
 }
 
 static int vring_alloc_state_extra_split(struct vring_virtqueue_split *vring_split)
@@ -1280,17 +1414,45 @@ static struct vring_packed_desc *alloc_indirect_packed(unsigned int total_sg,
 	return desc;
 }
 
+/*
+ * Makes the buffer at @head available. In a batch, only the first head is
+ * held back: the device stops there, so the later ones can be written right
+ * away and the whole batch needs a single barrier.
+ */
+static inline void virtqueue_publish_head_packed(struct vring_virtqueue *vq,
+						 u16 head, __le16 head_flags,
+						 bool batch)
+{
+	if (batch && !vq->packed.add_batch_pending) {
+		vq->packed.add_batch_pending = true;
+		vq->packed.add_batch_head = head;
+		vq->packed.add_batch_head_flags = head_flags;
+		return;
+	}
+
+	/*
+	 * A driver MUST NOT make the first descriptor in the list
+	 * available before all subsequent descriptors comprising
+	 * the list are made available.
+	 */
+	if (!batch)
+		virtio_wmb(vq->weak_barriers);
+	vq->packed.vring.desc[head].flags = head_flags;
+}
+
 static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 					 struct scatterlist *sgs[],
 					 unsigned int total_sg,
 					 unsigned int out_sgs,
 					 unsigned int in_sgs,
 					 void *data,
-					 gfp_t gfp)
+					 gfp_t gfp,
+					 bool batch)
 {
 	struct vring_packed_desc *desc;
 	struct scatterlist *sg;
 	unsigned int i, n, err_idx;
+	u32 total_in_len = 0;
 	u16 head, id;
 	dma_addr_t addr;
 
@@ -1320,6 +1482,8 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 						0 : VRING_DESC_F_WRITE);
 			desc[i].addr = cpu_to_le64(addr);
 			desc[i].len = cpu_to_le32(sg->length);
+			if (n >= out_sgs)
+				total_in_len += sg->length;
 			i++;
 		}
 	}
@@ -1348,14 +1512,10 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 						  vq->packed.avail_used_flags;
 	}
 
-	/*
-	 * A driver MUST NOT make the first descriptor in the list
-	 * available before all subsequent descriptors comprising
-	 * the list are made available.
-	 */
-	virtio_wmb(vq->weak_barriers);
-	vq->packed.vring.desc[head].flags = cpu_to_le16(VRING_DESC_F_INDIRECT |
-						vq->packed.avail_used_flags);
+	virtqueue_publish_head_packed(vq, head,
+				      cpu_to_le16(VRING_DESC_F_INDIRECT |
+						  vq->packed.avail_used_flags),
+				      batch);
 
 	/* We're using some buffers from the free list. */
 	vq->vq.num_free -= 1;
@@ -1377,6 +1537,7 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 	vq->packed.desc_state[id].data = data;
 	vq->packed.desc_state[id].indir_desc = desc;
 	vq->packed.desc_state[id].last = id;
+	vq->packed.desc_state[id].total_in_len = total_in_len;
 
 	vq->num_added += 1;
 
@@ -1405,12 +1566,14 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 				       unsigned int in_sgs,
 				       void *data,
 				       void *ctx,
-				       gfp_t gfp)
+				       gfp_t gfp,
+				       bool batch)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
 	struct vring_packed_desc *desc;
 	struct scatterlist *sg;
 	unsigned int i, n, c, descs_used, err_idx;
+	u32 total_in_len = 0;
 	__le16 head_flags, flags;
 	u16 head, id, prev, curr, avail_used_flags;
 	int err;
@@ -1431,7 +1594,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 
 	if (virtqueue_use_indirect(vq, total_sg)) {
 		err = virtqueue_add_indirect_packed(vq, sgs, total_sg, out_sgs,
-						    in_sgs, data, gfp);
+						    in_sgs, data, gfp, batch);
 		if (err != -ENOMEM) {
 			END_USE(vq);
 			return err;
@@ -1480,6 +1643,8 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 			desc[i].addr = cpu_to_le64(addr);
 			desc[i].len = cpu_to_le32(sg->length);
 			desc[i].id = cpu_to_le16(id);
+			if (n >= out_sgs)
+				total_in_len += sg->length;
 
 			if (unlikely(vq->use_dma_api)) {
 				vq->packed.desc_extra[curr].addr = addr;
@@ -1514,14 +1679,9 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 	vq->packed.desc_state[id].data = data;
 	vq->packed.desc_state[id].indir_desc = ctx;
 	vq->packed.desc_state[id].last = prev;
+	vq->packed.desc_state[id].total_in_len = total_in_len;
 
-	/*
-	 * A driver MUST NOT make the first descriptor in the list
-	 * available before all subsequent descriptors comprising
-	 * the list are made available.
-	 */
-	virtio_wmb(vq->weak_barriers);
-	vq->packed.vring.desc[head].flags = head_flags;
+	virtqueue_publish_head_packed(vq, head, head_flags, batch);
 	vq->num_added += descs_used;
 
 	pr_debug("Added buffer head %i to %p\n", head, vq);
@@ -1611,8 +1771,11 @@ static void detach_buf_packed(struct vring_virtqueue *vq,
 	/* Clear data ptr. */
 	state->data = NULL;
 
-	vq->packed.desc_extra[state->last].next = vq->free_head;
-	vq->free_head = id;
+	/* In order, the ring is a FIFO and the free list is implicit. */
+	if (!vq->in_order) {
+		vq->packed.desc_extra[state->last].next = vq->free_head;
+		vq->free_head = id;
+	}
 	vq->vq.num_free += state->num;
 
 	if (unlikely(vq->use_dma_api)) {
@@ -1739,6 +1902,101 @@ static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 	return ret;
 }
 
+/*
+ * With VIRTIO_F_IN_ORDER, see virtqueue_get_buf_ctx_split_in_order(). The
+ * device writes a single used element for a batch, at the position of the
+ * first buffer, and skips the rest of the batch. The used index is moved
+ * past the whole batch right away, the buffers are handed out one by one.
+ */
+static void *virtqueue_get_buf_ctx_packed_in_order(struct virtqueue *_vq,
+						   unsigned int *len,
+						   void **ctx)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	unsigned int num = vq->packed.vring.num;
+	u16 last_used, id, last_used_idx;
+	bool used_wrap_counter;
+	unsigned int head, n;
+	void *ret;
+
+	START_USE(vq);
+
+	if (unlikely(vq->broken)) {
+		END_USE(vq);
+		return NULL;
+	}
+
+	if (!used_batch_pending(vq)) {
+		if (!more_used_packed(vq)) {
+			pr_debug("No more buffers in queue\n");
+			END_USE(vq);
+			return NULL;
+		}
+
+		/* Only get used elements after they have been exposed by host. */
+		virtio_rmb(vq->weak_barriers);
+
+		last_used_idx = READ_ONCE(vq->last_used_idx);
+		used_wrap_counter = packed_used_wrap_counter(last_used_idx);
+		last_used = packed_last_used(last_used_idx);
+		id = le16_to_cpu(vq->packed.vring.desc[last_used].id);
+		vq->batch_last.len = le32_to_cpu(vq->packed.vring.desc[last_used].len);
+
+		if (unlikely(id >= num)) {
+			BAD_RING(vq, "id %u out of range\n", id);
+			return NULL;
+		}
+
+		/* Buffer ids are the positions of their first descriptor. */
+		for (n = 0; ; n++) {
+			head = last_used;
+			if (unlikely(n == num || !vq->packed.desc_state[head].data)) {
+				BAD_RING(vq, "id %u is not a head!\n", id);
+				return NULL;
+			}
+
+			last_used += vq->packed.desc_state[head].num;
+			if (unlikely(last_used >= num)) {
+				last_used -= num;
+				used_wrap_counter ^= 1;
+			}
+
+			if (head == id)
+				break;
+		}
+
+		vq->batch_last.id = id;
+		last_used = (last_used | (used_wrap_counter << VRING_PACKED_EVENT_F_WRAP_CTR));
+		WRITE_ONCE(vq->last_used_idx, last_used);
+
+		if (vq->packed.event_flags_shadow == VRING_PACKED_EVENT_FLAG_DESC)
+			virtio_store_mb(vq->weak_barriers,
+					&vq->packed.vring.driver->off_wrap,
+					cpu_to_le16(vq->last_used_idx));
+	}
+
+	/* The buffers in flight are the descriptors just behind free_head. */
+	head = vq->free_head + vq->vq.num_free;
+	if (head >= num)
+		head -= num;
+
+	if (head == vq->batch_last.id) {
+		*len = vq->batch_last.len;
+		vq->batch_last.id = UINT_MAX;
+	} else {
+		*len = vq->packed.desc_state[head].total_in_len;
+	}
+
+	/* detach_buf_packed clears data, so grab it now. */
+	ret = vq->packed.desc_state[head].data;
+	detach_buf_packed(vq, head, ctx);
+
+	LAST_ADD_TIME_INVALID(vq);
+
+	END_USE(vq);
+	return ret;
+}
+
 static void virtqueue_disable_cb_packed(struct virtqueue *_vq)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
@@ -2017,6 +2275,7 @@ static void virtqueue_vring_init_packed(struct vring_virtqueue_packed *vring_pac
 					bool callback)
 {
 	vring_packed->next_avail_idx = 0;
+	vring_packed->add_batch_pending = false;
 	vring_packed->avail_wrap_counter = 1;
 	vring_packed->event_flags_shadow = 0;
 	vring_packed->avail_used_flags = 1 << VRING_PACKED_DESC_F_AVAIL;
@@ -2036,6 +2295,10 @@ static void virtqueue_vring_attach_packed(struct vring_virtqueue *vq,
 
 	/* Put everything in free lists. */
 	vq->free_head = 0;
+
+	/* In order, buffer ids are the ring positions of their heads. */
+	if (vq->in_order)
+		vq->packed.desc_extra[vq->packed.vring.num - 1].next = 0;
 }
 
 static void virtqueue_reinit_packed(struct vring_virtqueue *vq)
@@ -2096,6 +2359,7 @@ static struct virtqueue *vring_create_virtqueue_packed(
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->in_order = virtio_has_feature(vdev, VIRTIO_F_IN_ORDER);
 
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
@@ -2206,9 +2470,23 @@ static inline int virtqueue_add(struct virtqueue *_vq,
 	struct vring_virtqueue *vq = to_vvq(_vq);
 
 	return vq->packed_ring ? virtqueue_add_packed(_vq, sgs, total_sg,
-					out_sgs, in_sgs, data, ctx, gfp) :
+					out_sgs, in_sgs, data, ctx, gfp, false) :
 				 virtqueue_add_split(_vq, sgs, total_sg,
-					out_sgs, in_sgs, data, ctx, gfp);
+					out_sgs, in_sgs, data, ctx, gfp, false);
+}
+
+static unsigned int virtqueue_count_sgs(struct scatterlist *sgs[],
+					unsigned int nents)
+{
+	unsigned int i, total_sg = 0;
+	struct scatterlist *sg;
+
+	for (i = 0; i < nents; i++) {
+		for (sg = sgs[i]; sg; sg = sg_next(sg))
+			total_sg++;
+	}
+
+	return total_sg;
 }
 
 /**
@@ -2232,20 +2510,80 @@ int virtqueue_add_sgs(struct virtqueue *_vq,
 		      void *data,
 		      gfp_t gfp)
 {
-	unsigned int i, total_sg = 0;
-
 	/* Count them first. */
-	for (i = 0; i < out_sgs + in_sgs; i++) {
-		struct scatterlist *sg;
+	unsigned int total_sg = virtqueue_count_sgs(sgs, out_sgs + in_sgs);
 
-		for (sg = sgs[i]; sg; sg = sg_next(sg))
-			total_sg++;
-	}
 	return virtqueue_add(_vq, sgs, total_sg, out_sgs, in_sgs,
 			     data, NULL, gfp);
 }
 EXPORT_SYMBOL_GPL(virtqueue_add_sgs);
 
+/**
+ * virtqueue_add_batch - expose several buffers to other end at once
+ * @_vq: the struct virtqueue we're talking about.
+ * @bufs: the buffers, each as for virtqueue_add_sgs().
+ * @num: the number of entries in @bufs.
+ * @gfp: how to do memory allocations (if necessary).
+ *
+ * The buffers are added in order and made visible to the device together,
+ * with a single avail index update (split ring) or head flags write (packed
+ * ring). Adding stops at the first buffer that does not fit or fails.
+ *
+ * Caller must ensure we don't call this with other virtqueue operations
+ * at the same time (except where noted).
+ *
+ * Returns the number of buffers added, or a negative error (ie. ENOSPC,
+ * ENOMEM, EIO) if not even the first one could be added.
+ */
+int virtqueue_add_batch(struct virtqueue *_vq,
+			const struct virtqueue_buf *bufs,
+			unsigned int num,
+			gfp_t gfp)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	const struct virtqueue_buf *buf;
+	unsigned int n, total_sg;
+	int err = 0;
+
+	for (n = 0; n < num; n++) {
+		buf = &bufs[n];
+		total_sg = virtqueue_count_sgs(buf->sgs, buf->out_sgs + buf->in_sgs);
+		if (vq->packed_ring)
+			err = virtqueue_add_packed(_vq, buf->sgs, total_sg,
+						   buf->out_sgs, buf->in_sgs,
+						   buf->data, NULL, gfp, true);
+		else
+			err = virtqueue_add_split(_vq, buf->sgs, total_sg,
+						  buf->out_sgs, buf->in_sgs,
+						  buf->data, NULL, gfp, true);
+		if (err)
+			break;
+	}
+
+	if (!n)
+		return err;
+
+	START_USE(vq);
+	/* Descriptors need to be set before we expose them. */
+	virtio_wmb(vq->weak_barriers);
+	if (vq->packed_ring) {
+		vq->packed.vring.desc[vq->packed.add_batch_head].flags =
+			vq->packed.add_batch_head_flags;
+		vq->packed.add_batch_pending = false;
+	} else {
+		vq->split.vring.avail->idx = cpu_to_virtio16(_vq->vdev,
+						vq->split.avail_idx_shadow);
+	}
+	END_USE(vq);
+
+	/* See virtqueue_add_split(). */
+	if (unlikely(!vq->packed_ring && vq->num_added >= (1 << 16) - 1))
+		virtqueue_kick(_vq);
+
+	return n;
+}
+EXPORT_SYMBOL_GPL(virtqueue_add_batch);
+
 /**
  * virtqueue_add_outbuf - expose output buffers to other end
  * @vq: the struct virtqueue we're talking about.
@@ -2417,6 +2755,11 @@ void *virtqueue_get_buf_ctx(struct virtqueue *_vq, unsigned int *len,
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
 
+	if (vq->in_order)
+		return vq->packed_ring ?
+			virtqueue_get_buf_ctx_packed_in_order(_vq, len, ctx) :
+			virtqueue_get_buf_ctx_split_in_order(_vq, len, ctx);
+
 	return vq->packed_ring ? virtqueue_get_buf_ctx_packed(_vq, len, ctx) :
 				 virtqueue_get_buf_ctx_split(_vq, len, ctx);
 }
@@ -2487,6 +2830,10 @@ bool virtqueue_poll(struct virtqueue *_vq, unsigned int last_used_idx)
 	if (unlikely(vq->broken))
 		return false;
 
+	/* The rest of a used batch has not been fetched yet. */
+	if (used_batch_pending(vq))
+		return true;
+
 	virtio_mb(vq->weak_barriers);
 	return vq->packed_ring ? virtqueue_poll_packed(_vq, last_used_idx) :
 				 virtqueue_poll_split(_vq, last_used_idx);
@@ -2532,6 +2879,9 @@ bool virtqueue_enable_cb_delayed(struct virtqueue *_vq)
 	if (vq->event_triggered)
 		vq->event_triggered = false;
 
+	if (used_batch_pending(vq))
+		return false;
+
 	return vq->packed_ring ? virtqueue_enable_cb_delayed_packed(_vq) :
 				 virtqueue_enable_cb_delayed_split(_vq);
 }
@@ -2556,6 +2906,9 @@ EXPORT_SYMBOL_GPL(virtqueue_detach_unused_buf);
 
 static inline bool more_used(const struct vring_virtqueue *vq)
 {
+	if (used_batch_pending(vq))
+		return true;
+
 	return vq->packed_ring ? more_used_packed(vq) : more_used_split(vq);
 }
 
@@ -2641,6 +2994,7 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->in_order = virtio_has_feature(vdev, VIRTIO_F_IN_ORDER);
 
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
@@ -2961,6 +3315,8 @@ void vring_transport_features(struct virtio_device *vdev)
 			break;
 		case VIRTIO_F_NOTIFICATION_DATA:
 			break;
+		case VIRTIO_F_IN_ORDER:
+			break;
 		default:
 			/* We don't understand this bit. */
 			__virtio_clear_bit(vdev, i);
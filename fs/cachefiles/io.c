@@ -386,7 +386,7 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 	const struct cred *saved_cred;
 	struct file *file = cachefiles_cres_file(cres);
 	enum netfs_io_source ret = NETFS_DOWNLOAD_FROM_SERVER;
-	size_t len = *_len;
+	size_t len = *_len, orig_len = len;
 	loff_t off, to;
 	ino_t ino = file ? file_inode(file)->i_ino : 0;
 	int rc;
@@ -474,9 +474,15 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 download_and_store:
 	__set_bit(NETFS_SREQ_COPY_TO_CACHE, _flags);
 	if (test_bit(NETFS_SREQ_ONDEMAND, _flags)) {
-		rc = cachefiles_ondemand_read(object, start, len);
+		/*
+		 * Ask the daemon for the whole range, not just up to the next
+		 * data, so that a range with several holes costs one round trip
+		 * rather than one per hole, and read it all from the cache after.
+		 */
+		rc = cachefiles_ondemand_read(object, start, orig_len);
 		if (!rc) {
 			__clear_bit(NETFS_SREQ_ONDEMAND, _flags);
+			len = *_len = orig_len;
 			goto retry;
 		}
 		ret = NETFS_INVALID_READ;
@@ -107,6 +107,7 @@ struct z_erofs_decompressqueue {
 		struct kthread_work kthread_work;
 	} u;
 	bool eio, sync;
+	bool chunk;	/* split off by z_erofs_fanout_queue() */
 };
 
 static inline bool z_erofs_is_inline_pcluster(struct z_erofs_pcluster *pcl)
@@ -1350,6 +1351,101 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 	}
 }
 
+static void z_erofs_decompressqueue_work(struct work_struct *work);
+
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+static void z_erofs_decompressqueue_kthread_work(struct kthread_work *work)
+{
+	z_erofs_decompressqueue_work((struct work_struct *)work);
+}
+#endif
+
+/* queue a background jobqueue to the worker of @cpu */
+static void z_erofs_queue_bgq(struct z_erofs_decompressqueue *q,
+			      unsigned int cpu)
+{
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+	struct kthread_worker *worker;
+
+	rcu_read_lock();
+	worker = rcu_dereference(z_erofs_pcpu_workers[cpu]);
+	if (!worker) {
+		INIT_WORK(&q->u.work, z_erofs_decompressqueue_work);
+		queue_work(z_erofs_workqueue, &q->u.work);
+	} else {
+		kthread_queue_work(worker, &q->u.kthread_work);
+	}
+	rcu_read_unlock();
+#else
+	queue_work(z_erofs_workqueue, &q->u.work);
+#endif
+}
+
+/* don't bother to split jobqueues into chunks smaller than this */
+#define Z_EROFS_FANOUT_MIN_PCLUSTERS	4
+
+/*
+ * A large readahead ends up as a single jobqueue, so split it into chunks
+ * and hand them over to the workers of other online CPUs instead of
+ * decompressing all pclusters one by one here.  Pclusters are independent
+ * of each other (a folio shared by two of them is ended by whichever
+ * finishes last), so the order of decompression doesn't matter.
+ */
+static void z_erofs_fanout_queue(struct z_erofs_decompressqueue *bgq)
+{
+	struct z_erofs_decompressqueue *q = NULL, *nq;
+	z_erofs_next_pcluster_t owned = bgq->head;
+	unsigned int nr = 0, chunk, cpu;
+	struct z_erofs_pcluster *pcl;
+
+	while (owned != Z_EROFS_PCLUSTER_TAIL) {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
+		++nr;
+	}
+
+	chunk = max(DIV_ROUND_UP(nr, num_online_cpus()),
+		    Z_EROFS_FANOUT_MIN_PCLUSTERS);
+	if (nr < 2 * chunk)
+		return;
+
+	/* the first chunk stays in bgq, the others are queued elsewhere */
+	cpu = raw_smp_processor_id();
+	owned = bgq->head;
+	nr = 0;
+	while (owned != Z_EROFS_PCLUSTER_TAIL) {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
+		if (++nr % chunk || owned == Z_EROFS_PCLUSTER_TAIL)
+			continue;
+
+		/* if out of memory, the current chunk takes all the rest */
+		nq = kvzalloc(sizeof(*nq), GFP_NOIO | __GFP_NOWARN);
+		if (!nq)
+			break;
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+		kthread_init_work(&nq->u.kthread_work,
+				  z_erofs_decompressqueue_kthread_work);
+#else
+		INIT_WORK(&nq->u.work, z_erofs_decompressqueue_work);
+#endif
+		nq->sb = bgq->sb;
+		nq->eio = bgq->eio;
+		nq->chunk = true;
+		nq->head = owned;
+		WRITE_ONCE(pcl->next, Z_EROFS_PCLUSTER_TAIL);
+
+		if (q)
+			z_erofs_queue_bgq(q, cpu);
+		q = nq;
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+	}
+	if (q)
+		z_erofs_queue_bgq(q, cpu);
+}
+
 static void z_erofs_decompressqueue_work(struct work_struct *work)
 {
 	struct z_erofs_decompressqueue *bgq =
@@ -1357,18 +1453,14 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	struct page *pagepool = NULL;
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL);
+	/* chunks are decompressed here, splitting them again would cascade */
+	if (!bgq->chunk)
+		z_erofs_fanout_queue(bgq);
 	z_erofs_decompress_queue(bgq, &pagepool);
 	erofs_release_pages(&pagepool);
 	kvfree(bgq);
 }
 
-#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
-static void z_erofs_decompressqueue_kthread_work(struct kthread_work *work)
-{
-	z_erofs_decompressqueue_work((struct work_struct *)work);
-}
-#endif
-
 static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 				       int bios)
 {
@@ -1385,22 +1477,7 @@ static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 		return;
 	/* Use (kthread_)work and sync decompression for atomic contexts only */
 	if (!in_task() || irqs_disabled() || rcu_read_lock_any_held()) {
-#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
-		struct kthread_worker *worker;
-
-		rcu_read_lock();
-		worker = rcu_dereference(
-				z_erofs_pcpu_workers[raw_smp_processor_id()]);
-		if (!worker) {
-			INIT_WORK(&io->u.work, z_erofs_decompressqueue_work);
-			queue_work(z_erofs_workqueue, &io->u.work);
-		} else {
-			kthread_queue_work(worker, &io->u.kthread_work);
-		}
-		rcu_read_unlock();
-#else
-		queue_work(z_erofs_workqueue, &io->u.work);
-#endif
+		z_erofs_queue_bgq(io, raw_smp_processor_id());
 		/* enable sync decompression for readahead */
 		if (sbi->opt.sync_decompress == EROFS_SYNC_DECOMPRESS_AUTO)
 			sbi->opt.sync_decompress = EROFS_SYNC_DECOMPRESS_FORCE_ON;
@@ -7,6 +7,7 @@
 */
 
 #include "fuse_i.h"
+#include "fuse_dev_i.h"
 
 #include <linux/init.h>
 #include <linux/module.h>
@@ -25,21 +26,8 @@
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 MODULE_ALIAS("devname:fuse");
 
-/* Ordinary requests have even IDs, while interrupts IDs are odd */
-#define FUSE_INT_REQ_BIT (1ULL << 0)
-#define FUSE_REQ_ID_STEP (1ULL << 1)
-
 static struct kmem_cache *fuse_req_cachep;
 
-static struct fuse_dev *fuse_get_dev(struct file *file)
-{
-	/*
-	 * Lockless access is OK, because file->private data is set
-	 * once during mount and is valid until the file is released.
-	 */
-	return READ_ONCE(file->private_data);
-}
-
 static void fuse_request_init(struct fuse_mount *fm, struct fuse_req *req)
 {
 	INIT_LIST_HEAD(&req->list);
@@ -64,11 +52,6 @@ static void fuse_request_free(struct fuse_req *req)
 	kmem_cache_free(fuse_req_cachep, req);
 }
 
-static void __fuse_get_request(struct fuse_req *req)
-{
-	refcount_inc(&req->count);
-}
-
 /* Must be called with > 1 refcount */
 static void __fuse_put_request(struct fuse_req *req)
 {
@@ -101,8 +84,6 @@ static void fuse_drop_waiting(struct fuse_conn *fc)
 	}
 }
 
-static void fuse_put_request(struct fuse_req *req);
-
 static struct fuse_req *fuse_get_req(struct fuse_mount *fm, bool for_background)
 {
 	struct fuse_conn *fc = fm->fc;
@@ -155,7 +136,7 @@ static struct fuse_req *fuse_get_req(struct fuse_mount *fm, bool for_background)
 	return ERR_PTR(err);
 }
 
-static void fuse_put_request(struct fuse_req *req)
+void fuse_put_request(struct fuse_req *req)
 {
 	struct fuse_conn *fc = req->fm->fc;
 
@@ -229,6 +210,10 @@ __releases(fiq->lock)
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		fuse_len_args(req->args->in_numargs,
 			      (struct fuse_arg *) req->args->in_args);
+	if (fuse_uring_queue_req(req->fm->fc, req)) {
+		spin_unlock(&fiq->lock);
+		return;
+	}
 	list_add_tail(&req->list, &fiq->pending);
 	fiq->ops->wake_pending_and_unlock(fiq);
 }
@@ -641,22 +626,8 @@ static int unlock_request(struct fuse_req *req)
 	return err;
 }
 
-struct fuse_copy_state {
-	int write;
-	struct fuse_req *req;
-	struct iov_iter *iter;
-	struct pipe_buffer *pipebufs;
-	struct pipe_buffer *currbuf;
-	struct pipe_inode_info *pipe;
-	unsigned long nr_segs;
-	struct page *pg;
-	unsigned len;
-	unsigned offset;
-	unsigned move_pages:1;
-};
-
-static void fuse_copy_init(struct fuse_copy_state *cs, int write,
-			   struct iov_iter *iter)
+void fuse_copy_init(struct fuse_copy_state *cs, int write,
+		    struct iov_iter *iter)
 {
 	memset(cs, 0, sizeof(*cs));
 	cs->write = write;
@@ -664,7 +635,7 @@ static void fuse_copy_init(struct fuse_copy_state *cs, int write,
 }
 
 /* Unmap and put previous page of userspace buffer */
-static void fuse_copy_finish(struct fuse_copy_state *cs)
+void fuse_copy_finish(struct fuse_copy_state *cs)
 {
 	if (cs->currbuf) {
 		struct pipe_buffer *buf = cs->currbuf;
@@ -996,7 +967,7 @@ static int fuse_copy_pages(struct fuse_copy_state *cs, unsigned nbytes,
 }
 
 /* Copy a single argument in the request to/from userspace buffer */
-static int fuse_copy_one(struct fuse_copy_state *cs, void *val, unsigned size)
+int fuse_copy_one(struct fuse_copy_state *cs, void *val, unsigned size)
 {
 	while (size) {
 		if (!cs->len) {
@@ -1192,6 +1163,61 @@ __releases(fiq->lock)
 		return fuse_read_batch_forget(fiq, cs, nbytes);
 }
 
+/*
+ * Copy a request that is already on fpq->io to the userspace buffer.  If
+ * there was an error during the copying then it's finished by calling
+ * fuse_request_end().  Otherwise add it to the processing list, and set
+ * the 'sent' flag.  Returns the size of the request or an error.
+ */
+ssize_t fuse_dev_send_req(struct fuse_conn *fc, struct fuse_pqueue *fpq,
+			  struct fuse_copy_state *cs, struct fuse_req *req)
+{
+	struct fuse_args *args = req->args;
+	unsigned int reqsize = req->in.h.len;
+	unsigned int hash;
+	ssize_t err;
+
+	cs->req = req;
+	err = fuse_copy_one(cs, &req->in.h, sizeof(req->in.h));
+	if (!err)
+		err = fuse_copy_args(cs, args->in_numargs, args->in_pages,
+				     (struct fuse_arg *) args->in_args, 0);
+	fuse_copy_finish(cs);
+	spin_lock(&fpq->lock);
+	clear_bit(FR_LOCKED, &req->flags);
+	if (!fpq->connected) {
+		err = fc->aborted ? -ECONNABORTED : -ENODEV;
+		goto out_end;
+	}
+	if (err) {
+		req->out.h.error = -EIO;
+		goto out_end;
+	}
+	if (!test_bit(FR_ISREPLY, &req->flags)) {
+		err = reqsize;
+		goto out_end;
+	}
+	hash = fuse_req_hash(req->in.h.unique);
+	list_move_tail(&req->list, &fpq->processing[hash]);
+	__fuse_get_request(req);
+	set_bit(FR_SENT, &req->flags);
+	spin_unlock(&fpq->lock);
+	/* matches barrier in request_wait_answer() */
+	smp_mb__after_atomic();
+	if (test_bit(FR_INTERRUPTED, &req->flags))
+		queue_interrupt(req);
+	fuse_put_request(req);
+
+	return reqsize;
+
+out_end:
+	if (!test_bit(FR_PRIVATE, &req->flags))
+		list_del_init(&req->list);
+	spin_unlock(&fpq->lock);
+	fuse_request_end(req);
+	return err;
+}
+
 /*
  * Read a single request into the userspace filesystem's buffer.  This
  * function waits until a request is available, then removes it from
@@ -1211,7 +1237,6 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	struct fuse_req *req;
 	struct fuse_args *args;
 	unsigned reqsize;
-	unsigned int hash;
 
 	/*
 	 * Require sane minimum read buffer - that has capacity for fixed part
@@ -1225,10 +1250,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	 * which is the absolute minimum any sane filesystem should be using
 	 * for header room.
 	 */
-	if (nbytes < max_t(size_t, FUSE_MIN_READ_BUFFER,
-			   sizeof(struct fuse_in_header) +
-			   sizeof(struct fuse_write_in) +
-			   fc->max_write))
+	if (nbytes < fuse_dev_min_read_buf(fc))
 		return -EINVAL;
 
  restart:
@@ -1294,38 +1316,8 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	}
 	list_add(&req->list, &fpq->io);
 	spin_unlock(&fpq->lock);
-	cs->req = req;
-	err = fuse_copy_one(cs, &req->in.h, sizeof(req->in.h));
-	if (!err)
-		err = fuse_copy_args(cs, args->in_numargs, args->in_pages,
-				     (struct fuse_arg *) args->in_args, 0);
-	fuse_copy_finish(cs);
-	spin_lock(&fpq->lock);
-	clear_bit(FR_LOCKED, &req->flags);
-	if (!fpq->connected) {
-		err = fc->aborted ? -ECONNABORTED : -ENODEV;
-		goto out_end;
-	}
-	if (err) {
-		req->out.h.error = -EIO;
-		goto out_end;
-	}
-	if (!test_bit(FR_ISREPLY, &req->flags)) {
-		err = reqsize;
-		goto out_end;
-	}
-	hash = fuse_req_hash(req->in.h.unique);
-	list_move_tail(&req->list, &fpq->processing[hash]);
-	__fuse_get_request(req);
-	set_bit(FR_SENT, &req->flags);
-	spin_unlock(&fpq->lock);
-	/* matches barrier in request_wait_answer() */
-	smp_mb__after_atomic();
-	if (test_bit(FR_INTERRUPTED, &req->flags))
-		queue_interrupt(req);
-	fuse_put_request(req);
 
-	return reqsize;
+	return fuse_dev_send_req(fc, fpq, cs, req);
 
 out_end:
 	if (!test_bit(FR_PRIVATE, &req->flags))
@@ -1865,7 +1857,7 @@ static int fuse_notify(struct fuse_conn *fc, enum fuse_notify_code code,
 }
 
 /* Look up request on processing list by unique ID */
-static struct fuse_req *request_find(struct fuse_pqueue *fpq, u64 unique)
+struct fuse_req *fuse_request_find(struct fuse_pqueue *fpq, u64 unique)
 {
 	unsigned int hash = fuse_req_hash(unique);
 	struct fuse_req *req;
@@ -1898,6 +1890,46 @@ static int copy_out_args(struct fuse_copy_state *cs, struct fuse_args *args,
 			      args->out_args, args->page_zeroing);
 }
 
+/*
+ * Copy the reply in the userspace buffer to a request found on the
+ * processing list, and finish the request.  Called with fpq->lock held.
+ */
+int fuse_dev_commit_req(struct fuse_pqueue *fpq, struct fuse_req *req,
+			struct fuse_copy_state *cs,
+			const struct fuse_out_header *oh, unsigned int nbytes)
+__releases(fpq->lock)
+{
+	int err;
+
+	clear_bit(FR_SENT, &req->flags);
+	list_move(&req->list, &fpq->io);
+	req->out.h = *oh;
+	set_bit(FR_LOCKED, &req->flags);
+	spin_unlock(&fpq->lock);
+	cs->req = req;
+	if (!req->args->page_replace)
+		cs->move_pages = 0;
+
+	if (oh->error)
+		err = nbytes != sizeof(*oh) ? -EINVAL : 0;
+	else
+		err = copy_out_args(cs, req->args, nbytes);
+	fuse_copy_finish(cs);
+
+	spin_lock(&fpq->lock);
+	clear_bit(FR_LOCKED, &req->flags);
+	if (!fpq->connected)
+		err = -ENOENT;
+	else if (err)
+		req->out.h.error = -EIO;
+	if (!test_bit(FR_PRIVATE, &req->flags))
+		list_del_init(&req->list);
+	spin_unlock(&fpq->lock);
+
+	fuse_request_end(req);
+	return err;
+}
+
 /*
  * Write a single reply to a request.  First the header is copied from
  * the write buffer.  The request is then searched on the processing
@@ -1942,7 +1974,7 @@ static ssize_t fuse_dev_do_write(struct fuse_dev *fud,
 	spin_lock(&fpq->lock);
 	req = NULL;
 	if (fpq->connected)
-		req = request_find(fpq, oh.unique & ~FUSE_INT_REQ_BIT);
+		req = fuse_request_find(fpq, oh.unique & ~FUSE_INT_REQ_BIT);
 
 	err = -ENOENT;
 	if (!req) {
@@ -1968,32 +2000,7 @@ static ssize_t fuse_dev_do_write(struct fuse_dev *fud,
 		goto copy_finish;
 	}
 
-	clear_bit(FR_SENT, &req->flags);
-	list_move(&req->list, &fpq->io);
-	req->out.h = oh;
-	set_bit(FR_LOCKED, &req->flags);
-	spin_unlock(&fpq->lock);
-	cs->req = req;
-	if (!req->args->page_replace)
-		cs->move_pages = 0;
-
-	if (oh.error)
-		err = nbytes != sizeof(oh) ? -EINVAL : 0;
-	else
-		err = copy_out_args(cs, req->args, nbytes);
-	fuse_copy_finish(cs);
-
-	spin_lock(&fpq->lock);
-	clear_bit(FR_LOCKED, &req->flags);
-	if (!fpq->connected)
-		err = -ENOENT;
-	else if (err)
-		req->out.h.error = -EIO;
-	if (!test_bit(FR_PRIVATE, &req->flags))
-		list_del_init(&req->list);
-	spin_unlock(&fpq->lock);
-
-	fuse_request_end(req);
+	err = fuse_dev_commit_req(fpq, req, cs, &oh, nbytes);
 out:
 	return err ? err : nbytes;
 
@@ -2162,6 +2169,31 @@ static void end_polls(struct fuse_conn *fc)
 	}
 }
 
+/*
+ * Disconnect a processing queue and move its requests to @to_end, except for
+ * the ones locked under I/O.  Called with fpq->lock held.
+ */
+void fuse_abort_pqueue(struct fuse_pqueue *fpq, struct list_head *to_end)
+{
+	struct fuse_req *req, *next;
+	unsigned int i;
+
+	fpq->connected = 0;
+	list_for_each_entry_safe(req, next, &fpq->io, list) {
+		req->out.h.error = -ECONNABORTED;
+		spin_lock(&req->waitq.lock);
+		set_bit(FR_ABORTED, &req->flags);
+		if (!test_bit(FR_LOCKED, &req->flags)) {
+			set_bit(FR_PRIVATE, &req->flags);
+			__fuse_get_request(req);
+			list_move(&req->list, to_end);
+		}
+		spin_unlock(&req->waitq.lock);
+	}
+	for (i = 0; i < FUSE_PQ_HASH_SIZE; i++)
+		list_splice_tail_init(&fpq->processing[i], to_end);
+}
+
 /*
  * Abort all requests.
  *
@@ -2187,9 +2219,8 @@ void fuse_abort_conn(struct fuse_conn *fc)
 	spin_lock(&fc->lock);
 	if (fc->connected) {
 		struct fuse_dev *fud;
-		struct fuse_req *req, *next;
+		struct fuse_req *req;
 		LIST_HEAD(to_end);
-		unsigned int i;
 
 		/* Background queuing checks fc->connected under bg_lock */
 		spin_lock(&fc->bg_lock);
@@ -2201,23 +2232,10 @@ void fuse_abort_conn(struct fuse_conn *fc)
 			struct fuse_pqueue *fpq = &fud->pq;
 
 			spin_lock(&fpq->lock);
-			fpq->connected = 0;
-			list_for_each_entry_safe(req, next, &fpq->io, list) {
-				req->out.h.error = -ECONNABORTED;
-				spin_lock(&req->waitq.lock);
-				set_bit(FR_ABORTED, &req->flags);
-				if (!test_bit(FR_LOCKED, &req->flags)) {
-					set_bit(FR_PRIVATE, &req->flags);
-					__fuse_get_request(req);
-					list_move(&req->list, &to_end);
-				}
-				spin_unlock(&req->waitq.lock);
-			}
-			for (i = 0; i < FUSE_PQ_HASH_SIZE; i++)
-				list_splice_tail_init(&fpq->processing[i],
-						      &to_end);
+			fuse_abort_pqueue(fpq, &to_end);
 			spin_unlock(&fpq->lock);
 		}
+		fuse_uring_abort(fc, &to_end);
 		spin_lock(&fc->bg_lock);
 		fc->blocked = 0;
 		fc->max_background = UINT_MAX;
@@ -2409,6 +2427,9 @@ const struct file_operations fuse_dev_operations = {
 	.fasync		= fuse_dev_fasync,
 	.unlocked_ioctl = fuse_dev_ioctl,
 	.compat_ioctl   = compat_ptr_ioctl,
+#ifdef CONFIG_FUSE_IO_URING
+	.uring_cmd	= fuse_uring_cmd,
+#endif
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
@@ -0,0 +1,541 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FUSE: Filesystem in Userspace
+ *
+ * Communication with the FUSE server over io-uring.
+ *
+ * The server registers buffers on /dev/fuse with FUSE_IO_URING_CMD_REGISTER,
+ * one command per buffer, on the queue of a CPU.  A request issued on that
+ * CPU is copied to the buffer of an idle entry, and its command completes.
+ * The server answers it and waits for the next request with a single
+ * FUSE_IO_URING_CMD_COMMIT_AND_FETCH command on the same entry.  The buffers
+ * hold the same data a read(2) and a write(2) of /dev/fuse would.
+ */
+
+#include "fuse_i.h"
+#include "fuse_dev_i.h"
+
+#include <linux/io_uring/cmd.h>
+#include <linux/slab.h>
+#include <linux/uio.h>
+
+struct fuse_ring_queue;
+
+struct fuse_ring_ent {
+	/* On the queue's ent_avail or ent_busy list */
+	struct list_head list;
+	struct fuse_ring_queue *queue;
+
+	/* Command waiting for a request, NULL while in userspace */
+	struct io_uring_cmd *cmd;
+	void __user *buf;
+	u32 buf_len;
+
+	/* Request being copied to the buffer or answered */
+	struct fuse_req *req;
+};
+
+struct fuse_ring_queue {
+	struct fuse_conn *fc;
+
+	/* fpq.lock protects the queue */
+	struct fuse_pqueue fpq;
+
+	/* Entries with a command and no request */
+	struct list_head ent_avail;
+	/* Entries with a request, or in userspace */
+	struct list_head ent_busy;
+	/* Requests waiting for an available entry */
+	struct list_head req_queue;
+
+	bool stopped;
+};
+
+struct fuse_ring {
+	unsigned int nr_queues;
+	/* Set once under fc->lock, read locklessly */
+	struct fuse_ring_queue *queues[];
+};
+
+struct fuse_uring_pdu {
+	struct fuse_ring_ent *ent;
+};
+
+static struct fuse_ring_ent *fuse_uring_cmd_ent(struct io_uring_cmd *cmd)
+{
+	return ((struct fuse_uring_pdu *)cmd->pdu)->ent;
+}
+
+static struct fuse_ring_queue *fuse_uring_get_queue(struct fuse_conn *fc,
+						    unsigned int qid)
+{
+	/* Both pair with smp_store_release() in fuse_uring_create_queue() */
+	struct fuse_ring *ring = smp_load_acquire(&fc->ring);
+
+	if (!ring || qid >= ring->nr_queues)
+		return NULL;
+
+	/* See above */
+	return smp_load_acquire(&ring->queues[qid]);
+}
+
+static struct fuse_ring_queue *fuse_uring_create_queue(struct fuse_conn *fc,
+						       unsigned int qid)
+{
+	struct fuse_ring_queue *queue;
+	struct fuse_ring *ring;
+
+	queue = fuse_uring_get_queue(fc, qid);
+	if (queue)
+		return queue;
+
+	ring = kzalloc(struct_size(ring, queues, nr_cpu_ids), GFP_KERNEL_ACCOUNT);
+	queue = kzalloc(sizeof(*queue), GFP_KERNEL_ACCOUNT);
+	if (!ring || !queue) {
+		kfree(ring);
+		kfree(queue);
+		return NULL;
+	}
+	ring->nr_queues = nr_cpu_ids;
+
+	queue->fpq.processing = kcalloc(FUSE_PQ_HASH_SIZE,
+					sizeof(struct list_head),
+					GFP_KERNEL_ACCOUNT);
+	if (!queue->fpq.processing) {
+		kfree(ring);
+		kfree(queue);
+		return NULL;
+	}
+	fuse_pqueue_init(&queue->fpq);
+	queue->fc = fc;
+	INIT_LIST_HEAD(&queue->ent_avail);
+	INIT_LIST_HEAD(&queue->ent_busy);
+	INIT_LIST_HEAD(&queue->req_queue);
+
+	spin_lock(&fc->lock);
+	if (!fc->ring)
+		/* Publish initialized objects to fuse_uring_get_queue() */
+		smp_store_release(&fc->ring, ring);
+	else
+		kfree(ring);
+	ring = fc->ring;
+
+	if (!ring->queues[qid]) {
+		/* Requests must not reach a queue the abort has missed */
+		if (!fc->connected)
+			queue->stopped = true;
+		/* See above */
+		smp_store_release(&ring->queues[qid], queue);
+	} else {
+		kfree(queue->fpq.processing);
+		kfree(queue);
+	}
+	queue = ring->queues[qid];
+	spin_unlock(&fc->lock);
+
+	return queue;
+}
+
+static void fuse_uring_send_in_task(struct io_uring_cmd *cmd,
+				    unsigned int issue_flags);
+
+/*
+ * Make @req the entry's request, called with fpq.lock held.  An abort may
+ * end the request while it waits on fpq.io for the copy, so it holds a
+ * reference until fuse_uring_copy_req() or fuse_uring_req_fail() is done.
+ */
+static void fuse_uring_ent_set_req(struct fuse_ring_queue *queue,
+				   struct fuse_ring_ent *ent,
+				   struct fuse_req *req)
+{
+	__fuse_get_request(req);
+	ent->req = req;
+	req->ring_entry = ent;
+	list_move(&req->list, &queue->fpq.io);
+}
+
+/* Hand a request to an available entry, called with fpq.lock held */
+static void fuse_uring_dispatch(struct fuse_ring_queue *queue,
+				struct fuse_ring_ent *ent, struct fuse_req *req)
+{
+	list_move_tail(&ent->list, &queue->ent_busy);
+	fuse_uring_ent_set_req(queue, ent, req);
+
+	io_uring_cmd_complete_in_task(ent->cmd, fuse_uring_send_in_task);
+}
+
+/*
+ * Give the entry a new command: take the next queued request, or wait for
+ * one.  The command must have been marked cancelable.
+ */
+static void fuse_uring_ent_arm(struct fuse_ring_ent *ent,
+			       struct io_uring_cmd *cmd,
+			       unsigned int issue_flags)
+{
+	struct fuse_ring_queue *queue = ent->queue;
+	struct fuse_req *req;
+
+	((struct fuse_uring_pdu *)cmd->pdu)->ent = ent;
+
+	spin_lock(&queue->fpq.lock);
+	if (queue->stopped) {
+		list_move_tail(&ent->list, &queue->ent_busy);
+		spin_unlock(&queue->fpq.lock);
+		io_uring_cmd_done(cmd, -ENOTCONN, 0, issue_flags);
+		return;
+	}
+
+	ent->cmd = cmd;
+	req = list_first_entry_or_null(&queue->req_queue, struct fuse_req,
+				       list);
+	if (req) {
+		list_del_init(&req->list);
+		fuse_uring_dispatch(queue, ent, req);
+	} else {
+		list_move_tail(&ent->list, &queue->ent_avail);
+	}
+	spin_unlock(&queue->fpq.lock);
+}
+
+/* Finish a request that could not be copied to the entry's buffer */
+static void fuse_uring_req_fail(struct fuse_ring_queue *queue,
+				struct fuse_req *req, int err)
+{
+	spin_lock(&queue->fpq.lock);
+	if (!test_bit(FR_PRIVATE, &req->flags)) {
+		list_del_init(&req->list);
+		req->out.h.error = err;
+	}
+	spin_unlock(&queue->fpq.lock);
+	fuse_request_end(req);
+	fuse_put_request(req);
+}
+
+/* Copy the entry's request to its buffer, returns the request size or an error */
+static ssize_t fuse_uring_copy_req(struct fuse_ring_ent *ent)
+{
+	struct fuse_ring_queue *queue = ent->queue;
+	struct fuse_req *req = ent->req;
+	struct fuse_copy_state cs;
+	struct iov_iter iter;
+	ssize_t ret;
+	int err;
+
+	if (ent->buf_len < req->in.h.len) {
+		/* SETXATTR is special, since it may contain too large data */
+		err = req->args->opcode == FUSE_SETXATTR ? -E2BIG : -EIO;
+		fuse_uring_req_fail(queue, req, err);
+		return err;
+	}
+
+	err = import_ubuf(ITER_DEST, ent->buf, ent->buf_len, &iter);
+	if (err) {
+		fuse_uring_req_fail(queue, req, -EIO);
+		return err;
+	}
+
+	fuse_copy_init(&cs, 1, &iter);
+	ret = fuse_dev_send_req(queue->fc, &queue->fpq, &cs, req);
+	fuse_put_request(req);
+
+	return ret;
+}
+
+static void fuse_uring_send_in_task(struct io_uring_cmd *cmd,
+				    unsigned int issue_flags)
+{
+	struct fuse_ring_ent *ent = fuse_uring_cmd_ent(cmd);
+	struct fuse_ring_queue *queue = ent->queue;
+	struct fuse_req *req;
+	ssize_t ret;
+
+	/* The buffer can only be reached from the server's task */
+	if (unlikely(current != io_uring_cmd_get_task(cmd) ||
+		     current->flags & PF_EXITING)) {
+		fuse_uring_req_fail(queue, ent->req, -EIO);
+		spin_lock(&queue->fpq.lock);
+		goto out_stop;
+	}
+
+	ret = fuse_uring_copy_req(ent);
+	spin_lock(&queue->fpq.lock);
+	/* The request was lost, go on with the next one */
+	while (ret < 0) {
+		if (queue->stopped)
+			goto out_stop;
+
+		req = list_first_entry_or_null(&queue->req_queue,
+					       struct fuse_req, list);
+		if (!req) {
+			ent->req = NULL;
+			list_move_tail(&ent->list, &queue->ent_avail);
+			spin_unlock(&queue->fpq.lock);
+			return;
+		}
+
+		fuse_uring_ent_set_req(queue, ent, req);
+		spin_unlock(&queue->fpq.lock);
+		ret = fuse_uring_copy_req(ent);
+		spin_lock(&queue->fpq.lock);
+	}
+	ent->cmd = NULL;
+	spin_unlock(&queue->fpq.lock);
+
+	io_uring_cmd_done(cmd, ret, 0, issue_flags);
+	return;
+
+out_stop:
+	ent->req = NULL;
+	ent->cmd = NULL;
+	spin_unlock(&queue->fpq.lock);
+	io_uring_cmd_done(cmd, -ENOTCONN, 0, issue_flags);
+}
+
+static void fuse_uring_stopped_in_task(struct io_uring_cmd *cmd,
+				       unsigned int issue_flags)
+{
+	io_uring_cmd_done(cmd, -ENOTCONN, 0, issue_flags);
+}
+
+/*
+ * Queue a request on the current CPU's queue, if the server registered one.
+ * Called with fiq->lock held.
+ */
+bool fuse_uring_queue_req(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_ring_queue *queue;
+	struct fuse_ring_ent *ent;
+
+	if (!test_bit(FR_ISREPLY, &req->flags))
+		return false;
+
+	queue = fuse_uring_get_queue(fc, raw_smp_processor_id());
+	if (!queue)
+		return false;
+
+	spin_lock(&queue->fpq.lock);
+	if (queue->stopped) {
+		spin_unlock(&queue->fpq.lock);
+		return false;
+	}
+
+	clear_bit(FR_PENDING, &req->flags);
+	ent = list_first_entry_or_null(&queue->ent_avail, struct fuse_ring_ent,
+				       list);
+	if (ent)
+		fuse_uring_dispatch(queue, ent, req);
+	else
+		list_add_tail(&req->list, &queue->req_queue);
+	spin_unlock(&queue->fpq.lock);
+
+	return true;
+}
+
+/*
+ * Stop all queues and move their requests to @to_end.  Waiting commands
+ * complete with -ENOTCONN.  Called with fc->lock held.
+ */
+void fuse_uring_abort(struct fuse_conn *fc, struct list_head *to_end)
+{
+	struct fuse_ring *ring = fc->ring;
+	struct fuse_ring_queue *queue;
+	struct fuse_ring_ent *ent, *next;
+	unsigned int qid;
+
+	if (!ring)
+		return;
+
+	for (qid = 0; qid < ring->nr_queues; qid++) {
+		queue = ring->queues[qid];
+		if (!queue)
+			continue;
+
+		spin_lock(&queue->fpq.lock);
+		queue->stopped = true;
+		fuse_abort_pqueue(&queue->fpq, to_end);
+		list_splice_tail_init(&queue->req_queue, to_end);
+		list_for_each_entry_safe(ent, next, &queue->ent_avail, list) {
+			list_move_tail(&ent->list, &queue->ent_busy);
+			io_uring_cmd_complete_in_task(ent->cmd,
+						      fuse_uring_stopped_in_task);
+			ent->cmd = NULL;
+		}
+		spin_unlock(&queue->fpq.lock);
+	}
+}
+
+/* Called on connection teardown, when no command can be outstanding */
+void fuse_uring_destruct(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = fc->ring;
+	struct fuse_ring_queue *queue;
+	struct fuse_ring_ent *ent, *next;
+	unsigned int qid;
+
+	if (!ring)
+		return;
+
+	for (qid = 0; qid < ring->nr_queues; qid++) {
+		queue = ring->queues[qid];
+		if (!queue)
+			continue;
+
+		WARN_ON(!list_empty(&queue->ent_avail));
+		WARN_ON(!list_empty(&queue->req_queue));
+		list_for_each_entry_safe(ent, next, &queue->ent_busy, list)
+			kfree(ent);
+		kfree(queue->fpq.processing);
+		kfree(queue);
+	}
+	kfree(ring);
+	fc->ring = NULL;
+}
+
+static void fuse_uring_cancel(struct io_uring_cmd *cmd,
+			      unsigned int issue_flags)
+{
+	struct fuse_ring_ent *ent = fuse_uring_cmd_ent(cmd);
+	struct fuse_ring_queue *queue = ent->queue;
+	bool idle;
+
+	spin_lock(&queue->fpq.lock);
+	/* A dispatched command is completed by fuse_uring_send_in_task() */
+	idle = ent->cmd == cmd && !ent->req;
+	if (idle) {
+		list_move_tail(&ent->list, &queue->ent_busy);
+		ent->cmd = NULL;
+	}
+	spin_unlock(&queue->fpq.lock);
+
+	if (idle)
+		io_uring_cmd_done(cmd, -ENOTCONN, 0, issue_flags);
+}
+
+static int fuse_uring_register(struct io_uring_cmd *cmd, struct fuse_conn *fc,
+			       void __user *buf, u32 buf_len, unsigned int qid,
+			       unsigned int issue_flags)
+{
+	struct fuse_ring_queue *queue;
+	struct fuse_ring_ent *ent;
+
+	queue = fuse_uring_create_queue(fc, qid);
+	if (!queue)
+		return -ENOMEM;
+
+	ent = kzalloc(sizeof(*ent), GFP_KERNEL_ACCOUNT);
+	if (!ent)
+		return -ENOMEM;
+
+	INIT_LIST_HEAD(&ent->list);
+	ent->queue = queue;
+	ent->buf = buf;
+	ent->buf_len = buf_len;
+
+	io_uring_cmd_mark_cancelable(cmd, issue_flags);
+	fuse_uring_ent_arm(ent, cmd, issue_flags);
+
+	return -EIOCBQUEUED;
+}
+
+static int fuse_uring_commit_fetch(struct io_uring_cmd *cmd,
+				   struct fuse_conn *fc, void __user *buf,
+				   u32 buf_len, unsigned int qid,
+				   unsigned int issue_flags)
+{
+	struct fuse_ring_queue *queue;
+	struct fuse_copy_state cs;
+	struct fuse_out_header oh;
+	struct fuse_ring_ent *ent;
+	struct fuse_req *req;
+	struct iov_iter iter;
+	int err;
+
+	queue = fuse_uring_get_queue(fc, qid);
+	if (!queue)
+		return -EINVAL;
+
+	err = import_ubuf(ITER_SOURCE, buf, buf_len, &iter);
+	if (err)
+		return err;
+
+	fuse_copy_init(&cs, 0, &iter);
+	err = fuse_copy_one(&cs, &oh, sizeof(oh));
+	if (err)
+		goto copy_finish;
+
+	/* Notifications and interrupt replies go to /dev/fuse */
+	err = -EINVAL;
+	if (oh.len < sizeof(oh) || oh.len > buf_len || !oh.unique ||
+	    (oh.unique & FUSE_INT_REQ_BIT) ||
+	    oh.error <= -512 || oh.error > 0)
+		goto copy_finish;
+
+	spin_lock(&queue->fpq.lock);
+	req = NULL;
+	if (queue->fpq.connected)
+		req = fuse_request_find(&queue->fpq, oh.unique);
+	if (!req) {
+		err = queue->fpq.connected ? -ENOENT : -ENOTCONN;
+		spin_unlock(&queue->fpq.lock);
+		goto copy_finish;
+	}
+
+	ent = req->ring_entry;
+	ent->req = NULL;
+	/* Errors in the reply are the request's, the entry goes on */
+	fuse_dev_commit_req(&queue->fpq, req, &cs, &oh, oh.len);
+
+	ent->buf = buf;
+	ent->buf_len = buf_len;
+	io_uring_cmd_mark_cancelable(cmd, issue_flags);
+	fuse_uring_ent_arm(ent, cmd, issue_flags);
+
+	return -EIOCBQUEUED;
+
+copy_finish:
+	fuse_copy_finish(&cs);
+	return err;
+}
+
+int fuse_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags)
+{
+	const struct fuse_uring_cmd_req *cmd_req = io_uring_sqe_cmd(cmd->sqe);
+	struct fuse_dev *fud = fuse_get_dev(cmd->file);
+	struct fuse_conn *fc;
+	void __user *buf;
+	u32 buf_len;
+	u16 qid;
+
+	if (!fud)
+		return -EPERM;
+	fc = fud->fc;
+
+	if (issue_flags & IO_URING_F_CANCEL) {
+		fuse_uring_cancel(cmd, issue_flags);
+		return 0;
+	}
+
+	if (READ_ONCE(cmd_req->flags))
+		return -EINVAL;
+	buf = u64_to_user_ptr(READ_ONCE(cmd_req->buf));
+	buf_len = READ_ONCE(cmd_req->buf_len);
+	qid = READ_ONCE(cmd_req->qid);
+
+	if (!fc->io_uring)
+		return -EOPNOTSUPP;
+	if (!fc->connected)
+		return -ENOTCONN;
+	if (qid >= nr_cpu_ids || buf_len < fuse_dev_min_read_buf(fc))
+		return -EINVAL;
+
+	switch (cmd->cmd_op) {
+	case FUSE_IO_URING_CMD_REGISTER:
+		return fuse_uring_register(cmd, fc, buf, buf_len, qid,
+					   issue_flags);
+	case FUSE_IO_URING_CMD_COMMIT_AND_FETCH:
+		return fuse_uring_commit_fetch(cmd, fc, buf, buf_len, qid,
+					       issue_flags);
+	default:
+		return -EINVAL;
+	}
+}
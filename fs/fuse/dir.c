@@ -1659,6 +1659,12 @@ static int fuse_dir_open(struct inode *inode, struct file *file)
 		 */
 		if (ff->open_flags & (FOPEN_STREAM | FOPEN_NONSEEKABLE))
 			nonseekable_open(inode, file);
+
+		if (ff->args && (ff->open_flags & FOPEN_PASSTHROUGH)) {
+			err = fuse_dir_passthrough_open(inode, file);
+			if (err)
+				fuse_release_common(file, true);
+		}
 	}
 
 	return err;
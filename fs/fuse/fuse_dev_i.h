@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: GPL-2.0
+ *
+ * FUSE: Filesystem in Userspace
+ * Copyright (C) 2001-2008  Miklos Szeredi <miklos@szeredi.hu>
+ */
+#ifndef _FS_FUSE_DEV_I_H
+#define _FS_FUSE_DEV_I_H
+
+#include <linux/types.h>
+
+/* Ordinary requests have even IDs, while interrupts IDs are odd */
+#define FUSE_INT_REQ_BIT (1ULL << 0)
+#define FUSE_REQ_ID_STEP (1ULL << 1)
+
+struct fuse_copy_state {
+	int write;
+	struct fuse_req *req;
+	struct iov_iter *iter;
+	struct pipe_buffer *pipebufs;
+	struct pipe_buffer *currbuf;
+	struct pipe_inode_info *pipe;
+	unsigned long nr_segs;
+	struct page *pg;
+	unsigned len;
+	unsigned offset;
+	unsigned move_pages:1;
+};
+
+static inline struct fuse_dev *fuse_get_dev(struct file *file)
+{
+	/*
+	 * Lockless access is OK, because file->private data is set
+	 * once during mount and is valid until the file is released.
+	 */
+	return READ_ONCE(file->private_data);
+}
+
+/*
+ * Require sane minimum read buffer - that has capacity for fixed part
+ * of any request header + negotiated max_write room for data.
+ */
+static inline size_t fuse_dev_min_read_buf(struct fuse_conn *fc)
+{
+	return max_t(size_t, FUSE_MIN_READ_BUFFER,
+		     sizeof(struct fuse_in_header) +
+		     sizeof(struct fuse_write_in) + fc->max_write);
+}
+
+static inline void __fuse_get_request(struct fuse_req *req)
+{
+	refcount_inc(&req->count);
+}
+
+void fuse_put_request(struct fuse_req *req);
+
+void fuse_copy_init(struct fuse_copy_state *cs, int write,
+		    struct iov_iter *iter);
+void fuse_copy_finish(struct fuse_copy_state *cs);
+int fuse_copy_one(struct fuse_copy_state *cs, void *val, unsigned size);
+
+struct fuse_req *fuse_request_find(struct fuse_pqueue *fpq, u64 unique);
+ssize_t fuse_dev_send_req(struct fuse_conn *fc, struct fuse_pqueue *fpq,
+			  struct fuse_copy_state *cs, struct fuse_req *req);
+int fuse_dev_commit_req(struct fuse_pqueue *fpq, struct fuse_req *req,
+			struct fuse_copy_state *cs,
+			const struct fuse_out_header *oh, unsigned int nbytes);
+void fuse_abort_pqueue(struct fuse_pqueue *fpq, struct list_head *to_end);
+
+#endif
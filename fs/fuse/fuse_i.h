@@ -433,6 +433,11 @@ struct fuse_req {
 	void *argbuf;
 #endif
 
+#ifdef CONFIG_FUSE_IO_URING
+	/** io-uring entry this request is sent on */
+	struct fuse_ring_ent *ring_entry;
+#endif
+
 	/** fuse_mount this request belongs to */
 	struct fuse_mount *fm;
 };
@@ -860,6 +865,9 @@ struct fuse_conn {
 	/** Passthrough support for read/write IO */
 	unsigned int passthrough:1;
 
+	/** Requests may be sent over io-uring */
+	unsigned int io_uring:1;
+
 	/** Maximum stack depth for passthrough backing files */
 	int max_stack_depth;
 
@@ -917,6 +925,11 @@ struct fuse_conn {
 	/** IDR for backing files ids */
 	struct idr backing_files_map;
 #endif
+
+#ifdef CONFIG_FUSE_IO_URING
+	/** io-uring queues, allocated on the first registration */
+	struct fuse_ring *ring;
+#endif
 };
 
 /*
@@ -1211,6 +1224,7 @@ struct fuse_dev *fuse_dev_alloc_install(struct fuse_conn *fc);
 struct fuse_dev *fuse_dev_alloc(void);
 void fuse_dev_install(struct fuse_dev *fud, struct fuse_conn *fc);
 void fuse_dev_free(struct fuse_dev *fud);
+void fuse_pqueue_init(struct fuse_pqueue *fpq);
 void fuse_send_init(struct fuse_mount *fm);
 
 /**
@@ -1470,5 +1484,30 @@ ssize_t fuse_passthrough_splice_write(struct pipe_inode_info *pipe,
 				      struct file *out, loff_t *ppos,
 				      size_t len, unsigned int flags);
 ssize_t fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+int fuse_passthrough_readdir(struct file *file, struct dir_context *ctx);
+int fuse_dir_passthrough_open(struct inode *inode, struct file *file);
+
+/* dev_uring.c */
+#ifdef CONFIG_FUSE_IO_URING
+int fuse_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags);
+bool fuse_uring_queue_req(struct fuse_conn *fc, struct fuse_req *req);
+void fuse_uring_abort(struct fuse_conn *fc, struct list_head *to_end);
+void fuse_uring_destruct(struct fuse_conn *fc);
+#else
+static inline bool fuse_uring_queue_req(struct fuse_conn *fc,
+					struct fuse_req *req)
+{
+	return false;
+}
+
+static inline void fuse_uring_abort(struct fuse_conn *fc,
+				    struct list_head *to_end)
+{
+}
+
+static inline void fuse_uring_destruct(struct fuse_conn *fc)
+{
+}
+#endif
 
 #endif /* _FS_FUSE_I_H */
@@ -173,6 +173,31 @@ static int fuse_file_passthrough_open(struct inode *inode, struct file *file)
 	return err;
 }
 
+/*
+ * A directory opened with FOPEN_PASSTHROUGH is read from its backing
+ * directory.  There is no page cache to keep coherent, so the inode io mode
+ * is left alone and the backing is only referenced by the open file.
+ */
+int fuse_dir_passthrough_open(struct inode *inode, struct file *file)
+{
+	struct fuse_file *ff = file->private_data;
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_backing *fb;
+
+	if (!IS_ENABLED(CONFIG_FUSE_PASSTHROUGH) || !fc->passthrough ||
+	    (ff->open_flags & FOPEN_CACHE_DIR))
+		return -EIO;
+
+	fb = fuse_passthrough_open(file, inode,
+				   ff->args->open_outarg.backing_id);
+	if (IS_ERR(fb))
+		return -EIO;
+
+	fuse_backing_put(fb);
+
+	return 0;
+}
+
 /* Request access to submit new io to inode via open file */
 int fuse_file_io_open(struct file *file, struct inode *inode)
 {
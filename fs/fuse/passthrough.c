@@ -124,6 +124,29 @@ ssize_t fuse_passthrough_splice_write(struct pipe_inode_info *pipe,
 	return ret;
 }
 
+int fuse_passthrough_readdir(struct file *file, struct dir_context *ctx)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_file = fuse_file_passthrough(ff);
+	const struct cred *old_cred;
+	loff_t pos;
+	int ret;
+
+	pr_debug("%s: backing_file=0x%p, pos=%lld\n", __func__,
+		 backing_file, ctx->pos);
+
+	old_cred = override_creds(ff->cred);
+	/* Follow seeks on the fuse directory */
+	pos = backing_file->f_pos;
+	if (pos != ctx->pos)
+		pos = vfs_llseek(backing_file, ctx->pos, SEEK_SET);
+	ret = pos < 0 ? pos : iterate_dir(backing_file, ctx);
+	revert_creds(old_cred);
+	fuse_invalidate_atime(file_inode(file));
+
+	return ret;
+}
+
 ssize_t fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
 {
 	struct fuse_file *ff = file->private_data;
@@ -234,7 +257,8 @@ int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map)
 		goto out;
 
 	res = -EOPNOTSUPP;
-	if (!file->f_op->read_iter || !file->f_op->write_iter)
+	if (d_is_dir(file->f_path.dentry) ? !file->f_op->iterate_shared :
+	    (!file->f_op->read_iter || !file->f_op->write_iter))
 		goto out_fput;
 
 	backing_sb = file_inode(file)->i_sb;
@@ -324,6 +348,13 @@ struct fuse_backing *fuse_passthrough_open(struct file *file,
 	if (!fb)
 		goto out;
 
+	/* Directories pass through to directories, files to files */
+	err = -EINVAL;
+	if (d_is_dir(fb->file->f_path.dentry) != S_ISDIR(inode->i_mode)) {
+		fuse_backing_put(fb);
+		goto out;
+	}
+
 	/* Allocate backing file per fuse file to store fuse path */
 	backing_file = backing_file_open(&file->f_path, file->f_flags,
 					 &fb->file->f_path, fb->cred);
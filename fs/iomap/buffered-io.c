@@ -99,22 +99,23 @@ static unsigned ifs_find_dirty_range(struct folio *folio,
 		struct iomap_folio_state *ifs, u64 *range_start, u64 range_end)
 {
 	struct inode *inode = folio->mapping->host;
+	unsigned int blks_per_folio = i_blocks_per_folio(inode, folio);
 	unsigned start_blk =
 		offset_in_folio(folio, *range_start) >> inode->i_blkbits;
 	unsigned end_blk = min_not_zero(
 		offset_in_folio(folio, range_end) >> inode->i_blkbits,
-		i_blocks_per_folio(inode, folio));
-	unsigned nblks = 1;
+		blks_per_folio);
+	unsigned nblks;
 
-	while (!ifs_block_is_dirty(folio, ifs, start_blk))
-		if (++start_blk == end_blk)
-			return 0;
+	/* The dirty bits follow the uptodate bits in ifs->state */
+	start_blk = find_next_bit(ifs->state, blks_per_folio + end_blk,
+				  blks_per_folio + start_blk) - blks_per_folio;
+	if (start_blk >= end_blk)
+		return 0;
 
-	while (start_blk + nblks < end_blk) {
-		if (!ifs_block_is_dirty(folio, ifs, start_blk + nblks))
-			break;
-		nblks++;
-	}
+	nblks = find_next_zero_bit(ifs->state, blks_per_folio + end_blk,
+				   blks_per_folio + start_blk + 1) -
+		blks_per_folio - start_blk;
 
 	*range_start = folio_pos(folio) + (start_blk << inode->i_blkbits);
 	return nblks << inode->i_blkbits;
@@ -250,24 +251,22 @@ static void iomap_adjust_read_range(struct inode *inode, struct folio *folio,
 	 * to avoid reading in already uptodate ranges.
 	 */
 	if (ifs) {
-		unsigned int i;
-
-		/* move forward for each leading block marked uptodate */
-		for (i = first; i <= last; i++) {
-			if (!ifs_block_is_uptodate(ifs, i))
-				break;
-			*pos += block_size;
-			poff += block_size;
-			plen -= block_size;
-			first++;
-		}
+		unsigned int i, skip;
+
+		/* move forward over the leading blocks marked uptodate */
+		i = find_next_zero_bit(ifs->state, last + 1, first);
+		skip = (i - first) << block_bits;
+		*pos += skip;
+		poff += skip;
+		plen -= skip;
+		first = i;
 
 		/* truncate len if we find any trailing uptodate block(s) */
-		for ( ; i <= last; i++) {
-			if (ifs_block_is_uptodate(ifs, i)) {
+		if (i <= last) {
+			i = find_next_bit(ifs->state, last + 1, i + 1);
+			if (i <= last) {
 				plen -= (last - i + 1) * block_size;
 				last = i - 1;
-				break;
 			}
 		}
 	}
@@ -556,7 +555,7 @@ bool iomap_is_partially_uptodate(struct folio *folio, size_t from, size_t count)
 {
 	struct iomap_folio_state *ifs = folio->private;
 	struct inode *inode = folio->mapping->host;
-	unsigned first, last, i;
+	unsigned first, last;
 
 	if (!ifs)
 		return false;
@@ -568,10 +567,7 @@ bool iomap_is_partially_uptodate(struct folio *folio, size_t from, size_t count)
 	first = from >> inode->i_blkbits;
 	last = (from + count - 1) >> inode->i_blkbits;
 
-	for (i = first; i <= last; i++)
-		if (!ifs_block_is_uptodate(ifs, i))
-			return false;
-	return true;
+	return find_next_zero_bit(ifs->state, last + 1, first) > last;
 }
 EXPORT_SYMBOL_GPL(iomap_is_partially_uptodate);
 
@@ -5,6 +5,7 @@
  * Written by David Howells (dhowells@redhat.com)
  */
 
+#include <linux/ktime.h>
 #include <linux/slab.h>
 #include <linux/seq_file.h>
 #include <linux/netfs.h>
@@ -130,6 +131,9 @@ extern atomic_t netfs_n_wh_upload_failed;
 extern atomic_t netfs_n_wh_write;
 extern atomic_t netfs_n_wh_write_done;
 extern atomic_t netfs_n_wh_write_failed;
+extern atomic64_t netfs_n_rh_download_ns;
+extern atomic64_t netfs_n_rh_read_ns;
+extern atomic64_t netfs_n_rh_write_ns;
 
 int netfs_stats_show(struct seq_file *m, void *v);
 
@@ -143,9 +147,27 @@ static inline void netfs_stat_d(atomic_t *stat)
 	atomic_dec(stat);
 }
 
+/*
+ * Account the time a subrequest spent on the cache or the server, from
+ * netfs_stat_issue() to its termination.
+ */
+static inline void netfs_stat_issue(struct netfs_io_subrequest *subreq)
+{
+	subreq->issue_time = ktime_get();
+}
+
+static inline void netfs_stat_time(atomic64_t *stat,
+				   struct netfs_io_subrequest *subreq)
+{
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), subreq->issue_time)),
+		     stat);
+}
+
 #else
 #define netfs_stat(x) do {} while(0)
 #define netfs_stat_d(x) do {} while(0)
+#define netfs_stat_issue(x) do {} while (0)
+#define netfs_stat_time(x, s) do {} while (0)
 #endif
 
 /*
@@ -43,6 +43,7 @@ static void netfs_read_from_cache(struct netfs_io_request *rreq,
 	struct netfs_cache_resources *cres = &rreq->cache_resources;
 
 	netfs_stat(&netfs_n_rh_read);
+	netfs_stat_issue(subreq);
 	cres->ops->read(cres, subreq->start, &subreq->io_iter, read_hole,
 			netfs_cache_read_terminated, subreq);
 }
@@ -85,6 +86,7 @@ static void netfs_read_from_server(struct netfs_io_request *rreq,
 			rreq->debug_id, subreq->debug_index,
 			iov_iter_count(&subreq->io_iter), subreq->len,
 			subreq->transferred, subreq->flags);
+	netfs_stat_issue(subreq);
 	rreq->netfs_ops->issue_read(subreq);
 }
 
@@ -149,6 +151,7 @@ static void netfs_rreq_copy_terminated(void *priv, ssize_t transferred_or_error,
 				    netfs_fail_copy_to_cache);
 	} else {
 		netfs_stat(&netfs_n_rh_write_done);
+		netfs_stat_time(&netfs_n_rh_write_ns, subreq);
 	}
 
 	trace_netfs_sreq(subreq, netfs_sreq_trace_write_term);
@@ -213,6 +216,7 @@ static void netfs_rreq_do_write_to_cache(struct netfs_io_request *rreq)
 		netfs_stat(&netfs_n_rh_write);
 		netfs_get_subrequest(subreq, netfs_sreq_trace_get_copy_to_cache);
 		trace_netfs_sreq(subreq, netfs_sreq_trace_write);
+		netfs_stat_issue(subreq);
 		cres->ops->write(cres, subreq->start, &iter,
 				 netfs_rreq_copy_terminated, subreq);
 	}
@@ -470,9 +474,11 @@ void netfs_subreq_terminated(struct netfs_io_subrequest *subreq,
 	switch (subreq->source) {
 	case NETFS_READ_FROM_CACHE:
 		netfs_stat(&netfs_n_rh_read_done);
+		netfs_stat_time(&netfs_n_rh_read_ns, subreq);
 		break;
 	case NETFS_DOWNLOAD_FROM_SERVER:
 		netfs_stat(&netfs_n_rh_download_done);
+		netfs_stat_time(&netfs_n_rh_download_ns, subreq);
 		break;
 	default:
 		break;
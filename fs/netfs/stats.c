@@ -6,6 +6,7 @@
  */
 
 #include <linux/export.h>
+#include <linux/math64.h>
 #include <linux/seq_file.h>
 #include "internal.h"
 
@@ -36,6 +37,17 @@ atomic_t netfs_n_wh_upload_failed;
 atomic_t netfs_n_wh_write;
 atomic_t netfs_n_wh_write_done;
 atomic_t netfs_n_wh_write_failed;
+atomic64_t netfs_n_rh_download_ns;
+atomic64_t netfs_n_rh_read_ns;
+atomic64_t netfs_n_rh_write_ns;
+
+/* Mean time per completed subrequest, in microseconds */
+static u64 netfs_stat_mean_us(atomic64_t *ns, atomic_t *count)
+{
+	unsigned int n = atomic_read(count);
+
+	return n ? div64_u64(atomic64_read(ns), n) / NSEC_PER_USEC : 0;
+}
 
 int netfs_stats_show(struct seq_file *m, void *v)
 {
@@ -71,6 +83,13 @@ int netfs_stats_show(struct seq_file *m, void *v)
 		   atomic_read(&netfs_n_rh_rreq),
 		   atomic_read(&netfs_n_rh_sreq),
 		   atomic_read(&netfs_n_wh_wstream_conflict));
+	seq_printf(m, "Netfs  : DLt=%lluus RDt=%lluus WRt=%lluus\n",
+		   netfs_stat_mean_us(&netfs_n_rh_download_ns,
+				      &netfs_n_rh_download_done),
+		   netfs_stat_mean_us(&netfs_n_rh_read_ns,
+				      &netfs_n_rh_read_done),
+		   netfs_stat_mean_us(&netfs_n_rh_write_ns,
+				      &netfs_n_rh_write_done));
 	return fscache_stats_show(m);
 }
 EXPORT_SYMBOL(netfs_stats_show);
@@ -246,8 +246,15 @@ static void ovl_cache_put(struct ovl_dir_file *od, struct inode *inode)
 	WARN_ON(cache->refcount <= 0);
 	cache->refcount--;
 	if (!cache->refcount) {
-		if (ovl_dir_cache(inode) == cache)
+		/*
+		 * Keep an up to date cache on the inode for the next open, it
+		 * is freed with the inode or once stale.
+		 */
+		if (ovl_dir_cache(inode) == cache) {
+			if (ovl_inode_version_get(inode) == cache->version)
+				return;
 			ovl_set_dir_cache(inode, NULL);
+		}
 
 		ovl_cache_free(&cache->entries);
 		kfree(cache);
@@ -405,10 +412,12 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 
 	cache = ovl_dir_cache(inode);
 	if (cache && ovl_inode_version_get(inode) == cache->version) {
-		WARN_ON(!cache->refcount);
 		cache->refcount++;
 		return cache;
 	}
+	/* A stale cache that no open file holds any more is ours to free */
+	if (cache && !cache->refcount)
+		ovl_dir_cache_free(inode);
 	ovl_set_dir_cache(d_inode(dentry), NULL);
 
 	cache = kzalloc(sizeof(struct ovl_dir_cache), GFP_KERNEL);
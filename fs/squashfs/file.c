@@ -34,6 +34,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -533,6 +534,100 @@ static int squashfs_readahead_fragment(struct page **page,
 	return error;
 }
 
+/*
+ * Read and decompress one datablock into @pages, and unlock and release
+ * them.  @last is set for the last block of the file, whose last page may
+ * have to be zero-filled past the end of the file.
+ */
+static void squashfs_readahead_block(struct super_block *sb,
+	struct page **pages, unsigned int nr_pages, int expected, u64 block,
+	int bsize, bool last)
+{
+	struct squashfs_page_actor *actor;
+	struct page *last_page;
+	int i, res;
+
+	actor = squashfs_page_actor_init_special(sb->s_fs_info, pages,
+						 nr_pages, expected);
+	if (!actor)
+		goto out;
+
+	res = squashfs_read_data(sb, block, bsize, NULL, actor);
+
+	last_page = squashfs_page_actor_free(actor);
+
+	if (res == expected) {
+		int bytes;
+
+		/* Last page (if present) may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (last && bytes && last_page)
+			memzero_page(last_page, bytes, PAGE_SIZE - bytes);
+
+		for (i = 0; i < nr_pages; i++) {
+			flush_dcache_page(pages[i]);
+			SetPageUptodate(pages[i]);
+		}
+	}
+
+out:
+	for (i = 0; i < nr_pages; i++) {
+		unlock_page(pages[i]);
+		put_page(pages[i]);
+	}
+}
+
+/*
+ * With more than one decompressor, the datablocks of a readahead are read
+ * and decompressed by workers, so that their I/O and decompression overlap
+ * instead of being done one block after the other.  The pages stay locked
+ * until the worker is done with them, and squashfs_put_super() waits for
+ * any worker still running before it frees the caches.
+ */
+struct squashfs_readahead_work {
+	struct work_struct	work;
+	struct super_block	*sb;
+	u64			block;
+	int			bsize;
+	int			expected;
+	bool			last;
+	unsigned int		nr_pages;
+	struct page		*pages[];
+};
+
+static void squashfs_readahead_workfn(struct work_struct *work)
+{
+	struct squashfs_readahead_work *rw =
+		container_of(work, struct squashfs_readahead_work, work);
+
+	squashfs_readahead_block(rw->sb, rw->pages, rw->nr_pages, rw->expected,
+				 rw->block, rw->bsize, rw->last);
+	kfree(rw);
+}
+
+static bool squashfs_readahead_queue(struct super_block *sb,
+	struct page **pages, unsigned int nr_pages, int expected, u64 block,
+	int bsize, bool last)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	struct squashfs_readahead_work *rw;
+
+	rw = kmalloc(struct_size(rw, pages, nr_pages), GFP_NOFS | __GFP_NOWARN);
+	if (!rw)
+		return false;
+
+	INIT_WORK(&rw->work, squashfs_readahead_workfn);
+	rw->sb = sb;
+	rw->block = block;
+	rw->bsize = bsize;
+	rw->expected = expected;
+	rw->last = last;
+	rw->nr_pages = nr_pages;
+	memcpy(rw->pages, pages, nr_pages * sizeof(*pages));
+	queue_work(msblk->readahead_wq, &rw->work);
+	return true;
+}
+
 static void squashfs_readahead(struct readahead_control *ractl)
 {
 	struct inode *inode = ractl->mapping->host;
@@ -541,7 +636,6 @@ static void squashfs_readahead(struct readahead_control *ractl)
 	unsigned short shift = msblk->block_log - PAGE_SHIFT;
 	loff_t start = readahead_pos(ractl) & ~mask;
 	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
-	struct squashfs_page_actor *actor;
 	unsigned int nr_pages = 0;
 	struct page **pages;
 	int i;
@@ -559,7 +653,6 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		int res, bsize;
 		u64 block = 0;
 		unsigned int expected;
-		struct page *last_page;
 
 		expected = start >> msblk->block_log == file_end ?
 			   (i_size_read(inode) & (msblk->block_size - 1)) :
@@ -592,34 +685,14 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		if (bsize == 0)
 			goto skip_pages;
 
-		actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
-							 expected);
-		if (!actor)
-			goto skip_pages;
-
-		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
-
-		last_page = squashfs_page_actor_free(actor);
-
-		if (res == expected) {
-			int bytes;
-
-			/* Last page (if present) may have trailing bytes not filled */
-			bytes = res % PAGE_SIZE;
-			if (index == file_end && bytes && last_page)
-				memzero_page(last_page, bytes,
-					     PAGE_SIZE - bytes);
-
-			for (i = 0; i < nr_pages; i++) {
-				flush_dcache_page(pages[i]);
-				SetPageUptodate(pages[i]);
-			}
-		}
+		if (msblk->readahead_wq &&
+		    squashfs_readahead_queue(inode->i_sb, pages, nr_pages,
+					     expected, block, bsize,
+					     index == file_end))
+			continue;
 
-		for (i = 0; i < nr_pages; i++) {
-			unlock_page(pages[i]);
-			put_page(pages[i]);
-		}
+		squashfs_readahead_block(inode->i_sb, pages, nr_pages, expected,
+					 block, bsize, index == file_end);
 	}
 
 	kfree(pages);
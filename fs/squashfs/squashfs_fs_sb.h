@@ -69,5 +69,6 @@ struct squashfs_sb_info {
 	bool					panic_on_errors;
 	const struct squashfs_decompressor_thread_ops *thread_ops;
 	int					max_thread_num;
+	struct workqueue_struct			*readahead_wq;
 };
 #endif
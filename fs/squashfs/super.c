@@ -29,6 +29,7 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -349,6 +350,14 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto insanity;
 	}
 
+	/*
+	 * Readahead only hands datablocks to workers if it can decompress more
+	 * than one at a time.  Without the workqueue it reads them inline.
+	 */
+	if (msblk->max_thread_num > 1)
+		msblk->readahead_wq = alloc_workqueue("squashfs_ra", WQ_UNBOUND,
+						      msblk->max_thread_num);
+
 	/* Handle xattrs */
 	sb->s_xattr = squashfs_xattr_handlers;
 	xattr_id_table_start = le64_to_cpu(sblk->xattr_id_table_start);
@@ -464,6 +473,8 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 insanity:
 	errorf(fc, "squashfs image failed sanity check");
 failed_mount:
+	if (msblk->readahead_wq)
+		destroy_workqueue(msblk->readahead_wq);
 	squashfs_cache_delete(msblk->block_cache);
 	squashfs_cache_delete(msblk->fragment_cache);
 	squashfs_cache_delete(msblk->read_page);
@@ -584,6 +595,10 @@ static void squashfs_put_super(struct super_block *sb)
 {
 	if (sb->s_fs_info) {
 		struct squashfs_sb_info *sbi = sb->s_fs_info;
+
+		/* Let readahead workers finish before tearing down the caches */
+		if (sbi->readahead_wq)
+			destroy_workqueue(sbi->readahead_wq);
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
@@ -18,12 +18,23 @@
  */
 #define FS_VERITY_MAX_LEVELS		8
 
+/*
+ * Maximum number of data blocks whose hashes are computed together, when the
+ * hash implementation supports multibuffer hashing.
+ */
+#define FS_VERITY_MAX_PENDING_DATA_BLOCKS	2
+
 /* A hash algorithm supported by fs-verity */
 struct fsverity_hash_alg {
 	struct crypto_shash *tfm; /* hash tfm, allocated on demand */
 	const char *name;	  /* crypto API name, e.g. sha256 */
 	unsigned int digest_size; /* digest size in bytes, e.g. 32 for SHA-256 */
 	unsigned int block_size;  /* block size in bytes, e.g. 64 for SHA-256 */
+	/*
+	 * The number of data blocks to hash at once, i.e. the tfm's multibuffer
+	 * interleaving factor, capped to FS_VERITY_MAX_PENDING_DATA_BLOCKS
+	 */
+	unsigned int mb_max_msgs;
 	/*
 	 * The HASH_ALGO_* constant for this algorithm.  This is different from
 	 * FS_VERITY_HASH_ALG_*, which uses a different numbering scheme.
@@ -84,6 +95,9 @@ const u8 *fsverity_prepare_hash_state(const struct fsverity_hash_alg *alg,
 				      const u8 *salt, size_t salt_size);
 int fsverity_hash_block(const struct merkle_tree_params *params,
 			const struct inode *inode, const void *data, u8 *out);
+int fsverity_hash_blocks(const struct merkle_tree_params *params,
+			 const struct inode *inode, const u8 * const data[],
+			 u8 * const outs[], unsigned int num_blocks);
 int fsverity_hash_buffer(const struct fsverity_hash_alg *alg,
 			 const void *data, size_t size, u8 *out);
 void __init fsverity_check_hash_algs(void);
@@ -84,8 +84,12 @@ const struct fsverity_hash_alg *fsverity_get_hash_alg(const struct inode *inode,
 	if (WARN_ON_ONCE(alg->block_size != crypto_shash_blocksize(tfm)))
 		goto err_free_tfm;
 
-	pr_info("%s using implementation \"%s\"\n",
-		alg->name, crypto_shash_driver_name(tfm));
+	alg->mb_max_msgs = min_t(unsigned int, crypto_shash_mb_max_msgs(tfm),
+				 FS_VERITY_MAX_PENDING_DATA_BLOCKS);
+
+	pr_info("%s using implementation \"%s\"%s\n",
+		alg->name, crypto_shash_driver_name(tfm),
+		alg->mb_max_msgs > 1 ? " (multibuffer)" : "");
 
 	/* pairs with smp_load_acquire() above */
 	smp_store_release(&alg->tfm, tfm);
@@ -197,6 +201,47 @@ int fsverity_hash_block(const struct merkle_tree_params *params,
 	return err;
 }
 
+/**
+ * fsverity_hash_blocks() - hash several data blocks at once
+ * @params: the Merkle tree's parameters
+ * @inode: inode for which the hashing is being done
+ * @data: virtual addresses of the blocks to hash
+ * @outs: output digests, size 'params->digest_size' bytes each
+ * @num_blocks: number of blocks, at most 'params->hash_alg->mb_max_msgs'
+ *
+ * Like fsverity_hash_block(), but hashes multiple blocks with multibuffer
+ * hashing, which is faster when the hash implementation supports it.
+ *
+ * Return: 0 on success, -errno on failure
+ */
+int fsverity_hash_blocks(const struct merkle_tree_params *params,
+			 const struct inode *inode, const u8 * const data[],
+			 u8 * const outs[], unsigned int num_blocks)
+{
+	SHASH_DESC_ON_STACK(desc, params->hash_alg->tfm);
+	int err;
+
+	desc->tfm = params->hash_alg->tfm;
+
+	if (params->hashstate) {
+		err = crypto_shash_import(desc, params->hashstate);
+		if (err) {
+			fsverity_err(inode,
+				     "Error %d importing hash state", err);
+			return err;
+		}
+		err = crypto_shash_finup_mb(desc, data, params->block_size,
+					    outs, num_blocks);
+	} else {
+		err = crypto_shash_init(desc) ?:
+		      crypto_shash_finup_mb(desc, data, params->block_size,
+					    outs, num_blocks);
+	}
+	if (err)
+		fsverity_err(inode, "Error %d computing block hashes", err);
+	return err;
+}
+
 /**
  * fsverity_hash_buffer() - hash some data
  * @alg: the hash algorithm to use
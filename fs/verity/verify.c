@@ -78,20 +78,31 @@ static bool is_hash_block_verified(struct fsverity_info *vi, struct page *hpage,
 	return false;
 }
 
+/* A data block whose hash still has to be computed and checked */
+struct fsverity_pending_block {
+	const u8 *data;
+	u64 pos;
+	u8 want_hash[FS_VERITY_MAX_DIGEST_SIZE];
+};
+
 /*
- * Verify a single data block against the file's Merkle tree.
+ * Verify the Merkle tree path of a single data block, and get the hash that
+ * the data block itself must have.  The data block's hash isn't computed here,
+ * so that the caller can compute the hashes of multiple data blocks at once.
  *
  * In principle, we need to verify the entire path to the root node.  However,
  * for efficiency the filesystem may cache the hash blocks.  Therefore we need
  * only ascend the tree until an already-verified hash block is seen, and then
  * verify the path to that block.
  *
- * Return: %true if the data block is valid, else %false.
+ * Return: %true if the path is valid and @block->want_hash was set, else %false.
  */
 static bool
 verify_data_block(struct inode *inode, struct fsverity_info *vi,
-		  const void *data, u64 data_pos, unsigned long max_ra_pages)
+		  struct fsverity_pending_block *block,
+		  unsigned long max_ra_pages)
 {
+	const u64 data_pos = block->pos;
 	const struct merkle_tree_params *params = &vi->tree_params;
 	const unsigned int hsize = params->digest_size;
 	int level;
@@ -115,25 +126,12 @@ verify_data_block(struct inode *inode, struct fsverity_info *vi,
 	 */
 	u64 hidx = data_pos >> params->log_blocksize;
 
-	/* Up to 1 + FS_VERITY_MAX_LEVELS pages may be mapped at once */
-	BUILD_BUG_ON(1 + FS_VERITY_MAX_LEVELS > KM_MAX_IDX);
-
-	if (unlikely(data_pos >= inode->i_size)) {
-		/*
-		 * This can happen in the data page spanning EOF when the Merkle
-		 * tree block size is less than the page size.  The Merkle tree
-		 * doesn't cover data blocks fully past EOF.  But the entire
-		 * page spanning EOF can be visible to userspace via a mmap, and
-		 * any part past EOF should be all zeroes.  Therefore, we need
-		 * to verify that any data blocks fully past EOF are all zeroes.
-		 */
-		if (memchr_inv(data, 0, params->block_size)) {
-			fsverity_err(inode,
-				     "FILE CORRUPTED!  Data past EOF is not zeroed");
-			return false;
-		}
-		return true;
-	}
+	/*
+	 * Up to FS_VERITY_MAX_PENDING_DATA_BLOCKS + FS_VERITY_MAX_LEVELS pages
+	 * may be mapped at once
+	 */
+	BUILD_BUG_ON(FS_VERITY_MAX_PENDING_DATA_BLOCKS +
+		     FS_VERITY_MAX_LEVELS > KM_MAX_IDX);
 
 	/*
 	 * Starting at the leaf level, ascend the tree saving hash blocks along
@@ -221,11 +219,7 @@ verify_data_block(struct inode *inode, struct fsverity_info *vi,
 		put_page(hpage);
 	}
 
-	/* Finally, verify the data block. */
-	if (fsverity_hash_block(params, inode, data, real_hash) != 0)
-		goto error;
-	if (memcmp(want_hash, real_hash, hsize) != 0)
-		goto corrupted;
+	memcpy(block->want_hash, want_hash, hsize);
 	return true;
 
 corrupted:
@@ -242,6 +236,53 @@ verify_data_block(struct inode *inode, struct fsverity_info *vi,
 	return false;
 }
 
+/*
+ * Hash the pending data blocks, compare the hashes with the wanted ones, and
+ * unmap the blocks.
+ */
+static bool
+verify_pending_blocks(struct inode *inode, struct fsverity_info *vi,
+		      struct fsverity_pending_block *pending,
+		      unsigned int num_pending)
+{
+	const struct merkle_tree_params *params = &vi->tree_params;
+	const unsigned int hsize = params->digest_size;
+	u8 real_hashes[FS_VERITY_MAX_PENDING_DATA_BLOCKS][FS_VERITY_MAX_DIGEST_SIZE];
+	const u8 *data[FS_VERITY_MAX_PENDING_DATA_BLOCKS];
+	u8 *outs[FS_VERITY_MAX_PENDING_DATA_BLOCKS];
+	bool valid = true;
+	unsigned int i;
+
+	if (num_pending == 0)
+		return true;
+
+	for (i = 0; i < num_pending; i++) {
+		data[i] = pending[i].data;
+		outs[i] = real_hashes[i];
+	}
+
+	if (fsverity_hash_blocks(params, inode, data, outs, num_pending) != 0)
+		valid = false;
+
+	for (i = 0; valid && i < num_pending; i++) {
+		if (memcmp(pending[i].want_hash, real_hashes[i], hsize) != 0) {
+			fsverity_err(inode,
+				     "FILE CORRUPTED! pos=%llu, level=-1, want_hash=%s:%*phN, real_hash=%s:%*phN",
+				     pending[i].pos,
+				     params->hash_alg->name, hsize,
+				     pending[i].want_hash,
+				     params->hash_alg->name, hsize,
+				     real_hashes[i]);
+			valid = false;
+		}
+	}
+
+	/* Unmap in the reverse order of mapping. */
+	while (num_pending--)
+		kunmap_local(pending[num_pending].data);
+	return valid;
+}
+
 static bool
 verify_data_blocks(struct folio *data_folio, size_t len, size_t offset,
 		   unsigned long max_ra_pages)
@@ -249,6 +290,9 @@ verify_data_blocks(struct folio *data_folio, size_t len, size_t offset,
 	struct inode *inode = data_folio->mapping->host;
 	struct fsverity_info *vi = inode->i_verity_info;
 	const unsigned int block_size = vi->tree_params.block_size;
+	const unsigned int max_pending = vi->tree_params.hash_alg->mb_max_msgs;
+	struct fsverity_pending_block pending[FS_VERITY_MAX_PENDING_DATA_BLOCKS];
+	unsigned int num_pending = 0;
 	u64 pos = (u64)data_folio->index << PAGE_SHIFT;
 
 	if (WARN_ON_ONCE(len <= 0 || !IS_ALIGNED(len | offset, block_size)))
@@ -257,19 +301,50 @@ verify_data_blocks(struct folio *data_folio, size_t len, size_t offset,
 			 folio_test_uptodate(data_folio)))
 		return false;
 	do {
-		void *data;
-		bool valid;
-
-		data = kmap_local_folio(data_folio, offset);
-		valid = verify_data_block(inode, vi, data, pos + offset,
-					  max_ra_pages);
-		kunmap_local(data);
-		if (!valid)
-			return false;
+		struct fsverity_pending_block *block = &pending[num_pending];
+
+		block->data = kmap_local_folio(data_folio, offset);
+		block->pos = pos + offset;
+
+		if (unlikely(block->pos >= inode->i_size)) {
+			/*
+			 * This can happen in the data page spanning EOF when
+			 * the Merkle tree block size is less than the page
+			 * size.  The Merkle tree doesn't cover data blocks
+			 * fully past EOF.  But the entire page spanning EOF can
+			 * be visible to userspace via a mmap, and any part past
+			 * EOF should be all zeroes.  Therefore, we need to
+			 * verify that any data blocks fully past EOF are all
+			 * zeroes.
+			 */
+			bool zeroed = !memchr_inv(block->data, 0, block_size);
+
+			kunmap_local(block->data);
+			if (!zeroed) {
+				fsverity_err(inode,
+					     "FILE CORRUPTED!  Data past EOF is not zeroed");
+				goto fail;
+			}
+		} else if (!verify_data_block(inode, vi, block,
+					      max_ra_pages)) {
+			kunmap_local(block->data);
+			goto fail;
+		} else if (++num_pending == max_pending) {
+			num_pending = 0;
+			if (!verify_pending_blocks(inode, vi, pending,
+						   max_pending))
+				return false;
+		}
 		offset += block_size;
 		len -= block_size;
 	} while (len);
-	return true;
+
+	return verify_pending_blocks(inode, vi, pending, num_pending);
+
+fail:
+	while (num_pending--)
+		kunmap_local(pending[num_pending].data);
+	return false;
 }
 
 /**
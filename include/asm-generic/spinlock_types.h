@@ -3,8 +3,11 @@
 #ifndef __ASM_GENERIC_SPINLOCK_TYPES_H
 #define __ASM_GENERIC_SPINLOCK_TYPES_H
 
-#include <linux/types.h>
-typedef atomic_t arch_spinlock_t;
+/*
+ * The ticket lock shares arch_spinlock_t with qspinlock, so that an
+ * architecture can pick either implementation at boot.
+ */
+#include <asm-generic/qspinlock_types.h>
 
 /*
  * qrwlock_types depends on arch_spinlock_t, so we must typedef that before the
@@ -12,6 +15,4 @@ typedef atomic_t arch_spinlock_t;
  */
 #include <asm/qrwlock_types.h>
 
-#define __ARCH_SPIN_LOCK_UNLOCKED	ATOMIC_INIT(0)
-
 #endif /* __ASM_GENERIC_SPINLOCK_TYPES_H */
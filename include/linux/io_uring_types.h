@@ -363,6 +363,7 @@ struct io_ring_ctx {
 
 	const struct cred	*sq_creds;	/* cred used for __io_sq_thread() */
 	struct io_sq_data	*sq_data;	/* if using sq thread polling */
+	unsigned int		sq_weight;	/* share of a shared sq thread */
 
 	struct wait_queue_head	sqo_sq_wait;
 	struct list_head	sqd_list;
@@ -421,6 +422,10 @@ struct io_ring_ctx {
 	unsigned int		napi_busy_poll_to;
 	bool			napi_prefer_busy_poll;
 	bool			napi_enabled;
+	/* an io_uring_napi_tracking_strategy value */
+	u8			napi_track_mode;
+	/* packets polled per napi_busy_loop_rcu() call */
+	u16			napi_budget;
 
 	DECLARE_HASHTABLE(napi_ht, 4);
 #endif
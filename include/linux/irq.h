@@ -1262,7 +1262,15 @@ int ipi_send_single(unsigned int virq, unsigned int cpu);
 int ipi_send_mask(unsigned int virq, const struct cpumask *dest);
 
 void ipi_mux_process(void);
-int ipi_mux_create(unsigned int nr_ipi, void (*mux_send)(unsigned int cpu));
+int ipi_mux_create_mask(unsigned int nr_ipi,
+			void (*mux_send)(unsigned int cpu),
+			void (*mux_send_mask)(const struct cpumask *mask));
+
+static inline int ipi_mux_create(unsigned int nr_ipi,
+				 void (*mux_send)(unsigned int cpu))
+{
+	return ipi_mux_create_mask(nr_ipi, mux_send, NULL);
+}
 
 #ifdef CONFIG_GENERIC_IRQ_MULTI_HANDLER
 /*
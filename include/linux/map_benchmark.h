@@ -15,6 +15,16 @@
 #define DMA_MAP_TO_DEVICE       1
 #define DMA_MAP_FROM_DEVICE     2
 
+#define DMA_MAP_SINGLE_MODE     0 /* dma_map_single() of the whole buffer */
+#define DMA_MAP_SG_MODE         1 /* dma_map_sgtable(), one entry per page */
+#define DMA_MAP_SWIOTLB_MODE    2 /* dma-direct, always bouncing */
+
+/* spread the threads over all online nodes instead of using ->node */
+#define DMA_MAP_F_ALL_NODES     (1U << 0)
+
+/* p50, p90, p99 and p99.9 */
+#define DMA_MAP_NR_PERCENTILES  4
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -27,5 +37,10 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule;  /* how many PAGE_SIZE will do map/unmap once a time */
+	__u32 map_mode; /* DMA_MAP_*_MODE */
+	__u32 flags; /* DMA_MAP_F_* */
+	__u32 resv; /* must be zero */
+	__u64 map_pct_100ns[DMA_MAP_NR_PERCENTILES]; /* map latency percentiles */
+	__u64 unmap_pct_100ns[DMA_MAP_NR_PERCENTILES]; /* as above */
 };
 #endif /* _KERNEL_DMA_BENCHMARK_H */
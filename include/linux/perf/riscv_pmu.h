@@ -28,6 +28,13 @@
 
 #define RISCV_PMU_CONFIG1_GUEST_EVENTS 0x1
 
+/* Counter configuration left programmed in the firmware after the event is gone */
+struct riscv_pmu_ctr_cfg {
+	unsigned long	event_base;
+	u64		config;
+	unsigned long	cflags;
+};
+
 struct cpu_hw_events {
 	/* currently enabled events */
 	int			n_events;
@@ -39,6 +46,18 @@ struct cpu_hw_events {
 	DECLARE_BITMAP(used_hw_ctrs, RISCV_MAX_COUNTERS);
 	/* currently enabled firmware counters */
 	DECLARE_BITMAP(used_fw_ctrs, RISCV_MAX_COUNTERS);
+	/* unused counters still configured in the firmware, see ctr_cfg */
+	DECLARE_BITMAP(cached_ctrs, RISCV_MAX_COUNTERS);
+	/* last configuration programmed on each counter */
+	struct riscv_pmu_ctr_cfg ctr_cfg[RISCV_MAX_COUNTERS];
+	/* The virtual address of the shared memory where counter snapshot will be taken */
+	void *snapshot_addr;
+	/* The physical address of the shared memory where counter snapshot will be taken */
+	phys_addr_t snapshot_addr_phys;
+	/* Boolean flag to indicate setup is already done */
+	bool snapshot_set_done;
+	/* A shadow copy of the counter values to avoid clobbering during multiple SBI calls */
+	u64 snapshot_cval_shcopy[RISCV_MAX_COUNTERS];
 };
 
 struct riscv_pmu {
@@ -2,6 +2,10 @@
 #ifndef _XOR_H
 #define _XOR_H
 
+/*
+ * Number of sources the fixed-arity do_2()..do_5() routines take at once.
+ * xor_blocks() accepts more, either through do_n() or by chaining passes.
+ */
 #define MAX_XOR_BLOCKS 4
 
 extern void xor_blocks(unsigned int count, unsigned int bytes,
@@ -25,6 +29,9 @@ struct xor_block_template {
 		     const unsigned long * __restrict,
 		     const unsigned long * __restrict,
 		     const unsigned long * __restrict);
+	/* optional: xor src_count (> MAX_XOR_BLOCKS) sources in one pass */
+	void (*do_n)(unsigned long, unsigned long * __restrict,
+		     unsigned int, const unsigned long * const *);
 };
 
 #endif
@@ -10,6 +10,7 @@
 #define _LINUX_RHASHTABLE_TYPES_H
 
 #include <linux/atomic.h>
+#include <linux/cache.h>
 #include <linux/compiler.h>
 #include <linux/mutex.h>
 #include <linux/workqueue_types.h>
@@ -76,7 +77,8 @@ struct rhashtable_params {
  * @run_work: Deferred worker to expand/shrink asynchronously
  * @mutex: Mutex to protect current/future table swapping
  * @lock: Spin lock to protect walker list
- * @nelems: Number of elements in table
+ * @nelems: Number of elements in table, kept out of the cacheline of @tbl
+ *	    which every lookup reads
  */
 struct rhashtable {
 	struct bucket_table __rcu	*tbl;
@@ -87,7 +89,7 @@ struct rhashtable {
 	struct work_struct		run_work;
 	struct mutex                    mutex;
 	spinlock_t			lock;
-	atomic_t			nelems;
+	atomic_t			nelems ____cacheline_aligned_in_smp;
 };
 
 /**
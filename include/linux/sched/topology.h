@@ -82,6 +82,7 @@ struct sched_domain_shared {
 	atomic_t	nr_busy_cpus;
 	int		has_idle_cores;
 	int		nr_idle_scan;
+	int		has_idle_cpus;	/* cluster domains only */
 };
 
 struct sched_domain {
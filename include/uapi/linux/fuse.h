@@ -217,6 +217,10 @@
  *  - add backing_id to fuse_open_out, add FOPEN_PASSTHROUGH open flag
  *  - add FUSE_NO_EXPORT_SUPPORT init flag
  *  - add FUSE_NOTIFY_RESEND, add FUSE_HAS_RESEND init flag
+ *
+ *  7.46
+ *  - add FUSE_OVER_IO_URING init flag, add fuse_uring_cmd_req and the
+ *    FUSE_IO_URING_CMD_* commands
  */
 
 #ifndef _LINUX_FUSE_H
@@ -252,7 +256,7 @@
 #define FUSE_KERNEL_VERSION 7
 
 /** Minor version number of this interface */
-#define FUSE_KERNEL_MINOR_VERSION 40
+#define FUSE_KERNEL_MINOR_VERSION 46
 
 /** The node ID of the root inode */
 #define FUSE_ROOT_ID 1
@@ -421,6 +425,8 @@ struct fuse_file_lock {
  * FUSE_NO_EXPORT_SUPPORT: explicitly disable export support
  * FUSE_HAS_RESEND: kernel supports resending pending requests, and the high bit
  *		    of the request ID indicates resend requests
+ * FUSE_OVER_IO_URING: requests may be fetched and answered with io-uring
+ *		       commands on /dev/fuse
  */
 #define FUSE_ASYNC_READ		(1 << 0)
 #define FUSE_POSIX_LOCKS	(1 << 1)
@@ -463,6 +469,7 @@ struct fuse_file_lock {
 #define FUSE_PASSTHROUGH	(1ULL << 37)
 #define FUSE_NO_EXPORT_SUPPORT	(1ULL << 38)
 #define FUSE_HAS_RESEND		(1ULL << 39)
+#define FUSE_OVER_IO_URING	(1ULL << 43)
 
 /* Obsolete alias for FUSE_DIRECT_IO_ALLOW_MMAP */
 #define FUSE_DIRECT_IO_RELAX	FUSE_DIRECT_IO_ALLOW_MMAP
@@ -1186,4 +1193,38 @@ struct fuse_supp_groups {
 	uint32_t	groups[];
 };
 
+/*
+ * io-uring commands on /dev/fuse (IORING_OP_URING_CMD), in the cmd_op field
+ * of the SQE.
+ *
+ * FUSE_IO_URING_CMD_REGISTER: add a buffer to queue @qid.  The command
+ *	completes when a request is copied to the buffer, with the size of
+ *	the request as result.  The buffer takes the same format as a read(2)
+ *	of /dev/fuse and must be at least as large.
+ *
+ * FUSE_IO_URING_CMD_COMMIT_AND_FETCH: answer the request last fetched with
+ *	this entry, the buffer holding the reply in the format of a write(2)
+ *	to /dev/fuse, then wait for the next request like
+ *	FUSE_IO_URING_CMD_REGISTER does.  The buffer may differ from the one
+ *	the request was fetched into.
+ *
+ * Requests are queued on the queue of the CPU they are issued on, so @qid is
+ * a CPU number.  FORGET and INTERRUPT requests, and requests issued on CPUs
+ * without a registered queue, are still read from /dev/fuse.  Commands
+ * complete with -ENOTCONN once the connection is aborted.
+ */
+enum fuse_uring_cmd {
+	FUSE_IO_URING_CMD_INVALID		= 0,
+	FUSE_IO_URING_CMD_REGISTER		= 1,
+	FUSE_IO_URING_CMD_COMMIT_AND_FETCH	= 2,
+};
+
+/* In the command area of the SQE */
+struct fuse_uring_cmd_req {
+	uint64_t	buf;
+	uint32_t	buf_len;
+	uint16_t	qid;
+	uint16_t	flags;
+};
+
 #endif /* _LINUX_FUSE_H */
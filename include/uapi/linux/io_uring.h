@@ -342,7 +342,8 @@ enum io_uring_op {
  *				CQEs on behalf of the same SQE.
  *
  * IORING_RECVSEND_FIXED_BUF	Use registered buffers, the index is stored in
- *				the buf_index field.
+ *				the buf_index field. Supported by send_zc
+ *				and recv.
  *
  * IORING_SEND_ZC_REPORT_USAGE
  *				If set, SEND[MSG]_ZC should report
@@ -419,11 +420,16 @@ struct io_uring_cqe {
  * IORING_CQE_F_SOCK_NONEMPTY	If set, more data to read after socket recv
  * IORING_CQE_F_NOTIF	Set for notification CQEs. Can be used to distinct
  * 			them from sends.
+ * IORING_CQE_F_BUF_MORE	If set, the buffer ID set in the completion was
+ *			only partially consumed and the kernel keeps using
+ *			the rest of it for later completions. Only set for
+ *			buffer rings registered with IOU_PBUF_RING_INC.
  */
 #define IORING_CQE_F_BUFFER		(1U << 0)
 #define IORING_CQE_F_MORE		(1U << 1)
 #define IORING_CQE_F_SOCK_NONEMPTY	(1U << 2)
 #define IORING_CQE_F_NOTIF		(1U << 3)
+#define IORING_CQE_F_BUF_MORE		(1U << 4)
 
 enum {
 	IORING_CQE_BUFFER_SHIFT		= 16,
@@ -575,6 +581,11 @@ enum {
 	IORING_REGISTER_NAPI			= 27,
 	IORING_UNREGISTER_NAPI			= 28,
 
+	/* 29 - 36 are allocated upstream, starting at IORING_REGISTER_CLOCK */
+
+	/* set the share of a shared SQPOLL thread this ring gets */
+	IORING_REGISTER_SQPOLL_WEIGHT		= 37,
+
 	/* this goes last */
 	IORING_REGISTER_LAST,
 
@@ -687,9 +698,17 @@ struct io_uring_buf_ring {
  *			mmap(2) with the offset set as:
  *			IORING_OFF_PBUF_RING | (bgid << IORING_OFF_PBUF_SHIFT)
  *			to get a virtual mapping for the ring.
+ * IOU_PBUF_RING_INC:	If set, buffers are consumed incrementally. A
+ *			completion only uses up as much of the buffer as it
+ *			transferred, and the rest of the buffer is used by
+ *			the following ones, at the next offset. Completions
+ *			set IORING_CQE_F_BUF_MORE while the kernel still
+ *			holds on to the buffer. The kernel updates the addr
+ *			and len of the buffer in the ring as it goes.
  */
 enum {
 	IOU_PBUF_RING_MMAP	= 1,
+	IOU_PBUF_RING_INC	= 2,
 };
 
 /* argument for IORING_(UN)REGISTER_PBUF_RING */
@@ -712,8 +731,48 @@ struct io_uring_buf_status {
 struct io_uring_napi {
 	__u32	busy_poll_to;
 	__u8	prefer_busy_poll;
-	__u8	pad[3];
-	__u64	resv;
+	/* an io_uring_napi_op value */
+	__u8	opcode;
+	/* packets per busy poll of a NAPI ID, 0 for the default */
+	__u16	budget;
+	/*
+	 * For IO_URING_NAPI_REGISTER_OP, an io_uring_napi_tracking_strategy
+	 * value. For IO_URING_NAPI_STATIC_ADD_ID and IO_URING_NAPI_STATIC_DEL_ID,
+	 * the NAPI ID to add to or remove from the busy poll list.
+	 */
+	__u32	op_param;
+	__u32	resv;
+};
+
+enum io_uring_napi_op {
+	/* set the busy poll settings and tracking strategy */
+	IO_URING_NAPI_REGISTER_OP	= 0,
+	/* with IO_URING_NAPI_TRACKING_STATIC, add or remove a NAPI ID */
+	IO_URING_NAPI_STATIC_ADD_ID	= 1,
+	IO_URING_NAPI_STATIC_DEL_ID	= 2,
+};
+
+enum io_uring_napi_tracking_strategy {
+	/*
+	 * The NAPI IDs of the sockets used by requests are added as they are
+	 * seen, and dropped after a minute without use.
+	 */
+	IO_URING_NAPI_TRACKING_DYNAMIC	= 0,
+	/*
+	 * Only the NAPI IDs added with IO_URING_NAPI_STATIC_ADD_ID are busy
+	 * polled, until they are removed.
+	 */
+	IO_URING_NAPI_TRACKING_STATIC	= 1,
+};
+
+/* argument for IORING_REGISTER_SQPOLL_WEIGHT */
+struct io_uring_sqpoll_weight {
+	/*
+	 * Relative number of SQEs submitted per pass of an SQPOLL thread
+	 * shared with other rings, 1 being the default.
+	 */
+	__u32	weight;
+	__u32	resv[3];
 };
 
 /*
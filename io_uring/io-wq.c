@@ -59,6 +59,8 @@ struct io_worker {
 	unsigned long create_state;
 	struct callback_head create_work;
 	int create_index;
+	/* node of the task that queued the work this worker was created for */
+	int node;
 
 	union {
 		struct rcu_head rcu;
@@ -264,11 +266,11 @@ static inline bool io_acct_run_queue(struct io_wq_acct *acct)
 }
 
 /*
- * Check head of free list for an available worker. If one isn't available,
- * caller must create one.
+ * Check head of free list for an available worker on @node, or on any node
+ * if @node is NUMA_NO_NODE.
  */
-static bool io_wq_activate_free_worker(struct io_wq *wq,
-					struct io_wq_acct *acct)
+static bool __io_wq_activate_free_worker(struct io_wq *wq,
+					 struct io_wq_acct *acct, int node)
 	__must_hold(RCU)
 {
 	struct hlist_nulls_node *n;
@@ -282,7 +284,8 @@ static bool io_wq_activate_free_worker(struct io_wq *wq,
 	hlist_nulls_for_each_entry_rcu(worker, n, &wq->free_list, nulls_node) {
 		if (!io_worker_get(worker))
 			continue;
-		if (io_wq_get_acct(worker) != acct) {
+		if (io_wq_get_acct(worker) != acct ||
+		    (node != NUMA_NO_NODE && worker->node != node)) {
 			io_worker_release(worker);
 			continue;
 		}
@@ -299,6 +302,21 @@ static bool io_wq_activate_free_worker(struct io_wq *wq,
 	return false;
 }
 
+/*
+ * Check the free list for an available worker, preferring one that was
+ * created on the node of the caller so the work stays close to the memory
+ * it was queued with. If one isn't available, caller must create one.
+ */
+static bool io_wq_activate_free_worker(struct io_wq *wq,
+					struct io_wq_acct *acct)
+	__must_hold(RCU)
+{
+	if (nr_node_ids > 1 &&
+	    __io_wq_activate_free_worker(wq, acct, numa_node_id()))
+		return true;
+	return __io_wq_activate_free_worker(wq, acct, NUMA_NO_NODE);
+}
+
 /*
  * We need a worker. If we find a free one, we're good. If not, and we're
  * below the max number of workers, create one.
@@ -771,7 +789,7 @@ static void create_worker_cont(struct callback_head *cb)
 	worker = container_of(cb, struct io_worker, create_work);
 	clear_bit_unlock(0, &worker->create_state);
 	wq = worker->wq;
-	tsk = create_io_thread(io_wq_worker, worker, NUMA_NO_NODE);
+	tsk = create_io_thread(io_wq_worker, worker, worker->node);
 	if (!IS_ERR(tsk)) {
 		io_init_new_worker(wq, worker, tsk);
 		io_worker_release(worker);
@@ -821,7 +839,7 @@ static bool create_io_worker(struct io_wq *wq, int index)
 
 	__set_current_state(TASK_RUNNING);
 
-	worker = kzalloc(sizeof(*worker), GFP_KERNEL);
+	worker = kzalloc_node(sizeof(*worker), GFP_KERNEL, numa_node_id());
 	if (!worker) {
 fail:
 		atomic_dec(&acct->nr_running);
@@ -834,13 +852,14 @@ static bool create_io_worker(struct io_wq *wq, int index)
 
 	refcount_set(&worker->ref, 1);
 	worker->wq = wq;
+	worker->node = numa_node_id();
 	raw_spin_lock_init(&worker->lock);
 	init_completion(&worker->ref_done);
 
 	if (index == IO_WQ_ACCT_BOUND)
 		worker->flags |= IO_WORKER_F_BOUND;
 
-	tsk = create_io_thread(io_wq_worker, worker, NUMA_NO_NODE);
+	tsk = create_io_thread(io_wq_worker, worker, worker->node);
 	if (!IS_ERR(tsk)) {
 		io_init_new_worker(wq, worker, tsk);
 	} else if (!io_should_retry_thread(PTR_ERR(tsk))) {
@@ -15,7 +15,6 @@
 #include "opdef.h"
 #include "kbuf.h"
 
-#define IO_BUFFER_LIST_BUF_PER_PAGE (PAGE_SIZE / sizeof(struct io_uring_buf))
 
 #define BGID_ARRAY	64
 
@@ -111,12 +110,12 @@ void __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags)
 		struct io_ring_ctx *ctx = req->ctx;
 
 		spin_lock(&ctx->completion_lock);
-		__io_put_kbuf_list(req, &ctx->io_buffers_comp);
+		__io_put_kbuf_list(req, 0, &ctx->io_buffers_comp);
 		spin_unlock(&ctx->completion_lock);
 	} else {
 		lockdep_assert_held(&req->ctx->uring_lock);
 
-		__io_put_kbuf_list(req, &req->ctx->io_buffers_cache);
+		__io_put_kbuf_list(req, 0, &req->ctx->io_buffers_cache);
 	}
 }
 
@@ -155,16 +154,7 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 	if (head + 1 == tail)
 		req->flags |= REQ_F_BL_EMPTY;
 
-	head &= bl->mask;
-	/* mmaped buffers are always contig */
-	if (bl->is_mmap || head < IO_BUFFER_LIST_BUF_PER_PAGE) {
-		buf = &br->bufs[head];
-	} else {
-		int off = head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1);
-		int index = head / IO_BUFFER_LIST_BUF_PER_PAGE;
-		buf = page_address(bl->buf_pages[index]);
-		buf += off;
-	}
+	buf = io_ring_head_to_buf(bl, head);
 	if (*len == 0 || *len > buf->len)
 		*len = buf->len;
 	req->flags |= REQ_F_BUFFER_RING;
@@ -180,7 +170,8 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 		 * io-wq context and there may be further retries in async hybrid
 		 * mode. For the locked case, the caller must call commit when
 		 * the transfer completes (or if we get -EAGAIN and must poll of
-		 * retry).
+		 * retry). An incrementally consumed buffer is consumed whole
+		 * here, as the length of the transfer isn't known yet.
 		 */
 		req->buf_list = NULL;
 		bl->head++;
@@ -275,6 +266,7 @@ static int __io_remove_buffers(struct io_ring_ctx *ctx,
 		/* make sure it's seen as empty */
 		INIT_LIST_HEAD(&bl->buf_list);
 		bl->is_buf_ring = 0;
+		bl->is_inc = 0;
 		return i;
 	}
 
@@ -660,7 +652,7 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 
 	if (reg.resv[0] || reg.resv[1] || reg.resv[2])
 		return -EINVAL;
-	if (reg.flags & ~IOU_PBUF_RING_MMAP)
+	if (reg.flags & ~(IOU_PBUF_RING_MMAP | IOU_PBUF_RING_INC))
 		return -EINVAL;
 	if (!(reg.flags & IOU_PBUF_RING_MMAP)) {
 		if (!reg.ring_addr)
@@ -704,6 +696,7 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 	if (!ret) {
 		bl->nr_entries = reg.ring_entries;
 		bl->mask = reg.ring_entries - 1;
+		bl->is_inc = !!(reg.flags & IOU_PBUF_RING_INC);
 
 		io_buffer_add_list(ctx, bl, reg.bgid);
 		return 0;
@@ -4,6 +4,8 @@
 
 #include <uapi/linux/io_uring.h>
 
+#define IO_BUFFER_LIST_BUF_PER_PAGE (PAGE_SIZE / sizeof(struct io_uring_buf))
+
 struct io_buffer_list {
 	/*
 	 * If ->buf_nr_pages is set, then buf_pages/buf_ring are used. If not,
@@ -31,6 +33,8 @@ struct io_buffer_list {
 	__u8 is_mmap;
 	/* bl is visible from an RCU point of view for lookup */
 	__u8 is_ready;
+	/* buffers are consumed incrementally, see IOU_PBUF_RING_INC */
+	__u8 is_inc;
 };
 
 struct io_buffer {
@@ -63,6 +67,43 @@ bool io_kbuf_recycle_legacy(struct io_kiocb *req, unsigned issue_flags);
 
 void *io_pbuf_get_address(struct io_ring_ctx *ctx, unsigned long bgid);
 
+static inline struct io_uring_buf *io_ring_head_to_buf(struct io_buffer_list *bl,
+						       __u16 head)
+{
+	struct io_uring_buf *buf;
+
+	head &= bl->mask;
+	/* mmaped buffers are always contig */
+	if (bl->is_mmap || head < IO_BUFFER_LIST_BUF_PER_PAGE)
+		return &bl->buf_ring->bufs[head];
+
+	buf = page_address(bl->buf_pages[head / IO_BUFFER_LIST_BUF_PER_PAGE]);
+	return buf + (head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1));
+}
+
+/*
+ * Consume @len bytes of the buffer at the head of an incrementally consumed
+ * ring.  The rest of the buffer stays at the head for the next request.
+ * Returns true if the buffer was used up and handed back to the application.
+ */
+static inline bool io_kbuf_inc_commit(struct io_buffer_list *bl, int len)
+{
+	struct io_uring_buf *buf = io_ring_head_to_buf(bl, bl->head);
+	u32 buf_len;
+
+	if (len <= 0)
+		return false;
+
+	buf_len = READ_ONCE(buf->len);
+	if (len < buf_len) {
+		WRITE_ONCE(buf->addr, READ_ONCE(buf->addr) + len);
+		WRITE_ONCE(buf->len, buf_len - len);
+		return false;
+	}
+	bl->head++;
+	return true;
+}
+
 static inline bool io_kbuf_recycle_ring(struct io_kiocb *req)
 {
 	/*
@@ -98,25 +139,37 @@ static inline bool io_kbuf_recycle(struct io_kiocb *req, unsigned issue_flags)
 	return false;
 }
 
-static inline void __io_put_kbuf_ring(struct io_kiocb *req)
+/*
+ * @len is the number of bytes transferred into the buffer, which is what an
+ * incrementally consumed buffer is charged.  Returns false if the buffer was
+ * only partially consumed.
+ */
+static inline bool __io_put_kbuf_ring(struct io_kiocb *req, int len)
 {
-	if (req->buf_list) {
-		req->buf_index = req->buf_list->bgid;
-		req->buf_list->head++;
+	struct io_buffer_list *bl = req->buf_list;
+	bool ret = true;
+
+	if (bl) {
+		req->buf_index = bl->bgid;
+		if (bl->is_inc)
+			ret = io_kbuf_inc_commit(bl, len);
+		else
+			bl->head++;
 	}
 	req->flags &= ~REQ_F_BUFFER_RING;
+	return ret;
 }
 
-static inline void __io_put_kbuf_list(struct io_kiocb *req,
+static inline bool __io_put_kbuf_list(struct io_kiocb *req, int len,
 				      struct list_head *list)
 {
-	if (req->flags & REQ_F_BUFFER_RING) {
-		__io_put_kbuf_ring(req);
-	} else {
-		req->buf_index = req->kbuf->bgid;
-		list_add(&req->kbuf->list, list);
-		req->flags &= ~REQ_F_BUFFER_SELECTED;
-	}
+	if (req->flags & REQ_F_BUFFER_RING)
+		return __io_put_kbuf_ring(req, len);
+
+	req->buf_index = req->kbuf->bgid;
+	list_add(&req->kbuf->list, list);
+	req->flags &= ~REQ_F_BUFFER_SELECTED;
+	return true;
 }
 
 static inline unsigned int io_put_kbuf_comp(struct io_kiocb *req)
@@ -129,11 +182,12 @@ static inline unsigned int io_put_kbuf_comp(struct io_kiocb *req)
 		return 0;
 
 	ret = IORING_CQE_F_BUFFER | (req->buf_index << IORING_CQE_BUFFER_SHIFT);
-	__io_put_kbuf_list(req, &req->ctx->io_buffers_comp);
+	if (!__io_put_kbuf_list(req, 0, &req->ctx->io_buffers_comp))
+		ret |= IORING_CQE_F_BUF_MORE;
 	return ret;
 }
 
-static inline unsigned int io_put_kbuf(struct io_kiocb *req,
+static inline unsigned int io_put_kbuf(struct io_kiocb *req, int len,
 				       unsigned issue_flags)
 {
 	unsigned int ret;
@@ -142,10 +196,12 @@ static inline unsigned int io_put_kbuf(struct io_kiocb *req,
 		return 0;
 
 	ret = IORING_CQE_F_BUFFER | (req->buf_index << IORING_CQE_BUFFER_SHIFT);
-	if (req->flags & REQ_F_BUFFER_RING)
-		__io_put_kbuf_ring(req);
-	else
+	if (req->flags & REQ_F_BUFFER_RING) {
+		if (!__io_put_kbuf_ring(req, len))
+			ret |= IORING_CQE_F_BUF_MORE;
+	} else {
 		__io_put_kbuf(req, issue_flags);
+	}
 	return ret;
 }
 #endif
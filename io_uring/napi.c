@@ -33,22 +33,15 @@ static struct io_napi_entry *io_napi_hash_find(struct hlist_head *hash_list,
 	return NULL;
 }
 
-void __io_napi_add(struct io_ring_ctx *ctx, struct socket *sock)
+static int __io_napi_add_id(struct io_ring_ctx *ctx, unsigned int napi_id,
+			    gfp_t gfp)
 {
 	struct hlist_head *hash_list;
-	unsigned int napi_id;
-	struct sock *sk;
 	struct io_napi_entry *e;
 
-	sk = sock->sk;
-	if (!sk)
-		return;
-
-	napi_id = READ_ONCE(sk->sk_napi_id);
-
 	/* Non-NAPI IDs can be rejected. */
 	if (napi_id < MIN_NAPI_ID)
-		return;
+		return -EINVAL;
 
 	hash_list = &ctx->napi_ht[hash_min(napi_id, HASH_BITS(ctx->napi_ht))];
 
@@ -57,13 +50,13 @@ void __io_napi_add(struct io_ring_ctx *ctx, struct socket *sock)
 	if (e) {
 		e->timeout = jiffies + NAPI_TIMEOUT;
 		rcu_read_unlock();
-		return;
+		return -EEXIST;
 	}
 	rcu_read_unlock();
 
-	e = kmalloc(sizeof(*e), GFP_NOWAIT);
+	e = kmalloc(sizeof(*e), gfp);
 	if (!e)
-		return;
+		return -ENOMEM;
 
 	e->napi_id = napi_id;
 	e->timeout = jiffies + NAPI_TIMEOUT;
@@ -72,12 +65,51 @@ void __io_napi_add(struct io_ring_ctx *ctx, struct socket *sock)
 	if (unlikely(io_napi_hash_find(hash_list, napi_id))) {
 		spin_unlock(&ctx->napi_lock);
 		kfree(e);
-		return;
+		return -EEXIST;
 	}
 
 	hlist_add_tail_rcu(&e->node, hash_list);
-	list_add_tail(&e->list, &ctx->napi_list);
+	list_add_tail_rcu(&e->list, &ctx->napi_list);
+	spin_unlock(&ctx->napi_lock);
+	return 0;
+}
+
+void __io_napi_add(struct io_ring_ctx *ctx, struct socket *sock)
+{
+	struct sock *sk;
+
+	sk = sock->sk;
+	if (!sk)
+		return;
+
+	__io_napi_add_id(ctx, READ_ONCE(sk->sk_napi_id), GFP_NOWAIT);
+}
+
+static void io_napi_entry_del(struct io_napi_entry *e)
+{
+	list_del_rcu(&e->list);
+	hash_del_rcu(&e->node);
+	kfree_rcu(e, rcu);
+}
+
+static int io_napi_del_id(struct io_ring_ctx *ctx, unsigned int napi_id)
+{
+	struct hlist_head *hash_list;
+	struct io_napi_entry *e;
+	int ret = -ENOENT;
+
+	hash_list = &ctx->napi_ht[hash_min(napi_id, HASH_BITS(ctx->napi_ht))];
+
+	spin_lock(&ctx->napi_lock);
+	hlist_for_each_entry(e, hash_list, node) {
+		if (e->napi_id == napi_id) {
+			io_napi_entry_del(e);
+			ret = 0;
+			break;
+		}
+	}
 	spin_unlock(&ctx->napi_lock);
+	return ret;
 }
 
 static void __io_napi_remove_stale(struct io_ring_ctx *ctx)
@@ -87,11 +119,8 @@ static void __io_napi_remove_stale(struct io_ring_ctx *ctx)
 
 	spin_lock(&ctx->napi_lock);
 	hash_for_each(ctx->napi_ht, i, e, node) {
-		if (time_after(jiffies, e->timeout)) {
-			list_del(&e->list);
-			hash_del_rcu(&e->node);
-			kfree_rcu(e, rcu);
-		}
+		if (time_after(jiffies, e->timeout))
+			io_napi_entry_del(e);
 	}
 	spin_unlock(&ctx->napi_lock);
 }
@@ -136,15 +165,19 @@ static bool __io_napi_do_busy_loop(struct io_ring_ctx *ctx,
 	struct io_napi_entry *e;
 	bool (*loop_end)(void *, unsigned long) = NULL;
 	bool is_stale = false;
+	bool dynamic = READ_ONCE(ctx->napi_track_mode) ==
+		       IO_URING_NAPI_TRACKING_DYNAMIC;
+	u16 budget = READ_ONCE(ctx->napi_budget);
 
 	if (loop_end_arg)
 		loop_end = io_napi_busy_loop_should_end;
 
 	list_for_each_entry_rcu(e, &ctx->napi_list, list) {
 		napi_busy_loop_rcu(e->napi_id, loop_end, loop_end_arg,
-				   ctx->napi_prefer_busy_poll, BUSY_POLL_BUDGET);
+				   ctx->napi_prefer_busy_poll, budget);
 
-		if (time_after(jiffies, e->timeout))
+		/* Registered IDs stay until they are removed */
+		if (dynamic && time_after(jiffies, e->timeout))
 			is_stale = true;
 	}
 
@@ -185,6 +218,8 @@ void io_napi_init(struct io_ring_ctx *ctx)
 	spin_lock_init(&ctx->napi_lock);
 	ctx->napi_prefer_busy_poll = false;
 	ctx->napi_busy_poll_to = READ_ONCE(sysctl_net_busy_poll);
+	ctx->napi_track_mode = IO_URING_NAPI_TRACKING_DYNAMIC;
+	ctx->napi_budget = BUSY_POLL_BUDGET;
 }
 
 /*
@@ -200,10 +235,8 @@ void io_napi_free(struct io_ring_ctx *ctx)
 	unsigned int i;
 
 	spin_lock(&ctx->napi_lock);
-	hash_for_each(ctx->napi_ht, i, e, node) {
-		hash_del_rcu(&e->node);
-		kfree_rcu(e, rcu);
-	}
+	hash_for_each(ctx->napi_ht, i, e, node)
+		io_napi_entry_del(e);
 	spin_unlock(&ctx->napi_lock);
 }
 
@@ -218,20 +251,47 @@ int io_register_napi(struct io_ring_ctx *ctx, void __user *arg)
 {
 	const struct io_uring_napi curr = {
 		.busy_poll_to 	  = ctx->napi_busy_poll_to,
-		.prefer_busy_poll = ctx->napi_prefer_busy_poll
+		.prefer_busy_poll = ctx->napi_prefer_busy_poll,
+		.budget		  = ctx->napi_budget,
+		.op_param	  = ctx->napi_track_mode
 	};
 	struct io_uring_napi napi;
 
 	if (copy_from_user(&napi, arg, sizeof(napi)))
 		return -EFAULT;
-	if (napi.pad[0] || napi.pad[1] || napi.pad[2] || napi.resv)
+	if (napi.resv)
+		return -EINVAL;
+
+	switch (napi.opcode) {
+	case IO_URING_NAPI_REGISTER_OP:
+		break;
+	case IO_URING_NAPI_STATIC_ADD_ID:
+		if (ctx->napi_track_mode != IO_URING_NAPI_TRACKING_STATIC)
+			return -EINVAL;
+		return __io_napi_add_id(ctx, napi.op_param, GFP_KERNEL);
+	case IO_URING_NAPI_STATIC_DEL_ID:
+		if (ctx->napi_track_mode != IO_URING_NAPI_TRACKING_STATIC)
+			return -EINVAL;
+		return io_napi_del_id(ctx, napi.op_param);
+	default:
+		return -EINVAL;
+	}
+
+	if (napi.op_param != IO_URING_NAPI_TRACKING_DYNAMIC &&
+	    napi.op_param != IO_URING_NAPI_TRACKING_STATIC)
 		return -EINVAL;
 
 	if (copy_to_user(arg, &curr, sizeof(curr)))
 		return -EFAULT;
 
+	/* The tracked IDs don't carry over to another strategy */
+	if (napi.op_param != ctx->napi_track_mode)
+		io_napi_free(ctx);
+
 	WRITE_ONCE(ctx->napi_busy_poll_to, napi.busy_poll_to);
 	WRITE_ONCE(ctx->napi_prefer_busy_poll, !!napi.prefer_busy_poll);
+	WRITE_ONCE(ctx->napi_budget, napi.budget ?: BUSY_POLL_BUDGET);
+	WRITE_ONCE(ctx->napi_track_mode, napi.op_param);
 	WRITE_ONCE(ctx->napi_enabled, true);
 	return 0;
 }
@@ -248,7 +308,9 @@ int io_unregister_napi(struct io_ring_ctx *ctx, void __user *arg)
 {
 	const struct io_uring_napi curr = {
 		.busy_poll_to 	  = ctx->napi_busy_poll_to,
-		.prefer_busy_poll = ctx->napi_prefer_busy_poll
+		.prefer_busy_poll = ctx->napi_prefer_busy_poll,
+		.budget		  = ctx->napi_budget,
+		.op_param	  = ctx->napi_track_mode
 	};
 
 	if (arg && copy_to_user(arg, &curr, sizeof(curr)))
@@ -257,6 +319,11 @@ int io_unregister_napi(struct io_ring_ctx *ctx, void __user *arg)
 	WRITE_ONCE(ctx->napi_busy_poll_to, 0);
 	WRITE_ONCE(ctx->napi_prefer_busy_poll, false);
 	WRITE_ONCE(ctx->napi_enabled, false);
+	if (ctx->napi_track_mode == IO_URING_NAPI_TRACKING_STATIC) {
+		io_napi_free(ctx);
+		WRITE_ONCE(ctx->napi_track_mode, IO_URING_NAPI_TRACKING_DYNAMIC);
+	}
+	WRITE_ONCE(ctx->napi_budget, BUSY_POLL_BUDGET);
 	return 0;
 }
 
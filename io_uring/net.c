@@ -627,7 +627,8 @@ int io_recvmsg_prep_async(struct io_kiocb *req)
 	return ret;
 }
 
-#define RECVMSG_FLAGS (IORING_RECVSEND_POLL_FIRST | IORING_RECV_MULTISHOT)
+#define RECVMSG_FLAGS (IORING_RECVSEND_POLL_FIRST | IORING_RECV_MULTISHOT | \
+			IORING_RECVSEND_FIXED_BUF)
 
 int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
@@ -666,6 +667,20 @@ int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		 */
 		sr->buf_group = req->buf_index;
 	}
+	if (sr->flags & IORING_RECVSEND_FIXED_BUF) {
+		struct io_ring_ctx *ctx = req->ctx;
+		unsigned idx = READ_ONCE(sqe->buf_index);
+
+		/* only plain recv, a provided buffer can't also be fixed */
+		if (req->opcode != IORING_OP_RECV ||
+		    (req->flags & REQ_F_BUFFER_SELECT))
+			return -EINVAL;
+		if (unlikely(idx >= ctx->nr_user_bufs))
+			return -EFAULT;
+		idx = array_index_nospec(idx, ctx->nr_user_bufs);
+		req->imu = READ_ONCE(ctx->user_bufs[idx]);
+		io_req_set_rsrc_node(req, ctx, 0);
+	}
 
 #ifdef CONFIG_COMPAT
 	if (req->ctx->compat)
@@ -697,7 +712,7 @@ static inline bool io_recv_finish(struct io_kiocb *req, int *ret,
 {
 	unsigned int cflags;
 
-	cflags = io_put_kbuf(req, issue_flags);
+	cflags = io_put_kbuf(req, *ret, issue_flags);
 	if (msg->msg_inq > 0)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 
@@ -966,7 +981,11 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 		sr->len = len;
 	}
 
-	ret = import_ubuf(ITER_DEST, sr->buf, len, &msg.msg_iter);
+	if (sr->flags & IORING_RECVSEND_FIXED_BUF)
+		ret = io_import_fixed(ITER_DEST, &msg.msg_iter, req->imu,
+					(u64)(uintptr_t)sr->buf, len);
+	else
+		ret = import_ubuf(ITER_DEST, sr->buf, len, &msg.msg_iter);
 	if (unlikely(ret))
 		goto out_free;
 
@@ -563,6 +563,12 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_unregister_napi(ctx, arg);
 		break;
+	case IORING_REGISTER_SQPOLL_WEIGHT:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_sqpoll_register_weight(ctx, arg);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -19,6 +19,7 @@
 #include "sqpoll.h"
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
+#define IORING_SQPOLL_MAX_WEIGHT	64
 #define IORING_TW_CAP_ENTRIES_VALUE	8
 
 enum {
@@ -172,9 +173,17 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 	int ret = 0;
 
 	to_submit = io_sqring_entries(ctx);
-	/* if we're handling multiple rings, cap submit size for fairness */
-	if (cap_entries && to_submit > IORING_SQPOLL_CAP_ENTRIES_VALUE)
-		to_submit = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	/*
+	 * If we're handling multiple rings, cap submit size for fairness,
+	 * in proportion to the weight of the ring.
+	 */
+	if (cap_entries) {
+		unsigned int cap = IORING_SQPOLL_CAP_ENTRIES_VALUE *
+				   READ_ONCE(ctx->sq_weight);
+
+		if (to_submit > cap)
+			to_submit = cap;
+	}
 
 	if (!wq_list_empty(&ctx->iopoll_list) || to_submit) {
 		const struct cred *creds = NULL;
@@ -309,6 +318,12 @@ static int io_sq_thread(void *data)
 			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
 				sqt_spin = true;
 		}
+		/*
+		 * Start the next pass with the following ring, so that no ring
+		 * is always served first and the others only after it.
+		 */
+		if (cap_entries)
+			list_rotate_left(&sqd->ctx_list);
 		if (io_sq_tw(&retry_list, IORING_TW_CAP_ENTRIES_VALUE))
 			sqt_spin = true;
 
@@ -433,6 +448,7 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 
 		ctx->sq_creds = get_current_cred();
 		ctx->sq_data = sqd;
+		ctx->sq_weight = 1;
 		ctx->sq_thread_idle = msecs_to_jiffies(p->sq_thread_idle);
 		if (!ctx->sq_thread_idle)
 			ctx->sq_thread_idle = HZ;
@@ -503,3 +519,21 @@ __cold int io_sqpoll_wq_cpu_affinity(struct io_ring_ctx *ctx,
 
 	return ret;
 }
+
+int io_sqpoll_register_weight(struct io_ring_ctx *ctx, void __user *arg)
+{
+	struct io_uring_sqpoll_weight w;
+
+	if (!(ctx->flags & IORING_SETUP_SQPOLL))
+		return -EINVAL;
+	if (copy_from_user(&w, arg, sizeof(w)))
+		return -EFAULT;
+	if (!w.weight || w.weight > IORING_SQPOLL_MAX_WEIGHT)
+		return -EINVAL;
+	if (memchr_inv(w.resv, 0, sizeof(w.resv)))
+		return -EINVAL;
+
+	/* read locklessly by the SQPOLL thread on its next pass */
+	WRITE_ONCE(ctx->sq_weight, w.weight);
+	return 0;
+}
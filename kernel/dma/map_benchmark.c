@@ -8,6 +8,7 @@
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
+#include <linux/dma-map-ops.h>
 #include <linux/dma-mapping.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
@@ -16,9 +17,21 @@
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
+#include <linux/swiotlb.h>
 #include <linux/timekeeping.h>
 
+#include "direct.h"
+
+/* latency histogram in 100ns steps, the last bucket counts anything above */
+#define DMA_MAP_HIST_BUCKETS	1024
+
+/* percentiles reported, in tenths of a percent */
+static const unsigned int map_benchmark_pct[DMA_MAP_NR_PERCENTILES] = {
+	500, 900, 990, 999,
+};
+
 struct map_benchmark_data {
 	struct map_benchmark bparam;
 	struct device *dev;
@@ -31,19 +44,75 @@ struct map_benchmark_data {
 	atomic64_t loops;
 };
 
+struct map_benchmark_thread {
+	struct map_benchmark_data *map;
+	u64 map_hist[DMA_MAP_HIST_BUCKETS];
+	u64 unmap_hist[DMA_MAP_HIST_BUCKETS];
+};
+
+static int map_benchmark_map(struct map_benchmark_data *map, void *buf,
+		u64 size, struct sg_table *sgt, dma_addr_t *dma_addr)
+{
+	switch (map->bparam.map_mode) {
+	case DMA_MAP_SG_MODE:
+		return dma_map_sgtable(map->dev, sgt, map->dir, 0);
+	case DMA_MAP_SWIOTLB_MODE:
+		if (!IS_ENABLED(CONFIG_SWIOTLB))
+			return -EOPNOTSUPP;
+		*dma_addr = swiotlb_map(map->dev, virt_to_phys(buf), size,
+					map->dir, 0);
+		break;
+	default:
+		*dma_addr = dma_map_single(map->dev, buf, size, map->dir);
+		break;
+	}
+
+	if (unlikely(dma_mapping_error(map->dev, *dma_addr)))
+		return -ENOMEM;
+	return 0;
+}
+
+static void map_benchmark_unmap(struct map_benchmark_data *map, u64 size,
+		struct sg_table *sgt, dma_addr_t dma_addr)
+{
+	switch (map->bparam.map_mode) {
+	case DMA_MAP_SG_MODE:
+		dma_unmap_sgtable(map->dev, sgt, map->dir, 0);
+		break;
+	case DMA_MAP_SWIOTLB_MODE:
+		dma_direct_unmap_page(map->dev, dma_addr, size, map->dir, 0);
+		break;
+	default:
+		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		break;
+	}
+}
+
 static int map_benchmark_thread(void *data)
 {
 	void *buf;
-	dma_addr_t dma_addr;
-	struct map_benchmark_data *map = data;
+	dma_addr_t dma_addr = 0;
+	struct sg_table sgt = {};
+	struct map_benchmark_thread *thread = data;
+	struct map_benchmark_data *map = thread->map;
 	int npages = map->bparam.granule;
 	u64 size = npages * PAGE_SIZE;
+	struct scatterlist *sg;
 	int ret = 0;
+	int i;
 
 	buf = alloc_pages_exact(size, GFP_KERNEL);
 	if (!buf)
 		return -ENOMEM;
 
+	if (map->bparam.map_mode == DMA_MAP_SG_MODE) {
+		ret = sg_alloc_table(&sgt, npages, GFP_KERNEL);
+		if (ret)
+			goto out;
+		for_each_sgtable_sg(&sgt, sg, i)
+			sg_set_buf(sg, buf + i * PAGE_SIZE, PAGE_SIZE);
+	}
+
 	while (!kthread_should_stop())  {
 		u64 map_100ns, unmap_100ns, map_sq, unmap_sq;
 		ktime_t map_stime, map_etime, unmap_stime, unmap_etime;
@@ -59,11 +128,9 @@ static int map_benchmark_thread(void *data)
 			memset(buf, 0x66, size);
 
 		map_stime = ktime_get();
-		dma_addr = dma_map_single(map->dev, buf, size, map->dir);
-		if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
-			pr_err("dma_map_single failed on %s\n",
-				dev_name(map->dev));
-			ret = -ENOMEM;
+		ret = map_benchmark_map(map, buf, size, &sgt, &dma_addr);
+		if (unlikely(ret)) {
+			pr_err("dma map failed on %s\n", dev_name(map->dev));
 			goto out;
 		}
 		map_etime = ktime_get();
@@ -73,7 +140,7 @@ static int map_benchmark_thread(void *data)
 		ndelay(map->bparam.dma_trans_ns);
 
 		unmap_stime = ktime_get();
-		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		map_benchmark_unmap(map, size, &sgt, dma_addr);
 		unmap_etime = ktime_get();
 		unmap_delta = ktime_sub(unmap_etime, unmap_stime);
 
@@ -89,19 +156,46 @@ static int map_benchmark_thread(void *data)
 		atomic64_add(map_sq, &map->sum_sq_map);
 		atomic64_add(unmap_sq, &map->sum_sq_unmap);
 		atomic64_inc(&map->loops);
+
+		thread->map_hist[min_t(u64, map_100ns,
+				       DMA_MAP_HIST_BUCKETS - 1)]++;
+		thread->unmap_hist[min_t(u64, unmap_100ns,
+					 DMA_MAP_HIST_BUCKETS - 1)]++;
 	}
 
 out:
+	sg_free_table(&sgt);
 	free_pages_exact(buf, size);
 	return ret;
 }
 
+/*
+ * Turn the latency histograms of all threads into percentiles, in 100ns.
+ * Latencies in the last bucket are reported as its lower bound.
+ */
+static void map_benchmark_percentiles(struct map_benchmark_thread *threads,
+		int nr, u64 loops, bool unmap, u64 *pct)
+{
+	u64 seen = 0, count;
+	int b, i, p = 0;
+
+	for (b = 0; b < DMA_MAP_HIST_BUCKETS && p < DMA_MAP_NR_PERCENTILES; b++) {
+		for (i = 0, count = 0; i < nr; i++)
+			count += unmap ? threads[i].unmap_hist[b] :
+					 threads[i].map_hist[b];
+		seen += count;
+		while (p < DMA_MAP_NR_PERCENTILES &&
+		       seen * 1000 >= loops * map_benchmark_pct[p])
+			pct[p++] = b;
+	}
+}
+
 static int do_map_benchmark(struct map_benchmark_data *map)
 {
+	struct map_benchmark_thread *data;
 	struct task_struct **tsk;
 	int threads = map->bparam.threads;
 	int node = map->bparam.node;
-	const cpumask_t *cpu_mask = cpumask_of_node(node);
 	u64 loops;
 	int ret = 0;
 	int i;
@@ -110,11 +204,25 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 	if (!tsk)
 		return -ENOMEM;
 
+	data = kvcalloc(threads, sizeof(*data), GFP_KERNEL);
+	if (!data) {
+		kfree(tsk);
+		return -ENOMEM;
+	}
+
 	get_device(map->dev);
 
 	for (i = 0; i < threads; i++) {
-		tsk[i] = kthread_create_on_node(map_benchmark_thread, map,
-				map->bparam.node, "dma-map-benchmark/%d", i);
+		/* round-robin over the online nodes to contend across them */
+		if (map->bparam.flags & DMA_MAP_F_ALL_NODES) {
+			node = i ? next_online_node(node) : first_online_node;
+			if (node == MAX_NUMNODES)
+				node = first_online_node;
+		}
+
+		data[i].map = map;
+		tsk[i] = kthread_create_on_node(map_benchmark_thread, &data[i],
+				node, "dma-map-benchmark/%d", i);
 		if (IS_ERR(tsk[i])) {
 			pr_err("create dma_map thread failed\n");
 			ret = PTR_ERR(tsk[i]);
@@ -122,7 +230,7 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 		}
 
 		if (node != NUMA_NO_NODE)
-			kthread_bind_mask(tsk[i], cpu_mask);
+			kthread_bind_mask(tsk[i], cpumask_of_node(node));
 	}
 
 	/* clear the old value in the previous benchmark */
@@ -167,12 +275,18 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 				map->bparam.avg_unmap_100ns;
 		map->bparam.map_stddev = int_sqrt64(map_variance);
 		map->bparam.unmap_stddev = int_sqrt64(unmap_variance);
+
+		map_benchmark_percentiles(data, threads, loops, false,
+					  map->bparam.map_pct_100ns);
+		map_benchmark_percentiles(data, threads, loops, true,
+					  map->bparam.unmap_pct_100ns);
 	}
 
 out:
 	for (i = 0; i < threads; i++)
 		put_task_struct(tsk[i]);
 	put_device(map->dev);
+	kvfree(data);
 	kfree(tsk);
 	return ret;
 }
@@ -218,6 +332,39 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 			return -EINVAL;
 		}
 
+		if ((map->bparam.flags & ~DMA_MAP_F_ALL_NODES) ||
+		    map->bparam.resv) {
+			pr_err("invalid flags\n");
+			return -EINVAL;
+		}
+
+		if ((map->bparam.flags & DMA_MAP_F_ALL_NODES) &&
+		    map->bparam.node != NUMA_NO_NODE) {
+			pr_err("all nodes mode needs no numa node\n");
+			return -EINVAL;
+		}
+
+		switch (map->bparam.map_mode) {
+		case DMA_MAP_SINGLE_MODE:
+		case DMA_MAP_SG_MODE:
+			break;
+		case DMA_MAP_SWIOTLB_MODE:
+			/* swiotlb_map() below an IOMMU would be meaningless */
+			if (get_dma_ops(map->dev) || !is_swiotlb_active(map->dev)) {
+				pr_err("swiotlb mode needs dma-direct with swiotlb\n");
+				return -EOPNOTSUPP;
+			}
+			if (map->bparam.granule * PAGE_SIZE >
+			    swiotlb_max_mapping_size(map->dev)) {
+				pr_err("granule too large for swiotlb\n");
+				return -EINVAL;
+			}
+			break;
+		default:
+			pr_err("invalid map mode\n");
+			return -EINVAL;
+		}
+
 		switch (map->bparam.dma_dir) {
 		case DMA_MAP_BIDIRECTIONAL:
 			map->dir = DMA_BIDIRECTIONAL;
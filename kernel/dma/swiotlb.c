@@ -34,10 +34,12 @@
 #include <linux/init.h>
 #include <linux/memblock.h>
 #include <linux/mm.h>
+#include <linux/percpu.h>
 #include <linux/pfn.h>
 #include <linux/rculist.h>
 #include <linux/scatterlist.h>
 #include <linux/set_memory.h>
+#include <linux/sizes.h>
 #include <linux/spinlock.h>
 #include <linux/string.h>
 #include <linux/swiotlb.h>
@@ -978,6 +980,272 @@ static void dec_transient_used(struct io_tlb_mem *mem, unsigned int nslots)
 #endif /* CONFIG_DEBUG_FS */
 #endif /* CONFIG_SWIOTLB_DYNAMIC */
 
+/**
+ * swiotlb_free_slots() - return a run of slots to its area
+ * @mem:	Memory pool of the slots.
+ * @index:	Index of the first slot.
+ * @nslots:	Number of slots in the run.
+ */
+static void swiotlb_free_slots(struct io_tlb_pool *mem, int index, int nslots)
+{
+	int aindex = index / mem->area_nslabs;
+	struct io_tlb_area *area = &mem->areas[aindex];
+	unsigned long flags;
+	int count, i;
+
+	/*
+	 * Return the buffer to the free list by setting the corresponding
+	 * entries to indicate the number of contiguous entries available.
+	 * While returning the entries to the free list, we merge the entries
+	 * with slots below and above the pool being returned.
+	 */
+	BUG_ON(aindex >= mem->nareas);
+
+	spin_lock_irqsave(&area->lock, flags);
+	if (index + nslots < ALIGN(index + 1, IO_TLB_SEGSIZE))
+		count = mem->slots[index + nslots].list;
+	else
+		count = 0;
+
+	/*
+	 * Step 1: return the slots to the free list, merging the slots with
+	 * superceeding slots
+	 */
+	for (i = index + nslots - 1; i >= index; i--) {
+		mem->slots[i].list = ++count;
+		mem->slots[i].orig_addr = INVALID_PHYS_ADDR;
+		mem->slots[i].alloc_size = 0;
+	}
+
+	/*
+	 * Step 2: merge the returned slots with the preceding slots, if
+	 * available (non zero)
+	 */
+	for (i = index - 1;
+	     io_tlb_offset(i) != IO_TLB_SEGSIZE - 1 && mem->slots[i].list;
+	     i--)
+		mem->slots[i].list = ++count;
+	area->used -= nslots;
+	spin_unlock_irqrestore(&area->lock, flags);
+}
+
+/*
+ * Compute the alignment required for the first slot of an allocation, and
+ * the bits of the original address that the slot address has to preserve.
+ */
+static void swiotlb_align_masks(struct device *dev, size_t alloc_size,
+		unsigned int *alloc_align_mask, unsigned int *iotlb_align_mask)
+{
+	*iotlb_align_mask = dma_get_min_align_mask(dev);
+
+	/*
+	 * Historically, swiotlb allocations >= PAGE_SIZE were guaranteed to be
+	 * page-aligned in the absence of any other alignment requirements.
+	 * 'alloc_align_mask' was later introduced to specify the alignment
+	 * explicitly, however this is passed as zero for streaming mappings
+	 * and so we preserve the old behaviour there in case any drivers are
+	 * relying on it.
+	 */
+	if (!*alloc_align_mask && !*iotlb_align_mask && alloc_size >= PAGE_SIZE)
+		*alloc_align_mask = PAGE_SIZE - 1;
+
+	/*
+	 * Ensure that the allocation is at least slot-aligned and update
+	 * 'iotlb_align_mask' to ignore bits that will be preserved when
+	 * offsetting into the allocation.
+	 */
+	*alloc_align_mask |= (IO_TLB_SIZE - 1);
+	*iotlb_align_mask &= ~*alloc_align_mask;
+}
+
+/*
+ * Per-CPU cache of slot runs unmapped on that CPU, for the default pool.
+ *
+ * Streaming mappings of a given size tend to be mapped and unmapped at a
+ * high rate on the same CPU (packet buffers, block requests), so instead of
+ * returning such a run to its area, keep it and hand it out again for the
+ * next mapping of the same number of slots. That skips the area lock and
+ * the slot search. Cached slots stay allocated in their area, and all
+ * caches are drained back when an allocation would otherwise fail.
+ */
+#define IO_TLB_PCP_RUNS		8
+#define IO_TLB_PCP_MAX_RUN	(SZ_64K >> IO_TLB_SHIFT)
+#define IO_TLB_PCP_NSLABS	(2 * IO_TLB_PCP_MAX_RUN)
+
+struct io_tlb_pcp_run {
+	unsigned int index;
+	unsigned int nslots;
+};
+
+/**
+ * struct io_tlb_pcp - per-CPU cache of free slot runs
+ * @lock:	Protects the cache, only contended by swiotlb_pcp_drain().
+ * @nr:		Number of cached runs.
+ * @nslabs:	Total number of slots in the cached runs.
+ * @runs:	The cached runs, most recently freed last.
+ */
+struct io_tlb_pcp {
+	spinlock_t lock;
+	unsigned int nr;
+	unsigned int nslabs;
+	struct io_tlb_pcp_run runs[IO_TLB_PCP_RUNS];
+};
+
+static DEFINE_PER_CPU(struct io_tlb_pcp, io_tlb_pcp) = {
+	.lock = __SPIN_LOCK_UNLOCKED(io_tlb_pcp.lock),
+};
+
+/**
+ * swiotlb_pcp_get() - allocate slots from the per-CPU cache
+ * @dev:	Device which maps the buffer.
+ * @orig_addr:	Original (non-bounced) IO buffer address.
+ * @alloc_size: Total requested size of the bounce buffer,
+ *		including initial alignment padding.
+ * @alloc_align_mask:	Required alignment of the allocated buffer.
+ *
+ * Return: Index of the first allocated slot in the default pool, or -1 if
+ * no cached run matches the allocation constraints.
+ */
+static int swiotlb_pcp_get(struct device *dev, phys_addr_t orig_addr,
+		size_t alloc_size, unsigned int alloc_align_mask)
+{
+	struct io_tlb_pool *pool = &io_tlb_default_mem.defpool;
+	unsigned int nslots = nr_slots(alloc_size);
+	unsigned int iotlb_align_mask, offset;
+	unsigned long boundary_mask, max_slots;
+	dma_addr_t tbl_dma_addr;
+	struct io_tlb_pcp *pcp;
+	unsigned long flags;
+	int index = -1;
+	unsigned int i;
+
+	if (dev->dma_io_tlb_mem != &io_tlb_default_mem ||
+	    nslots > IO_TLB_PCP_MAX_RUN)
+		return -1;
+
+	/* a stale CPU only means using another CPU's cache, under its lock */
+	pcp = raw_cpu_ptr(&io_tlb_pcp);
+	if (!READ_ONCE(pcp->nr))
+		return -1;
+
+	boundary_mask = dma_get_seg_boundary(dev);
+	tbl_dma_addr = phys_to_dma_unencrypted(dev, pool->start) & boundary_mask;
+	max_slots = get_max_slots(boundary_mask);
+	offset = swiotlb_align_offset(dev, orig_addr);
+	swiotlb_align_masks(dev, alloc_size, &alloc_align_mask,
+			    &iotlb_align_mask);
+
+	spin_lock_irqsave(&pcp->lock, flags);
+	for (i = pcp->nr; i-- > 0; ) {
+		unsigned int slot_index = pcp->runs[i].index;
+		phys_addr_t tlb_addr = slot_addr(tbl_dma_addr, slot_index);
+
+		if (pcp->runs[i].nslots != nslots)
+			continue;
+		if ((tlb_addr & alloc_align_mask) ||
+		    (orig_addr && (tlb_addr & iotlb_align_mask) !=
+				  (orig_addr & iotlb_align_mask)))
+			continue;
+		if (iommu_is_span_boundary(slot_index, nslots,
+					   nr_slots(tbl_dma_addr), max_slots))
+			continue;
+
+		index = slot_index;
+		pcp->nslabs -= nslots;
+		pcp->runs[i] = pcp->runs[--pcp->nr];
+		break;
+	}
+	spin_unlock_irqrestore(&pcp->lock, flags);
+
+	if (index < 0)
+		return -1;
+
+	for (i = index; i < index + nslots; i++)
+		pool->slots[i].alloc_size = alloc_size - (offset +
+				((i - index) << IO_TLB_SHIFT));
+
+	inc_used_and_hiwater(dev->dma_io_tlb_mem, nslots);
+	return index;
+}
+
+/**
+ * swiotlb_pcp_put() - keep freed slots in the per-CPU cache
+ * @mem:	Memory pool of the slots.
+ * @index:	Index of the first slot.
+ * @nslots:	Number of slots in the run.
+ *
+ * Return: %true if the run was cached, %false if it must be freed.
+ */
+static bool swiotlb_pcp_put(struct io_tlb_pool *mem, int index, int nslots)
+{
+	struct io_tlb_pcp *pcp;
+	unsigned long flags;
+	bool cached = false;
+	int i;
+
+	if (mem != &io_tlb_default_mem.defpool || nslots > IO_TLB_PCP_MAX_RUN)
+		return false;
+
+	/* don't let the caches hold more than a quarter of a small pool */
+	if (nr_cpu_ids * IO_TLB_PCP_NSLABS > mem->nslabs / 4)
+		return false;
+
+	for (i = index; i < index + nslots; i++) {
+		mem->slots[i].orig_addr = INVALID_PHYS_ADDR;
+		mem->slots[i].alloc_size = 0;
+	}
+
+	pcp = raw_cpu_ptr(&io_tlb_pcp);
+	spin_lock_irqsave(&pcp->lock, flags);
+	if (pcp->nr < IO_TLB_PCP_RUNS &&
+	    pcp->nslabs + nslots <= IO_TLB_PCP_NSLABS) {
+		pcp->runs[pcp->nr].index = index;
+		pcp->runs[pcp->nr].nslots = nslots;
+		pcp->nr++;
+		pcp->nslabs += nslots;
+		cached = true;
+	}
+	spin_unlock_irqrestore(&pcp->lock, flags);
+
+	return cached;
+}
+
+/**
+ * swiotlb_pcp_drain() - return all cached runs to their areas
+ * @mem:	Software IO TLB descriptor an allocation failed in.
+ *
+ * Return: %true if any slots were returned, so a retry may succeed.
+ */
+static bool swiotlb_pcp_drain(struct io_tlb_mem *mem)
+{
+	struct io_tlb_pcp_run run;
+	struct io_tlb_pcp *pcp;
+	unsigned long flags;
+	bool drained = false;
+	int cpu;
+
+	if (mem != &io_tlb_default_mem)
+		return false;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(&io_tlb_pcp, cpu);
+		if (!READ_ONCE(pcp->nr))
+			continue;
+
+		spin_lock_irqsave(&pcp->lock, flags);
+		while (pcp->nr) {
+			run = pcp->runs[--pcp->nr];
+			swiotlb_free_slots(&mem->defpool, run.index,
+					   run.nslots);
+			drained = true;
+		}
+		pcp->nslabs = 0;
+		spin_unlock_irqrestore(&pcp->lock, flags);
+	}
+
+	return drained;
+}
+
 /**
  * swiotlb_search_pool_area() - search one memory area in one pool
  * @dev:	Device which maps the buffer.
@@ -1003,7 +1271,7 @@ static int swiotlb_search_pool_area(struct device *dev, struct io_tlb_pool *pool
 	dma_addr_t tbl_dma_addr =
 		phys_to_dma_unencrypted(dev, pool->start) & boundary_mask;
 	unsigned long max_slots = get_max_slots(boundary_mask);
-	unsigned int iotlb_align_mask = dma_get_min_align_mask(dev);
+	unsigned int iotlb_align_mask;
 	unsigned int nslots = nr_slots(alloc_size), stride;
 	unsigned int offset = swiotlb_align_offset(dev, orig_addr);
 	unsigned int index, slots_checked, count = 0, i;
@@ -1014,24 +1282,8 @@ static int swiotlb_search_pool_area(struct device *dev, struct io_tlb_pool *pool
 	BUG_ON(!nslots);
 	BUG_ON(area_index >= pool->nareas);
 
-	/*
-	 * Historically, swiotlb allocations >= PAGE_SIZE were guaranteed to be
-	 * page-aligned in the absence of any other alignment requirements.
-	 * 'alloc_align_mask' was later introduced to specify the alignment
-	 * explicitly, however this is passed as zero for streaming mappings
-	 * and so we preserve the old behaviour there in case any drivers are
-	 * relying on it.
-	 */
-	if (!alloc_align_mask && !iotlb_align_mask && alloc_size >= PAGE_SIZE)
-		alloc_align_mask = PAGE_SIZE - 1;
-
-	/*
-	 * Ensure that the allocation is at least slot-aligned and update
-	 * 'iotlb_align_mask' to ignore bits that will be preserved when
-	 * offsetting into the allocation.
-	 */
-	alloc_align_mask |= (IO_TLB_SIZE - 1);
-	iotlb_align_mask &= ~alloc_align_mask;
+	swiotlb_align_masks(dev, alloc_size, &alloc_align_mask,
+			    &iotlb_align_mask);
 
 	/*
 	 * For mappings with an alignment requirement don't bother looping to
@@ -1174,6 +1426,12 @@ static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
 	if (alloc_size > IO_TLB_SEGSIZE * IO_TLB_SIZE)
 		return -1;
 
+	index = swiotlb_pcp_get(dev, orig_addr, alloc_size, alloc_align_mask);
+	if (index >= 0) {
+		pool = &mem->defpool;
+		goto found;
+	}
+
 	cpu = raw_smp_processor_id();
 	for (i = 0; i < default_nareas; ++i) {
 		index = swiotlb_search_area(dev, cpu, i, orig_addr, alloc_size,
@@ -1244,6 +1502,10 @@ static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
 	int index;
 
 	*retpool = pool = &dev->dma_io_tlb_mem->defpool;
+	index = swiotlb_pcp_get(dev, orig_addr, alloc_size, alloc_align_mask);
+	if (index >= 0)
+		return index;
+
 	i = start = raw_smp_processor_id() & (pool->nareas - 1);
 	do {
 		index = swiotlb_search_pool_area(dev, pool, i, orig_addr,
@@ -1351,6 +1613,9 @@ phys_addr_t swiotlb_tbl_map_single(struct device *dev, phys_addr_t orig_addr,
 
 	index = swiotlb_find_slots(dev, orig_addr,
 				   alloc_size + offset, alloc_align_mask, &pool);
+	if (index == -1 && swiotlb_pcp_drain(mem))
+		index = swiotlb_find_slots(dev, orig_addr, alloc_size + offset,
+					   alloc_align_mask, &pool);
 	if (index == -1) {
 		if (!(attrs & DMA_ATTR_NO_WARN))
 			dev_warn_ratelimited(dev,
@@ -1383,50 +1648,14 @@ phys_addr_t swiotlb_tbl_map_single(struct device *dev, phys_addr_t orig_addr,
 static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr)
 {
 	struct io_tlb_pool *mem = swiotlb_find_pool(dev, tlb_addr);
-	unsigned long flags;
 	unsigned int offset = swiotlb_align_offset(dev, tlb_addr);
 	int index = (tlb_addr - offset - mem->start) >> IO_TLB_SHIFT;
 	int nslots = nr_slots(mem->slots[index].alloc_size + offset);
-	int aindex = index / mem->area_nslabs;
-	struct io_tlb_area *area = &mem->areas[aindex];
-	int count, i;
-
-	/*
-	 * Return the buffer to the free list by setting the corresponding
-	 * entries to indicate the number of contiguous entries available.
-	 * While returning the entries to the free list, we merge the entries
-	 * with slots below and above the pool being returned.
-	 */
-	BUG_ON(aindex >= mem->nareas);
-
-	spin_lock_irqsave(&area->lock, flags);
-	if (index + nslots < ALIGN(index + 1, IO_TLB_SEGSIZE))
-		count = mem->slots[index + nslots].list;
-	else
-		count = 0;
-
-	/*
-	 * Step 1: return the slots to the free list, merging the slots with
-	 * superceeding slots
-	 */
-	for (i = index + nslots - 1; i >= index; i--) {
-		mem->slots[i].list = ++count;
-		mem->slots[i].orig_addr = INVALID_PHYS_ADDR;
-		mem->slots[i].alloc_size = 0;
-	}
-
-	/*
-	 * Step 2: merge the returned slots with the preceding slots, if
-	 * available (non zero)
-	 */
-	for (i = index - 1;
-	     io_tlb_offset(i) != IO_TLB_SEGSIZE - 1 && mem->slots[i].list;
-	     i--)
-		mem->slots[i].list = ++count;
-	area->used -= nslots;
-	spin_unlock_irqrestore(&area->lock, flags);
 
 	dec_used(dev->dma_io_tlb_mem, nslots);
+	if (swiotlb_pcp_put(mem, index, nslots))
+		return;
+	swiotlb_free_slots(mem, index, nslots);
 }
 
 #ifdef CONFIG_SWIOTLB_DYNAMIC
@@ -25,6 +25,8 @@ struct ipi_mux_cpu {
 static struct ipi_mux_cpu __percpu *ipi_mux_pcpu;
 static struct irq_domain *ipi_mux_domain;
 static void (*ipi_mux_send)(unsigned int cpu);
+static void (*ipi_mux_send_many)(const struct cpumask *mask);
+static DEFINE_PER_CPU(struct cpumask, ipi_mux_targets);
 
 static void ipi_mux_mask(struct irq_data *d)
 {
@@ -55,9 +57,21 @@ static void ipi_mux_send_mask(struct irq_data *d, const struct cpumask *mask)
 {
 	struct ipi_mux_cpu *icpu = this_cpu_ptr(ipi_mux_pcpu);
 	u32 ibit = BIT(irqd_to_hwirq(d));
-	unsigned long pending;
+	struct cpumask *targets = NULL;
+	unsigned long pending, flags;
 	int cpu;
 
+	/*
+	 * Collect the CPUs which need a parent IPI and raise it for all of
+	 * them at once. Interrupts are off so that an IPI sent from an
+	 * interrupt can't clobber this CPU's target mask.
+	 */
+	if (ipi_mux_send_many) {
+		local_irq_save(flags);
+		targets = this_cpu_ptr(&ipi_mux_targets);
+		cpumask_clear(targets);
+	}
+
 	for_each_cpu(cpu, mask) {
 		icpu = per_cpu_ptr(ipi_mux_pcpu, cpu);
 
@@ -83,8 +97,18 @@ static void ipi_mux_send_mask(struct irq_data *d, const struct cpumask *mask)
 		 * dependency on the result of atomic_read() below, which is
 		 * itself already ordered after the vIPI flag write.
 		 */
-		if (!(pending & ibit) && (atomic_read(&icpu->enable) & ibit))
-			ipi_mux_send(cpu);
+		if (!(pending & ibit) && (atomic_read(&icpu->enable) & ibit)) {
+			if (targets)
+				__cpumask_set_cpu(cpu, targets);
+			else
+				ipi_mux_send(cpu);
+		}
+	}
+
+	if (targets) {
+		if (!cpumask_empty(targets))
+			ipi_mux_send_many(targets);
+		local_irq_restore(flags);
 	}
 }
 
@@ -142,16 +166,20 @@ void ipi_mux_process(void)
 }
 
 /**
- * ipi_mux_create - Create virtual IPIs multiplexed on top of a single
- * parent IPI.
+ * ipi_mux_create_mask - Create virtual IPIs multiplexed on top of a single
+ * parent IPI which can be raised on several CPUs at once.
  * @nr_ipi:		number of virtual IPIs to create. This should
  *			be <= BITS_PER_TYPE(int)
  * @mux_send:		callback to trigger parent IPI for a particular CPU
+ * @mux_send_mask:	optional callback to trigger parent IPI for a mask
+ *			of CPUs
  *
  * Returns first virq of the newly created virtual IPIs upon success
  * or <=0 upon failure
  */
-int ipi_mux_create(unsigned int nr_ipi, void (*mux_send)(unsigned int cpu))
+int ipi_mux_create_mask(unsigned int nr_ipi,
+			void (*mux_send)(unsigned int cpu),
+			void (*mux_send_mask)(const struct cpumask *mask))
 {
 	struct fwnode_handle *fwnode;
 	struct irq_domain *domain;
@@ -193,6 +221,7 @@ int ipi_mux_create(unsigned int nr_ipi, void (*mux_send)(unsigned int cpu))
 
 	ipi_mux_domain = domain;
 	ipi_mux_send = mux_send;
+	ipi_mux_send_many = mux_send_mask;
 
 	return rc;
 
@@ -195,6 +195,57 @@ static int compare_symbol_name(const char *name, char *namebuf)
 	return strcmp(name, namebuf);
 }
 
+/*
+ * Compare @name with the symbol at @off in the compressed stream, expanding
+ * only as many tokens as needed to tell them apart. Only usable without clang
+ * LTO, where the stored names are the ones kallsyms_seqs_of_names is sorted by.
+ */
+static int kallsyms_compare_symbol(unsigned int off, const char *name)
+{
+	int len, skipped_first = 0;
+	const char *tptr;
+	const u8 *data;
+
+	data = &kallsyms_names[off];
+	len = *data;
+	data++;
+
+	if ((len & 0x80) != 0) {
+		len = (len & 0x7F) | (*data << 7);
+		data++;
+	}
+
+	while (len) {
+		tptr = &kallsyms_token_table[kallsyms_token_index[*data]];
+		data++;
+		len--;
+
+		for (; *tptr; tptr++) {
+			if (!skipped_first) {
+				skipped_first = 1;
+				continue;
+			}
+			if (*name != *tptr)
+				return (unsigned char)*name - (unsigned char)*tptr;
+			name++;
+		}
+	}
+
+	return (unsigned char)*name;
+}
+
+static int compare_symbol_seq(const char *name, unsigned int seq,
+			      char *namebuf)
+{
+	unsigned int off = get_symbol_offset(seq);
+
+	if (!IS_ENABLED(CONFIG_LTO_CLANG))
+		return kallsyms_compare_symbol(off, name);
+
+	kallsyms_expand_symbol(off, namebuf, KSYM_NAME_LEN);
+	return compare_symbol_name(name, namebuf);
+}
+
 static unsigned int get_symbol_seq(int index)
 {
 	unsigned int i, seq = 0;
@@ -211,7 +262,6 @@ static int kallsyms_lookup_names(const char *name,
 {
 	int ret;
 	int low, mid, high;
-	unsigned int seq, off;
 	char namebuf[KSYM_NAME_LEN];
 
 	low = 0;
@@ -219,10 +269,7 @@ static int kallsyms_lookup_names(const char *name,
 
 	while (low <= high) {
 		mid = low + (high - low) / 2;
-		seq = get_symbol_seq(mid);
-		off = get_symbol_offset(seq);
-		kallsyms_expand_symbol(off, namebuf, ARRAY_SIZE(namebuf));
-		ret = compare_symbol_name(name, namebuf);
+		ret = compare_symbol_seq(name, get_symbol_seq(mid), namebuf);
 		if (ret > 0)
 			low = mid + 1;
 		else if (ret < 0)
@@ -236,10 +283,7 @@ static int kallsyms_lookup_names(const char *name,
 
 	low = mid;
 	while (low) {
-		seq = get_symbol_seq(low - 1);
-		off = get_symbol_offset(seq);
-		kallsyms_expand_symbol(off, namebuf, ARRAY_SIZE(namebuf));
-		if (compare_symbol_name(name, namebuf))
+		if (compare_symbol_seq(name, get_symbol_seq(low - 1), namebuf))
 			break;
 		low--;
 	}
@@ -248,10 +292,8 @@ static int kallsyms_lookup_names(const char *name,
 	if (end) {
 		high = mid;
 		while (high < kallsyms_num_syms - 1) {
-			seq = get_symbol_seq(high + 1);
-			off = get_symbol_offset(seq);
-			kallsyms_expand_symbol(off, namebuf, ARRAY_SIZE(namebuf));
-			if (compare_symbol_name(name, namebuf))
+			if (compare_symbol_seq(name, get_symbol_seq(high + 1),
+					       namebuf))
 				break;
 			high++;
 		}
@@ -187,6 +187,41 @@ static void test_perf_kallsyms_lookup_name(void)
 		stat.min, stat.max, div_u64(stat.sum, stat.real_cnt));
 }
 
+static int lookup_addr(void *data, const char *name, unsigned long addr)
+{
+	char namebuf[KSYM_NAME_LEN];
+	struct test_stat *stat = (struct test_stat *)data;
+	u64 t0, t1, t;
+
+	t0 = ktime_get_ns();
+	(void)lookup_symbol_name(addr, namebuf);
+	t1 = ktime_get_ns();
+
+	t = t1 - t0;
+	if (t < stat->min)
+		stat->min = t;
+
+	if (t > stat->max)
+		stat->max = t;
+
+	stat->real_cnt++;
+	stat->sum += t;
+
+	return 0;
+}
+
+static void test_perf_lookup_symbol_name(void)
+{
+	struct test_stat stat;
+
+	memset(&stat, 0, sizeof(stat));
+	stat.min = INT_MAX;
+	kallsyms_on_each_symbol(lookup_addr, &stat);
+	pr_info("lookup_symbol_name() looked up %d addresses\n", stat.real_cnt);
+	pr_info("The time spent on each address is (ns): min=%d, max=%d, avg=%lld\n",
+		stat.min, stat.max, div_u64(stat.sum, stat.real_cnt));
+}
+
 static bool match_cleanup_name(const char *s, const char *name)
 {
 	char *p;
@@ -444,6 +479,7 @@ static int test_entry(void *p)
 
 	test_kallsyms_compression_ratio();
 	test_perf_kallsyms_lookup_name();
+	test_perf_lookup_symbol_name();
 	test_perf_kallsyms_on_each_symbol();
 	test_perf_kallsyms_on_each_match_symbol();
 	pr_info("finish\n");
@@ -484,8 +484,9 @@ void __init padata_do_multithreaded(struct padata_mt_job *job)
 	static const unsigned long load_balance_factor = 4;
 	struct padata_work my_work, *pw;
 	struct padata_mt_job_state ps;
+	const struct cpumask *node_mask;
 	LIST_HEAD(works);
-	int nworks, nid;
+	int nworks, nid, cpu;
 	static atomic_t last_used_nid __initdata;
 
 	if (job->size == 0)
@@ -517,6 +518,14 @@ void __init padata_do_multithreaded(struct padata_mt_job *job)
 	ps.chunk_size = max(ps.chunk_size, job->min_chunk);
 	ps.chunk_size = roundup(ps.chunk_size, job->align);
 
+	/*
+	 * Without numa_aware, the data is assumed to live on the caller's node.
+	 * Spread the helpers over all of its CPUs rather than piling them onto
+	 * the caller's pod, which may only be one LLC of that node.
+	 */
+	node_mask = cpumask_of_node(numa_node_id());
+	cpu = raw_smp_processor_id();
+
 	list_for_each_entry(pw, &works, pw_list)
 		if (job->numa_aware) {
 			int old_node = atomic_read(&last_used_nid);
@@ -526,7 +535,13 @@ void __init padata_do_multithreaded(struct padata_mt_job *job)
 			} while (!atomic_try_cmpxchg(&last_used_nid, &old_node, nid));
 			queue_work_node(nid, system_unbound_wq, &pw->pw_work);
 		} else {
-			queue_work(system_unbound_wq, &pw->pw_work);
+			cpu = cpumask_next(cpu, node_mask);
+			if (cpu >= nr_cpu_ids)
+				cpu = cpumask_first(node_mask);
+			if (cpu_online(cpu))
+				queue_work_on(cpu, system_unbound_wq, &pw->pw_work);
+			else
+				queue_work(system_unbound_wq, &pw->pw_work);
 		}
 
 	/* Use the current thread, which saves starting a workqueue worker. */
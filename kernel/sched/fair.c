@@ -7360,6 +7360,42 @@ static inline int select_idle_smt(struct task_struct *p, struct sched_domain *sd
 
 #endif /* CONFIG_SCHED_SMT */
 
+static inline void set_idle_cluster(int cpu, int val)
+{
+	struct sched_domain_shared *sds;
+
+	sds = rcu_dereference(per_cpu(sd_cluster_shared, cpu));
+	if (sds)
+		WRITE_ONCE(sds->has_idle_cpus, val);
+}
+
+/* Without cluster state, assume there may be idle CPUs and scan. */
+static inline bool test_idle_cluster(int cpu)
+{
+	struct sched_domain_shared *sds;
+
+	sds = rcu_dereference(per_cpu(sd_cluster_shared, cpu));
+	if (sds)
+		return READ_ONCE(sds->has_idle_cpus);
+
+	return true;
+}
+
+/*
+ * Records in sd_cluster_shared->has_idle_cpus that a CPU of the cluster went
+ * idle; select_idle_cpu() clears it when a scan finds none, and skips the
+ * clusters without idle CPUs instead of scanning the whole LLC.
+ */
+void __update_idle_cluster(struct rq *rq)
+{
+	int cpu = cpu_of(rq);
+
+	rcu_read_lock();
+	if (!test_idle_cluster(cpu))
+		set_idle_cluster(cpu, 1);
+	rcu_read_unlock();
+}
+
 /*
  * Scan the LLC domain for idle CPUs; this is dynamically regulated by
  * comparing the average scan cost (tracked in sd->avg_scan_cost) against the
@@ -7387,7 +7423,9 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 	if (static_branch_unlikely(&sched_cluster_active)) {
 		struct sched_group *sg = sd->groups;
 
-		if (sg->flags & SD_CLUSTER) {
+		if (sg->flags & SD_CLUSTER && test_idle_cluster(target)) {
+			bool whole = cpumask_subset(sched_group_span(sg), cpus);
+
 			for_each_cpu_wrap(cpu, sched_group_span(sg), target + 1) {
 				if (!cpumask_test_cpu(cpu, cpus))
 					continue;
@@ -7404,7 +7442,23 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 						return idle_cpu;
 				}
 			}
+
+			/*
+			 * Only a scan not narrowed by the task's affinity tells
+			 * that nothing in the cluster is idle.
+			 */
+			if (whole && idle_cpu == -1)
+				set_idle_cluster(target, 0);
+		}
+
+		if (sg->flags & SD_CLUSTER) {
 			cpumask_andnot(cpus, cpus, sched_group_span(sg));
+
+			/* Leave out the other clusters that have no idle CPU. */
+			for (sg = sg->next; sg != sd->groups; sg = sg->next) {
+				if (!test_idle_cluster(cpumask_first(sched_group_span(sg))))
+					cpumask_andnot(cpus, cpus, sched_group_span(sg));
+			}
 		}
 	}
 
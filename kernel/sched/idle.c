@@ -463,6 +463,7 @@ static void put_prev_task_idle(struct rq *rq, struct task_struct *prev)
 static void set_next_task_idle(struct rq *rq, struct task_struct *next, bool first)
 {
 	update_idle_core(rq);
+	update_idle_cluster(rq);
 	schedstat_inc(rq->sched_goidle);
 }
 
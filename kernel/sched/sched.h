@@ -1888,6 +1888,7 @@ DECLARE_PER_CPU(int, sd_llc_size);
 DECLARE_PER_CPU(int, sd_llc_id);
 DECLARE_PER_CPU(int, sd_share_id);
 DECLARE_PER_CPU(struct sched_domain_shared __rcu *, sd_llc_shared);
+DECLARE_PER_CPU(struct sched_domain_shared __rcu *, sd_cluster_shared);
 DECLARE_PER_CPU(struct sched_domain __rcu *, sd_numa);
 DECLARE_PER_CPU(struct sched_domain __rcu *, sd_asym_packing);
 DECLARE_PER_CPU(struct sched_domain __rcu *, sd_asym_cpucapacity);
@@ -1899,6 +1900,14 @@ static __always_inline bool sched_asym_cpucap_active(void)
 	return static_branch_unlikely(&sched_asym_cpucapacity);
 }
 
+extern void __update_idle_cluster(struct rq *rq);
+
+static inline void update_idle_cluster(struct rq *rq)
+{
+	if (static_branch_unlikely(&sched_cluster_active))
+		__update_idle_cluster(rq);
+}
+
 struct sched_group_capacity {
 	atomic_t		ref;
 	/*
@@ -1973,6 +1982,8 @@ static inline const struct cpumask *task_user_cpus(struct task_struct *p)
 		return cpu_possible_mask; /* &init_task.cpus_mask */
 	return p->user_cpus_ptr;
 }
+#else /* !CONFIG_SMP */
+static inline void update_idle_cluster(struct rq *rq) { }
 #endif /* CONFIG_SMP */
 
 #include "stats.h"
@@ -166,12 +166,18 @@ struct notification {
  * @allow_compat: A bitmap where each bit represents whether the
  *		  filter will always allow the syscall, for the
  *		  compat architecture.
+ * @hits: Syscalls allowed by the bitmaps, without running the filters.
+ * @misses: Syscalls that had to run the filters.
  */
 struct action_cache {
 	DECLARE_BITMAP(allow_native, SECCOMP_ARCH_NATIVE_NR);
 #ifdef SECCOMP_ARCH_COMPAT
 	DECLARE_BITMAP(allow_compat, SECCOMP_ARCH_COMPAT_NR);
 #endif
+#ifdef CONFIG_SECCOMP_CACHE_DEBUG
+	atomic_long_t hits;
+	atomic_long_t misses;
+#endif
 };
 #else
 struct action_cache { };
@@ -236,6 +242,20 @@ struct seccomp_filter {
 	wait_queue_head_t wqh;
 };
 
+#ifdef CONFIG_SECCOMP_CACHE_DEBUG
+/* Accounted on the filter at the top of the list, whose cache covers it all. */
+static inline void seccomp_cache_account(struct seccomp_filter *sfilter,
+					 bool hit)
+{
+	atomic_long_inc(hit ? &sfilter->cache.hits : &sfilter->cache.misses);
+}
+#else
+static inline void seccomp_cache_account(struct seccomp_filter *sfilter,
+					 bool hit)
+{
+}
+#endif /* CONFIG_SECCOMP_CACHE_DEBUG */
+
 /* Limit any path through the tree to 256KB worth of instructions. */
 #define MAX_INSNS_PER_PATH ((1 << 18) / sizeof(struct sock_filter))
 
@@ -415,8 +435,11 @@ static u32 seccomp_run_filters(const struct seccomp_data *sd,
 	if (WARN_ON(f == NULL))
 		return SECCOMP_RET_KILL_PROCESS;
 
-	if (seccomp_cache_check_allow(f, sd))
+	if (seccomp_cache_check_allow(f, sd)) {
+		seccomp_cache_account(f, true);
 		return SECCOMP_RET_ALLOW;
+	}
+	seccomp_cache_account(f, false);
 
 	/*
 	 * All filters in the list are evaluated and the lowest BPF return
@@ -2509,6 +2532,10 @@ int proc_pid_seccomp_cache(struct seq_file *m, struct pid_namespace *ns,
 				    SECCOMP_ARCH_COMPAT_NR);
 #endif /* SECCOMP_ARCH_COMPAT */
 
+	seq_printf(m, "cache_hits %ld\ncache_misses %ld\n",
+		   atomic_long_read(&f->cache.hits),
+		   atomic_long_read(&f->cache.misses));
+
 	__put_seccomp_filter(f);
 	return 0;
 }
@@ -5,10 +5,13 @@
  * Copyright(C) 2022 linutronix GmbH
  */
 #include <linux/cpuhotplug.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/smp.h>
 #include <linux/spinlock.h>
 #include <linux/timerqueue.h>
+#include <linux/topology.h>
 #include <trace/events/ipi.h>
 
 #include "timer_migration.h"
@@ -25,6 +28,12 @@
  * CPUs per node even the next level might be kept as groups of CPU groups
  * per node and only the levels above cross the node topology.
  *
+ * Within a node, a CPU first joins the group of its SMT siblings, then of
+ * its cluster, then of its package, if those have room left. A new
+ * group is attached the same way to the parent of a group holding such
+ * CPUs. Timers of an idle CPU are thus preferably expired by a CPU sharing
+ * caches with it, instead of waking one up in another cluster.
+ *
  * Example topology for a two node system with 24 CPUs each.
  *
  * LVL 2                           [GRP2:0]
@@ -904,8 +913,12 @@ static void tmigr_handle_remote_cpu(unsigned int cpu, u64 now,
 	/* Drop the lock to allow the remote CPU to exit idle */
 	raw_spin_unlock_irq(&tmc->lock);
 
-	if (cpu != smp_processor_id())
+	if (cpu != smp_processor_id()) {
+		this_cpu_inc(tmigr_cpu.remote_expiries);
+		if (!cpumask_test_cpu(cpu, topology_cluster_cpumask(smp_processor_id())))
+			this_cpu_inc(tmigr_cpu.remote_expiries_xcluster);
 		timer_expire_remote(cpu);
+	}
 
 	/*
 	 * Lock ordering needs to be preserved - timer_base locks before tmigr
@@ -1436,6 +1449,32 @@ static void tmigr_init_group(struct tmigr_group *group, unsigned int lvl,
 	group->groupevt.ignore = true;
 }
 
+/*
+ * Find a group of level @lvl with room left, which already holds one of the
+ * CPUs in @mask, directly or through its children.
+ */
+static struct tmigr_group *tmigr_get_topology_group(const struct cpumask *mask,
+						    int node, unsigned int lvl)
+{
+	struct tmigr_group *group;
+	unsigned int sibling;
+
+	for_each_cpu(sibling, mask) {
+		group = per_cpu(tmigr_cpu, sibling).tmgroup;
+		while (group && group->level < lvl)
+			group = group->parent;
+
+		if (!group || group->level != lvl)
+			continue;
+		if (lvl < tmigr_crossnode_level && group->numa_node != node)
+			continue;
+		if (group->num_children < TMIGR_CHILDREN_PER_GROUP)
+			return group;
+	}
+
+	return NULL;
+}
+
 static struct tmigr_group *tmigr_get_group(unsigned int cpu, int node,
 					   unsigned int lvl)
 {
@@ -1443,7 +1482,20 @@ static struct tmigr_group *tmigr_get_group(unsigned int cpu, int node,
 
 	lockdep_assert_held(&tmigr_mutex);
 
-	/* Try to attach to an existing group first */
+	/*
+	 * Prefer the group of the closest CPUs in the topology, so that the
+	 * migrator of an idle CPU shares as many cache levels with it as
+	 * possible.
+	 */
+	group = tmigr_get_topology_group(topology_sibling_cpumask(cpu), node, lvl);
+	if (!group)
+		group = tmigr_get_topology_group(topology_cluster_cpumask(cpu), node, lvl);
+	if (!group)
+		group = tmigr_get_topology_group(topology_core_cpumask(cpu), node, lvl);
+	if (group)
+		return group;
+
+	/* Try to attach to an existing group otherwise */
 	list_for_each_entry(tmp, &tmigr_level_list[lvl], list) {
 		/*
 		 * If @lvl is below the cross NUMA node level, check whether
@@ -1456,13 +1508,6 @@ static struct tmigr_group *tmigr_get_group(unsigned int cpu, int node,
 		if (tmp->num_children >= TMIGR_CHILDREN_PER_GROUP)
 			continue;
 
-		/*
-		 * TODO: A possible further improvement: Make sure that all CPU
-		 * siblings end up in the same group of the lowest level of the
-		 * hierarchy. Rely on the topology sibling mask would be a
-		 * reasonable solution.
-		 */
-
 		group = tmp;
 		break;
 	}
@@ -1778,3 +1823,35 @@ static int __init tmigr_init(void)
 	return ret;
 }
 late_initcall(tmigr_init);
+
+#ifdef CONFIG_DEBUG_FS
+static int tmigr_stats_show(struct seq_file *s, void *data)
+{
+	struct tmigr_cpu *tmc;
+	unsigned int cpu;
+
+	seq_puts(s, "cpu  cluster  remote  xcluster\n");
+	for_each_online_cpu(cpu) {
+		tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+		if (!tmc->tmgroup)
+			continue;
+
+		seq_printf(s, "%3u  %7u  %6lu  %8lu\n", cpu,
+			   cpumask_first(topology_cluster_cpumask(cpu)),
+			   READ_ONCE(tmc->remote_expiries),
+			   READ_ONCE(tmc->remote_expiries_xcluster));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tmigr_stats);
+
+static int __init tmigr_debugfs_init(void)
+{
+	if (num_possible_cpus() > 1)
+		debugfs_create_file("timer_migration", 0444, NULL, NULL,
+				    &tmigr_stats_fops);
+	return 0;
+}
+late_initcall(tmigr_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
@@ -85,6 +85,10 @@ struct tmigr_group {
  *			is returned to timer code in the idle path and is only
  *			used in idle path.
  * @cpuevt:		CPU event which could be enqueued into the parent group
+ * @remote_expiries:	Number of times the CPU expired the timers of another
+ *			idle CPU
+ * @remote_expiries_xcluster: Part of @remote_expiries for CPUs outside of
+ *			the cluster of the CPU
  */
 struct tmigr_cpu {
 	raw_spinlock_t		lock;
@@ -95,6 +99,8 @@ struct tmigr_cpu {
 	u8			childmask;
 	u64			wakeup;
 	struct tmigr_event	cpuevt;
+	unsigned long		remote_expiries;
+	unsigned long		remote_expiries_xcluster;
 };
 
 /**
@@ -1,9 +1,12 @@
 // SPDX-License-Identifier: GPL-2.0+
 /*
- * Test cases csum_partial, csum_fold, ip_fast_csum, csum_ipv6_magic
+ * Test cases csum_partial, csum_partial_copy_nocheck, csum_fold, ip_fast_csum,
+ * csum_ipv6_magic
  */
 
 #include <kunit/test.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
 #include <asm/checksum.h>
 #include <net/ip6_checksum.h>
 
@@ -575,6 +578,66 @@ static void test_csum_no_carry_inputs(struct kunit *test)
 	}
 }
 
+/*
+ * The copy must be exact and the checksum must match csum_partial() on the
+ * copied data, whatever the source and destination alignment.
+ */
+static void test_csum_partial_copy_nocheck(struct kunit *test)
+{
+	static u8 dst_buf[TEST_BUFLEN];
+	int len, align;
+	__wsum result, expec;
+
+	assert_setup_correct(test);
+	memcpy(tmp_buf, random_buf, MAX_LEN);
+	for (align = 0; align < MAX_ALIGN; ++align) {
+		for (len = 0; len < MAX_LEN; ++len) {
+			memset(dst_buf, 0, TEST_BUFLEN);
+			result = csum_partial_copy_nocheck(tmp_buf, &dst_buf[align], len);
+			expec = csum_partial(tmp_buf, len, 0);
+			CHECK_EQ(csum_fold(result), csum_fold(expec));
+			KUNIT_ASSERT_EQ(test, memcmp(&dst_buf[align], tmp_buf, len), 0);
+		}
+	}
+}
+
+#define CSUM_BENCH_LEN 1500
+#define CSUM_BENCH_ITERS 10000
+
+/*
+ * Not a correctness test: report the throughput of csum_partial() and of
+ * csum_partial_copy_nocheck() on an MTU sized packet.
+ */
+static void benchmark_csum_partial(struct kunit *test)
+{
+	u8 *src, *dst;
+	__wsum sum = 0;
+	u64 start, ns;
+	int i;
+
+	src = kunit_kmalloc(test, CSUM_BENCH_LEN, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, src);
+	dst = kunit_kmalloc(test, CSUM_BENCH_LEN, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, dst);
+	memset(src, 0x5a, CSUM_BENCH_LEN);
+
+	start = ktime_get_ns();
+	for (i = 0; i < CSUM_BENCH_ITERS; i++)
+		sum = csum_partial(src, CSUM_BENCH_LEN, sum);
+	ns = ktime_get_ns() - start;
+	kunit_info(test, "csum_partial: %llu MB/s\n",
+		   div64_u64((u64)CSUM_BENCH_LEN * CSUM_BENCH_ITERS * 1000, ns ?: 1));
+
+	start = ktime_get_ns();
+	for (i = 0; i < CSUM_BENCH_ITERS; i++)
+		sum = csum_add(sum, csum_partial_copy_nocheck(src, dst, CSUM_BENCH_LEN));
+	ns = ktime_get_ns() - start;
+	/* Print the sum as well so the loops can't be optimised away */
+	kunit_info(test, "csum_partial_copy_nocheck: %llu MB/s (sum %04x)\n",
+		   div64_u64((u64)CSUM_BENCH_LEN * CSUM_BENCH_ITERS * 1000, ns ?: 1),
+		   (__force u16)csum_fold(sum));
+}
+
 static void test_ip_fast_csum(struct kunit *test)
 {
 	__sum16 csum_result;
@@ -625,8 +688,10 @@ static struct kunit_case __refdata checksum_test_cases[] = {
 	KUNIT_CASE(test_csum_fixed_random_inputs),
 	KUNIT_CASE(test_csum_all_carry_inputs),
 	KUNIT_CASE(test_csum_no_carry_inputs),
+	KUNIT_CASE(test_csum_partial_copy_nocheck),
 	KUNIT_CASE(test_ip_fast_csum),
 	KUNIT_CASE(test_csum_ipv6_magic),
+	KUNIT_CASE_SLOW(benchmark_csum_partial),
 	{}
 };
 
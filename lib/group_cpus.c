@@ -114,6 +114,37 @@ static int ncpus_cmp_func(const void *l, const void *r)
 	return ln->ncpus - rn->ncpus;
 }
 
+/*
+ * Turn the ncpus of the @nr entries of @grps into their share of @numgrps,
+ * as explained in alloc_nodes_groups(). Unused entries have ncpus UINT_MAX.
+ */
+static void assign_groups(struct node_groups *grps, unsigned int nr,
+			  unsigned int numgrps, unsigned int remaining_ncpus)
+{
+	unsigned int n;
+
+	sort(grps, nr, sizeof(grps[0]), ncpus_cmp_func, NULL);
+
+	for (n = 0; n < nr; n++) {
+		unsigned int ngroups, ncpus;
+
+		if (grps[n].ncpus == UINT_MAX)
+			continue;
+
+		WARN_ON_ONCE(numgrps == 0);
+
+		ncpus = grps[n].ncpus;
+		ngroups = max_t(unsigned int, 1,
+				 numgrps * ncpus / remaining_ncpus);
+		WARN_ON_ONCE(ngroups > ncpus);
+
+		grps[n].ngroups = ngroups;
+
+		remaining_ncpus -= ncpus;
+		numgrps -= ngroups;
+	}
+}
+
 /*
  * Allocate group number for each node, so that for each node:
  *
@@ -155,9 +186,6 @@ static void alloc_nodes_groups(unsigned int numgrps,
 
 	numgrps = min_t(unsigned, remaining_ncpus, numgrps);
 
-	sort(node_groups, nr_node_ids, sizeof(node_groups[0]),
-	     ncpus_cmp_func, NULL);
-
 	/*
 	 * Allocate groups for each node according to the ratio of this
 	 * node's nr_cpus to remaining un-assigned ncpus. 'numgrps' is
@@ -226,36 +254,103 @@ static void alloc_nodes_groups(unsigned int numgrps,
 	 * finally for each node X: grps(X) <= ncpu(X).
 	 *
 	 */
-	for (n = 0; n < nr_node_ids; n++) {
-		unsigned ngroups, ncpus;
+	assign_groups(node_groups, nr_node_ids, numgrps, remaining_ncpus);
+}
 
-		if (node_groups[n].ncpus == UINT_MAX)
-			continue;
+/* Spread @ngroups groups evenly over the @ncpus CPUs in @msk */
+static void spread_groups(struct cpumask *masks, struct cpumask *msk,
+			  unsigned int ncpus, unsigned int ngroups,
+			  unsigned int *curgrp, unsigned int last_grp)
+{
+	unsigned int v, cpus_per_grp, extra_grps;
 
-		WARN_ON_ONCE(numgrps == 0);
+	/* Account for rounding errors */
+	extra_grps = ncpus - ngroups * (ncpus / ngroups);
 
-		ncpus = node_groups[n].ncpus;
-		ngroups = max_t(unsigned, 1,
-				 numgrps * ncpus / remaining_ncpus);
-		WARN_ON_ONCE(ngroups > ncpus);
+	for (v = 0; v < ngroups; v++, (*curgrp)++) {
+		cpus_per_grp = ncpus / ngroups;
 
-		node_groups[n].ngroups = ngroups;
+		/* Account for extra groups to compensate rounding errors */
+		if (extra_grps) {
+			cpus_per_grp++;
+			--extra_grps;
+		}
 
-		remaining_ncpus -= ncpus;
-		numgrps -= ngroups;
+		/*
+		 * wrapping has to be considered given 'startgrp'
+		 * may start anywhere
+		 */
+		if (*curgrp >= last_grp)
+			*curgrp = 0;
+		grp_spread_init_one(&masks[*curgrp], msk, cpus_per_grp);
 	}
 }
 
+/*
+ * If a node has at least as many groups as clusters (CPUs sharing an L2 or
+ * similar), split its groups over the clusters the same way they are split
+ * over nodes, so that no group, and thus no queue and its interrupt, spans
+ * two clusters. Returns false to leave the node to spread_groups().
+ */
+static bool spread_node_clusters(struct cpumask *masks, struct cpumask *nmsk,
+				 struct cpumask *cmsk, unsigned int ncpus,
+				 unsigned int ngroups, unsigned int *curgrp,
+				 unsigned int last_grp)
+{
+	unsigned int i, nclusters = 0;
+	struct node_groups *cl;
+	int cpu;
+
+	if (!cmsk)
+		return false;
+
+	cpumask_copy(cmsk, nmsk);
+	while ((cpu = cpumask_first(cmsk)) < nr_cpu_ids) {
+		cpumask_andnot(cmsk, cmsk, topology_cluster_cpumask(cpu));
+		nclusters++;
+	}
+
+	if (nclusters < 2 || ngroups < nclusters)
+		return false;
+
+	cl = kcalloc(nclusters, sizeof(*cl), GFP_KERNEL);
+	if (!cl)
+		return false;
+
+	cpumask_copy(cmsk, nmsk);
+	for (i = 0; i < nclusters; i++) {
+		cpu = cpumask_first(cmsk);
+		cl[i].id = cpu;
+		cl[i].ncpus = cpumask_weight_and(cmsk,
+						 topology_cluster_cpumask(cpu));
+		cpumask_andnot(cmsk, cmsk, topology_cluster_cpumask(cpu));
+	}
+
+	assign_groups(cl, nclusters, ngroups, ncpus);
+
+	for (i = 0; i < nclusters; i++) {
+		cpumask_and(cmsk, nmsk, topology_cluster_cpumask(cl[i].id));
+		spread_groups(masks, cmsk, cpumask_weight(cmsk), cl[i].ngroups,
+			      curgrp, last_grp);
+	}
+	cpumask_clear(nmsk);
+
+	kfree(cl);
+	return true;
+}
+
 static int __group_cpus_evenly(unsigned int startgrp, unsigned int numgrps,
 			       cpumask_var_t *node_to_cpumask,
 			       const struct cpumask *cpu_mask,
 			       struct cpumask *nmsk, struct cpumask *masks)
 {
-	unsigned int i, n, nodes, cpus_per_grp, extra_grps, done = 0;
+	unsigned int i, n, nodes, done = 0;
 	unsigned int last_grp = numgrps;
 	unsigned int curgrp = startgrp;
 	nodemask_t nodemsk = NODE_MASK_NONE;
 	struct node_groups *node_groups;
+	cpumask_var_t cmsk;
+	bool have_cmsk;
 
 	if (cpumask_empty(cpu_mask))
 		return 0;
@@ -283,11 +378,14 @@ static int __group_cpus_evenly(unsigned int startgrp, unsigned int numgrps,
 	if (!node_groups)
 		return -ENOMEM;
 
+	/* Only needed for cluster aware spreading, which is optional */
+	have_cmsk = zalloc_cpumask_var(&cmsk, GFP_KERNEL);
+
 	/* allocate group number for each node */
 	alloc_nodes_groups(numgrps, node_to_cpumask, cpu_mask,
 			   nodemsk, nmsk, node_groups);
 	for (i = 0; i < nr_node_ids; i++) {
-		unsigned int ncpus, v;
+		unsigned int ncpus;
 		struct node_groups *nv = &node_groups[i];
 
 		if (nv->ngroups == UINT_MAX)
@@ -301,30 +399,15 @@ static int __group_cpus_evenly(unsigned int startgrp, unsigned int numgrps,
 
 		WARN_ON_ONCE(nv->ngroups > ncpus);
 
-		/* Account for rounding errors */
-		extra_grps = ncpus - nv->ngroups * (ncpus / nv->ngroups);
-
 		/* Spread allocated groups on CPUs of the current node */
-		for (v = 0; v < nv->ngroups; v++, curgrp++) {
-			cpus_per_grp = ncpus / nv->ngroups;
-
-			/* Account for extra groups to compensate rounding errors */
-			if (extra_grps) {
-				cpus_per_grp++;
-				--extra_grps;
-			}
-
-			/*
-			 * wrapping has to be considered given 'startgrp'
-			 * may start anywhere
-			 */
-			if (curgrp >= last_grp)
-				curgrp = 0;
-			grp_spread_init_one(&masks[curgrp], nmsk,
-						cpus_per_grp);
-		}
+		if (!spread_node_clusters(masks, nmsk, have_cmsk ? cmsk : NULL,
+					  ncpus, nv->ngroups, &curgrp, last_grp))
+			spread_groups(masks, nmsk, ncpus, nv->ngroups, &curgrp,
+				      last_grp);
 		done += nv->ngroups;
 	}
+	if (have_cmsk)
+		free_cpumask_var(cmsk);
 	kfree(node_groups);
 	return done;
 }
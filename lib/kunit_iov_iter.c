@@ -12,6 +12,7 @@
 #include <linux/mm.h>
 #include <linux/uio.h>
 #include <linux/bvec.h>
+#include <linux/ktime.h>
 #include <kunit/test.h>
 
 MODULE_DESCRIPTION("iov_iter testing");
@@ -756,6 +757,85 @@ static void __init iov_kunit_extract_pages_xarray(struct kunit *test)
 	KUNIT_SUCCEED();
 }
 
+#define IOV_BENCH_SIZE		0x100000
+#define IOV_BENCH_ITERS		100
+
+static void __init iov_kunit_benchmark_report(struct kunit *test,
+					      const char *name, u64 ns)
+{
+	kunit_info(test, "%s: %llu MB/s\n", name,
+		   div64_u64((u64)IOV_BENCH_SIZE * IOV_BENCH_ITERS * 1000,
+			     ns ?: 1));
+}
+
+/*
+ * Not a correctness test: report the throughput of copy_to_iter() and
+ * copy_from_iter() into and out of page sized ITER_KVEC and ITER_BVEC
+ * segments, the shapes the network and NFS receive paths use.
+ */
+static void __init iov_kunit_benchmark_copy(struct kunit *test)
+{
+	struct iov_iter iter;
+	struct bio_vec *bvec;
+	struct kvec *kvec;
+	struct page **spages, **bpages;
+	u8 *scratch, *buffer;
+	size_t npages, copied = 0;
+	u64 start;
+	int i, j;
+
+	npages = IOV_BENCH_SIZE / PAGE_SIZE;
+
+	scratch = iov_kunit_create_buffer(test, &spages, npages);
+	memset(scratch, 0x5a, IOV_BENCH_SIZE);
+	buffer = iov_kunit_create_buffer(test, &bpages, npages);
+
+	kvec = kunit_kcalloc(test, npages, sizeof(*kvec), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, kvec);
+	bvec = kunit_kcalloc(test, npages, sizeof(*bvec), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, bvec);
+
+	for (i = 0; i < npages; i++) {
+		kvec[i].iov_base = buffer + i * PAGE_SIZE;
+		kvec[i].iov_len = PAGE_SIZE;
+		bvec_set_page(&bvec[i], bpages[i], PAGE_SIZE, 0);
+	}
+
+	start = ktime_get_ns();
+	for (j = 0; j < IOV_BENCH_ITERS; j++) {
+		iov_iter_kvec(&iter, READ, kvec, npages, IOV_BENCH_SIZE);
+		copied += copy_to_iter(scratch, IOV_BENCH_SIZE, &iter);
+	}
+	iov_kunit_benchmark_report(test, "copy_to_iter kvec",
+				   ktime_get_ns() - start);
+
+	start = ktime_get_ns();
+	for (j = 0; j < IOV_BENCH_ITERS; j++) {
+		iov_iter_kvec(&iter, WRITE, kvec, npages, IOV_BENCH_SIZE);
+		copied += copy_from_iter(scratch, IOV_BENCH_SIZE, &iter);
+	}
+	iov_kunit_benchmark_report(test, "copy_from_iter kvec",
+				   ktime_get_ns() - start);
+
+	start = ktime_get_ns();
+	for (j = 0; j < IOV_BENCH_ITERS; j++) {
+		iov_iter_bvec(&iter, READ, bvec, npages, IOV_BENCH_SIZE);
+		copied += copy_to_iter(scratch, IOV_BENCH_SIZE, &iter);
+	}
+	iov_kunit_benchmark_report(test, "copy_to_iter bvec",
+				   ktime_get_ns() - start);
+
+	start = ktime_get_ns();
+	for (j = 0; j < IOV_BENCH_ITERS; j++) {
+		iov_iter_bvec(&iter, WRITE, bvec, npages, IOV_BENCH_SIZE);
+		copied += copy_from_iter(scratch, IOV_BENCH_SIZE, &iter);
+	}
+	iov_kunit_benchmark_report(test, "copy_from_iter bvec",
+				   ktime_get_ns() - start);
+
+	KUNIT_EXPECT_EQ(test, copied, 4 * IOV_BENCH_ITERS * IOV_BENCH_SIZE);
+}
+
 static struct kunit_case __refdata iov_kunit_cases[] = {
 	KUNIT_CASE(iov_kunit_copy_to_kvec),
 	KUNIT_CASE(iov_kunit_copy_from_kvec),
@@ -766,6 +846,7 @@ static struct kunit_case __refdata iov_kunit_cases[] = {
 	KUNIT_CASE(iov_kunit_extract_pages_kvec),
 	KUNIT_CASE(iov_kunit_extract_pages_bvec),
 	KUNIT_CASE(iov_kunit_extract_pages_xarray),
+	KUNIT_CASE_SLOW(iov_kunit_benchmark_copy),
 	{}
 };
 
@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * RAID6 recovery algorithms in RISC-V Vector (RVV)
+ *
+ * Originally based on recov_avx2.c and recov_ssse3.c:
+ *
+ * Copyright (C) 2012 Intel Corporation
+ * Author: Jim Kukunas <james.t.kukunas@linux.intel.com>
+ */
+
+#include <linux/raid/pq.h>
+#include "rvv.h"
+
+/*
+ * The multiplications by a constant are done with two table lookups, one
+ * for each nibble of the input bytes, using the 32-byte raid6_vgfmul[]
+ * tables. The V extension mandates VLEN >= 128, so a 16-entry half fits
+ * into a single vector register, from which vrgather.vv picks the products.
+ * Only the 16 first elements of the table registers are ever indexed, so
+ * they are loaded with vl = 16.
+ */
+
+static void raid6_2data_recov_rvv(int disks, size_t bytes, int faila,
+				  int failb, void **ptrs)
+{
+	u8 *p, *q, *dp, *dq;
+	const u8 *pbmul;	/* P multiplier table for B data */
+	const u8 *qmul;		/* Q multiplier table (for both) */
+	unsigned long vl;
+
+	p = (u8 *)ptrs[disks - 2];
+	q = (u8 *)ptrs[disks - 1];
+
+	/*
+	 * Compute syndrome with zero for the missing data pages
+	 * Use the dead data pages as temporary storage for
+	 * delta p and delta q
+	 */
+	dp = (u8 *)ptrs[faila];
+	ptrs[faila] = (void *)raid6_empty_zero_page;
+	ptrs[disks - 2] = dp;
+	dq = (u8 *)ptrs[failb];
+	ptrs[failb] = (void *)raid6_empty_zero_page;
+	ptrs[disks - 1] = dq;
+
+	raid6_call.gen_syndrome(disks, bytes, ptrs);
+
+	/* Restore pointer table */
+	ptrs[faila] = dp;
+	ptrs[failb] = dq;
+	ptrs[disks - 2] = p;
+	ptrs[disks - 1] = q;
+
+	/* Now, pick the proper data tables */
+	pbmul = raid6_vgfmul[raid6_gfexi[failb - faila]];
+	qmul  = raid6_vgfmul[raid6_gfinv[raid6_gfexp[faila] ^ raid6_gfexp[failb]]];
+
+	kernel_vector_begin();
+
+	/*
+	 * v0, v1: qmul
+	 * v2, v3: pbmul
+	 */
+	asm volatile(RVV_ASM("vsetivli x0, 16, e8, m1, ta, ma\n\t"
+			     "vle8.v v0, (%0)\n\t"
+			     "vle8.v v1, (%1)\n\t"
+			     "vle8.v v2, (%2)\n\t"
+			     "vle8.v v3, (%3)")
+		     : : "r" (&qmul[0]), "r" (&qmul[16]),
+			 "r" (&pbmul[0]), "r" (&pbmul[16]));
+
+	while (bytes) {
+		asm volatile(RVV_ASM("vsetvli %0, %1, e8, m1, ta, ma")
+			     : "=&r" (vl) : "r" (bytes));
+		/*
+		 * v4: Q + Qxy
+		 * v6: px = P + Pxy
+		 */
+		asm volatile(RVV_ASM("vle8.v v4, (%0)\n\t"
+				     "vle8.v v5, (%1)\n\t"
+				     "vxor.vv v4, v4, v5\n\t"
+				     "vle8.v v6, (%2)\n\t"
+				     "vle8.v v7, (%3)\n\t"
+				     "vxor.vv v6, v6, v7")
+			     : : "r" (q), "r" (dq), "r" (p), "r" (dp));
+		/* v11: qx = qmul[Q + Qxy] */
+		asm volatile(RVV_ASM("vsrl.vi v8, v4, 4\n\t"
+				     "vand.vi v4, v4, 0xf\n\t"
+				     "vrgather.vv v9, v0, v4\n\t"
+				     "vrgather.vv v10, v1, v8\n\t"
+				     "vxor.vv v11, v9, v10"));
+		/* v9: db = pbmul[px] ^ qx */
+		asm volatile(RVV_ASM("vsrl.vi v8, v6, 4\n\t"
+				     "vand.vi v12, v6, 0xf\n\t"
+				     "vrgather.vv v9, v2, v12\n\t"
+				     "vrgather.vv v10, v3, v8\n\t"
+				     "vxor.vv v9, v9, v10\n\t"
+				     "vxor.vv v9, v9, v11"));
+		/* *dq = db; *dp = db ^ px; */
+		asm volatile(RVV_ASM("vse8.v v9, (%0)\n\t"
+				     "vxor.vv v6, v6, v9\n\t"
+				     "vse8.v v6, (%1)")
+			     : : "r" (dq), "r" (dp) : "memory");
+
+		bytes -= vl;
+		p += vl;
+		q += vl;
+		dp += vl;
+		dq += vl;
+	}
+
+	kernel_vector_end();
+}
+
+static void raid6_datap_recov_rvv(int disks, size_t bytes, int faila,
+				  void **ptrs)
+{
+	u8 *p, *q, *dq;
+	const u8 *qmul;		/* Q multiplier table */
+	unsigned long vl;
+
+	p = (u8 *)ptrs[disks - 2];
+	q = (u8 *)ptrs[disks - 1];
+
+	/*
+	 * Compute syndrome with zero for the missing data page
+	 * Use the dead data page as temporary storage for delta q
+	 */
+	dq = (u8 *)ptrs[faila];
+	ptrs[faila] = (void *)raid6_empty_zero_page;
+	ptrs[disks - 1] = dq;
+
+	raid6_call.gen_syndrome(disks, bytes, ptrs);
+
+	/* Restore pointer table */
+	ptrs[faila] = dq;
+	ptrs[disks - 1] = q;
+
+	/* Now, pick the proper data tables */
+	qmul  = raid6_vgfmul[raid6_gfinv[raid6_gfexp[faila]]];
+
+	kernel_vector_begin();
+
+	/* v0, v1: qmul */
+	asm volatile(RVV_ASM("vsetivli x0, 16, e8, m1, ta, ma\n\t"
+			     "vle8.v v0, (%0)\n\t"
+			     "vle8.v v1, (%1)")
+		     : : "r" (&qmul[0]), "r" (&qmul[16]));
+
+	while (bytes) {
+		asm volatile(RVV_ASM("vsetvli %0, %1, e8, m1, ta, ma")
+			     : "=&r" (vl) : "r" (bytes));
+		/* v9: *dq = qmul[Q + Qxy] */
+		asm volatile(RVV_ASM("vle8.v v4, (%0)\n\t"
+				     "vle8.v v5, (%1)\n\t"
+				     "vxor.vv v4, v4, v5\n\t"
+				     "vsrl.vi v8, v4, 4\n\t"
+				     "vand.vi v4, v4, 0xf\n\t"
+				     "vrgather.vv v9, v0, v4\n\t"
+				     "vrgather.vv v10, v1, v8\n\t"
+				     "vxor.vv v9, v9, v10")
+			     : : "r" (q), "r" (dq));
+		/* *p ^= *dq */
+		asm volatile(RVV_ASM("vse8.v v9, (%0)\n\t"
+				     "vle8.v v6, (%1)\n\t"
+				     "vxor.vv v6, v6, v9\n\t"
+				     "vse8.v v6, (%1)")
+			     : : "r" (dq), "r" (p) : "memory");
+
+		bytes -= vl;
+		p += vl;
+		q += vl;
+		dq += vl;
+	}
+
+	kernel_vector_end();
+}
+
+const struct raid6_recov_calls raid6_recov_rvv = {
+	.data2 = raid6_2data_recov_rvv,
+	.datap = raid6_datap_recov_rvv,
+	.valid = raid6_has_rvv,
+	.name = "rvv",
+	.priority = 1,
+};
@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * RAID6 syndrome calculations in RISC-V Vector (RVV)
+ *
+ * Based on the generic RAID-6 code (int.uc):
+ *
+ * Copyright 2002-2004 H. Peter Anvin
+ */
+
+#include <linux/raid/pq.h>
+#include "rvv.h"
+
+/*
+ * Instead of unrolling the loops by hand like the other SIMD versions, the
+ * x1/x2/x4 variants group 1, 2 or 4 vector registers per operand through
+ * LMUL, which lets the hardware pipeline the byte-wise operations on longer
+ * vectors. The operands are kept in v0 (wp), v4 (wq), v8 (wd), v12 (w2) and
+ * v16 (w1), which are suitably aligned for all three register groupings.
+ *
+ * As with the LoongArch version, the vector register file is not visible to
+ * the compiler, so the values live across separate asm statements between
+ * kernel_vector_begin() and kernel_vector_end().
+ */
+
+#define RAID6_RVV_WRAPPER(_n, _lmul)					\
+static void raid6_rvv ## _n ## _gen_syndrome(int disks, size_t bytes,	\
+					     void **ptrs)		\
+{									\
+	u8 **dptr = (u8 **)ptrs;					\
+	unsigned long vl, d;						\
+	u8 *p, *q;							\
+	int z, z0;							\
+									\
+	z0 = disks - 3;		/* Highest data disk */			\
+	p = dptr[z0+1];		/* XOR parity */			\
+	q = dptr[z0+2];		/* RS syndrome */			\
+									\
+	kernel_vector_begin();						\
+									\
+	for (d = 0; d < bytes; d += vl) {				\
+		asm volatile(RVV_ASM("vsetvli %0, %1, e8, " _lmul ", ta, ma")\
+			     : "=&r" (vl) : "r" (bytes - d));		\
+		/* wq = wp = *(unative_t *)&dptr[z0][d]; */		\
+		asm volatile(RVV_ASM("vle8.v v0, (%0)\n\t"		\
+				     "vmv.v.v v4, v0")			\
+			     : : "r" (&dptr[z0][d]));			\
+		for (z = z0-1; z >= 0; z--) {				\
+			/*						\
+			 * wd = *(unative_t *)&dptr[z][d];		\
+			 * wp ^= wd;					\
+			 * w2 = MASK(wq);				\
+			 * w1 = SHLBYTE(wq);				\
+			 * w2 &= NBYTES(0x1d);				\
+			 * w1 ^= w2;					\
+			 * wq = w1 ^ wd;				\
+			 */						\
+			asm volatile(RVV_ASM("vle8.v v8, (%0)\n\t"	\
+					     "vxor.vv v0, v0, v8\n\t"	\
+					     "vsra.vi v12, v4, 7\n\t"	\
+					     "vsll.vi v16, v4, 1\n\t"	\
+					     "vand.vx v12, v12, %1\n\t"	\
+					     "vxor.vv v16, v16, v12\n\t"\
+					     "vxor.vv v4, v16, v8")	\
+				     : : "r" (&dptr[z][d]), "r" (0x1d));\
+		}							\
+		/* *(unative_t *)&p[d] = wp; *(unative_t *)&q[d] = wq; */\
+		asm volatile(RVV_ASM("vse8.v v0, (%0)\n\t"		\
+				     "vse8.v v4, (%1)")			\
+			     : : "r" (&p[d]), "r" (&q[d]) : "memory");	\
+	}								\
+									\
+	kernel_vector_end();						\
+}									\
+									\
+static void raid6_rvv ## _n ## _xor_syndrome(int disks, int start,	\
+					     int stop, size_t bytes,	\
+					     void **ptrs)		\
+{									\
+	u8 **dptr = (u8 **)ptrs;					\
+	unsigned long vl, d;						\
+	u8 *p, *q;							\
+	int z, z0;							\
+									\
+	z0 = stop;		/* P/Q right side optimization */	\
+	p = dptr[disks-2];	/* XOR parity */			\
+	q = dptr[disks-1];	/* RS syndrome */			\
+									\
+	kernel_vector_begin();						\
+									\
+	for (d = 0; d < bytes; d += vl) {				\
+		asm volatile(RVV_ASM("vsetvli %0, %1, e8, " _lmul ", ta, ma")\
+			     : "=&r" (vl) : "r" (bytes - d));		\
+		/* P/Q data pages */					\
+		asm volatile(RVV_ASM("vle8.v v0, (%0)\n\t"		\
+				     "vmv.v.v v4, v0")			\
+			     : : "r" (&dptr[z0][d]));			\
+		for (z = z0-1; z >= start; z--) {			\
+			asm volatile(RVV_ASM("vle8.v v8, (%0)\n\t"	\
+					     "vxor.vv v0, v0, v8\n\t"	\
+					     "vsra.vi v12, v4, 7\n\t"	\
+					     "vsll.vi v16, v4, 1\n\t"	\
+					     "vand.vx v12, v12, %1\n\t"	\
+					     "vxor.vv v16, v16, v12\n\t"\
+					     "vxor.vv v4, v16, v8")	\
+				     : : "r" (&dptr[z][d]), "r" (0x1d));\
+		}							\
+		/* P/Q left side optimization */			\
+		for (z = start-1; z >= 0; z--) {			\
+			/*						\
+			 * w2 = MASK(wq);				\
+			 * w1 = SHLBYTE(wq);				\
+			 * w2 &= NBYTES(0x1d);				\
+			 * wq = w1 ^ w2;				\
+			 */						\
+			asm volatile(RVV_ASM("vsra.vi v12, v4, 7\n\t"	\
+					     "vsll.vi v16, v4, 1\n\t"	\
+					     "vand.vx v12, v12, %0\n\t"	\
+					     "vxor.vv v4, v16, v12")	\
+				     : : "r" (0x1d));			\
+		}							\
+		/*							\
+		 * *(unative_t *)&p[d] ^= wp;				\
+		 * *(unative_t *)&q[d] ^= wq;				\
+		 */							\
+		asm volatile(RVV_ASM("vle8.v v8, (%0)\n\t"		\
+				     "vxor.vv v0, v0, v8\n\t"		\
+				     "vse8.v v0, (%0)\n\t"		\
+				     "vle8.v v12, (%1)\n\t"		\
+				     "vxor.vv v4, v4, v12\n\t"		\
+				     "vse8.v v4, (%1)")			\
+			     : : "r" (&p[d]), "r" (&q[d]) : "memory");	\
+	}								\
+									\
+	kernel_vector_end();						\
+}									\
+									\
+const struct raid6_calls raid6_rvvx ## _n = {				\
+	raid6_rvv ## _n ## _gen_syndrome,				\
+	raid6_rvv ## _n ## _xor_syndrome,				\
+	raid6_has_rvv,							\
+	"rvvx" #_n,							\
+	0								\
+}
+
+RAID6_RVV_WRAPPER(1, "m1");
+RAID6_RVV_WRAPPER(2, "m2");
+RAID6_RVV_WRAPPER(4, "m4");
@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * raid6/rvv.h
+ *
+ * Definitions common to RISC-V Vector RAID-6 code only
+ */
+
+#ifndef _LIB_RAID6_RVV_H
+#define _LIB_RAID6_RVV_H
+
+#ifdef __KERNEL__
+
+#include <asm/vector.h>
+
+#else /* for user-space testing */
+
+#include <sys/auxv.h>
+
+#ifndef COMPAT_HWCAP_ISA_V
+#define COMPAT_HWCAP_ISA_V	(1 << ('V' - 'A'))
+#endif
+
+#define kernel_vector_begin()
+#define kernel_vector_end()
+
+#define has_vector()	(getauxval(AT_HWCAP) & COMPAT_HWCAP_ISA_V)
+
+#endif /* __KERNEL__ */
+
+/*
+ * The kernel C code is not built with the V extension enabled, so every
+ * inline assembly block has to turn it on for itself.
+ */
+#define RVV_ASM(insns)					\
+	".option	push\n\t"			\
+	".option	arch, +v\n\t"			\
+	insns "\n\t"					\
+	".option	pop\n\t"
+
+static int raid6_has_rvv(void)
+{
+	return has_vector();
+}
+
+#endif /* _LIB_RAID6_RVV_H */
@@ -496,7 +496,8 @@ unsigned long __sbitmap_queue_get_batch(struct sbitmap_queue *sbq, int nr_tags,
 		unsigned int map_depth = __map_depth(sb, index);
 
 		sbitmap_deferred_clear(map);
-		if (map->word == (1UL << (map_depth - 1)) - 1)
+		/* Skip full words without scanning them. */
+		if (map->word == GENMASK(map_depth - 1, 0))
 			goto next;
 
 		nr = find_first_zero_bit(&map->word, map_depth);
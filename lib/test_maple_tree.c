@@ -48,6 +48,7 @@ atomic_t maple_tree_tests_passed;
 /* #define BENCH_FORK */
 /* #define BENCH_MAS_FOR_EACH */
 /* #define BENCH_MAS_PREV */
+/* #define BENCH_BULK_STORE */
 
 #ifdef __KERNEL__
 #define mt_set_non_kernel(x)		do {} while (0)
@@ -1996,6 +1997,68 @@ static noinline void __init check_mas_store_gfp(struct maple_tree *mt)
 	mtree_destroy(&newmt);
 }
 
+#if defined(BENCH_BULK_STORE)
+/*
+ * Build a tree of many small ranges, one store at a time or in bulk mode
+ * with the nodes preallocated by mas_expected_entries().
+ */
+static void __init bulk_store_fill(struct rw_semaphore *mt_lock,
+				   int nr_entries, bool bulk, bool validate)
+{
+	struct maple_tree mt;
+	MA_STATE(mas, &mt, 0, 0);
+	int i, ret;
+
+	mt_init_flags(&mt, MT_FLAGS_ALLOC_RANGE | MT_FLAGS_LOCK_EXTERN);
+	mt_set_external_lock(&mt, mt_lock);
+	down_write(mt_lock);
+	if (bulk) {
+		ret = mas_expected_entries(&mas, nr_entries);
+		MT_BUG_ON(&mt, ret != 0);
+	}
+
+	for (i = 0; i < nr_entries; i++) {
+		mas_set_range(&mas, i * 10, i * 10 + 5);
+		if (bulk)
+			mas_store(&mas, xa_mk_value(i));
+		else
+			mas_store_gfp(&mas, xa_mk_value(i), GFP_KERNEL);
+	}
+
+	if (bulk)
+		mas_destroy(&mas);
+	if (validate)
+		mt_validate(&mt);
+	__mt_destroy(&mt);
+	up_write(mt_lock);
+}
+
+static noinline void __init bench_bulk_store(void)
+{
+	int j, nr_entries = 5000, loops = 200;
+	struct rw_semaphore mt_lock;
+	u64 t0, t1, t2;
+
+	init_rwsem(&mt_lock);
+
+	t0 = ktime_get_ns();
+	for (j = 0; j < loops; j++)
+		bulk_store_fill(&mt_lock, nr_entries, false, false);
+
+	t1 = ktime_get_ns();
+	for (j = 0; j < loops; j++)
+		bulk_store_fill(&mt_lock, nr_entries, true, false);
+	t2 = ktime_get_ns();
+
+	/* Check both trees once, outside the timed loops */
+	bulk_store_fill(&mt_lock, nr_entries, false, true);
+	bulk_store_fill(&mt_lock, nr_entries, true, true);
+
+	pr_info("%d entries: single stores %llu ns, bulk stores %llu ns\n",
+		nr_entries, div_u64(t1 - t0, loops), div_u64(t2 - t1, loops));
+}
+#endif
+
 #if defined(BENCH_FORK)
 static noinline void __init bench_forking(void)
 {
@@ -3688,6 +3751,11 @@ static int __init maple_tree_seed(void)
 	bench_forking();
 	goto skip;
 #endif
+#if defined(BENCH_BULK_STORE)
+#define BENCH
+	bench_bulk_store();
+	goto skip;
+#endif
 #if defined(BENCH_MT_FOR_EACH)
 #define BENCH
 	mt_init_flags(&tree, MT_FLAGS_ALLOC_RANGE);
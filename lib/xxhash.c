@@ -169,6 +169,51 @@ static uint64_t xxh64_merge_round(uint64_t acc, uint64_t val)
 	return acc;
 }
 
+static __always_inline uint64_t xxh64_read(const uint8_t *p, bool aligned)
+{
+	return aligned ? le64_to_cpup((const __le64 *)p) : get_unaligned_le64(p);
+}
+
+static __always_inline const uint8_t *__xxh64_stripes(uint64_t *v,
+		const uint8_t *p, const uint8_t *limit, bool aligned)
+{
+	uint64_t v1 = v[0], v2 = v[1], v3 = v[2], v4 = v[3];
+
+	do {
+		v1 = xxh64_round(v1, xxh64_read(p, aligned));
+		p += 8;
+		v2 = xxh64_round(v2, xxh64_read(p, aligned));
+		p += 8;
+		v3 = xxh64_round(v3, xxh64_read(p, aligned));
+		p += 8;
+		v4 = xxh64_round(v4, xxh64_read(p, aligned));
+		p += 8;
+	} while (p <= limit);
+
+	v[0] = v1;
+	v[1] = v2;
+	v[2] = v3;
+	v[3] = v4;
+
+	return p;
+}
+
+/*
+ * Consume 32 byte stripes up to limit. Without efficient unaligned access
+ * get_unaligned_le64() is eight byte loads, so use plain loads when the
+ * input is aligned, which is the case for the page and block buffers the
+ * filesystems hash.
+ */
+static const uint8_t *xxh64_stripes(uint64_t *v, const uint8_t *p,
+				    const uint8_t *limit)
+{
+	if (!IS_ENABLED(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS) &&
+	    IS_ALIGNED((unsigned long)p, sizeof(uint64_t)))
+		return __xxh64_stripes(v, p, limit, true);
+
+	return __xxh64_stripes(v, p, limit, false);
+}
+
 uint64_t xxh64(const void *input, const size_t len, const uint64_t seed)
 {
 	const uint8_t *p = (const uint8_t *)input;
@@ -177,28 +222,21 @@ uint64_t xxh64(const void *input, const size_t len, const uint64_t seed)
 
 	if (len >= 32) {
 		const uint8_t *const limit = b_end - 32;
-		uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
-		uint64_t v2 = seed + PRIME64_2;
-		uint64_t v3 = seed + 0;
-		uint64_t v4 = seed - PRIME64_1;
-
-		do {
-			v1 = xxh64_round(v1, get_unaligned_le64(p));
-			p += 8;
-			v2 = xxh64_round(v2, get_unaligned_le64(p));
-			p += 8;
-			v3 = xxh64_round(v3, get_unaligned_le64(p));
-			p += 8;
-			v4 = xxh64_round(v4, get_unaligned_le64(p));
-			p += 8;
-		} while (p <= limit);
-
-		h64 = xxh_rotl64(v1, 1) + xxh_rotl64(v2, 7) +
-			xxh_rotl64(v3, 12) + xxh_rotl64(v4, 18);
-		h64 = xxh64_merge_round(h64, v1);
-		h64 = xxh64_merge_round(h64, v2);
-		h64 = xxh64_merge_round(h64, v3);
-		h64 = xxh64_merge_round(h64, v4);
+		uint64_t v[4] = {
+			seed + PRIME64_1 + PRIME64_2,
+			seed + PRIME64_2,
+			seed + 0,
+			seed - PRIME64_1,
+		};
+
+		p = xxh64_stripes(v, p, limit);
+
+		h64 = xxh_rotl64(v[0], 1) + xxh_rotl64(v[1], 7) +
+			xxh_rotl64(v[2], 12) + xxh_rotl64(v[3], 18);
+		h64 = xxh64_merge_round(h64, v[0]);
+		h64 = xxh64_merge_round(h64, v[1]);
+		h64 = xxh64_merge_round(h64, v[2]);
+		h64 = xxh64_merge_round(h64, v[3]);
 
 	} else {
 		h64  = seed + PRIME64_5;
@@ -410,26 +448,14 @@ int xxh64_update(struct xxh64_state *state, const void *input, const size_t len)
 
 	if (p + 32 <= b_end) {
 		const uint8_t *const limit = b_end - 32;
-		uint64_t v1 = state->v1;
-		uint64_t v2 = state->v2;
-		uint64_t v3 = state->v3;
-		uint64_t v4 = state->v4;
+		uint64_t v[4] = { state->v1, state->v2, state->v3, state->v4 };
 
-		do {
-			v1 = xxh64_round(v1, get_unaligned_le64(p));
-			p += 8;
-			v2 = xxh64_round(v2, get_unaligned_le64(p));
-			p += 8;
-			v3 = xxh64_round(v3, get_unaligned_le64(p));
-			p += 8;
-			v4 = xxh64_round(v4, get_unaligned_le64(p));
-			p += 8;
-		} while (p <= limit);
+		p = xxh64_stripes(v, p, limit);
 
-		state->v1 = v1;
-		state->v2 = v2;
-		state->v3 = v3;
-		state->v4 = v4;
+		state->v1 = v[0];
+		state->v2 = v[1];
+		state->v3 = v[2];
+		state->v4 = v[3];
 	}
 
 	if (p < b_end) {
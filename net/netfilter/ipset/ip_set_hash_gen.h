@@ -685,9 +685,7 @@ mtype_resize(struct ip_set *set, bool retried)
 			n = __ipset_dereference(hbucket(orig, i));
 			if (!n)
 				continue;
-			for (j = 0; j < n->pos; j++) {
-				if (!test_bit(j, n->used))
-					continue;
+			for_each_set_bit(j, n->used, n->pos) {
 				data = ahash_data(n, j, dsize);
 				if (SET_ELEM_EXPIRED(set, data))
 					continue;
@@ -751,6 +749,8 @@ mtype_resize(struct ip_set *set, bool retried)
 			}
 		}
 		rcu_read_unlock_bh();
+		/* Let packet processing run between regions of huge sets */
+		cond_resched();
 	}
 
 	/* There can't be any other writer. */
@@ -1188,9 +1188,7 @@ mtype_test_cidrs(struct ip_set *set, struct mtype_elem *d,
 		n = rcu_dereference_bh(hbucket(t, key));
 		if (!n)
 			continue;
-		for (i = 0; i < n->pos; i++) {
-			if (!test_bit(i, n->used))
-				continue;
+		for_each_set_bit(i, n->used, n->pos) {
 			data = ahash_data(n, i, set->dsize);
 			if (!mtype_data_equal(data, d, &multi))
 				continue;
@@ -1244,9 +1242,8 @@ mtype_test(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 		ret = 0;
 		goto out;
 	}
-	for (i = 0; i < n->pos; i++) {
-		if (!test_bit(i, n->used))
-			continue;
+	/* Skip the holes left by deletions a word at a time */
+	for_each_set_bit(i, n->used, n->pos) {
 		data = ahash_data(n, i, set->dsize);
 		if (!mtype_data_equal(data, d, &multi))
 			continue;
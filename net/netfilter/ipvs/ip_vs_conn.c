@@ -469,7 +469,17 @@ static void __ip_vs_conn_put_timer(struct ip_vs_conn *cp)
 {
 	unsigned long t = (cp->flags & IP_VS_CONN_F_ONE_PACKET) ?
 		0 : cp->timeout;
-	mod_timer(&cp->timer, jiffies+t);
+	unsigned long expires = jiffies + t;
+	unsigned long old = READ_ONCE(cp->timer.expires);
+
+	/* Busy connections are put back for every packet, don't requeue
+	 * their timer each time. Expiring up to 1/64 of the timeout early
+	 * is well within the granularity of the timer wheel at such
+	 * timeouts, shorter timeouts after a state change still apply.
+	 */
+	if (!timer_pending(&cp->timer) || time_before(expires, old) ||
+	    time_after_eq(expires, old + (t >> 6)))
+		mod_timer(&cp->timer, expires);
 
 	__ip_vs_conn_put(cp);
 }
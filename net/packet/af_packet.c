@@ -694,27 +694,27 @@ static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 	if (unlikely(pkc->delete_blk_timer))
 		goto out;
 
-	/* We only need to plug the race when the block is partially filled.
-	 * tpacket_rcv:
-	 *		lock(); increment BLOCK_NUM_PKTS; unlock()
-	 *		copy_bits() is in progress ...
-	 *		timer fires on other cpu:
-	 *		we can't retire the current block because copy_bits
-	 *		is in progress.
-	 *
-	 */
-	if (BLOCK_NUM_PKTS(pbd)) {
-		/* Waiting for skb_copy_bits to finish... */
-		write_lock(&pkc->blk_fill_in_prog_lock);
-		write_unlock(&pkc->blk_fill_in_prog_lock);
-	}
-
 	if (pkc->last_kactive_blk_num == pkc->kactive_blk_num) {
 		if (!frozen) {
 			if (!BLOCK_NUM_PKTS(pbd)) {
 				/* An empty block. Just refresh the timer. */
 				goto refresh_timer;
 			}
+			/* We only need to plug the race when we retire a
+			 * partially filled block.
+			 * tpacket_rcv:
+			 *		lock(); increment BLOCK_NUM_PKTS; unlock()
+			 *		copy_bits() is in progress ...
+			 *		timer fires on other cpu:
+			 *		we can't retire the current block because
+			 *		copy_bits is in progress.
+			 *
+			 * A block that is still being filled at line rate
+			 * is only refreshed, so don't stall the producers
+			 * behind the receive queue lock for it.
+			 */
+			write_lock(&pkc->blk_fill_in_prog_lock);
+			write_unlock(&pkc->blk_fill_in_prog_lock);
 			prb_retire_current_block(pkc, po, TP_STATUS_BLK_TMO);
 			if (!prb_dispatch_next_block(pkc, po))
 				goto refresh_timer;
@@ -142,7 +142,7 @@ static void rpcrdma_wc_send(struct ib_cq *cq, struct ib_wc *wc)
 	struct ib_cqe *cqe = wc->wr_cqe;
 	struct rpcrdma_sendctx *sc =
 		container_of(cqe, struct rpcrdma_sendctx, sc_cqe);
-	struct rpcrdma_xprt *r_xprt = cq->cq_context;
+	struct rpcrdma_xprt *r_xprt = sc->sc_xprt;
 
 	/* WARNING: Only wr_cqe and status are reliable at this point */
 	trace_xprtrdma_wc_send(wc, &sc->sc_cid);
@@ -161,7 +161,7 @@ static void rpcrdma_wc_receive(struct ib_cq *cq, struct ib_wc *wc)
 	struct ib_cqe *cqe = wc->wr_cqe;
 	struct rpcrdma_rep *rep = container_of(cqe, struct rpcrdma_rep,
 					       rr_cqe);
-	struct rpcrdma_xprt *r_xprt = cq->cq_context;
+	struct rpcrdma_xprt *r_xprt = rep->rr_rxprt;
 
 	/* WARNING: Only wr_cqe and status are reliable at this point */
 	trace_xprtrdma_wc_receive(wc, &rep->rr_cid);
@@ -336,10 +336,10 @@ static void rpcrdma_ep_destroy(struct kref *kref)
 	}
 
 	if (ep->re_attr.recv_cq)
-		ib_free_cq(ep->re_attr.recv_cq);
+		ib_cq_pool_put(ep->re_attr.recv_cq, ep->re_recv_cqes);
 	ep->re_attr.recv_cq = NULL;
 	if (ep->re_attr.send_cq)
-		ib_free_cq(ep->re_attr.send_cq);
+		ib_cq_pool_put(ep->re_attr.send_cq, ep->re_send_cqes);
 	ep->re_attr.send_cq = NULL;
 
 	if (ep->re_pd)
@@ -407,18 +407,25 @@ static int rpcrdma_ep_create(struct rpcrdma_xprt *r_xprt)
 	ep->re_send_count = ep->re_send_batch;
 	init_waitqueue_head(&ep->re_connect_wait);
 
-	ep->re_attr.send_cq = ib_alloc_cq_any(device, r_xprt,
-					      ep->re_attr.cap.max_send_wr,
-					      IB_POLL_WORKQUEUE);
+	/* Transports share the device's pool of CQs, which are spread
+	 * over its completion vectors and polled in batches. With many
+	 * transports, e.g. nconnect mounts, this keeps the number of
+	 * CQs and polling works down to about one per vector. The
+	 * completion handlers find their transport through their
+	 * ib_cqe, as the CQs have no per-transport context.
+	 */
+	ep->re_send_cqes = ep->re_attr.cap.max_send_wr;
+	ep->re_attr.send_cq = ib_cq_pool_get(device, ep->re_send_cqes, -1,
+					     IB_POLL_WORKQUEUE);
 	if (IS_ERR(ep->re_attr.send_cq)) {
 		rc = PTR_ERR(ep->re_attr.send_cq);
 		ep->re_attr.send_cq = NULL;
 		goto out_destroy;
 	}
 
-	ep->re_attr.recv_cq = ib_alloc_cq_any(device, r_xprt,
-					      ep->re_attr.cap.max_recv_wr,
-					      IB_POLL_WORKQUEUE);
+	ep->re_recv_cqes = ep->re_attr.cap.max_recv_wr;
+	ep->re_attr.recv_cq = ib_cq_pool_get(device, ep->re_recv_cqes, -1,
+					     IB_POLL_WORKQUEUE);
 	if (IS_ERR(ep->re_attr.recv_cq)) {
 		rc = PTR_ERR(ep->re_attr.recv_cq);
 		ep->re_attr.recv_cq = NULL;
@@ -600,8 +607,10 @@ static void rpcrdma_sendctxs_destroy(struct rpcrdma_xprt *r_xprt)
 	buf->rb_sc_ctxs = NULL;
 }
 
-static struct rpcrdma_sendctx *rpcrdma_sendctx_create(struct rpcrdma_ep *ep)
+static struct rpcrdma_sendctx *
+rpcrdma_sendctx_create(struct rpcrdma_xprt *r_xprt)
 {
+	struct rpcrdma_ep *ep = r_xprt->rx_ep;
 	struct rpcrdma_sendctx *sc;
 
 	sc = kzalloc(struct_size(sc, sc_sges, ep->re_attr.cap.max_send_sge),
@@ -610,6 +619,7 @@ static struct rpcrdma_sendctx *rpcrdma_sendctx_create(struct rpcrdma_ep *ep)
 		return NULL;
 
 	sc->sc_cqe.done = rpcrdma_wc_send;
+	sc->sc_xprt = r_xprt;
 	sc->sc_cid.ci_queue_id = ep->re_attr.send_cq->res.id;
 	sc->sc_cid.ci_completion_id =
 		atomic_inc_return(&ep->re_completion_ids);
@@ -634,7 +644,7 @@ static int rpcrdma_sendctxs_create(struct rpcrdma_xprt *r_xprt)
 
 	buf->rb_sc_last = i - 1;
 	for (i = 0; i <= buf->rb_sc_last; i++) {
-		sc = rpcrdma_sendctx_create(r_xprt->rx_ep);
+		sc = rpcrdma_sendctx_create(r_xprt);
 		if (!sc)
 			return -ENOMEM;
 
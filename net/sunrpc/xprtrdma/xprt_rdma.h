@@ -87,6 +87,8 @@ struct rpcrdma_ep {
 	atomic_t		re_receiving;
 	atomic_t		re_force_disconnect;
 	struct ib_qp_init_attr	re_attr;
+	unsigned int		re_send_cqes;	/* taken from the CQ pool */
+	unsigned int		re_recv_cqes;
 	wait_queue_head_t       re_connect_wait;
 	struct rpc_xprt		*re_xprt;
 	struct rpcrdma_connect_private
@@ -225,6 +227,7 @@ struct rpcrdma_req;
 struct rpcrdma_sendctx {
 	struct ib_cqe		sc_cqe;
 	struct rpc_rdma_cid	sc_cid;
+	struct rpcrdma_xprt	*sc_xprt;
 	struct rpcrdma_req	*sc_req;
 	unsigned int		sc_unmap_count;
 	struct ib_sge		sc_sges[];
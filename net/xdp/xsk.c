@@ -225,12 +225,18 @@ static u32 xsk_copy_xdp(void *to, void **from, u32 to_len,
 	}
 }
 
+/* Buffers taken from the fill ring at a time for a multi-buffer packet */
+#define XSK_RCV_BATCH_SIZE	16
+
 static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 {
 	u32 frame_size = xsk_pool_get_rx_frame_size(xs->pool);
 	void *copy_from = xsk_copy_xdp_start(xdp), *copy_to;
+	struct xdp_buff *bufs[XSK_RCV_BATCH_SIZE];
 	u32 from_len, meta_len, rem, num_desc;
-	struct xdp_buff_xsk *xskb;
+	struct xdp_buff_xsk *xskb, *tmp;
+	u32 nb_bufs, i, done = 0;
+	LIST_HEAD(xskbs);
 	struct xdp_buff *xsk_xdp;
 	skb_frag_t *frag;
 
@@ -268,6 +274,32 @@ static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 		return -ENOBUFS;
 	}
 
+	/* Take all the buffers before producing any descriptor: once on the
+	 * RX ring a buffer belongs to userspace, and it could not be given
+	 * back if a later allocation failed.
+	 */
+	while (done < num_desc) {
+		nb_bufs = xp_alloc_batch(xs->pool, bufs,
+					 min_t(u32, num_desc - done,
+					       XSK_RCV_BATCH_SIZE));
+		if (unlikely(!nb_bufs)) {
+			/* Only invalid fill ring entries get us here. */
+			list_for_each_entry_safe(xskb, tmp, &xskbs,
+						 xskb_list_node) {
+				list_del_init(&xskb->xskb_list_node);
+				xp_free(xskb);
+			}
+			xs->rx_dropped++;
+			return -ENOMEM;
+		}
+
+		for (i = 0; i < nb_bufs; i++) {
+			xskb = container_of(bufs[i], struct xdp_buff_xsk, xdp);
+			list_add_tail(&xskb->xskb_list_node, &xskbs);
+		}
+		done += nb_bufs;
+	}
+
 	if (xdp_buff_has_frags(xdp)) {
 		struct skb_shared_info *sinfo;
 
@@ -275,20 +307,23 @@ static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 		frag =  &sinfo->frags[0];
 	}
 
-	do {
+	list_for_each_entry_safe(xskb, tmp, &xskbs, xskb_list_node) {
 		u32 to_len = frame_size + meta_len;
 		u32 copied;
 
-		xsk_xdp = xsk_buff_alloc(xs->pool);
+		list_del_init(&xskb->xskb_list_node);
+		xsk_xdp = &xskb->xdp;
+		xsk_xdp->data = xsk_xdp->data_hard_start + XDP_PACKET_HEADROOM;
+		xsk_xdp->data_meta = xsk_xdp->data;
+		xsk_xdp->flags = 0;
 		copy_to = xsk_xdp->data - meta_len;
 
 		copied = xsk_copy_xdp(copy_to, &copy_from, to_len, &from_len, &frag, rem);
 		rem -= copied;
 
-		xskb = container_of(xsk_xdp, struct xdp_buff_xsk, xdp);
 		__xsk_rcv_zc(xs, xskb, copied - meta_len, rem ? XDP_PKT_CONTD : 0);
 		meta_len = 0;
-	} while (rem);
+	}
 
 	return 0;
 }
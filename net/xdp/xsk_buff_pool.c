@@ -629,33 +629,42 @@ static u32 xp_alloc_reused(struct xsk_buff_pool *pool, struct xdp_buff **xdp, u3
 	return nb_entries;
 }
 
-u32 xp_alloc_batch(struct xsk_buff_pool *pool, struct xdp_buff **xdp, u32 max)
+static void xp_dma_sync_batch_for_device(struct xsk_buff_pool *pool,
+					 struct xdp_buff **xdp, u32 nb_entries)
 {
-	u32 nb_entries1 = 0, nb_entries2;
-
-	if (unlikely(pool->dma_need_sync)) {
-		struct xdp_buff *buff;
+	struct xdp_buff_xsk *xskb;
+	u32 i;
 
-		/* Slow path */
-		buff = xp_alloc(pool);
-		if (buff)
-			*xdp = buff;
-		return !!buff;
+	for (i = 0; i < nb_entries; i++) {
+		xskb = container_of(xdp[i], struct xdp_buff_xsk, xdp);
+		dma_sync_single_range_for_device(pool->dev, xskb->dma, 0,
+						 pool->frame_len,
+						 DMA_BIDIRECTIONAL);
 	}
+}
+
+u32 xp_alloc_batch(struct xsk_buff_pool *pool, struct xdp_buff **xdp, u32 max)
+{
+	u32 nb_entries1 = 0, nb_entries2 = 0;
 
 	if (unlikely(pool->free_list_cnt)) {
 		nb_entries1 = xp_alloc_reused(pool, xdp, max);
 		if (nb_entries1 == max)
-			return nb_entries1;
-
-		max -= nb_entries1;
-		xdp += nb_entries1;
+			goto out;
 	}
 
-	nb_entries2 = xp_alloc_new_from_fq(pool, xdp, max);
+	nb_entries2 = xp_alloc_new_from_fq(pool, xdp + nb_entries1,
+					   max - nb_entries1);
 	if (!nb_entries2)
 		pool->fq->queue_empty_descs++;
 
+out:
+	/* Non-coherent devices still get the whole batch from the fill ring
+	 * in one go, only the cache maintenance is per buffer.
+	 */
+	if (unlikely(pool->dma_need_sync))
+		xp_dma_sync_batch_for_device(pool, xdp, nb_entries1 + nb_entries2);
+
 	return nb_entries1 + nb_entries2;
 }
 EXPORT_SYMBOL(xp_alloc_batch);
@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#ifndef __ASM_INSN_DEF_H
+#define __ASM_INSN_DEF_H
+
+#include <asm/asm.h>
+
+#ifdef __ASSEMBLY__
+
+	.macro insn_i, opcode, func3, rd, rs1, simm12
+	.insn	i \opcode, \func3, \rd, \rs1, \simm12
+	.endm
+
+#define __INSN_I(...)	insn_i __VA_ARGS__
+
+#endif /* __ASSEMBLY__ */
+
+#define INSN_I(opcode, func3, rd, rs1, simm12)			\
+	__INSN_I(RV_##opcode, RV_##func3, RV_##rd,		\
+		 RV_##rs1, RV_##simm12)
+
+#define RV_OPCODE(v)		__ASM_STR(v)
+#define RV_FUNC3(v)		__ASM_STR(v)
+#define RV_SIMM12(v)		__ASM_STR(v)
+#define RV_RD(v)		__ASM_STR(v)
+#define RV_RS1(v)		__ASM_STR(v)
+#define __RV_REG(v)		__ASM_STR(x ## v)
+#define RV___RD(v)		__RV_REG(v)
+#define RV___RS1(v)		__RV_REG(v)
+
+#define RV_OPCODE_OP_IMM	RV_OPCODE(19)
+
+/*
+ * The Zicbop prefetches are ORI hints with rd=x0.  The offset must be a
+ * multiple of 32, as the low five bits of the immediate select the prefetch.
+ */
+#define PREFETCH_R(base, offset)				\
+	INSN_I(OPCODE_OP_IMM, FUNC3(6), __RD(0),		\
+	       RS1(base), SIMM12((((offset) & 0xfe0) | 1)))
+
+#define PREFETCH_W(base, offset)				\
+	INSN_I(OPCODE_OP_IMM, FUNC3(6), __RD(0),		\
+	       RS1(base), SIMM12((((offset) & 0xfe0) | 3)))
+
+#endif /* __ASM_INSN_DEF_H */
@@ -48,6 +48,18 @@ static bool asm_test_bit(long nr, const unsigned long *addr)
 
 	return oldbit;
 }
+#elif defined(__riscv) && defined(__riscv_zbs)
+static bool asm_test_bit(long nr, const unsigned long *addr)
+{
+	unsigned long bit;
+
+	/* bext only uses the low bits of nr, i.e. the bit within the word. */
+	asm volatile("bext %0, %1, %2"
+		     : "=r" (bit)
+		     : "r" (addr[BIT_WORD(nr)]), "r" (nr) : "memory");
+
+	return bit;
+}
 #else
 #define asm_test_bit test_bit
 #endif
@@ -278,6 +278,12 @@ struct function memcpy_functions[] = {
 # define MEMCPY_FN(_fn, _name, _desc) {.name = _name, .desc = _desc, .fn.memcpy = _fn},
 # include "mem-memcpy-x86-64-asm-def.h"
 # undef MEMCPY_FN
+#endif
+
+#ifdef HAVE_ARCH_RISCV64_SUPPORT
+# define MEMCPY_FN(_fn, _name, _desc) {.name = _name, .desc = _desc, .fn.memcpy = _fn},
+# include "mem-memcpy-riscv64-asm-def.h"
+# undef MEMCPY_FN
 #endif
 
 	{ .name = NULL, }
@@ -357,6 +363,12 @@ static const struct function memset_functions[] = {
 # define MEMSET_FN(_fn, _name, _desc) { .name = _name, .desc = _desc, .fn.memset = _fn },
 # include "mem-memset-x86-64-asm-def.h"
 # undef MEMSET_FN
+#endif
+
+#ifdef HAVE_ARCH_RISCV64_SUPPORT
+# define MEMSET_FN(_fn, _name, _desc) { .name = _name, .desc = _desc, .fn.memset = _fn },
+# include "mem-memset-riscv64-asm-def.h"
+# undef MEMSET_FN
 #endif
 
 	{ .name = NULL, }
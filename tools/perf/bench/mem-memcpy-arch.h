@@ -11,3 +11,14 @@
 
 #endif
 
+#ifdef HAVE_ARCH_RISCV64_SUPPORT
+
+#define MEMCPY_FN(fn, name, desc)		\
+	void *fn(void *, const void *, size_t);
+
+#include "mem-memcpy-riscv64-asm-def.h"
+
+#undef MEMCPY_FN
+
+#endif
+
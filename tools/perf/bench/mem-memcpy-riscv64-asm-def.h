@@ -0,0 +1,5 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+MEMCPY_FN(__memcpy,
+	"riscv64-unrolled",
+	"unrolled memcpy() in arch/riscv/lib/memcpy.S")
@@ -11,3 +11,14 @@
 
 #endif
 
+#ifdef HAVE_ARCH_RISCV64_SUPPORT
+
+#define MEMSET_FN(fn, name, desc)		\
+	void *fn(void *, int, size_t);
+
+#include "mem-memset-riscv64-asm-def.h"
+
+#undef MEMSET_FN
+
+#endif
+
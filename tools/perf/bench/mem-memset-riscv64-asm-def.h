@@ -0,0 +1,5 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+MEMSET_FN(__memset,
+	"riscv64-unrolled",
+	"unrolled memset() in arch/riscv/lib/memset.S")
@@ -21,6 +21,19 @@ static char *directions[] = {
 	"FROM_DEVICE",
 };
 
+static char *modes[] = {
+	"SINGLE",
+	"SG",
+	"SWIOTLB",
+};
+
+static void print_percentiles(const char *name, __u64 *pct)
+{
+	printf("%s latency(us) p50:%.1f p90:%.1f p99:%.1f p99.9:%.1f\n",
+	       name, pct[0] / 10.0, pct[1] / 10.0, pct[2] / 10.0,
+	       pct[3] / 10.0);
+}
+
 int main(int argc, char **argv)
 {
 	struct map_benchmark map;
@@ -31,11 +44,13 @@ int main(int argc, char **argv)
 	int bits = 32, xdelay = 0, dir = DMA_MAP_BIDIRECTIONAL;
 	/* default granule 1 PAGESIZE */
 	int granule = 1;
+	/* default dma_map_single(), threads on one node */
+	int mode = DMA_MAP_SINGLE_MODE, flags = 0;
 
 	int cmd = DMA_MAP_BENCHMARK;
 	char *p;
 
-	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:")) != -1) {
+	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:m:a")) != -1) {
 		switch (opt) {
 		case 't':
 			threads = atoi(optarg);
@@ -58,6 +73,12 @@ int main(int argc, char **argv)
 		case 'g':
 			granule = atoi(optarg);
 			break;
+		case 'm':
+			mode = atoi(optarg);
+			break;
+		case 'a':
+			flags |= DMA_MAP_F_ALL_NODES;
+			break;
 		default:
 			return -1;
 		}
@@ -98,6 +119,17 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (mode != DMA_MAP_SINGLE_MODE && mode != DMA_MAP_SG_MODE &&
+			mode != DMA_MAP_SWIOTLB_MODE) {
+		fprintf(stderr, "invalid map mode\n");
+		exit(1);
+	}
+
+	if ((flags & DMA_MAP_F_ALL_NODES) && node != -1) {
+		fprintf(stderr, "-a and -n are exclusive\n");
+		exit(1);
+	}
+
 	fd = open("/sys/kernel/debug/dma_map_benchmark", O_RDWR);
 	if (fd == -1) {
 		perror("open");
@@ -112,6 +144,8 @@ int main(int argc, char **argv)
 	map.dma_dir = dir;
 	map.dma_trans_ns = xdelay;
 	map.granule = granule;
+	map.map_mode = mode;
+	map.flags = flags;
 
 	if (ioctl(fd, cmd, &map)) {
 		perror("ioctl");
@@ -120,10 +154,14 @@ int main(int argc, char **argv)
 
 	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s granule: %d\n",
 			threads, seconds, node, dir[directions], granule);
+	printf("map mode:%s all nodes:%s\n", modes[mode],
+			flags & DMA_MAP_F_ALL_NODES ? "yes" : "no");
 	printf("average map latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_map_100ns/10.0, map.map_stddev/10.0);
 	printf("average unmap latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_unmap_100ns/10.0, map.unmap_stddev/10.0);
+	print_percentiles("map", map.map_pct_100ns);
+	print_percentiles("unmap", map.unmap_pct_100ns);
 
 	return 0;
 }
@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Coalesced MMIO test
+ *
+ * Fill the coalesced MMIO ring from the guest, starting at every possible
+ * ring index, and verify that all writes but the one that doesn't fit are
+ * batched without an exit to userspace.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/sizes.h>
+
+#include "test_util.h"
+#include "kvm_util.h"
+#include "processor.h"
+
+#define MMIO_GPA	(4ull * SZ_1G)
+
+struct kvm_coalesced_io {
+	struct kvm_coalesced_mmio_ring *ring;
+	uint32_t ring_size;
+	uint64_t mmio_gpa;
+	uint64_t *mmio;
+};
+
+static struct kvm_coalesced_io kvm_builtin_io_ring;
+
+static void guest_code(struct kvm_coalesced_io *io)
+{
+	uint32_t i;
+
+	for (;;) {
+		/*
+		 * KVM always leaves one entry free, so the last write doesn't
+		 * fit in the ring and exits to userspace.
+		 */
+		for (i = 0; i < io->ring_size; i++)
+			WRITE_ONCE(*io->mmio, io->mmio_gpa + i);
+
+		GUEST_SYNC(0);
+	}
+}
+
+static void test_coalesced_ring(struct kvm_vcpu *vcpu,
+				struct kvm_coalesced_io *io,
+				uint32_t ring_start)
+{
+	struct kvm_coalesced_mmio_ring *ring = io->ring;
+	struct kvm_run *run = vcpu->run;
+	struct ucall uc;
+	uint32_t i;
+
+	WRITE_ONCE(ring->first, ring_start);
+	WRITE_ONCE(ring->last, ring_start);
+
+	vcpu_run(vcpu);
+	TEST_ASSERT_KVM_EXIT_REASON(vcpu, KVM_EXIT_MMIO);
+	TEST_ASSERT(run->mmio.is_write && run->mmio.phys_addr == io->mmio_gpa &&
+		    run->mmio.len == sizeof(uint64_t) &&
+		    *(uint64_t *)run->mmio.data == io->mmio_gpa + io->ring_size - 1,
+		    "For start = %u, expected exit on write 0x%lx = 0x%lx, got addr = 0x%llx, write = %u, len = %u, data = 0x%lx",
+		    ring_start, io->mmio_gpa, io->mmio_gpa + io->ring_size - 1,
+		    run->mmio.phys_addr, run->mmio.is_write, run->mmio.len,
+		    *(uint64_t *)run->mmio.data);
+
+	TEST_ASSERT_EQ(READ_ONCE(ring->first), ring_start);
+	TEST_ASSERT_EQ(READ_ONCE(ring->last),
+		       (ring_start + io->ring_size - 1) % io->ring_size);
+
+	for (i = 0; i < io->ring_size - 1; i++) {
+		struct kvm_coalesced_mmio *entry;
+
+		entry = &ring->coalesced_mmio[(ring_start + i) % io->ring_size];
+		TEST_ASSERT(entry->phys_addr == io->mmio_gpa &&
+			    entry->len == sizeof(uint64_t) && !entry->pio &&
+			    *(uint64_t *)entry->data == io->mmio_gpa + i,
+			    "For start = %u, entry %u is addr = 0x%llx, len = %u, pio = %u, data = 0x%lx",
+			    ring_start, i, entry->phys_addr, entry->len,
+			    entry->pio, *(uint64_t *)entry->data);
+	}
+
+	vcpu_run(vcpu);
+	TEST_ASSERT_EQ(get_ucall(vcpu, &uc), UCALL_SYNC);
+}
+
+int main(int argc, char *argv[])
+{
+	struct kvm_coalesced_mmio_zone zone;
+	struct kvm_vcpu *vcpu;
+	struct kvm_vm *vm;
+	uint32_t i;
+
+	TEST_REQUIRE(kvm_has_cap(KVM_CAP_COALESCED_MMIO));
+
+	vm = vm_create_with_one_vcpu(&vcpu, guest_code);
+
+	kvm_builtin_io_ring = (struct kvm_coalesced_io) {
+		.ring = (void *)vcpu->run +
+			KVM_COALESCED_MMIO_PAGE_OFFSET * getpagesize(),
+		.ring_size = (getpagesize() - sizeof(struct kvm_coalesced_mmio_ring)) /
+			     sizeof(struct kvm_coalesced_mmio),
+		.mmio_gpa = MMIO_GPA,
+		.mmio = (uint64_t *)MMIO_GPA,
+	};
+
+	virt_map(vm, (uint64_t)kvm_builtin_io_ring.mmio,
+		 kvm_builtin_io_ring.mmio_gpa, 1);
+	sync_global_to_guest(vm, kvm_builtin_io_ring);
+	vcpu_args_set(vcpu, 1, &kvm_builtin_io_ring);
+
+	zone = (struct kvm_coalesced_mmio_zone) {
+		.addr = kvm_builtin_io_ring.mmio_gpa,
+		.size = sizeof(uint64_t),
+	};
+	vm_ioctl(vm, KVM_REGISTER_COALESCED_MMIO, &zone);
+
+	for (i = 0; i < kvm_builtin_io_ring.ring_size; i++)
+		test_coalesced_ring(vcpu, &kvm_builtin_io_ring, i);
+
+	kvm_vm_free(vm);
+	return 0;
+}
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Check that the vDSO answers hwprobe queries for single CPUs and for
+ * CPU sets exactly like the syscall does.
+ */
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/auxv.h>
+
+#include "hwprobe.h"
+#include "../../kselftest.h"
+#include "../../vDSO/parse_vdso.h"
+
+#define NR_KEYS	(RISCV_HWPROBE_KEY_TIME_CSR + 1)
+
+typedef long (*vdso_hwprobe_t)(struct riscv_hwprobe *pairs, size_t pair_count,
+			       size_t cpusetsize, unsigned long *cpus,
+			       unsigned int flags);
+
+static void init_pairs(struct riscv_hwprobe *pairs)
+{
+	for (int i = 0; i < NR_KEYS; i++) {
+		pairs[i].key = i;
+		pairs[i].value = 0;
+	}
+}
+
+static int compare_values(vdso_hwprobe_t vdso_hwprobe, cpu_set_t *cpus)
+{
+	struct riscv_hwprobe sys[NR_KEYS], vdso[NR_KEYS];
+	long sys_ret, vdso_ret;
+
+	init_pairs(sys);
+	init_pairs(vdso);
+
+	sys_ret = riscv_hwprobe(sys, NR_KEYS, sizeof(*cpus), (unsigned long *)cpus, 0);
+	vdso_ret = vdso_hwprobe(vdso, NR_KEYS, sizeof(*cpus), (unsigned long *)cpus, 0);
+
+	if (sys_ret != vdso_ret)
+		return -1;
+
+	return memcmp(sys, vdso, sizeof(sys));
+}
+
+static int compare_which_cpus(vdso_hwprobe_t vdso_hwprobe, cpu_set_t *cpus,
+			      struct riscv_hwprobe *pair)
+{
+	cpu_set_t sys_cpus = *cpus, vdso_cpus = *cpus;
+	long sys_ret, vdso_ret;
+
+	sys_ret = riscv_hwprobe(pair, 1, sizeof(sys_cpus), (unsigned long *)&sys_cpus,
+				RISCV_HWPROBE_WHICH_CPUS);
+	vdso_ret = vdso_hwprobe(pair, 1, sizeof(vdso_cpus), (unsigned long *)&vdso_cpus,
+				RISCV_HWPROBE_WHICH_CPUS);
+
+	if (sys_ret != vdso_ret)
+		return -1;
+
+	return !CPU_EQUAL(&sys_cpus, &vdso_cpus);
+}
+
+int main(int argc, char **argv)
+{
+	struct riscv_hwprobe pairs[NR_KEYS];
+	vdso_hwprobe_t vdso_hwprobe;
+	cpu_set_t online, one;
+	bool values_ok = true, which_ok = true;
+	unsigned long sysinfo_ehdr;
+	int cpu;
+
+	ksft_print_header();
+	ksft_set_plan(3);
+
+	sysinfo_ehdr = getauxval(AT_SYSINFO_EHDR);
+	if (!sysinfo_ehdr)
+		ksft_exit_skip("AT_SYSINFO_EHDR is not present\n");
+
+	vdso_init_from_sysinfo_ehdr(sysinfo_ehdr);
+	vdso_hwprobe = (vdso_hwprobe_t)vdso_sym("LINUX_4.15", "__vdso_riscv_hwprobe");
+	if (!vdso_hwprobe)
+		ksft_exit_skip("__vdso_riscv_hwprobe is not present\n");
+
+	if (sched_getaffinity(0, sizeof(online), &online))
+		ksft_exit_fail_msg("sched_getaffinity() failed\n");
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (!CPU_ISSET(cpu, &online))
+			continue;
+
+		CPU_ZERO(&one);
+		CPU_SET(cpu, &one);
+		if (compare_values(vdso_hwprobe, &one)) {
+			ksft_print_msg("vDSO and syscall answers differ for CPU%d\n", cpu);
+			values_ok = false;
+		}
+	}
+	ksft_test_result(values_ok, "Single CPU answers match the syscall\n");
+
+	ksft_test_result(!compare_values(vdso_hwprobe, &online),
+			 "CPU set answers match the syscall\n");
+
+	init_pairs(pairs);
+	riscv_hwprobe(pairs, NR_KEYS, 0, NULL, 0);
+	for (int i = 0; i < NR_KEYS; i++) {
+		CPU_ZERO(&one);
+		if (compare_which_cpus(vdso_hwprobe, &one, &pairs[i]) ||
+		    compare_which_cpus(vdso_hwprobe, &online, &pairs[i])) {
+			ksft_print_msg("vDSO and syscall CPU sets differ for key %lld\n",
+				       pairs[i].key);
+			which_ok = false;
+		}
+	}
+	ksft_test_result(which_ok, "RISCV_HWPROBE_WHICH_CPUS matches the syscall\n");
+
+	ksft_finished();
+}
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Scalability of path walk on a shared hot dentry: every thread stat()s the
+ * same path, so the dentry reference count is taken and dropped from all
+ * CPUs at once.  With the lockref cmpxchg fast path that doesn't touch the
+ * dentry lock.  This only reports numbers, so it isn't run by default.
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../../kselftest.h"
+
+#define BENCH_PATH	"/usr/bin"
+#define BENCH_SECONDS	2
+
+static volatile bool stop;
+
+struct worker {
+	pthread_t thread;
+	int cpu;
+	unsigned long long ops;
+};
+
+static void *stat_worker(void *arg)
+{
+	struct worker *w = arg;
+	struct stat st;
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(w->cpu, &set);
+	sched_setaffinity(0, sizeof(set), &set);
+
+	while (!stop) {
+		if (stat(BENCH_PATH, &st))
+			return NULL;
+		w->ops++;
+	}
+
+	return NULL;
+}
+
+static int bench(int nr_threads, unsigned long long *ops_per_sec)
+{
+	struct worker *w;
+	unsigned long long ops = 0;
+	int i;
+
+	w = calloc(nr_threads, sizeof(*w));
+	if (!w)
+		return -1;
+
+	stop = false;
+	for (i = 0; i < nr_threads; i++) {
+		w[i].cpu = i;
+		if (pthread_create(&w[i].thread, NULL, stat_worker, &w[i]))
+			break;
+	}
+
+	sleep(BENCH_SECONDS);
+	stop = true;
+
+	nr_threads = i;
+	for (i = 0; i < nr_threads; i++) {
+		pthread_join(w[i].thread, NULL);
+		ops += w[i].ops;
+	}
+	free(w);
+
+	*ops_per_sec = ops / BENCH_SECONDS;
+	return ops ? 0 : -1;
+}
+
+int main(void)
+{
+	long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned long long one, all;
+	struct stat st;
+
+	ksft_print_header();
+
+	if (stat(BENCH_PATH, &st))
+		ksft_exit_skip("%s not found\n", BENCH_PATH);
+
+	ksft_set_plan(2);
+
+	ksft_test_result(!bench(1, &one), "stat() 1 thread: %llu ops/s\n", one);
+	ksft_test_result(!bench(nr_cpus, &all),
+			 "stat() %ld threads: %llu ops/s (%llu%% of linear)\n",
+			 nr_cpus, all, one ? all * 100 / (one * nr_cpus) : 0);
+
+	ksft_finished();
+}
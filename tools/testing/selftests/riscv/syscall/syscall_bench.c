@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Round trip cost of the syscall entry and exit path: a bare ecall of an
+ * invalid syscall number, which returns -ENOSYS without leaving the entry
+ * code, and of getppid(), the cheapest real syscall.  This only reports
+ * numbers, so it isn't run by default.
+ */
+#include <time.h>
+#include <asm/unistd.h>
+
+#include "../../kselftest.h"
+
+#define LOOPS	1000000
+
+static inline long ecall0(long nr)
+{
+	register long a7 asm("a7") = nr;
+	register long a0 asm("a0");
+
+	asm volatile ("ecall" : "=r" (a0) : "r" (a7) : "memory");
+
+	return a0;
+}
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench(const char *name, long nr)
+{
+	unsigned long long start;
+	int i;
+
+	start = now_ns();
+	for (i = 0; i < LOOPS; i++)
+		ecall0(nr);
+
+	ksft_test_result_pass("%s: %llu ns\n", name,
+			      (now_ns() - start) / LOOPS);
+}
+
+int main(void)
+{
+	ksft_print_header();
+	ksft_set_plan(2);
+
+	bench("invalid syscall", -2);
+	bench("getppid", __NR_getppid);
+
+	ksft_finished();
+}
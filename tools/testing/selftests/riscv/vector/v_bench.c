@@ -0,0 +1,289 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Cost of the kernel's vector state handling: the first use trap, context
+ * switches, signal delivery and ptrace access, each with the vector state
+ * of the tasks unused, clean (enabled but not written since the last
+ * switch) or dirty.  This only reports numbers, so it isn't run by default.
+ *
+ * The parent never executes a vector instruction.  Every measurement runs
+ * in a fresh child, which starts out without vector state.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <asm/ptrace.h>
+#include <linux/elf.h>
+
+#include "../hwprobe/hwprobe.h"
+#include "../../kselftest.h"
+
+#define LOOPS		100000
+#define FIRST_USE_LOOPS	1000
+#define MAX_VSIZE	(8192 * 32)
+
+enum vstate {
+	V_UNUSED,
+	V_CLEAN,
+	V_DIRTY,
+};
+
+static const char * const vstate_name[] = {
+	[V_UNUSED]	= "unused",
+	[V_CLEAN]	= "clean",
+	[V_DIRTY]	= "dirty",
+};
+
+static char regset_buf[sizeof(struct __riscv_v_regset_state) + MAX_VSIZE];
+
+static inline void v_write(void)
+{
+	asm volatile (
+		".option push\n\t"
+		".option arch, +v\n\t"
+		"vsetvli	t0, x0, e8, m1, ta, ma\n\t"
+		"vmv.v.i	v0, 0\n\t"
+		".option pop\n\t"
+		: : : "t0", "memory");
+}
+
+/* The first vector instruction traps and enables V for the task. */
+static void v_prepare(enum vstate v)
+{
+	if (v != V_UNUSED)
+		v_write();
+}
+
+static void v_touch(enum vstate v)
+{
+	if (v == V_DIRTY)
+		v_write();
+}
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void pin_to_current_cpu(void)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(sched_getcpu(), &set);
+	if (sched_setaffinity(0, sizeof(set), &set))
+		ksft_exit_fail_msg("sched_setaffinity failed: %d\n", errno);
+}
+
+static int wait_child(pid_t pid)
+{
+	int status;
+
+	if (waitpid(pid, &status, 0) != pid)
+		return -1;
+	if (!WIFEXITED(status) || WEXITSTATUS(status))
+		return -1;
+	return 0;
+}
+
+/* Runs fn(v) in a new child and gets back the ns per operation. */
+static int run_in_child(unsigned long long (*fn)(enum vstate v),
+			enum vstate v, unsigned long long *ns)
+{
+	int fd[2];
+	pid_t pid;
+
+	if (pipe(fd))
+		return -1;
+
+	pid = fork();
+	if (pid < 0)
+		return -1;
+
+	if (!pid) {
+		unsigned long long res;
+
+		close(fd[0]);
+		res = fn(v);
+		if (write(fd[1], &res, sizeof(res)) != sizeof(res))
+			_exit(1);
+		_exit(0);
+	}
+
+	close(fd[1]);
+	if (read(fd[0], ns, sizeof(*ns)) != sizeof(*ns))
+		*ns = 0;
+	close(fd[0]);
+
+	return wait_child(pid) || !*ns ? -1 : 0;
+}
+
+static unsigned long long bench_first_use(enum vstate v)
+{
+	unsigned long long start = now_ns();
+
+	v_write();
+	return now_ns() - start;
+}
+
+/* Ping-pong a byte with a child on the same CPU, two switches a round. */
+static unsigned long long bench_ctxsw(enum vstate v)
+{
+	unsigned long long start, end;
+	int ping[2], pong[2];
+	char c = 0;
+	pid_t pid;
+	int i;
+
+	pin_to_current_cpu();
+	if (pipe(ping) || pipe(pong))
+		return 0;
+
+	pid = fork();
+	if (pid < 0)
+		return 0;
+
+	if (!pid) {
+		v_prepare(v);
+		for (i = 0; i < LOOPS; i++) {
+			if (read(ping[0], &c, 1) != 1)
+				_exit(1);
+			v_touch(v);
+			if (write(pong[1], &c, 1) != 1)
+				_exit(1);
+		}
+		_exit(0);
+	}
+
+	v_prepare(v);
+	start = now_ns();
+	for (i = 0; i < LOOPS; i++) {
+		v_touch(v);
+		if (write(ping[1], &c, 1) != 1 || read(pong[0], &c, 1) != 1)
+			return 0;
+	}
+	end = now_ns();
+
+	if (wait_child(pid))
+		return 0;
+
+	return (end - start) / (2 * LOOPS);
+}
+
+static void sigusr1_handler(int sig)
+{
+}
+
+static unsigned long long bench_signal(enum vstate v)
+{
+	struct sigaction sa = { .sa_handler = sigusr1_handler };
+	unsigned long long start;
+	int i;
+
+	if (sigaction(SIGUSR1, &sa, NULL))
+		return 0;
+
+	v_prepare(v);
+	start = now_ns();
+	for (i = 0; i < LOOPS; i++) {
+		v_touch(v);
+		raise(SIGUSR1);
+	}
+
+	return (now_ns() - start) / LOOPS;
+}
+
+static unsigned long long bench_ptrace(enum vstate v)
+{
+	struct iovec iov = {
+		.iov_base = regset_buf,
+		.iov_len = sizeof(regset_buf),
+	};
+	unsigned long long start, end;
+	int status, i;
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0)
+		return 0;
+
+	if (!pid) {
+		if (ptrace(PTRACE_TRACEME, 0, NULL, NULL))
+			_exit(1);
+		v_prepare(v);
+		raise(SIGSTOP);
+		_exit(0);
+	}
+
+	if (waitpid(pid, &status, 0) != pid || !WIFSTOPPED(status))
+		return 0;
+
+	start = now_ns();
+	for (i = 0; i < LOOPS; i++) {
+		iov.iov_len = sizeof(regset_buf);
+		if (ptrace(PTRACE_GETREGSET, pid, NT_RISCV_VECTOR, &iov))
+			break;
+	}
+	end = now_ns();
+
+	kill(pid, SIGKILL);
+	waitpid(pid, &status, 0);
+
+	return i == LOOPS ? (end - start) / LOOPS : 0;
+}
+
+static void report(const char *name, unsigned long long (*fn)(enum vstate v),
+		   enum vstate v)
+{
+	unsigned long long ns;
+	int ret;
+
+	ret = run_in_child(fn, v, &ns);
+	ksft_test_result(!ret, "%s, V %s: %llu ns\n", name, vstate_name[v],
+			 ret ? 0 : ns);
+}
+
+int main(void)
+{
+	struct riscv_hwprobe pair = { .key = RISCV_HWPROBE_KEY_IMA_EXT_0 };
+	unsigned long long ns, total = 0;
+	enum vstate v;
+	int i;
+
+	ksft_print_header();
+
+	if (riscv_hwprobe(&pair, 1, 0, NULL, 0) < 0 ||
+	    !(pair.value & RISCV_HWPROBE_IMA_V))
+		ksft_exit_skip("Vector not supported\n");
+
+	ksft_set_plan(1 + 3 + 3 + 1);
+
+	for (i = 0; i < FIRST_USE_LOOPS; i++) {
+		if (run_in_child(bench_first_use, V_DIRTY, &ns))
+			break;
+		total += ns;
+	}
+	ksft_test_result(i == FIRST_USE_LOOPS, "first use trap: %llu ns\n",
+			 total / FIRST_USE_LOOPS);
+
+	for (v = V_UNUSED; v <= V_DIRTY; v++)
+		report("context switch", bench_ctxsw, v);
+	for (v = V_UNUSED; v <= V_DIRTY; v++)
+		report("signal delivery", bench_signal, v);
+	/*
+	 * There is no vector regset to read until the tracee used V. Its state
+	 * was saved when it stopped, so whether it was dirty doesn't matter.
+	 */
+	report("ptrace getregset", bench_ptrace, V_CLEAN);
+
+	ksft_finished();
+}